@@ -15,8 +15,13 @@
  */
 #include <assert.h>
 #include <png.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <zlib.h>
 
 #include <string>
 #include <vector>
@@ -243,6 +248,12 @@ struct BundleConfig {
 extern "C" void resnet50(uint8_t *constantWeightVars,
                          uint8_t *mutableWeightVars, uint8_t *activations);
 extern "C" BundleConfig resnet50_config;
+// When the bundle is compiled with the -bundle-embed-weights option, the
+// constant weights live in a read-only data section of the bundle object
+// under this symbol and no separate weights file is produced. The symbol is
+// declared weak so that the same client links against bundles of both styles;
+// it is null when the weights are in a separate file.
+extern "C" __attribute__((weak)) uint8_t resnet50_constantWeights[];
 
 /// Find in the bundle's symbol table a weight variable whose name starts with
 /// \p name.
@@ -282,6 +293,101 @@ void *alignedAlloc(const BundleConfig &config, size_t size) {
   return ptr;
 }
 
+/// On-disk header of a chunked weights file, as written by the CPU backend
+/// when the bundle is compiled with the -bundle-compress-weights option. The
+/// header is followed by \p numChunks WeightsFileChunk index entries and then
+/// by the chunk payloads in index order.
+struct WeightsFileHeader {
+  // Identifies the chunked weights file format.
+  char magic[8];
+  // Total size of the constant weights memory area after decompression.
+  uint64_t uncompressedSize;
+  // Size of each chunk before compression. The last chunk may be shorter.
+  uint64_t chunkSize;
+  // Number of chunks in the file.
+  uint64_t numChunks;
+};
+
+/// On-disk index entry describing the location of one chunk.
+struct WeightsFileChunk {
+  // Offset of the chunk payload from the beginning of the file.
+  uint64_t offset;
+  // Size of the chunk payload in the file.
+  uint64_t size;
+  // Nonzero if the payload is zlib-compressed.
+  uint64_t compressed;
+};
+
+// State of the lazily-mapped weights area, consumed by the fault handler.
+static uint8_t *lazyWeightsAddr = nullptr;
+static const WeightsFileHeader *lazyWeightsHeader = nullptr;
+static const WeightsFileChunk *lazyWeightsIndex = nullptr;
+static const uint8_t *lazyWeightsFile = nullptr;
+
+/// Fault handler for the lazily-mapped weights area. It makes the chunk under
+/// the faulting address accessible and fills it from the mapped weights file,
+/// decompressing the payload when needed. Faults outside of the weights area
+/// are forwarded to the default handler.
+static void lazyWeightsFaultHandler(int sig, siginfo_t *info, void *context) {
+  uint8_t *addr = (uint8_t *)info->si_addr;
+  if (!lazyWeightsAddr || addr < lazyWeightsAddr ||
+      addr >= lazyWeightsAddr + lazyWeightsHeader->uncompressedSize) {
+    // Not a touch of the weights area; let the default handler report it.
+    signal(SIGSEGV, SIG_DFL);
+    return;
+  }
+  size_t chunkIdx = (addr - lazyWeightsAddr) / lazyWeightsHeader->chunkSize;
+  uint8_t *chunkAddr = lazyWeightsAddr + chunkIdx * lazyWeightsHeader->chunkSize;
+  size_t chunkSize = lazyWeightsHeader->chunkSize;
+  if (chunkIdx == lazyWeightsHeader->numChunks - 1) {
+    chunkSize = lazyWeightsHeader->uncompressedSize -
+                chunkIdx * lazyWeightsHeader->chunkSize;
+  }
+  int res = mprotect(chunkAddr, chunkSize, PROT_READ | PROT_WRITE);
+  assert(res == 0 && "mprotect failed");
+  const uint8_t *payload = lazyWeightsFile + lazyWeightsIndex[chunkIdx].offset;
+  if (lazyWeightsIndex[chunkIdx].compressed) {
+    uLongf destLen = chunkSize;
+    res = uncompress(chunkAddr, &destLen, payload,
+                     lazyWeightsIndex[chunkIdx].size);
+    assert(res == Z_OK && destLen == chunkSize &&
+           "Could not decompress a weights chunk");
+  } else {
+    memcpy(chunkAddr, payload, chunkSize);
+  }
+  (void)res;
+}
+
+/// Set up the lazy mapping of the constant weights from the mapped chunked
+/// weights file at \p fileAddr. The weights area starts out inaccessible, and
+/// each chunk is read (and decompressed) on first touch, so start-up does not
+/// pay for weights before the network actually uses them.
+static uint8_t *initLazyConstantWeights(const uint8_t *fileAddr,
+                                        const BundleConfig &config) {
+  auto *header = (const WeightsFileHeader *)fileAddr;
+  assert(header->uncompressedSize == config.constantWeightVarsMemSize &&
+         "Wrong weights file size");
+  uint8_t *baseAddr =
+      (uint8_t *)mmap(nullptr, header->uncompressedSize, PROT_NONE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  assert(baseAddr != MAP_FAILED && "Could not reserve the weights area");
+  lazyWeightsAddr = baseAddr;
+  lazyWeightsHeader = header;
+  lazyWeightsIndex =
+      (const WeightsFileChunk *)(fileAddr + sizeof(WeightsFileHeader));
+  lazyWeightsFile = fileAddr;
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_sigaction = lazyWeightsFaultHandler;
+  action.sa_flags = SA_SIGINFO;
+  int res = sigaction(SIGSEGV, &action, nullptr);
+  assert(res == 0 && "Could not install the fault handler");
+  (void)res;
+  printf("Mapped weights of size: %lu\n",
+         (unsigned long)header->uncompressedSize);
+  return baseAddr;
+}
+
 /// Initialize the constant weights memory block by loading the weights from the
 /// weights file.
 static uint8_t *initConstantWeights(const char *weightsFileName,
@@ -295,6 +401,20 @@ static uint8_t *initConstantWeights(const char *weightsFileName,
   fseek(weightsFile, 0, SEEK_END);
   size_t fileSize = ftell(weightsFile);
   fseek(weightsFile, 0, SEEK_SET);
+  // A chunked weights file is mapped and loaded lazily instead of being read
+  // up front.
+  WeightsFileHeader header;
+  if (fileSize >= sizeof(WeightsFileHeader) &&
+      fread(&header, sizeof(header), 1, weightsFile) == 1 &&
+      !memcmp(header.magic, "GlowWts1", sizeof(header.magic))) {
+    auto *fileAddr = (const uint8_t *)mmap(nullptr, fileSize, PROT_READ,
+                                           MAP_PRIVATE, fileno(weightsFile), 0);
+    assert(fileAddr != MAP_FAILED && "Could not map the weights file");
+    // The mapping stays valid after the file is closed.
+    fclose(weightsFile);
+    return initLazyConstantWeights(fileAddr, config);
+  }
+  fseek(weightsFile, 0, SEEK_SET);
   uint8_t *baseConstantWeightVarsAddr =
       static_cast<uint8_t *>(alignedAlloc(config, fileSize));
   printf("Allocated weights of size: %lu\n", fileSize);
@@ -366,9 +486,13 @@ static uint8_t *initActivations(const BundleConfig &config) {
 
 int main(int argc, char **argv) {
   parseCommandLineOptions(argc, argv);
-  // Allocate and initialize constant and mutable weights.
+  // Use the weights embedded in the bundle object when present; the OS loader
+  // demand-pages them straight from the executable. Otherwise allocate the
+  // constant weights area and fill it from the weights file.
   uint8_t *constantWeightVarsAddr =
-      initConstantWeights("resnet50.weights", resnet50_config);
+      resnet50_constantWeights
+          ? resnet50_constantWeights
+          : initConstantWeights("resnet50.weights", resnet50_config);
   uint8_t *mutableWeightVarsAddr = initMutableWeightVars(resnet50_config);
   uint8_t *activationsAddr = initActivations(resnet50_config);
 
@@ -378,8 +502,15 @@ int main(int argc, char **argv) {
   // Report the results.
   dumpInferenceResults(resnet50_config, mutableWeightVarsAddr);
 
-  // Free all resources.
+  // Free all resources. The constant weights are embedded in the executable,
+  // malloc'ed or lazily mapped, depending on how the bundle was compiled.
   free(activationsAddr);
-  free(constantWeightVarsAddr);
+  if (constantWeightVarsAddr == resnet50_constantWeights) {
+    // Nothing to free; the weights belong to the executable image.
+  } else if (constantWeightVarsAddr == lazyWeightsAddr) {
+    munmap(lazyWeightsAddr, lazyWeightsHeader->uncompressedSize);
+  } else {
+    free(constantWeightVarsAddr);
+  }
   free(mutableWeightVarsAddr);
 }
@@ -195,6 +195,78 @@ static Function *createNetwork(Module &mod, size_t minibatchSize,
   return F;
 }
 
+/// Creates a single-timestep generator network that shares the trained
+/// weights of the unrolled network built by createNetwork. The recurrent
+/// hidden and cell states live in the module variables "genH" and "genC",
+/// and the network saves its new states back into them, so the state
+/// persists between ExecutionEngine::run calls and generating each char
+/// costs one timestep instead of re-running all of them.
+static Function *createGeneratorNetwork(Module &mod, size_t hiddenSize) {
+  Function *G = mod.createFunction("generate");
+
+  Variable *X = mod.createVariable(ElemKind::FloatTy, {1, 128}, "genInput",
+                                   VisibilityKind::Public,
+                                   Variable::TrainKind::None);
+  Variable *H =
+      mod.createVariable(ElemKind::FloatTy, {1, hiddenSize}, "genH",
+                         VisibilityKind::Public, Variable::TrainKind::None);
+  Variable *C =
+      mod.createVariable(ElemKind::FloatTy, {1, hiddenSize}, "genC",
+                         VisibilityKind::Public, Variable::TrainKind::None);
+  // The softmax selector is unused during inference.
+  Variable *S =
+      mod.createVariable(ElemKind::IndexTy, {1, 1}, "genSelector",
+                         VisibilityKind::Public, Variable::TrainKind::None);
+
+  // Look up the weights that createLSTM created and the trainer updated.
+  auto W = [&](const char *name) {
+    Variable *V = mod.getVariableByName(std::string("rnn.") + name);
+    GLOW_ASSERT(V && "Unknown LSTM weight");
+    return V;
+  };
+
+  // One LSTM timestep with the same gate math that createLSTM unrolls.
+  auto *Ft = G->createSigmoid(
+      "gen.f", G->createAdd("gen.f.pre",
+                            G->createFullyConnected("gen.f.h", H, W("Whf"),
+                                                    W("bf1")),
+                            G->createFullyConnected("gen.f.x", X, W("Wxf"),
+                                                    W("bf2"))));
+  auto *It = G->createSigmoid(
+      "gen.i", G->createAdd("gen.i.pre",
+                            G->createFullyConnected("gen.i.h", H, W("Whi"),
+                                                    W("bi1")),
+                            G->createFullyConnected("gen.i.x", X, W("Wxi"),
+                                                    W("bi2"))));
+  auto *Ot = G->createSigmoid(
+      "gen.o", G->createAdd("gen.o.pre",
+                            G->createFullyConnected("gen.o.h", H, W("Who"),
+                                                    W("bo1")),
+                            G->createFullyConnected("gen.o.x", X, W("Wxo"),
+                                                    W("bo2"))));
+  auto *CRt = G->createTanh(
+      "gen.cr", G->createAdd("gen.cr.pre",
+                             G->createFullyConnected("gen.cr.h", H, W("Whc"),
+                                                     W("bc1")),
+                             G->createFullyConnected("gen.cr.x", X, W("Wxc"),
+                                                     W("bc2"))));
+
+  auto *newC = G->createAdd("gen.newc", G->createMul("gen.fc", Ft, C),
+                            G->createMul("gen.icr", It, CRt));
+  auto *newH =
+      G->createMul("gen.newh", Ot, G->createTanh("gen.tanhc", newC));
+
+  // Persist the state for the next run call.
+  G->createSave("gen.saveH", newH, H);
+  G->createSave("gen.saveC", newC, C);
+
+  auto *O = G->createFullyConnected("gen.out", newH, W("Why"), W("by"));
+  auto *SM = G->createSoftMax("gen.softmax", O, S);
+  auto *K = G->createReshape("gen.reshape", SM, {1, 1, 128});
+  G->createSave("genResult", K);
+  return G;
+}
+
 int main(int argc, char **argv) {
   llvm::cl::ParseCommandLineOptions(argc, argv, " The char-rnn test\n\n");
   auto mb = loadFile(inputFilename);
@@ -220,6 +292,9 @@ int main(int argc, char **argv) {
   Function *F = createNetwork(mod, minibatchSize, numSteps, hiddenSize);
   Function *TF = differentiate(F, TC);
 
+  //// Generation runs a separate stateful single-timestep network ////
+  Function *G = createGeneratorNetwork(mod, hiddenSize);
+
   auto *X = mod.getVariableByName("input");
   auto *Y = mod.getVariableByName("expected");
 
@@ -239,33 +314,39 @@ int main(int argc, char **argv) {
     llvm::outs() << ".\n";
 
     //// Use the trained network to generate some text ////
-    EE.compile(CompilationMode::Infer, F);
+    EE.compile(CompilationMode::Infer, G);
 
-    // Load a few characters to start the text that we generate.
-    Tensor currCharInfer(ElemKind::FloatTy, {minibatchSize, numSteps, 128});
-    Tensor nextCharInfer(ElemKind::IndexTy, {minibatchSize, numSteps});
-    loadText(currCharInfer, nextCharInfer, text.slice(0, 128), false);
+    // Start generation from a fresh state.
+    auto *X1 = mod.getVariableByName("genInput");
+    mod.getVariableByName("genH")->getPayload().zero();
+    mod.getVariableByName("genC")->getPayload().zero();
 
-    auto *res = llvm::cast<SaveNode>(F->getNodeByName("result"));
+    auto *res = llvm::cast<SaveNode>(G->getNodeByName("genResult"));
     auto &T = res->getVariable()->getPayload();
 
-    std::string result;
-    std::string input;
-    input.insert(input.begin(), text.begin(), text.begin() + numSteps);
-    result = input;
+    Tensor currChar(ElemKind::FloatTy, {1, 128});
+    auto feedChar = [&](char c) {
+      currChar.zero();
+      currChar.getHandle().at({0, clipASCII(c)}) = 1.0;
+      // The hidden and cell states persist in the genH/genC variables
+      // between run calls, so each char costs a single timestep.
+      EE.run({X1}, {&currChar});
+    };
 
-    // Generate a sentence by running inference over and over again.
-    for (unsigned i = 0; i < generateChars; i++) {
-      // Generate a char:
-      EE.run({X}, {&currCharInfer});
-      // Pick a char at random from the softmax distribution.
-      char c = getPredictedChar(T, 0, numSteps - 1);
+    std::string result(text.begin(), text.begin() + numSteps);
+
+    // Prime the recurrent state with the seed text.
+    for (char c : result) {
+      feedChar(c);
+    }
 
-      // Update the inputs for the next iteration:
+    // Generate a sentence one char at a time.
+    for (unsigned i = 0; i < generateChars; i++) {
+      // Pick a char at random from the softmax distribution and feed it
+      // back in as the next input.
+      char c = getPredictedChar(T, 0, 0);
       result.push_back(c);
-      input.push_back(c);
-      input.erase(input.begin());
-      loadText(currCharInfer, nextCharInfer, input, false);
+      feedChar(c);
     }
 
     llvm::outs() << "Generated output:\n" << result << "\n";
@@ -49,6 +49,10 @@ llvm::cl::alias batchSizeA("b", llvm::cl::desc("Alias for -batchsize"),
                            llvm::cl::aliasopt(batchSizeOpt),
                            llvm::cl::cat(fr2enCat));
 
+llvm::cl::opt<unsigned> beamSizeOpt(
+    "beamsize", llvm::cl::desc("Decode with N beams per sentence."),
+    llvm::cl::init(1), llvm::cl::value_desc("N"), llvm::cl::cat(fr2enCat));
+
 llvm::cl::opt<bool>
     timeOpt("time",
             llvm::cl::desc("Print timer data detailing how long it "
@@ -125,19 +129,30 @@ void loadMatrixFromFile(llvm::StringRef filename, Tensor &result) {
 /// few references to input/output Variables.
 struct Model {
   unsigned batchSize_;
+  unsigned beamSize_;
   ExecutionEngine EE_{ExecutionBackend};
   Function *F_;
+  /// The batched single-step decoder. All beams of all sentences run as one
+  /// batch per step, and the recurrent state persists in beamHidden_
+  /// between runs.
+  Function *FDec_;
   Vocabulary en_, fr_;
   Variable *input_;
   Variable *seqLength_;
-  Variable *output_;
+  Variable *encoderHidden_;
+  Variable *beamSrc_;
+  Variable *lastWord_;
+  Variable *beamHidden_;
+  Variable *topKValues_;
+  Variable *topKIndices_;
 
   void loadLanguages();
   void loadEncoder();
   void loadDecoder();
   void translate(const std::vector<std::string> &batch);
 
-  Model(unsigned batchSize) : batchSize_(batchSize) {
+  Model(unsigned batchSize, unsigned beamSize)
+      : batchSize_(batchSize), beamSize_(beamSize) {
     F_ = EE_.getModule().createFunction("main");
   }
 
@@ -172,7 +187,6 @@ struct Model {
 
 private:
   Variable *embedding_fr_, *embedding_en_;
-  Node *encoderHiddenOutput_;
 
   Variable *loadEmbedding(llvm::StringRef langPrefix, size_t langSize) {
     auto &mod = EE_.getModule();
@@ -187,25 +201,25 @@ private:
 
   Node *createPyTorchGRUCell(Function *G, Node *input, Node *hidden,
                              Variable *w_ih, Variable *b_ih, Variable *w_hh,
-                             Variable *b_hh) {
+                             Variable *b_hh, size_t batch) {
     // reference implementation:
     // https://github.com/pytorch/pytorch/blob/dd5c195646b941d3e20a72847ac48c41e272b8b2/torch/nn/_functions/rnn.py#L46
     Node *gi = G->createFullyConnected("pytorch.GRU.gi", input, w_ih, b_ih);
     Node *gh = G->createFullyConnected("pytorch.GRU.gh", hidden, w_hh, b_hh);
 
     Node *i_r = G->createSlice("pytorch.GRU.i_r", gi, {0, 0},
-                               {batchSize_, EMBEDDING_SIZE});
+                               {batch, EMBEDDING_SIZE});
     Node *i_i = G->createSlice("pytorch.GRU.i_i", gi, {0, EMBEDDING_SIZE},
-                               {batchSize_, 2 * EMBEDDING_SIZE});
+                               {batch, 2 * EMBEDDING_SIZE});
     Node *i_n = G->createSlice("pytorch.GRU.i_n", gi, {0, 2 * EMBEDDING_SIZE},
-                               {batchSize_, 3 * EMBEDDING_SIZE});
+                               {batch, 3 * EMBEDDING_SIZE});
 
     Node *h_r = G->createSlice("pytorch.GRU.h_r", gh, {0, 0},
-                               {batchSize_, EMBEDDING_SIZE});
+                               {batch, EMBEDDING_SIZE});
     Node *h_i = G->createSlice("pytorch.GRU.h_i", gh, {0, EMBEDDING_SIZE},
-                               {batchSize_, 2 * EMBEDDING_SIZE});
+                               {batch, 2 * EMBEDDING_SIZE});
     Node *h_n = G->createSlice("pytorch.GRU.h_n", gh, {0, 2 * EMBEDDING_SIZE},
-                               {batchSize_, 3 * EMBEDDING_SIZE});
+                               {batch, 3 * EMBEDDING_SIZE});
 
     Node *resetgate = G->createSigmoid("pytorch.GRU.resetgate",
                                        G->createAdd("i_r_plus_h_r", i_r, h_r));
@@ -279,7 +293,8 @@ void Model::loadEncoder() {
     Node *reshape =
         F_->createReshape("encoder." + std::to_string(step) + ".reshape",
                           inputSlice, {batchSize_, EMBEDDING_SIZE});
-    hidden = createPyTorchGRUCell(F_, reshape, hidden, w_ih, b_ih, w_hh, b_hh);
+    hidden = createPyTorchGRUCell(F_, reshape, hidden, w_ih, b_ih, w_hh,
+                                  b_hh, batchSize_);
     outputs.push_back(hidden);
   }
 
@@ -287,20 +302,51 @@ void Model::loadEncoder() {
   Node *r2 = F_->createReshape("encoder.output.r2", output,
                                {MAX_LENGTH * batchSize_, EMBEDDING_SIZE});
 
-  encoderHiddenOutput_ = F_->createGather("encoder.outputNth", r2, seqLength_);
+  Node *encoderHiddenOutput =
+      F_->createGather("encoder.outputNth", r2, seqLength_);
+
+  // The final encoder state is saved into a variable so that the decoder
+  // steps, which run as a separate function, can read it. All beams of a
+  // sentence share this one encoder execution.
+  encoderHidden_ = mod.createVariable(
+      ElemKind::FloatTy, {batchSize_, EMBEDDING_SIZE}, "encoder.hidden",
+      VisibilityKind::Public, Variable::TrainKind::None);
+  F_->createSave("encoder.saveHidden", encoderHiddenOutput, encoderHidden_);
 }
 
-/// Model part representing Decoder.
-/// Uses \p encoderHiddenOutput as final state from Encoder.
-/// Resulting translation is put into \p output Variable.
+/// Model part representing the Decoder. Builds a batched single-step
+/// function: one run advances all beamSize_ beams of all batchSize_
+/// sentences by one word. The recurrent state lives in the beamHidden_
+/// variable and persists between runs; each step first gathers the state
+/// rows named by beamSrc_, so the host can reorder beams between steps by
+/// writing indices instead of copying hidden vectors. The per-row TopK
+/// feeds the candidate words and their log-probabilities back to the host,
+/// which only merges beamSize_ x beamSize_ scalar candidates per sentence.
 void Model::loadDecoder() {
   auto &mod = EE_.getModule();
-  Variable *input =
-      mod.createVariable(ElemKind::IndexTy, {batchSize_}, "decoder.input",
+  const size_t rows = batchSize_ * beamSize_;
+
+  FDec_ = mod.createFunction("decoder.step");
+
+  beamSrc_ = mod.createVariable(ElemKind::IndexTy, {rows}, "decoder.beamSrc",
+                                VisibilityKind::Public,
+                                Variable::TrainKind::None);
+  lastWord_ = mod.createVariable(ElemKind::IndexTy, {rows},
+                                 "decoder.lastWord", VisibilityKind::Public,
+                                 Variable::TrainKind::None);
+  beamHidden_ = mod.createVariable(
+      ElemKind::FloatTy, {rows, EMBEDDING_SIZE}, "decoder.beamHidden",
+      VisibilityKind::Public, Variable::TrainKind::None);
+  topKValues_ = mod.createVariable(
+      ElemKind::FloatTy, {rows, beamSize_}, "decoder.topk.values",
+      VisibilityKind::Public, Variable::TrainKind::None);
+  topKIndices_ = mod.createVariable(
+      ElemKind::IndexTy, {rows, beamSize_}, "decoder.topk.indices",
+      VisibilityKind::Public, Variable::TrainKind::None);
+  // The softmax selector is unused during inference.
+  Variable *selector =
+      mod.createVariable(ElemKind::IndexTy, {rows, 1}, "decoder.selector",
                          VisibilityKind::Private, Variable::TrainKind::None);
-  for (size_t i = 0; i < batchSize_; i++) {
-    input->getPayload().getHandle<size_t>().at({i}) = en_.word2index_["SOS"];
-  }
 
   Variable *w_ih = mod.createVariable(
       ElemKind::FloatTy, {EMBEDDING_SIZE, HIDDEN_SIZE}, "decoder.w_ih",
@@ -327,36 +373,25 @@ void Model::loadDecoder() {
   loadMatrixFromFile("fr2en/decoder_out_w.bin", out_w->getPayload());
   loadMatrixFromFile("fr2en/decoder_out_b.bin", out_b->getPayload());
 
-  Node *hidden = encoderHiddenOutput_;
-  Node *lastWordIdx = input;
-
-  std::vector<NodeValue> outputs;
-  // TODO: decoder does exactly MAX_LENGTH steps, while translation could be
-  // smaller. We could use control flow here.
-  for (unsigned step = 0; step < MAX_LENGTH; step++) {
-    // Use last translated word as an input at the current step.
-    Node *embedded =
-        F_->createGather("decoder.embedding." + std::to_string(step),
-                         embedding_en_, lastWordIdx);
-
-    Node *relu = F_->createRELU("decoder.relu", embedded);
-    hidden = createPyTorchGRUCell(F_, relu, hidden, w_ih, b_ih, w_hh, b_hh);
-
-    Node *FC = F_->createFullyConnected("decoder.outFC", hidden, out_w, out_b);
-    auto *topK = F_->createTopK("decoder.topK", FC, 1);
-
-    lastWordIdx =
-        F_->createReshape("decoder.reshape", topK->getIndices(), {batchSize_});
-    outputs.push_back(lastWordIdx);
-  }
-
-  Node *concat = F_->createConcat("decoder.output.concat", outputs, 0);
-  Node *reshape = F_->createReshape("decoder.output.reshape", concat,
-                                    {MAX_LENGTH, batchSize_});
-  output_ = mod.createVariable(ElemKind::IndexTy, {MAX_LENGTH, batchSize_},
-                               "decoder.output", VisibilityKind::Public,
-                               Variable::TrainKind::None);
-  F_->createSave("decoder.output", reshape, output_);
+  // Reorder the persistent state: beam row r continues from the previous
+  // step's row beamSrc[r].
+  Node *hidden = FDec_->createGather("decoder.gatherHidden", beamHidden_,
+                                     beamSrc_);
+
+  Node *embedded =
+      FDec_->createGather("decoder.embedding", embedding_en_, lastWord_);
+  Node *relu = FDec_->createRELU("decoder.relu", embedded);
+  hidden = createPyTorchGRUCell(FDec_, relu, hidden, w_ih, b_ih, w_hh, b_hh,
+                                rows);
+  FDec_->createSave("decoder.saveHidden", hidden, beamHidden_);
+
+  Node *FC = FDec_->createFullyConnected("decoder.outFC", hidden, out_w,
+                                         out_b);
+  Node *probs = FDec_->createSoftMax("decoder.softmax", FC, selector);
+  Node *logProbs = FDec_->createLog("decoder.logprobs", probs);
+  auto *topK = FDec_->createTopK("decoder.topK", logProbs, beamSize_);
+  FDec_->createSave("decoder.topk.values", topK->getValues(), topKValues_);
+  FDec_->createSave("decoder.topk.indices", topK->getIndices(), topKIndices_);
 }
 
 /// Translation has 2 stages:
@@ -386,13 +421,105 @@ void Model::translate(const std::vector<std::string> &batch) {
     seqLength.getHandle<size_t>().at({j}) = (words.size() - 1) + j * MAX_LENGTH;
   }
 
+  // Run the encoder once for the whole batch. The compile cache makes the
+  // alternation between the encoder and decoder functions a reinstall
+  // rather than a recompilation.
+  EE_.compile(CompilationMode::Infer, F_);
   EE_.run({input_, seqLength_}, {&input, &seqLength});
 
-  auto OH = output_->getPayload().getHandle<size_t>();
+  const size_t K = beamSize_;
+  const size_t rows = batchSize_ * K;
+  const size_t SOS = en_.word2index_["SOS"];
+  const size_t EOS = en_.word2index_["EOS"];
+
+  // Seed every beam of sentence b with encoder state row b. Only beam 0
+  // starts live; the rest begin with a score low enough that the first
+  // step repopulates them from beam 0's candidates.
+  auto EH = encoderHidden_->getPayload().getHandle<float>();
+  auto BH = beamHidden_->getPayload().getHandle<float>();
+  for (size_t b = 0; b < batchSize_; b++) {
+    for (size_t k = 0; k < K; k++) {
+      for (size_t e = 0; e < EMBEDDING_SIZE; e++) {
+        BH.at({b * K + k, e}) = EH.at({b, e});
+      }
+    }
+  }
+
+  Tensor beamSrcT(ElemKind::IndexTy, {rows});
+  Tensor lastWordT(ElemKind::IndexTy, {rows});
+  auto srcH = beamSrcT.getHandle<size_t>();
+  auto wordH = lastWordT.getHandle<size_t>();
+  std::vector<double> score(rows);
+  std::vector<bool> ended(rows, false);
+  std::vector<std::vector<size_t>> words(rows);
+  for (size_t r = 0; r < rows; r++) {
+    srcH.at({r}) = r;
+    wordH.at({r}) = SOS;
+    score[r] = (r % K) ? -1e9 : 0;
+  }
+
+  EE_.compile(CompilationMode::Infer, FDec_);
+  for (unsigned step = 0; step < MAX_LENGTH; step++) {
+    // One batched execution advances every beam of every sentence.
+    EE_.run({beamSrc_, lastWord_}, {&beamSrcT, &lastWordT});
+
+    auto VH = topKValues_->getPayload().getHandle<float>();
+    auto IH = topKIndices_->getPayload().getHandle<size_t>();
+
+    // Merge the K * K candidates of each sentence on the host. Only these
+    // scalar scores ever leave the device; the hidden states are reordered
+    // by the gather at the top of the next step.
+    struct Candidate {
+      double score;
+      size_t srcRow;
+      size_t word;
+    };
+    std::vector<double> newScore(rows);
+    std::vector<bool> newEnded(rows);
+    std::vector<std::vector<size_t>> newWords(rows);
+    for (size_t b = 0; b < batchSize_; b++) {
+      std::vector<Candidate> cands;
+      for (size_t k = 0; k < K; k++) {
+        size_t r = b * K + k;
+        if (ended[r]) {
+          // A finished beam competes with its final score but does not
+          // grow.
+          cands.push_back({score[r], r, EOS});
+          continue;
+        }
+        for (size_t j = 0; j < K; j++) {
+          cands.push_back({score[r] + VH.at({r, j}), r, IH.at({r, j})});
+        }
+      }
+      std::partial_sort(cands.begin(), cands.begin() + K, cands.end(),
+                        [](const Candidate &a, const Candidate &b) {
+                          return a.score > b.score;
+                        });
+      for (size_t k = 0; k < K; k++) {
+        size_t r = b * K + k;
+        const Candidate &c = cands[k];
+        newScore[r] = c.score;
+        newEnded[r] = ended[c.srcRow] || c.word == EOS;
+        newWords[r] = words[c.srcRow];
+        if (!ended[c.srcRow]) {
+          newWords[r].push_back(c.word);
+        }
+        srcH.at({r}) = c.srcRow;
+        wordH.at({r}) = c.word;
+      }
+    }
+    score = std::move(newScore);
+    ended = std::move(newEnded);
+    words = std::move(newWords);
+  }
+
+  // The beams of each sentence are kept sorted by score, so beam 0 holds
+  // the best hypothesis.
   for (unsigned j = 0; j < batch.size(); j++) {
-    for (unsigned i = 0; i < MAX_LENGTH; i++) {
-      size_t wordIdx = OH.at({i, j});
-      if (wordIdx == en_.word2index_["EOS"])
+    const auto &best = words[j * K];
+    for (size_t i = 0; i < best.size(); i++) {
+      size_t wordIdx = best[i];
+      if (wordIdx == EOS)
         break;
 
       if (i)
@@ -416,7 +543,7 @@ int main(int argc, char **argv) {
   llvm::cl::ParseCommandLineOptions(
       argc, argv, "Translate sentences from French to English");
 
-  Model seq2seq(batchSizeOpt);
+  Model seq2seq(batchSizeOpt, beamSizeOpt);
   seq2seq.loadLanguages();
   seq2seq.loadEncoder();
   seq2seq.loadDecoder();
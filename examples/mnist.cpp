@@ -13,6 +13,7 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include "glow/Base/TensorArchive.h"
 #include "glow/ExecutionEngine/ExecutionEngine.h"
 #include "glow/Graph/Graph.h"
 #include "glow/Support/Support.h"
@@ -23,6 +24,7 @@
 
 #include <cassert>
 #include <fstream>
+#include <memory>
 
 using namespace glow;
 
@@ -40,6 +42,17 @@ llvm::cl::opt<BackendKind> executionBackend(
 } // namespace
 
 unsigned loadMNIST(Tensor &imageInputs, Tensor &labelInputs) {
+  // A previous run leaves the parsed dataset behind as a mmap-able archive;
+  // loading it is zero-copy, so the parse below is paid only once per
+  // machine and concurrent experiments share the pages of the archive.
+  static std::unique_ptr<TensorArchive> archive;
+  if (TensorArchive::isArchive("mnist.glowdata")) {
+    archive.reset(new TensorArchive("mnist.glowdata"));
+    imageInputs = archive->getTensor(0);
+    labelInputs = archive->getTensor(1);
+    return mnistNumImages;
+  }
+
   /// Load the MNIST database into 4D tensor of images and 2D tensor of labels.
   imageInputs.reset(ElemKind::FloatTy, {50000u, 28, 28, 1});
   labelInputs.reset(ElemKind::IndexTy, {50000u, 1});
@@ -80,6 +93,9 @@ unsigned loadMNIST(Tensor &imageInputs, Tensor &labelInputs) {
   }
   size_t numImages = labels.size();
   GLOW_ASSERT(numImages && "No images were found.");
+
+  // Leave an archive behind, so the next run skips the parse.
+  TensorArchive::write("mnist.glowdata", {&imageInputs, &labelInputs});
   return numImages;
 }
 
@@ -146,7 +162,8 @@ void testMNIST() {
     // On each training iteration take a slice of imageInputs and labelInputs
     // and put them into variables A and B, then run forward and backward passes
     // and update weights.
-    EE.runBatch(numIterations, {A, selected}, {&imageInputs, &labelInputs});
+    EE.runBatchPrefetch(numIterations, {A, selected},
+                        {&imageInputs, &labelInputs});
 
     timer.stopTimer();
   }
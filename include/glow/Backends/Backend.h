@@ -22,6 +22,9 @@
 
 #include <llvm/ADT/StringRef.h>
 
+#include <memory>
+#include <vector>
+
 namespace glow {
 
 class IRFunction;
@@ -43,12 +46,28 @@ public:
   virtual std::unique_ptr<CompiledFunction>
   compile(std::unique_ptr<IRFunction> IR) const = 0;
 
+  /// Generate code for input function \param IR with affinity to device
+  /// \p deviceAffinity, for backends that manage several devices. The
+  /// default implementation, defined out of line because IRFunction is
+  /// incomplete here, ignores the affinity and compiles for the backend's
+  /// default device.
+  virtual std::unique_ptr<CompiledFunction>
+  compile(std::unique_ptr<IRFunction> IR, unsigned deviceAffinity) const;
+
   /// Save the bundle for a later standalone execution.
   virtual void save(std::unique_ptr<IRFunction> IR,
                     llvm::StringRef outputDir) const {
     GLOW_UNREACHABLE("Saving a bundle is not supported by the backend");
   }
 
+  /// Save one bundle with an entry point per function of \p IRs, which must
+  /// all belong to one module. Backends that can share the weights between
+  /// the entry points emit them once; the default implementation, defined
+  /// out of line because IRFunction is incomplete here, saves each function
+  /// as a bundle of its own.
+  virtual void save(std::vector<std::unique_ptr<IRFunction>> IRs,
+                    llvm::StringRef outputDir) const;
+
   /// @name Backend transform methods for different phases.
   /// These methods are called by the compiler before code generation and gives
   /// the backend an opportunity to transform the graph before IRGen. The
@@ -69,17 +88,34 @@ public:
   virtual bool isOpSupported(Kinded::Kind opKind, ElemKind elementTy) const = 0;
 
   /// \returns true if the supplied Node \N should be lowered. By default, all
-  /// Nodes are candidates for lowering.
+  /// Nodes are candidates for lowering. Backends return false for operators
+  /// they execute natively; such operators must also be reported as supported
+  /// by isOpSupported, which lower() verifies.
   virtual bool shouldLower(const Node *N) const { return true; }
 
   /// \returns true if the Backend wants the buffer sharing optimization
   /// performed.
   virtual bool shouldShareBuffers() const { return true; }
+
+  /// \returns true if the backend observes a variable payload that was
+  /// rebound to a caller buffer after compilation. Backends that resolve
+  /// payload addresses at compile time return false.
+  virtual bool supportsBoundIO() const { return true; }
+
+  /// \returns true if the backend has kernels for CSR-encoded sparse
+  /// weights. Sparse weights are densified before compilation for backends
+  /// that do not.
+  virtual bool supportsSparseWeights() const { return false; }
 };
 
 /// Create a backend of kind \p kind.
 Backend *createBackend(BackendKind backendKind);
 
+/// \returns true if a backend of kind \p backendKind is compiled in and
+/// usable on this host, e.g. the OpenCL backend reports whether a device
+/// is present. Creating an unavailable backend aborts.
+bool isBackendAvailable(BackendKind backendKind);
+
 } // namespace glow
 
 #endif // GLOW_BACKENDS_BACKEND_H
@@ -16,8 +16,13 @@
 #ifndef GLOW_BACKENDS_COMPILEDFUNCTION_H
 #define GLOW_BACKENDS_COMPILEDFUNCTION_H
 
+#include <cassert>
+#include <cstddef>
+
 namespace glow {
 
+class Variable;
+
 /// Interface for executing a compiled function.
 class CompiledFunction {
 public:
@@ -26,6 +31,60 @@ public:
 
   /// Execute the network.
   virtual void execute() = 0;
+
+  /// \returns the number of independent activation regions the function was
+  /// compiled with. A function compiled with several regions can run
+  /// back-to-back batches against alternating regions, so that the input
+  /// upload and output download of one batch overlap with the compute of
+  /// the other.
+  virtual unsigned getNumActivationRegions() const { return 1; }
+
+  /// Selects the activation \p region that subsequent calls to execute()
+  /// run against.
+  virtual void setActivationRegion(unsigned region) {
+    (void)region;
+    assert(region == 0 && "Function was compiled with a single region");
+  }
+
+  /// \returns the size in bytes of one activation arena, so that callers of
+  /// executeWithActivations() can allocate arenas of their own.
+  virtual size_t getActivationsSize() const { return 0; }
+
+  /// Execute the network against the caller-provided activation arena at
+  /// \p activations, which must be at least getActivationsSize() bytes and
+  /// properly aligned. Unlike execute(), concurrent calls with disjoint
+  /// arenas may run in parallel on different threads.
+  virtual void executeWithActivations(void *activations) {
+    (void)activations;
+    assert(false && "Backend does not support external activation arenas");
+  }
+
+  /// \returns the size in bytes of the mutable weights arena of an
+  /// execution context: the inputs and outputs of one request. Zero when
+  /// the backend does not support execution contexts.
+  virtual size_t getMutableWeightsSize() const { return 0; }
+
+  /// \returns the offset of the public variable \p v inside a context's
+  /// mutable weights arena.
+  virtual size_t getMutableWeightOffset(const Variable *v) const {
+    (void)v;
+    assert(false && "Backend does not support execution contexts");
+    return 0;
+  }
+
+  /// Execute the network against the caller-provided per-run state: the
+  /// \p mutableWeights and \p activations arenas of an execution context.
+  /// Calls with disjoint arenas may run concurrently on different threads.
+  virtual void executeWithContext(void *mutableWeights, void *activations) {
+    (void)mutableWeights;
+    (void)activations;
+    assert(false && "Backend does not support execution contexts");
+  }
+
+  /// Prints a per-kernel breakdown of the execution time accumulated by the
+  /// executions so far. A no-op when the function was compiled or run
+  /// without the backend's profiling instrumentation enabled.
+  virtual void dumpKernelProfile() {}
 };
 
 } // end namespace glow
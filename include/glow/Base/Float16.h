@@ -0,0 +1,143 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GLOW_BASE_FLOAT16_H
+#define GLOW_BASE_FLOAT16_H
+
+#include <cstdint>
+#include <cstring>
+
+namespace glow {
+
+/// A 16-bit IEEE-754 floating point storage type. This is a pure storage
+/// format: all arithmetic implicitly promotes to fp32, so computations that
+/// mix float16_t values accumulate in single precision and only round back to
+/// half precision on assignment.
+class float16_t final {
+  /// The raw IEEE-754 binary16 bits.
+  uint16_t data_{0};
+
+  /// Convert the fp32 value \p f to binary16 bits, rounding to nearest even.
+  static uint16_t fromFloat(float f) {
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    uint16_t sign = (bits >> 16) & 0x8000;
+    uint32_t exp = (bits >> 23) & 0xff;
+    uint32_t mant = bits & 0x7fffff;
+
+    // Infinity and NaN. Keep NaNs quiet.
+    if (exp == 0xff) {
+      return sign | 0x7c00 | (mant ? 0x200 : 0);
+    }
+
+    int newExp = int(exp) - 127 + 15;
+    // Overflow to infinity.
+    if (newExp >= 0x1f) {
+      return sign | 0x7c00;
+    }
+    // Subnormal half or underflow to zero.
+    if (newExp <= 0) {
+      if (newExp < -10) {
+        return sign;
+      }
+      mant |= 0x800000;
+      uint32_t shift = 14 - newExp;
+      uint16_t half = mant >> shift;
+      uint32_t rem = mant & ((1u << shift) - 1);
+      uint32_t halfway = 1u << (shift - 1);
+      if (rem > halfway || (rem == halfway && (half & 1))) {
+        half++;
+      }
+      return sign | half;
+    }
+    // Normal number. A mantissa carry during rounding correctly bumps the
+    // exponent, and may round up to infinity.
+    uint16_t half = sign | (newExp << 10) | (mant >> 13);
+    uint32_t rem = mant & 0x1fff;
+    if (rem > 0x1000 || (rem == 0x1000 && (half & 1))) {
+      half++;
+    }
+    return half;
+  }
+
+  /// Convert the binary16 bits \p h to an fp32 value.
+  static float toFloat(uint16_t h) {
+    uint32_t sign = uint32_t(h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1f;
+    uint32_t mant = h & 0x3ff;
+    uint32_t bits;
+
+    if (exp == 0) {
+      if (!mant) {
+        bits = sign;
+      } else {
+        // Normalize the subnormal half.
+        uint32_t e = 127 - 15 + 1;
+        while (!(mant & 0x400)) {
+          mant <<= 1;
+          e--;
+        }
+        bits = sign | (e << 23) | ((mant & 0x3ff) << 13);
+      }
+    } else if (exp == 0x1f) {
+      bits = sign | 0x7f800000 | (mant << 13);
+    } else {
+      bits = sign | ((exp - 15 + 127) << 23) | (mant << 13);
+    }
+
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+  }
+
+public:
+  float16_t() = default;
+
+  float16_t(float f) : data_(fromFloat(f)) {}
+  float16_t(double d) : data_(fromFloat(float(d))) {}
+  float16_t(int i) : data_(fromFloat(float(i))) {}
+
+  /// All arithmetic and comparisons go through this promotion to fp32.
+  operator float() const { return toFloat(data_); }
+
+  float16_t &operator+=(float16_t other) {
+    *this = float(*this) + float(other);
+    return *this;
+  }
+
+  float16_t &operator-=(float16_t other) {
+    *this = float(*this) - float(other);
+    return *this;
+  }
+
+  float16_t &operator*=(float16_t other) {
+    *this = float(*this) * float(other);
+    return *this;
+  }
+
+  float16_t &operator/=(float16_t other) {
+    *this = float(*this) / float(other);
+    return *this;
+  }
+
+  /// \returns the raw binary16 bits.
+  uint16_t getBits() const { return data_; }
+};
+
+static_assert(sizeof(float16_t) == 2, "float16_t must be 2 bytes wide");
+
+} // namespace glow
+
+#endif // GLOW_BASE_FLOAT16_H
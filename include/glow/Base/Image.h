@@ -18,6 +18,7 @@
 
 #include "glow/Base/Tensor.h"
 
+#include <string>
 #include <tuple>
 
 namespace glow {
@@ -30,11 +31,57 @@ std::tuple<size_t, size_t, bool> getPngInfo(const char *filename);
 bool readPngImage(Tensor *T, const char *filename,
                   std::pair<float, float> range);
 
+/// Reads a png image directly into the int8 quantized tensor \p T. The
+/// normalization to the range \p range and the quantization with the
+/// parameters \p quantScale and \p quantOffset are folded into a single
+/// 256-entry table, so each pixel is translated with one lookup and the
+/// float intermediate of readPngImage() is skipped entirely. \returns True
+/// if an error occurred.
+bool readPngImageInt8(Tensor *T, const char *filename,
+                      std::pair<float, float> range, float quantScale,
+                      int32_t quantOffset);
+
 /// Writes a png image. \returns True if an error occurred. The values of the
 /// image are in the range \p range.
 bool writePngImage(Tensor *T, const char *filename,
                    std::pair<float, float> range);
 
+/// Reads a jpeg image header from jpeg file \p filename and \returns a tuple
+/// containing height, width, and a bool if it is grayscale or not.
+std::tuple<size_t, size_t, bool> getJpegInfo(const char *filename);
+
+/// Reads a jpeg image. The scanlines are translated through the same
+/// 256-entry normalization table as the png reader, straight from the
+/// decoder's row buffer into the tensor, so there is no intermediate copy
+/// of the image. When linked against libjpeg-turbo the iDCT and the color
+/// conversion run in its SIMD paths. \returns True if an error occurred.
+/// The values of the image are in the range \p range.
+bool readJpegImage(Tensor *T, const char *filename,
+                   std::pair<float, float> range);
+
+/// Reads the image \p filename, dispatching on the file signature between
+/// the png and the jpeg reader. \returns True if an error occurred. The
+/// values of the image are in the range \p range.
+bool readImage(Tensor *T, const char *filename, std::pair<float, float> range);
+
+/// Reads the image header of \p filename, dispatching on the file signature
+/// like readImage(), and \returns a tuple containing height, width, and a
+/// bool if it is grayscale or not.
+std::tuple<size_t, size_t, bool> getImageInfo(const char *filename);
+
+/// Reads the png or jpeg images \p filenames into the NHWC batch tensor
+/// \p batch, decoding them in parallel and writing each image directly into
+/// its slice of the batch. The formats may be mixed; each file dispatches on
+/// its signature. All images must have the dimensions of the first one. The
+/// values of the images are in the range \p range. \returns True if an error
+/// occurred.
+bool readImages(llvm::ArrayRef<std::string> filenames, Tensor *batch,
+                std::pair<float, float> range);
+
+/// Like readImages(), restricted to png files; kept for existing callers.
+bool readPngImages(llvm::ArrayRef<std::string> filenames, Tensor *batch,
+                   std::pair<float, float> range);
+
 } // namespace glow
 
 #endif // GLOW_BASE_IMAGE_H
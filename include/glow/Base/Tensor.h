@@ -16,7 +16,10 @@
 #ifndef GLOW_BASE_TENSOR_H
 #define GLOW_BASE_TENSOR_H
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstring>
 #include <vector>
 
 #include "glow/Base/Type.h"
@@ -39,6 +42,14 @@ class Tensor;
 void genericTranspose(Tensor *src, Tensor *dest,
                       llvm::ArrayRef<unsigned> shuffle);
 
+/// \returns a CSR encoding of the dense two-dimensional float tensor \p src.
+/// The result has the same logical shape, marked sparse, and stores only the
+/// non-zero elements of \p src.
+Tensor sparsifyTensorCSR(const Tensor *src);
+
+/// \returns a dense tensor with the content of the CSR-encoded tensor \p src.
+Tensor densifyTensorCSR(const Tensor *src);
+
 /// Helper function that \returns a ShapeVector of those dimensions in \p
 /// currDims expanded with dimension = 1 until the maximum tensor dimension is
 /// reached. The number of elements in the input dims is the same as in the
@@ -65,6 +76,20 @@ private:
   /// If the tensor is unowned.
   bool isUnowned_{false};
 
+  /// The distance, in elements, between consecutive indices of each
+  /// dimension. For an owned tensor these are the row-major products of the
+  /// trailing dimensions; a strided view created by getUnownedView() keeps
+  /// the strides of its parent, so it can alias a non-contiguous region.
+  size_t strides_[max_tensor_dimensions] = {
+      0,
+  };
+
+  /// The number of tensors sharing \ref data_ when the payload is shared
+  /// between copy-on-write clones, or null when this tensor owns its payload
+  /// exclusively. Mutable because unsharing does not change the logical
+  /// content of the tensor.
+  mutable std::atomic<unsigned> *refcount_{nullptr};
+
   template <class ElemTy> friend class Handle;
 
   /// \returns a pointer to the tensor data buffer.
@@ -73,6 +98,36 @@ private:
   /// \returns true if it is an unowned tensor.
   bool isUnowned() const { return isUnowned_; }
 
+  /// Drop this tensor's reference to its payload, freeing the payload if
+  /// this was the last reference.
+  void releasePayload() {
+    if (isUnowned_) {
+      data_ = nullptr;
+      return;
+    }
+    if (refcount_) {
+      if (refcount_->fetch_sub(1) == 1) {
+        delete refcount_;
+        deallocateTensorPayload(data_, type_.getSizeInBytes());
+      }
+      refcount_ = nullptr;
+      data_ = nullptr;
+      return;
+    }
+    deallocateTensorPayload(data_, type_.getSizeInBytes());
+    data_ = nullptr;
+  }
+
+  /// Recompute \ref strides_ for a contiguous row-major layout of the
+  /// current shape.
+  void resetStrides() {
+    size_t pi = 1;
+    for (int i = type_.numSizes_ - 1; i >= 0; i--) {
+      strides_[i] = pi;
+      pi *= type_.sizes_[i];
+    }
+  }
+
 public:
   /// \returns the type of the tensor.
   const Type &getType() const { return type_; }
@@ -92,10 +147,7 @@ public:
   }
 
   /// Set the content of the tensor to zero.
-  void zero() {
-    std::fill(&getData()[0], &getData()[0] + size() * type_.getElementSize(),
-              0);
-  }
+  void zero();
 
   /// \returns the shape of the tensor.
   llvm::ArrayRef<size_t> dims() const { return type_.dims(); }
@@ -106,6 +158,7 @@ public:
   /// \returns a pointer to the raw data, of type \p ElemTy.
   template <class ElemTy> ElemTy *getRawDataPointer() {
     assert(type_.isType<ElemTy>() && "Asking for the wrong ptr type.");
+    ensureOwnPayload();
     return reinterpret_cast<ElemTy *>(data_);
   }
 
@@ -147,11 +200,14 @@ public:
 
   /// Construct an unowned tensor provided an existing payload buffer.
   /// This constructor can be used when there is a need to work with
-  /// "externally" managed payload buffers using Tensor APIs.
+  /// "externally" managed payload buffers using Tensor APIs, e.g. to alias a
+  /// region of a read-only file mapping (see Support/MappedFile.h). Aliasing
+  /// read-only memory is fine as long as the tensor is never written to.
   Tensor(void *data, TypeRef ty)
       : data_(reinterpret_cast<char *>(data)), type_(*ty), isUnowned_{false} {
     // Mark as unowned.
     isUnowned_ = true;
+    resetStrides();
   }
 
   /// Allocate and initialize a new integer tensor with \p scale and \p offset.
@@ -180,6 +236,9 @@ public:
   /// outlive its parent tensor.
   Tensor getUnowned(llvm::ArrayRef<size_t> dims,
                     llvm::ArrayRef<size_t> offsets = {}) const {
+    // The view aliases our buffer for reading and writing, so it must not
+    // observe a payload shared with a clone.
+    ensureOwnPayload();
     Tensor unownedTensor;
 
     auto *firstElemPtr = getData();
@@ -199,6 +258,7 @@ public:
     unownedTensor.data_ = firstElemPtr;
     unownedTensor.isUnowned_ = true;
     unownedTensor.type_ = Type::newShape(getType(), dims);
+    unownedTensor.resetStrides();
     if (offsets.size() == 0) {
       assert(size() == unownedTensor.size() && "The size of the unowned tensor "
                                                "should the same as the size of "
@@ -212,6 +272,55 @@ public:
     return unownedTensor;
   }
 
+  /// \returns true if the tensor covers a contiguous row-major region of its
+  /// buffer. Owned tensors and full-buffer views are always contiguous;
+  /// strided views created by getUnownedView() usually are not.
+  bool isContiguous() const {
+    size_t pi = 1;
+    for (int i = type_.numSizes_ - 1; i >= 0; i--) {
+      if (strides_[i] != pi) {
+        return false;
+      }
+      pi *= type_.sizes_[i];
+    }
+    return true;
+  }
+
+  /// \returns the strides of the tensor, in elements.
+  llvm::ArrayRef<size_t> getStrides() const {
+    return llvm::ArrayRef<size_t>(strides_, type_.numSizes_);
+  }
+
+  /// \returns a zero-copy view of the region of this tensor that starts at
+  /// \p offsets and extends for \p dims elements in each dimension. Unlike
+  /// getUnowned(), the view keeps the strides of this tensor, so it may
+  /// alias a non-contiguous region (e.g. a channel split). Element access
+  /// through Handle::at() works as usual; APIs that touch the raw payload
+  /// (raw(), copyRawFrom(), etc.) require a contiguous view. The view must
+  /// not outlive this tensor.
+  Tensor getUnownedView(llvm::ArrayRef<size_t> dims,
+                        llvm::ArrayRef<size_t> offsets) const {
+    ensureOwnPayload();
+    assert(dims.size() == this->dims().size() &&
+           "Views must have the same number of dimensions as the tensor");
+    assert(offsets.size() == this->dims().size() &&
+           "Number of dims of tensor must equal number of dims in offsets");
+
+    size_t index = 0;
+    for (size_t i = 0, e = dims.size(); i < e; i++) {
+      assert(offsets[i] + dims[i] <= this->dims()[i] &&
+             "View exceeds tensor bounds");
+      index += strides_[i] * offsets[i];
+    }
+
+    Tensor view;
+    view.data_ = &getData()[index * type_.getElementSize()];
+    view.isUnowned_ = true;
+    view.type_ = Type::newShape(getType(), dims);
+    memcpy(view.strides_, strides_, sizeof(strides_));
+    return view;
+  }
+
   /// Reset the shape and type of this tensor to match the shape and type of
   /// \p other.
   void reset(const Tensor *other) { reset(other->getType()); }
@@ -236,29 +345,28 @@ public:
       return;
     }
 
-    // Delete the old buffer, update the shape, and allocate a new one.
-    if (!isUnowned())
-      alignedFree(getData());
+    // Return the old buffer to the pool, update the shape, and allocate a new
+    // one.
+    releasePayload();
     type_ = T;
+    resetStrides();
 
     if (size()) {
-      size_t count = size() * type_.getElementSize();
-      data_ = reinterpret_cast<char *>(alignedAlloc(count, TensorAlignment));
+      size_t count = type_.getSizeInBytes();
+      data_ = reinterpret_cast<char *>(allocateTensorPayload(count));
       zero();
     }
   }
 
-  ~Tensor() {
-    if (!isUnowned()) {
-      alignedFree(getData());
-    }
-  }
+  ~Tensor() { releasePayload(); }
 
   // Move ctor.
   Tensor(Tensor &&other) noexcept {
     std::swap(data_, other.data_);
     std::swap(type_, other.type_);
     std::swap(isUnowned_, other.isUnowned_);
+    std::swap(strides_, other.strides_);
+    std::swap(refcount_, other.refcount_);
   }
 
   /// Move assignment operator.
@@ -266,9 +374,36 @@ public:
     std::swap(data_, other.data_);
     std::swap(type_, other.type_);
     std::swap(isUnowned_, other.isUnowned_);
+    std::swap(strides_, other.strides_);
+    std::swap(refcount_, other.refcount_);
     return *this;
   }
 
+  /// Make sure this tensor does not share its payload with any clone,
+  /// copying the payload if it does. Called before every mutable access.
+  void ensureOwnPayload() const {
+    if (!refcount_) {
+      return;
+    }
+    auto *self = const_cast<Tensor *>(this);
+    // If we hold the only reference there is nothing to copy.
+    if (refcount_->load() == 1) {
+      delete refcount_;
+      self->refcount_ = nullptr;
+      return;
+    }
+    size_t bytes = type_.getSizeInBytes();
+    char *copy = reinterpret_cast<char *>(allocateTensorPayload(bytes));
+    memcpy(copy, data_, bytes);
+    if (refcount_->fetch_sub(1) == 1) {
+      // The other clones died while we were copying.
+      delete refcount_;
+      deallocateTensorPayload(self->data_, bytes);
+    }
+    self->data_ = copy;
+    self->refcount_ = nullptr;
+  }
+
   /// \returns true if the content of the other tensor \p other is identical to
   /// this one.
   bool isEqual(const Tensor &other, float allowedError = 0.0001) const {
@@ -279,16 +414,26 @@ public:
     switch (getElementType()) {
     case ElemKind::FloatTy:
       return isEqualImpl<float>(other, allowedError);
+    case ElemKind::Float16Ty:
+      return isEqualImpl<float16_t>(other, allowedError);
     case ElemKind::Int8QTy:
       assert(getType().getScale() == other.getType().getScale() &&
              "Scales must match.");
       assert(getType().getOffset() == other.getType().getOffset() &&
              "Offsets must match.");
       return isEqualImpl<int8_t>(other, allowedError);
+    case ElemKind::Int16QTy:
+      assert(getType().getScale() == other.getType().getScale() &&
+             "Scales must match.");
+      assert(getType().getOffset() == other.getType().getOffset() &&
+             "Offsets must match.");
+      return isEqualImpl<int16_t>(other, allowedError);
     case ElemKind::Int32QTy:
       return isEqualImpl<int32_t>(other, allowedError);
     case ElemKind::IndexTy:
       return isEqualImpl<size_t>(other, allowedError);
+    case ElemKind::Int32ITy:
+      return isEqualImpl<int32_t>(other, allowedError);
     }
 
     // This is to make compiler happy. It can never reach this point as switch
@@ -299,17 +444,20 @@ public:
   /// Update the content of the tensor from the tensor \p t.
   void copyFrom(const Tensor *t) {
     assert(this != t && "Copying to self");
+    assert(t->isContiguous() && "Source must be contiguous");
     reset(t);
-    size_t bufferSize = size() * type_.getElementSize();
+    size_t bufferSize = type_.getSizeInBytes();
     std::copy(&t->getData()[0], &t->getData()[bufferSize], getData());
   }
 
   /// Update the raw data of the tensor from the tensor \p t.
   void copyRawFrom(const Tensor *t) {
     assert(this != t && "Copying to self");
+    assert(isContiguous() && t->isContiguous() && "Tensors must be contiguous");
+    ensureOwnPayload();
     assert(size() == t->size());
     assert(getElementType() == t->getElementType() && "Invalid element type");
-    size_t bufferSize = size() * type_.getElementSize();
+    size_t bufferSize = type_.getSizeInBytes();
     std::copy(&t->getData()[0], &t->getData()[bufferSize], getData());
   }
 
@@ -320,8 +468,9 @@ public:
     (void)dim;
     assert(dim == dims() && "Invalid slice size");
     assert(getElementType() == t->getElementType() && "Invalid element type");
+    ensureOwnPayload();
 
-    size_t bufferSize = size() * type_.getElementSize();
+    size_t bufferSize = type_.getSizeInBytes();
     std::copy(&t->getData()[bufferSize * slice],
               &t->getData()[bufferSize * (slice + 1)], getData());
   }
@@ -336,6 +485,7 @@ public:
     assert(onceSliceDim == dims().slice(1) && "Invalid slice size");
     assert(getElementType() == t->getElementType() && "Invalid element type");
     assert(dims().size() > 1 && "Tensor must contain at least two dimensions");
+    ensureOwnPayload();
 
     size_t numSlicesInInput = t->dims()[0];
     size_t numElementsInSlice = size() / dims()[0];
@@ -356,15 +506,62 @@ public:
     genericTranspose(this, dest, shuffle);
   }
 
-  /// Create a new copy of the current tensor.
+  /// Create a new copy of the current tensor. Owned tensors share their
+  /// payload with the clone by copy-on-write: the copy is O(1) and the
+  /// payload is only duplicated when either tensor is first written to.
+  /// Unowned tensors and views keep deep-copy semantics.
   Tensor clone() const {
-    Tensor slice;
-    slice.copyFrom(this);
-    return slice;
+    if (isUnowned_ || !data_) {
+      Tensor slice;
+      slice.copyFrom(this);
+      return slice;
+    }
+
+    if (!refcount_) {
+      refcount_ = new std::atomic<unsigned>(1);
+    }
+    refcount_->fetch_add(1);
+
+    Tensor copy;
+    copy.data_ = data_;
+    copy.type_ = type_;
+    memcpy(copy.strides_, strides_, sizeof(strides_));
+    copy.refcount_ = refcount_;
+    return copy;
+  }
+
+  /// \returns a copy of the tensor converted to the element kind \p newKind.
+  /// Only conversions between FloatTy and Float16Ty are supported; the
+  /// accumulation type of the conversion is fp32.
+  Tensor getCopyConvertedToType(ElemKind newKind) const;
+
+  /// \returns true if \p other has the same type and a bit-identical payload.
+  /// Unlike isEqual() this performs no elementwise epsilon comparison; it is
+  /// a bulk memcmp over the raw payload, so it runs at memory bandwidth and
+  /// is suitable for detecting duplicate constants.
+  bool isBitwiseEqual(const Tensor &other) const {
+    assert(isContiguous() && other.isContiguous() &&
+           "Tensors must be contiguous");
+    if (!getType().isEqual(other.getType())) {
+      return false;
+    }
+    return memcmp(getData(), other.getData(), getSizeInBytes()) == 0;
   }
 
-  /// Return the raw unsafe pointer to the tensor payload.
-  char *getUnsafePtr() const { return getData(); }
+  /// \returns a 64-bit hash of the raw payload. Tensors with bit-identical
+  /// payloads of the same size hash to the same value. The hash consumes the
+  /// payload eight bytes at a time, so it runs at close to memory bandwidth.
+  uint64_t hash() const;
+
+  /// \returns the size in bytes of the payload.
+  size_t getSizeInBytes() const { return type_.getSizeInBytes(); }
+
+  /// Return the raw unsafe pointer to the tensor payload. The pointer may be
+  /// used for writing, so any copy-on-write sharing is broken first.
+  char *getUnsafePtr() const {
+    ensureOwnPayload();
+    return getData();
+  }
 
   /// \return a new handle that points and manages this tensor.
   template <class ElemTy = float> Handle<ElemTy> getHandle();
@@ -469,12 +666,11 @@ public:
     memcpy(sizes_, tensor_->type_.sizes_,
            max_tensor_dimensions * sizeof(sizes_[0]));
 
-    size_t pi = 1;
-    for (int i = numDims_ - 1; i >= 0; i--) {
-      sizeIntegral_[i] = pi;
-      assert(sizes_[i] > 0 && "invalid dim size");
-      pi *= sizes_[i];
-    }
+    // Use the strides of the tensor, so that handles of strided views index
+    // into the parent buffer correctly. For owned tensors these are the
+    // plain row-major products of the trailing dimensions.
+    memcpy(sizeIntegral_, tensor_->strides_,
+           max_tensor_dimensions * sizeof(sizeIntegral_[0]));
 
     assert(numDims_ <= max_tensor_dimensions && "Too many dimensions.");
   }
@@ -492,13 +688,30 @@ public:
 
   void clear(ElemTy value = 0) {
     auto *data = tensor_->getRawDataPointer<ElemTy>();
-    std::fill(&data[0], &data[0] + size(), value);
+    size_t e = size();
+    if (value == 0) {
+      // Clearing to zero is by far the most common fill and memset is
+      // vectorized by every libc.
+      tensor_->zero();
+      return;
+    }
+    // Fill a small prefix with scalar stores and then double the initialized
+    // region with memcpy. This turns the element-by-element loop into a few
+    // wide block copies.
+    const size_t seed = std::min<size_t>(e, 64);
+    std::fill(&data[0], &data[0] + seed, value);
+    size_t filled = seed;
+    while (filled < e) {
+      size_t chunk = std::min(filled, e - filled);
+      memcpy(&data[filled], &data[0], chunk * sizeof(ElemTy));
+      filled += chunk;
+    }
   }
 
   ElemTy &at(llvm::ArrayRef<size_t> indices) {
     assert(tensor_->isInBounds(indices));
     size_t index = getElementPtr(indices);
-    assert(index < size() && "Out of bounds");
+    assert((index < size() || !tensor_->isContiguous()) && "Out of bounds");
     auto *data = tensor_->getRawDataPointer<ElemTy>();
     return data[index];
   }
@@ -506,7 +719,7 @@ public:
   const ElemTy &at(llvm::ArrayRef<size_t> indices) const {
     assert(tensor_->isInBounds(indices));
     size_t index = getElementPtr(indices);
-    assert(index < size() && "Out of bounds");
+    assert((index < size() || !tensor_->isContiguous()) && "Out of bounds");
     auto *data = tensor_->getRawDataPointer<ElemTy>();
     return data[index];
   }
@@ -601,6 +814,27 @@ public:
   void dump(llvm::raw_ostream &os) const { dumpImpl(tensor_, os); }
   void dump() const { dumpImpl(tensor_); }
 
+  /// Fill the float tensor with uniformly distributed values from [\p low,
+  /// \p high) in bulk with FastPRNG, in parallel when the tensor is large.
+  /// The stream is drawn from \p PRNG, so the global sequence stays
+  /// deterministic.
+  void initUniform(double low, double high, PseudoRNG &PRNG, std::true_type) {
+    if (size() == 0) {
+      return;
+    }
+    fillUniform(&raw(0), size(), low, high, PRNG());
+  }
+
+  /// Fill the tensor with uniformly distributed values from [\p low,
+  /// \p high), drawn one at a time from \p PRNG.
+  void initUniform(double low, double high, PseudoRNG &PRNG,
+                   std::false_type) {
+    std::uniform_real_distribution<> dist(low, high);
+    for (size_t i = 0, e = size(); i < e; i++) {
+      raw(i) = dist(PRNG);
+    }
+  }
+
   /// Fill the array with random data that's close to zero using the
   /// Xavier method, based on the paper [Bengio and Glorot 2010].
   /// This type of initialization facilitates better training performance.
@@ -612,19 +846,39 @@ public:
   void initXavier(size_t filterSize, PseudoRNG &PRNG) {
     assert(filterSize > 0 && "invalid filter size");
     double scale = std::sqrt(3.0 / double(filterSize));
-    std::uniform_real_distribution<> dist(-scale, scale);
+    initUniform(-scale, scale, PRNG, std::is_same<ElemTy, float>());
+  }
+
+  /// Fill the tensor with uniformly distributed values in the range
+  /// [low .. high]. Float tensors are filled in bulk with the fast
+  /// generator, in parallel when they are large.
+  template <typename T = ElemTy>
+  typename std::enable_if<std::is_same<T, float>::value>::type
+  randomize(float low, float high, PseudoRNG &PRNG) {
+    assert(low < high && "invalid range");
+    initUniform(low, high, PRNG, std::true_type());
+  }
+
+  /// Fill the tensor with uniformly distributed values in the range
+  /// [low .. high].
+  template <typename T = ElemTy>
+  typename std::enable_if<std::is_floating_point<T>::value &&
+                          !std::is_same<T, float>::value>::type
+  randomize(float low, float high, PseudoRNG &PRNG) {
+    assert(low < high && "invalid range");
+    std::uniform_real_distribution<ElemTy> dist(low, high);
     for (size_t i = 0, e = size(); i < e; i++) {
       raw(i) = dist(PRNG);
     }
   }
 
   /// Fill the tensor with uniformly distributed values in the range
-  /// [low .. high].
+  /// [low .. high]. Float16 values are generated in fp32 and rounded.
   template <typename T = ElemTy>
-  typename std::enable_if<std::is_floating_point<T>::value>::type
+  typename std::enable_if<std::is_same<T, float16_t>::value>::type
   randomize(float low, float high, PseudoRNG &PRNG) {
     assert(low < high && "invalid range");
-    std::uniform_real_distribution<ElemTy> dist(low, high);
+    std::uniform_real_distribution<float> dist(low, high);
     for (size_t i = 0, e = size(); i < e; i++) {
       raw(i) = dist(PRNG);
     }
@@ -0,0 +1,82 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GLOW_BASE_TENSORARCHIVE_H
+#define GLOW_BASE_TENSORARCHIVE_H
+
+#include "glow/Base/Tensor.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <deque>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace glow {
+
+/// A memory-mapped archive of packed tensors, for datasets that are parsed
+/// once and trained on many times. The archive is a fixed header, one record
+/// per tensor describing its type, and the raw payloads at aligned offsets.
+/// The reader maps the file and hands out unowned Tensor views into the
+/// mapping, so opening an archive costs no parsing and no copies: the
+/// samples are paged in on first touch, and several experiment processes
+/// reading the same archive share one copy of the data in the page cache.
+class TensorArchive final {
+  /// The base address of the file mapping.
+  uint8_t *base_{nullptr};
+  /// The size of the mapping, in bytes.
+  size_t mappedSize_{0};
+  /// The type and payload offset of every archived tensor.
+  std::vector<std::pair<Type, size_t>> entries_;
+  /// The types of the batch views handed out so far. The views alias the
+  /// mapping and reference their type, so the types must outlive them; a
+  /// deque keeps the addresses stable as it grows.
+  std::deque<Type> viewTypes_;
+  /// Protects \ref viewTypes_ against concurrent getBatch() calls.
+  std::mutex mtx_;
+
+public:
+  /// Ctor. Maps the archive at \p path. Aborts when the file cannot be
+  /// mapped or does not carry the archive header.
+  TensorArchive(llvm::StringRef path);
+
+  ~TensorArchive();
+
+  /// \returns the number of tensors in the archive.
+  size_t size() const { return entries_.size(); }
+
+  /// \returns an unowned view of the whole \p idx-th tensor of the archive.
+  Tensor getTensor(size_t idx);
+
+  /// \returns an unowned view of \p count consecutive samples of the
+  /// \p idx-th tensor, starting at sample \p first along the batch (first)
+  /// dimension. No data is copied; the view reads the mapping directly.
+  Tensor getBatch(size_t idx, size_t first, size_t count);
+
+  /// Writes \p tensors to a new archive at \p path, replacing any existing
+  /// file.
+  static void write(llvm::StringRef path,
+                    llvm::ArrayRef<const Tensor *> tensors);
+
+  /// \returns true when \p path exists and starts with the archive header,
+  /// i.e. it can be opened with the ctor.
+  static bool isArchive(llvm::StringRef path);
+};
+
+} // namespace glow
+
+#endif // GLOW_BASE_TENSORARCHIVE_H
@@ -26,14 +26,34 @@ namespace glow {
 
 class Tensor;
 
+/// The weight update rule that the trainer applies to the gradients.
+enum class OptimizerKind {
+  SGD,     // Stochastic gradient descent with momentum.
+  Adam,    // Per-weight first/second moments with bias correction.
+  RMSProp, // Per-weight running average of the squared gradients.
+};
+
 /// This is a list of parameters that the network trainers (such as sgd and
 /// adam) use for training the network.
 struct TrainingConfig {
+  OptimizerKind optimizer{OptimizerKind::SGD};
   float L1Decay{0};
   float L2Decay{0};
   float learningRate{0.01f};
   float momentum{0.0};
+  /// The decay rates of the first and the second gradient moment (Adam).
+  float beta1{0.9f};
+  float beta2{0.999f};
+  /// The decay rate of the squared-gradient average (RMSProp).
+  float rmsDecay{0.9f};
+  /// Stabilizes the division by the second moment (Adam and RMSProp).
+  float epsilon{1e-8f};
   unsigned batchSize{1};
+  /// The number of micro-batches whose gradients are accumulated before
+  /// one weight update is applied. Values above one trade a little extra
+  /// compute for training with an effective batch of accumSteps *
+  /// batchSize samples at the activation memory of a single micro-batch.
+  unsigned accumSteps{1};
 };
 
 } // namespace glow
@@ -23,12 +23,20 @@
 
 namespace glow {
 
+/// \returns a reference to an interned copy of \p name. Interned names live
+/// in a process-wide arena and are deduplicated, so equal names share one
+/// allocation and can be compared by pointer.
+llvm::StringRef internName(llvm::StringRef name);
+
 /// This add the capability to name subclasses.
 class Named {
-  std::string name_{};
+  /// The name. It points into the interned-name arena, so storing and
+  /// copying a Named moves only the reference, and two Named with equal
+  /// names share one allocation.
+  llvm::StringRef name_;
 
 public:
-  explicit Named(llvm::StringRef name) : name_(name) {}
+  explicit Named(llvm::StringRef name) : name_(internName(name)) {}
 
   /// \returns the name of the instruction.
   llvm::StringRef getName() const { return name_; }
@@ -37,7 +45,13 @@ public:
   bool hasName() const { return !name_.empty(); }
 
   /// Set the name of the instruction to \p name.
-  void setName(llvm::StringRef name) { name_ = name; }
+  void setName(llvm::StringRef name) { name_ = internName(name); }
+
+  /// \returns true if this entity has the same name as \p other. Interning
+  /// makes this a pointer comparison.
+  bool hasSameName(const Named &other) const {
+    return name_.data() == other.name_.data();
+  }
 };
 
 /// Subclasses of this class have a type associated with them.
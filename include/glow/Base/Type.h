@@ -16,14 +16,18 @@
 #ifndef GLOW_BASE_TYPE_H
 #define GLOW_BASE_TYPE_H
 
+#include "glow/Base/Float16.h"
 #include "glow/Support/Compiler.h"
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/StringRef.h"
 
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <type_traits>
+#include <vector>
 
 namespace llvm {
 class raw_ostream;
@@ -160,9 +164,12 @@ inline bool operator==(const ShapeNCHW &LHS, const ShapeNCHW &RHS) {
 
 enum class ElemKind : unsigned char {
   FloatTy,
+  Float16Ty,
   Int8QTy,
+  Int16QTy,
   Int32QTy,
   IndexTy,
+  Int32ITy,
 };
 
 /// A class that represents a type of a tensor.
@@ -180,6 +187,22 @@ struct Type final {
   /// On quantized tensors, this represents the offset of the values.
   int32_t offset_{0};
 
+  /// On channelwise-quantized tensors, one scale and one offset per channel
+  /// along \ref channelAxis_. Empty on tensors quantized with a single
+  /// scale/offset pair for the whole tensor.
+  std::vector<float> channelScales_;
+  std::vector<int32_t> channelOffsets_;
+  /// The dimension that the per-channel parameters run along.
+  unsigned char channelAxis_{0};
+
+  /// On sparse tensors, the number of stored non-zero elements. The
+  /// dimensions describe the logical dense shape, but the payload is a
+  /// CSR encoding of the matrix: one uint32_t row pointer per row plus one,
+  /// followed by one uint32_t column index and one element per non-zero.
+  size_t numNonZeros_{0};
+  /// True if the payload of the tensor is CSR-encoded.
+  bool sparse_{false};
+
   /// Specifies the element type of the tensor.
   ElemKind elementType_{ElemKind::IndexTy};
 
@@ -198,7 +221,43 @@ struct Type final {
     initDims(dims);
   }
 
+  /// \returns a copy of the quantized type \p T that carries one scale and
+  /// one offset per channel along dimension \p channelAxis. The per-tensor
+  /// scale and offset of \p T are kept untouched as the parameters of code
+  /// paths that do not understand per-channel quantization.
+  static Type newChannelwise(const Type &T, llvm::ArrayRef<float> scales,
+                             llvm::ArrayRef<int32_t> offsets,
+                             unsigned channelAxis) {
+    assert(T.isQuantizedType() &&
+           "Only quantized types carry per-channel parameters");
+    assert(channelAxis < T.numSizes_ && "Invalid channel axis");
+    assert(scales.size() == T.sizes_[channelAxis] &&
+           offsets.size() == T.sizes_[channelAxis] &&
+           "Expected one scale and one offset per channel");
+    Type result = T;
+    result.channelScales_.assign(scales.begin(), scales.end());
+    result.channelOffsets_.assign(offsets.begin(), offsets.end());
+    result.channelAxis_ = channelAxis;
+    return result;
+  }
+
+  /// \returns a copy of the two-dimensional float type \p T that marks the
+  /// payload as a CSR encoding with \p numNonZeros stored elements. The
+  /// dimensions keep describing the logical dense shape.
+  static Type newSparse(const Type &T, size_t numNonZeros) {
+    assert(T.getElementType() == ElemKind::FloatTy &&
+           "Only float tensors have a sparse representation");
+    assert(T.numSizes_ == 2 && "Only matrices have a sparse representation");
+    Type result = T;
+    result.sparse_ = true;
+    result.numNonZeros_ = numNonZeros;
+    return result;
+  }
+
   /// Reshape existing type. This method takes care of quantized types.
+  /// Per-channel parameters are not carried over, because a reshape changes
+  /// the meaning of the channel axis. The sparse marker is not carried over
+  /// either; the CSR encoding is tied to the original row layout.
   static Type newShape(const Type &T, llvm::ArrayRef<size_t> dims) {
     if (T.isQuantizedType()) {
       return Type(T.getElementType(), dims, T.getScale(), T.getOffset());
@@ -223,6 +282,35 @@ struct Type final {
     return offset_;
   }
 
+  /// \returns true if this quantized type carries one scale/offset pair per
+  /// channel instead of a single pair for the whole tensor.
+  bool isChannelwiseQuantized() const { return !channelScales_.empty(); }
+
+  llvm::ArrayRef<float> getChannelScales() const {
+    assert(isChannelwiseQuantized() && "Type has no per-channel parameters");
+    return channelScales_;
+  }
+
+  llvm::ArrayRef<int32_t> getChannelOffsets() const {
+    assert(isChannelwiseQuantized() && "Type has no per-channel parameters");
+    return channelOffsets_;
+  }
+
+  /// \returns the dimension that the per-channel parameters run along.
+  unsigned getChannelAxis() const {
+    assert(isChannelwiseQuantized() && "Type has no per-channel parameters");
+    return channelAxis_;
+  }
+
+  /// \returns true if the payload of the tensor is CSR-encoded.
+  bool isSparse() const { return sparse_; }
+
+  /// \returns the number of stored non-zero elements of a sparse tensor.
+  size_t getNumNonZeros() const {
+    assert(isSparse() && "Can't get the non-zero count of a dense type");
+    return numNonZeros_;
+  }
+
   /// \returns true if \p other is the same type.
   bool isEqual(const Type &other) const {
     // Element type must be the same.
@@ -245,6 +333,17 @@ struct Type final {
       if (scale_ != other.scale_ || offset_ != other.offset_) {
         return false;
       }
+      if (channelAxis_ != other.channelAxis_ ||
+          channelScales_ != other.channelScales_ ||
+          channelOffsets_ != other.channelOffsets_) {
+        return false;
+      }
+    }
+
+    // A sparse and a dense type of the same shape describe different
+    // payloads.
+    if (sparse_ != other.sparse_ || numNonZeros_ != other.numNonZeros_) {
+      return false;
     }
 
     return true;
@@ -289,38 +388,69 @@ struct Type final {
     switch (Ty) {
     case ElemKind::FloatTy:
       return std::is_same<ElemTy, float>::value;
+    case ElemKind::Float16Ty:
+      return std::is_same<ElemTy, float16_t>::value;
     case ElemKind::Int8QTy:
       return std::is_same<ElemTy, int8_t>::value;
+    case ElemKind::Int16QTy:
+      return std::is_same<ElemTy, int16_t>::value;
     case ElemKind::Int32QTy:
       return std::is_same<ElemTy, int32_t>::value;
     case ElemKind::IndexTy:
       return std::is_same<ElemTy, size_t>::value;
+    case ElemKind::Int32ITy:
+      return std::is_same<ElemTy, int32_t>::value;
     }
     GLOW_UNREACHABLE("Invalid type.");
   }
 
   /// \returns true if the type of this Tensor is one of the integer types.
-  /// Notice that we don't consider IndexTy as an integer because we are not
-  /// performing calculations on this type.
-  bool isQuantizedType() const { return isType<int8_t>() || isType<int32_t>(); }
+  /// Notice that we don't consider the index types as integers because we are
+  /// not performing calculations on them. Int32ITy shares the storage type of
+  /// Int32QTy but carries plain row indices, not quantized values.
+  bool isQuantizedType() const {
+    return elementType_ == ElemKind::Int8QTy ||
+           elementType_ == ElemKind::Int16QTy ||
+           elementType_ == ElemKind::Int32QTy;
+  }
+
+  /// \returns true if this type holds indices into another tensor, either as
+  /// the native size_t or as a compact 32-bit integer.
+  bool isIndexType() const {
+    return elementType_ == ElemKind::IndexTy ||
+           elementType_ == ElemKind::Int32ITy;
+  }
 
   /// \return the size of the type element.
   unsigned getElementSize() const { return getElementSize(elementType_); }
 
-  /// \returns the size in bytes for this Tensor.
-  size_t getSizeInBytes() const { return getElementSize() * size(); }
+  /// \returns the size in bytes for this Tensor. For sparse tensors this is
+  /// the size of the CSR encoding, not of the logical dense matrix.
+  size_t getSizeInBytes() const {
+    if (sparse_) {
+      return sizeof(uint32_t) * (sizes_[0] + 1 + numNonZeros_) +
+             getElementSize() * numNonZeros_;
+    }
+    return getElementSize() * size();
+  }
 
   /// \return the size of the element \p Ty.
   static unsigned getElementSize(ElemKind Ty) {
     switch (Ty) {
     case ElemKind::FloatTy:
       return sizeof(float);
+    case ElemKind::Float16Ty:
+      return sizeof(float16_t);
     case ElemKind::Int8QTy:
       return sizeof(int8_t);
+    case ElemKind::Int16QTy:
+      return sizeof(int16_t);
     case ElemKind::Int32QTy:
       return sizeof(int32_t);
     case ElemKind::IndexTy:
       return sizeof(size_t);
+    case ElemKind::Int32ITy:
+      return sizeof(int32_t);
     }
     GLOW_UNREACHABLE("Invalid type.");
   }
@@ -334,9 +464,12 @@ struct Type final {
   static llvm::StringRef getElementName(ElemKind Ty) {
     static const char *names[] = {
         "float",
+        "float16",
         "i8",
+        "i16",
         "i32",
         "index",
+        "index32",
     };
     return names[(int)Ty];
   }
@@ -358,6 +491,25 @@ inline bool operator==(const Type &LHS, const Type &RHS) {
   return LHS.isEqual(RHS);
 }
 
+/// \returns a hash of the type, based on the element kind, the dimensions and
+/// the quantization parameters. Types that compare equal hash to the same
+/// value.
+inline llvm::hash_code hash_value(const Type &T) {
+  // Hash the bit pattern of the scale; hash_combine does not take floats.
+  float scale = T.isQuantizedType() ? T.getScale() : 0.0f;
+  int32_t scaleBits;
+  memcpy(&scaleBits, &scale, sizeof(scaleBits));
+  // Per-channel parameters only contribute their count; equal types always
+  // hash to the same value, and unequal types that collide are resolved by
+  // the full comparison.
+  return llvm::hash_combine(
+      static_cast<unsigned>(T.getElementType()),
+      llvm::hash_combine_range(T.dims().begin(), T.dims().end()), scaleBits,
+      T.isQuantizedType() ? T.getOffset() : 0,
+      T.isChannelwiseQuantized() ? T.getChannelScales().size() : 0,
+      T.isSparse() ? T.getNumNonZeros() + 1 : 0);
+}
+
 llvm::raw_ostream &operator<<(llvm::raw_ostream &os, const Type &type);
 llvm::raw_ostream &operator<<(llvm::raw_ostream &os, const TypeRef &type);
 
@@ -17,51 +17,93 @@
 #define GLOW_CODEGEN_MEMORYALLOCATOR_H
 #include <cstddef>
 #include <cstdint>
-#include <list>
+#include <map>
+#include <vector>
 
 namespace glow {
 
-/// A POD struct that represents a single half-open allocation [start .. end).
-class Segment {
-public:
-  /// The allocation starts at this address.
-  size_t begin_;
-  /// The allocation ends before this address (half-open interval).
-  size_t end_;
-
-  Segment(size_t begin, size_t end) : begin_(begin), end_(end) {}
-
-  /// \returns the size of the interval.
-  size_t size() const { return end_ - begin_; }
-
-  /// \returns True if the value \p idx falls within this segment.
-  bool contains(size_t idx) const { return idx >= begin_ && idx < end_; }
+/// A buffer to be placed by MemoryAllocator::allocateAll: its size in bytes
+/// and its live interval, expressed as half-open instruction numbers. The
+/// allocator fills in \ref offset.
+struct OfflineAllocation {
+  /// The size of the buffer, in bytes.
+  size_t size;
+  /// The instruction number at which the buffer becomes live.
+  size_t begin;
+  /// The instruction number at which the buffer dies.
+  size_t end;
+  /// The assigned start address. Written by allocateAll.
+  size_t offset;
 };
 
 /// Allocates segments of memory.
 class MemoryAllocator {
-  /// A list of live buffers.
-  std::list<Segment> allocations_;
+public:
+  /// The policy used to pick a free segment for a new allocation.
+  enum class Strategy {
+    /// Pick the lowest-addressed free segment that fits. Simple and fast,
+    /// but long-lived small buffers can split large free segments.
+    FirstFit,
+    /// Pick the smallest free segment that fits, found through a
+    /// size-ordered index of the free segments. Keeps large segments intact
+    /// and fragments less on graphs with many activations.
+    BestFit,
+  };
+
+private:
+  /// The live allocations, keyed by their start address and mapped to their
+  /// end address. Ordered by address.
+  std::map<size_t, size_t> allocations_;
+  /// The free segments between live allocations, keyed by their start
+  /// address and mapped to their size. The region above \ref frontier_ is
+  /// implicitly free and is not listed here.
+  std::map<size_t, size_t> freeByAddr_;
+  /// A size-ordered index of \ref freeByAddr_, mapping the size of every
+  /// free segment to its start address. Used by the best-fit strategy to
+  /// find the smallest adequate segment in logarithmic time.
+  std::multimap<size_t, size_t> freeBySize_;
+  /// The end of the highest live allocation. Everything above it is free.
+  size_t frontier_{0};
+  /// The number of free bytes below \ref frontier_.
+  size_t fragmentedBytes_{0};
+  /// The high water mark of \ref fragmentedBytes_.
+  size_t maxFragmentedBytes_{0};
   /// The size of the memory region that we can allocate segments into.
   size_t poolSize_;
   /// This is the high water mark for the allocated memory.
   size_t maxMemoryAllocated_{0};
+  /// The allocation strategy for this instance.
+  Strategy strategy_;
+
+  /// Adds the free segment [\p begin .. \p begin + \p size) to both indices.
+  void insertFreeSegment(size_t begin, size_t size);
+
+  /// Removes the free segment starting at \p begin of \p size bytes from
+  /// both indices.
+  void removeFreeSegment(size_t begin, size_t size);
 
 public:
   /// A reserved value to mark invalid allocation.
   static const size_t npos;
 
-  explicit MemoryAllocator(size_t poolSize) : poolSize_(poolSize) {}
+  explicit MemoryAllocator(size_t poolSize,
+                           Strategy strategy = Strategy::FirstFit)
+      : poolSize_(poolSize), strategy_(strategy) {}
 
   void reset() {
     maxMemoryAllocated_ = 0;
+    frontier_ = 0;
+    fragmentedBytes_ = 0;
+    maxFragmentedBytes_ = 0;
     allocations_.clear();
+    freeByAddr_.clear();
+    freeBySize_.clear();
   }
 
   /// \returns True if the value \p idx is within the currently allocated range.
   bool contains(size_t idx) const {
     for (auto &s : allocations_) {
-      if (s.contains(idx)) {
+      if (idx >= s.first && idx < s.second) {
         return true;
       }
     }
@@ -73,11 +115,48 @@ public:
   /// allocation failed.
   size_t allocate(size_t size);
 
+  /// Allocate a region of size \p size whose start address is a multiple of
+  /// \p alignment. Codegen can then assume aligned loads and stores on the
+  /// buffer without runtime checks. \p alignment must be a power of two and
+  /// at least TensorAlignment; the padding skipped for alignment remains
+  /// available as free space for other requests.
+  /// \returns the allocated pointer, or MemoryAllocator::npos, if the
+  /// allocation failed.
+  size_t allocate(size_t size, size_t alignment);
+
   /// Frees the allocation at \p ptr.
   void deallocate(size_t ptr);
 
+  /// Places the complete set of \p buffers at once, using the live interval
+  /// of every buffer. Unlike allocate/deallocate, which must place buffers
+  /// online in allocation order, this packs buffers greedily by decreasing
+  /// size, which keeps the peak well below what the online order achieves.
+  /// Writes the assigned address of every buffer into its offset field.
+  /// \returns the total size of the packing, or npos if it does not fit in
+  /// the pool. The instance must have no live online allocations.
+  size_t allocateAll(std::vector<OfflineAllocation> &buffers);
+
   /// \returns the high water mark for the allocated memory.
   size_t getMaxMemoryUsage() const { return maxMemoryAllocated_; }
+
+  /// \returns the stride between replicated copies of the arena: the high
+  /// water mark rounded up to TensorAlignment. All of the offsets that the
+  /// allocator assigns are relative to the base of the arena, so a client
+  /// can lay the arena out several times and address buffer \p b in copy
+  /// \p r at b + r * getRegionStride(). This is used to double-buffer the
+  /// activations for software pipelining of back-to-back batches.
+  size_t getRegionStride() const;
+
+  /// \returns the number of free bytes currently trapped between live
+  /// allocations.
+  size_t getFragmentedBytes() const { return fragmentedBytes_; }
+
+  /// \returns the high water mark of the bytes trapped between live
+  /// allocations.
+  size_t getMaxFragmentedBytes() const { return maxFragmentedBytes_; }
+
+  /// \returns the number of free segments between live allocations.
+  size_t getNumFreeSegments() const { return freeByAddr_.size(); }
 };
 
 } // namespace glow
@@ -21,15 +21,58 @@
 #include "glow/Base/Train.h"
 #include "glow/Base/Traits.h"
 #include "glow/Graph/Graph.h"
+#include "glow/IR/MemoryUsage.h"
 #include "glow/Optimizer/Optimizer.h"
+#include "glow/Optimizer/Partition.h"
+#include "glow/Support/PassStats.h"
 
 #include "llvm/ADT/ArrayRef.h"
 
+#include <condition_variable>
+#include <deque>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 namespace glow {
 
+/// A per-thread execution context over a compiled function. A context owns
+/// only the per-run state of one request - the mutable weights (the inputs
+/// and outputs) and the activations - so many contexts can serve concurrent
+/// requests against a single compiled function instead of replicating the
+/// whole model once per thread.
+class ExecutionContext final {
+  /// The compiled function this context executes.
+  CompiledFunction *function_;
+  /// The context's private copy of the mutable weights arena.
+  void *mutableWeights_{nullptr};
+  /// The context's private activations arena.
+  void *activations_{nullptr};
+
+  friend class ExecutionEngine;
+
+  /// Ctor, called by ExecutionEngine::createContext().
+  explicit ExecutionContext(CompiledFunction *function);
+
+public:
+  ~ExecutionContext();
+
+  ExecutionContext(const ExecutionContext &) = delete;
+  ExecutionContext &operator=(const ExecutionContext &) = delete;
+
+  /// \returns an unowned tensor addressing the payload of the public
+  /// variable \p v inside this context, for loading inputs and reading
+  /// results.
+  Tensor getTensor(const Variable *v) const;
+
+  /// Runs the compiled function against this context's state. Different
+  /// contexts may execute concurrently on different threads.
+  void execute();
+};
+
 /// This is the ExecutionEngine. It owns the Graph, the IR, and the backends.
 /// The Graph, IR, etc in this class are defined as pointers, in order to
 /// erase the type and prevent the internal types from leaking out to the
@@ -41,10 +84,164 @@ class ExecutionEngine final {
   std::unique_ptr<Backend> backend_;
   /// A glow function compiled for this ExecutionEngine's backend.
   std::unique_ptr<CompiledFunction> function_;
+  /// The compiled weight-update function used by gradient accumulation.
+  std::unique_ptr<CompiledFunction> updateFunction_;
+  /// The gradient accumulator variables of the update function compiled by
+  /// compileUpdate(), one per trainable weight. runBatchParallel() sums the
+  /// per-worker copies of these into the shared payloads before it applies
+  /// the update.
+  std::vector<Variable *> gradAccVars_;
+  /// The static memory footprint of the last compiled function.
+  MemoryUsageReport memoryUsage_;
+
+  /// One compiled partition of a FunctionDAG.
+  struct DAGStage {
+    /// The partition's graph function.
+    Function *F;
+    /// The backend that compiled the partition, when the heterogeneous
+    /// compileDAG() overload assigned it one other than the engine's own
+    /// backend. Declared before \ref function so that the compiled code is
+    /// destroyed before the backend that produced it.
+    std::unique_ptr<Backend> backend;
+    /// The code compiled for the partition.
+    std::unique_ptr<CompiledFunction> function;
+  };
+
+  /// A single-entry mailbox that carries the payload of a boundary variable
+  /// pair between the stage that produces it and the stage that consumes
+  /// it.
+  struct BoundaryChannel {
+    /// The variable the producer saves into.
+    Variable *out;
+    /// The variable the consumer reads.
+    Variable *in;
+    /// The producing and consuming stage indices.
+    unsigned producer, consumer;
+    /// Whether \ref in holds a batch the consumer has not finished with.
+    bool full{false};
+  };
+
+  /// The compiled partitions of the last compiled FunctionDAG, in
+  /// topological order.
+  std::vector<DAGStage> dagStages_;
+  /// The mailboxes for the variables that cross partition boundaries.
+  std::vector<BoundaryChannel> dagChannels_;
+
+  /// One execution request queued by runAsync().
+  struct RunRequest {
+    /// The variables to update before the run.
+    std::vector<Variable *> vars;
+    /// The tensors to update them with.
+    std::vector<Tensor *> inputs;
+    /// Fulfilled when the run completes.
+    std::promise<void> done;
+  };
+
+  /// The maximum number of requests that runAsync() buffers before it
+  /// blocks the caller.
+  static constexpr size_t maxPendingRequests = 32;
+  /// The requests queued by runAsync() that the worker has not picked up
+  /// yet.
+  std::deque<RunRequest> runQueue_;
+  /// Protects \ref runQueue_ and \ref runWorkerStop_.
+  std::mutex runQueueMutex_;
+  /// Signals the worker about new requests and the callers about free
+  /// queue slots.
+  std::condition_variable runQueueCV_;
+  /// The thread that executes the queued requests, started lazily by the
+  /// first runAsync() call.
+  std::thread runWorker_;
+  /// Tells the worker to exit once the queue is drained.
+  bool runWorkerStop_{false};
+
+  /// One batch-1 request queued by runBatched().
+  struct BatchedRequest {
+    /// The input variables of the request, in terms of the batch-1 function
+    /// passed to enableBatching().
+    std::vector<Variable *> vars;
+    /// The batch-1 tensors to gather into the coalesced batch.
+    std::vector<Tensor *> inputs;
+    /// The output variables whose rows are scattered back to the caller.
+    std::vector<Variable *> outputVars;
+    /// The caller's batch-1 tensors the results are scattered into.
+    std::vector<Tensor *> results;
+    /// Fulfilled once the request's results are in place.
+    std::promise<void> done;
+  };
+
+  /// The coalesced-batch function compiled by enableBatching().
+  std::unique_ptr<CompiledFunction> batchedFunction_;
+  /// Maps the public variables of the batch-1 function to the coalesced
+  /// clone's replacements.
+  llvm::DenseMap<Variable *, Variable *> batchedVarMap_;
+  /// The number of requests one coalesced execution carries at most.
+  size_t batchedMaxBatch_{0};
+  /// How long the batching worker waits for more requests before it runs a
+  /// partially filled batch.
+  unsigned batchedTimeoutUs_{0};
+  /// The requests queued by runBatched() that the batching worker has not
+  /// claimed yet.
+  std::deque<BatchedRequest> batchedQueue_;
+  /// Protects \ref batchedQueue_ and \ref batchedWorkerStop_.
+  std::mutex batchedQueueMutex_;
+  /// Signals the batching worker about new requests and the callers about
+  /// free queue slots.
+  std::condition_variable batchedQueueCV_;
+  /// The thread that coalesces and executes the queued requests, started by
+  /// enableBatching().
+  std::thread batchedWorker_;
+  /// Tells the batching worker to exit once the queue is drained.
+  bool batchedWorkerStop_{false};
+
+  /// A function compiled by compileAsync() that has not started serving
+  /// yet. run() installs it in place of \ref function_ before the next
+  /// execution.
+  std::unique_ptr<CompiledFunction> pendingFunction_;
+  /// Protects \ref pendingFunction_.
+  std::mutex pendingFunctionMutex_;
+  /// The thread that runs a compileAsync() compilation.
+  std::thread compileWorker_;
+  /// Counts compileAsync() calls, to give every clone a fresh name.
+  size_t recompileCounter_{0};
+
+  /// Previously compiled functions that are not currently installed, keyed
+  /// by the structural hash of their optimized IR. compile() reinstalls a
+  /// cached function instead of invoking the backend when it sees the same
+  /// structure again.
+  std::unordered_map<size_t, std::unique_ptr<CompiledFunction>> compileCache_;
+  /// The structural hash of the currently installed function.
+  size_t functionHash_{0};
+
+  /// One batch-size variant of the function compiled by the multi-batch
+  /// compile(). The variants share the weights through the module weight
+  /// arena; only the public variables are per-variant.
+  struct BatchVariant {
+    /// The batch size this variant was compiled for.
+    size_t batchSize;
+    /// The code compiled for this batch size.
+    std::unique_ptr<CompiledFunction> function;
+    /// Maps the public variables of the original function to this variant's
+    /// replacements.
+    llvm::DenseMap<Variable *, Variable *> varMap;
+  };
+
+  /// The batch-size variants compiled by the last multi-batch compile(), or
+  /// empty when a single batch size is compiled. run() dispatches between
+  /// them on the leading dimension of its first input.
+  std::vector<BatchVariant> batchVariants_;
+  /// Whether the variants in \ref batchVariants_ were compiled by
+  /// compileBucketed(): run() then routes an unmatched leading dimension to
+  /// the smallest variant that fits instead of rejecting it.
+  bool bucketedDispatch_{false};
 
   /// Optimize the graph, generate IR, and optimize the IR.
   std::unique_ptr<IRFunction> generateIR(CompilationMode mode, Function *F);
 
+  /// Like generateIR(), but lowers and transforms for \p backend instead of
+  /// the engine's own backend, for the heterogeneous compileDAG() overload.
+  std::unique_ptr<IRFunction> generateIR(CompilationMode mode, Function *F,
+                                         Backend &backend);
+
 public:
   ExecutionEngine(BackendKind backendKind = BackendKind::Interpreter);
 
@@ -66,22 +263,292 @@ public:
   /// specific target. This method should be invoked before the run method.
   void compile(CompilationMode mode, Function *F);
 
+  /// Compiles one variant of \p F per batch size in \p batchSizes, cloned
+  /// with Function::cloneWithNewBatch(), so a single engine serves batch-1
+  /// latency requests and large-batch throughput requests without
+  /// recompiling or padding. The variants share the constant weights; each
+  /// has its own public variables. run() dispatches on the leading
+  /// dimension of its first input tensor and remaps the variables of \p F
+  /// to the selected variant; results are read back through
+  /// getVariantVariable().
+  void compile(CompilationMode mode, Function *F,
+               llvm::ArrayRef<size_t> batchSizes);
+
+  /// Compiles one variant of \p F per bucket size in \p buckets, like the
+  /// multi-batch compile(), and enables bucketed dispatch for
+  /// variable-length inputs: a run() whose leading input dimension matches
+  /// no bucket exactly is routed to the smallest bucket that fits, with the
+  /// trailing rows of every input variable zero-padded. This bounds the
+  /// padding waste of worst-case-size compilation without recompiling per
+  /// length. Results are read from the variables of the selected bucket -
+  /// getVariantVariable() with the size selectBucket() returns - and only
+  /// the first rows, one per real input row, are meaningful.
+  void compileBucketed(CompilationMode mode, Function *F,
+                       llvm::ArrayRef<size_t> buckets);
+
+  /// \returns the bucket size that a run() with leading input dimension
+  /// \p length is routed to after compileBucketed().
+  size_t selectBucket(size_t length) const;
+
+  /// \returns the variable of the batch-size-\p batchSize variant that
+  /// corresponds to the public variable \p v of the function compiled by
+  /// the multi-batch compile(), e.g. for reading results after a dispatched
+  /// run(); \p v itself when it is shared between the variants.
+  Variable *getVariantVariable(Variable *v, size_t batchSize) const;
+
+  /// Compiles \p F like compile(), but with the backend code generation on
+  /// a background thread and against a clone of the function, so the
+  /// currently compiled function keeps serving runs while the new code is
+  /// generated. The graph optimization and IRGen run on the calling thread,
+  /// because graph nodes and IR values live in thread-local slab allocators
+  /// and must not outlive the thread that created them. Once the background
+  /// compilation finishes, the new function is installed before the next
+  /// run - recompilation without downtime, e.g. for switching between
+  /// training and inference or changing the batch size while serving. At
+  /// most one background compilation is in flight; a second call first
+  /// waits for the previous one. Must not overlap with calls to compile().
+  /// \returns a future that becomes ready when the new function has been
+  /// compiled and is eligible to serve.
+  std::future<void> compileAsync(CompilationMode mode, Function *F);
+
+  /// Selects the fastest backend for the model at startup: compiles \p F
+  /// for every available backend kind in \p candidates and times a few
+  /// forward passes with the sample inputs \p inputs bound to the
+  /// variables \p vars. The engine is left with the winning backend
+  /// selected and \p F compiled for inference. Unavailable candidates,
+  /// e.g. OpenCL on a host without a device, are skipped. When the
+  /// -backend-probe-cache option names a file, the decision is cached
+  /// there and later startups on the same host skip the probe.
+  /// \returns the selected backend kind.
+  BackendKind selectBackend(Function *F, llvm::ArrayRef<Variable *> vars,
+                            llvm::ArrayRef<Tensor *> inputs,
+                            llvm::ArrayRef<BackendKind> candidates);
+
+  /// \returns per-pass timing statistics collected during the last call to
+  /// compile(). Collection is enabled with the '-glow-pass-stats' command
+  /// line option.
+  llvm::ArrayRef<PassStat> getPassStats() const { return glow::getPassStats(); }
+
+  /// \returns the static memory footprint - weight bytes, peak activation
+  /// bytes and per-buffer lifetimes - of the function compiled by the last
+  /// call to compile() or save().
+  const MemoryUsageReport &getMemoryUsage() const { return memoryUsage_; }
+
   /// Save a bundle for a standalone execution. This method takes care of
   /// everything when preparing the bundle for saving. There is no need to
   /// invoke the compile method before it.
   void save(CompilationMode mode, Function *F, llvm::StringRef outputDir);
 
+  /// Save one bundle with an entry point for every function of \p Fs, which
+  /// must all belong to this engine's module. On backends that support it
+  /// the entry points share a single copy of the constant weights, e.g. a
+  /// preprocessing and a main network, or several batch sizes of one model.
+  void save(CompilationMode mode, llvm::ArrayRef<Function *> Fs,
+            llvm::StringRef outputDir);
+
+  /// Compile every partition of \p dag for this engine's backend. On
+  /// backends that manage several devices the partitions are assigned to
+  /// devices round-robin, so runDAGBatch() keeps all of them busy.
+  void compileDAG(CompilationMode mode, const FunctionDAG &dag);
+
+  /// Compile the partitions of \p dag for heterogeneous co-execution:
+  /// \p kinds names the backend kind of every partition, parallel to
+  /// dag.getFunctions(). Each partition is lowered, transformed and
+  /// compiled by a backend of its own kind, so e.g. the convolution-heavy
+  /// partitions of a model can run on the OpenCL device while the rest runs
+  /// on the host. runDAG() and runDAGBatch() drive the mixed stages
+  /// unchanged; the pipelined executor overlaps the boundary transfers with
+  /// the compute of the other stages, so both backends stay busy at once.
+  void compileDAG(CompilationMode mode, const FunctionDAG &dag,
+                  llvm::ArrayRef<BackendKind> kinds);
+
+  /// \returns a backend kind per partition of \p dag, parallel to
+  /// dag.getFunctions(), for the heterogeneous compileDAG() overload. A
+  /// partition goes to \p preferred when it contains dense compute - a
+  /// convolution or a matrix multiplication - and \p preferred supports all
+  /// of its operators; everything else, e.g. gather/topk tails, goes to
+  /// \p fallback. When \p preferred is not available on this host every
+  /// partition is assigned to \p fallback.
+  std::vector<BackendKind> assignDAGBackends(const FunctionDAG &dag,
+                                             BackendKind preferred,
+                                             BackendKind fallback) const;
+
+  /// Runs one forward pass over the partitions compiled by compileDAG(), in
+  /// dependency order. Updates the variables in \p vars with the values
+  /// \p inputs first.
+  void runDAG(llvm::ArrayRef<Variable *> vars, llvm::ArrayRef<Tensor *> inputs);
+
+  /// Runs \p iterations batches through the compiled partitions as a
+  /// pipeline: every partition runs on its own thread and hands its
+  /// boundary variables to the consuming partitions through single-entry
+  /// mailboxes, so consecutive batches overlap across partitions - and
+  /// across devices, when the partitions are placed on several devices.
+  /// Inputs are consumed slice-wise from \p inputs like in runBatch().
+  void runDAGBatch(size_t iterations, llvm::ArrayRef<Variable *> vars,
+                   llvm::ArrayRef<Tensor *> inputs);
+
   /// Runs the program in a forward pass. Update the nodes in \p nodes with the
   /// values \p inputs.
   void run(llvm::ArrayRef<Variable *> vars, llvm::ArrayRef<Tensor *> inputs);
 
+  /// Queues a forward pass that updates the variables in \p vars with the
+  /// values \p inputs and runs the compiled function, like run(). The
+  /// requests execute in order on an internal worker thread; at most a
+  /// fixed number of them are buffered before the call blocks, so a fast
+  /// producer cannot queue unbounded work. The caller must not modify
+  /// \p inputs until the run completes. runAsync() must not be mixed with
+  /// concurrent calls to run() or compile().
+  /// \returns a future that becomes ready when the run has finished.
+  std::future<void> runAsync(llvm::ArrayRef<Variable *> vars,
+                             llvm::ArrayRef<Tensor *> inputs);
+
+  /// Enables dynamic request batching: compiles a batch-\p maxBatch clone of
+  /// the batch-1 function \p F (with Function::cloneWithNewBatch(), so the
+  /// weights are shared) and starts a worker thread that coalesces requests
+  /// queued by runBatched() into single executions of it. Serving hardware
+  /// is only efficient at large batches while requests arrive one sample at
+  /// a time; coalescing trades a bounded amount of latency for that
+  /// efficiency. \p timeoutMicroseconds is the bound: once the oldest
+  /// queued request has waited that long, the worker runs a partially
+  /// filled batch instead of holding out for \p maxBatch requests.
+  void enableBatching(CompilationMode mode, Function *F, size_t maxBatch,
+                      unsigned timeoutMicroseconds);
+
+  /// Queues one batch-1 request against the function passed to
+  /// enableBatching(). The tensors \p inputs are gathered into one row of
+  /// the coalesced batch's variables, and after the batched execution the
+  /// request's rows of the variables in \p outputVars are scattered into
+  /// the caller's tensors \p results, like in runSharded(). \p vars and
+  /// \p outputVars name the variables of the original batch-1 function.
+  /// The caller must keep \p inputs and \p results alive until the
+  /// returned future is ready; at most a fixed number of requests are
+  /// buffered before the call blocks.
+  /// \returns a future that becomes ready when the results are in place.
+  std::future<void> runBatched(llvm::ArrayRef<Variable *> vars,
+                               llvm::ArrayRef<Tensor *> inputs,
+                               llvm::ArrayRef<Variable *> outputVars,
+                               llvm::ArrayRef<Tensor *> results);
+
+  /// \returns true if the function compiled by the last call to compile()
+  /// supports execution contexts.
+  bool supportsContexts() const {
+    return function_ && function_->getMutableWeightsSize();
+  }
+
+  /// \returns a new execution context over the function compiled by the
+  /// last call to compile(), seeded with the current values of the public
+  /// variables. Contexts are cheap - they hold only the activations and the
+  /// I/O bindings - and independent, so one context per serving thread runs
+  /// concurrent requests over a single compiled function. Requires a
+  /// backend that supports execution contexts, like the CPU backend.
+  std::unique_ptr<ExecutionContext> createContext();
+
+  /// Like run(), but against the private state of \p ctx: updates the
+  /// context's copies of the variables in \p vars with the values
+  /// \p inputs, then runs the compiled function. Calls with distinct
+  /// contexts may run concurrently on different threads; results are read
+  /// back with ExecutionContext::getTensor().
+  void runWithContext(ExecutionContext *ctx, llvm::ArrayRef<Variable *> vars,
+                      llvm::ArrayRef<Tensor *> inputs);
+
+  /// Runs the program like run(), but with zero-copy I/O binding: for the
+  /// duration of the run the payload of each variable in \p vars aliases
+  /// the corresponding caller buffer in \p buffers instead of being copied
+  /// into. Inputs are read from and results are produced directly into the
+  /// bound buffers, which eliminates both memcpys of run(). The i-th
+  /// buffer must stay alive for the whole run and hold at least
+  /// vars[i]->getType()->getSizeInBytes() bytes, aligned for the element
+  /// type. Requires a backend whose supportsBoundIO() is true; the CPU JIT
+  /// resolves payload addresses at compile time and is not supported.
+  void runWithBoundIO(llvm::ArrayRef<Variable *> vars,
+                      llvm::ArrayRef<void *> buffers);
+
+  /// Shards the batch dimension of the \p inputs across worker threads:
+  /// the function must be compiled for the shard batch size, and the batch
+  /// dimension of every input must be a multiple of it. Each shard runs
+  /// the compiled function on its slice of the batch in a private execution
+  /// context, and the slices of the result variables \p outputVars are
+  /// reassembled into the tensors \p results, which must have the full
+  /// batch size. Requires a backend that supports execution contexts.
+  void runSharded(llvm::ArrayRef<Variable *> vars,
+                  llvm::ArrayRef<Tensor *> inputs,
+                  llvm::ArrayRef<Variable *> outputVars,
+                  llvm::ArrayRef<Tensor *> results);
+
+  /// Runs a quantization calibration pass over \p iterations batches, in
+  /// parallel. \p F must be the instrumented function produced by
+  /// profileQuantization() and compiled by the last call to compile().
+  /// Inputs are consumed slice-wise from \p inputs like in runBatch(), but
+  /// the batches are distributed over \p numThreads workers (0 uses all
+  /// hardware threads), each profiling into the private histogram copies of
+  /// its own execution context. After the workers drain the dataset, the
+  /// per-worker histograms and min/max ranges are merged back into the
+  /// profile variables of \p F, so generateNodeQuantizationInfos() sees a
+  /// profile equivalent to a serial calibration run. Requires a backend
+  /// that supports execution contexts.
+  void runProfile(Function *F, size_t iterations,
+                  llvm::ArrayRef<Variable *> vars,
+                  llvm::ArrayRef<Tensor *> inputs, unsigned numThreads = 0);
+
   /// Train the network. Perform \p iterations in the training loop. Each
   /// iteration does a full forward and backward pass of a whole batch.
   /// The method updates the variables in \p vars with the tensors \p inputs.
   void runBatch(size_t iterations, llvm::ArrayRef<Variable *> vars,
                 llvm::ArrayRef<Tensor *> inputs);
 
+  /// Like runBatch(), but with a prefetching data pipeline: a background
+  /// thread stages the next micro-batch into one half of a double buffer
+  /// while the current micro-batch trains out of the other half, so slice
+  /// extraction overlaps with compute and only a straight copy into the
+  /// input variables remains on the training step critical path.
+  void runBatchPrefetch(size_t iterations, llvm::ArrayRef<Variable *> vars,
+                        llvm::ArrayRef<Tensor *> inputs);
+
+  /// Compiles the weight-update function \p F that differentiate() emits
+  /// when the training configuration accumulates micro-batch gradients
+  /// (TrainingConfig::accumSteps > 1). The compiled update is applied by
+  /// runBatch() with a matching \p accumSteps argument, or once per
+  /// parallel step by runBatchParallel().
+  void compileUpdate(CompilationMode mode, Function *F);
+
+  /// Like runBatch(), but with gradient accumulation: every micro-batch
+  /// runs a forward and backward pass that only sums the gradients, and
+  /// the update function compiled by compileUpdate() applies the weight
+  /// update once every \p accumSteps micro-batches. This trains with an
+  /// effective batch of accumSteps full batches at the activation memory
+  /// of a single one.
+  void runBatch(size_t iterations, llvm::ArrayRef<Variable *> vars,
+                llvm::ArrayRef<Tensor *> inputs, size_t accumSteps);
+
+  /// Data-parallel training: every one of \p iterations steps runs
+  /// \p numWorkers consecutive micro-batches concurrently, each worker
+  /// executing the forward and backward pass on its own slice of \p inputs
+  /// in a private execution context. The weights are private variables, so
+  /// all workers read the one shared copy; the gradient accumulators are
+  /// public, so every worker sums into a context-private copy. After the
+  /// workers finish a step, the per-worker gradients are reduced into the
+  /// shared accumulators and the update function compiled by
+  /// compileUpdate() applies the weight update once. Differentiate with
+  /// TrainingConfig::accumSteps == numWorkers, so that the optimizer
+  /// normalizes by the effective batch; a step is then equivalent to one
+  /// accumulation cycle of runBatch(), executed on numWorkers cores.
+  /// \p numWorkers of 0 uses all hardware threads. Requires a backend that
+  /// supports execution contexts.
+  void runBatchParallel(size_t iterations, llvm::ArrayRef<Variable *> vars,
+                        llvm::ArrayRef<Tensor *> inputs,
+                        unsigned numWorkers = 0);
+
 private:
+  /// The loop of the runAsync() worker thread: executes the queued
+  /// requests in order until it is told to stop and the queue is drained.
+  void runWorkerLoop();
+
+  /// The loop of the enableBatching() worker thread: claims up to
+  /// batchedMaxBatch_ queued requests (waiting out the deadline for more),
+  /// gathers their inputs, runs the coalesced function once and scatters
+  /// the results back to the callers.
+  void batchedWorkerLoop();
+
   /// Update the inputs for all variables \p vars with data from the inputs \p
   /// inputs at offset \p sampleIdx. Then perform a run of the network.
   void updateInputsAndRunNetwork(llvm::ArrayRef<Variable *> vars,
@@ -21,11 +21,15 @@
 
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/ilist.h"
 #include "llvm/ADT/ilist_node.h"
 
 #include <list>
+#include <unordered_map>
 #include <vector>
 
 namespace glow {
@@ -48,13 +52,27 @@ class Module final {
   /// A uniqued list of types. Types in this list can be equated by comparing
   /// their addresses.
   TypesList types_{};
+  /// An index from the hash of a type to the uniqued types with that hash.
+  /// Each bucket is almost always a single entry; it only grows on a hash
+  /// collision. The Type pointers refer into \ref types_, which guarantees
+  /// their stability.
+  std::unordered_map<size_t, llvm::SmallVector<Type *, 1>> typesByHash_;
   /// Stores a list of unique variable names that were used by the module at
   /// some point.
   llvm::StringSet<> uniqueVariableNames_{};
   /// A list of variables that the Module owns.
   VariablesList vars_;
+  /// An index from the unique name of a variable to the variable itself,
+  /// kept in sync by addVar() and eraseVariable(). This makes rebinding
+  /// named inputs O(1) instead of a scan over all of the weights.
+  llvm::StringMap<Variable *> variableByName_;
   /// Deterministic PRNG used to initialize weights in this module.
   PseudoRNG PRNG_;
+  /// When set, createVariable() allocates the variable payloads but skips
+  /// their initialization. See \ref setDeferredInit.
+  bool deferInit_{false};
+  /// Memoized results of differentiate(). See \ref getGradFunctionCache.
+  std::unordered_map<uint64_t, Function *> gradFunctionCache_;
 
 public:
   Module() = default;
@@ -70,6 +88,7 @@ public:
   Variable *addVar(Variable *V) {
     V->setName(uniqueName(V->getName(), uniqueVariableNames_));
     vars_.push_back(V);
+    variableByName_[V->getName()] = V;
     return V;
   }
 
@@ -97,6 +116,9 @@ public:
   Function *getFunction(llvm::StringRef name);
   /// \returns a new function with the name \p name.
   Function *createFunction(llvm::StringRef name);
+
+  /// Erase the function \p F from the module and delete it.
+  void eraseFunction(Function *F);
   /// \returns the list of Functions that the Module owns.
   FunctionList &getFunctions() { return functions_; }
 
@@ -149,9 +171,24 @@ public:
   /// Verify the correctness of the Module.
   void verify() const;
 
+  /// \returns the cache that maps the structural hash of a forward function
+  /// combined with a training configuration to a previously differentiated
+  /// function. Used by differentiate() to avoid rebuilding an identical
+  /// gradient graph on repeated compiles.
+  std::unordered_map<uint64_t, Function *> &getGradFunctionCache() {
+    return gradFunctionCache_;
+  }
+
   /// Get the pseudo-random number generator used by this module.
   PseudoRNG &getPRNG() { return PRNG_; }
 
+  /// When \p defer is set, variables created from this point on have their
+  /// payloads allocated but not initialized - no Xavier randomization and
+  /// no zero fill. Intended for modules whose weights are about to be
+  /// overwritten anyway, e.g. by loadCheckpoint(), where the initialization
+  /// pass is pure waste at large model sizes.
+  void setDeferredInit(bool defer) { deferInit_ = defer; }
+
   /// Dumps the textual representation of the network.
   void dump() const;
 
@@ -174,6 +211,19 @@ class Function final : public Named {
   /// point.
   llvm::StringSet<> uniqueNodeNames_{};
 
+  /// The set of nodes that were added or mutated since the last verification.
+  /// This lets verify() re-check only the part of the function that actually
+  /// changed between optimization passes.
+  mutable llvm::SmallPtrSet<const Node *, 16> dirtyNodes_;
+
+  /// A cached post-order (topological) ordering of the nodes. The cache is
+  /// invalidated whenever a node is added, removed or has an operand changed,
+  /// and recomputed lazily on the next request.
+  mutable std::vector<Node *> cachedPostOrder_;
+
+  /// True if \ref cachedPostOrder_ is up to date.
+  mutable bool postOrderValid_{false};
+
   /// A reference to the owner of the function.
   Module *parent_;
 
@@ -291,6 +341,13 @@ public:
   InsertTensorNode *createTile(llvm::StringRef name, NodeValue input,
                                unsigned tiles, unsigned axis);
 
+  /// Create an insert tensor node that inserts \p count copies of \p small
+  /// into \p big along \p axis, starting at the offsets \p start.
+  InsertTensorNode *createInsertTensor(llvm::StringRef name, NodeValue big,
+                                       NodeValue small,
+                                       llvm::ArrayRef<size_t> start,
+                                       unsigned count, unsigned axis);
+
   SliceNode *createSlice(llvm::StringRef name, NodeValue input,
                          UnsignedArrayRef begin, UnsignedArrayRef end);
 
@@ -379,6 +436,15 @@ public:
   MatMulNode *createMatMul(llvm::StringRef name, TypeRef outTy, NodeValue lhs,
                            NodeValue rhs);
 
+  /// Create a batched matrix multiplication that multiplies each slice of
+  /// \p lhs, of shape (N, A, Z), with the corresponding slice of \p rhs, of
+  /// shape (N, Z, B), producing a result of shape (N, A, B).
+  BatchMatMulNode *createBatchMatMul(llvm::StringRef name, NodeValue lhs,
+                                     NodeValue rhs);
+
+  BatchMatMulNode *createBatchMatMul(llvm::StringRef name, TypeRef outTy,
+                                     NodeValue lhs, NodeValue rhs);
+
   BatchedReduceAddNode *createBatchedReduceAdd(llvm::StringRef name,
                                                NodeValue batch, size_t axis);
 
@@ -446,6 +512,12 @@ public:
 
   TopKNode *createTopK(llvm::StringRef name, NodeValue input, size_t k);
 
+  /// Create a TopK node that emits its indices with the element kind
+  /// \p indexKind, either the native ElemKind::IndexTy or the compact
+  /// ElemKind::Int32ITy.
+  TopKNode *createTopK(llvm::StringRef name, NodeValue input, size_t k,
+                       ElemKind indexKind);
+
   /// Gathers entries of the outer-most dimension of \p data indexed by
   /// \p indices, and concatenates them. A non-zero \p batchDims specifies the
   /// batch, and the result is the concatenation of the operation on each sample
@@ -524,6 +596,27 @@ public:
                   unsigned hiddenSize, unsigned outputSize,
                   std::vector<NodeValue> &outputs);
 
+  /// Create a fused LSTM timestep that consumes the previous hidden state
+  /// \p H and cell state \p C, both {batch, hiddenSize}, and the input
+  /// \p input {batch, inputSize}. \p Wx is {inputSize, 4 * hiddenSize},
+  /// \p Wh is {hiddenSize, 4 * hiddenSize} and \p bias is {4 * hiddenSize},
+  /// with the input, forget, cell and output gates packed in that order.
+  /// Backends without a native kernel lower it to the expanded form.
+  LSTMCellNode *createLSTMCell(llvm::StringRef name, NodeValue input,
+                               NodeValue H, NodeValue C, NodeValue Wx,
+                               NodeValue Wh, NodeValue bias);
+
+  /// Create a fused GRU timestep that consumes the previous hidden state
+  /// \p H {batch, hiddenSize} and the input \p input {batch, inputSize}.
+  /// \p Wx is {inputSize, 3 * hiddenSize}, \p Wh is {hiddenSize, 3 *
+  /// hiddenSize} and \p bx / \p bh are the input-side and recurrent biases
+  /// {3 * hiddenSize}, with the update, reset and candidate gates packed in
+  /// that order. Backends without a native kernel lower it to the expanded
+  /// form.
+  GRUCellNode *createGRUCell(llvm::StringRef name, NodeValue input,
+                             NodeValue H, NodeValue Wx, NodeValue Wh,
+                             NodeValue bx, NodeValue bh);
+
   /// @}
 
   /// Erase the node \p N from the Function.
@@ -539,9 +632,54 @@ public:
   Function *clone(llvm::StringRef newName,
                   llvm::DenseMap<Node *, Node *> *map = nullptr);
 
-  /// Verify the correctness of the Function.
+  /// Clone the current function into a new function with the name \p newName
+  /// that processes batches of \p batchSize samples. The batch size of this
+  /// function is inferred from the leading dimension of its public variables.
+  /// Every public variable whose leading dimension is the batch is replaced
+  /// in the clone by a new variable sized for \p batchSize; the private
+  /// variables - the weights - stay shared between the clones. If \p varMap
+  /// is non-null it records the mapping from the replaced variables to their
+  /// replacements. Dimensions are identified by value, so a function whose
+  /// non-batch dimensions coincide with the batch size cannot be
+  /// respecialized this way.
+  /// \returns the new-batch clone of the current function.
+  Function *cloneWithNewBatch(llvm::StringRef newName, size_t batchSize,
+                              llvm::DenseMap<Variable *, Variable *> *varMap =
+                                  nullptr);
+
+  /// Record that the node \p N was added or mutated since the last
+  /// verification.
+  void markNodeDirty(const Node *N) const {
+    dirtyNodes_.insert(N);
+    postOrderValid_ = false;
+  }
+
+  /// Drop the dirty-state of the node \p N, e.g. when it is removed from the
+  /// function.
+  void forgetDirtyNode(const Node *N) const {
+    dirtyNodes_.erase(N);
+    postOrderValid_ = false;
+  }
+
+  /// \returns a post-order (topological) ordering of the nodes: every node
+  /// appears after all of its inputs. The order is computed lazily and cached;
+  /// repeated calls over an unmodified function return the cached order.
+  llvm::ArrayRef<Node *> getPostOrder() const;
+
+  /// \returns a hash of the structure of the function: the kinds and
+  /// attributes of all reachable nodes and the shape of the edges between
+  /// them. Functions with identical structure hash to the same value.
+  llvm::hash_code getStructuralHash() const;
+
+  /// Verify the correctness of the Function. In release builds only the nodes
+  /// that were touched since the previous call are re-verified; debug builds
+  /// always verify the whole function.
   void verify() const;
 
+  /// Verify the correctness of every node in the Function, regardless of what
+  /// changed since the last verification.
+  void verifyFull() const;
+
   /// Dumps the textual representation of the network.
   void dump() const;
 
@@ -577,6 +715,11 @@ using VariableGradientsList = std::list<std::pair<Variable *, Variable *>>;
 /// the procedure adds code to record the last gradient value: a list of
 /// (var, grad_var) pairs associating variables with their gradient variables.
 /// This feature is used by the gradient-check unit tests.
+/// When \p config requests gradient accumulation (accumSteps > 1), the
+/// returned function only sums the micro-batch gradients into accumulator
+/// variables; the weight update lives in a companion function named
+/// '<newFuncName>_update' that must be compiled separately and run once
+/// per accumulation cycle (see ExecutionEngine::compileUpdate).
 /// \returns a new function with the name \p newFuncName.
 Function *differentiate(Function *F, const TrainingConfig &config,
                         llvm::StringRef newFuncName = "",
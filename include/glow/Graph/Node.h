@@ -186,6 +186,7 @@ public:
 
   NodeValueArrayRef(llvm::ArrayRef<NodeHandle> ref) : ref_(ref) {}
   NodeValueArrayRef(const std::vector<NodeHandle> &ref) : ref_(ref) {}
+  NodeValueArrayRef(const llvm::SmallVectorImpl<NodeHandle> &ref) : ref_(ref) {}
   const NodeValue &operator[](std::size_t idx) const { return ref_[idx]; }
   operator std::vector<NodeValue>() {
     return std::vector<NodeValue>(ref_.begin(), ref_.end());
@@ -247,6 +248,13 @@ public:
   Node(Kinded::Kind k, llvm::StringRef name)
       : Named(name), Kinded(k), predicate_(this, nullptr), parent_(nullptr) {}
 
+  /// Nodes are allocated from a slab allocator that hands out memory
+  /// bump-pointer style, so nodes that are created together are laid out
+  /// next to each other and graph traversals walk mostly-contiguous memory.
+  void *operator new(size_t size);
+  /// Returns the node's memory to the slab allocator's free list.
+  void operator delete(void *ptr, size_t size);
+
   /// \returns the nullable predicate of the current node.
   const NodeValue getPredicate() const;
   /// Assigns a nullable predicate to the current node.
@@ -323,6 +331,11 @@ public:
   /// \returns the n'th result type of the node.
   TypeRef getType(unsigned idx) const;
 
+  /// Replace the n'th result type of the node with \p T. The caller is
+  /// responsible for keeping the graph consistent, e.g. when respecializing
+  /// a cloned function to a new batch size.
+  void setType(unsigned idx, TypeRef T);
+
   /// Methods that forward to the result type (that must be valid):
   /// @{
   ElemKind getElementType(unsigned resNo) const;
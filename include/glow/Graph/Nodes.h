@@ -22,6 +22,7 @@
 #include "glow/Graph/Node.h"
 
 #include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/Casting.h"
 
 #include <tuple>
@@ -48,28 +49,45 @@ private:
   TrainKind train_;
   /// Specifies the visibility of the variable.
   VisibilityKind visibility_;
-  /// The tensor payload that the variable holds.
-  Tensor payload_;
+  /// The tensor payload that the variable holds. It is allocated and
+  /// initialized lazily, on the first access through getPayload(), so that
+  /// variables that are overwritten in bulk before being read (imported
+  /// weights, restored checkpoints) never pay for the initial fill.
+  mutable Tensor payload_;
+  /// True once \ref payload_ has been allocated.
+  mutable bool payloadReady_{false};
+  /// The random number generator to use for the deferred initialization.
+  PseudoRNG *PRNG_{nullptr};
+  /// If set, the initial fill is skipped because the creator of the variable
+  /// promised to overwrite the payload.
+  bool deferInit_{false};
 
   /// Initialize the content of the tensor.
   /// Payload is initialized to zero for 'None' TrainKind, and user
   /// of the graph is responsible for updating the tensor externally.
-  void initPayload(PseudoRNG &PRNG);
+  /// If \p skipInit then the payload is allocated but its content is left
+  /// uninitialized, for variables that are about to be overwritten, e.g. by
+  /// restoring a checkpoint.
+  void initPayload(PseudoRNG &PRNG, bool skipInit = false);
+
+  /// Allocate and initialize \ref payload_ on its first access.
+  void ensurePayload() const;
 
 public:
-  /// Create a new variable and initialize its payload.
+  /// Create a new variable. The payload is materialized on first access; if
+  /// \p deferInit is set the caller announced that it will fill the payload
+  /// itself and the initial fill is skipped.
   Variable(llvm::StringRef name, TypeRef Ty, VisibilityKind visibility,
-           TrainKind train, float val, PseudoRNG &PRNG)
+           TrainKind train, float val, PseudoRNG &PRNG, bool deferInit = false)
       : Node(Kinded::Kind::VariableKind, name), val_(val), train_(train),
-        visibility_(visibility) {
+        visibility_(visibility), PRNG_(&PRNG), deferInit_(deferInit) {
     addResult(Ty);
-    initPayload(PRNG);
   }
 
   Variable(llvm::StringRef name, VisibilityKind visibility, Tensor &&payload)
       : Node(Kinded::Kind::VariableKind, name), val_(0.0),
         train_(TrainKind::None), visibility_(visibility),
-        payload_(std::move(payload)) {
+        payload_(std::move(payload)), payloadReady_(true) {
     addResult(&payload_.getType());
   }
 
@@ -101,15 +119,26 @@ public:
   /// \returns the visibility of the variable.
   VisibilityKind getVisibilityKind() const { return visibility_; }
 
-  Tensor &getPayload() { return payload_; }
+  Tensor &getPayload() {
+    ensurePayload();
+    return payload_;
+  }
 
-  const Tensor &getPayload() const { return payload_; }
+  const Tensor &getPayload() const {
+    ensurePayload();
+    return payload_;
+  }
 
   template <class ElemTy = float> Handle<ElemTy> getHandle() {
     return getPayload().getHandle<ElemTy>();
   }
 
-  void copyFrom(const Tensor *t) { payload_.copyFrom(t); }
+  void copyFrom(const Tensor *t) {
+    // The whole payload is overwritten, so the initial fill would be wasted
+    // work; just mark the payload as materialized.
+    payloadReady_ = true;
+    payload_.copyFrom(t);
+  }
 
   /// \returns the output NodeValue from the Variable. Variables only have a
   /// single output.
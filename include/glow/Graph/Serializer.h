@@ -0,0 +1,71 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GLOW_GRAPH_SERIALIZER_H
+#define GLOW_GRAPH_SERIALIZER_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#include <memory>
+
+namespace glow {
+
+class Function;
+class Module;
+
+/// Writes the types, variables and nodes of \p F into the versioned binary
+/// graph file \p graphFileName, and the variable payloads into the sidecar
+/// weights file \p weightsFileName. The two files capture the function after
+/// import and optimization, so a later process can load the compiled graph
+/// directly and skip both the protobuf importers and the graph optimizer.
+/// Only the node kinds that can appear in an optimized inference graph are
+/// supported; serializing an unsupported kind aborts with an error.
+void saveFunction(Function &F, llvm::StringRef graphFileName,
+                  llvm::StringRef weightsFileName);
+
+/// Reads a function that was saved by saveFunction from \p graphFileName and
+/// \p weightsFileName into \p F, which must be empty. Variables are created
+/// in the module of \p F and their payloads alias the memory-mapped weights
+/// file instead of being copied, so loading is O(graph size) and the weights
+/// are paged in lazily by the OS. \returns the mapping that backs the
+/// payloads; the caller must keep it alive for as long as the module is in
+/// use. The mapping is read-only, so the loaded graph must not be trained or
+/// otherwise mutate its weights.
+std::unique_ptr<llvm::MemoryBuffer> loadFunction(Function &F,
+                                                 llvm::StringRef graphFileName,
+                                                 llvm::StringRef weightsFileName);
+
+/// Writes the payloads of every variable of \p M into the single binary
+/// checkpoint file \p checkpointFileName, for snapshotting a training run.
+/// The file holds a name-keyed index followed by the raw payloads, which are
+/// written in parallel by \p numThreads writers (0 uses all hardware
+/// threads) at precomputed offsets, so the cost is bounded by the disk
+/// bandwidth rather than by any serialization format.
+void saveCheckpoint(Module &M, llvm::StringRef checkpointFileName,
+                    unsigned numThreads = 0);
+
+/// Restores the variable payloads of \p M from a checkpoint written by
+/// saveCheckpoint(). The file is memory-mapped and each entry is copied into
+/// the payload of the variable with the matching name, whose type must
+/// match; variables absent from the checkpoint keep their current content.
+/// Modules built under Module::setDeferredInit() skip the weight
+/// initialization pass entirely and get their content here.
+void loadCheckpoint(Module &M, llvm::StringRef checkpointFileName);
+
+} // namespace glow
+
+#endif // GLOW_GRAPH_SERIALIZER_H
@@ -16,20 +16,32 @@
 #ifndef GLOW_GRAPH_USEDEF_H
 #define GLOW_GRAPH_USEDEF_H
 
-#include <list>
+#include "llvm/ADT/SmallVector.h"
+
+#include <algorithm>
+#include <cassert>
 
 namespace glow {
 
 /// A UseDef is something that can be an operand for an instruction.
 template <typename UserTy, typename UseTy, typename Use> class UseDef {
+public:
+  /// The type of the use-list. The first few uses are stored inline in the
+  /// value itself, so maintaining the use-list of a typical value does not
+  /// touch the heap at all, and iteration over the uses is contiguous.
+  using UsersTy = llvm::SmallVector<Use, 2>;
+
+private:
   /// A list of users. Notice that the same user may appear twice in the list.
   /// This is typically a very short list.
-  std::list<Use> users_{};
+  UsersTy users_{};
 
 public:
   UseDef() = default;
 
-  /// Removes the use \p U from the uselist.
+  /// Removes the use \p U from the uselist. Note: use-list iterators are
+  /// invalidated; callers that mutate the list while iterating must copy it
+  /// first.
   void removeUse(Use U) {
     auto it = std::find(users_.begin(), users_.end(), U);
     assert(it != users_.end() && "User not in list");
@@ -58,10 +70,10 @@ public:
   }
 
   /// \returns the list of users for this value.
-  std::list<Use> &getUsers() { return users_; }
+  UsersTy &getUsers() { return users_; }
 
   /// \returns the list of users for this value.
-  const std::list<Use> &getUsers() const { return users_; }
+  const UsersTy &getUsers() const { return users_; }
 };
 
 } // namespace glow
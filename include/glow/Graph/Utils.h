@@ -20,12 +20,59 @@
 #include "glow/Graph/Node.h"
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
 
 #include <unordered_set>
 #include <vector>
 
 namespace glow {
 
+/// Visits \p root and every node reachable from it through inputs and
+/// predicates, invoking the callbacks of \p walker in the same order as the
+/// recursive Node::visit: shouldVisit() and pre() before a node's inputs are
+/// processed, and post() after them. The traversal keeps an explicit stack,
+/// so arbitrarily deep graphs do not overflow the call stack.
+inline void visitPostOrder(Node *root, NodeWalker &walker) {
+  /// An entry in the traversal stack: a node, the node it was reached from,
+  /// and the index of the next child to process. The predicate, when present,
+  /// is child number zero.
+  struct StackEntry {
+    Node *parent;
+    Node *node;
+    unsigned nextChild;
+  };
+  llvm::SmallVector<StackEntry, 32> stack;
+
+  if (!walker.shouldVisit(nullptr, root)) {
+    return;
+  }
+  walker.pre(nullptr, root);
+  stack.push_back({nullptr, root, 0});
+
+  while (!stack.empty()) {
+    StackEntry &top = stack.back();
+    Node *N = top.node;
+    unsigned hasPred = N->hasPredicate() ? 1 : 0;
+    unsigned numChildren = N->getNumInputs() + hasPred;
+
+    if (top.nextChild < numChildren) {
+      unsigned idx = top.nextChild++;
+      Node *child = (hasPred && idx == 0)
+                        ? N->getPredicate().getNode()
+                        : N->getNthInput(idx - hasPred).getNode();
+      // Note: pushing may invalidate \ref top; it is not touched after this.
+      if (walker.shouldVisit(N, child)) {
+        walker.pre(N, child);
+        stack.push_back({N, child, 0});
+      }
+      continue;
+    }
+
+    walker.post(top.parent, N);
+    stack.pop_back();
+  }
+}
+
 /// A helper class for ordering the nodes in a post-order order.
 struct PostOrderVisitor : NodeWalker {
   /// A post-order list of nodes.
@@ -59,13 +106,13 @@ public:
 class GraphPostOrderVisitor : public PostOrderVisitor {
   Function &G;
   void visit() {
-    for (const auto *V : G.getParent()->getVars()) {
-      V->visit(nullptr, this);
+    for (auto *V : G.getParent()->getVars()) {
+      visitPostOrder(V, *this);
     }
     // Start visiting all root nodes, i.e. nodes that do not have any users.
     for (auto &N : G.getNodes()) {
       if (N.getNumUsers() == 0)
-        N.visit(nullptr, this);
+        visitPostOrder(&N, *this);
     }
   }
 
@@ -22,6 +22,7 @@
 #include "glow/Graph/UseDef.h"
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/StringSet.h"
@@ -86,6 +87,14 @@ public:
   Value(llvm::StringRef name, TypeRef T, Kinded::Kind k)
       : Named(name), Typed(T), Kinded(k) {}
 
+  /// Values and instructions are allocated from a per-thread slab allocator,
+  /// so instructions that IRGen emits together are laid out next to each
+  /// other and the optimizer's repeated scans over the instruction list walk
+  /// mostly-contiguous memory.
+  void *operator new(size_t size);
+  /// Returns the object's memory to the slab allocator's free list.
+  void operator delete(void *ptr, size_t size);
+
   void verifyUseList(const InstructionNumbering &InstrNumbering) const;
 
   /// Verify the correctness of the instruction parameters.
@@ -124,6 +133,11 @@ private:
   /// short list.
   llvm::SmallVector<Operand, 6> ops_{};
 
+  /// Cached root of the tensor-view chain that starts at this instruction.
+  /// Computed lazily by getOrigin() and reset whenever an operand changes, so
+  /// that alias queries do not walk the view chain on every call.
+  mutable Value *cachedOrigin_{nullptr};
+
   // Define/disallow default ctor, copy ctor and assignment operator.
   Instruction(const Instruction &I) = delete;
   Instruction &operator=(const Instruction &I) = delete;
@@ -174,6 +188,14 @@ public:
   /// Sets the ith operand at index \p idx to the value \p v.
   void setOperand(unsigned idx, Value *v);
 
+  /// \returns the cached tensor-view origin, or nullptr if it was not
+  /// computed yet. Maintained by getOrigin().
+  Value *getCachedOrigin() const { return cachedOrigin_; }
+
+  /// Records \p origin as the root of the tensor-view chain that starts at
+  /// this instruction.
+  void setCachedOrigin(Value *origin) const { cachedOrigin_ = origin; }
+
   /// \returns the ith operand.
   Operand getOperand(unsigned idx) const;
 
@@ -279,9 +301,18 @@ private:
   /// A list of unique instruction names use by the function.
   llvm::StringSet<> stringTable_;
 
+  /// Maps instructions to the concurrency stream of the graph node they were
+  /// generated from. See getInstrStream() for the semantics of streams.
+  std::unordered_map<const Instruction *, unsigned> instrStreams_;
+
+  /// Number of concurrency streams used by the current schedule.
+  unsigned numStreams_{0};
+
   /// Perform scheduling on the graph.
-  /// \returns computed schedule in the \p Schedule parameter.
-  void scheduleGraph(NodesPtrList &Schedule);
+  /// \returns the computed schedule in the \p Schedule parameter and the
+  /// concurrency stream of every scheduled node in \p streams.
+  void scheduleGraph(NodesPtrList &Schedule,
+                     llvm::DenseMap<const Node *, unsigned> &streams);
 
 public:
   /// Add an instruction to the instr stream.
@@ -299,6 +330,26 @@ public:
   /// again for another round of code generation.
   void clear();
 
+  /// Records that the instruction \p I belongs to concurrency stream
+  /// \p stream.
+  void setInstrStream(const Instruction *I, unsigned stream) {
+    instrStreams_[I] = stream;
+    numStreams_ = std::max(numStreams_, stream + 1);
+  }
+
+  /// \returns the concurrency stream of the instruction \p I. Instructions
+  /// on the same stream must execute in order. Instructions on different
+  /// streams have no ordering between them beyond the dependencies implied by
+  /// their operands, so backends may execute them concurrently after
+  /// synchronizing on the producers of their input buffers.
+  unsigned getInstrStream(const Instruction *I) const {
+    auto it = instrStreams_.find(I);
+    return it == instrStreams_.end() ? 0 : it->second;
+  }
+
+  /// \returns the number of concurrency streams in the current schedule.
+  unsigned getNumStreams() const { return numStreams_; }
+
   /// \returns a reference to the high-level graph.
   Function *getGraph() { return G_; }
 
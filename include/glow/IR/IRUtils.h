@@ -22,6 +22,8 @@
 
 namespace glow {
 
+class TensorViewInst;
+
 /// \returns true if the value \v is a tensor view.
 bool isTensorView(Value *v);
 
@@ -45,7 +47,7 @@ public:
         std::forward_iterator_tag,
         typename std::conditional<is_const_iter, const Use, Use>::type>;
     using reference = typename BASE::reference;
-    using UseList = std::list<Use>;
+    using UseList = Value::UsersTy;
     using value =
         typename std::conditional<is_const_iter, const Value, Value>::type;
     using iterator =
@@ -133,6 +135,11 @@ Value *getOrigin(Value *V);
 /// \returns peels off the layers of tensorviews from a value \p V.
 const Value *getOrigin(const Value *V);
 
+/// \returns the offset, in elements of \p TVI's source, of the first element
+/// of the view from the first element of its origin allocation. Walks through
+/// chains of tensorviews.
+size_t calculateTensorViewOffset(const TensorViewInst *TVI);
+
 } // namespace glow
 
 #endif // GLOW_IR_IRUTILS_H
@@ -0,0 +1,62 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GLOW_IR_MEMORYUSAGE_H
+#define GLOW_IR_MEMORYUSAGE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace glow {
+
+class IRFunction;
+
+/// The lifetime of a single activation buffer, expressed in instruction
+/// indices of the optimized IR.
+struct BufferLifetime {
+  /// Name of the alloc activation that owns the buffer.
+  std::string name;
+  /// Size of the buffer, in bytes.
+  size_t sizeInBytes;
+  /// Index of the instruction that allocates the buffer.
+  size_t allocatedAt;
+  /// Index of the instruction that deallocates the buffer, or the number of
+  /// instructions if the buffer is never deallocated.
+  size_t freedAt;
+};
+
+/// The static memory footprint of a function after IR optimization. All of
+/// the quantities are known exactly at compile time, so capacity planning can
+/// be done without empirically testing models against the available memory.
+struct MemoryUsageReport {
+  /// Bytes of read-only weights.
+  size_t constantWeightBytes{0};
+  /// Bytes of mutable weights (inputs, outputs and trained parameters).
+  size_t mutableWeightBytes{0};
+  /// The high-water mark of concurrently live activation bytes.
+  size_t peakActivationBytes{0};
+  /// The lifetime of every activation buffer, ordered by allocation point.
+  std::vector<BufferLifetime> activationLifetimes;
+};
+
+/// Computes the static memory footprint of \p M: the weight bytes by
+/// mutability, the peak number of concurrently live activation bytes, and
+/// the lifetime of every activation buffer.
+MemoryUsageReport collectMemoryUsage(const IRFunction &M);
+
+} // namespace glow
+
+#endif // GLOW_IR_MEMORYUSAGE_H
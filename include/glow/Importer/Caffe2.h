@@ -30,6 +30,12 @@ class OperatorDef;
 class NetDef;
 } // namespace caffe2
 
+namespace google {
+namespace protobuf {
+class Arena;
+} // namespace protobuf
+} // namespace google
+
 namespace glow {
 
 class Tensor;
@@ -52,9 +58,11 @@ class caffe2ModelLoader
   /// in the network.
   void loadOperator(const caffe2::OperatorDef &op);
 
-  /// Reads a network (weights or structure) from the serialized protocol buffer
-  /// file.
-  bool loadProtoFile(caffe2::NetDef &net, const std::string &filename);
+  /// Reads a network (weights or structure) from the serialized protocol
+  /// buffer file \p filename. The file is memory-mapped and the messages are
+  /// allocated on \p arena, which must outlive the returned network.
+  caffe2::NetDef *loadProtoFile(google::protobuf::Arena &arena,
+                                const std::string &filename);
 
 public:
   /// Loads the caffe2 model that's represented by a network description file,
@@ -47,6 +47,30 @@ protected:
     }
   }
 
+  /// Creates a transpose of \p in by \p shuffle with the name \p name, unless
+  /// \p in is itself a transpose that \p shuffle exactly inverts, in which
+  /// case the pair cancels and the operand of \p in is returned. The NCHW
+  /// operators are imported wrapped in a pair of layout transposes, so on a
+  /// typical convolutional network most of those pairs fold away here at
+  /// load time instead of leaving the work to the graph optimizer.
+  NodeValue createTransposeOrFold(llvm::StringRef name, NodeValue in,
+                                  llvm::ArrayRef<unsigned> shuffle) {
+    auto *TR = llvm::dyn_cast<TransposeNode>(in.getNode());
+    if (TR && TR->getShuffle().size() == shuffle.size()) {
+      bool cancels = true;
+      for (size_t i = 0, e = shuffle.size(); i < e; i++) {
+        if (TR->getShuffle()[shuffle[i]] != i) {
+          cancels = false;
+          break;
+        }
+      }
+      if (cancels) {
+        return TR->getInput();
+      }
+    }
+    return G_.createTranspose(name, in, shuffle);
+  }
+
   /// Loads RELU operator, given its protobuf representation and parsed args.
   void loadRelu(const OpType &op, ArgumentDictionaryTy &dict) {
     const std::string &opName = loadOperatorName(op);
@@ -89,7 +113,7 @@ protected:
     float beta = loadFloat(dict["beta"]);
     float k = loadFloat(dict["bias"]);
 
-    auto *tr = G_.createTranspose(opName, in, NCHW2NHWC);
+    NodeValue tr = createTransposeOrFold(opName, in, NCHW2NHWC);
 
     auto *node = G_.createLocalResponseNormalization(opName, tr, size / 2,
                                                      alpha, beta, k);
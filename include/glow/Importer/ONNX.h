@@ -29,6 +29,7 @@ class AttributeProto;
 class NodeProto;
 class GraphProto;
 class ModelProto;
+class TensorProto;
 } // namespace onnx
 
 namespace glow {
@@ -50,11 +51,25 @@ class ONNXModelLoader
   /// names of the outputs to the save nodes that save each output.
   void setOutputNodes(onnx::GraphProto &net);
 
-  /// Load the network initializers from the GraphProto.
+  /// Register the network initializers from the GraphProto. The payloads are
+  /// not decoded here; each initializer is materialized on first use by
+  /// getTensorByName, so peak load memory is bounded by the largest single
+  /// tensor rather than by the whole model.
   void loadInitializers(onnx::GraphProto &net);
 
-  /// Load the inputs from the GraphProto. This is useful when the
-  /// initializers are not available.
+  /// The initializers that have been registered but not yet materialized,
+  /// by name. The protos are owned by the GraphProto that is being loaded,
+  /// so the map must not outlive the loader constructor.
+  std::unordered_map<std::string, const onnx::TensorProto *>
+      pendingInitializers_;
+
+  /// \returns the tensor registered under \p name, decoding it from its
+  /// initializer proto if this is the first use.
+  Tensor *getTensorByName(llvm::StringRef name) override;
+
+  /// Load the inputs from the GraphProto. Inputs that were not registered as
+  /// weights beforehand become public variables that are bound at run time.
+  /// This is useful when the initializers are not available.
   void loadInputs(onnx::GraphProto &net);
 
   /// \returns true if operator \p op can be loaded.
@@ -100,8 +115,14 @@ public:
   /// \returns unique pointer to ONNXModelLoader if \p onnxModel can be parsed,
   /// e.g., the model is a valid ONNX model and Glow supports all of the
   /// operators in the network. \returns nullptr otherwise.
+  /// The payloads of the weight tensors in \p weightTensors are moved into
+  /// the loader under the names in \p weightNames and are consumed as private
+  /// variables when the network references them. Network inputs that are not
+  /// listed as weights become public variables that can be bound at run time.
   static std::unique_ptr<ONNXModelLoader>
-  parse(const void *onnxModel, size_t onnxModelSize, Function &F);
+  parse(const void *onnxModel, size_t onnxModelSize, Function &F,
+        llvm::ArrayRef<const char *> weightNames = {},
+        llvm::ArrayRef<Tensor *> weightTensors = {});
 };
 
 } // namespace glow
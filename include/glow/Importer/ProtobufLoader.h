@@ -26,6 +26,7 @@
 
 #include <google/protobuf/text_format.h>
 
+#include <functional>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -38,6 +39,11 @@ namespace glow {
 /// Returns true iff all elements of \p a are the same.
 bool isArrayConstant(const llvm::ArrayRef<size_t> a);
 
+/// Run \p fn(i) for every index in [0, \p n) across a temporary pool of
+/// worker threads. The importers use this to materialize independent weight
+/// tensors in parallel; \p fn must not touch shared loader state.
+void parallelForIndices(size_t n, const std::function<void(size_t)> &fn);
+
 /// Prints a single serialized protocol buffer node. This method is useful for
 /// debugging the network and printing errors.
 template <typename T>
@@ -102,7 +108,9 @@ protected:
   std::unordered_map<std::string, SaveNode *> outputsByName_;
 
   /// \returns the tensor that was registered under the name \p name.
-  Tensor *getTensorByName(llvm::StringRef name);
+  /// Loaders that defer the decoding of their weights override this to
+  /// materialize the tensor on first use.
+  virtual Tensor *getTensorByName(llvm::StringRef name);
 
   /// Create a new variable \p name initialized with \p tensor.
   /// \returns The newly created variable.
@@ -18,6 +18,10 @@
 
 #include "llvm/ADT/StringRef.h"
 
+#include <functional>
+#include <string>
+#include <vector>
+
 namespace glow {
 
 class IRFunction;
@@ -30,6 +34,51 @@ enum class CompilationMode {
          /// changes the graph in a way that is not reversible.
 };
 
+/// A single named transformation over a Function. The callback \returns true
+/// when it changed the function.
+struct FunctionPass {
+  /// Name of the pass, used for timing reports.
+  std::string name;
+  /// Runs the pass. \returns true if the function was modified.
+  std::function<bool(Function *)> run;
+};
+
+/// An ordered sequence of graph passes with convergence detection. The
+/// pipeline repeats its pass sequence until an entire iteration reports no
+/// modification, or until the iteration limit is hit.
+class FunctionPassPipeline {
+public:
+  /// Appends the pass \p run under the name \p name.
+  void add(llvm::StringRef name, std::function<bool(Function *)> run);
+
+  /// Runs the pipeline on \p F until a fixpoint is reached.
+  /// \returns true if any pass changed the function.
+  bool run(Function *F) const;
+
+  /// Sets the maximum number of iterations over the pass sequence.
+  void setMaxIterations(unsigned maxIterations) {
+    maxIterations_ = maxIterations;
+  }
+
+private:
+  /// The passes, in execution order.
+  std::vector<FunctionPass> passes_;
+  /// Bound on the number of iterations over the sequence, to guard against
+  /// pass pairs that keep undoing each other's work.
+  unsigned maxIterations_{3};
+};
+
+/// \returns the standard graph optimization pipeline for the compilation
+/// mode \p mode.
+FunctionPassPipeline createDefaultGraphOptimizationPipeline(CompilationMode mode);
+
+/// Registers \p pipeline to be used instead of the default pipeline whenever
+/// a function named \p functionName is optimized, in any compilation mode.
+/// Deployments that recompile a fixed set of models can install a trimmed
+/// pipeline per model this way.
+void registerOptimizationPipeline(llvm::StringRef functionName,
+                                  FunctionPassPipeline pipeline);
+
 /// Perform optimizations on the IR representation.
 void optimize(IRFunction &M, CompilationMode mode, const Backend &B);
 /// Perform optimizations on the graph representation.
@@ -39,6 +88,25 @@ void optimize(Function *F, CompilationMode mode);
 /// operators.
 void lower(Function *F, const Backend &B);
 
+/// Fuses Gather nodes whose only use is a sum over the gathered dimension
+/// into SparseLengthsSum nodes, so the rows are accumulated as they are
+/// gathered and the gathered intermediate is never materialized. Called from
+/// transformPostLowering() by the backends that execute SparseLengthsSum
+/// natively. \returns true if the function was modified.
+bool fuseGatherReduceAdd(Function *F);
+
+/// Converts the payloads of private float weight matrices of \p F that feed
+/// fully-connected or matrix multiplication nodes into the CSR sparse
+/// representation, when at least a fraction \p minSparsity of their elements
+/// is zero. Pruned models become cheaper to store and, on backends with
+/// sparse kernels, to execute. Inference only: the converted weights cannot
+/// be trained.
+void sparsifyWeights(Function *F, float minSparsity = 0.9);
+
+/// Converts all CSR-encoded weights used by \p F back to the dense
+/// representation. This is the fallback for backends without sparse kernels.
+void densifySparseWeights(Function *F);
+
 /// Instrument function \p F by inserting quantization profile nodes
 /// for capturing stats for quantization. The new quantized function is called
 /// \p newFuncName. If no name is given the method will generate a name.
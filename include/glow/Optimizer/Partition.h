@@ -20,12 +20,35 @@
 
 #include <llvm/ADT/DenseMap.h>
 
+#include <vector>
+
 namespace glow {
 
+class Variable;
+
 /// Maps a set of functions to the set of functions it depends on.  The
 /// execution of a function cannot begin until all its dependencies have
 /// executed.
 class FunctionDAG {
+public:
+  /// A pair of variables that carries a value across a partition boundary:
+  /// the \ref producer partition saves into \ref out and the \ref consumer
+  /// partition reads \ref in. The executor of the DAG copies \ref out into
+  /// \ref in between the two partitions. Keeping the two sides distinct
+  /// lets a pipelined executor run the producer's next batch while the
+  /// consumer still reads the previous one.
+  struct Boundary {
+    /// The partition that computes the value.
+    Function *producer;
+    /// The partition that consumes the value.
+    Function *consumer;
+    /// The variable the producer saves into.
+    Variable *out;
+    /// The variable the consumer reads.
+    Variable *in;
+  };
+
+private:
   /// Dependency map type.
   using Map = llvm::DenseMap<Function *, FunctionList>;
 
@@ -38,6 +61,9 @@ class FunctionDAG {
   /// Input dependencies of each function.
   Map dependencies_;
 
+  /// The variable pairs that cross partition boundaries.
+  std::vector<Boundary> boundaries_;
+
 public:
   /// Ctor.
   FunctionDAG(const FunctionList &functions);
@@ -66,6 +92,16 @@ public:
   /// Record that \p F depends on \p inputF.
   void add(Function *F, Function *inputF) { dependencies_[F].push_back(inputF); }
 
+  /// Record a boundary: \p producer saves into \p out and \p consumer reads
+  /// \p in.
+  void addBoundary(Function *producer, Function *consumer, Variable *out,
+                   Variable *in) {
+    boundaries_.push_back({producer, consumer, out, in});
+  }
+
+  /// Get the variable pairs that cross partition boundaries.
+  const std::vector<Boundary> &getBoundaries() const { return boundaries_; }
+
   /// Verify that function graph is well-formed (acyclic, topologically sorted).
   bool verify() const;
 };
@@ -73,6 +109,22 @@ public:
 /// Split an input Function into a FunctionDAG.
 FunctionDAG partition(Function *F);
 
+/// Split an input Function into a FunctionDAG of \p numPartitions functions
+/// with balanced compute. Nodes are assigned by a cost model that estimates
+/// the FLOPs and the bytes moved by every node, and the cut points between
+/// partitions are chosen where the amount of data crossing the boundary is
+/// smallest, so pipelined multi-device execution gets both even load and low
+/// cross-partition Variable traffic.
+FunctionDAG partition(Function *F, unsigned numPartitions);
+
+/// Split an input Function into as few partitions as possible such that the
+/// estimated peak memory footprint of each partition - live activations plus
+/// the weights it touches - fits within \p budgetBytes. This enables
+/// executing models that are larger than a single device's memory. A node
+/// whose footprint alone exceeds the budget still becomes its own partition,
+/// because a node cannot be split.
+FunctionDAG partitionByMemoryBudget(Function *F, uint64_t budgetBytes);
+
 } // namespace glow
 
 #endif // GLOW_OPTIMIZER_PARTITION_H
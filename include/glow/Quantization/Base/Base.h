@@ -19,6 +19,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstdlib>
 #include <limits>
 
@@ -63,14 +64,6 @@ enum Schema {
   Symmetric,
 };
 
-/// Converts floating point value to int8 based on the quantization
-/// parameters \p TQP.
-int8_t quantize(float input, const TensorQuantizationParams &TQP);
-
-/// Converts int8 quantized value back to floating point number based on
-/// the quantization parameters \p TQP.
-float dequantize(int8_t input, const TensorQuantizationParams &TQP);
-
 /// \returns the value \p in as clipped to the range of \p DestTy.
 template <class SrcTy, class DestTy> DestTy clip(SrcTy in) {
   assert(sizeof(SrcTy) >= sizeof(DestTy) && "Invalid types");
@@ -80,6 +73,34 @@ template <class SrcTy, class DestTy> DestTy clip(SrcTy in) {
   return std::max<SrcTy>(mn, std::min<SrcTy>(mx, in));
 }
 
+/// Converts floating point value to the quantized integer representation
+/// \p DestTy based on the quantization parameters \p TQP.
+template <class DestTy = int8_t>
+DestTy quantize(float input, const TensorQuantizationParams &TQP) {
+  float result = input / TQP.scale + TQP.offset;
+  return clip<int32_t, DestTy>((int32_t)nearbyintf(result));
+}
+
+/// Converts a quantized integer value back to floating point number based
+/// on the quantization parameters \p TQP.
+template <class SrcTy = int8_t>
+float dequantize(SrcTy input, const TensorQuantizationParams &TQP) {
+  static_assert(std::numeric_limits<SrcTy>::is_integer,
+                "Can't dequantize a floating point value");
+  return TQP.scale * (input - TQP.offset);
+}
+
+/// Converts \p count floating point values from \p src into int8 values in
+/// \p dest based on the quantization parameters \p TQP. The loop body is
+/// kept free of division so the compiler can vectorize the conversion.
+void quantizeBulk(int8_t *dest, const float *src, size_t count,
+                  const TensorQuantizationParams &TQP);
+
+/// Converts \p count int8 quantized values from \p src back into floating
+/// point values in \p dest based on the quantization parameters \p TQP.
+void dequantizeBulk(float *dest, const int8_t *src, size_t count,
+                    const TensorQuantizationParams &TQP);
+
 /// Convert the floating point quantization parameters \p scale and \p offset
 /// into the integer sequence of:
 /// result = ((input >> pre) * scale) >> post + offset.
@@ -90,9 +111,11 @@ QuantizationTransform32To8 quantizeScaleOffset32To8(float scale,
 
 /// Calculate TensorQuantizationParams based on the clipped \p min and \p max
 /// floating point range and using the quantization method described
-/// by \p schema.
+/// by \p schema. \p precision is the number of bits of the quantized
+/// integer representation (8 for Int8QTy, 16 for Int16QTy).
 TensorQuantizationParams chooseQuantizationParams(float min, float max,
-                                                  Schema schema = Asymmetric);
+                                                  Schema schema = Asymmetric,
+                                                  unsigned precision = 8);
 
 } // namespace quantization
 } // namespace glow
@@ -32,9 +32,25 @@ namespace quantization {
 ///            updated.
 /// \param max max value seen so far, at the end of this method it
 ///            could be updated.
+/// \param sampleStride only every sampleStride-th element of \p inputTensor
+///                     is observed. A stride of one (the default) processes
+///                     the whole tensor; larger strides trade a proportional
+///                     reduction in profiling cost for a subsampled histogram
+///                     with the same shape.
 void generateTensorHistogram(const Handle<float> inputTensor,
                              Handle<float> existingHistogram, float &min,
-                             float &max);
+                             float &max, size_t sampleStride = 1);
+
+/// Merge the histogram \p srcHistogram, which covers the value range
+/// [\p srcMin, \p srcMax], into \p destHistogram, which covers
+/// [\p destMin, \p destMax]. Both histograms must have the same number of
+/// bins. The destination is rescaled to the union of the two ranges and
+/// \p destMin / \p destMax are updated accordingly. This combines the
+/// profiles accumulated by independent calibration workers into a single
+/// profile equivalent to a serial run.
+void mergeTensorHistogram(Handle<float> destHistogram,
+                          const Handle<float> srcHistogram, float &destMin,
+                          float &destMax, float srcMin, float srcMax);
 
 } // namespace quantization
 } // namespace glow
@@ -21,6 +21,13 @@
 
 #include "llvm/ADT/APInt.h"
 
+#include <functional>
+#include <memory>
+
+namespace llvm {
+class MemoryBuffer;
+} // namespace llvm
+
 namespace glow {
 
 /// Serialize \p quantizationInfos into the file named \p fileName.
@@ -30,6 +37,45 @@ void serializeToYaml(llvm::StringRef fileName,
 /// Deserialize quantization infos from the file \p fileName.
 std::vector<NodeQuantizationInfo> deserializeFromYaml(llvm::StringRef fileName);
 
+/// Serialize \p quantizationInfos into the file named \p fileName using the
+/// compact binary profile format. The file is a versioned open-addressing
+/// hash table over the node output names, so a reader can map it and serve
+/// lookups without parsing anything.
+void serializeToBinary(llvm::StringRef fileName,
+                       llvm::ArrayRef<NodeQuantizationInfo> quantizationInfos);
+
+/// Deserialize quantization infos from the binary profile file \p fileName.
+/// The entries are returned in an unspecified order.
+std::vector<NodeQuantizationInfo>
+deserializeFromBinary(llvm::StringRef fileName);
+
+/// A read-only view of a binary quantization profile file. The file stays
+/// memory-mapped for the lifetime of this object and lookups hash directly
+/// into the mapped table, so construction cost is independent of the number
+/// of entries.
+class BinaryQuantizationProfile {
+  /// The mapped (or, for small files, read) contents of the profile file.
+  std::unique_ptr<llvm::MemoryBuffer> buffer_;
+
+public:
+  /// Map the binary profile file \p fileName.
+  explicit BinaryQuantizationProfile(llvm::StringRef fileName);
+  ~BinaryQuantizationProfile();
+
+  /// Look up the quantization parameters of \p nodeOutputName. On success
+  /// stores them into \p params.
+  /// \returns true if the profile contains \p nodeOutputName.
+  bool lookup(llvm::StringRef nodeOutputName,
+              TensorQuantizationParams &params) const;
+
+  /// Invoke \p fn on every entry in the profile, in an unspecified order.
+  void forEach(const std::function<void(llvm::StringRef,
+                                        TensorQuantizationParams)> &fn) const;
+
+  /// \returns the number of entries in the profile.
+  size_t size() const;
+};
+
 } // namespace glow
 
 #endif
@@ -0,0 +1,73 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GLOW_SUPPORT_FASTMATH_H
+#define GLOW_SUPPORT_FASTMATH_H
+
+#include <cstdint>
+#include <cstring>
+
+namespace glow {
+
+/// Fast polynomial approximations of the transcendental functions that
+/// dominate the runtime of recurrent networks. The functions are plain
+/// branch-free arithmetic, so the compiler can inline and vectorize loops
+/// over them, unlike calls into libm. This header is shared between the
+/// interpreter and the CPU backend kernel library and must not depend on
+/// any other Glow header.
+
+/// \returns the single-precision exponential of \p x, computed with the
+/// Cephes polynomial approximation. The result is accurate to about one
+/// ulp; inputs are clamped to the range where the result is a normal
+/// float. This is the scalar twin of the vectorized ExpFloat8 in
+/// libjit_defs.h.
+inline float fastExpf(float x) {
+  x = (x < 88.3762626647949f) ? x : 88.3762626647949f;
+  x = (x > -87.3365478515625f) ? x : -87.3365478515625f;
+
+  // Decompose exp(x) into 2^n * exp(r), where n = round(x * log2(e)) and
+  // |r| <= 0.5 * ln(2).
+  float fx = x * 1.44269504088896341f + 0.5f;
+  float nf = (float)(int32_t)fx;
+  // Truncation rounds towards zero; correct it to round down.
+  nf = (nf > fx) ? nf - 1.0f : nf;
+  // ln(2) is split into two constants so that the reduction is exact.
+  x -= nf * 0.693359375f;
+  x += nf * 2.12194440e-4f;
+
+  float z = x * 1.9875691500e-4f + 1.3981999507e-3f;
+  z = z * x + 8.3334519073e-3f;
+  z = z * x + 4.1665795894e-2f;
+  z = z * x + 1.6666665459e-1f;
+  z = z * x + 5.0000001201e-1f;
+  z = z * x * x + x + 1.0f;
+
+  // Scale by 2^n by constructing the exponent bits directly.
+  int32_t pow2n = ((int32_t)nf + 127) << 23;
+  float scale;
+  memcpy(&scale, &pow2n, sizeof(scale));
+  return z * scale;
+}
+
+/// \returns a fast approximation of the logistic sigmoid of \p x.
+inline float fastSigmoidf(float x) { return 1 / (1 + fastExpf(-x)); }
+
+/// \returns a fast approximation of tanh(\p x), using the same
+/// 1 - 2 / (exp(2x) + 1) formulation as the precise kernels.
+inline float fastTanhf(float x) { return 1 - 2 / (fastExpf(2 * x) + 1); }
+
+} // namespace glow
+
+#endif // GLOW_SUPPORT_FASTMATH_H
@@ -0,0 +1,77 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GLOW_SUPPORT_MAPPEDFILE_H
+#define GLOW_SUPPORT_MAPPEDFILE_H
+
+#include "llvm/ADT/StringRef.h"
+
+#include <cstddef>
+
+namespace glow {
+
+/// A read-only memory mapping of a file. The mapped pages are shared between
+/// all processes that map the same file and are paged in lazily by the OS,
+/// so loading large constant payloads through a mapping costs no copies.
+///
+/// Tensors can alias regions of the mapping through the unowned-payload
+/// Tensor constructor; the mapping must outlive every tensor that refers to
+/// it.
+class MappedFile final {
+  /// The base address of the mapping, or null if nothing is mapped.
+  void *base_{nullptr};
+
+  /// The size of the mapping in bytes.
+  size_t size_{0};
+
+public:
+  MappedFile() = default;
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  MappedFile(MappedFile &&other) noexcept {
+    std::swap(base_, other.base_);
+    std::swap(size_, other.size_);
+  }
+
+  MappedFile &operator=(MappedFile &&other) noexcept {
+    std::swap(base_, other.base_);
+    std::swap(size_, other.size_);
+    return *this;
+  }
+
+  ~MappedFile() { unmap(); }
+
+  /// Map the file \p path read-only. Any previous mapping is released.
+  /// \returns true on success.
+  bool map(llvm::StringRef path);
+
+  /// Release the mapping, if any.
+  void unmap();
+
+  /// \returns the base address of the mapping.
+  char *data() const { return reinterpret_cast<char *>(base_); }
+
+  /// \returns the size of the mapping in bytes.
+  size_t size() const { return size_; }
+
+  /// \returns true if a file is currently mapped.
+  bool isMapped() const { return base_ != nullptr; }
+};
+
+} // end namespace glow
+
+#endif // GLOW_SUPPORT_MAPPEDFILE_H
@@ -18,6 +18,7 @@
 
 #include <cassert>
 #include <cstdlib>
+#include <vector>
 
 namespace glow {
 
@@ -45,6 +46,70 @@ inline size_t alignedSize(size_t size, size_t alignment) {
   return (size + alignment - 1) & ~(alignment - 1);
 }
 
+/// \returns the size of a virtual memory page in bytes.
+size_t getPageSize();
+
+/// Allocate \p size bytes aligned to the virtual memory page size. When
+/// \p pinned is set the pages are locked into physical memory with mlock(),
+/// which allows DMA-speed transfers to devices that can only stream from
+/// non-pageable memory. When \p hugePages is set, transparent huge pages are
+/// requested for the region to cut TLB misses on multi-gigabyte buffers.
+/// Both flags are best-effort: the allocation succeeds even if the runtime
+/// refuses to pin or back the region with huge pages.
+void *pageAlignedAlloc(size_t size, bool pinned = false,
+                       bool hugePages = false);
+
+/// Free memory of \p size bytes allocated with pageAlignedAlloc().
+void pageAlignedFree(void *ptr, size_t size);
+
+/// A slab allocator for small, frequently created compiler objects such as
+/// graph nodes and IR instructions. Objects are carved out of large slabs
+/// bump-pointer style, so objects that are created together are adjacent in
+/// memory and list traversals touch mostly-contiguous addresses. Deleted
+/// objects are recycled through per-size free lists; the slabs themselves
+/// live until the allocator is destroyed.
+class SlabAllocator {
+public:
+  /// Size of the backing slabs.
+  static constexpr size_t slabSize = 256 * 1024;
+  /// Allocation granularity; also the alignment of the returned memory.
+  static constexpr size_t granularity = 16;
+  /// Allocations above this size bypass the slabs and use the system
+  /// allocator directly.
+  static constexpr size_t maxSlabAllocSize = 2048;
+
+  /// \returns a block of at least \p size bytes.
+  void *allocate(size_t size);
+
+  /// Returns the block \p ptr of \p size bytes to the free list.
+  void deallocate(void *ptr, size_t size);
+
+  ~SlabAllocator();
+
+private:
+  /// The slabs that were allocated so far.
+  std::vector<char *> slabs_;
+  /// Next free byte in the newest slab.
+  size_t slabUsed_{slabSize};
+  /// Free lists bucketed by allocation size. The link to the next free block
+  /// is stored in the block itself.
+  void *freeLists_[maxSlabAllocSize / granularity]{};
+};
+
+/// Allocate a tensor payload of \p size bytes, aligned to TensorAlignment.
+/// Small and medium payloads are served from a per-thread size-classed pool
+/// that recycles buffers instead of calling into the system allocator.
+void *allocateTensorPayload(size_t size);
+
+/// Return the payload \p ptr of \p size bytes to the pool, or free it if the
+/// pool is full.
+void deallocateTensorPayload(void *ptr, size_t size);
+
+/// Pre-populate the calling thread's payload pool with \p bytes bytes of
+/// buffers of \p size bytes each, so that subsequent allocations do not hit
+/// the system allocator.
+void reserveTensorPool(size_t size, size_t bytes);
+
 } // end namespace glow
 
 #endif // GLOW_SUPPORT_MEMORY_H
@@ -0,0 +1,91 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GLOW_SUPPORT_PASSSTATS_H
+#define GLOW_SUPPORT_PASSSTATS_H
+
+#include "llvm/ADT/ArrayRef.h"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace llvm {
+class raw_ostream;
+}
+
+namespace glow {
+
+/// Timing and impact statistics for a single execution of an optimization
+/// pass.
+struct PassStat {
+  /// Name of the pass.
+  std::string name;
+  /// Wall time spent in the pass, in seconds.
+  double seconds;
+  /// Number of compilation units (graph nodes or IR instructions) before the
+  /// pass ran.
+  int64_t unitsBefore;
+  /// Number of compilation units after the pass ran.
+  int64_t unitsAfter;
+};
+
+/// \returns true if pass statistics collection is enabled via the
+/// '-glow-pass-stats' command line option.
+bool passStatsEnabled();
+
+/// \returns the statistics collected since the last call to clearPassStats().
+llvm::ArrayRef<PassStat> getPassStats();
+
+/// Discards the collected statistics.
+void clearPassStats();
+
+/// Prints the collected statistics to \p os as one comma-separated line per
+/// pass: name, seconds, units before, units after.
+void dumpPassStats(llvm::raw_ostream &os);
+
+/// Times the execution of a single pass. When collection is enabled the
+/// destructor records a PassStat with the elapsed wall time and the
+/// compilation unit counts reported by \p countUnits before and after the
+/// pass.
+class ScopedPassTimer {
+public:
+  ScopedPassTimer(const char *name, std::function<int64_t()> countUnits);
+  ~ScopedPassTimer();
+
+private:
+  /// Name of the timed pass.
+  const char *name_;
+  /// Counts the compilation units of the function being optimized.
+  std::function<int64_t()> countUnits_;
+  /// Unit count when the pass started.
+  int64_t unitsBefore_;
+  /// Time when the pass started.
+  std::chrono::steady_clock::time_point start_;
+};
+
+/// Macro to run the statement \p X as a timed pass named \p NAME. The
+/// callable \p COUNT reports the number of compilation units of the function
+/// being optimized.
+#define GLOW_TIMED_PASS(NAME, COUNT, X)                                        \
+  do {                                                                         \
+    glow::ScopedPassTimer scopedPassTimer(NAME, COUNT);                        \
+    X;                                                                         \
+  } while (false)
+
+} // namespace glow
+
+#endif // GLOW_SUPPORT_PASSSTATS_H
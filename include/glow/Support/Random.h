@@ -16,10 +16,55 @@
 #ifndef GLOW_SUPPORT_RANDOM_H
 #define GLOW_SUPPORT_RANDOM_H
 
+#include <cstdint>
 #include <random>
 
 namespace glow {
 
+/// A fast pseudo-random number generator (xoshiro256++) for bulk tensor
+/// initialization. Unlike PseudoRNG it is cheap to construct, so independent
+/// deterministic streams can be created per thread or per chunk of work. The
+/// stream passed to the constructor is mixed with the global
+/// "-pseudo-random-seed" value, so two generators with different streams
+/// produce uncorrelated sequences while the whole program stays
+/// deterministic.
+class FastPRNG {
+  uint64_t s_[4];
+
+  static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+public:
+  explicit FastPRNG(uint64_t stream = 0);
+
+  /// \returns the next pseudo-random 64 bit number.
+  uint64_t next() {
+    const uint64_t result = rotl(s_[0] + s_[3], 23) + s_[0];
+    const uint64_t t = s_[1] << 17;
+    s_[2] ^= s_[0];
+    s_[3] ^= s_[1];
+    s_[1] ^= s_[2];
+    s_[0] ^= s_[3];
+    s_[2] ^= t;
+    s_[3] = rotl(s_[3], 45);
+    return result;
+  }
+
+  /// \returns a pseudo-random float from the half-open range [\p low, \p
+  /// high), built from the top 24 bits of the next number.
+  float nextFloat(float low, float high) {
+    float unit = (next() >> 40) * (1.0f / 16777216.0f);
+    return low + unit * (high - low);
+  }
+};
+
+/// Fills \p data with \p size uniformly distributed floats from [\p low, \p
+/// high). The array is processed in fixed-size chunks, each drawn from its
+/// own FastPRNG stream derived from \p stream, so the result is deterministic
+/// and independent of the number of threads used; large arrays are filled in
+/// parallel.
+void fillUniform(float *data, size_t size, float low, float high,
+                 uint64_t stream = 0);
+
 /// A pseudo-random number generator.
 ///
 /// A PseudoRNG generates a deterministic sequence of numbers controlled by the
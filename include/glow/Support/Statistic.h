@@ -0,0 +1,85 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GLOW_SUPPORT_STATISTIC_H
+#define GLOW_SUPPORT_STATISTIC_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace llvm {
+class raw_ostream;
+}
+
+namespace glow {
+
+/// \returns true if statistics collection is enabled via the '-glow-stats'
+/// command line option.
+bool statisticsEnabled();
+
+/// A named counter that quantifies the work done by an optimization, in the
+/// style of LLVM's Statistic. Define counters with the GLOW_STATISTIC macro
+/// and bump them where the optimization fires; when '-glow-stats' is off the
+/// increment is a single predictable branch. Enabled counters are printed by
+/// dumpStatistics() at the end of each compilation.
+class Statistic {
+  /// The DEBUG_TYPE of the file defining the counter.
+  const char *debugType_;
+  /// Name of the counter.
+  const char *name_;
+  /// One-line description of what is being counted.
+  const char *desc_;
+  /// The value of the counter.
+  std::atomic<uint64_t> value_{0};
+  /// True once the counter is linked into the global registry.
+  std::atomic<bool> registered_{false};
+
+  /// Links the counter into the global registry the first time it fires.
+  void registerStatistic();
+
+public:
+  Statistic(const char *debugType, const char *name, const char *desc)
+      : debugType_(debugType), name_(name), desc_(desc) {}
+
+  const char *getDebugType() const { return debugType_; }
+  const char *getName() const { return name_; }
+  const char *getDesc() const { return desc_; }
+  uint64_t getValue() const { return value_.load(std::memory_order_relaxed); }
+
+  Statistic &operator+=(uint64_t v) {
+    if (statisticsEnabled()) {
+      if (!registered_.load(std::memory_order_acquire)) {
+        registerStatistic();
+      }
+      value_.fetch_add(v, std::memory_order_relaxed);
+    }
+    return *this;
+  }
+
+  Statistic &operator++() { return *this += 1; }
+};
+
+/// Prints all counters that fired to \p os, grouped by debug type, as
+/// "<value> <debug-type> - <description>" lines.
+void dumpStatistics(llvm::raw_ostream &os);
+
+/// Define a statistics counter named \p VARNAME, reported under the current
+/// DEBUG_TYPE with the description \p DESC.
+#define GLOW_STATISTIC(VARNAME, DESC)                                          \
+  static glow::Statistic VARNAME(DEBUG_TYPE, #VARNAME, DESC)
+
+} // namespace glow
+
+#endif // GLOW_SUPPORT_STATISTIC_H
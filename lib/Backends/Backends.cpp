@@ -17,12 +17,27 @@
 #include "glow/Backends/Backend.h"
 #include "glow/Graph/Graph.h"
 #include "glow/Graph/Nodes.h"
+#include "glow/IR/IR.h"
 #include "glow/IR/Instrs.h"
 
 #include "llvm/Support/Casting.h"
 
 using namespace glow;
 
+std::unique_ptr<CompiledFunction>
+Backend::compile(std::unique_ptr<IRFunction> IR,
+                 unsigned deviceAffinity) const {
+  (void)deviceAffinity;
+  return compile(std::move(IR));
+}
+
+void Backend::save(std::vector<std::unique_ptr<IRFunction>> IRs,
+                   llvm::StringRef outputDir) const {
+  for (auto &IR : IRs) {
+    save(std::move(IR), outputDir);
+  }
+}
+
 namespace glow {
 /// NOTE: Please add a declaration of a backend-specific `create` method here
 /// when you define a new backend.
@@ -42,10 +57,13 @@ Backend *createCPUBackend() {
 #if defined(GLOW_WITH_OPENCL)
 /// Create a new instance of the OpenCL backend.
 Backend *createOCLBackend();
+/// \returns true if the OpenCL backend has a usable device.
+bool isOCLBackendAvailable();
 #else
 Backend *createOCLBackend() {
   GLOW_UNREACHABLE("Must compile with OpenCL support");
 }
+bool isOCLBackendAvailable() { return false; }
 #endif
 } // namespace glow
 
@@ -63,3 +81,20 @@ Backend *glow::createBackend(BackendKind backendKind) {
   // always covers all possible values.
   llvm_unreachable("unreachable");
 }
+
+bool glow::isBackendAvailable(BackendKind backendKind) {
+  switch (backendKind) {
+  case BackendKind::Interpreter:
+    return true;
+  case BackendKind::OpenCL:
+    return isOCLBackendAvailable();
+  case BackendKind::CPU:
+#if defined(GLOW_WITH_CPU)
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  llvm_unreachable("unreachable");
+}
@@ -24,6 +24,8 @@
 #include "glow/Support/Debug.h"
 
 #include "llvm/Support/Debug.h"
+
+#include <vector>
 #include "llvm/Support/raw_ostream.h"
 
 using namespace glow;
@@ -31,41 +33,47 @@ using llvm::cast;
 using llvm::dyn_cast;
 using llvm::isa;
 
-void AllocationsInfo::allocateWeightVars(const IRFunction *F,
-                                         bool reuseAddresses) {
+void ModuleWeightLayout::assignOffsets(const Module &M) {
   // Use two different allocators, because constant weights and mutable weights
   // may use different memory blocks.
-  MemoryAllocator constantWeightVarsAllocator(0);
-  MemoryAllocator mutableWeightVarsAllocator(0);
-
-  // Compute the new offsets for all the weights, do not reuse their current
-  // addresses. Process all constant WeightVars first.
-  for (auto &v : F->getGraph()->getParent()->getVars()) {
-    assert(isa<WeightVar>(F->getWeightForNode(v)));
-    auto *w = cast<WeightVar>(F->getWeightForNode(v));
-    if (v->getVisibilityKind() == VisibilityKind::Public)
+  for (auto &v : M.getVars()) {
+    if (varOffsets_.count(v)) {
+      // The variable was placed by an earlier call; keep its offset so that
+      // functions already compiled against this layout stay valid.
       continue;
-    auto numBytes = w->getSizeInBytes();
-    size_t addr = constantWeightVarsAllocator.allocate(numBytes);
-    if (!reuseAddresses) {
-      allocatedAddressed_[w] = addr;
+    }
+    auto numBytes = v->getType()->getSizeInBytes();
+    if (v->getVisibilityKind() == VisibilityKind::Public) {
+      varOffsets_[v] = mutableWeightVarsAllocator_.allocate(numBytes);
     } else {
-      // Reuse the address used by the payload.
-      allocatedAddressed_[w] =
-          v->getPayload().getUnsafePtr() - static_cast<char *>(nullptr);
+      varOffsets_[v] = constantWeightVarsAllocator_.allocate(numBytes);
     }
   }
 
-  // Process all mutable WeightVars afterwards.
+  // Remember the max required memory size for each kind of weights.
+  constantWeightVarsMemSize_ = constantWeightVarsAllocator_.getMaxMemoryUsage();
+  mutableWeightVarsMemSize_ = mutableWeightVarsAllocator_.getMaxMemoryUsage();
+}
+
+void AllocationsInfo::allocateWeightVars(const IRFunction *F,
+                                         const ModuleWeightLayout &layout,
+                                         bool reuseAddresses) {
+  // Map the WeightVars of this function to the offsets that the module-level
+  // layout assigned to their variables. The layout does not depend on the
+  // function, so every function compiled from the module addresses the same
+  // single copy of the weights.
   for (auto &v : F->getGraph()->getParent()->getVars()) {
-    assert(isa<WeightVar>(F->getWeightForNode(v)));
-    auto *w = cast<WeightVar>(F->getWeightForNode(v));
-    if (v->getVisibilityKind() != VisibilityKind::Public)
+    auto *w = llvm::dyn_cast_or_null<WeightVar>(F->getWeightForNode(v));
+    if (!w) {
+      // The variable is not used by this function, e.g. it belongs only to
+      // the float original of a quantized function.
       continue;
-    auto numBytes = w->getSizeInBytes();
-    size_t addr = mutableWeightVarsAllocator.allocate(numBytes);
+    }
     if (!reuseAddresses) {
-      allocatedAddressed_[w] = addr;
+      auto offset = layout.varOffsets_.find(v);
+      assert(offset != layout.varOffsets_.end() &&
+             "Variable was not placed by the module weight layout");
+      allocatedAddressed_[w] = offset->second;
     } else {
       // Reuse the address used by the payload.
       allocatedAddressed_[w] =
@@ -73,9 +81,9 @@ void AllocationsInfo::allocateWeightVars(const IRFunction *F,
     }
   }
 
-  // Remember that max required memory size for each kind of weights.
-  constantWeightVarsMemSize_ = constantWeightVarsAllocator.getMaxMemoryUsage();
-  mutableWeightVarsMemSize_ = mutableWeightVarsAllocator.getMaxMemoryUsage();
+  // Remember the arena sizes computed by the module-level layout.
+  constantWeightVarsMemSize_ = layout.constantWeightVarsMemSize_;
+  mutableWeightVarsMemSize_ = layout.mutableWeightVarsMemSize_;
 
   DEBUG_GLOW(for (auto &A
                   : allocatedAddressed_) {
@@ -100,32 +108,33 @@ void AllocationsInfo::allocateActivations(const IRFunction *F) {
   // allocate.
   MemoryAllocator activationsAllocator(0);
 
-  // Maps activations and views to some offset within the heap.
-  llvm::DenseMap<const Value *, size_t> activationAddr;
-
-  // Assign device-space addresses to the activations.
+  // The full live interval of every activation is known before execution, so
+  // the buffers can be packed offline instead of placed one by one in
+  // allocation order.
+  std::vector<OfflineAllocation> buffers;
+  llvm::DenseMap<const Value *, size_t> bufferIdx;
+  size_t instrIdx = 0;
   for (const auto &I : F->getInstrs()) {
     if (auto *A = dyn_cast<AllocActivationInst>(&I)) {
-      auto numBytes = I.getSizeInBytes();
-      size_t addr = activationsAllocator.allocate(numBytes);
-      assert(!activationAddr.count(A) && "Allocation already made!");
-      activationAddr[A] = addr;
-      continue;
-    }
-
-    if (auto *D = dyn_cast<DeallocActivationInst>(&I)) {
+      assert(!bufferIdx.count(A) && "Allocation already made!");
+      bufferIdx[A] = buffers.size();
+      buffers.push_back({A->getSizeInBytes(), instrIdx, F->getInstrs().size(),
+                         MemoryAllocator::npos});
+    } else if (auto *D = dyn_cast<DeallocActivationInst>(&I)) {
       auto *A = D->getAlloc();
-      assert(activationAddr.count(A) && "Invalid deallocation!");
-      activationsAllocator.deallocate(activationAddr[A]);
-      continue;
+      assert(bufferIdx.count(A) && "Invalid deallocation!");
+      buffers[bufferIdx[A]].end = instrIdx;
     }
+    instrIdx++;
   }
 
-  activationsMemSize_ = activationsAllocator.getMaxMemoryUsage();
+  activationsMemSize_ = activationsAllocator.allocateAll(buffers);
+  assert(activationsMemSize_ != MemoryAllocator::npos &&
+         "Could not pack the activations");
 
   // Register specific addresses within the heap to activations.
-  for (auto &A : activationAddr) {
-    allocatedAddressed_[A.first] = A.second;
+  for (auto &A : bufferIdx) {
+    allocatedAddressed_[A.first] = buffers[A.second].offset;
   }
   DEBUG_GLOW(for (auto &A
                   : allocatedAddressed_) {
@@ -147,15 +156,9 @@ void AllocationsInfo::allocateTensorViews(const IRFunction *F) {
              "TensorView.");
       size_t originAddr = allocatedAddressed_[viewOrigin];
 
-      // Calculate and store the length of the offset into the base, using the
-      // source of the tensorview.
-      size_t offsetLength = A->getOffsets().empty() ? 0 : A->getOffsets()[0];
-      auto *tvSource = A->getSrc();
-      if (tvSource->dims().size() > 1) {
-        for (size_t i = 1; i < tvSource->dims().size(); ++i) {
-          offsetLength *= tvSource->dims()[i];
-        }
-      }
+      // Calculate the offset of the view from the start of its origin
+      // allocation, in elements, accumulated over the whole tensorview chain.
+      size_t offsetLength = calculateTensorViewOffset(A);
       assert(!allocatedAddressed_.count(A) && "Allocation already made!");
       allocatedAddressed_[A] =
           originAddr + (offsetLength * A->getType()->getElementSize());
@@ -168,8 +171,11 @@ void AllocationsInfo::numberValues(const IRFunction *F) {
   size_t valueIdx = 0;
   // Assign numbers to all weights.
   for (auto &v : F->getGraph()->getParent()->getVars()) {
-    assert(isa<WeightVar>(F->getWeightForNode(v)));
-    auto *w = cast<WeightVar>(F->getWeightForNode(v));
+    auto *w = llvm::dyn_cast_or_null<WeightVar>(F->getWeightForNode(v));
+    if (!w) {
+      // Skip the variables that this function does not use.
+      continue;
+    }
     auto kind = v->getVisibilityKind() != VisibilityKind::Public
                     ? ValueKind::ConstantWeight
                     : ValueKind::MutableWeight;
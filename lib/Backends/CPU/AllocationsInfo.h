@@ -16,6 +16,8 @@
 #ifndef GLOW_BACKENDS_CPU_ALLOCATIONSINFO_H
 #define GLOW_BACKENDS_CPU_ALLOCATIONSINFO_H
 
+#include "glow/CodeGen/MemoryAllocator.h"
+
 #include "llvm/IR/Module.h"
 
 #include <functional>
@@ -23,9 +25,35 @@
 namespace glow {
 class Value;
 class IRFunction;
+class Module;
 class WeightVar;
 class Variable;
 
+/// Module-level layout of the weight arenas. The offsets depend only on the
+/// variables of the module, not on any particular function, so the layout is
+/// computed once and shared by every compiled function. Several entry points
+/// built from the same module (e.g. the inference and training versions of a
+/// model) then address a single copy of the weights.
+struct ModuleWeightLayout {
+  /// Maps every variable of the module to its offset in the arena of its
+  /// mutability kind.
+  llvm::DenseMap<const Variable *, size_t> varOffsets_;
+  /// Amount of memory required for all constant WeightVars.
+  size_t constantWeightVarsMemSize_{0};
+  /// Amount of memory required for all mutable WeightVars.
+  size_t mutableWeightVarsMemSize_{0};
+  /// The allocators for the two arenas. They are kept alive so that the
+  /// layout can be extended later without moving anything.
+  MemoryAllocator constantWeightVarsAllocator_{0};
+  MemoryAllocator mutableWeightVarsAllocator_{0};
+
+  /// Assigns arena offsets to the variables of \p M that do not have one
+  /// yet. Variables placed by an earlier call keep their offsets, so
+  /// functions that were already compiled against this layout stay valid
+  /// when the module grows, e.g. when differentiation adds new variables.
+  void assignOffsets(const Module &M);
+};
+
 /// Information about allocations for activations, constant weight variables
 /// and mutable weight variables.
 struct AllocationsInfo {
@@ -52,12 +80,14 @@ struct AllocationsInfo {
   /// Base address of activations.
   uint8_t *baseActivationsAddress_{nullptr};
 
-  /// Assign offsets to all WeightVars of \p M.
+  /// Assign offsets to all WeightVars of \p F.
   /// If the \p reuseAddresses is true, simply reuse the addresses already used
   /// by the payloads of tensors corresponding to those WeightVars as offsets.
-  /// This is useful in a JIT setup. If \p reuseAddresses is false, then all the
-  /// WeightVars will get new offsets assigned.
-  void allocateWeightVars(const IRFunction *F, bool reuseAddresses);
+  /// This is useful in a JIT setup. If \p reuseAddresses is false, the
+  /// WeightVars get the offsets that \p layout assigned to their variables,
+  /// so that all functions of the module share one weight arena.
+  void allocateWeightVars(const IRFunction *F, const ModuleWeightLayout &layout,
+                          bool reuseAddresses);
   /// Assign offsets to all activations.
   /// No actual memory allocation is performed. All the allocations should be
   /// performed by the client based on the information provided by the
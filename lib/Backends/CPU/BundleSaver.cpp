@@ -18,67 +18,197 @@
 #include "BundleSaver.h"
 
 #include "CPUBackend.h"
+#include "CommandLine.h"
 
 #include "glow/Graph/Graph.h"
 #include "glow/IR/Instrs.h"
 #include "glow/Support/Debug.h"
 
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/Linker/Linker.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Support/Casting.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Compression.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Error.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <vector>
+
 using namespace glow;
 using llvm::cast;
 using llvm::dyn_cast;
 using llvm::isa;
 
-BundleSaver::BundleSaver(const IRFunction *F)
-    : F_(F), irgen_(F_, allocationsInfo_, "") {}
+static llvm::cl::opt<bool> bundleCompressWeights(
+    "bundle-compress-weights",
+    llvm::cl::desc("Emit the bundle weights as a chunked, zlib-compressed "
+                   "file with an index, so that the client can map it and "
+                   "decompress chunks lazily on first use"),
+    llvm::cl::init(false), llvm::cl::cat(CPUBackendCat));
+
+static llvm::cl::opt<bool> bundleEmbedWeights(
+    "bundle-embed-weights",
+    llvm::cl::desc("Emit the constant weights into a read-only data section "
+                   "of the bundle object file instead of a separate weights "
+                   "file. The bundle becomes a single self-contained "
+                   "artifact, and the OS loader demand-pages the weights and "
+                   "shares them across processes"),
+    llvm::cl::init(false), llvm::cl::cat(CPUBackendCat));
+
+namespace {
+/// On-disk header of a chunked bundle weights file. The header is followed by
+/// \p numChunks WeightsFileChunk index entries and then by the chunk payloads
+/// in index order. Old-style weights files contain the raw weights payload
+/// instead and are told apart by the missing magic. The loader side of this
+/// format lives in the bundle examples.
+struct WeightsFileHeader {
+  /// Identifies the chunked weights file format.
+  char magic[8];
+  /// Total size of the constant weights memory area after decompression.
+  uint64_t uncompressedSize;
+  /// Size of each chunk before compression. The last chunk may be shorter.
+  uint64_t chunkSize;
+  /// Number of chunks in the file.
+  uint64_t numChunks;
+};
+
+/// On-disk index entry describing the location of one chunk.
+struct WeightsFileChunk {
+  /// Offset of the chunk payload from the beginning of the file.
+  uint64_t offset;
+  /// Size of the chunk payload in the file.
+  uint64_t size;
+  /// Nonzero if the payload is zlib-compressed.
+  uint64_t compressed;
+};
+
+const char weightsFileMagic[8] = {'G', 'l', 'o', 'w', 'W', 't', 's', '1'};
+
+/// Chunks are sized as a multiple of the page size, so that a loader that maps
+/// the decompressed image can fill in and protect each chunk independently.
+constexpr uint64_t weightsFileChunkSize = 1 << 20;
+} // namespace
+
+BundleSaver::SavedFunction::SavedFunction(const IRFunction *F)
+    : F(F), irgen(llvm::make_unique<LLVMIRGen>(F, allocationsInfo, "")) {}
+
+BundleSaver::BundleSaver(const IRFunction *F, const ModuleWeightLayout &layout)
+    : BundleSaver(llvm::makeArrayRef(&F, 1), layout) {}
+
+BundleSaver::BundleSaver(llvm::ArrayRef<const IRFunction *> Fs,
+                         const ModuleWeightLayout &layout)
+    : weightLayout_(layout) {
+  GLOW_ASSERT(!Fs.empty() && "A bundle needs at least one entry point");
+  for (auto *F : Fs) {
+    GLOW_ASSERT(F->getGraph()->getParent() ==
+                    Fs.front()->getGraph()->getParent() &&
+                "All entry points of a bundle must come from one module");
+    funcs_.emplace_back(F);
+  }
+}
+
+std::vector<char> BundleSaver::serializeConstantWeights() {
+  // Serialize only constant weights into an in-memory image of the constant
+  // weights area. Do not serialize mutable weights representing inputs and
+  // outputs, because it should be configurable and set by the client. The
+  // image is sized by the module-level layout to properly handle alignments,
+  // and every entry point addresses its weights inside this single image.
+  std::vector<char> image(weightLayout_.constantWeightVarsMemSize_, 0);
+  llvm::SmallPtrSet<const Variable *, 16> written;
+  for (auto &SF : funcs_) {
+    for (auto &v : SF.F->getGraph()->getParent()->getVars()) {
+      auto *w = llvm::dyn_cast_or_null<WeightVar>(SF.F->getWeightForNode(v));
+      if (!w) {
+        // The variable is not used by this entry, e.g. it belongs only to
+        // the float original of a quantized function.
+        continue;
+      }
+      if (v->getVisibilityKind() == VisibilityKind::Public)
+        continue;
+      if (!written.insert(v).second) {
+        // The variable was serialized already for an earlier entry.
+        continue;
+      }
+      auto numBytes = w->getSizeInBytes();
+      auto payload = v->getPayload().getUnsafePtr();
+      auto addr = weightLayout_.varOffsets_.lookup(v);
+      memcpy(&image[addr], payload, numBytes);
+    }
+  }
+  return image;
+}
 
 void BundleSaver::saveWeights(llvm::StringRef weightsFileName) {
   std::error_code EC;
   llvm::raw_fd_ostream weightsFile(weightsFileName, EC, llvm::sys::fs::F_None);
   GLOW_ASSERT(!EC &&
               "Could not open the output file for saving the bundle weights");
-  // Serialize only constant weights.
-  // Do not serialize mutable weights representing inputs and outputs, because
-  // it should be configurable and set by the client.
-  size_t pos = 0;
-  size_t maxPos = 0;
-  for (auto &v : F_->getGraph()->getParent()->getVars()) {
-    auto *w = cast<WeightVar>(F_->getWeightForNode(v));
-    if (v->getVisibilityKind() == VisibilityKind::Public)
-      continue;
-    auto numBytes = w->getSizeInBytes();
-    auto payload = v->getPayload().getUnsafePtr();
-    auto addr = allocationsInfo_.allocatedAddressed_[w];
-    if (addr < pos) {
-      // The payload was written already. It aliases something we have seen
-      // already.
-      continue;
+  std::vector<char> image = serializeConstantWeights();
+
+  if (!bundleCompressWeights) {
+    // Emit the classic format: one raw binary blob that the client loads
+    // directly into the constant weights area.
+    weightsFile.write(image.data(), image.size());
+    weightsFile.close();
+    return;
+  }
+
+  // Emit the chunked format. Each chunk is compressed independently, so the
+  // client can map the file and decompress only the chunks it touches.
+  uint64_t numChunks =
+      (image.size() + weightsFileChunkSize - 1) / weightsFileChunkSize;
+  WeightsFileHeader header;
+  memcpy(header.magic, weightsFileMagic, sizeof(header.magic));
+  header.uncompressedSize = image.size();
+  header.chunkSize = weightsFileChunkSize;
+  header.numChunks = numChunks;
+  std::vector<WeightsFileChunk> index(numChunks);
+  std::vector<llvm::SmallVector<char, 0>> payloads(numChunks);
+  uint64_t offset =
+      sizeof(WeightsFileHeader) + numChunks * sizeof(WeightsFileChunk);
+  for (uint64_t c = 0; c < numChunks; c++) {
+    uint64_t begin = c * weightsFileChunkSize;
+    uint64_t size = std::min<uint64_t>(weightsFileChunkSize,
+                                       image.size() - begin);
+    llvm::StringRef chunk(image.data() + begin, size);
+    auto &payload = payloads[c];
+    bool isCompressed = false;
+    if (llvm::zlib::isAvailable()) {
+      if (auto err = llvm::zlib::compress(chunk, payload)) {
+        llvm::consumeError(std::move(err));
+        payload.clear();
+      } else {
+        // Keep the chunk compressed only when compression actually shrinks
+        // it; high-entropy weights may not compress at all.
+        isCompressed = payload.size() < size;
+      }
+    }
+    if (!isCompressed) {
+      payload.assign(chunk.begin(), chunk.end());
     }
-    weightsFile.seek(addr);
-    weightsFile.write(payload, numBytes);
-    pos = addr + numBytes;
-    maxPos = std::max(pos, maxPos);
+    index[c].offset = offset;
+    index[c].size = payload.size();
+    index[c].compressed = isCompressed;
+    offset += payload.size();
   }
-  // Make sure that the file is as long as the constantWeightVarsMemSize_.
-  // This is needed to properly handle alignments.
-  weightsFile.seek(maxPos);
-  for (size_t endPos = irgen_.getAllocationsInfo().constantWeightVarsMemSize_;
-       maxPos < endPos; maxPos++) {
-    weightsFile.write(0);
+  weightsFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  weightsFile.write(reinterpret_cast<const char *>(index.data()),
+                    numChunks * sizeof(WeightsFileChunk));
+  for (uint64_t c = 0; c < numChunks; c++) {
+    weightsFile.write(payloads[c].data(), payloads[c].size());
   }
   weightsFile.close();
 }
 
-void BundleSaver::emitSymbolTable() {
+void BundleSaver::emitSymbolTable(SavedFunction &SF) {
+  auto &irgen = *SF.irgen;
   // Define a struct for symbol table entries:
   // struct SymbolTableEntry {
   //  const char *name;
@@ -86,27 +216,31 @@ void BundleSaver::emitSymbolTable() {
   //  size_t size;
   //  char kind;
   // };
-  auto *charTy = llvm::Type::getInt8Ty(irgen_.getLLVMContext());
+  auto *charTy = llvm::Type::getInt8Ty(irgen.getLLVMContext());
   auto *sizeTTy =
-      llvm::Type::getIntNTy(irgen_.getLLVMContext(), sizeof(size_t) * 8);
+      llvm::Type::getIntNTy(irgen.getLLVMContext(), sizeof(size_t) * 8);
   auto symbolTableEntryTy =
-      llvm::StructType::get(irgen_.getLLVMContext(),
+      llvm::StructType::get(irgen.getLLVMContext(),
                             {charTy->getPointerTo(), sizeTTy, sizeTTy, charTy});
   // Set of entries in the symbol table.
   llvm::SmallVector<llvm::Constant *, 128> entries;
   // Iterate over all weights and record information about their names, offset,
   // size and kind.
-  for (auto &v : F_->getGraph()->getParent()->getVars()) {
-    auto *w = cast<WeightVar>(F_->getWeightForNode(v));
+  for (auto &v : SF.F->getGraph()->getParent()->getVars()) {
+    auto *w = llvm::dyn_cast_or_null<WeightVar>(SF.F->getWeightForNode(v));
+    if (!w) {
+      // Skip the variables that the saved function does not use.
+      continue;
+    }
     bool isConstWeight = v->getVisibilityKind() != VisibilityKind::Public;
     auto size = w->getType()->size();
-    auto addr = allocationsInfo_.allocatedAddressed_[w];
+    auto addr = SF.allocationsInfo.allocatedAddressed_[w];
     // Create an SymbolTableEntry.
     auto *entry = llvm::ConstantStruct::get(
         symbolTableEntryTy,
         {// name.
-         dyn_cast<llvm::Constant>(irgen_.getBuilder().CreateBitCast(
-             irgen_.emitStringConst(irgen_.getBuilder(), w->getName()),
+         dyn_cast<llvm::Constant>(irgen.getBuilder().CreateBitCast(
+             irgen.emitStringConst(irgen.getBuilder(), w->getName()),
              charTy->getPointerTo())),
          // offset.
          llvm::ConstantInt::get(sizeTTy, addr),
@@ -121,19 +255,55 @@ void BundleSaver::emitSymbolTable() {
   auto *arr = llvm::ConstantArray::get(
       llvm::ArrayType::get(symbolTableEntryTy, entries.size()), entries);
   // Create a global variable and initialize it with the constructed array.
-  new llvm::GlobalVariable(irgen_.getModule(), arr->getType(), true,
+  new llvm::GlobalVariable(irgen.getModule(), arr->getType(), true,
                            llvm::GlobalValue::InternalLinkage, arr,
-                           irgen_.getMainEntryName() + "SymbolTable");
+                           irgen.getMainEntryName() + "SymbolTable");
+}
+
+void BundleSaver::emitConstantWeights() {
+  // The weights land in the module of the first entry, which every bundle
+  // object is linked into.
+  auto &irgen = *funcs_.front().irgen;
+  std::vector<char> image = serializeConstantWeights();
+  // Emit the image as an external constant global, so that it lands in a
+  // read-only data section of the object file. The client passes its address
+  // to the entry function instead of loading a weights file: the OS loader
+  // pages the weights in on first touch and shares the pages between all
+  // processes running the bundle.
+  auto *init = llvm::ConstantDataArray::get(
+      irgen.getLLVMContext(),
+      llvm::makeArrayRef(reinterpret_cast<const uint8_t *>(image.data()),
+                         image.size()));
+  auto *weights = new llvm::GlobalVariable(
+      irgen.getModule(), init->getType(), /* isConst */ true,
+      llvm::GlobalValue::ExternalLinkage, init,
+      irgen.getMainEntryName() + "_constantWeights");
+  // The kernels expect the weights base to be aligned like tensor payloads.
+  weights->setAlignment(TensorAlignment);
 }
 
 void BundleSaver::produceBundle(llvm::StringRef outputDir) {
-  // Emit the symbol table for weight variables.
-  emitSymbolTable();
-  // Emit the config for the bundle.
-  emitBundleConfig();
+  // Emit the symbol table and the config for every entry point.
+  for (auto &SF : funcs_) {
+    emitSymbolTable(SF);
+    emitBundleConfig(SF);
+  }
+  // Optionally embed the constant weights into the object itself.
+  if (bundleEmbedWeights) {
+    emitConstantWeights();
+  }
 
-  auto &M = irgen_.getModule();
-  auto bundleName = irgen_.getMainEntryName();
+  auto &irgen = *funcs_.front().irgen;
+  auto &M = irgen.getModule();
+  // Link the modules of the other entry points into the module of the first
+  // one, so that the bundle is a single object with one entry symbol per
+  // saved function, all addressing one copy of the weights.
+  llvm::Linker linker(M);
+  for (auto it = std::next(funcs_.begin()), e = funcs_.end(); it != e; ++it) {
+    bool failed = linker.linkInModule(it->irgen->borrowModule());
+    GLOW_ASSERT(!failed && "Could not link the module of a bundle entry");
+  }
+  auto bundleName = irgen.getMainEntryName();
   auto bundleCodeOutput = (outputDir + "/" + bundleName + ".o").str();
   auto bundleWeightsOutput = (outputDir + "/" + bundleName + ".weights").str();
   DEBUG_GLOW(llvm::outs() << "Producing a bundle:\n"
@@ -155,14 +325,16 @@ void BundleSaver::produceBundle(llvm::StringRef outputDir) {
   } else if (fileName.endswith(".o")) {
     // Emit the object file.
     llvm::legacy::PassManager PM;
-    auto &TM = irgen_.getTargetMachine();
+    auto &TM = irgen.getTargetMachine();
     TM.addPassesToEmitFile(
         PM, outputFile, llvm::TargetMachine::CodeGenFileType::CGFT_ObjectFile);
     PM.run(M);
   }
   outputFile.close();
-  // Output weights.
-  saveWeights(bundleWeightsOutput);
+  // Output weights, unless they were embedded into the object above.
+  if (!bundleEmbedWeights) {
+    saveWeights(bundleWeightsOutput);
+  }
 }
 
 /// Emit the entry function for the bundle. It simply calls the main entry of
@@ -171,19 +343,20 @@ void BundleSaver::produceBundle(llvm::StringRef outputDir) {
 /// the LLVM optimizer will constant propagate them into relative addressing
 /// computations and the like and produce a very efficient code that uses
 /// absolute addressing whenever possible.
-void BundleSaver::emitBundleEntryFunction() {
+void BundleSaver::emitBundleEntryFunction(SavedFunction &SF) {
+  auto &irgen = *SF.irgen;
   // The bundle entry point has the following API:
   // void entry(uint8_t *baseConstantWeightVars, uint8_t *baseInoutWeightVars,
   // uint8_t *baseActivations);
-  llvm::Type *voidTy = llvm::Type::getVoidTy(irgen_.getLLVMContext());
-  auto int8PtrTy = llvm::Type::getInt8PtrTy(irgen_.getLLVMContext());
+  llvm::Type *voidTy = llvm::Type::getVoidTy(irgen.getLLVMContext());
+  auto int8PtrTy = llvm::Type::getInt8PtrTy(irgen.getLLVMContext());
   llvm::FunctionType *bundleFuncTy =
       llvm::FunctionType::get(voidTy, {int8PtrTy, int8PtrTy, int8PtrTy}, false);
   auto *func =
       llvm::Function::Create(bundleFuncTy, llvm::Function::ExternalLinkage,
-                             irgen_.getMainEntryName(), &irgen_.getModule());
+                             irgen.getMainEntryName(), &irgen.getModule());
   llvm::BasicBlock *entry_bb =
-      llvm::BasicBlock::Create(irgen_.getLLVMContext(), "entry", func);
+      llvm::BasicBlock::Create(irgen.getLLVMContext(), "entry", func);
   llvm::IRBuilder<> builder(entry_bb);
 
   // Prepare arguments for the "main" function.
@@ -192,17 +365,17 @@ void BundleSaver::emitBundleEntryFunction() {
   initFunctionCallArgs.push_back(func->args().begin() + 1);
   initFunctionCallArgs.push_back(func->args().begin() + 2);
   // Now form the offsets array and pass it as the last argument.
-  auto offsetsArray = irgen_.emitConstOffsetsArray(builder, allocationsInfo_);
+  auto offsetsArray = irgen.emitConstOffsetsArray(builder, SF.allocationsInfo);
   initFunctionCallArgs.push_back(offsetsArray);
   // Invoke the main entry with constant arguments and let LLVM optimizer make
   // use of it.
-  auto *entryF = irgen_.getModule().getFunction("main");
+  auto *entryF = irgen.getModule().getFunction("main");
   entryF->setLinkage(llvm::Function::InternalLinkage);
   createCall(builder, entryF, initFunctionCallArgs);
   // Terminate the function.
   builder.CreateRetVoid();
   // Create the debug info for the bundle entry point function.
-  irgen_.generateFunctionDebugInfo(func);
+  irgen.generateFunctionDebugInfo(func);
 }
 
 // Create a config for this network. It will be exposed to the clients,
@@ -216,56 +389,62 @@ void BundleSaver::emitBundleEntryFunction() {
 //   size_t numSymbols;
 //   SymbolTableEntry *symbolTable;
 // };
-void BundleSaver::emitBundleConfig() {
-  auto symbolTable = irgen_.getModule().getGlobalVariable(
-      irgen_.getMainEntryName() + "SymbolTable", true);
+void BundleSaver::emitBundleConfig(SavedFunction &SF) {
+  auto &irgen = *SF.irgen;
+  auto symbolTable = irgen.getModule().getGlobalVariable(
+      irgen.getMainEntryName() + "SymbolTable", true);
   GLOW_ASSERT(symbolTable &&
               "Expected to find a symbol table for the AOT bundle");
   // Get the integer type having the same size in bits as size_t.
-  auto *SizeTType = irgen_.getBuilder().getIntNTy(sizeof(size_t) * 8);
+  auto *SizeTType = irgen.getBuilder().getIntNTy(sizeof(size_t) * 8);
   auto symbolTableEntryTy = symbolTable->getType()->getPointerElementType();
   auto *bundleConfigTy = llvm::StructType::get(
-      irgen_.getLLVMContext(), {SizeTType, SizeTType, SizeTType, SizeTType,
-                                SizeTType, symbolTableEntryTy->getPointerTo()});
+      irgen.getLLVMContext(), {SizeTType, SizeTType, SizeTType, SizeTType,
+                               SizeTType, symbolTableEntryTy->getPointerTo()});
   auto config = new llvm::GlobalVariable(
-      irgen_.getModule(), bundleConfigTy, /* isConst */ true,
+      irgen.getModule(), bundleConfigTy, /* isConst */ true,
       llvm::GlobalValue::LinkageTypes::ExternalLinkage, nullptr,
-      irgen_.getMainEntryName() + "_config");
+      irgen.getMainEntryName() + "_config");
   config->setInitializer(llvm::ConstantStruct::get(
       bundleConfigTy,
       llvm::ConstantInt::get(
-          SizeTType, irgen_.getAllocationsInfo().constantWeightVarsMemSize_),
+          SizeTType, irgen.getAllocationsInfo().constantWeightVarsMemSize_),
       llvm::ConstantInt::get(
-          SizeTType, irgen_.getAllocationsInfo().mutableWeightVarsMemSize_),
+          SizeTType, irgen.getAllocationsInfo().mutableWeightVarsMemSize_),
       llvm::ConstantInt::get(SizeTType,
-                             irgen_.getAllocationsInfo().activationsMemSize_),
+                             irgen.getAllocationsInfo().activationsMemSize_),
       llvm::ConstantInt::get(SizeTType, TensorAlignment),
       llvm::ConstantInt::get(SizeTType,
-                             F_->getGraph()->getParent()->getVars().size()),
+                             SF.F->getGraph()->getParent()->getVars().size()),
       symbolTable));
 }
 
-void BundleSaver::performBundleMemoryAllocation() {
-  allocationsInfo_.numberValues(F_);
-  allocationsInfo_.allocateActivations(F_);
-  // Tell the allocateWeightVars to not reuse any existing addresses for weights
-  // and to assign new ones.
-  allocationsInfo_.allocateWeightVars(F_, false);
-  allocationsInfo_.allocateTensorViews(F_);
+void BundleSaver::performBundleMemoryAllocation(SavedFunction &SF) {
+  SF.allocationsInfo.numberValues(SF.F);
+  SF.allocationsInfo.allocateActivations(SF.F);
+  // Tell the allocateWeightVars to not reuse any existing addresses for
+  // weights and to use the offsets of the shared module-level layout.
+  SF.allocationsInfo.allocateWeightVars(SF.F, weightLayout_, false);
+  SF.allocationsInfo.allocateTensorViews(SF.F);
 }
 
 void BundleSaver::save(llvm::StringRef target, llvm::StringRef outputDir) {
-  // Object files generation works properly only in small mode.
-  irgen_.initTargetMachine(target, llvm::CodeModel::Model::Small);
-  irgen_.setMainEntryName(F_->getGraph()->getName());
-  irgen_.setOutputDir(outputDir);
-  irgen_.initCodeGen();
-  // Perform the address assignment for activations and WeightVars.
-  performBundleMemoryAllocation();
-  // Create the bundle entry function.
-  emitBundleEntryFunction();
-  // Emit the code for the body of the entry function.
-  irgen_.performCodeGen();
+  // Generate the code of every entry point into its own LLVM module. The
+  // modules are linked into one bundle object by produceBundle.
+  for (auto &SF : funcs_) {
+    auto &irgen = *SF.irgen;
+    // Object files generation works properly only in small mode.
+    irgen.initTargetMachine(target, llvm::CodeModel::Model::Small);
+    irgen.setMainEntryName(SF.F->getGraph()->getName());
+    irgen.setOutputDir(outputDir);
+    irgen.initCodeGen();
+    // Perform the address assignment for activations and WeightVars.
+    performBundleMemoryAllocation(SF);
+    // Create the bundle entry function.
+    emitBundleEntryFunction(SF);
+    // Emit the code for the body of the entry function.
+    irgen.performCodeGen();
+  }
   // Produce the bundle.
   produceBundle(outputDir);
 }
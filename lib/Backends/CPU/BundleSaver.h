@@ -21,32 +21,62 @@
 
 #include "glow/IR/IR.h"
 
+#include <list>
+#include <memory>
+#include <vector>
+
 namespace glow {
 
 class BundleSaver final {
-  /// The IR to be compiled.
-  const IRFunction *F_;
-  /// Information about allocations.
-  AllocationsInfo allocationsInfo_;
-  /// The LLVM IR code generator.
-  LLVMIRGen irgen_;
-
-  /// Perform memory allocation for a bundle.
-  void performBundleMemoryAllocation();
+  /// One entry point of the bundle: an IR function together with its own
+  /// allocations and code generator. All entries are laid out against the
+  /// shared module-level weight layout, so they address a single copy of
+  /// the weights.
+  struct SavedFunction {
+    /// The IR to be compiled.
+    const IRFunction *F;
+    /// Information about allocations.
+    AllocationsInfo allocationsInfo;
+    /// The LLVM IR code generator.
+    std::unique_ptr<LLVMIRGen> irgen;
+
+    explicit SavedFunction(const IRFunction *F);
+  };
+
+  /// The entry points of the bundle. A list, because every code generator
+  /// keeps a reference to the AllocationsInfo of its entry.
+  std::list<SavedFunction> funcs_;
+  /// The module-level weight layout shared by all bundles of the module.
+  const ModuleWeightLayout &weightLayout_;
+
+  /// Perform memory allocation for the entry \p SF.
+  void performBundleMemoryAllocation(SavedFunction &SF);
+  /// \returns an image of the constant weights area, with every constant
+  /// weight used by any of the saved entries serialized at the offset the
+  /// module-level layout assigned to it.
+  std::vector<char> serializeConstantWeights();
   /// Save weights for the bundle.
   void saveWeights(llvm::StringRef weightsFileName);
+  /// Emit the constant weights into a read-only global of the bundle object.
+  void emitConstantWeights();
   /// Produce a bundle.
   void produceBundle(llvm::StringRef outputDir);
-  /// Emit config for a bundle.
-  void emitBundleConfig();
-  /// Emit the symbol table for a bundle.
-  void emitSymbolTable();
-  /// Emit the entry function for the bundle.
-  void emitBundleEntryFunction();
+  /// Emit config for the entry \p SF.
+  void emitBundleConfig(SavedFunction &SF);
+  /// Emit the symbol table for the entry \p SF.
+  void emitSymbolTable(SavedFunction &SF);
+  /// Emit the entry function for the entry \p SF.
+  void emitBundleEntryFunction(SavedFunction &SF);
 
 public:
-  /// Ctor.
-  explicit BundleSaver(const IRFunction *F);
+  /// Ctor. \p layout is the module-level weight layout that the bundle
+  /// addresses its weights through.
+  BundleSaver(const IRFunction *F, const ModuleWeightLayout &layout);
+  /// Ctor for a bundle with one entry point per function of \p Fs. All
+  /// functions must belong to one module; the bundle contains a single copy
+  /// of the constant weights referenced by every entry.
+  BundleSaver(llvm::ArrayRef<const IRFunction *> Fs,
+              const ModuleWeightLayout &layout);
   /// Save code bundle built for \p target to \p outputDir.
   void save(llvm::StringRef target, llvm::StringRef outputDir);
 };
@@ -17,8 +17,12 @@
 #include "CPUBackend.h"
 #include "BundleSaver.h"
 #include "CPUFunction.h"
+#include "CommandLine.h"
+#include "NumaSupport.h"
+#include "WeightPager.h"
 
 #include "glow/Graph/Graph.h"
+#include "glow/IR/IRUtils.h"
 #include "glow/IR/Instrs.h"
 #include "glow/Support/Debug.h"
 
@@ -29,8 +33,27 @@
 
 using namespace glow;
 
+using llvm::cast;
+using llvm::dyn_cast;
+
 static llvm::cl::opt<std::string> target("target", llvm::cl::desc("target"));
 
+static llvm::cl::opt<bool> numaInterleaveWeights(
+    "numa-interleave-weights",
+    llvm::cl::desc("Interleave the pages of large weight tensors across the "
+                   "NUMA nodes, so that no socket concentrates the remote "
+                   "memory traffic"),
+    llvm::cl::init(false), llvm::cl::cat(CPUBackendCat));
+
+llvm::cl::opt<bool> numaBindActivations(
+    "numa-bind-activations",
+    llvm::cl::desc("Bind the activation heap of a compiled function to the "
+                   "NUMA node of the thread that first executes it"),
+    llvm::cl::init(false), llvm::cl::cat(CPUBackendCat));
+
+/// Defined in lib/CodeGen/MemoryAllocator.cpp.
+extern llvm::cl::opt<unsigned> activationRegionsOpt;
+
 namespace glow {
 Backend *createCPUBackend() { return new CPUBackend(); }
 } // namespace glow
@@ -41,18 +64,38 @@ namespace {
 //                   Functions for executing code using JIT
 //===----------------------------------------------------------------------===//
 
-/// Emit the entry point for JIT called "jitmain". It simply calls the main
+/// Emit the entry point for JIT called \p entryName. It simply calls the main
 /// entry of the module with the constant concrete addresses of all the memory
 /// areas. Since these addresses are constants, the LLVM optimizer will constant
 /// propagate them into relative addressing computations and the like and
 /// produce a very efficient code that uses absolute addressing whenever
-/// possible.
-static void emitJitMain(AllocationsInfo &allocationsInfo, LLVMIRGen &irgen) {
+/// possible. The activations live at \p baseActivations; one entry point is
+/// emitted per activation region, so that the caller can execute against
+/// either region. When \p activationsAsArg is set, the entry takes the base
+/// address of the activations as its only argument instead of baking it in as
+/// a constant. Such an entry is position-independent with respect to the
+/// activations, so several threads can execute it concurrently, each against
+/// its own arena. When \p mutableWeightsAsArg is additionally set, the entry
+/// takes the base addresses of both the mutable weights and the activations
+/// as arguments, which makes it position-independent with respect to the
+/// whole per-run state of an execution context.
+static void emitJitMain(AllocationsInfo &allocationsInfo, LLVMIRGen &irgen,
+                        llvm::StringRef entryName, uint8_t *baseActivations,
+                        bool activationsAsArg = false,
+                        bool mutableWeightsAsArg = false) {
   llvm::Type *voidTy = llvm::Type::getVoidTy(irgen.getLLVMContext());
-  llvm::FunctionType *jitFuncTy = llvm::FunctionType::get(voidTy, {}, false);
+  auto int8PtrTy = llvm::Type::getInt8PtrTy(irgen.getLLVMContext());
+  llvm::FunctionType *jitFuncTy;
+  if (mutableWeightsAsArg) {
+    jitFuncTy = llvm::FunctionType::get(voidTy, {int8PtrTy, int8PtrTy}, false);
+  } else if (activationsAsArg) {
+    jitFuncTy = llvm::FunctionType::get(voidTy, {int8PtrTy}, false);
+  } else {
+    jitFuncTy = llvm::FunctionType::get(voidTy, {}, false);
+  }
   auto *func =
       llvm::Function::Create(jitFuncTy, llvm::Function::ExternalLinkage,
-                             "jitmain", &irgen.getModule());
+                             entryName, &irgen.getModule());
   llvm::BasicBlock *entry_bb =
       llvm::BasicBlock::Create(irgen.getLLVMContext(), "entry", func);
   llvm::IRBuilder<> builder(entry_bb);
@@ -61,23 +104,30 @@ static void emitJitMain(AllocationsInfo &allocationsInfo, LLVMIRGen &irgen) {
   llvm::SmallVector<llvm::Value *, 4> initFunctionCallArgs;
   // Get the integer type having the same size in bits as size_t.
   auto *sizeTType = builder.getIntNTy(sizeof(size_t) * 8);
-  auto int8PtrTy = llvm::Type::getInt8PtrTy(irgen.getLLVMContext());
 
   initFunctionCallArgs.push_back(builder.CreateIntToPtr(
       llvm::ConstantInt::get(
           sizeTType, reinterpret_cast<size_t>(
                          allocationsInfo.baseConstantWeightVarsAddress_)),
       int8PtrTy));
-  initFunctionCallArgs.push_back(builder.CreateIntToPtr(
-      llvm::ConstantInt::get(
-          sizeTType, reinterpret_cast<size_t>(
-                         allocationsInfo.baseMutableWeightVarsAddress_)),
-      int8PtrTy));
-  initFunctionCallArgs.push_back(builder.CreateIntToPtr(
-      llvm::ConstantInt::get(
-          sizeTType,
-          reinterpret_cast<size_t>(allocationsInfo.baseActivationsAddress_)),
-      int8PtrTy));
+  auto argIt = func->args().begin();
+  if (mutableWeightsAsArg) {
+    initFunctionCallArgs.push_back(&*argIt++);
+  } else {
+    initFunctionCallArgs.push_back(builder.CreateIntToPtr(
+        llvm::ConstantInt::get(
+            sizeTType, reinterpret_cast<size_t>(
+                           allocationsInfo.baseMutableWeightVarsAddress_)),
+        int8PtrTy));
+  }
+  if (activationsAsArg || mutableWeightsAsArg) {
+    initFunctionCallArgs.push_back(&*argIt);
+  } else {
+    initFunctionCallArgs.push_back(builder.CreateIntToPtr(
+        llvm::ConstantInt::get(sizeTType,
+                               reinterpret_cast<size_t>(baseActivations)),
+        int8PtrTy));
+  }
   // Now form the offsets array and pass it as the last argument.
   auto offsetsArray =
       irgen.emitConstOffsetsArray(irgen.getBuilder(), allocationsInfo);
@@ -93,27 +143,46 @@ static void emitJitMain(AllocationsInfo &allocationsInfo, LLVMIRGen &irgen) {
   irgen.generateFunctionDebugInfo(func);
 }
 
-/// Perform memory allocation for a JIT execution.
+/// \returns the stride between the activation regions of \p allocationsInfo:
+/// the size of one copy of the activation arena, aligned so that every
+/// region starts properly aligned.
+static size_t getActivationsStride(const AllocationsInfo &allocationsInfo) {
+  return alignedSize(allocationsInfo.activationsMemSize_, TensorAlignment);
+}
+
+/// Perform memory allocation for a JIT execution. The heap holds \p
+/// numRegions independent copies of the activation arena, so that
+/// back-to-back batches can execute against alternating regions.
 static void *allocateJITMemory(const IRFunction *F,
-                               AllocationsInfo &allocationsInfo) {
+                               AllocationsInfo &allocationsInfo,
+                               const ModuleWeightLayout &weightLayout,
+                               unsigned numRegions) {
   allocationsInfo.numberValues(F);
   allocationsInfo.allocateActivations(F);
   // Tell the allocateWeightVars to reuse existing addresses for weights.
-  allocationsInfo.allocateWeightVars(F, true);
+  allocationsInfo.allocateWeightVars(F, weightLayout, true);
   allocationsInfo.allocateTensorViews(F);
 
   // Allocate the heap to match the max memory usage for activations.
   if (allocationsInfo.activationsMemSize_ == 0) {
     return nullptr;
   }
-  auto heap =
-      alignedAlloc(allocationsInfo.activationsMemSize_, TensorAlignment);
+  auto heap = alignedAlloc(getActivationsStride(allocationsInfo) * numRegions,
+                           TensorAlignment);
   allocationsInfo.baseActivationsAddress_ = (uint8_t *)heap;
   return heap;
 }
 
 } // end namespace
 
+const ModuleWeightLayout &CPUBackend::getWeightLayout(const Module *M) const {
+  auto &layout = weightLayouts_[M];
+  // Place any variables added to the module since the last compilation.
+  // Variables placed earlier keep their offsets.
+  layout.assignOffsets(*M);
+  return layout;
+}
+
 std::unique_ptr<CompiledFunction>
 CPUBackend::compile(std::unique_ptr<IRFunction> IR) const {
   AllocationsInfo allocationsInfo;
@@ -121,22 +190,122 @@ CPUBackend::compile(std::unique_ptr<IRFunction> IR) const {
   irgen.initTargetMachine(target.empty() ? "" : target.getValue(),
                           llvm::CodeModel::Model::Large);
   irgen.initCodeGen();
+  unsigned numRegions = activationRegionsOpt < 1 ? 1 : activationRegionsOpt;
+  const ModuleWeightLayout &weightLayout =
+      getWeightLayout(IR->getGraph()->getParent());
+  // When weight streaming is enabled, stage the constant weights in the
+  // backing file and rebind their payloads to its mapping before the weight
+  // addresses are assigned, and have the generated code drive the paging
+  // window as it advances through the instruction schedule.
+  if (auto *pager = WeightPager::get()) {
+    pager->pageConstantWeights(IR->getGraph()->getParent(), weightLayout);
+    irgen.setWeightPagerSchedule(pager->addSchedule(IR.get()));
+  }
   // Perform the address assignment for activations and WeightVars.
-  auto heap = allocateJITMemory(IR.get(), allocationsInfo);
-  // Create the jitmain function to be invoked by JIT.
-  emitJitMain(allocationsInfo, irgen);
+  auto heap =
+      allocateJITMemory(IR.get(), allocationsInfo, weightLayout, numRegions);
+  if (numaInterleaveWeights) {
+    // Spread the pages of large weight tensors across the NUMA nodes. Small
+    // tensors are left alone; they fit in cache and interleaving them only
+    // fragments the policies.
+    constexpr size_t numaInterleaveThreshold = 1 << 20;
+    for (auto *V : IR->getGraph()->getParent()->getVars()) {
+      auto &payload = V->getPayload();
+      size_t numBytes = payload.getSizeInBytes();
+      if (numBytes >= numaInterleaveThreshold) {
+        numaInterleaveMemory(payload.getUnsafePtr(), numBytes);
+      }
+    }
+  }
+  // Create one jitmain function per activation region to be invoked by JIT.
+  // The regions have identical layouts, so the entries differ only in the
+  // constant base address of the activations.
+  size_t stride = getActivationsStride(allocationsInfo);
+  for (unsigned r = 0; r < numRegions; r++) {
+    std::string entryName = r == 0 ? "jitmain" : "jitmain" + std::to_string(r);
+    emitJitMain(allocationsInfo, irgen, entryName,
+                allocationsInfo.baseActivationsAddress_ + r * stride);
+  }
+  // Emit one more entry that takes the base address of the activations as an
+  // argument. The generated code addresses the activations relative to that
+  // base, so any number of threads can execute the function concurrently,
+  // each against an arena of its own.
+  emitJitMain(allocationsInfo, irgen, "jitmainActivations", nullptr,
+              /* activationsAsArg */ true);
+  // Emit the entry for execution contexts: both the mutable weights and the
+  // activations are arguments, so every context runs against a private copy
+  // of the whole per-run state. The mutable weights (and their tensorviews)
+  // are rebased from the payload addresses of the variables onto the module
+  // layout offsets for this entry.
+  AllocationsInfo contextAllocs = allocationsInfo;
+  for (auto &v : IR->getGraph()->getParent()->getVars()) {
+    auto *w = llvm::dyn_cast_or_null<WeightVar>(IR->getWeightForNode(v));
+    if (!w) {
+      // Skip the variables that this function does not use.
+      continue;
+    }
+    if (contextAllocs.valueNumbers_[w].first !=
+        AllocationsInfo::ValueKind::MutableWeight) {
+      continue;
+    }
+    auto offset = weightLayout.varOffsets_.find(v);
+    assert(offset != weightLayout.varOffsets_.end() &&
+           "Variable was not placed by the module weight layout");
+    contextAllocs.allocatedAddressed_[w] = offset->second;
+  }
+  for (const auto &I : IR->getInstrs()) {
+    auto *A = dyn_cast<TensorViewInst>(&I);
+    if (!A || contextAllocs.valueNumbers_[A].first !=
+                  AllocationsInfo::ValueKind::MutableWeight) {
+      continue;
+    }
+    auto *origin = getOrigin(A);
+    size_t delta = allocationsInfo.allocatedAddressed_[A] -
+                   allocationsInfo.allocatedAddressed_[origin];
+    contextAllocs.allocatedAddressed_[A] =
+        contextAllocs.allocatedAddressed_[origin] + delta;
+  }
+  emitJitMain(contextAllocs, irgen, "jitmainContext", nullptr,
+              /* activationsAsArg */ true, /* mutableWeightsAsArg */ true);
   // Emit the code for the body of the entry function.
   irgen.performCodeGen();
   // Hand over the module to JIT for the machine code generation.
   auto JIT = llvm::make_unique<llvm::orc::GlowJIT>(irgen.getTargetMachine());
   JIT->addModule(irgen.borrowModule());
-  return llvm::make_unique<CPUFunction>(std::move(JIT), heap);
+  // The offsets of the public variables in a context's mutable weights
+  // arena, used to bind the I/O of execution contexts.
+  llvm::DenseMap<const Variable *, size_t> mutableWeightOffsets;
+  for (auto &v : IR->getGraph()->getParent()->getVars()) {
+    if (v->getVisibilityKind() == VisibilityKind::Public) {
+      mutableWeightOffsets[v] = weightLayout.varOffsets_.lookup(v);
+    }
+  }
+  return llvm::make_unique<CPUFunction>(
+      std::move(JIT), heap, numRegions, stride,
+      weightLayout.mutableWeightVarsMemSize_, std::move(mutableWeightOffsets));
+}
+
+void CPUBackend::pinFunctionMemory(CompiledFunction *F, uint64_t nodeMask) {
+  static_cast<CPUFunction *>(F)->pinMemory(nodeMask);
 }
 
 void CPUBackend::save(std::unique_ptr<IRFunction> IR,
                       llvm::StringRef outputDir) const {
   std::string tgt = target.empty() ? "" : target.getValue();
-  BundleSaver(IR.get()).save(tgt, outputDir);
+  BundleSaver(IR.get(), getWeightLayout(IR->getGraph()->getParent()))
+      .save(tgt, outputDir);
+}
+
+void CPUBackend::save(std::vector<std::unique_ptr<IRFunction>> IRs,
+                      llvm::StringRef outputDir) const {
+  GLOW_ASSERT(!IRs.empty() && "A bundle needs at least one entry point");
+  std::string tgt = target.empty() ? "" : target.getValue();
+  llvm::SmallVector<const IRFunction *, 4> funcs;
+  for (auto &IR : IRs) {
+    funcs.push_back(IR.get());
+  }
+  BundleSaver(funcs, getWeightLayout(funcs.front()->getGraph()->getParent()))
+      .save(tgt, outputDir);
 }
 
 bool CPUBackend::isOpSupported(Kinded::Kind opKind, ElemKind elementTy) const {
@@ -146,6 +315,7 @@ bool CPUBackend::isOpSupported(Kinded::Kind opKind, ElemKind elementTy) const {
     case Kinded::Kind::AddNodeKind:
     case Kinded::Kind::BatchedAddNodeKind:
     case Kinded::Kind::BatchedReduceAddNodeKind:
+    case Kinded::Kind::BroadcastNodeKind:
     case Kinded::Kind::CmpLTENodeKind:
     case Kinded::Kind::ConcatNodeKind:
     case Kinded::Kind::ConvolutionNodeKind:
@@ -174,12 +344,26 @@ bool CPUBackend::isOpSupported(Kinded::Kind opKind, ElemKind elementTy) const {
     }
   }
 
+  // The libjit kernels have no int16 variants.
+  if (elementTy == ElemKind::Int16QTy) {
+    return false;
+  }
+
   return true;
 }
 
 bool CPUBackend::shouldLower(const Node *N) const {
   if (N->getKind() == Kinded::Kind::ConvolutionNodeKind)
     return false;
+  // Broadcasts are executed as a single strided-read kernel instead of a
+  // chain of materialized tiles.
+  if (N->getKind() == Kinded::Kind::BroadcastNodeKind)
+    return false;
+  // Float batched matmuls are executed natively with the batch sharded over
+  // threads, instead of a chain of slices and serial matmuls.
+  if (N->getKind() == Kinded::Kind::BatchMatMulNodeKind &&
+      N->getNthResult(0).getType()->getElementType() == ElemKind::FloatTy)
+    return false;
   return true;
 }
 
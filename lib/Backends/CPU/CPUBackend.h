@@ -16,10 +16,13 @@
 #ifndef GLOW_BACKENDS_CPU_CPUBACKEND_H
 #define GLOW_BACKENDS_CPU_CPUBACKEND_H
 
+#include "AllocationsInfo.h"
+
 #include "glow/Backends/Backend.h"
 #include "glow/Base/Tensor.h"
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/IR/IRBuilder.h"
 
 namespace glow {
@@ -46,12 +49,40 @@ public:
   void save(std::unique_ptr<IRFunction> IR,
             llvm::StringRef outputDir) const override;
 
+  void save(std::vector<std::unique_ptr<IRFunction>> IRs,
+            llvm::StringRef outputDir) const override;
+
   bool transformPostLowering(Function *F, CompilationMode mode) const override;
 
   bool isOpSupported(Kinded::Kind opKind, ElemKind elementTy) const override;
 
   bool shouldLower(const Node *N) const override;
+
+  /// The JIT resolves the payload addresses of the weights at compile
+  /// time, so it does not observe payloads rebound after compilation.
+  bool supportsBoundIO() const override { return false; }
+
+  /// Matrix multiplications with CSR-encoded weights are dispatched to a
+  /// sparse libjit kernel.
+  bool supportsSparseWeights() const override { return true; }
   /// @}
+
+  /// Pins the activation heap of the compiled function \p F, which must have
+  /// been produced by this backend, to the set of NUMA nodes in \p nodeMask,
+  /// where bit i selects node i. Best effort; a no-op on systems without
+  /// NUMA support.
+  static void pinFunctionMemory(CompiledFunction *F, uint64_t nodeMask);
+
+private:
+  /// \returns the shared weight layout of \p M, extending it with any
+  /// variables added to the module since the last compilation.
+  const ModuleWeightLayout &getWeightLayout(const Module *M) const;
+
+  /// The weight arena layouts, one per module. A layout is computed when the
+  /// first function of a module is compiled and shared by every later
+  /// compile and save, so several entry points address one copy of the
+  /// weights.
+  mutable llvm::DenseMap<const Module *, ModuleWeightLayout> weightLayouts_;
 };
 
 } // namespace glow
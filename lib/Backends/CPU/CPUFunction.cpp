@@ -15,19 +15,88 @@
  */
 
 #include "CPUFunction.h"
+#include "NumaSupport.h"
 
 #include "glow/Support/Compiler.h"
 #include "glow/Support/Memory.h"
 
+#include "llvm/Support/CommandLine.h"
+
+#include <cassert>
+#include <string>
+
 using namespace glow;
 
-CPUFunction::CPUFunction(std::unique_ptr<llvm::orc::GlowJIT> JIT, void *heap)
-    : JIT_(std::move(JIT)), heap_(heap) {}
+/// Defined in LLVMIRGen.cpp.
+extern llvm::cl::opt<bool> instrumentKernels;
+
+/// Defined in CPUBackend.cpp.
+extern llvm::cl::opt<bool> numaBindActivations;
 
-CPUFunction::~CPUFunction() { alignedFree(heap_); }
+CPUFunction::CPUFunction(
+    std::unique_ptr<llvm::orc::GlowJIT> JIT, void *heap,
+    unsigned numActivationRegions, size_t activationsSize,
+    size_t mutableWeightsSize,
+    llvm::DenseMap<const Variable *, size_t> mutableWeightOffsets)
+    : JIT_(std::move(JIT)), heap_(heap),
+      numActivationRegions_(numActivationRegions),
+      activationsSize_(activationsSize),
+      mutableWeightsSize_(mutableWeightsSize),
+      mutableWeightOffsets_(std::move(mutableWeightOffsets)) {}
+
+CPUFunction::~CPUFunction() {
+  if (instrumentKernels) {
+    dumpKernelProfile();
+  }
+  alignedFree(heap_);
+}
+
+void CPUFunction::dumpKernelProfile() {
+  auto cyclesSym = JIT_->findSymbol("kernelProfileCycles");
+  auto namesSym = JIT_->findSymbol("kernelProfileNames");
+  auto sizeSym = JIT_->findSymbol("kernelProfileSize");
+  if (!cyclesSym || !namesSym || !sizeSym) {
+    // The function was compiled without instrumentation.
+    return;
+  }
+  auto cyclesAddr = cyclesSym.getAddress();
+  auto namesAddr = namesSym.getAddress();
+  auto sizeAddr = sizeSym.getAddress();
+  GLOW_ASSERT(cyclesAddr && namesAddr && sizeAddr &&
+              "Error getting the addresses of the profile tables");
+  auto *cycles = reinterpret_cast<const uint64_t *>(cyclesAddr.get());
+  auto *names = reinterpret_cast<const char *const *>(namesAddr.get());
+  auto numKernels = *reinterpret_cast<const uint64_t *>(sizeAddr.get());
+  llvm::outs() << "Kernel profile, cycles per kernel:\n";
+  for (uint64_t i = 0; i < numKernels; i++) {
+    llvm::outs() << cycles[i] << "\t" << names[i] << "\n";
+  }
+}
+
+unsigned CPUFunction::getNumActivationRegions() const {
+  return numActivationRegions_;
+}
+
+void CPUFunction::setActivationRegion(unsigned region) {
+  assert(region < numActivationRegions_ && "Invalid activation region");
+  activationRegion_ = region;
+}
 
 void CPUFunction::execute() {
-  auto sym = JIT_->findSymbol("jitmain");
+  if (numaBindActivations && !heapPlaced_ && heap_) {
+    // Bind the heap to the node of the first executing thread, so that the
+    // activations stay local no matter where the compiling thread first
+    // touched them.
+    numaBindMemoryToLocalNode(heap_,
+                              activationsSize_ * numActivationRegions_);
+    heapPlaced_ = true;
+  }
+  // Each activation region has its own entry point, with the base address of
+  // the region baked in as a constant.
+  std::string entryName =
+      activationRegion_ == 0 ? "jitmain"
+                             : "jitmain" + std::to_string(activationRegion_);
+  auto sym = JIT_->findSymbol(entryName);
   assert(sym && "Unable to JIT the code!");
   using JitFuncType = void (*)(void);
   auto address = sym.getAddress();
@@ -38,3 +107,55 @@ void CPUFunction::execute() {
     GLOW_ASSERT(false && "Error getting address.");
   }
 }
+
+size_t CPUFunction::getActivationsSize() const { return activationsSize_; }
+
+void CPUFunction::pinMemory(uint64_t nodeMask) {
+  if (heap_) {
+    numaBindMemory(heap_, activationsSize_ * numActivationRegions_, nodeMask);
+  }
+  heapPlaced_ = true;
+}
+
+size_t CPUFunction::getMutableWeightsSize() const {
+  return mutableWeightsSize_;
+}
+
+size_t CPUFunction::getMutableWeightOffset(const Variable *v) const {
+  auto it = mutableWeightOffsets_.find(v);
+  assert(it != mutableWeightOffsets_.end() &&
+         "Variable is not a public variable of this function's module");
+  return it->second;
+}
+
+void CPUFunction::executeWithContext(void *mutableWeights, void *activations) {
+  // This entry addresses both the mutable weights and the activations
+  // relative to the given bases, so concurrent calls with disjoint arenas
+  // do not interfere with each other.
+  auto sym = JIT_->findSymbol("jitmainContext");
+  assert(sym && "Unable to JIT the code!");
+  using JitFuncType = void (*)(uint8_t *, uint8_t *);
+  auto address = sym.getAddress();
+  if (address) {
+    JitFuncType funcPtr = reinterpret_cast<JitFuncType>(address.get());
+    funcPtr(reinterpret_cast<uint8_t *>(mutableWeights),
+            reinterpret_cast<uint8_t *>(activations));
+  } else {
+    GLOW_ASSERT(false && "Error getting address.");
+  }
+}
+
+void CPUFunction::executeWithActivations(void *activations) {
+  // This entry addresses the activations relative to the given base, so
+  // concurrent calls with disjoint arenas do not interfere with each other.
+  auto sym = JIT_->findSymbol("jitmainActivations");
+  assert(sym && "Unable to JIT the code!");
+  using JitFuncType = void (*)(uint8_t *);
+  auto address = sym.getAddress();
+  if (address) {
+    JitFuncType funcPtr = reinterpret_cast<JitFuncType>(address.get());
+    funcPtr(reinterpret_cast<uint8_t *>(activations));
+  } else {
+    GLOW_ASSERT(false && "Error getting address.");
+  }
+}
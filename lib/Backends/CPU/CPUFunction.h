@@ -20,6 +20,8 @@
 
 #include "glow/Backends/CompiledFunction.h"
 
+#include "llvm/ADT/DenseMap.h"
+
 namespace glow {
 
 /// A Glow IR function compiled for the CPU using LLVM.
@@ -27,19 +29,64 @@ class CPUFunction final : public CompiledFunction {
   /// The LLVM JIT engine. The jit must be initialized after the ctor
   /// initializes the LLVM backends.
   std::unique_ptr<llvm::orc::GlowJIT> JIT_;
-  /// This represents the heap, that stores the activations at runtime.
+  /// This represents the heap, that stores the activations at runtime. When
+  /// the function was compiled with several activation regions, the heap
+  /// holds one copy of the activation arena per region.
   void *heap_;
+  /// The number of independent activation regions in the heap.
+  unsigned numActivationRegions_;
+  /// The region that execute() runs against.
+  unsigned activationRegion_{0};
+  /// The size of one activation arena, in bytes.
+  size_t activationsSize_;
+  /// Whether a NUMA placement has been applied to the heap, either by
+  /// pinMemory() or by the first execution binding it to its local node.
+  bool heapPlaced_{false};
+  /// The size of the mutable weights arena of an execution context, in
+  /// bytes.
+  size_t mutableWeightsSize_{0};
+  /// The offsets of the public variables inside a context's mutable
+  /// weights arena, as assigned by the module weight layout.
+  llvm::DenseMap<const Variable *, size_t> mutableWeightOffsets_;
 
 public:
   /// Ctor.
-  CPUFunction(std::unique_ptr<llvm::orc::GlowJIT> JIT, void *heap);
+  CPUFunction(std::unique_ptr<llvm::orc::GlowJIT> JIT, void *heap,
+              unsigned numActivationRegions = 1, size_t activationsSize = 0,
+              size_t mutableWeightsSize = 0,
+              llvm::DenseMap<const Variable *, size_t> mutableWeightOffsets =
+                  llvm::DenseMap<const Variable *, size_t>());
 
   /// \name CompiledFunction interface
   ///@{
   ~CPUFunction() override;
 
   void execute() override;
+
+  unsigned getNumActivationRegions() const override;
+
+  void setActivationRegion(unsigned region) override;
+
+  size_t getActivationsSize() const override;
+
+  void executeWithActivations(void *activations) override;
+
+  size_t getMutableWeightsSize() const override;
+
+  size_t getMutableWeightOffset(const Variable *v) const override;
+
+  void executeWithContext(void *mutableWeights, void *activations) override;
+
+  /// Prints the per-kernel cycle counts accumulated by the executions of a
+  /// function that was compiled with -instrument-kernels. A no-op when the
+  /// function was compiled without instrumentation.
+  void dumpKernelProfile() override;
   ///@}
+
+  /// Pins the activation heap to the set of NUMA nodes in \p nodeMask, where
+  /// bit i selects node i. Best effort; a no-op on systems without NUMA
+  /// support.
+  void pinMemory(uint64_t nodeMask);
 };
 
 } // end namespace glow
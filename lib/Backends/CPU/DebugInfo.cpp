@@ -416,7 +416,11 @@ void LLVMIRGen::generateDebugInfo() {
   // Emit the debug info for weight variables and activations variables used by
   // the Glow IR. Represent those variables as global variables.
   for (auto &v : F_->getGraph()->getParent()->getVars()) {
-    auto *w = cast<WeightVar>(F_->getWeightForNode(v));
+    auto *w = llvm::dyn_cast_or_null<WeightVar>(F_->getWeightForNode(v));
+    if (!w) {
+      // Skip the variables that this function does not use.
+      continue;
+    }
     emitDebugGlobalVariableForValue(w);
   }
 
@@ -43,6 +43,13 @@ static llvm::cl::opt<bool>
                                      "operations with constant dimensions"),
                       llvm::cl::init(true), llvm::cl::cat(CPUBackendCat));
 
+static llvm::cl::opt<bool> jitInlineSmallKernels(
+    "jit-inline-small-kernels",
+    llvm::cl::desc("Inline small memory-movement kernels from libjit into the "
+                   "generated code instead of outlining them into noinline "
+                   "specializations"),
+    llvm::cl::init(true), llvm::cl::cat(CPUBackendCat));
+
 STATISTIC(NumSpecializations, "Number of created specializations");
 STATISTIC(NumSharedSpecializations, "Number of shared specializations");
 
@@ -222,6 +229,22 @@ class FunctionSpecializer {
     return specializedF;
   }
 
+  /// \returns true if \p callee is a kernel that should be inlined into its
+  /// caller rather than outlined into a noinline specialization. The bodies
+  /// of these kernels are so small that sharing a specialization saves no
+  /// code size, while keeping the direct call to the always-inline definition
+  /// from the libjit bitcode lets LLVM optimize across the kernel boundary:
+  /// the baked buffer addresses become visible to alias analysis, which can
+  /// then remove loads and stores that are killed by adjacent kernels.
+  bool shouldInlineKernel(const llvm::Function *callee) {
+    if (!jitInlineSmallKernels)
+      return false;
+    auto name = callee->getName();
+    return name.startswith("libjit_transpose") ||
+           name.startswith("libjit_insert_tensor") ||
+           name.startswith("libjit_extract_tensor");
+  }
+
   /// \returns true if a function is eligible for specialization.
   bool isEligibleForSpecialization(const llvm::CallInst *call) {
     // For now, specialize all functions invoked from "main". In the future, we
@@ -237,6 +260,10 @@ class FunctionSpecializer {
     // Do not specialize any LLVM internal functions.
     if (callee && callee->getName().startswith("llvm."))
       return false;
+    // Do not specialize small kernels; they are inlined into the caller
+    // instead.
+    if (callee && shouldInlineKernel(callee))
+      return false;
     // Do not specialize noinline functions, because it does not improve
     // anything.
     return callee != nullptr &&
@@ -16,8 +16,18 @@
 
 #include "GlowJIT.h"
 #include "CommandLine.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/ExecutionEngine/JITEventListener.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/MC/SubtargetFeature.h"
 #include "llvm/Object/SymbolSize.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
+
+#include <thread>
 
 using GlowJIT = llvm::orc::GlowJIT;
 
@@ -30,6 +40,147 @@ static llvm::cl::opt<bool> dumpJITSymbolInfo(
     llvm::cl::desc("Dump the load addresses and sizes of JITted symbols"),
     llvm::cl::init(false), llvm::cl::cat(CPUBackendCat));
 
+/// An option to cache the JITted objects on disk. Warm restarts of a process
+/// that compiles an identical module for an identical target load the native
+/// code from the cache instead of re-running LLVM codegen.
+static llvm::cl::opt<std::string> jitObjectCacheDir(
+    "jit-object-cache-dir",
+    llvm::cl::desc("Directory of the on-disk cache of JITted objects (empty "
+                   "disables caching)"),
+    llvm::cl::init(""), llvm::cl::cat(CPUBackendCat));
+
+/// An option to compile the module on several threads. The module is split
+/// into parts that are compiled concurrently. The specialized kernels are
+/// standalone no-inline functions, so large models split well.
+static llvm::cl::opt<unsigned> jitNumThreads(
+    "jit-num-threads",
+    llvm::cl::desc("Number of threads used to compile the module to machine "
+                   "code (1 compiles serially)"),
+    llvm::cl::init(1), llvm::cl::cat(CPUBackendCat));
+
+/// An on-disk cache of JITted objects. The cache key is the identifier that
+/// \ref GlowJIT::addModule assigns to the module: a hash of the module
+/// bitcode and the properties of the target it is compiled for. The
+/// SimpleCompiler consults the cache before running codegen and publishes
+/// the objects it compiles into it.
+class GlowObjectCache : public llvm::ObjectCache {
+  /// The directory that holds the cached objects.
+  std::string dir_;
+
+  /// \returns the path of the cached object for the module \p M.
+  std::string getCachePath(const llvm::Module *M) {
+    llvm::SmallString<128> path(dir_);
+    llvm::sys::path::append(path, M->getModuleIdentifier() + ".o");
+    return path.str();
+  }
+
+public:
+  explicit GlowObjectCache(llvm::StringRef dir) : dir_(dir) {
+    llvm::sys::fs::create_directories(dir_);
+  }
+
+  void notifyObjectCompiled(const llvm::Module *M,
+                            llvm::MemoryBufferRef obj) override {
+    // Write the object to a unique temporary file and rename it into place,
+    // so that concurrent processes never observe a partially written entry.
+    auto path = getCachePath(M);
+    int tmpFD;
+    llvm::SmallString<128> tmpPath;
+    if (llvm::sys::fs::createUniqueFile(path + ".tmp%%%%%%", tmpFD, tmpPath)) {
+      return;
+    }
+    {
+      llvm::raw_fd_ostream os(tmpFD, /* shouldClose */ true);
+      os << obj.getBuffer();
+    }
+    llvm::sys::fs::rename(tmpPath, path);
+  }
+
+  std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module *M) override {
+    auto buf = llvm::MemoryBuffer::getFile(getCachePath(M));
+    if (!buf) {
+      return nullptr;
+    }
+    return std::move(*buf);
+  }
+};
+
+/// Rename \p M so that its identifier describes its contents and the target
+/// \p TM compiles for. The identifier serves as the key of the on-disk
+/// object cache; it covers every constant that is baked into the module, so
+/// a cache hit always returns an object that is valid for this compilation.
+static void setCacheKeyIdentifier(llvm::Module &M, llvm::TargetMachine &TM) {
+  std::string bitcode;
+  llvm::raw_string_ostream os(bitcode);
+#ifdef FACEBOOK
+  llvm::WriteBitcodeToFile(M, os);
+#else
+  llvm::WriteBitcodeToFile(&M, os);
+#endif
+  os.flush();
+  llvm::MD5 hash;
+  hash.update(bitcode);
+  hash.update(TM.getTargetTriple().str());
+  hash.update(TM.getTargetCPU());
+  hash.update(TM.getTargetFeatureString());
+  llvm::MD5::MD5Result result;
+  hash.final(result);
+  M.setModuleIdentifier((llvm::Twine("glow-") + result.digest()).str());
+}
+
+/// Split \p M into up to \p numThreads parts and compile them concurrently,
+/// each part on its own thread with its own LLVMContext and TargetMachine,
+/// because neither of them may be shared by concurrent compilations.
+/// \returns the object files of the parts.
+static std::vector<llvm::object::OwningBinary<llvm::object::ObjectFile>>
+compileModuleParallel(std::unique_ptr<llvm::Module> M, llvm::TargetMachine &TM,
+                      unsigned numThreads) {
+  // Serialize each part to bitcode, so that the worker threads can
+  // rematerialize it in their own context.
+  std::vector<std::string> partBitcode;
+  llvm::SplitModule(std::move(M), numThreads,
+                    [&](std::unique_ptr<llvm::Module> part) {
+                      std::string buf;
+                      llvm::raw_string_ostream os(buf);
+#ifdef FACEBOOK
+                      llvm::WriteBitcodeToFile(*part, os);
+#else
+                      llvm::WriteBitcodeToFile(part.get(), os);
+#endif
+                      os.flush();
+                      partBitcode.push_back(std::move(buf));
+                    },
+                    /* PreserveLocals */ false);
+
+  // Collect the properties needed to recreate an equivalent target machine
+  // for every thread.
+  auto triple = TM.getTargetTriple();
+  auto cpu = TM.getTargetCPU();
+  llvm::SubtargetFeatures features(TM.getTargetFeatureString());
+  llvm::SmallVector<std::string, 0> mattrs;
+  for (auto &feature : features.getFeatures()) {
+    mattrs.push_back(feature);
+  }
+
+  std::vector<llvm::object::OwningBinary<llvm::object::ObjectFile>> objects(
+      partBitcode.size());
+  std::vector<std::thread> workers;
+  for (size_t idx = 0, e = partBitcode.size(); idx < e; idx++) {
+    workers.emplace_back([&, idx]() {
+      llvm::LLVMContext ctx;
+      llvm::MemoryBufferRef buffer(partBitcode[idx], "part");
+      auto part = llvm::cantFail(llvm::parseBitcodeFile(buffer, ctx));
+      std::unique_ptr<llvm::TargetMachine> partTM(
+          llvm::EngineBuilder().selectTarget(triple, "", cpu, mattrs));
+      objects[idx] = llvm::orc::SimpleCompiler(*partTM)(*part);
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  return objects;
+}
+
 #ifndef FACEBOOK
 /// This is a callback that is invoked when an LLVM module is compiled and
 /// loaded by the JIT for execution.
@@ -104,16 +255,45 @@ GlowJIT::GlowJIT(llvm::TargetMachine &TM)
           },
           [](Error Err) { cantFail(std::move(Err), "lookupFlags failed"); })),
       TM_(TM), DL_(TM_.createDataLayout()),
+      objectCache_(jitObjectCacheDir.empty()
+                       ? nullptr
+                       : new GlowObjectCache(jitObjectCacheDir)),
       objectLayer_(ES_,
                    [this](llvm::orc::VModuleKey) {
                      return RTDyldObjectLinkingLayer::Resources{
                          std::make_shared<SectionMemoryManager>(), resolver_};
                    }),
-      compileLayer_(objectLayer_, SimpleCompiler(TM_)) {
+      compileLayer_(objectLayer_, SimpleCompiler(TM_, objectCache_.get())) {
   llvm::sys::DynamicLibrary::LoadLibraryPermanently(nullptr);
 }
 
 llvm::orc::VModuleKey GlowJIT::addModule(std::unique_ptr<Module> M) {
+  // Split the module and compile its parts concurrently when requested. The
+  // parts resolve each other's symbols through the resolver when the objects
+  // are linked. The key of the first part stands for the whole module; the
+  // parts share the lifetime of the JIT.
+  if (jitNumThreads > 1) {
+    auto objects = compileModuleParallel(std::move(M), TM_, jitNumThreads);
+    VModuleKey firstKey = 0;
+    bool isFirst = true;
+    for (auto &obj : objects) {
+      auto K = ES_.allocateVModule();
+      cantFail(objectLayer_.addObject(
+          K, std::make_shared<object::OwningBinary<object::ObjectFile>>(
+                 std::move(obj))));
+      if (isFirst) {
+        firstKey = K;
+        isFirst = false;
+      }
+    }
+    return firstKey;
+  }
+  // Give the module an identifier that describes its contents and target, so
+  // that the on-disk object cache can use it as a key. The parallel path
+  // above compiles with its own compilers and does not consult the cache.
+  if (objectCache_) {
+    setCacheKeyIdentifier(*M, TM_);
+  }
   // Add the set to the JIT with the resolver we created above and a newly
   // created SectionMemoryManager.
   auto K = ES_.allocateVModule();
@@ -127,9 +307,12 @@ void GlowJIT::removeModule(llvm::orc::VModuleKey K) {
 #else
 GlowJIT::GlowJIT(llvm::TargetMachine &TM)
     : TM_(TM), DL_(TM_.createDataLayout()),
+      objectCache_(jitObjectCacheDir.empty()
+                       ? nullptr
+                       : new GlowObjectCache(jitObjectCacheDir)),
       objectLayer_([]() { return std::make_shared<SectionMemoryManager>(); },
                    NotifyLoadedFunctor(this)),
-      compileLayer_(objectLayer_, SimpleCompiler(TM)) {
+      compileLayer_(objectLayer_, SimpleCompiler(TM, objectCache_.get())) {
   llvm::sys::DynamicLibrary::LoadLibraryPermanently(nullptr);
 }
 
@@ -138,21 +321,48 @@ GlowJIT::ModuleHandle GlowJIT::addModule(std::unique_ptr<Module> M) {
   // Lambda 1: Look back into the JIT itself to find symbols that are part of
   //           the same "logical dylib".
   // Lambda 2: Search for external symbols in the host process.
-  auto resolver = createLambdaResolver(
-      [&](const std::string &name) {
-        if (auto sym = compileLayer_.findSymbol(name, false))
-          return sym;
-        return JITSymbol(nullptr);
-      },
-      [](const std::string &name) {
-        if (auto symAddr = RTDyldMemoryManager::getSymbolAddressInProcess(name))
-          return JITSymbol(symAddr, JITSymbolFlags::Exported);
-        return JITSymbol(nullptr);
-      });
+  auto makeResolver = [this]() {
+    return createLambdaResolver(
+        [this](const std::string &name) {
+          if (auto sym = compileLayer_.findSymbol(name, false))
+            return sym;
+          return JITSymbol(nullptr);
+        },
+        [](const std::string &name) {
+          if (auto symAddr =
+                  RTDyldMemoryManager::getSymbolAddressInProcess(name))
+            return JITSymbol(symAddr, JITSymbolFlags::Exported);
+          return JITSymbol(nullptr);
+        });
+  };
+
+  // Split the module and compile its parts concurrently when requested. The
+  // parts resolve each other's symbols through the resolver when the objects
+  // are linked. The handle of the first part stands for the whole module; the
+  // parts share the lifetime of the JIT.
+  if (jitNumThreads > 1) {
+    auto objects = compileModuleParallel(std::move(M), TM_, jitNumThreads);
+    llvm::SmallVector<ModuleHandle, 8> handles;
+    for (auto &obj : objects) {
+      auto objPtr =
+          std::make_shared<object::OwningBinary<object::ObjectFile>>(
+              std::move(obj));
+      handles.push_back(
+          cantFail(objectLayer_.addObject(std::move(objPtr), makeResolver())));
+    }
+    return handles.front();
+  }
+
+  // Give the module an identifier that describes its contents and target, so
+  // that the on-disk object cache can use it as a key. The parallel path
+  // above compiles with its own compilers and does not consult the cache.
+  if (objectCache_) {
+    setCacheKeyIdentifier(*M, TM_);
+  }
 
   // Add the set to the JIT with the resolver we created above and a newly
   // created SectionMemoryManager.
-  return cantFail(compileLayer_.addModule(std::move(M), std::move(resolver)));
+  return cantFail(compileLayer_.addModule(std::move(M), makeResolver()));
 }
 
 void GlowJIT::removeModule(GlowJIT::ModuleHandle H) {
@@ -22,6 +22,7 @@
 #include "llvm/ExecutionEngine/Orc/CompileUtils.h"
 #include "llvm/ExecutionEngine/Orc/IRCompileLayer.h"
 #include "llvm/ExecutionEngine/Orc/LambdaResolver.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
 #include "llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h"
 #include "llvm/ExecutionEngine/Orc/SymbolStringPool.h"
 #include "llvm/ExecutionEngine/RTDyldMemoryManager.h"
@@ -50,6 +51,10 @@ private:
 #endif
   TargetMachine &TM_;
   const DataLayout DL_;
+  /// An optional on-disk cache of JITted objects. When it is set, the
+  /// compiler loads previously compiled objects from disk instead of
+  /// re-running LLVM codegen for identical modules.
+  std::unique_ptr<ObjectCache> objectCache_;
   RTDyldObjectLinkingLayer objectLayer_;
   IRCompileLayer<decltype(objectLayer_), SimpleCompiler> compileLayer_;
 
@@ -0,0 +1,212 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "KernelTuner.h"
+#include "CommandLine.h"
+
+#include "glow/Support/Memory.h"
+
+#include "llvm/Support/CommandLine.h"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+using namespace glow;
+
+static llvm::cl::opt<bool>
+    kernelTuneOpt("kernel-tune",
+                  llvm::cl::desc("Micro-benchmark candidate libjit kernel "
+                                 "variants for the model's shapes during "
+                                 "compilation and emit the fastest one"),
+                  llvm::cl::init(false), llvm::cl::cat(CPUBackendCat));
+
+static llvm::cl::opt<std::string> kernelTuneCache(
+    "kernel-tune-cache",
+    llvm::cl::desc("File caching the kernel tuning decisions per host; later "
+                   "compilations of the same shapes skip the probes"),
+    llvm::cl::cat(CPUBackendCat));
+
+/// The natively compiled libjit kernels (the CPURuntimeNative library). The
+/// tuner probes these instead of JITting candidate modules; the native and
+/// the JIT copies are built from the same source, so their relative ranking
+/// carries over.
+extern "C" {
+void libjit_matmul_f(float *c, const float *a, const float *b,
+                     const size_t *cDims, const size_t *aDims,
+                     const size_t *bDims, unsigned rhsIsConstant,
+                     unsigned nthreads, unsigned usePacked);
+void libjit_convolution_f(float *outW, const float *inW, const float *filterW,
+                          const float *biasW, const size_t *outWdims,
+                          const size_t *inWdims, const size_t *filterWdims,
+                          const size_t *biasWdims, size_t filterSize,
+                          size_t stride, size_t *pads, size_t group,
+                          unsigned depthUnroll, unsigned doRelu,
+                          unsigned nthreads);
+}
+
+/// \returns a zeroed allocation of \p numFloats floats, aligned like a
+/// tensor payload so the probe sees the alignment the kernels run with.
+static float *allocProbeBuffer(size_t numFloats) {
+  auto *buf = (float *)alignedAlloc(numFloats * sizeof(float),
+                                    TensorAlignment);
+  memset(buf, 0, numFloats * sizeof(float));
+  return buf;
+}
+
+/// \returns the best of a few timed runs of \p fn, in seconds. The first,
+/// untimed run pays the one-time costs - page faults, cache warmup - that
+/// should not count against the variant.
+static double timeKernel(const std::function<void()> &fn) {
+  fn();
+  double best = std::numeric_limits<double>::max();
+  for (unsigned i = 0; i < 3; i++) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+    best = std::min(best, d.count());
+  }
+  return best;
+}
+
+KernelTuner::KernelTuner() {
+  if (kernelTuneCache.empty()) {
+    return;
+  }
+  std::ifstream in(kernelTuneCache);
+  std::string key;
+  unsigned variant;
+  while (in >> key >> variant) {
+    decisions_[key] = variant;
+  }
+}
+
+int KernelTuner::lookup(const std::string &key) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  auto it = decisions_.find(key);
+  return it == decisions_.end() ? -1 : (int)it->second;
+}
+
+unsigned
+KernelTuner::measure(const std::string &key,
+                     llvm::ArrayRef<std::function<void()>> candidates) {
+  unsigned best = 0;
+  double bestTime = std::numeric_limits<double>::max();
+  for (unsigned i = 0, e = candidates.size(); i < e; i++) {
+    double elapsed = timeKernel(candidates[i]);
+    if (elapsed < bestTime) {
+      bestTime = elapsed;
+      best = i;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mtx_);
+  decisions_[key] = best;
+  if (!kernelTuneCache.empty()) {
+    std::ofstream out(kernelTuneCache, std::ios::app);
+    out << key << " " << best << "\n";
+  }
+  return best;
+}
+
+bool KernelTuner::preferPackedMatMul(size_t m, size_t n, size_t k) {
+  std::string key = "matmul:" + std::to_string(m) + "x" + std::to_string(n) +
+                    "x" + std::to_string(k);
+  int cached = lookup(key);
+  if (cached >= 0) {
+    return cached == 1;
+  }
+
+  size_t cDims[2] = {m, n};
+  size_t aDims[2] = {m, k};
+  size_t bDims[2] = {k, n};
+  float *c = allocProbeBuffer(m * n);
+  float *a = allocProbeBuffer(m * k);
+  float *b = allocProbeBuffer(k * n);
+
+  // Probe single-threaded and with the per-call packing path: the thread
+  // sharding applies on top of either variant, and the packed-weight cache
+  // would let the first candidate pay the packing cost for both.
+  std::function<void()> candidates[] = {
+      [&] { libjit_matmul_f(c, a, b, cDims, aDims, bDims, 0, 1, 0); },
+      [&] { libjit_matmul_f(c, a, b, cDims, aDims, bDims, 0, 1, 1); },
+  };
+  unsigned best = measure(key, candidates);
+
+  alignedFree(c);
+  alignedFree(a);
+  alignedFree(b);
+  return best == 1;
+}
+
+unsigned KernelTuner::convDepthUnroll(llvm::ArrayRef<size_t> outDims,
+                                      llvm::ArrayRef<size_t> inDims,
+                                      size_t filterSize, size_t stride,
+                                      llvm::ArrayRef<size_t> pads,
+                                      size_t group) {
+  std::string key = "conv:";
+  for (auto d : outDims) {
+    key += std::to_string(d) + "x";
+  }
+  key += std::to_string(inDims[3]) + "x" + std::to_string(filterSize) + "x" +
+         std::to_string(stride) + "x" + std::to_string(pads[0]) + "x" +
+         std::to_string(group);
+  int cached = lookup(key);
+  if (cached >= 0) {
+    return cached == 1 ? 8 : 1;
+  }
+
+  size_t filterWdims[4] = {outDims[3], filterSize, filterSize,
+                           inDims[3] / group};
+  size_t biasWdims[1] = {outDims[3]};
+  size_t padsA[2] = {pads[0], pads[1]};
+  float *out = allocProbeBuffer(outDims[0] * outDims[1] * outDims[2] *
+                                outDims[3]);
+  float *in =
+      allocProbeBuffer(inDims[0] * inDims[1] * inDims[2] * inDims[3]);
+  float *filter = allocProbeBuffer(filterWdims[0] * filterWdims[1] *
+                                   filterWdims[2] * filterWdims[3]);
+  float *bias = allocProbeBuffer(outDims[3]);
+
+  std::function<void()> candidates[] = {
+      [&] {
+        libjit_convolution_f(out, in, filter, bias, outDims.data(),
+                             inDims.data(), filterWdims, biasWdims,
+                             filterSize, stride, padsA, group, 1, 0, 1);
+      },
+      [&] {
+        libjit_convolution_f(out, in, filter, bias, outDims.data(),
+                             inDims.data(), filterWdims, biasWdims,
+                             filterSize, stride, padsA, group, 8, 0, 1);
+      },
+  };
+  unsigned best = measure(key, candidates);
+
+  alignedFree(out);
+  alignedFree(in);
+  alignedFree(filter);
+  alignedFree(bias);
+  return best == 1 ? 8 : 1;
+}
+
+KernelTuner *KernelTuner::get() {
+  if (!kernelTuneOpt) {
+    return nullptr;
+  }
+  static KernelTuner tuner;
+  return &tuner;
+}
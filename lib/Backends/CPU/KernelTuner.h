@@ -0,0 +1,80 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GLOW_BACKENDS_CPU_KERNELTUNER_H
+#define GLOW_BACKENDS_CPU_KERNELTUNER_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringMap.h"
+
+#include <functional>
+#include <mutex>
+#include <string>
+
+namespace glow {
+
+/// Picks between candidate libjit kernel variants by micro-benchmarking them
+/// with the model's actual shapes during compilation. The best variant for a
+/// given shape differs per host - cache sizes, memory bandwidth and the core
+/// count all move the crossover points - so instead of hardcoded thresholds
+/// the tuner times the natively compiled copies of the kernels and the code
+/// generator bakes the winner into the call it emits. Shapes are static at
+/// compile(), so one probe per distinct shape covers the whole model; the
+/// decisions are cached per host in the -kernel-tune-cache file, so later
+/// compilations of the same shapes skip the probes entirely.
+class KernelTuner final {
+  /// The tuning decisions, keyed by "<kernel>:<shape>". Holds the loaded
+  /// per-host cache plus the decisions measured by this process.
+  llvm::StringMap<unsigned> decisions_;
+  /// Serializes the measurements and the decision table against concurrent
+  /// compilations.
+  std::mutex mtx_;
+
+  /// Ctor. Loads the decisions cached by earlier runs on this host.
+  KernelTuner();
+
+  /// \returns the cached decision for \p key, or -1 when the shape has not
+  /// been measured yet.
+  int lookup(const std::string &key);
+
+  /// Times every candidate in \p candidates, records the index of the
+  /// fastest one under \p key in the decision table and the per-host cache
+  /// file, and \returns it.
+  unsigned measure(const std::string &key,
+                   llvm::ArrayRef<std::function<void()>> candidates);
+
+public:
+  /// \returns true when the packed matmul path is faster than the unpacked
+  /// one on this host for an (m x k) * (k x n) multiplication, probing the
+  /// two variants on first sight of the shape.
+  bool preferPackedMatMul(size_t m, size_t n, size_t k);
+
+  /// \returns the faster depth-unroll factor (1 or 8) of the float
+  /// convolution kernel for the given shape, probing both variants on first
+  /// sight. The caller must only ask when unrolling by 8 is legal, i.e. the
+  /// per-group output depth is a multiple of 8.
+  unsigned convDepthUnroll(llvm::ArrayRef<size_t> outDims,
+                           llvm::ArrayRef<size_t> inDims, size_t filterSize,
+                           size_t stride, llvm::ArrayRef<size_t> pads,
+                           size_t group);
+
+  /// \returns the tuner enabled by the -kernel-tune option, or null when
+  /// autotuning is disabled.
+  static KernelTuner *get();
+};
+
+} // end namespace glow
+
+#endif // GLOW_BACKENDS_CPU_KERNELTUNER_H
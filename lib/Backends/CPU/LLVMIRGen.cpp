@@ -18,6 +18,7 @@
 
 #include "CPUBackend.h"
 #include "CommandLine.h"
+#include "KernelTuner.h"
 
 #include "glow/Graph/Graph.h"
 #include "glow/IR/IRUtils.h"
@@ -55,6 +56,50 @@ llvm::cl::opt<bool>
     emitDebugInfo("g", llvm::cl::desc("Emit debug information for debuggers"),
                   llvm::cl::init(false), llvm::cl::cat(CPUBackendCat));
 
+static llvm::cl::opt<unsigned> convNumThreads(
+    "conv-num-threads",
+    llvm::cl::desc("Number of threads that the convolution kernel shards its "
+                   "batch and output depth over (1 disables threading)"),
+    llvm::cl::init(1), llvm::cl::cat(CPUBackendCat));
+
+static llvm::cl::opt<unsigned> matmulNumThreads(
+    "matmul-num-threads",
+    llvm::cl::desc("Number of threads that the matrix multiplication kernel "
+                   "shards its row blocks over (1 disables threading)"),
+    llvm::cl::init(1), llvm::cl::cat(CPUBackendCat));
+
+static llvm::cl::opt<unsigned> lrnNumThreads(
+    "lrn-num-threads",
+    llvm::cl::desc("Number of threads that the local response normalization "
+                   "kernel shards its batch over (1 disables threading)"),
+    llvm::cl::init(1), llvm::cl::cat(CPUBackendCat));
+
+static llvm::cl::opt<bool> fastSigmoidTanh(
+    "fast-sigmoid-tanh",
+    llvm::cl::desc("Use inlinable polynomial approximations for the float "
+                   "sigmoid and tanh kernels so that LLVM can vectorize "
+                   "them, at a small cost in accuracy"),
+    llvm::cl::init(false), llvm::cl::cat(CPUBackendCat));
+
+static llvm::cl::opt<unsigned> poolNumThreads(
+    "pool-num-threads",
+    llvm::cl::desc("Number of threads that the max- and average-pooling "
+                   "kernels shard their batch over (1 disables threading)"),
+    llvm::cl::init(1), llvm::cl::cat(CPUBackendCat));
+
+static llvm::cl::opt<unsigned> gatherNumThreads(
+    "gather-num-threads",
+    llvm::cl::desc("Number of threads that large gathers shard their index "
+                   "array over (1 disables threading)"),
+    llvm::cl::init(1), llvm::cl::cat(CPUBackendCat));
+
+llvm::cl::opt<bool> instrumentKernels(
+    "instrument-kernels",
+    llvm::cl::desc("Instrument the generated code with cycle counters that "
+                   "accumulate the time spent in each kernel call into a "
+                   "per-instruction table"),
+    llvm::cl::init(false), llvm::cl::cat(CPUBackendCat));
+
 /// Generate the LLVM MAttr list of attributes.
 static llvm::SmallVector<std::string, 0> getMachineAttributes() {
   llvm::SmallVector<std::string, 0> result;
@@ -222,10 +267,16 @@ llvm::Type *LLVMIRGen::getElementType(llvm::IRBuilder<> &builder,
   switch (val->getElementType()) {
   case ElemKind::IndexTy:
     return builder.getIntNTy(sizeof(size_t) * 8);
+  case ElemKind::Int32ITy:
+    return builder.getInt32Ty();
   case ElemKind::FloatTy:
     return builder.getFloatTy();
+  case ElemKind::Float16Ty:
+    return builder.getHalfTy();
   case ElemKind::Int8QTy:
     return builder.getInt8Ty();
+  case ElemKind::Int16QTy:
+    return builder.getInt16Ty();
   case ElemKind::Int32QTy:
     return builder.getInt32Ty();
   }
@@ -261,6 +312,10 @@ void LLVMIRGen::performCodeGen() {
   // Optimize the module.
   optimizeLLVMModule(func, getTargetMachine());
 
+  // Optionally emit ISA-specialized clones of the entry functions with a
+  // CPUID-based dispatcher.
+  multiversionEntryFunctions();
+
   // Generate debug information.
   generateDebugInfo();
 
@@ -299,6 +354,9 @@ llvm::Value *LLVMIRGen::emitValueAddress(llvm::IRBuilder<> &builder,
   case ElemKind::IndexTy:
     T = sizeTTy->getPointerTo();
     break;
+  case ElemKind::Int32ITy:
+    T = llvm::Type::getInt32PtrTy(ctx_);
+    break;
   default:
     llvm_unreachable("Unimplemented");
     break;
@@ -360,6 +418,82 @@ LLVMIRGen::emitConstOffsetsArray(llvm::IRBuilder<> &builder,
   return constArrayVar;
 }
 
+llvm::Value *LLVMIRGen::emitKernelProfileStart(llvm::IRBuilder<> &builder) {
+  if (!instrumentKernels) {
+    return nullptr;
+  }
+  auto *readCycleCounter = llvm::Intrinsic::getDeclaration(
+      llmodule_.get(), llvm::Intrinsic::readcyclecounter);
+  return builder.CreateCall(readCycleCounter, {});
+}
+
+void LLVMIRGen::emitKernelProfileEnd(llvm::IRBuilder<> &builder,
+                                     llvm::Value *start,
+                                     llvm::StringRef name) {
+  if (!start) {
+    return;
+  }
+  auto *int64Ty = builder.getInt64Ty();
+  // Create the cycle table lazily. The number of instructions is an upper
+  // bound on the number of slots it may need.
+  if (!kernelProfileCycles_) {
+    auto *tableTy = llvm::ArrayType::get(int64Ty, F_->getInstrs().size());
+    kernelProfileCycles_ = new llvm::GlobalVariable(
+        *llmodule_, tableTy, false, llvm::GlobalValue::ExternalLinkage,
+        llvm::ConstantAggregateZero::get(tableTy), "kernelProfileCycles");
+  }
+  size_t slot = kernelProfileNames_.size();
+  kernelProfileNames_.push_back(
+      cast<llvm::Constant>(emitStringConst(builder, name)));
+  auto *readCycleCounter = llvm::Intrinsic::getDeclaration(
+      llmodule_.get(), llvm::Intrinsic::readcyclecounter);
+  auto *end = builder.CreateCall(readCycleCounter, {});
+  auto *elapsed = builder.CreateSub(end, start);
+  auto *table =
+      builder.CreateBitCast(kernelProfileCycles_, int64Ty->getPointerTo());
+  auto *slotAddr = builder.CreateGEP(int64Ty, table, builder.getInt64(slot));
+  auto *accumulated = builder.CreateLoad(int64Ty, slotAddr);
+  builder.CreateStore(builder.CreateAdd(accumulated, elapsed), slotAddr);
+}
+
+void LLVMIRGen::emitKernelProfileTables() {
+  if (kernelProfileNames_.empty()) {
+    return;
+  }
+  // Emit the table with the names of the instrumented kernels and the number
+  // of used slots, so that clients can retrieve and report the profile. The
+  // symbols are external and thus survive the internalization of the module.
+  auto *int8PtrTy = llvm::Type::getInt8PtrTy(ctx_);
+  auto *namesArr = llvm::ConstantArray::get(
+      llvm::ArrayType::get(int8PtrTy, kernelProfileNames_.size()),
+      kernelProfileNames_);
+  new llvm::GlobalVariable(*llmodule_, namesArr->getType(), true,
+                           llvm::GlobalValue::ExternalLinkage, namesArr,
+                           "kernelProfileNames");
+  auto *int64Ty = llvm::Type::getInt64Ty(ctx_);
+  new llvm::GlobalVariable(
+      *llmodule_, int64Ty, true, llvm::GlobalValue::ExternalLinkage,
+      llvm::ConstantInt::get(int64Ty, kernelProfileNames_.size()),
+      "kernelProfileSize");
+}
+
+void LLVMIRGen::emitWeightPagerAdvance(llvm::IRBuilder<> &builder,
+                                       size_t instrIdx) {
+  if (weightPagerScheduleId_ == (size_t)-1) {
+    return;
+  }
+  // The hook is an external symbol that the JIT resolves to the pager entry
+  // point in the process.
+  auto *int64Ty = builder.getInt64Ty();
+  auto *voidTy = llvm::Type::getVoidTy(ctx_);
+  auto *hookTy = llvm::FunctionType::get(voidTy, {int64Ty, int64Ty}, false);
+  auto *hook = cast<llvm::Function>(
+      llmodule_->getOrInsertFunction("glow_weight_pager_advance", hookTy));
+  builder.CreateCall(hook,
+                     {llvm::ConstantInt::get(int64Ty, weightPagerScheduleId_),
+                      llvm::ConstantInt::get(int64Ty, instrIdx)});
+}
+
 llvm::Value *LLVMIRGen::emitConstArray(llvm::IRBuilder<> &builder,
                                        llvm::ArrayRef<size_t> vals) {
   auto SizeTType = builder.getIntNTy(sizeof(size_t) * 8);
@@ -427,10 +561,16 @@ llvm::Value *LLVMIRGen::emitConst(llvm::IRBuilder<> &builder, float val,
   switch (kind) {
   case ElemKind::FloatTy:
     return llvm::ConstantFP::get(llvm::Type::getFloatTy(ctx_), val);
+  case ElemKind::Float16Ty:
+    return llvm::ConstantFP::get(llvm::Type::getHalfTy(ctx_), val);
   case ElemKind::IndexTy:
     return builder.getIntN(sizeof(size_t) * 8, static_cast<size_t>(val));
+  case ElemKind::Int32ITy:
+    return builder.getInt32(static_cast<int32_t>(val));
   case ElemKind::Int8QTy:
     return builder.getInt8(static_cast<int8_t>(val));
+  case ElemKind::Int16QTy:
+    return builder.getInt16(static_cast<int16_t>(val));
   case ElemKind::Int32QTy:
     return builder.getInt32(static_cast<int32_t>(val));
   }
@@ -484,6 +624,8 @@ llvm::Function *LLVMIRGen::getFunction(const std::string &name,
     return get("libjit_" + name + "_i32");
   case ElemKind::IndexTy:
     return get("libjit_" + name + "_u");
+  case ElemKind::Int32ITy:
+    return get("libjit_" + name + "_u32");
   default:
     GLOW_UNREACHABLE("Unsupported element type");
   }
@@ -576,6 +718,14 @@ void LLVMIRGen::emitDataParallelKernel(
     llvm::IRBuilder<> &builder, llvm::ArrayRef<const Instruction *> bundle) {
   if (bundle.empty())
     return;
+  // A bundle that consists of a single quantized arithmetic instruction is
+  // emitted as a call to its fused whole-buffer kernel, which keeps the
+  // rescale-operate-clamp pipeline in integer vector registers. Longer
+  // bundles keep using the generated stacked kernel, which fuses the chain.
+  if (bundle.size() == 1 &&
+      emitQuantizedFusedElementwiseKernel(builder, bundle[0])) {
+    return;
+  }
   llvm::Type *voidTy = llvm::Type::getVoidTy(ctx_);
   // Types of arguments for the kernel function being generated.
   llvm::SmallVector<llvm::Type *, 32> argTypes;
@@ -637,8 +787,103 @@ void LLVMIRGen::emitDataParallelKernel(
   // Add a return.
   kernelBuilder.CreateRetVoid();
 
-  // Emit a call of the kernel.
+  // Emit a call of the kernel. When instrumentation is enabled, the cycles
+  // spent in the whole bundle are attributed to its first instruction.
+  auto *profileStart = emitKernelProfileStart(builder);
   createCall(builder, kernelFunc, buffers);
+  emitKernelProfileEnd(builder, profileStart,
+                       (llvm::Twine("StackedKernel ") + bundle[0]->getName())
+                           .str());
+}
+
+bool LLVMIRGen::emitQuantizedFusedElementwiseKernel(
+    llvm::IRBuilder<> &builder, const glow::Instruction *I) {
+  Value *dest = nullptr;
+  Value *lhs = nullptr;
+  Value *rhs = nullptr;
+  const char *funcName = nullptr;
+  // Whether the operation rescales once after operating, like the
+  // multiplicative mini-kernels, instead of rescaling both operands.
+  bool singleRescale = false;
+
+  switch (I->getKind()) {
+#define FUSED_ARITHMETIC_CASE(INST_NAME_, FUN_NAME_, SINGLE_RESCALE_)          \
+  case Kinded::Kind::INST_NAME_##InstKind: {                                   \
+    auto *AN = cast<INST_NAME_##Inst>(I);                                      \
+    dest = AN->getDest();                                                      \
+    lhs = AN->getLHS();                                                        \
+    rhs = AN->getRHS();                                                        \
+    funcName = FUN_NAME_;                                                      \
+    singleRescale = SINGLE_RESCALE_;                                           \
+    break;                                                                     \
+  }
+    FUSED_ARITHMETIC_CASE(ElementAdd, "element_add", false);
+    FUSED_ARITHMETIC_CASE(ElementSub, "element_sub", false);
+    FUSED_ARITHMETIC_CASE(ElementMax, "elementmax", false);
+    FUSED_ARITHMETIC_CASE(ElementMin, "elementmin", false);
+    FUSED_ARITHMETIC_CASE(ElementMul, "element_mul", true);
+    FUSED_ARITHMETIC_CASE(ElementDiv, "element_div", true);
+#undef FUSED_ARITHMETIC_CASE
+  default:
+    return false;
+  }
+
+  if (!lhs->getType()->isQuantizedType()) {
+    return false;
+  }
+
+  setCurrentDebugLocation(builder, I);
+  auto *destPtr = emitValueAddress(builder, dest);
+  auto *lhsPtr = emitValueAddress(builder, lhs);
+  auto *rhsPtr = emitValueAddress(builder, rhs);
+  auto *numElem = emitConstSizeT(builder, dest->size());
+
+  auto *destTy = dest->getType();
+  auto *lhsTy = lhs->getType();
+  auto *rhsTy = rhs->getType();
+  auto *destOffset = emitConstI32(builder, destTy->getOffset());
+  auto *lhsOffset = emitConstI32(builder, lhsTy->getOffset());
+  auto *rhsOffset = emitConstI32(builder, rhsTy->getOffset());
+
+  auto *F = getFunction(funcName, dest->getElementType());
+  auto *profileStart = emitKernelProfileStart(builder);
+  if (singleRescale) {
+    // The single rescale factor follows the corresponding mini-kernels:
+    // s_l * s_r / s_d for multiplication and s_l / (s_r * s_d) for division.
+    float scale =
+        I->getKind() == Kinded::Kind::ElementMulInstKind
+            ? lhsTy->getScale() * rhsTy->getScale() / destTy->getScale()
+            : lhsTy->getScale() / (rhsTy->getScale() * destTy->getScale());
+    auto scaleParams = quantization::quantizeScaleOffset32To8(scale, 0);
+    auto *pre = emitConstI32(builder, scaleParams.pre);
+    auto *post = emitConstI32(builder, scaleParams.post);
+    auto *scaleVal = emitConstI32(builder, scaleParams.scale);
+    createCall(builder, F,
+               {destPtr, lhsPtr, rhsPtr, numElem, destOffset, lhsOffset,
+                rhsOffset, pre, post, scaleVal});
+  } else {
+    // Both operands are rescaled into the destination domain first, exactly
+    // like in the corresponding mini-kernels.
+    float destScale = destTy->getScale();
+    auto lhsScaleParams = quantization::quantizeScaleOffset32To8(
+        lhsTy->getScale() / destScale, lhsTy->getOffset());
+    auto rhsScaleParams = quantization::quantizeScaleOffset32To8(
+        rhsTy->getScale() / destScale, rhsTy->getOffset());
+    auto *lhsPre = emitConstI32(builder, lhsScaleParams.pre);
+    auto *lhsPost = emitConstI32(builder, lhsScaleParams.post);
+    auto *lhsScale = emitConstI32(builder, lhsScaleParams.scale);
+    auto *rhsPre = emitConstI32(builder, rhsScaleParams.pre);
+    auto *rhsPost = emitConstI32(builder, rhsScaleParams.post);
+    auto *rhsScale = emitConstI32(builder, rhsScaleParams.scale);
+    createCall(builder, F,
+               {destPtr, lhsPtr, rhsPtr, numElem, destOffset, lhsOffset,
+                rhsOffset, lhsPre, lhsPost, lhsScale, rhsPre, rhsPost,
+                rhsScale});
+  }
+  emitKernelProfileEnd(
+      builder, profileStart,
+      (llvm::Twine(I->getKindName()) + " " + I->getName()).str());
+  return true;
 }
 
 /// Check if the provided operand overlaps with an operand of an instruction
@@ -681,7 +926,9 @@ void LLVMIRGen::generateLLVMIRForModule(llvm::IRBuilder<> &builder) {
   // Group instructions into bundles of shape compatible data parallel
   // instructions and emit them.
   llvm::SmallVector<const Instruction *, 32> bundle;
+  size_t instrIdx = 0;
   for (auto &I : instrs) {
+    size_t curInstrIdx = instrIdx++;
     if (!I.isDataParallel()) {
       // Ignore memory management instructions as they are handled by the
       // MemoryManager and are NOPs for a JIT.
@@ -690,7 +937,14 @@ void LLVMIRGen::generateLLVMIRForModule(llvm::IRBuilder<> &builder) {
         continue;
       emitDataParallelKernel(builder, bundle);
       bundle.clear();
+      // Let the weight pager evict the weights that are done and prefetch
+      // the ones the upcoming instructions need.
+      emitWeightPagerAdvance(builder, curInstrIdx);
+      auto *profileStart = emitKernelProfileStart(builder);
       generateLLVMIRForInstr(builder, &I);
+      emitKernelProfileEnd(builder, profileStart,
+                           (llvm::Twine(I.getKindName()) + " " + I.getName())
+                               .str());
       continue;
     }
 
@@ -734,6 +988,9 @@ void LLVMIRGen::generateLLVMIRForModule(llvm::IRBuilder<> &builder) {
   }
 
   emitDataParallelKernel(builder, bundle);
+
+  // Emit the tables describing the instrumented kernels, if any.
+  emitKernelProfileTables();
 }
 
 void LLVMIRGen::generateLLVMIRForDataParallelInstr(
@@ -865,7 +1122,7 @@ void LLVMIRGen::generateLLVMIRForDataParallelInstr(
     auto *destPtr = emitBufferAddress(builder, dest, kernel, bufferToArgNum);  \
     auto *srcPtr =                                                             \
         emitBufferAddress(builder, AN->getSrc(), kernel, bufferToArgNum);      \
-    auto *F = getFunction(FUN_NAME_ "_kernel", dest->getElementType());        \
+    auto *F = getFunction(FUN_NAME_, dest->getElementType());                  \
     auto *elementTy = getElementType(builder, dest);                           \
     auto *pointerNull =                                                        \
         llvm::ConstantPointerNull::get(elementTy->getPointerTo());             \
@@ -877,9 +1134,12 @@ void LLVMIRGen::generateLLVMIRForDataParallelInstr(
     break;                                                                     \
   }
 
-    ARITHMETIC_UNARY_OP_CASE(Sigmoid, "sigmoid");
-    ARITHMETIC_UNARY_OP_CASE(Tanh, "tanh");
-    ARITHMETIC_UNARY_OP_CASE(ElementLog, "element_log");
+    ARITHMETIC_UNARY_OP_CASE(Sigmoid, fastSigmoidTanh ? "sigmoid_fast_kernel"
+                                                      : "sigmoid_kernel");
+    ARITHMETIC_UNARY_OP_CASE(Tanh,
+                             fastSigmoidTanh ? "tanh_fast_kernel"
+                                             : "tanh_kernel");
+    ARITHMETIC_UNARY_OP_CASE(ElementLog, "element_log_kernel");
 #undef ARITHMETIC_UNARY_OP_CASE
 
   case Kinded::Kind::CopyInstKind: {
@@ -934,6 +1194,33 @@ void LLVMIRGen::generateLLVMIRForDataParallelInstr(
     break;
   }
 
+  case Kinded::Kind::CPUMulSplatInstKind:
+  case Kinded::Kind::CPUSubSplatInstKind: {
+    // Float-only splat-immediate arithmetic; the post-lowering transform does
+    // not form these for quantized types.
+    auto *dest = I->getOperand(0).first;
+    auto *src = I->getOperand(1).first;
+    assert(!dest->getType()->isQuantizedType() &&
+           "Quantized splat-immediate arithmetic is not supported");
+    float V = isa<CPUMulSplatInst>(I) ? cast<CPUMulSplatInst>(I)->getSplatValue()
+                                      : cast<CPUSubSplatInst>(I)->getSplatValue();
+    const char *funcName = isa<CPUMulSplatInst>(I) ? "element_mulsplat_kernel"
+                                                   : "element_subsplat_kernel";
+    auto *destPtr = emitBufferAddress(builder, dest, kernel, bufferToArgNum);
+    auto *srcPtr = emitBufferAddress(builder, src, kernel, bufferToArgNum);
+    auto *F = getFunction(funcName, dest->getElementType());
+    auto *elementTy = getElementType(builder, dest);
+    auto *pointerNull =
+        llvm::ConstantPointerNull::get(elementTy->getPointerTo());
+    auto *val = emitConst(builder, V, src->getElementType());
+    auto *stackedOpCall =
+        createCall(builder, F, {loopCount, val, srcPtr, pointerNull});
+    auto *destAddr = builder.CreateGEP(builder.getFloatTy(), destPtr,
+                                       loopCount, "buffer.element.addr");
+    builder.CreateStore(stackedOpCall, destAddr);
+    break;
+  }
+
 #undef ARITHMETIC_UNARY_OP_CASE
 
 #define ARITHMETIC_BINARY_OP_CASE(INST_NAME_, FUN_NAME_)                       \
@@ -1246,9 +1533,40 @@ void LLVMIRGen::generateLLVMIRForInstr(llvm::IRBuilder<> &builder,
       createCall(builder, F,
                  {destPtr, lhsPtr, rhsPtr, destDims, lhsDims, rhsDims,
                   destOffset, lhsOffset, rhsOffset, outPre, outPost, outScale});
+    } else if (rhs->getType()->isSparse()) {
+      // A CSR-encoded RHS (a pruned weight matrix) goes to the sparse
+      // kernel, whose cost is proportional to the number of non-zeros.
+      auto *numNonZeros =
+          emitConstSizeT(builder, rhs->getType()->getNumNonZeros());
+      auto *csrF = getFunction("matmul_csr", dest->getElementType());
+      createCall(builder, csrF,
+                 {destPtr, lhsPtr, rhsPtr, destDims, lhsDims, numNonZeros});
     } else {
+      // Constant weights keep a stable address for the lifetime of the
+      // compiled function, so the kernel can cache their packed form across
+      // calls instead of repacking on every inference.
+      auto rhsNumberIt = allocationsInfo_.valueNumbers_.find(rhs);
+      bool rhsIsConstant =
+          rhsNumberIt != allocationsInfo_.valueNumbers_.end() &&
+          rhsNumberIt->second.first ==
+              AllocationsInfo::ValueKind::ConstantWeight;
+      auto *cacheRHS = emitConstI32(builder, rhsIsConstant ? 1 : 0);
+      auto *nthreads =
+          emitConstI32(builder, matmulNumThreads < 1 ? 1 : matmulNumThreads);
+      // Select the packed or the unpacked outer kernel. The default mirrors
+      // the kernel's pack_threshold heuristic; with -kernel-tune the two
+      // variants are probed for this shape and the faster one wins.
+      size_t m = dest->dims()[0];
+      size_t n = dest->dims()[1];
+      size_t k = lhs->dims()[1];
+      bool packed = n >= 1024;
+      if (auto *tuner = KernelTuner::get()) {
+        packed = tuner->preferPackedMatMul(m, n, k);
+      }
+      auto *usePacked = emitConstI32(builder, packed ? 1 : 0);
       createCall(builder, F,
-                 {destPtr, lhsPtr, rhsPtr, destDims, lhsDims, rhsDims});
+                 {destPtr, lhsPtr, rhsPtr, destDims, lhsDims, rhsDims, cacheRHS,
+                  nthreads, usePacked});
     }
     break;
   }
@@ -1386,6 +1704,15 @@ void LLVMIRGen::generateLLVMIRForInstr(llvm::IRBuilder<> &builder,
     bool groupDividedBy8 = ((destDepth / CI->getGroup()) % 8) == 0;
     if (groupDividedBy8) {
       unrollDFactor = 8;
+      // With -kernel-tune the unroll factor is not assumed: both variants
+      // are probed for this shape and the faster one is emitted.
+      if (!src->getType()->isQuantizedType()) {
+        if (auto *tuner = KernelTuner::get()) {
+          unrollDFactor = tuner->convDepthUnroll(
+              dest->dims(), src->dims(), CI->getKernel(), CI->getStride(),
+              CI->getPads(), CI->getGroup());
+        }
+      }
     }
 
     auto *unrollD = emitConstI32(builder, unrollDFactor);
@@ -1400,27 +1727,53 @@ void LLVMIRGen::generateLLVMIRForInstr(llvm::IRBuilder<> &builder,
 
       auto *destOffset = emitConstI32(builder, destTy->getOffset());
       auto *srcOffset = emitConstI32(builder, srcTy->getOffset());
-      auto *filterOffset = emitConstI32(builder, filterTy->getOffset());
       auto *biasOffset = emitConstI32(builder, biasTy->getOffset());
 
-      // Calculate the scale of the values that come out of the matrix
-      // multiplication part of the calculation.
-      float matMulScale = srcTy->getScale() * filterTy->getScale();
-
-      // Calculate the sacling parameters for the bias and output.
-      auto biasScaleParam = quantization::quantizeScaleOffset32To8(
-          biasTy->getScale() / matMulScale, biasTy->getOffset());
-      auto outScaleParam = quantization::quantizeScaleOffset32To8(
-          matMulScale / destTy->getScale(), 0);
+      // The kernel takes one filter offset and one set of bias/output
+      // scaling parameters per output channel. A channelwise-quantized
+      // filter provides per-channel values; a per-tensor filter broadcasts
+      // the same parameters to every channel.
+      bool channelwise = filterTy->isChannelwiseQuantized();
+      auto *int32Ty = builder.getInt32Ty();
+      llvm::SmallVector<llvm::Constant *, 16> filterOffsetsV, biasPreV,
+          biasPostV, biasScaleV, outPreV, outPostV, outScaleV;
+      for (size_t c = 0; c < destDepth; c++) {
+        float filterScale =
+            channelwise ? filterTy->getChannelScales()[c] : filterTy->getScale();
+        int32_t filterOff =
+            channelwise ? filterTy->getChannelOffsets()[c] : filterTy->getOffset();
+
+        // Calculate the scale of the values that come out of the matrix
+        // multiplication part of the calculation.
+        float matMulScale = srcTy->getScale() * filterScale;
+
+        // Calculate the sacling parameters for the bias and output.
+        auto biasScaleParam = quantization::quantizeScaleOffset32To8(
+            biasTy->getScale() / matMulScale, biasTy->getOffset());
+        auto outScaleParam = quantization::quantizeScaleOffset32To8(
+            matMulScale / destTy->getScale(), 0);
+
+        filterOffsetsV.push_back(llvm::ConstantInt::get(int32Ty, filterOff));
+        biasPreV.push_back(llvm::ConstantInt::get(int32Ty, biasScaleParam.pre));
+        biasPostV.push_back(
+            llvm::ConstantInt::get(int32Ty, biasScaleParam.post));
+        biasScaleV.push_back(
+            llvm::ConstantInt::get(int32Ty, biasScaleParam.scale));
+        outPreV.push_back(llvm::ConstantInt::get(int32Ty, outScaleParam.pre));
+        outPostV.push_back(llvm::ConstantInt::get(int32Ty, outScaleParam.post));
+        outScaleV.push_back(
+            llvm::ConstantInt::get(int32Ty, outScaleParam.scale));
+      }
 
-      // Pass the pre-shift, post-shift and integer scale parameters for the
-      // bias and output calculation.
-      auto *biasPre = emitConstI32(builder, biasScaleParam.pre);
-      auto *biasPost = emitConstI32(builder, biasScaleParam.post);
-      auto *biasScale = emitConstI32(builder, biasScaleParam.scale);
-      auto *outPre = emitConstI32(builder, outScaleParam.pre);
-      auto *outPost = emitConstI32(builder, outScaleParam.post);
-      auto *outScale = emitConstI32(builder, outScaleParam.scale);
+      // Pass the per-channel filter offsets and the pre-shift, post-shift
+      // and integer scale parameters for the bias and output calculation.
+      auto *filterOffset = emitConstArray(builder, filterOffsetsV, int32Ty);
+      auto *biasPre = emitConstArray(builder, biasPreV, int32Ty);
+      auto *biasPost = emitConstArray(builder, biasPostV, int32Ty);
+      auto *biasScale = emitConstArray(builder, biasScaleV, int32Ty);
+      auto *outPre = emitConstArray(builder, outPreV, int32Ty);
+      auto *outPost = emitConstArray(builder, outPostV, int32Ty);
+      auto *outScale = emitConstArray(builder, outScaleV, int32Ty);
 
       createCall(builder, F,
                  {destPtr,    srcPtr,     filterPtr,  biasPtr,   destDims,
@@ -1429,13 +1782,87 @@ void LLVMIRGen::generateLLVMIRForInstr(llvm::IRBuilder<> &builder,
                   biasOffset, biasPre,    biasPost,   biasScale, outPre,
                   outPost,    outScale,   unrollD});
     } else {
+      // Tell the kernel how many threads to shard the batch and the output
+      // depth over. The value is fixed at codegen time, so a run with one
+      // thread folds the whole threading path away.
+      auto *nthreads =
+          emitConstI32(builder, convNumThreads < 1 ? 1 : convNumThreads);
+      auto *doRelu = emitConstI32(builder, 0);
       createCall(builder, F,
                  {destPtr, srcPtr, filterPtr, biasPtr, destDims, srcDims,
-                  filterDims, biasDims, kernel, stride, pads, group, unrollD});
+                  filterDims, biasDims, kernel, stride, pads, group, unrollD,
+                  doRelu, nthreads});
     }
     break;
   }
 
+  case Kinded::Kind::CPUConvReluInstKind: {
+    auto *CI = cast<CPUConvReluInst>(I);
+    auto *dest = CI->getDest();
+    auto *src = CI->getSrc();
+    auto *filter = CI->getFilter();
+    auto *bias = CI->getBias();
+    auto *destPtr = emitValueAddress(builder, dest);
+    auto *srcPtr = emitValueAddress(builder, src);
+    auto *filterPtr = emitValueAddress(builder, filter);
+    auto *biasPtr = emitValueAddress(builder, bias);
+
+    auto *destDims = emitValueDims(builder, dest);
+    auto *srcDims = emitValueDims(builder, src);
+    auto *filterDims = emitValueDims(builder, filter);
+    auto *biasDims = emitValueDims(builder, bias);
+
+    auto *kernel = emitConstSizeT(builder, CI->getKernel());
+    auto *stride = emitConstSizeT(builder, CI->getStride());
+    auto *pads = emitConstArray(builder, CI->getPads());
+    auto *group = emitConstSizeT(builder, CI->getGroup());
+
+    // Same depth blocking as the plain convolution above; the only
+    // difference is the relu folded into the final accumulating store.
+    unsigned unrollDFactor = 1;
+    if (((dest->dims()[3] / CI->getGroup()) % 8) == 0) {
+      unrollDFactor = 8;
+      if (auto *tuner = KernelTuner::get()) {
+        unrollDFactor = tuner->convDepthUnroll(dest->dims(), src->dims(),
+                                               CI->getKernel(), CI->getStride(),
+                                               CI->getPads(), CI->getGroup());
+      }
+    }
+    auto *unrollD = emitConstI32(builder, unrollDFactor);
+    auto *doRelu = emitConstI32(builder, 1);
+    auto *nthreads =
+        emitConstI32(builder, convNumThreads < 1 ? 1 : convNumThreads);
+
+    auto *F = getFunction("convolution", dest->getElementType());
+    createCall(builder, F,
+               {destPtr, srcPtr, filterPtr, biasPtr, destDims, srcDims,
+                filterDims, biasDims, kernel, stride, pads, group, unrollD,
+                doRelu, nthreads});
+    break;
+  }
+
+  case Kinded::Kind::CPUFCReluInstKind: {
+    auto *CI = cast<CPUFCReluInst>(I);
+    auto *dest = CI->getDest();
+    auto *src = CI->getSrc();
+    auto *weights = CI->getWeights();
+    auto *bias = CI->getBias();
+    auto *destPtr = emitValueAddress(builder, dest);
+    auto *srcPtr = emitValueAddress(builder, src);
+    auto *weightsPtr = emitValueAddress(builder, weights);
+    auto *biasPtr = emitValueAddress(builder, bias);
+
+    auto *destDims = emitValueDims(builder, dest);
+    auto *srcDims = emitValueDims(builder, src);
+    auto *weightsDims = emitValueDims(builder, weights);
+
+    auto *F = getFunction("fc_relu", dest->getElementType());
+    createCall(builder, F,
+               {destPtr, srcPtr, weightsPtr, biasPtr, destDims, srcDims,
+                weightsDims});
+    break;
+  }
+
   case Kinded::Kind::CPUConvDKKC8InstKind: {
     auto *CI = cast<CPUConvDKKC8Inst>(I);
     auto *dest = CI->getDest();
@@ -1507,6 +1934,51 @@ void LLVMIRGen::generateLLVMIRForInstr(llvm::IRBuilder<> &builder,
     break;
   }
 
+  case Kinded::Kind::CPUConvPoolInstKind: {
+    auto *CP = cast<CPUConvPoolInst>(I);
+    auto *dest = CP->getDest();
+    auto *src = CP->getSrc();
+    auto *filter = CP->getFilter();
+    auto *bias = CP->getBias();
+    auto *destPtr = emitValueAddress(builder, dest);
+    auto *srcPtr = emitValueAddress(builder, src);
+    auto *filterPtr = emitValueAddress(builder, filter);
+    auto *biasPtr = emitValueAddress(builder, bias);
+
+    auto *destDims = emitValueDims(builder, dest);
+    auto *srcDims = emitValueDims(builder, src);
+    auto *filterDims = emitValueDims(builder, filter);
+    auto *biasDims = emitValueDims(builder, bias);
+
+    // The shape of the convolution activation. The kernel only ever
+    // materializes a ring buffer of pool-window-high row strips of it; the
+    // whole tensor never exists in memory.
+    auto convSz = calculateConvPoolOutputDims(src->dims()[1], src->dims()[2],
+                                              CP->getConvKernel(),
+                                              CP->getConvStride(),
+                                              CP->getConvPads());
+    llvm::SmallVector<size_t, 4> convShape = {src->dims()[0], convSz.first,
+                                              convSz.second,
+                                              filter->dims()[0]};
+    auto *convDims = emitConstArray(builder, convShape);
+
+    auto *convKernel = emitConstSizeT(builder, CP->getConvKernel());
+    auto *convStride = emitConstSizeT(builder, CP->getConvStride());
+    auto *convPads = emitConstArray(builder, CP->getConvPads());
+    auto *group = emitConstSizeT(builder, CP->getGroup());
+    auto *doRelu = emitConstI32(builder, CP->getDoRelu());
+    auto *poolKernel = emitConstSizeT(builder, CP->getPoolKernel());
+    auto *poolStride = emitConstSizeT(builder, CP->getPoolStride());
+    auto *poolPads = emitConstArray(builder, CP->getPoolPads());
+
+    auto *F = getFunction("conv_pool_max", dest->getElementType());
+    createCall(builder, F,
+               {destPtr, srcPtr, filterPtr, biasPtr, destDims, srcDims,
+                filterDims, biasDims, convDims, convKernel, convStride,
+                convPads, group, doRelu, poolKernel, poolStride, poolPads});
+    break;
+  }
+
   case Kinded::Kind::ConvolutionGradInstKind: {
     auto *CG = cast<ConvolutionGradInst>(I);
     auto *srcGrad = CG->getSrcGrad();
@@ -1567,12 +2039,14 @@ void LLVMIRGen::generateLLVMIRForInstr(llvm::IRBuilder<> &builder,
     auto *alpha = emitConstF32(builder, LRN->getAlpha());
     auto *beta = emitConstF32(builder, LRN->getBeta());
     auto *k = emitConstF32(builder, LRN->getK());
+    auto *nthreads =
+        emitConstI32(builder, lrnNumThreads < 1 ? 1 : lrnNumThreads);
 
     auto *F =
         getFunction("local_response_normalization", dest->getElementType());
     createCall(builder, F,
                {destPtr, srcPtr, scalePtr, destDims, srcDims, halfWindow, alpha,
-                beta, k});
+                beta, k, nthreads});
     break;
   }
 
@@ -1600,6 +2074,28 @@ void LLVMIRGen::generateLLVMIRForInstr(llvm::IRBuilder<> &builder,
     break;
   }
 
+  case Kinded::Kind::BatchMatMulInstKind: {
+    auto *BMM = cast<BatchMatMulInst>(I);
+    auto *dest = BMM->getDest();
+    auto *lhs = BMM->getLHS();
+    auto *rhs = BMM->getRHS();
+    auto *destPtr = emitValueAddress(builder, dest);
+    auto *lhsPtr = emitValueAddress(builder, lhs);
+    auto *rhsPtr = emitValueAddress(builder, rhs);
+
+    auto *destDims = emitValueDims(builder, dest);
+    auto *lhsDims = emitValueDims(builder, lhs);
+    auto *rhsDims = emitValueDims(builder, rhs);
+
+    auto *nthreads =
+        emitConstI32(builder, matmulNumThreads < 1 ? 1 : matmulNumThreads);
+
+    auto *F = getFunction("batchmatmul", dest->getElementType());
+    createCall(builder, F,
+               {destPtr, lhsPtr, rhsPtr, destDims, lhsDims, rhsDims, nthreads});
+    break;
+  }
+
   case Kinded::Kind::PoolMaxInstKind: {
     auto *PM = cast<PoolMaxInst>(I);
     auto *dest = PM->getDest();
@@ -1615,8 +2111,16 @@ void LLVMIRGen::generateLLVMIRForInstr(llvm::IRBuilder<> &builder,
     auto *pads = emitConstArray(builder, PM->getPads());
 
     auto *F = getFunction("pool_max", dest->getElementType());
-    createCall(builder, F,
-               {srcPtr, destPtr, srcDims, destDims, kernel, stride, pads});
+    if (src->getType()->isQuantizedType()) {
+      createCall(builder, F,
+                 {srcPtr, destPtr, srcDims, destDims, kernel, stride, pads});
+    } else {
+      auto *nthreads =
+          emitConstI32(builder, poolNumThreads < 1 ? 1 : poolNumThreads);
+      createCall(builder, F,
+                 {srcPtr, destPtr, srcDims, destDims, kernel, stride, pads,
+                  nthreads});
+    }
     break;
   }
 
@@ -1693,9 +2197,12 @@ void LLVMIRGen::generateLLVMIRForInstr(llvm::IRBuilder<> &builder,
                   destOffset, srcOffset, outPre, outPost, outScale});
       break;
     } else {
+      auto *nthreads =
+          emitConstI32(builder, poolNumThreads < 1 ? 1 : poolNumThreads);
       auto *F = getFunction("pool_avg", dest->getElementType());
       createCall(builder, F,
-                 {srcPtr, destPtr, srcDims, destDims, kernel, stride, pads});
+                 {srcPtr, destPtr, srcDims, destDims, kernel, stride, pads,
+                  nthreads});
       break;
     }
   }
@@ -1824,12 +2331,33 @@ void LLVMIRGen::generateLLVMIRForInstr(llvm::IRBuilder<> &builder,
     auto *n = emitConstSizeT(builder, input->dims().back());
     auto *size = emitConstSizeT(builder, input->size());
 
-    auto *F = getFunction("topk", input->getElementType());
+    // The "32" kernel variants consume compact 32-bit indices instead of
+    // size_t ones.
+    bool indices32 =
+        TI->getIndices()->getElementType() == ElemKind::Int32ITy;
+    auto *F = getFunction(indices32 ? "topk32" : "topk",
+                          input->getElementType());
     createCall(builder, F,
                {valuesPtr, indicesPtr, inputPtr, scratchPtr, k, n, size});
     break;
   }
 
+  case Kinded::Kind::BroadcastInstKind: {
+    auto *BI = cast<BroadcastInst>(I);
+    auto *dest = BI->getDest();
+    auto *src = BI->getSrc();
+    auto *destPtr = emitValueAddress(builder, dest);
+    auto *srcPtr = emitValueAddress(builder, src);
+
+    auto *destDims = emitValueDims(builder, dest);
+    auto *srcDims = emitValueDims(builder, src);
+    auto *numDims = emitConstSizeT(builder, dest->dims().size());
+
+    auto *F = getFunction("broadcast", dest->getElementType());
+    createCall(builder, F, {destPtr, srcPtr, destDims, srcDims, numDims});
+    break;
+  }
+
   case Kinded::Kind::TransposeInstKind: {
     auto *TI = cast<TransposeInst>(I);
     auto *dest = TI->getDest();
@@ -1945,11 +2473,41 @@ void LLVMIRGen::generateLLVMIRForInstr(llvm::IRBuilder<> &builder,
     auto *sliceSizeVal = emitConstSizeT(builder, sliceSize);
     auto *numSamplesVal = emitConstSizeT(builder, numSamples);
     auto *sampleSizeVal = emitConstSizeT(builder, sampleSize);
+    auto *nthreads =
+        emitConstI32(builder, gatherNumThreads < 1 ? 1 : gatherNumThreads);
 
-    auto *F = getFunction("gather", dest->getElementType());
+    bool indices32 = indices->getElementType() == ElemKind::Int32ITy;
+    auto *F =
+        getFunction(indices32 ? "gather32" : "gather", dest->getElementType());
     createCall(builder, F,
                {destPtr, dataPtr, indicesPtr, indicesSize, sliceSizeVal,
-                numSamplesVal, sampleSizeVal});
+                numSamplesVal, sampleSizeVal, nthreads});
+    break;
+  }
+
+  case Kinded::Kind::SparseLengthsSumInstKind: {
+    auto *SI = llvm::cast<SparseLengthsSumInst>(I);
+    auto *dest = SI->getDest();
+    auto *data = SI->getData();
+    auto *indices = SI->getIndices();
+    auto *lengths = SI->getLengths();
+
+    auto *destPtr = emitValueAddress(builder, dest);
+    auto *dataPtr = emitValueAddress(builder, data);
+    auto *indicesPtr = emitValueAddress(builder, indices);
+    auto *lengthsPtr = emitValueAddress(builder, lengths);
+
+    auto *segments = emitConstSizeT(builder, lengths->dims()[0]);
+    auto *dataType = data->getType();
+    auto *lineSize =
+        emitConstSizeT(builder, dataType->size() / dataType->dims()[0]);
+
+    bool indices32 = indices->getElementType() == ElemKind::Int32ITy;
+    auto *F =
+        getFunction(indices32 ? "sparse_lengths_sum32" : "sparse_lengths_sum",
+                    dest->getElementType());
+    createCall(builder, F,
+               {destPtr, dataPtr, indicesPtr, lengthsPtr, segments, lineSize});
     break;
   }
 
@@ -1969,7 +2527,9 @@ void LLVMIRGen::generateLLVMIRForInstr(llvm::IRBuilder<> &builder,
     auto *sliceSize =
         emitConstSizeT(builder, dataType->size() / dataType->dims()[0]);
 
-    auto *F = getFunction("scatterassign", data->getElementType());
+    bool indices32 = indices->getElementType() == ElemKind::Int32ITy;
+    auto *F = getFunction(indices32 ? "scatterassign32" : "scatterassign",
+                          data->getElementType());
     createCall(builder, F,
                {dataPtr, indicesPtr, slicesPtr, indicesSize, sliceSize});
     break;
@@ -158,6 +158,12 @@ class LLVMIRGen {
   void
   emitDataParallelKernel(llvm::IRBuilder<> &builder,
                          llvm::ArrayRef<const Instruction *> stackedInstrs);
+  /// Emit a call to a fused whole-buffer libjit kernel when \p I is a
+  /// quantized arithmetic instruction, which keeps the rescale, the operation
+  /// and the saturating clamp in integer vector registers. \returns true if
+  /// such a kernel was emitted for \p I.
+  bool emitQuantizedFusedElementwiseKernel(llvm::IRBuilder<> &builder,
+                                           const glow::Instruction *I);
   /// Emit IR for the data parallel instruction \p I which is invoked inside the
   /// stacked \p kernel. The current loop count is described by \p loopCount.
   /// The \p bufferToArgNum map can be used to find the required buffers, which
@@ -193,6 +199,35 @@ class LLVMIRGen {
   /// the debugger's perspective.
   void emitDebugGlobalVariableForValue(const Value *val);
 
+  /// Table of accumulated per-kernel cycle counts. Created lazily when kernel
+  /// instrumentation is enabled.
+  llvm::GlobalVariable *kernelProfileCycles_{nullptr};
+  /// Names of the instrumented kernels, indexed by their slot in the cycle
+  /// table.
+  std::vector<llvm::Constant *> kernelProfileNames_;
+
+  /// Emits a read of the cycle counter before a kernel is invoked, when
+  /// kernel instrumentation is enabled.
+  /// \returns the start count, or nullptr when instrumentation is disabled.
+  llvm::Value *emitKernelProfileStart(llvm::IRBuilder<> &builder);
+  /// Emits code that accumulates the cycles elapsed since \p start into the
+  /// profile slot of the kernel named \p name. A no-op when \p start is
+  /// nullptr.
+  void emitKernelProfileEnd(llvm::IRBuilder<> &builder, llvm::Value *start,
+                            llvm::StringRef name);
+  /// Emits the global tables describing the instrumented kernels, so that
+  /// clients can retrieve the accumulated profile after execution.
+  void emitKernelProfileTables();
+
+  /// The weight pager schedule of this function, or -1 when the constant
+  /// weights are not streamed. When set, the generated code reports its
+  /// progress through the instruction schedule to the pager.
+  size_t weightPagerScheduleId_{(size_t)-1};
+
+  /// Emits a call that tells the weight pager that execution reached the
+  /// instruction \p instrIdx. A no-op when weight streaming is disabled.
+  void emitWeightPagerAdvance(llvm::IRBuilder<> &builder, size_t instrIdx);
+
 public:
   /// Ctor.
   explicit LLVMIRGen(const IRFunction *M, AllocationsInfo &allocationsInfo,
@@ -218,6 +253,12 @@ public:
   /// Optimize the function \p F and the module that owns it. Use the target
   /// information from the \p TM target machine.
   void optimizeLLVMModule(llvm::Function *F, llvm::TargetMachine &TM);
+  /// Emit ISA-specialized clones of the entry functions and the kernels that
+  /// are reachable from them, together with a CPUID-based dispatcher, so that
+  /// one compiled artifact can use newer vector extensions when the executing
+  /// CPU supports them. Enabled by the -isa-multiversion option; runs after
+  /// the module was optimized for the baseline target.
+  void multiversionEntryFunctions();
   /// Performs specialization of operations based on constant parameters.
   void performSpecialization();
   /// \returns allocations info.
@@ -258,6 +299,11 @@ public:
   llvm::Value *emitStringConst(llvm::IRBuilder<> &builder, llvm::StringRef str);
   /// Register \p val as an argument that should not be specialized.
   void markArgAsUnspecialized(llvm::Value *val);
+  /// Make the generated code drive the weight pager schedule \p scheduleId
+  /// as execution advances through the instructions.
+  void setWeightPagerSchedule(size_t scheduleId) {
+    weightPagerScheduleId_ = scheduleId;
+  }
 };
 
 } // namespace glow
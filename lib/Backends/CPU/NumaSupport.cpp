@@ -0,0 +1,124 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NumaSupport.h"
+
+#ifdef __linux__
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstdio>
+#endif
+
+#ifdef __linux__
+
+namespace {
+
+/// Memory policy modes, from linux/mempolicy.h. The raw syscalls are used
+/// directly so that the backend does not grow a libnuma dependency.
+constexpr int kMPolBind = 2;
+constexpr int kMPolInterleave = 3;
+/// Migrate the pages that were already touched, from linux/mempolicy.h.
+constexpr unsigned kMPolMFMove = 1 << 1;
+
+/// Clip the range [\p ptr, \p ptr + \p size) to the whole pages it covers,
+/// since the policy syscalls operate on pages and neighbouring allocations
+/// may share the boundary pages. \returns false if no whole page remains.
+bool pageAlignRange(void *&ptr, size_t &size) {
+  size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+  uintptr_t begin = (uintptr_t)ptr;
+  uintptr_t end = begin + size;
+  begin = (begin + pageSize - 1) & ~(pageSize - 1);
+  end = end & ~(pageSize - 1);
+  if (begin >= end) {
+    return false;
+  }
+  ptr = (void *)begin;
+  size = end - begin;
+  return true;
+}
+
+/// Apply the memory policy \p mode with the node set \p nodeMask to the
+/// whole pages of [\p ptr, \p ptr + \p size). Failures are ignored, since
+/// NUMA placement is only a performance hint.
+void applyMemoryPolicy(void *ptr, size_t size, int mode, uint64_t nodeMask) {
+  if (!nodeMask || !pageAlignRange(ptr, size)) {
+    return;
+  }
+  syscall(SYS_mbind, ptr, size, mode, &nodeMask,
+          (unsigned long)(sizeof(nodeMask) * 8 + 1), kMPolMFMove);
+}
+
+} // namespace
+
+unsigned glow::numaNumNodes() {
+  unsigned n = 0;
+  char path[64];
+  struct stat st;
+  while (n < 64) {
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%u", n);
+    if (stat(path, &st)) {
+      break;
+    }
+    n++;
+  }
+  return n ? n : 1;
+}
+
+void glow::numaInterleaveMemory(void *ptr, size_t size) {
+  unsigned nodes = numaNumNodes();
+  if (nodes < 2) {
+    return;
+  }
+  uint64_t nodeMask = (nodes >= 64) ? ~0ull : ((1ull << nodes) - 1);
+  applyMemoryPolicy(ptr, size, kMPolInterleave, nodeMask);
+}
+
+void glow::numaBindMemory(void *ptr, size_t size, uint64_t nodeMask) {
+  applyMemoryPolicy(ptr, size, kMPolBind, nodeMask);
+}
+
+void glow::numaBindMemoryToLocalNode(void *ptr, size_t size) {
+  unsigned cpu = 0;
+  unsigned node = 0;
+  if (syscall(SYS_getcpu, &cpu, &node, nullptr)) {
+    return;
+  }
+  numaBindMemory(ptr, size, 1ull << node);
+}
+
+#else
+
+unsigned glow::numaNumNodes() { return 1; }
+
+void glow::numaInterleaveMemory(void *ptr, size_t size) {
+  (void)ptr;
+  (void)size;
+}
+
+void glow::numaBindMemory(void *ptr, size_t size, uint64_t nodeMask) {
+  (void)ptr;
+  (void)size;
+  (void)nodeMask;
+}
+
+void glow::numaBindMemoryToLocalNode(void *ptr, size_t size) {
+  (void)ptr;
+  (void)size;
+}
+
+#endif // __linux__
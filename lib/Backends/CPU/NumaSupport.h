@@ -0,0 +1,52 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GLOW_BACKENDS_CPU_NUMASUPPORT_H
+#define GLOW_BACKENDS_CPU_NUMASUPPORT_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace glow {
+
+/// Best-effort NUMA memory placement. On multi-socket hosts the node that
+/// the weight and activation pages happen to land on decides whether the
+/// kernels read local or remote memory, so placement is a significant and
+/// otherwise uncontrolled source of latency variance. All of these calls
+/// are performance hints: on systems without NUMA support, or when the
+/// placement fails, they are no-ops.
+
+/// \returns the number of NUMA nodes in the system, or 1 when the system
+/// has a single node or no NUMA support.
+unsigned numaNumNodes();
+
+/// Interleave the whole pages of the memory range [\p ptr, \p ptr + \p size)
+/// across all NUMA nodes, so that accesses from every socket pay the average
+/// instead of the worst-case distance. Pages that were already touched are
+/// migrated.
+void numaInterleaveMemory(void *ptr, size_t size);
+
+/// Bind the whole pages of the memory range [\p ptr, \p ptr + \p size) to the
+/// set of nodes in \p nodeMask, where bit i selects node i. Pages that were
+/// already touched are migrated.
+void numaBindMemory(void *ptr, size_t size, uint64_t nodeMask);
+
+/// Bind the whole pages of the memory range [\p ptr, \p ptr + \p size) to the
+/// node that the calling thread is currently running on.
+void numaBindMemoryToLocalNode(void *ptr, size_t size);
+
+} // namespace glow
+
+#endif // GLOW_BACKENDS_CPU_NUMASUPPORT_H
@@ -15,9 +15,13 @@
  */
 
 #include "CPUBackend.h"
+#include "CommandLine.h"
 #include "LLVMIRGen.h"
 
+#include "glow/Support/Compiler.h"
+
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Analysis/BasicAliasAnalysis.h"
 #include "llvm/Analysis/CFLAndersAliasAnalysis.h"
@@ -31,6 +35,7 @@
 #include "llvm/Analysis/TypeBasedAliasAnalysis.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DataLayout.h"
+#include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Verifier.h"
@@ -48,12 +53,23 @@
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Scalar/GVN.h"
 #include "llvm/Transforms/Scalar/SimpleLoopUnswitch.h"
+#include "llvm/Transforms/Utils/Cloning.h"
 #include "llvm/Transforms/Vectorize.h"
 
 using namespace glow;
 using llvm::dyn_cast;
 using llvm::isa;
 
+/// Defined in LLVMIRGen.cpp.
+extern llvm::cl::opt<bool> emitDebugInfo;
+
+static llvm::cl::opt<bool> isaMultiversion(
+    "isa-multiversion",
+    llvm::cl::desc("Emit AVX2 clones of the compiled entry functions and "
+                   "select between them with CPUID at run time, so that one "
+                   "compiled artifact runs at full speed on a range of CPUs"),
+    llvm::cl::init(false), llvm::cl::cat(CPUBackendCat));
+
 void LLVMIRGen::optimizeLLVMModule(llvm::Function *F, llvm::TargetMachine &TM) {
   auto *M = F->getParent();
 
@@ -64,6 +80,11 @@ void LLVMIRGen::optimizeLLVMModule(llvm::Function *F, llvm::TargetMachine &TM) {
     // Do not internalize declarations.
     if (GV.isDeclaration())
       return true;
+    // Keep the CPUID dispatch helper alive when multiversioning, because the
+    // dispatchers that reference it are emitted only after optimization. It
+    // is internalized again once the dispatchers exist.
+    if (isaMultiversion && name == "libjit_cpu_feature_level")
+      return true;
     // Do not preserve any internal symbols, which typically have no name or
     // start with jit_
     if (name.empty() || name.startswith("libjit_"))
@@ -142,3 +163,111 @@ void LLVMIRGen::optimizeLLVMModule(llvm::Function *F, llvm::TargetMachine &TM) {
   FPM.doFinalization();
   PM.run(*M);
 }
+
+void LLVMIRGen::multiversionEntryFunctions() {
+  if (!isaMultiversion) {
+    return;
+  }
+  // The debug information describes only the original functions, so the two
+  // features are mutually exclusive.
+  if (emitDebugInfo) {
+    return;
+  }
+  auto *M = llmodule_.get();
+  auto *featureLevelF = M->getFunction("libjit_cpu_feature_level");
+  GLOW_ASSERT(featureLevelF && "Missing the CPUID dispatch helper");
+
+  // Collect the entry points: after internalization they are the only
+  // external functions with a body, besides the preserved dispatch helper.
+  llvm::SmallVector<llvm::Function *, 4> entries;
+  for (auto &FF : *M) {
+    if (FF.isDeclaration() || FF.hasLocalLinkage() || &FF == featureLevelF) {
+      continue;
+    }
+    assert(FF.getReturnType()->isVoidTy() && "Entry must return void");
+    entries.push_back(&FF);
+  }
+
+  // Collect the functions reachable from the entries. Most of the code was
+  // inlined into the entries by now, but the no-inline kernels and the
+  // functions that are only invoked through pointers (e.g. thread workers)
+  // are still standalone and also need ISA-specialized clones.
+  llvm::SmallVector<llvm::Function *, 16> toClone;
+  llvm::SmallPtrSet<llvm::Function *, 16> visited;
+  llvm::SmallVector<llvm::Function *, 16> worklist(entries.begin(),
+                                                   entries.end());
+  while (!worklist.empty()) {
+    auto *FF = worklist.pop_back_val();
+    if (!visited.insert(FF).second) {
+      continue;
+    }
+    toClone.push_back(FF);
+    for (auto &BB : *FF) {
+      for (auto &I : BB) {
+        for (auto &op : I.operands()) {
+          auto *callee = dyn_cast<llvm::Function>(op->stripPointerCasts());
+          if (callee && !callee->isDeclaration() && callee != featureLevelF) {
+            worklist.push_back(callee);
+          }
+        }
+      }
+    }
+  }
+
+  // Clone the reachable functions and let the backend emit their code with
+  // the AVX2 feature set. AVX2 implies the earlier SSE/AVX generations, and
+  // avx512 is skipped because LLVM does not support it well.
+  llvm::ValueToValueMapTy vmap;
+  for (auto *FF : toClone) {
+    auto *clone =
+        llvm::Function::Create(FF->getFunctionType(), llvm::Function::InternalLinkage,
+                               FF->getName() + ".avx2", M);
+    vmap[FF] = clone;
+  }
+  for (auto *FF : toClone) {
+    auto *clone = llvm::cast<llvm::Function>(vmap[FF]);
+    auto cloneArgIt = clone->arg_begin();
+    for (auto &arg : FF->args()) {
+      cloneArgIt->setName(arg.getName());
+      vmap[&arg] = &*cloneArgIt++;
+    }
+    llvm::SmallVector<llvm::ReturnInst *, 8> returns;
+    llvm::CloneFunctionInto(clone, FF, vmap, /* ModuleLevelChanges */ true,
+                            returns);
+    clone->addFnAttr("target-features", "+avx2,+fma");
+  }
+
+  // Replace each entry by a dispatcher that picks the right clone based on
+  // the detected CPU feature level. The original entry keeps serving as the
+  // baseline version.
+  for (auto *entry : entries) {
+    auto *avx2F = llvm::cast<llvm::Function>(vmap[entry]);
+    std::string name = entry->getName().str();
+    entry->setName(name + ".generic");
+    entry->setLinkage(llvm::Function::InternalLinkage);
+    auto *dispatcher = llvm::Function::Create(
+        entry->getFunctionType(), llvm::Function::ExternalLinkage, name, M);
+    auto *entryBB = llvm::BasicBlock::Create(ctx_, "entry", dispatcher);
+    auto *avx2BB = llvm::BasicBlock::Create(ctx_, "avx2", dispatcher);
+    auto *genericBB = llvm::BasicBlock::Create(ctx_, "generic", dispatcher);
+    llvm::IRBuilder<> builder(entryBB);
+    llvm::SmallVector<llvm::Value *, 4> args;
+    for (auto &arg : dispatcher->args()) {
+      args.push_back(&arg);
+    }
+    auto *level = createCall(builder, featureLevelF, {});
+    auto *useAvx2 = builder.CreateICmpSGE(level, builder.getInt32(1));
+    builder.CreateCondBr(useAvx2, avx2BB, genericBB);
+    builder.SetInsertPoint(avx2BB);
+    createCall(builder, avx2F, args);
+    builder.CreateRetVoid();
+    builder.SetInsertPoint(genericBB);
+    createCall(builder, entry, args);
+    builder.CreateRetVoid();
+  }
+
+  // The helper was kept external only so that it would survive optimization;
+  // internalize it now that the dispatchers reference it, so that bundles do
+  // not export it.
+  featureLevelF->setLinkage(llvm::Function::InternalLinkage);
+}
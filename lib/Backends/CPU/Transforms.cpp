@@ -18,6 +18,7 @@
 
 #include "glow/Graph/Graph.h"
 #include "glow/Graph/Nodes.h"
+#include "glow/Optimizer/Optimizer.h"
 
 using namespace glow;
 using llvm::dyn_cast;
@@ -79,9 +80,144 @@ static Node *optimizeCPUConv(ConvolutionNode *CN, Function *F) {
       CN->getBias(), CN->getKernel(), CN->getStride(), CN->getPads(), group));
 }
 
+/// Fuse a Convolution -> (relu) -> PoolMax sequence into a CPUConvPool node.
+/// The fused kernel materializes the convolution activation in a ring of
+/// pool-window-high row strips and pools each strip while it is still cache
+/// resident, so the activation is never written to memory as a whole tensor.
+/// For the early high-resolution layers of vision models that activation is
+/// many times the size of the cache, and eliminating its round trip to memory
+/// is the dominant saving; for small activations the separate kernels are
+/// left alone since they already run out of cache.
+static bool fuseConvPool(Function *F) {
+  bool changed = false;
+  for (auto &node : F->getNodes()) {
+    auto *PM = dyn_cast<PoolMaxNode>(&node);
+    if (!PM) {
+      continue;
+    }
+
+    // Peel a relu off the pool input. This runs after lowering, where a relu
+    // is a Max against a zero splat. A max against a non-zero splat would
+    // also commute with the pool, but the kernel only folds the relu form.
+    NodeValue poolIn = PM->getInput();
+    bool doRelu = false;
+    if (auto *MX = dyn_cast<MaxNode>(poolIn)) {
+      auto *splat = dyn_cast<SplatNode>(MX->getLHS());
+      NodeValue other = MX->getRHS();
+      if (!splat) {
+        splat = dyn_cast<SplatNode>(MX->getRHS());
+        other = MX->getLHS();
+      }
+      if (!splat || splat->getValue() != 0.0f || MX->getNumUsers() != 1) {
+        continue;
+      }
+      doRelu = true;
+      poolIn = other;
+    }
+
+    auto *CN = dyn_cast<ConvolutionNode>(poolIn);
+    if (!CN) {
+      continue;
+    }
+    // The activation must be consumed by this sequence alone, or it has to
+    // be materialized anyway and the fusion saves nothing.
+    if (CN->getNumUsers() != 1) {
+      continue;
+    }
+    // Only the float kernel exists.
+    if (CN->getResult().getType()->getElementType() != ElemKind::FloatTy) {
+      continue;
+    }
+
+    // The kernel keeps a ring of poolKernel convolution rows resident. Only
+    // fuse when the full activation would spill the cache (otherwise the
+    // separate kernels already run out of cache, and the generic convolution
+    // is better vectorized) and the ring itself comfortably fits.
+    constexpr size_t cacheSize = 512 * 1024;
+    auto convDims = CN->getResult().dims();
+    size_t rowBytes = convDims[2] * convDims[3] * sizeof(float);
+    if (convDims[1] * rowBytes <= cacheSize ||
+        PM->getKernel() * rowBytes > cacheSize) {
+      continue;
+    }
+
+    auto *CP = F->addNode(new CPUConvPoolNode(
+        PM->getName(), PM->getResult().getType(), CN->getInput(),
+        CN->getFilter(), CN->getBias(), CN->getKernel(), CN->getStride(),
+        CN->getPads(), CN->getGroup(), doRelu, PM->getKernel(),
+        PM->getStride(), PM->getPads()));
+    NodeValue(&node, 0).replaceAllUsesOfWith(CP);
+    changed = true;
+  }
+  return changed;
+}
+
+/// Fuse the post-lowering relu form (a Max against a zero splat) into the
+/// convolution or fully-connected core that produces its input. The fused
+/// kernels apply the activation in the accumulator epilogue, so the relu no
+/// longer costs a read-modify-write pass over the whole output. A lowered
+/// fully-connected layer is a MatMul feeding a BatchedAdd of the bias; the
+/// whole triple collapses into one CPUFCRelu.
+static bool fuseActivation(Function *F) {
+  bool changed = false;
+  for (auto &node : F->getNodes()) {
+    auto *MX = dyn_cast<MaxNode>(&node);
+    if (!MX) {
+      continue;
+    }
+    auto *splat = dyn_cast<SplatNode>(MX->getLHS());
+    NodeValue other = MX->getRHS();
+    if (!splat) {
+      splat = dyn_cast<SplatNode>(MX->getRHS());
+      other = MX->getLHS();
+    }
+    if (!splat || splat->getValue() != 0.0f) {
+      continue;
+    }
+    // The intermediate result must be consumed by the relu alone, or it has
+    // to be materialized anyway and the fusion saves nothing.
+    if (auto *CN = dyn_cast<ConvolutionNode>(other)) {
+      if (CN->getNumUsers() != 1 ||
+          CN->getResult().getType()->getElementType() != ElemKind::FloatTy) {
+        continue;
+      }
+      auto *CR = F->addNode(new CPUConvReluNode(
+          MX->getName(), CN->getResult().getType(), CN->getInput(),
+          CN->getFilter(), CN->getBias(), CN->getKernel(), CN->getStride(),
+          CN->getPads(), CN->getGroup()));
+      NodeValue(&node, 0).replaceAllUsesOfWith(CR);
+      changed = true;
+      continue;
+    }
+    if (auto *BA = dyn_cast<BatchedAddNode>(other)) {
+      auto *MM = dyn_cast<MatMulNode>(BA->getBatch());
+      if (!MM || BA->getNumUsers() != 1 || MM->getNumUsers() != 1 ||
+          MM->getResult().dims().size() != 2 ||
+          BA->getResult().getType()->getElementType() != ElemKind::FloatTy) {
+        continue;
+      }
+      auto *FC = F->addNode(new CPUFCReluNode(
+          MX->getName(), BA->getResult().getType(), MM->getLHS(), MM->getRHS(),
+          BA->getSlice()));
+      NodeValue(&node, 0).replaceAllUsesOfWith(FC);
+      changed = true;
+      continue;
+    }
+  }
+  return changed;
+}
+
 bool CPUBackend::transformPostLowering(Function *F,
                                        CompilationMode mode) const {
-  bool changed = false;
+  // Sum-over-gather chains run as one fused kernel.
+  bool changed = fuseGatherReduceAdd(F);
+  // Fuse conv/relu/pool sequences before the splat rewrites below turn the
+  // relu into a CPUMaxSplat.
+  changed |= fuseConvPool(F);
+  // Fold the remaining relus into the conv/FC kernels that feed them. This
+  // runs after fuseConvPool so a conv/relu/pool triple takes the fully fused
+  // form, and before the splat rewrites for the same reason as above.
+  changed |= fuseActivation(F);
   for (auto &node : F->getNodes()) {
 
     if (auto *CN = dyn_cast<ConvolutionNode>(&node)) {
@@ -107,6 +243,42 @@ bool CPUBackend::transformPostLowering(Function *F,
         continue;
       }
     }
+    // Mul and Sub with a splat operand carry the splat as a scalar immediate
+    // into the kernel, removing the splat buffer and a full memory pass.
+    // Unlike Max, these change the value range, so the quantized versions
+    // would need a rescale that the immediate-operand kernels do not express;
+    // only handle the float case.
+    if (auto *MN = dyn_cast<MulNode>(&node)) {
+      if (!MN->getResult().getType()->isQuantizedType()) {
+        if (auto *splat = dyn_cast<SplatNode>(MN->getLHS())) {
+          auto MSN = F->addNode(new CPUMulSplatNode(MN->getName(), MN->getRHS(),
+                                                    splat->getValue()));
+          NodeValue(&node, 0).replaceAllUsesOfWith(MSN);
+          changed = true;
+          continue;
+        }
+        if (auto *splat = dyn_cast<SplatNode>(MN->getRHS())) {
+          auto MSN = F->addNode(new CPUMulSplatNode(MN->getName(), MN->getLHS(),
+                                                    splat->getValue()));
+          NodeValue(&node, 0).replaceAllUsesOfWith(MSN);
+          changed = true;
+          continue;
+        }
+      }
+    }
+    if (auto *SN = dyn_cast<SubNode>(&node)) {
+      // Subtraction is not commutative; only the splat-on-the-right form maps
+      // onto the immediate kernel.
+      if (!SN->getResult().getType()->isQuantizedType()) {
+        if (auto *splat = dyn_cast<SplatNode>(SN->getRHS())) {
+          auto SSN = F->addNode(new CPUSubSplatNode(SN->getName(), SN->getLHS(),
+                                                    splat->getValue()));
+          NodeValue(&node, 0).replaceAllUsesOfWith(SSN);
+          changed = true;
+          continue;
+        }
+      }
+    }
   }
 
   return changed;
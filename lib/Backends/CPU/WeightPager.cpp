@@ -0,0 +1,275 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "WeightPager.h"
+#include "CommandLine.h"
+
+#include "glow/Graph/Graph.h"
+#include "glow/Graph/Nodes.h"
+#include "glow/IR/IRUtils.h"
+#include "glow/IR/Instrs.h"
+#include "glow/Support/Compiler.h"
+
+#include "llvm/Support/CommandLine.h"
+
+#include <algorithm>
+#include <cassert>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace glow;
+
+llvm::cl::opt<std::string> streamWeightsFile(
+    "stream-weights",
+    llvm::cl::desc("Back the constant weights with a mapping of this file and "
+                   "page them in and out as the instruction schedule "
+                   "advances, so that models whose weights exceed host "
+                   "memory can execute"),
+    llvm::cl::init(""), llvm::cl::cat(CPUBackendCat));
+
+static llvm::cl::opt<unsigned> streamWeightsWindowOpt(
+    "stream-weights-window",
+    llvm::cl::desc("The bound on the resident constant weight memory when "
+                   "-stream-weights is used, in megabytes"),
+    llvm::cl::init(512), llvm::cl::cat(CPUBackendCat));
+
+#ifdef __linux__
+
+namespace {
+/// Clips the range [\p offset, \p offset + \p size) of the mapping based at
+/// \p base to the whole pages it covers, since madvise operates on pages.
+/// \returns the advised range via \p addr and \p len.
+void pageRange(uint8_t *base, size_t offset, size_t size, void *&addr,
+               size_t &len) {
+  size_t pageSize = sysconf(_SC_PAGESIZE);
+  size_t begin = offset & ~(pageSize - 1);
+  size_t end = (offset + size + pageSize - 1) & ~(pageSize - 1);
+  addr = base + begin;
+  len = end - begin;
+}
+} // namespace
+
+WeightPager::WeightPager(llvm::StringRef path, size_t windowBytes)
+    : path_(path), windowBytes_(windowBytes) {}
+
+WeightPager::~WeightPager() {
+  if (base_) {
+    munmap(base_, mappedSize_);
+  }
+  if (fd_ != -1) {
+    close(fd_);
+  }
+}
+
+void WeightPager::growMapping(size_t size) {
+  if (size <= mappedSize_) {
+    return;
+  }
+  if (fd_ == -1) {
+    fd_ = open(path_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    GLOW_ASSERT(fd_ != -1 && "Could not create the weight backing file");
+  }
+  auto res = ftruncate(fd_, size);
+  GLOW_ASSERT(res == 0 && "Could not grow the weight backing file");
+  if (base_) {
+    munmap(base_, mappedSize_);
+  }
+  // A shared mapping, so that the pages stay backed by the file: the OS can
+  // drop any of them under pressure and read them back on demand, and dirty
+  // pages are written back instead of being pinned in memory.
+  base_ = reinterpret_cast<uint8_t *>(
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0));
+  GLOW_ASSERT(base_ != MAP_FAILED && "Could not map the weight backing file");
+  mappedSize_ = size;
+}
+
+void WeightPager::pageConstantWeights(Module *M,
+                                      const ModuleWeightLayout &layout) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  bool remapped = mappedSize_ < layout.constantWeightVarsMemSize_;
+  growMapping(layout.constantWeightVarsMemSize_);
+  if (remapped) {
+    // The mapping moved; rebind the payloads of the variables that were
+    // paged before the module grew.
+    for (auto &p : pagedVars_) {
+      auto *v = p.first;
+      v->getPayload() = Tensor(base_ + p.second, v->getType());
+    }
+  }
+  for (auto &v : M->getVars()) {
+    if (v->getVisibilityKind() == VisibilityKind::Public ||
+        pagedVars_.count(v)) {
+      continue;
+    }
+    auto offset = layout.varOffsets_.find(v);
+    assert(offset != layout.varOffsets_.end() &&
+           "Variable was not placed by the module weight layout");
+    auto &payload = v->getPayload();
+    size_t numBytes = payload.getSizeInBytes();
+    // Stage the weight in the file, then rebind the payload to the mapping.
+    // This releases the heap copy; from now on the weight occupies memory
+    // only while its pages are resident.
+    auto written =
+        pwrite(fd_, payload.getUnsafePtr(), numBytes, offset->second);
+    GLOW_ASSERT(written == (ssize_t)numBytes &&
+                "Could not stage a weight in the backing file");
+    pagedVars_[v] = offset->second;
+    v->getPayload() = Tensor(base_ + offset->second, v->getType());
+  }
+}
+
+size_t WeightPager::addSchedule(const IRFunction *F) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  // Resolve the WeightVars of this function that address paged weights.
+  llvm::DenseMap<const Value *, PagedWeight> pagedWeights;
+  for (auto &v : F->getGraph()->getParent()->getVars()) {
+    auto it = pagedVars_.find(v);
+    if (it == pagedVars_.end()) {
+      continue;
+    }
+    auto *w = llvm::dyn_cast_or_null<WeightVar>(F->getWeightForNode(v));
+    if (!w) {
+      continue;
+    }
+    pagedWeights[w] = {it->second, w->getSizeInBytes(), (size_t)-1, 0};
+  }
+
+  // Record the span of instructions that uses each paged weight.
+  size_t instrIdx = 0;
+  for (const auto &I : F->getInstrs()) {
+    for (const auto &op : I.getOperands()) {
+      auto it = pagedWeights.find(getOrigin(op.first));
+      if (it == pagedWeights.end()) {
+        continue;
+      }
+      if (it->second.firstUse == (size_t)-1) {
+        it->second.firstUse = instrIdx;
+      }
+      it->second.lastUse = instrIdx;
+    }
+    instrIdx++;
+  }
+
+  schedules_.emplace_back();
+  auto &S = schedules_.back();
+  for (auto &p : pagedWeights) {
+    if (p.second.firstUse == (size_t)-1) {
+      // The weight is not used by this function.
+      continue;
+    }
+    S.weights.push_back(p.second);
+  }
+  std::sort(S.weights.begin(), S.weights.end(),
+            [](const PagedWeight &a, const PagedWeight &b) {
+              return a.firstUse < b.firstUse;
+            });
+  return schedules_.size() - 1;
+}
+
+void WeightPager::resetSchedule(Schedule &S) {
+  S.next = 0;
+  S.active.clear();
+  S.evictNext = 0;
+  S.residentBytes = 0;
+  S.lastInstrIdx = 0;
+}
+
+void WeightPager::advance(size_t scheduleId, size_t instrIdx) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  assert(scheduleId < schedules_.size() && "Invalid schedule");
+  auto &S = schedules_[scheduleId];
+  if (instrIdx < S.lastInstrIdx) {
+    // Execution wrapped around: a new run of the function started.
+    resetSchedule(S);
+  }
+  S.lastInstrIdx = instrIdx;
+
+  // Drop the pages of the weights whose last use has passed. The pages are
+  // clean or written back by the OS, so dropping them is just an eviction.
+  while (S.evictNext < S.active.size()) {
+    auto &w = S.weights[S.active[S.evictNext]];
+    if (w.lastUse >= instrIdx) {
+      break;
+    }
+    void *addr;
+    size_t len;
+    pageRange(base_, w.offset, w.size, addr, len);
+    madvise(addr, len, MADV_DONTNEED);
+    S.residentBytes -= w.size;
+    S.evictNext++;
+  }
+
+  // Prefetch the upcoming weights in schedule order. Weights that the
+  // current instruction already needs are always brought in; beyond that the
+  // prefetcher runs ahead only while the resident bytes stay in the window.
+  while (S.next < S.weights.size()) {
+    auto &w = S.weights[S.next];
+    if (w.firstUse > instrIdx && S.residentBytes + w.size > windowBytes_) {
+      break;
+    }
+    void *addr;
+    size_t len;
+    pageRange(base_, w.offset, w.size, addr, len);
+    madvise(addr, len, MADV_WILLNEED);
+    S.residentBytes += w.size;
+    S.active.push_back(S.next);
+    S.next++;
+  }
+}
+
+#else // !__linux__
+
+WeightPager::WeightPager(llvm::StringRef path, size_t windowBytes)
+    : path_(path), windowBytes_(windowBytes) {}
+
+WeightPager::~WeightPager() = default;
+
+void WeightPager::growMapping(size_t) {}
+
+void WeightPager::pageConstantWeights(Module *, const ModuleWeightLayout &) {}
+
+size_t WeightPager::addSchedule(const IRFunction *) {
+  schedules_.emplace_back();
+  return schedules_.size() - 1;
+}
+
+void WeightPager::resetSchedule(Schedule &) {}
+
+void WeightPager::advance(size_t, size_t) {}
+
+#endif // __linux__
+
+WeightPager *WeightPager::get() {
+  if (streamWeightsFile.empty()) {
+    return nullptr;
+  }
+  static WeightPager pager(streamWeightsFile,
+                           (size_t)streamWeightsWindowOpt * 1024 * 1024);
+  return &pager;
+}
+
+/// The entry point that the generated code of a streamed function calls as
+/// execution advances through the instruction schedule.
+extern "C" void glow_weight_pager_advance(uint64_t scheduleId,
+                                          uint64_t instrIdx) {
+  auto *pager = WeightPager::get();
+  assert(pager && "No pager; the hook was emitted without -stream-weights");
+  pager->advance(scheduleId, instrIdx);
+}
@@ -0,0 +1,139 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GLOW_BACKENDS_CPU_WEIGHTPAGER_H
+#define GLOW_BACKENDS_CPU_WEIGHTPAGER_H
+
+#include "AllocationsInfo.h"
+
+#include "llvm/ADT/DenseMap.h"
+
+#include <mutex>
+#include <vector>
+
+namespace glow {
+
+class IRFunction;
+class Module;
+class Variable;
+
+/// Pages the constant weights of a module through a file mapping, so that
+/// models whose weights exceed host memory can still execute.
+///
+/// The constant weights are written once to a backing file at the offsets
+/// assigned by the module weight layout and the variable payloads are rebound
+/// to a shared mapping of that file. The pages of the mapping are backed by
+/// the file, so the OS can drop any of them and read them back on demand;
+/// nothing forces the whole weight arena to be resident at once.
+///
+/// On top of the demand paging, the instruction schedule of each compiled
+/// function drives an explicit window: the generated code calls back into the
+/// pager as execution advances, and the pager prefetches the weights of the
+/// upcoming instructions while dropping the pages of the weights whose last
+/// use has passed. The resident weight set is thereby bounded by the
+/// configured window instead of growing to the size of the model.
+class WeightPager final {
+  /// The path of the backing file.
+  std::string path_;
+  /// The bound on the resident weight bytes.
+  size_t windowBytes_;
+  /// The file descriptor of the backing file, or -1 when nothing is mapped.
+  int fd_{-1};
+  /// The base address of the mapping of the backing file.
+  uint8_t *base_{nullptr};
+  /// The size of the mapping, in bytes.
+  size_t mappedSize_{0};
+  /// The offsets in the backing file of the variables that were written to
+  /// it. Used to rebind the payloads when the mapping moves because the
+  /// module grew, and to resolve the weights used by an instruction schedule.
+  llvm::DenseMap<Variable *, size_t> pagedVars_;
+
+  /// One streamed weight of a schedule: its place in the backing file and
+  /// the span of instructions that use it.
+  struct PagedWeight {
+    /// Offset of the weight in the backing file.
+    size_t offset;
+    /// Size of the weight in bytes.
+    size_t size;
+    /// Index of the first instruction that uses the weight.
+    size_t firstUse;
+    /// Index of the last instruction that uses the weight.
+    size_t lastUse;
+  };
+
+  /// The streamed weights of one compiled function, ordered by their first
+  /// use, together with the runtime frontiers of the paging window.
+  struct Schedule {
+    /// The streamed weights, ordered by first use.
+    std::vector<PagedWeight> weights;
+    /// Index of the next weight to prefetch.
+    size_t next{0};
+    /// The weights that were prefetched and not evicted yet, as indices
+    /// into \ref weights, in eviction (first-use) order.
+    std::vector<size_t> active;
+    /// Index into \ref active of the next weight to evict.
+    size_t evictNext{0};
+    /// The resident weight bytes of this schedule.
+    size_t residentBytes{0};
+    /// The instruction index of the last advance() call, used to detect the
+    /// start of a new execution.
+    size_t lastInstrIdx{0};
+  };
+
+  /// The schedules of the compiled functions, indexed by the schedule id
+  /// baked into their generated code.
+  std::vector<Schedule> schedules_;
+
+  /// Serializes the paging state against concurrent executions.
+  std::mutex mtx_;
+
+  /// Grows the backing file and the mapping to \p size bytes and rebinds the
+  /// payloads of the already paged variables when the mapping moved.
+  void growMapping(size_t size);
+
+  /// Resets the runtime frontiers of \p S to the start of the function.
+  void resetSchedule(Schedule &S);
+
+public:
+  /// Ctor. The weights are staged in the file at \p path and at most
+  /// \p windowBytes of them are kept resident by the schedules.
+  WeightPager(llvm::StringRef path, size_t windowBytes);
+
+  ~WeightPager();
+
+  /// Writes the constant weights of \p M that are not paged yet to the
+  /// backing file at the offsets assigned by \p layout, and rebinds their
+  /// payloads to the file mapping. Variables paged by an earlier call keep
+  /// their place, so recompilations and module growth are safe.
+  void pageConstantWeights(Module *M, const ModuleWeightLayout &layout);
+
+  /// Builds the prefetch/eviction schedule for the instructions of \p F.
+  /// \returns the schedule id that the generated code passes to advance().
+  size_t addSchedule(const IRFunction *F);
+
+  /// Called from the generated code of schedule \p scheduleId when execution
+  /// reaches the instruction \p instrIdx. Drops the pages of the weights
+  /// whose last use has passed and prefetches upcoming weights while the
+  /// resident bytes stay within the window.
+  void advance(size_t scheduleId, size_t instrIdx);
+
+  /// \returns the pager configured by the -stream-weights options, or null
+  /// when weight streaming is disabled.
+  static WeightPager *get();
+};
+
+} // end namespace glow
+
+#endif // GLOW_BACKENDS_CPU_WEIGHTPAGER_H
@@ -20,10 +20,17 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <pthread.h>
 #include <sys/types.h>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
 #include "libjit_defs.h"
 
+#include "glow/Support/FastMath.h"
+
 namespace {
 
 template <class ElemTy>
@@ -133,9 +140,6 @@ void libjit_insert_tensor(ElemTy *tensor, ElemTy *slice, size_t *offset,
                           size_t *tensorDim, size_t *sliceDim,
                           size_t numDimsTensor, size_t numDimsSlice,
                           size_t offsetDim, size_t count, size_t axis) {
-  // Destination coordinates.
-  size_t C[5];
-
   // A local copy of the offsets buffer. We copy the buffer to make it clear
   // to the optimizer that the inputs don't alias. This loop is optimized away.
   size_t offsets_cpy[5];
@@ -143,79 +147,52 @@ void libjit_insert_tensor(ElemTy *tensor, ElemTy *slice, size_t *offset,
     offsets_cpy[i] = offset[i];
   }
 
-  if (numDimsSlice == 5) {
-    for (size_t c = 0; c < count; c++)
-      for (size_t x = 0; x < sliceDim[0]; x++)
-        for (size_t y = 0; y < sliceDim[1]; y++)
-          for (size_t z = 0; z < sliceDim[2]; z++)
-            for (size_t w = 0; w < sliceDim[3]; w++)
-              for (size_t q = 0; q < sliceDim[4]; q++) {
-                const size_t countAxisOffset = c * sliceDim[axis];
-                C[0] = x + offsets_cpy[0] + ((axis == 0) ? countAxisOffset : 0);
-                C[1] = y + offsets_cpy[1] + ((axis == 1) ? countAxisOffset : 0);
-                C[2] = z + offsets_cpy[2] + ((axis == 2) ? countAxisOffset : 0);
-                C[3] = w + offsets_cpy[3] + ((axis == 3) ? countAxisOffset : 0);
-                C[4] = q + offsets_cpy[4] + ((axis == 4) ? countAxisOffset : 0);
-                tensor[libjit_getXYZWQ(tensorDim, C[0], C[1], C[2], C[3],
-                                       C[4])] =
-                    slice[libjit_getXYZWQ(sliceDim, x, y, z, w, q)];
-              }
-    return;
+  // Find the first dimension of the trailing run in which the slice spans
+  // the whole tensor. The region formed by that run and the (possibly
+  // partial) dimension right above it is contiguous in both tensors, so it
+  // collapses into a single memcpy. In the common batch-slice case this
+  // turns the whole insert into a few bandwidth-limited copies; in the
+  // worst case every block is one row along the innermost dimension.
+  size_t firstFullDim = numDimsSlice;
+  while (firstFullDim > 0 &&
+         sliceDim[firstFullDim - 1] == tensorDim[firstFullDim - 1]) {
+    firstFullDim--;
   }
 
-  if (numDimsSlice == 4) {
-    for (size_t c = 0; c < count; c++)
-      for (size_t x = 0; x < sliceDim[0]; x++)
-        for (size_t y = 0; y < sliceDim[1]; y++)
-          for (size_t z = 0; z < sliceDim[2]; z++)
-            for (size_t w = 0; w < sliceDim[3]; w++) {
-              const size_t countAxisOffset = c * sliceDim[axis];
-              C[0] = x + offsets_cpy[0] + ((axis == 0) ? countAxisOffset : 0);
-              C[1] = y + offsets_cpy[1] + ((axis == 1) ? countAxisOffset : 0);
-              C[2] = z + offsets_cpy[2] + ((axis == 2) ? countAxisOffset : 0);
-              C[3] = w + offsets_cpy[3] + ((axis == 3) ? countAxisOffset : 0);
-              tensor[libjit_getXYZW(tensorDim, C[0], C[1], C[2], C[3])] =
-                  slice[libjit_getXYZW(sliceDim, x, y, z, w)];
-            }
-    return;
+  // The dimensions that are walked block by block, and the number of
+  // contiguous elements that every block copies.
+  size_t numOuterDims = firstFullDim > 0 ? firstFullDim - 1 : 0;
+  size_t blockLen = 1;
+  for (size_t i = numOuterDims; i < numDimsSlice; i++) {
+    blockLen *= sliceDim[i];
   }
-
-  if (numDimsSlice == 3) {
-    for (size_t c = 0; c < count; c++)
-      for (size_t x = 0; x < sliceDim[0]; x++)
-        for (size_t y = 0; y < sliceDim[1]; y++)
-          for (size_t z = 0; z < sliceDim[2]; z++) {
-            const size_t countAxisOffset = c * sliceDim[axis];
-            C[0] = x + offsets_cpy[0] + ((axis == 0) ? countAxisOffset : 0);
-            C[1] = y + offsets_cpy[1] + ((axis == 1) ? countAxisOffset : 0);
-            C[2] = z + offsets_cpy[2] + ((axis == 2) ? countAxisOffset : 0);
-            tensor[libjit_getXYZ(tensorDim, C[0], C[1], C[2])] =
-                slice[libjit_getXYZ(sliceDim, x, y, z)];
-          }
-    return;
+  size_t numBlocks = 1;
+  for (size_t i = 0; i < numOuterDims; i++) {
+    numBlocks *= sliceDim[i];
   }
 
-  if (numDimsSlice == 2) {
-    for (size_t c = 0; c < count; c++)
-      for (size_t x = 0; x < sliceDim[0]; x++)
-        for (size_t y = 0; y < sliceDim[1]; y++) {
-          const size_t countAxisOffset = c * sliceDim[axis];
-          C[0] = x + offsets_cpy[0] + ((axis == 0) ? countAxisOffset : 0);
-          C[1] = y + offsets_cpy[1] + ((axis == 1) ? countAxisOffset : 0);
-          tensor[libjit_getXY(tensorDim, C[0], C[1])] =
-              slice[libjit_getXY(sliceDim, x, y)];
+  for (size_t c = 0; c < count; c++) {
+    const size_t countAxisOffset = c * sliceDim[axis];
+    // Destination coordinates of the current block.
+    size_t C[5] = {0, 0, 0, 0, 0};
+    for (size_t b = 0; b < numBlocks; b++) {
+      // Compute the flat index of the block start in the big tensor.
+      size_t tensorIdx = 0;
+      for (size_t i = 0; i < numDimsSlice; i++) {
+        size_t coord =
+            C[i] + offsets_cpy[i] + ((axis == i) ? countAxisOffset : 0);
+        tensorIdx = tensorIdx * tensorDim[i] + coord;
+      }
+      memcpy(tensor + tensorIdx, slice + b * blockLen,
+             blockLen * sizeof(ElemTy));
+      // Advance the outer coordinates.
+      for (size_t i = numOuterDims; i > 0; i--) {
+        if (++C[i - 1] < sliceDim[i - 1]) {
+          break;
         }
-    return;
-  }
-
-  if (numDimsSlice == 1) {
-    for (size_t c = 0; c < count; c++)
-      for (size_t x = 0; x < sliceDim[0]; x++) {
-        const size_t countAxisOffset = c * sliceDim[axis];
-        tensor[x + offsets_cpy[0] + ((axis == 0) ? countAxisOffset : 0)] =
-            slice[x];
+        C[i - 1] = 0;
       }
-    return;
+    }
   }
 }
 
@@ -224,9 +201,6 @@ void libjit_extract_tensor(ElemTy *tensor, ElemTy *slice, size_t *offset,
                            size_t *tensorDim, size_t *sliceDim,
                            size_t numDimsTensor, size_t numDimsSlice,
                            size_t offsetDim) {
-  // Source coordinates.
-  size_t C[5];
-
   // A local copy of the offsets buffer. We copy the buffer to make it clear
   // to the optimizer that the inputs don't alias. This loop is optimized away.
   size_t offsets_cpy[5];
@@ -234,68 +208,42 @@ void libjit_extract_tensor(ElemTy *tensor, ElemTy *slice, size_t *offset,
     offsets_cpy[i] = offset[i];
   }
 
-  if (numDimsSlice == 5) {
-    for (size_t x = 0; x < sliceDim[0]; x++)
-      for (size_t y = 0; y < sliceDim[1]; y++)
-        for (size_t z = 0; z < sliceDim[2]; z++)
-          for (size_t w = 0; w < sliceDim[3]; w++)
-            for (size_t q = 0; q < sliceDim[4]; q++) {
-              C[0] = x + offsets_cpy[0];
-              C[1] = y + offsets_cpy[1];
-              C[2] = z + offsets_cpy[2];
-              C[3] = w + offsets_cpy[3];
-              C[4] = q + offsets_cpy[4];
-              slice[libjit_getXYZWQ(sliceDim, x, y, z, w, q)] =
-                  tensor[libjit_getXYZWQ(tensorDim, C[0], C[1], C[2], C[3],
-                                         C[4])];
-            }
-    return;
+  // As in libjit_insert_tensor above, collapse the trailing dimensions in
+  // which the slice spans the whole tensor, plus the partial dimension
+  // right above them, into a single memcpy per block.
+  size_t firstFullDim = numDimsSlice;
+  while (firstFullDim > 0 &&
+         sliceDim[firstFullDim - 1] == tensorDim[firstFullDim - 1]) {
+    firstFullDim--;
   }
 
-  if (numDimsSlice == 4) {
-    for (size_t x = 0; x < sliceDim[0]; x++)
-      for (size_t y = 0; y < sliceDim[1]; y++)
-        for (size_t z = 0; z < sliceDim[2]; z++)
-          for (size_t w = 0; w < sliceDim[3]; w++) {
-            C[0] = x + offsets_cpy[0];
-            C[1] = y + offsets_cpy[1];
-            C[2] = z + offsets_cpy[2];
-            C[3] = w + offsets_cpy[3];
-            slice[libjit_getXYZW(sliceDim, x, y, z, w)] =
-                tensor[libjit_getXYZW(tensorDim, C[0], C[1], C[2], C[3])];
-          }
-    return;
+  size_t numOuterDims = firstFullDim > 0 ? firstFullDim - 1 : 0;
+  size_t blockLen = 1;
+  for (size_t i = numOuterDims; i < numDimsSlice; i++) {
+    blockLen *= sliceDim[i];
   }
-
-  if (numDimsSlice == 3) {
-    for (size_t x = 0; x < sliceDim[0]; x++)
-      for (size_t y = 0; y < sliceDim[1]; y++)
-        for (size_t z = 0; z < sliceDim[2]; z++) {
-          C[0] = x + offsets_cpy[0];
-          C[1] = y + offsets_cpy[1];
-          C[2] = z + offsets_cpy[2];
-          slice[libjit_getXYZ(sliceDim, x, y, z)] =
-              tensor[libjit_getXYZ(tensorDim, C[0], C[1], C[2])];
-        }
-    return;
+  size_t numBlocks = 1;
+  for (size_t i = 0; i < numOuterDims; i++) {
+    numBlocks *= sliceDim[i];
   }
 
-  if (numDimsSlice == 2) {
-    for (size_t x = 0; x < sliceDim[0]; x++)
-      for (size_t y = 0; y < sliceDim[1]; y++) {
-        C[0] = x + offsets_cpy[0];
-        C[1] = y + offsets_cpy[1];
-        slice[libjit_getXY(sliceDim, x, y)] =
-            tensor[libjit_getXY(tensorDim, C[0], C[1])];
+  // Source coordinates of the current block.
+  size_t C[5] = {0, 0, 0, 0, 0};
+  for (size_t b = 0; b < numBlocks; b++) {
+    // Compute the flat index of the block start in the big tensor.
+    size_t tensorIdx = 0;
+    for (size_t i = 0; i < numDimsSlice; i++) {
+      tensorIdx = tensorIdx * tensorDim[i] + C[i] + offsets_cpy[i];
+    }
+    memcpy(slice + b * blockLen, tensor + tensorIdx,
+           blockLen * sizeof(ElemTy));
+    // Advance the outer coordinates.
+    for (size_t i = numOuterDims; i > 0; i--) {
+      if (++C[i - 1] < sliceDim[i - 1]) {
+        break;
       }
-    return;
-  }
-
-  if (numDimsSlice == 1) {
-    for (size_t x = 0; x < sliceDim[0]; x++) {
-      slice[x] = tensor[x + offsets_cpy[0]];
+      C[i - 1] = 0;
     }
-    return;
   }
 }
 
@@ -305,31 +253,60 @@ template <typename T> struct value_index {
   T value;
 };
 
-/// Helper function for TopK
-template <typename T> int value_index_sort(const void *va, const void *vb) {
-  value_index<T> *a = (value_index<T> *)va;
-  value_index<T> *b = (value_index<T> *)vb;
-  if (a->value != b->value)
-    return a->value > b->value ? -1 : 1;
-  return a->index < b->index ? -1 : 1;
+/// Helper function for TopK. \returns true if \p a ranks below \p b in the
+/// TopK output order, i.e. it has a smaller value, or an equal value and a
+/// larger index.
+template <typename T>
+bool value_index_less(const value_index<T> &a, const value_index<T> &b) {
+  if (a.value != b.value)
+    return a.value < b.value;
+  return a.index > b.index;
 }
 
-/// Generic Top-K function. Here, \p scratch is some allocated buffer space, \p
-/// size is the size of the input, and \p n is the size of the last dimension of
-/// the input.
+/// Helper function for TopK. Restores the min-heap property of the heap at
+/// \p heap with \p size elements, assuming that only the element at \p pos
+/// may violate it.
 template <typename T>
-void libjit_topk(T *values, size_t *indices, const T *input, size_t *scratch,
+void value_index_sift_down(value_index<T> *heap, size_t pos, size_t size) {
+  while (true) {
+    size_t smallest = pos;
+    size_t l = 2 * pos + 1;
+    size_t r = 2 * pos + 2;
+    if (l < size && value_index_less(heap[l], heap[smallest])) {
+      smallest = l;
+    }
+    if (r < size && value_index_less(heap[r], heap[smallest])) {
+      smallest = r;
+    }
+    if (smallest == pos) {
+      return;
+    }
+    value_index<T> tmp = heap[pos];
+    heap[pos] = heap[smallest];
+    heap[smallest] = tmp;
+    pos = smallest;
+  }
+}
+
+/// Generic Top-K function. Here, \p scratch is a buffer of at least \p k
+/// value_index entries, \p size is the size of the input, and \p n is the
+/// size of the last dimension of the input. Each slice is processed in
+/// O(n log k) with a bounded min-heap of the k best candidates seen so far,
+/// whose root is the worst kept element. \p IndexTy is the element type of
+/// the emitted index tensor, either size_t or a compact int32_t.
+template <typename T, typename IndexTy>
+void libjit_topk(T *values, IndexTy *indices, const T *input, size_t *scratch,
                  size_t k, size_t n, size_t size) {
   size_t in = 0;
   size_t out = 0;
 
-  value_index<T> *buffer = (value_index<T> *)scratch;
+  value_index<T> *heap = (value_index<T> *)scratch;
 
   // Specialize TopK for the case where K is 1.
   if (k == 1) {
     while (in < size) {
-      // Find the largest value by iterating over the array instead of calling
-      // 'sort'.
+      // Find the largest value by iterating over the array instead of
+      // maintaining a heap.
       value_index<T> mx = {0, input[in]};
       for (size_t i = 1; i < n; i++) {
         if (input[i + in] > mx.value) {
@@ -345,46 +322,163 @@ void libjit_topk(T *values, size_t *indices, const T *input, size_t *scratch,
   }
 
   while (in < size) {
-    for (size_t i = 0; i < n; i++) {
-      buffer[i].index = i;
-      buffer[i].value = input[in++];
+    // Fill the heap with the first k elements of the slice and establish
+    // the heap property.
+    for (size_t i = 0; i < k; i++) {
+      heap[i].index = i;
+      heap[i].value = input[in + i];
+    }
+    for (size_t i = k / 2; i-- > 0;) {
+      value_index_sift_down(heap, i, k);
     }
-    qsort(buffer, n, sizeof(value_index<T>), value_index_sort<T>);
+
+    // Scan the rest of the slice. A candidate that ranks above the root
+    // replaces it, evicting the worst kept element.
+    for (size_t i = k; i < n; i++) {
+      value_index<T> candidate = {i, input[in + i]};
+      if (value_index_less(heap[0], candidate)) {
+        heap[0] = candidate;
+        value_index_sift_down(heap, 0, k);
+      }
+    }
+
+    // Heap-sort in place: repeatedly move the worst remaining element to the
+    // back, which leaves the array ordered best-first.
+    for (size_t heapSize = k; heapSize > 1; heapSize--) {
+      value_index<T> tmp = heap[0];
+      heap[0] = heap[heapSize - 1];
+      heap[heapSize - 1] = tmp;
+      value_index_sift_down(heap, 0, heapSize - 1);
+    }
+
     for (size_t i = 0; i < k; i++) {
-      indices[out] = buffer[i].index;
-      values[out] = buffer[i].value;
+      indices[out] = heap[i].index;
+      values[out] = heap[i].value;
       out++;
     }
+    in += n;
   }
 }
 
-template <typename T>
-void libjit_gather(T *dest, const T *data, const size_t *indices,
-                   size_t numIndices, size_t sliceSize, size_t numSamples,
-                   size_t sampleSize) {
-  // The index of the slice that is being written.
-  size_t outIdx = 0;
+/// Copy the gathered rows [\p begin, \p end) of the index array \p indices
+/// from \p data to \p dest. The indices are all available up front, so the
+/// rows that will be needed a few iterations from now are prefetched while
+/// the current ones are being copied, which hides the random-access latency
+/// of embedding-style gathers.
+template <typename T, typename IndexTy>
+void libjit_gather_rows(T *dest, const T *data, const IndexTy *indices,
+                        size_t begin, size_t end, size_t sliceSize) {
+  // The distance, in rows, that the prefetches run ahead of the copies.
+  const size_t prefetchDistance = 16;
+  const size_t cacheLineSize = 64;
+  size_t rowBytes = sliceSize * sizeof(T);
+
+  for (size_t i = begin; i < end; i++) {
+    if (i + prefetchDistance < end) {
+      // Request the cache lines of an upcoming row, capped so that huge rows
+      // do not flood the prefetch queues.
+      const char *row =
+          (const char *)(data + indices[i + prefetchDistance] * sliceSize);
+      for (size_t b = 0; b < rowBytes && b < 4 * cacheLineSize;
+           b += cacheLineSize) {
+        __builtin_prefetch(row + b, 0, 1);
+      }
+    }
 
-  // For each sample in our batch:
-  for (size_t sample = 0; sample < numSamples; sample++) {
-    size_t sampleStart = sample * sampleSize;
+    const T *src = data + indices[i] * sliceSize;
+    T *dst = dest + i * sliceSize;
+    if (rowBytes <= 16) {
+      // Copy small rows element-wise to avoid the memcpy call overhead.
+      for (size_t j = 0; j < sliceSize; j++) {
+        dst[j] = src[j];
+      }
+    } else {
+      memcpy(dst, src, rowBytes);
+    }
+  }
+}
+
+/// The arguments of a libjit_gather call, plus the identity of one of the
+/// threads that shard its work.
+template <typename T, typename IndexTy> struct libjit_gather_task {
+  T *dest;
+  const T *data;
+  const IndexTy *indices;
+  size_t numIndices;
+  size_t sliceSize;
+  size_t numSamples;
+  size_t sampleSize;
+  unsigned threadId;
+  unsigned nthreads;
+};
 
-    // For each slice that we fetch:
-    for (size_t i = 0; i < numIndices; i++) {
-      size_t slice = indices[i];
+/// Perform this thread's share of a sharded gather. The index array is split
+/// into contiguous chunks, one per thread, so that every thread writes a
+/// contiguous range of the destination.
+template <typename T, typename IndexTy> void *libjit_gather_worker(void *arg) {
+  auto *t = (libjit_gather_task<T, IndexTy> *)arg;
+  size_t chunk = (t->numIndices + t->nthreads - 1) / t->nthreads;
+  size_t begin = t->threadId * chunk;
+  size_t end = MIN(begin + chunk, t->numIndices);
+
+  for (size_t sample = 0; sample < t->numSamples; sample++) {
+    libjit_gather_rows(t->dest + sample * t->numIndices * t->sliceSize,
+                       t->data + sample * t->sampleSize, t->indices, begin, end,
+                       t->sliceSize);
+  }
+  return nullptr;
+}
 
-      // Copy the slice.
-      memcpy(dest + outIdx * sliceSize, data + sampleStart + slice * sliceSize,
-             sliceSize * sizeof(T));
+template <typename T, typename IndexTy>
+void libjit_gather(T *dest, const T *data, const IndexTy *indices,
+                   size_t numIndices, size_t sliceSize, size_t numSamples,
+                   size_t sampleSize, unsigned nthreads) {
+  libjit_gather_task<T, IndexTy> task = {dest,       data,       indices,
+                                         numIndices, sliceSize,  numSamples,
+                                         sampleSize, 0,          1};
+
+  // Threading only pays off when there is enough copying to amortize the
+  // thread launches.
+  if (nthreads <= 1 || numIndices < 4 * (size_t)nthreads ||
+      numSamples * numIndices * sliceSize * sizeof(T) < (1 << 20)) {
+    libjit_gather_worker<T, IndexTy>(&task);
+    return;
+  }
 
-      // Point to the next location in the destination tensor.
-      outIdx++;
+  // Shard the index array over the threads. Every thread, including this
+  // one, copies its own contiguous chunk of the destination, so no
+  // synchronization is needed beyond the final join.
+  libjit_gather_task<T, IndexTy> tasks[nthreads];
+  pthread_t threads[nthreads];
+  for (unsigned t = 0; t < nthreads; t++) {
+    tasks[t] = task;
+    tasks[t].threadId = t;
+    tasks[t].nthreads = nthreads;
+  }
+  unsigned spawned = 0;
+  for (unsigned t = 1; t < nthreads; t++) {
+    if (pthread_create(&threads[t], nullptr, libjit_gather_worker<T, IndexTy>,
+                       &tasks[t])) {
+      // Could not spawn the thread; fold its share into this thread by
+      // running its task inline below.
+      break;
+    }
+    spawned = t;
+  }
+  // Run this thread's share, plus the shares of any threads that could not
+  // be spawned.
+  for (unsigned t = 0; t < nthreads; t++) {
+    if (t == 0 || t > spawned) {
+      libjit_gather_worker<T, IndexTy>(&tasks[t]);
     }
   }
+  for (unsigned t = 1; t <= spawned; t++) {
+    pthread_join(threads[t], nullptr);
+  }
 }
 
-template <typename T>
-void libjit_scatterassign(T *data, const size_t *indices, const T *slices,
+template <typename T, typename IndexTy>
+void libjit_scatterassign(T *data, const IndexTy *indices, const T *slices,
                           size_t numIndices, size_t sliceSize) {
   for (size_t i = 0; i < numIndices; i++) {
     size_t destDataIdx = indices[i];
@@ -393,6 +487,83 @@ void libjit_scatterassign(T *data, const size_t *indices, const T *slices,
   }
 }
 
+/// Gathers the rows of \p data selected by \p indices and accumulates them
+/// into \p dest: the first lengths[0] rows sum into dest row 0, the next
+/// lengths[1] rows into dest row 1, and so on. The rows are accumulated as
+/// they are gathered, so the full gathered matrix is never materialized. The
+/// indices are all available up front, so the rows needed a few iterations
+/// from now are prefetched while the current ones are being summed, hiding
+/// the random-access latency of embedding lookups.
+template <typename IndexTy>
+void libjit_sparse_lengths_sum_generic(float *dest, const float *data,
+                                       const IndexTy *indices,
+                                       const size_t *lengths, size_t segments,
+                                       size_t lineSize) {
+  // The distance, in rows, that the prefetches run ahead of the sums.
+  const size_t prefetchDistance = 16;
+  const size_t cacheLineSize = 64;
+  size_t rowBytes = lineSize * sizeof(float);
+  size_t numIndices = 0;
+  for (size_t i = 0; i < segments; i++) {
+    numIndices += lengths[i];
+  }
+
+  memset(dest, 0, segments * lineSize * sizeof(float));
+  size_t curIdx = 0;
+  for (size_t i = 0; i < segments; i++) {
+    float *out = dest + i * lineSize;
+    for (size_t j = 0, e = lengths[i]; j < e; j++, curIdx++) {
+      if (curIdx + prefetchDistance < numIndices) {
+        const char *row =
+            (const char *)(data + indices[curIdx + prefetchDistance] * lineSize);
+        for (size_t b = 0; b < rowBytes && b < 4 * cacheLineSize;
+             b += cacheLineSize) {
+          __builtin_prefetch(row + b, 0, 1);
+        }
+      }
+      const float *in = data + indices[curIdx] * lineSize;
+      for (size_t k = 0; k < lineSize; k++) {
+        out[k] += in[k];
+      }
+    }
+  }
+}
+
+template <typename T>
+void libjit_broadcast_generic(T *outW, const T *inW, const size_t *odim,
+                              const size_t *idim, size_t numDims) {
+  // The source strides, with zero in the stretched dimensions, so that the
+  // repeated reads come back to the same source elements.
+  size_t srcStrides[6];
+  size_t stride = 1;
+  for (size_t i = numDims; i > 0; i--) {
+    srcStrides[i - 1] = (idim[i - 1] == 1) ? 0 : stride;
+    stride *= idim[i - 1];
+  }
+
+  size_t counters[6] = {0};
+  size_t numElems = 1;
+  for (size_t i = 0; i < numDims; i++) {
+    numElems *= odim[i];
+  }
+
+  size_t srcIdx = 0;
+  for (size_t e = 0; e < numElems; e++) {
+    outW[e] = inW[srcIdx];
+    // Advance the destination odometer and the source index together.
+    for (size_t i = numDims; i > 0; i--) {
+      size_t d = i - 1;
+      counters[d]++;
+      srcIdx += srcStrides[d];
+      if (counters[d] < odim[d]) {
+        break;
+      }
+      counters[d] = 0;
+      srcIdx -= srcStrides[d] * odim[d];
+    }
+  }
+}
+
 template <typename T>
 void libjit_transpose_generic(const T *inW, T *outW, const size_t *idim,
                               const size_t *odim, const size_t *shuffle,
@@ -556,6 +727,280 @@ void libjit_pool_max_xy_generic(const T *inW, T *outW, size_t *inXY,
   }       // N
 }
 
+/// Compute the max-pool output for the sample \p n. The filter window is
+/// walked once per output coordinate and the max is formed across the whole
+/// depth row, which is contiguous in NHWC, eight channels at a time.
+void libjit_pool_max_f_slice(const float *inW, float *outW,
+                             const size_t *inWdims, const size_t *outWdims,
+                             size_t filterSize, size_t stride, size_t *pads,
+                             size_t n) {
+  size_t pad_t = pads[0];
+  size_t pad_l = pads[1];
+  size_t depth = inWdims[3];
+
+  // For each (x,y) step in the input/output tensor:
+  ssize_t x = -(ssize_t)pad_t;
+  for (size_t ax = 0; ax < outWdims[1]; x += stride, ax++) {
+    ssize_t y = -(ssize_t)pad_l;
+    for (size_t ay = 0; ay < outWdims[2]; y += stride, ay++) {
+      float *out = &outW[libjit_getXYZW(outWdims, n, ax, ay, 0)];
+      int first = 1;
+
+      // For each element in the pool filter:
+      for (size_t fx = 0; fx < filterSize; fx++) {
+        for (size_t fy = 0; fy < filterSize; fy++) {
+          ssize_t ox = x + fx;
+          ssize_t oy = y + fy;
+
+          // Ignore index access below zero (this is due to padding).
+          if (ox < 0 || oy < 0 || ox >= (ssize_t)inWdims[1] ||
+              oy >= (ssize_t)inWdims[2]) {
+            continue;
+          }
+
+          const float *in =
+              &inW[libjit_getXYZW(inWdims, n, (size_t)ox, (size_t)oy, 0)];
+          size_t z = 0;
+          if (first) {
+            // The first valid filter element initializes the output row.
+            first = 0;
+            for (; z + 8 <= depth; z += 8) {
+              StoreuFloat8(out + z, LoaduFloat8(in + z));
+            }
+            for (; z < depth; z++) {
+              out[z] = in[z];
+            }
+          } else {
+            for (; z + 8 <= depth; z += 8) {
+              StoreuFloat8(out + z,
+                           MaxFloat8(LoaduFloat8(out + z), LoaduFloat8(in + z)));
+            }
+            for (; z < depth; z++) {
+              out[z] = MAX(out[z], in[z]);
+            }
+          }
+        }
+      }
+
+      // The window was entirely in the padding area.
+      if (first) {
+        for (size_t z = 0; z < depth; z++) {
+          out[z] = 0;
+        }
+      }
+    } // W
+  }   // H
+}
+
+/// Compute the average-pool output for the sample \p n, accumulating the
+/// filter window into the contiguous depth row eight channels at a time.
+void libjit_pool_avg_f_slice(const float *inW, float *outW,
+                             const size_t *inWdims, const size_t *outWdims,
+                             size_t filterSize, size_t stride, size_t *pads,
+                             size_t n) {
+  size_t pad_t = pads[0];
+  size_t pad_l = pads[1];
+  size_t depth = inWdims[3];
+  float scale = 1.0f / (filterSize * filterSize);
+  float8 scaleV = SplatFloat8(scale);
+
+  // For each (x,y) step in the input/output tensor:
+  ssize_t x = -(ssize_t)pad_t;
+  for (size_t ax = 0; ax < outWdims[1]; x += stride, ax++) {
+    ssize_t y = -(ssize_t)pad_l;
+    for (size_t ay = 0; ay < outWdims[2]; y += stride, ay++) {
+      float *out = &outW[libjit_getXYZW(outWdims, n, ax, ay, 0)];
+      for (size_t z = 0; z < depth; z++) {
+        out[z] = 0;
+      }
+
+      // For each element in the pool filter:
+      for (size_t fx = 0; fx < filterSize; fx++) {
+        for (size_t fy = 0; fy < filterSize; fy++) {
+          ssize_t ox = x + fx;
+          ssize_t oy = y + fy;
+
+          // Ignore index access below zero (this is due to padding).
+          if (ox < 0 || oy < 0 || ox >= (ssize_t)inWdims[1] ||
+              oy >= (ssize_t)inWdims[2]) {
+            continue;
+          }
+
+          const float *in =
+              &inW[libjit_getXYZW(inWdims, n, (size_t)ox, (size_t)oy, 0)];
+          size_t z = 0;
+          for (; z + 8 <= depth; z += 8) {
+            AdduFloat8(out + z, LoaduFloat8(in + z));
+          }
+          for (; z < depth; z++) {
+            out[z] += in[z];
+          }
+        }
+      }
+
+      size_t z = 0;
+      for (; z + 8 <= depth; z += 8) {
+        StoreuFloat8(out + z, LoaduFloat8(out + z) * scaleV);
+      }
+      for (; z < depth; z++) {
+        out[z] *= scale;
+      }
+    } // W
+  }   // H
+}
+
+/// Compute the LRN output for the sample \p n. The sum of squares of the
+/// normalization window is maintained incrementally across the channel
+/// dimension, as in the gradient kernel, and the pow() of the scale is
+/// evaluated eight channels at a time as exp(-beta * log(scale)).
+void libjit_local_response_normalization_f_slice(
+    float *outW, const float *inW, float *scaleCache, const size_t *outWdims,
+    const size_t *inWdims, size_t halfWindow, float normedAlpha, float beta,
+    float k, size_t n) {
+  size_t numChannels = inWdims[3];
+  for (size_t h = 0; h < inWdims[1]; h++) {
+    for (size_t w = 0; w < inWdims[2]; w++) {
+      const float *in = &inW[libjit_getXYZW(inWdims, n, h, w, 0)];
+      float *scale = &scaleCache[libjit_getXYZW(inWdims, n, h, w, 0)];
+      float *out = &outW[libjit_getXYZW(outWdims, n, h, w, 0)];
+
+      // Prepare the right half of the sliding window based at c = 0.
+      float m2 = 0.0;
+      for (size_t i = 0; i < MIN(halfWindow, numChannels); i++) {
+        m2 += in[i] * in[i];
+      }
+
+      for (size_t c = 0; c < numChannels; c++) {
+        if (c > halfWindow) {
+          float val = in[c - halfWindow - 1];
+          m2 -= val * val;
+        }
+
+        size_t j = c + halfWindow;
+        if (j < numChannels) {
+          m2 += in[j] * in[j];
+        }
+
+        scale[c] = k + normedAlpha * m2;
+      }
+
+      // Normalize the input by scale^(-beta), eight channels at a time.
+      size_t c = 0;
+      for (; c + 8 <= numChannels; c += 8) {
+        float8 normFactor =
+            ExpFloat8(LogFloat8(LoaduFloat8(&scale[c])) * -beta);
+        StoreuFloat8(&out[c], LoaduFloat8(&in[c]) * normFactor);
+      }
+      for (; c < numChannels; c++) {
+        out[c] = in[c] * powf(scale[c], -beta);
+      }
+    } // W
+  }   // H
+}
+
+/// The arguments of a libjit_local_response_normalization_f call, plus the
+/// identity of one of the threads that shard its work.
+struct libjit_lrn_task {
+  float *outW;
+  const float *inW;
+  float *scaleCache;
+  const size_t *outWdims;
+  const size_t *inWdims;
+  size_t halfWindow;
+  float normedAlpha;
+  float beta;
+  float k;
+  unsigned threadId;
+  unsigned nthreads;
+};
+
+/// Perform this thread's share of a sharded LRN. The samples of the batch
+/// are dealt round-robin to the threads.
+void *libjit_lrn_worker(void *arg) {
+  auto *T = (libjit_lrn_task *)arg;
+  for (size_t n = T->threadId; n < T->inWdims[0]; n += T->nthreads) {
+    libjit_local_response_normalization_f_slice(
+        T->outW, T->inW, T->scaleCache, T->outWdims, T->inWdims, T->halfWindow,
+        T->normedAlpha, T->beta, T->k, n);
+  }
+  return nullptr;
+}
+
+/// The arguments of a pooling kernel call, plus the identity of one of the
+/// threads that shard its work. Max- and average-pooling take the same
+/// arguments and share this task type.
+struct libjit_pool_task {
+  const float *inW;
+  float *outW;
+  const size_t *inWdims;
+  const size_t *outWdims;
+  size_t filterSize;
+  size_t stride;
+  size_t *pads;
+  unsigned threadId;
+  unsigned nthreads;
+};
+
+/// Perform this thread's share of a sharded max-pool. The samples of the
+/// batch are dealt round-robin to the threads.
+void *libjit_pool_max_f_worker(void *arg) {
+  auto *T = (libjit_pool_task *)arg;
+  for (size_t n = T->threadId; n < T->outWdims[0]; n += T->nthreads) {
+    libjit_pool_max_f_slice(T->inW, T->outW, T->inWdims, T->outWdims,
+                            T->filterSize, T->stride, T->pads, n);
+  }
+  return nullptr;
+}
+
+/// Perform this thread's share of a sharded average-pool.
+void *libjit_pool_avg_f_worker(void *arg) {
+  auto *T = (libjit_pool_task *)arg;
+  for (size_t n = T->threadId; n < T->outWdims[0]; n += T->nthreads) {
+    libjit_pool_avg_f_slice(T->inW, T->outW, T->inWdims, T->outWdims,
+                            T->filterSize, T->stride, T->pads, n);
+  }
+  return nullptr;
+}
+
+/// Shard the samples of a pooling \p task over \p nthreads threads running
+/// \p worker. Every thread, including this one, processes its share; the
+/// samples write disjoint slices of the output, so no synchronization is
+/// needed beyond the final join.
+void libjit_pool_f_threaded(libjit_pool_task *task, void *(*worker)(void *),
+                            unsigned nthreads) {
+  if (nthreads <= 1 || task->outWdims[0] < 2) {
+    worker(task);
+    return;
+  }
+
+  libjit_pool_task tasks[nthreads];
+  pthread_t threads[nthreads];
+  for (unsigned t = 0; t < nthreads; t++) {
+    tasks[t] = *task;
+    tasks[t].threadId = t;
+    tasks[t].nthreads = nthreads;
+  }
+  unsigned spawned = 0;
+  for (unsigned t = 1; t < nthreads; t++) {
+    if (pthread_create(&threads[t], nullptr, worker, &tasks[t])) {
+      // Could not spawn the thread; fold its share into this thread by
+      // running its task inline below.
+      break;
+    }
+    spawned = t;
+  }
+  // Run this thread's share, plus the shares of any threads that could not
+  // be spawned.
+  for (unsigned t = 0; t < nthreads; t++) {
+    if (t == 0 || t > spawned) {
+      worker(&tasks[t]);
+    }
+  }
+  for (unsigned t = 1; t <= spawned; t++) {
+    pthread_join(threads[t], nullptr);
+  }
+}
+
 } // namespace
 
 extern "C" {
@@ -651,6 +1096,74 @@ DEFINE_DATA_PARALLEL_KERNEL_QUANTIZED(libjit_elementmin_kernel_i8, int8_t,
 DEFINE_DATA_PARALLEL_KERNEL_QUANTIZED_M(libjit_element_mul_kernel_i8, lhs *rhs)
 DEFINE_DATA_PARALLEL_KERNEL_QUANTIZED_M(libjit_element_div_kernel_i8, lhs / rhs)
 
+/// Macro to define a fused whole-buffer kernel for quantized arithmetic
+/// operations that rescale both operands. The rescale, the operation and the
+/// saturating clamp all stay in 32-bit integer vector registers, eight
+/// elements at a time. These kernels are called for single quantized
+/// arithmetic instructions; sequences of data parallel instructions keep
+/// using the generated stacked kernels and the mini-kernels above.
+/// \p name the name of the kernel
+/// \p vecBody the operation on the rescaled int32x8 operands
+/// \p body the same operation on the rescaled scalar operands
+#define DEFINE_FUSED_KERNEL_QUANTIZED(name, vecBody, body)                     \
+  void name(int8_t *dest, const int8_t *LHS, const int8_t *RHS,                \
+            size_t numElem, int32_t destOffset, int32_t lhsOffset,             \
+            int32_t rhsOffset, int32_t lhsPre, int32_t lhsPost,                \
+            int32_t lhsScale, int32_t rhsPre, int32_t rhsPost,                 \
+            int32_t rhsScale) {                                                \
+    size_t i = 0;                                                              \
+    for (; i + 8 <= numElem; i += 8) {                                         \
+      int32x8 lhs =                                                            \
+          libjit_scale_i32x8(LoaduInt8x8ToInt32x8(&LHS[i]) - lhsOffset,        \
+                             lhsPre, lhsPost, lhsScale, 0);                    \
+      int32x8 rhs =                                                            \
+          libjit_scale_i32x8(LoaduInt8x8ToInt32x8(&RHS[i]) - rhsOffset,        \
+                             rhsPre, rhsPost, rhsScale, 0);                    \
+      StoreuInt8x8(&dest[i], ClipInt32x8ToInt8x8((vecBody) + destOffset));     \
+    }                                                                          \
+    for (; i < numElem; i++) {                                                 \
+      int32_t lhs = libjit_scale_i32i8(LHS[i] - lhsOffset, lhsPre, lhsPost,    \
+                                       lhsScale, 0);                           \
+      int32_t rhs = libjit_scale_i32i8(RHS[i] - rhsOffset, rhsPre, rhsPost,    \
+                                       rhsScale, 0);                           \
+      dest[i] = libjit_clip((body) + destOffset);                              \
+    }                                                                          \
+  }
+
+/// Macro to define a fused whole-buffer kernel for multiplicative quantized
+/// operations, which rescale once after the operation. See
+/// DEFINE_FUSED_KERNEL_QUANTIZED for the structure.
+/// \p name the name of the kernel
+/// \p vecBody the operation on the offset-corrected int32x8 operands
+/// \p body the same operation on the offset-corrected scalar operands
+#define DEFINE_FUSED_KERNEL_QUANTIZED_M(name, vecBody, body)                   \
+  void name(int8_t *dest, const int8_t *LHS, const int8_t *RHS,                \
+            size_t numElem, int32_t destOffset, int32_t lhsOffset,             \
+            int32_t rhsOffset, int32_t pre, int32_t post, int32_t scale) {     \
+    size_t i = 0;                                                              \
+    for (; i + 8 <= numElem; i += 8) {                                         \
+      int32x8 lhs = LoaduInt8x8ToInt32x8(&LHS[i]) - lhsOffset;                 \
+      int32x8 rhs = LoaduInt8x8ToInt32x8(&RHS[i]) - rhsOffset;                 \
+      StoreuInt8x8(&dest[i], ClipInt32x8ToInt8x8(libjit_scale_i32x8(           \
+                                 (vecBody), pre, post, scale, destOffset)));   \
+    }                                                                          \
+    for (; i < numElem; i++) {                                                 \
+      int32_t lhs = LHS[i] - lhsOffset;                                        \
+      int32_t rhs = RHS[i] - rhsOffset;                                        \
+      dest[i] = libjit_clip(                                                   \
+          libjit_scale_i32i8((body), pre, post, scale, destOffset));           \
+    }                                                                          \
+  }
+
+DEFINE_FUSED_KERNEL_QUANTIZED(libjit_element_add_i8, lhs + rhs, lhs + rhs)
+DEFINE_FUSED_KERNEL_QUANTIZED(libjit_element_sub_i8, lhs - rhs, lhs - rhs)
+DEFINE_FUSED_KERNEL_QUANTIZED(libjit_elementmax_i8, MaxInt32x8(lhs, rhs),
+                              MAX(lhs, rhs))
+DEFINE_FUSED_KERNEL_QUANTIZED(libjit_elementmin_i8, MinInt32x8(lhs, rhs),
+                              MIN(lhs, rhs))
+DEFINE_FUSED_KERNEL_QUANTIZED_M(libjit_element_mul_i8, lhs *rhs, lhs *rhs)
+DEFINE_FUSED_KERNEL_QUANTIZED_M(libjit_element_div_i8, lhs / rhs, lhs / rhs)
+
 int8_t libjit_element_cmp_lte_kernel_i8(size_t idx, const int8_t *LHS,
                                         const int8_t *RHS, int32_t lhsOffset,
                                         int32_t rhsOffset, int32_t pre,
@@ -667,6 +1180,11 @@ int8_t libjit_element_cmp_lte_kernel_i8(size_t idx, const int8_t *LHS,
 // approximation by a direct tanh call.
 DEFINE_DATA_PARALLEL_KERNEL(libjit_tanh_kernel_f, float,
                             1 - 2 / (expf(LHS[idx] * 2) + 1))
+// The fast variant replaces the libm expf call with the inlinable Cephes
+// polynomial, which lets LLVM vectorize the stacked data-parallel loop. It
+// is selected by the -fast-sigmoid-tanh flag of the CPU backend.
+DEFINE_DATA_PARALLEL_KERNEL(libjit_tanh_fast_kernel_f, float,
+                            glow::fastTanhf(LHS[idx]))
 DEFINE_DATA_PARALLEL_KERNEL(libjit_elementselect_kernel_f, float,
                             (LHS[idx] != 0.0) ? RHS[idx] : op3[idx])
 
@@ -693,10 +1211,17 @@ DEFINE_DATA_PARALLEL_KERNEL_FUNC(libjit_sigmoid_kernel_f) {
   float e = expf(LHS[idx]);
   return e / (e + 1);
 }
+// See the comment on libjit_tanh_fast_kernel_f.
+DEFINE_DATA_PARALLEL_KERNEL(libjit_sigmoid_fast_kernel_f, float,
+                            glow::fastSigmoidf(LHS[idx]))
 DEFINE_DATA_PARALLEL_KERNEL_WITH_IMM_OPERAND(libjit_element_maxsplat_kernel_f,
                                              float, MAX(LHS[idx], val))
 DEFINE_DATA_PARALLEL_KERNEL_WITH_IMM_OPERAND(libjit_element_maxsplat_kernel_i8,
                                              int8_t, MAX(LHS[idx], val))
+DEFINE_DATA_PARALLEL_KERNEL_WITH_IMM_OPERAND(libjit_element_mulsplat_kernel_f,
+                                             float, LHS[idx] * val)
+DEFINE_DATA_PARALLEL_KERNEL_WITH_IMM_OPERAND(libjit_element_subsplat_kernel_f,
+                                             float, LHS[idx] - val)
 DEFINE_DATA_PARALLEL_KERNEL_WITH_IMM_OPERAND(libjit_element_pow_kernel_f, float,
                                              pow(LHS[idx], val))
 DEFINE_DATA_PARALLEL_KERNEL_WITH_IMM_OPERAND(libjit_splat_kernel_f, float, val)
@@ -742,24 +1267,52 @@ void libjit_batchedadd_i8(int8_t *dest, const int8_t *batch,
 
 /// The dimensions passed in here are pre-expanded in LLVMIRGen with 1s so that
 /// we can iterate over the shape here, regardless of the shape of the tensor.
+/// The batch is viewed as [pre x n x post], where n is the reduced dimension.
 void libjit_batchedreduceadd_f(float *dest, const float *batch, size_t destSize,
                                const size_t *destDims, const size_t *batchDims,
                                size_t axis) {
-  for (size_t i = 0; i < destSize; i++)
-    dest[i] = 0.0;
-
-  for (size_t x = 0; x < batchDims[0]; x++)
-    for (size_t y = 0; y < batchDims[1]; y++)
-      for (size_t z = 0; z < batchDims[2]; z++)
-        for (size_t w = 0; w < batchDims[3]; w++)
-          for (size_t q = 0; q < batchDims[4]; q++)
-            for (size_t r = 0; r < batchDims[5]; r++) {
-              size_t I[] = {x, y, z, w, q, r};
-              I[axis] = 0;
-              dest[libjit_getXYZWQR(destDims, I[0], I[1], I[2], I[3], I[4],
-                                    I[5])] +=
-                  batch[libjit_getXYZWQR(batchDims, x, y, z, w, q, r)];
-            }
+  (void)destDims;
+  size_t pre = 1, post = 1;
+  for (size_t i = 0; i < axis; i++)
+    pre *= batchDims[i];
+  for (size_t i = axis + 1; i < 6; i++)
+    post *= batchDims[i];
+  size_t n = batchDims[axis];
+
+  if (post > 1) {
+    // The reduced dimension is not innermost: accumulate whole contiguous
+    // inner slices into the destination slice, which vectorizes across the
+    // slice and keeps independent element chains.
+    for (size_t i = 0; i < destSize; i++)
+      dest[i] = 0.0;
+    for (size_t p = 0; p < pre; p++) {
+      const float *b = &batch[p * n * post];
+      float *d = &dest[p * post];
+      for (size_t a = 0; a < n; a++, b += post)
+        for (size_t q = 0; q < post; q++)
+          d[q] += b[q];
+    }
+    return;
+  }
+
+  // Reducing the innermost dimension: a single running sum is one long
+  // dependency chain with poor ILP and, in fp32, linearly accumulating
+  // rounding error. Reduce into four parallel accumulators and combine them
+  // pairwise at the end.
+  for (size_t p = 0; p < pre; p++) {
+    const float *b = &batch[p * n];
+    float s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    size_t a = 0;
+    for (; a + 4 <= n; a += 4) {
+      s0 += b[a];
+      s1 += b[a + 1];
+      s2 += b[a + 2];
+      s3 += b[a + 3];
+    }
+    for (; a < n; a++)
+      s0 += b[a];
+    dest[p] = (s0 + s1) + (s2 + s3);
+  }
 }
 
 /// Same as the non-quantized version, the dimensions here are pre-expanded in
@@ -818,16 +1371,46 @@ void libjit_cross_entropy_loss_f(float *CE, float *P, size_t *labels,
 
 void libjit_gather_f(float *dest, const float *data, const size_t *indices,
                      size_t numIndices, size_t sliceSize, size_t numSamples,
-                     size_t sampleSize) {
+                     size_t sampleSize, unsigned nthreads) {
   libjit_gather(dest, data, indices, numIndices, sliceSize, numSamples,
-                sampleSize);
+                sampleSize, nthreads);
 }
 
 void libjit_gather_i8(int8_t *dest, const int8_t *data, const size_t *indices,
                       size_t numIndices, size_t sliceSize, size_t numSamples,
-                      size_t sampleSize) {
+                      size_t sampleSize, unsigned nthreads) {
+  libjit_gather(dest, data, indices, numIndices, sliceSize, numSamples,
+                sampleSize, nthreads);
+}
+
+void libjit_gather32_f(float *dest, const float *data, const int32_t *indices,
+                       size_t numIndices, size_t sliceSize, size_t numSamples,
+                       size_t sampleSize, unsigned nthreads) {
   libjit_gather(dest, data, indices, numIndices, sliceSize, numSamples,
-                sampleSize);
+                sampleSize, nthreads);
+}
+
+void libjit_gather32_i8(int8_t *dest, const int8_t *data,
+                        const int32_t *indices, size_t numIndices,
+                        size_t sliceSize, size_t numSamples, size_t sampleSize,
+                        unsigned nthreads) {
+  libjit_gather(dest, data, indices, numIndices, sliceSize, numSamples,
+                sampleSize, nthreads);
+}
+
+void libjit_sparse_lengths_sum_f(float *dest, const float *data,
+                                 const size_t *indices, const size_t *lengths,
+                                 size_t segments, size_t lineSize) {
+  libjit_sparse_lengths_sum_generic(dest, data, indices, lengths, segments,
+                                    lineSize);
+}
+
+void libjit_sparse_lengths_sum32_f(float *dest, const float *data,
+                                   const int32_t *indices,
+                                   const size_t *lengths, size_t segments,
+                                   size_t lineSize) {
+  libjit_sparse_lengths_sum_generic(dest, data, indices, lengths, segments,
+                                    lineSize);
 }
 
 void libjit_scatterassign_f(float *data, const size_t *indices,
@@ -840,36 +1423,61 @@ void libjit_scatterassign_i8(int8_t *data, const size_t *indices,
                              size_t sliceSize) {
   libjit_scatterassign(data, indices, slices, numIndices, sliceSize);
 }
+void libjit_scatterassign32_f(float *data, const int32_t *indices,
+                              const float *slices, size_t numIndices,
+                              size_t sliceSize) {
+  libjit_scatterassign(data, indices, slices, numIndices, sliceSize);
+}
+void libjit_scatterassign32_i8(int8_t *data, const int32_t *indices,
+                               const int8_t *slices, size_t numIndices,
+                               size_t sliceSize) {
+  libjit_scatterassign(data, indices, slices, numIndices, sliceSize);
+}
 
-void libjit_local_response_normalization_f(float *outW, const float *inW,
-                                           float *scaleCache,
-                                           const size_t *outWdims,
-                                           const size_t *inWdims,
-                                           size_t halfWindow, float alpha,
-                                           float beta, float k) {
+void libjit_local_response_normalization_f(
+    float *outW, const float *inW, float *scaleCache, const size_t *outWdims,
+    const size_t *inWdims, size_t halfWindow, float alpha, float beta, float k,
+    unsigned nthreads) {
   size_t window = 2 * halfWindow + 1;
   float normedAlpha = alpha / window;
 
-  for (size_t n = 0; n < inWdims[0]; n++) {
-    for (size_t h = 0; h < inWdims[1]; h++) {
-      for (size_t w = 0; w < inWdims[2]; w++) {
-        for (size_t c = 0; c < inWdims[3]; c++) {
-          float m2 = 0.0;
-          for (size_t i = (c >= halfWindow ? c - halfWindow : 0);
-               i <= MIN(c + halfWindow, inWdims[3] - 1); i++) {
-            float val = inW[libjit_getXYZW(inWdims, n, h, w, i)];
-            m2 += val * val;
-          }
+  libjit_lrn_task task = {outW, inW,  scaleCache, outWdims, inWdims, halfWindow,
+                          normedAlpha, beta,      k,        0,       1};
 
-          float scale = k + normedAlpha * m2;
-          scaleCache[libjit_getXYZW(inWdims, n, h, w, c)] = scale;
-          float normFactor = pow(scale, -beta);
-          outW[libjit_getXYZW(outWdims, n, h, w, c)] =
-              inW[libjit_getXYZW(inWdims, n, h, w, c)] * normFactor;
-        } // C
-      }   // W
-    }     // H
-  }       // N
+  if (nthreads <= 1 || inWdims[0] < 2) {
+    libjit_lrn_worker(&task);
+    return;
+  }
+
+  // Shard the samples of the batch over the threads. Every thread, including
+  // this one, processes its share; the samples write disjoint slices of the
+  // output, so no synchronization is needed beyond the final join.
+  libjit_lrn_task tasks[nthreads];
+  pthread_t threads[nthreads];
+  for (unsigned t = 0; t < nthreads; t++) {
+    tasks[t] = task;
+    tasks[t].threadId = t;
+    tasks[t].nthreads = nthreads;
+  }
+  unsigned spawned = 0;
+  for (unsigned t = 1; t < nthreads; t++) {
+    if (pthread_create(&threads[t], nullptr, libjit_lrn_worker, &tasks[t])) {
+      // Could not spawn the thread; fold its share into this thread by
+      // running its task inline below.
+      break;
+    }
+    spawned = t;
+  }
+  // Run this thread's share, plus the shares of any threads that could not
+  // be spawned.
+  for (unsigned t = 0; t < nthreads; t++) {
+    if (t == 0 || t > spawned) {
+      libjit_lrn_worker(&tasks[t]);
+    }
+  }
+  for (unsigned t = 1; t <= spawned; t++) {
+    pthread_join(threads[t], nullptr);
+  }
 }
 
 void libjit_local_response_normalization_grad_f(
@@ -928,9 +1536,10 @@ void libjit_pool_max_i8(const int8_t *inW, int8_t *outW, const size_t *inWdims,
 }
 void libjit_pool_max_f(const float *inW, float *outW, const size_t *inWdims,
                        const size_t *outWdims, size_t filterSize, size_t stride,
-                       size_t *pads) {
-  libjit_pool_max_generic(inW, outW, inWdims, outWdims, filterSize, stride,
-                          pads);
+                       size_t *pads, unsigned nthreads) {
+  libjit_pool_task task = {inW,    outW, inWdims, outWdims, filterSize,
+                           stride, pads, 0,       1};
+  libjit_pool_f_threaded(&task, libjit_pool_max_f_worker, nthreads);
 }
 
 void libjit_pool_max_xy_i8(const int8_t *inW, int8_t *outW, size_t *inXY,
@@ -1020,42 +1629,10 @@ void libjit_pool_avg_i8(const int8_t *inW, int8_t *outW, const size_t *inWdims,
 
 void libjit_pool_avg_f(const float *inW, float *outW, const size_t *inWdims,
                        const size_t *outWdims, size_t filterSize, size_t stride,
-                       size_t *pads) {
-  size_t pad_t = pads[0];
-  size_t pad_l = pads[1];
-  float filterArea = filterSize * filterSize;
-  // For each input in the batch:
-  for (size_t n = 0; n < outWdims[0]; n++) {
-    // For each (x,y) step in the input/output tensor:
-    ssize_t x = -(ssize_t)pad_t;
-    for (size_t ax = 0; ax < outWdims[1]; x += stride, ax++) {
-      ssize_t y = -(ssize_t)pad_l;
-      for (size_t ay = 0; ay < outWdims[2]; y += stride, ay++) {
-        // For each layer in the output tensor:
-        for (size_t z = 0; z < inWdims[3]; z++) {
-
-          float sum = 0;
-
-          for (size_t fx = 0; fx < filterSize; fx++) {
-            for (size_t fy = 0; fy < filterSize; fy++) {
-              ssize_t ox = x + fx;
-              ssize_t oy = y + fy;
-
-              // Ignore index access below zero (this is due to padding).
-              if (ox < 0 || oy < 0 || ox >= (ssize_t)inWdims[1] ||
-                  oy >= (ssize_t)inWdims[2]) {
-                continue;
-              }
-
-              sum += inW[libjit_getXYZW(inWdims, n, (size_t)ox, (size_t)oy, z)];
-            }
-          }
-
-          outW[libjit_getXYZW(outWdims, n, ax, ay, z)] = sum / filterArea;
-        } // C
-      }   // W
-    }     // H
-  }       // N
+                       size_t *pads, unsigned nthreads) {
+  libjit_pool_task task = {inW,    outW, inWdims, outWdims, filterSize,
+                           stride, pads, 0,       1};
+  libjit_pool_f_threaded(&task, libjit_pool_avg_f_worker, nthreads);
 }
 
 void libjit_pool_avg_grad_f(float *inG, const float *outG,
@@ -1099,15 +1676,33 @@ void libjit_pool_avg_grad_f(float *inG, const float *outG,
 
 void libjit_quantize_i8(int8_t *outW, const float *inW, size_t numElem,
                         float scale, int32_t offset) {
-  for (size_t i = 0; i < numElem; i++) {
-    int32_t result = (int32_t)nearbyintf(inW[i] / scale + offset);
+  float invScale = 1.0f / scale;
+  float8 invScaleV = SplatFloat8(invScale);
+  float8 offsetV = SplatFloat8((float)offset);
+  // Scale eight lanes at once, round them to int32 and clip-pack to int8.
+  size_t i = 0;
+  for (; i + 8 <= numElem; i += 8) {
+    int32x8 q =
+        RoundFloat8ToInt32x8(LoaduFloat8(&inW[i]) * invScaleV + offsetV);
+    StoreuInt8x8(&outW[i], ClipInt32x8ToInt8x8(q));
+  }
+  for (; i < numElem; i++) {
+    int32_t result = (int32_t)nearbyintf(inW[i] * invScale + offset);
     outW[i] = MAX(INT8_MIN, MIN(INT8_MAX, result));
   }
 }
 
 void libjit_dequantize_f(float *outW, const int8_t *inW, size_t numElem,
                          float scale, int32_t offset) {
-  for (size_t i = 0; i < numElem; i++) {
+  float8 scaleV = SplatFloat8(scale);
+  // The int8 lanes are widened to int32, offset-corrected exactly in the
+  // integer domain, and only then converted to float.
+  size_t i = 0;
+  for (; i + 8 <= numElem; i += 8) {
+    int32x8 in = LoaduInt8x8ToInt32x8(&inW[i]) - offset;
+    StoreuFloat8(&outW[i], __builtin_convertvector(in, float8) * scaleV);
+  }
+  for (; i < numElem; i++) {
     outW[i] = scale * (inW[i] - offset);
   }
 }
@@ -1115,7 +1710,13 @@ void libjit_dequantize_f(float *outW, const int8_t *inW, size_t numElem,
 void libjit_rescale_i8(int8_t *outW, const int8_t *inW, size_t numElem,
                        int32_t outOffset, int32_t inOffset, int32_t pre,
                        int32_t post, int32_t scale) {
-  for (size_t i = 0; i < numElem; i++) {
+  size_t i = 0;
+  for (; i + 8 <= numElem; i += 8) {
+    int32x8 s = libjit_scale_i32x8(LoaduInt8x8ToInt32x8(&inW[i]) - inOffset,
+                                   pre, post, scale, outOffset);
+    StoreuInt8x8(&outW[i], ClipInt32x8ToInt8x8(s));
+  }
+  for (; i < numElem; i++) {
     int32_t s =
         libjit_scale_i32i8(inW[i] - inOffset, pre, post, scale, outOffset);
     outW[i] = libjit_clip(s);
@@ -1124,26 +1725,51 @@ void libjit_rescale_i8(int8_t *outW, const int8_t *inW, size_t numElem,
 
 void libjit_softmax_f(const float *inW, float *outW, const size_t *idim,
                       const size_t *odim) {
+  size_t len = idim[1];
   for (size_t n = 0; n < idim[0]; n++) {
-    float max = inW[libjit_getXY(idim, n, 0)];
-
-    // Find Max.
-    for (size_t i = 1; i < idim[1]; i++) {
-      max = MAX(max, inW[libjit_getXY(idim, n, i)]);
+    const float *in = &inW[libjit_getXY(idim, n, 0)];
+    float *out = &outW[libjit_getXY(odim, n, 0)];
+
+    // Find Max, eight elements at a time.
+    float max = in[0];
+    size_t i = 0;
+    if (len >= 8) {
+      float8 maxV = LoaduFloat8(in);
+      for (i = 8; i + 8 <= len; i += 8) {
+        maxV = MaxFloat8(maxV, LoaduFloat8(&in[i]));
+      }
+      for (unsigned l = 0; l < 8; l++) {
+        max = MAX(max, maxV[l]);
+      }
+    }
+    for (; i < len; i++) {
+      max = MAX(max, in[i]);
     }
 
+    // Compute exp with the vectorized approximation and accumulate the sum.
     float sum = 0;
-
-    // Compute exp.
-    for (size_t i = 0; i < idim[1]; i++) {
-      float e = expf(inW[libjit_getXY(idim, n, i)] - max);
+    float8 sumV = SplatFloat8(0.0f);
+    for (i = 0; i + 8 <= len; i += 8) {
+      float8 e = ExpFloat8(LoaduFloat8(&in[i]) - max);
+      sumV += e;
+      StoreuFloat8(&out[i], e);
+    }
+    for (unsigned l = 0; l < 8; l++) {
+      sum += sumV[l];
+    }
+    for (; i < len; i++) {
+      float e = expf(in[i] - max);
       sum += e;
-      outW[libjit_getXY(odim, n, i)] = e;
+      out[i] = e;
     }
 
     // Normalize the output.
-    for (size_t i = 0; i < idim[1]; i++) {
-      outW[libjit_getXY(odim, n, i)] = outW[libjit_getXY(odim, n, i)] / sum;
+    float recip = 1.0f / sum;
+    for (i = 0; i + 8 <= len; i += 8) {
+      StoreuFloat8(&out[i], LoaduFloat8(&out[i]) * recip);
+    }
+    for (; i < len; i++) {
+      out[i] = out[i] * recip;
     }
   } // N
 }
@@ -1175,6 +1801,16 @@ void libjit_topk_i8(int8_t *values, size_t *indices, const int8_t *input,
   libjit_topk(values, indices, input, scratch, k, n, size);
 }
 
+void libjit_topk32_f(float *values, int32_t *indices, const float *input,
+                     size_t *scratch, size_t k, size_t n, size_t size) {
+  libjit_topk(values, indices, input, scratch, k, n, size);
+}
+
+void libjit_topk32_i8(int8_t *values, int32_t *indices, const int8_t *input,
+                      size_t *scratch, size_t k, size_t n, size_t size) {
+  libjit_topk(values, indices, input, scratch, k, n, size);
+}
+
 void libjit_transpose_i8(const int8_t *inW, int8_t *outW, const size_t *idim,
                          const size_t *odim, const size_t *shuffle,
                          size_t numDims) {
@@ -1193,6 +1829,21 @@ void libjit_transpose_u(const size_t *inW, size_t *outW, const size_t *idim,
   libjit_transpose_generic(inW, outW, idim, odim, shuffle, numDims);
 }
 
+void libjit_broadcast_i8(int8_t *outW, const int8_t *inW, const size_t *odim,
+                         const size_t *idim, size_t numDims) {
+  libjit_broadcast_generic(outW, inW, odim, idim, numDims);
+}
+
+void libjit_broadcast_f(float *outW, const float *inW, const size_t *odim,
+                        const size_t *idim, size_t numDims) {
+  libjit_broadcast_generic(outW, inW, odim, idim, numDims);
+}
+
+void libjit_broadcast_u(size_t *outW, const size_t *inW, const size_t *odim,
+                        const size_t *idim, size_t numDims) {
+  libjit_broadcast_generic(outW, inW, odim, idim, numDims);
+}
+
 void libjit_insert_tensor_f(float *tensor, float *slice, size_t *offset,
                             size_t *tensorDim, size_t *sliceDim,
                             size_t numDimsTensor, size_t numDimsSlice,
@@ -1241,6 +1892,44 @@ void libjit_insert_tensor_i8(int8_t *tensor, int8_t *slice, size_t *offset,
                        numDimsTensor, numDimsSlice, offsetDim, count, axis);
 }
 
+/// The detected CPU feature level. -1 means that detection did not run yet.
+/// This is a file-scope variable with a constant initializer, because the
+/// standard library must not require guard variables for local statics.
+static int cpuFeatureLevel = -1;
+
+/// \returns the ISA feature level of the executing CPU: 0 for the baseline
+/// ISA that the module was compiled for, and 1 when AVX2 and FMA are
+/// supported and enabled by the OS. The result is cached, so only the first
+/// call pays for the CPUID instructions. The compiler emits one clone of the
+/// entry function per level and dispatches on this value, so that a single
+/// compiled artifact runs at full speed on newer CPUs.
+int libjit_cpu_feature_level() {
+  int level = cpuFeatureLevel;
+  if (level >= 0) {
+    return level;
+  }
+  level = 0;
+#if defined(__x86_64__) || defined(__i386__)
+  unsigned eax, ebx, ecx, edx;
+  // Leaf 1: check for OSXSAVE and AVX support.
+  if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_OSXSAVE) &&
+      (ecx & bit_AVX) && (ecx & bit_FMA)) {
+    // Check that the OS saves and restores the YMM registers.
+    unsigned xcrLow, xcrHigh;
+    __asm__("xgetbv" : "=a"(xcrLow), "=d"(xcrHigh) : "c"(0));
+    if ((xcrLow & 0x6) == 0x6) {
+      // Leaf 7: check for AVX2 support.
+      __cpuid_count(7, 0, eax, ebx, ecx, edx);
+      if (ebx & bit_AVX2) {
+        level = 1;
+      }
+    }
+  }
+#endif
+  cpuFeatureLevel = level;
+  return level;
+}
+
 __attribute__((noinline)) void
 libjit_dump_tensor(uint8_t *tensor, size_t *tensorDim, size_t numDimsTensor,
                    size_t elemKind, const char *name) {
@@ -1248,9 +1937,12 @@ libjit_dump_tensor(uint8_t *tensor, size_t *tensorDim, size_t numDimsTensor,
   /// This definition should match the defintion in Glow.
   enum ElemKind {
     FloatTy,
+    Float16Ty,
     Int8QTy,
+    Int16QTy,
     Int32QTy,
     IndexTy,
+    Int32ITy,
   };
   // Dump the content of a tensor.
   switch (elemKind) {
@@ -1260,6 +1952,9 @@ libjit_dump_tensor(uint8_t *tensor, size_t *tensorDim, size_t numDimsTensor,
   case IndexTy:
     libjit_dump_tensor_impl((size_t *)tensor, tensorDim, numDimsTensor);
     break;
+  case Int32ITy:
+    libjit_dump_tensor_impl((int32_t *)tensor, tensorDim, numDimsTensor);
+    break;
   default:
     printf("Dumping this type of payload is not supported: %zu\n", elemKind);
     break;
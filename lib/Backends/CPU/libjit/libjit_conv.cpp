@@ -20,22 +20,24 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <pthread.h>
 #include <sys/types.h>
 
 #include "libjit_defs.h"
 
 namespace {
 // Initialize the convolution output frame for slice \p N with the bias \p
-// biasW.
+// biasW, for the output channels in the range [\p dBegin .. \p dEnd).
 void libjit_conv_init_output_with_bias(size_t N, float *outW,
                                        const float *biasW,
                                        const size_t *outWdims,
-                                       const size_t *biasWdims) {
+                                       const size_t *biasWdims, size_t dBegin,
+                                       size_t dEnd) {
   // For each (x,y) step in the output tensor:
   for (size_t ax = 0; ax < outWdims[1]; ax++) {
     for (size_t ay = 0; ay < outWdims[2]; ay++) {
       // For each output channel:
-      for (size_t d = 0; d < outWdims[3]; d++) {
+      for (size_t d = dBegin; d < dEnd; d++) {
         // Store the results to the output buffer.
         float bias = biasW[d];
         auto outIdx = libjit_getXYZW(outWdims, N, ax, ay, d);
@@ -45,6 +47,26 @@ void libjit_conv_init_output_with_bias(size_t N, float *outW,
   }     // For each X in the output.
 }
 
+/// Computes the half-open range [\p begin .. \p end) of output coordinates
+/// whose corresponding input coordinate (out * \p stride - \p pad + \p f)
+/// falls inside [0 .. \p inSize), so that loops over the range need no
+/// boundary checks. When the convolution is specialized for a constant
+/// (filter, stride, pad) shape the ranges become compile-time constants and
+/// the checks disappear entirely from the generated code.
+inline void libjit_conv_valid_range(size_t outSize, size_t inSize,
+                                    size_t stride, size_t pad, size_t f,
+                                    size_t *begin, size_t *end) {
+  if (f >= inSize + pad) {
+    *begin = *end = 0;
+    return;
+  }
+  *begin = (pad > f) ? (pad - f + stride - 1) / stride : 0;
+  *end = MIN((inSize + pad - f + stride - 1) / stride, outSize);
+  if (*begin > *end) {
+    *begin = *end;
+  }
+}
+
 /// Perform the heart of the convolution. Load \p ywidth scalars in a specific
 /// channel, broadcast them, and multiply them with
 /// [ywidth * float8 * numDepthRegs] depth values and accumulate them to create
@@ -243,6 +265,239 @@ void libjit_convDKKC8_foreach_xy_pixels_filter(
   }       // For each X in the output.
 }
 
+/// Perform the convolution of \p libjit_convolution_f for the batch sample
+/// \p n and the output channels [\p dBegin .. \p dEnd) of the group \p g,
+/// including the initialization of those channels with the bias. When
+/// \p doRelu is set a relu is applied as part of the final accumulating
+/// store. The range never crosses a group boundary, so disjoint ranges touch
+/// disjoint slices of the output and can run on different threads.
+void libjit_convolution_f_slice(float *outW, const float *inW,
+                                const float *filterW, const float *biasW,
+                                const size_t *outWdims, const size_t *inWdims,
+                                const size_t *filterWdims,
+                                const size_t *biasWdims, size_t filterSize,
+                                size_t stride, size_t *pads, size_t group,
+                                unsigned depthUnroll, unsigned doRelu, size_t n,
+                                size_t g, size_t dBegin, size_t dEnd) {
+  size_t inCperG = inWdims[3] / group;
+
+  // The output dims are calculated already from all of the pads,
+  // therefore we only need the top and left pads here to control the starting
+  // position.
+  size_t pad_t = pads[0];
+  size_t pad_l = pads[1];
+  // The size of the input-channel tile. High channel count allow for SIMD
+  // parallelism but create register pressure. Low channel count reduces the
+  // memory pressure and allows things to fit in cache, but require additional
+  // compute (horizontal add) to sum the values in the block. This value is a
+  // compromise between the two.
+  constexpr unsigned cbSize = 512;
+
+  // Initialize the output channels of the N'th slice with the bias.
+  // Later we will accumulate values into this slice.
+  libjit_conv_init_output_with_bias(n, outW, biasW, outWdims, biasWdims,
+                                    dBegin, dEnd);
+
+  // Process the body of the loop in tiles of "channel-block".
+  for (size_t cb = 0; cb < inCperG; cb += cbSize) {
+    // The output is only final once the last channel block has been
+    // accumulated; an optional relu folds into that block's store, which
+    // reads the output anyway.
+    unsigned applyRelu = doRelu && cb + cbSize >= inCperG;
+
+    // For each output channel in the range. Process 'depthUnroll' output
+    // layers together.
+    for (size_t d = dBegin; d < dEnd; d += depthUnroll) {
+
+      // For each element in the convolution-filter:
+      for (size_t fx = 0; fx < filterSize; fx++) {
+        for (size_t fy = 0; fy < filterSize; fy++) {
+
+          // Compute the range of output coordinates for which the input
+          // coordinate is in bounds, so that the loops below need no
+          // boundary checks.
+          size_t axBegin, axEnd, ayBegin, ayEnd;
+          libjit_conv_valid_range(outWdims[1], inWdims[1], stride, pad_t, fx,
+                                  &axBegin, &axEnd);
+          libjit_conv_valid_range(outWdims[2], inWdims[2], stride, pad_l, fy,
+                                  &ayBegin, &ayEnd);
+
+          // For each convolution 'jump' in the input tensor:
+          for (size_t outx = axBegin; outx < axEnd; outx++) {
+            size_t inx = outx * stride - pad_t + fx;
+            for (size_t outy = ayBegin; outy < ayEnd; outy++) {
+              size_t iny = outy * stride - pad_l + fy;
+
+              // Process 'depthUnroll' output pixels at once. Each scalar
+              // here represents the convolution sum for one (x,y) point in
+              // the output. We process the same pixel for different output
+              // channel (D) values. The compiler should perform scalar
+              // replacement of aggregates and split this tiny array to
+              // registers.
+              float sum[depthUnroll];
+              for (unsigned i = 0; i < depthUnroll; i++) {
+                sum[i] = 0;
+              }
+
+              // Calculate the indices into the Filter and Input buffers.
+              size_t inIdx =
+                  libjit_getXYZW(inWdims, n, inx, iny, g * inCperG);
+              size_t filterIdx = libjit_getXYZW(filterWdims, d, fx, fy, 0);
+              size_t sliceSize =
+                  filterWdims[1] * filterWdims[2] * filterWdims[3];
+
+              // Perform the heart of the convolution, 4 elements at a time
+              // to reduce register pressure.
+              for (size_t fd = cb, e = MIN(cb + cbSize, inCperG); fd < e;
+                   fd++) {
+                float in = inW[inIdx + fd];
+                for (unsigned i = 0; i < MIN(4, depthUnroll); i++) {
+                  sum[i] += filterW[filterIdx + (sliceSize * i) + fd] * in;
+                }
+              }
+
+              // And run the innermost loop again for the second group of
+              // depth slices:
+              if (depthUnroll > 4) {
+                for (size_t fd = cb, e = MIN(cb + cbSize, inCperG); fd < e;
+                     fd++) {
+                  float in = inW[inIdx + fd];
+                  for (unsigned i = 4; i < MIN(8, depthUnroll); i++) {
+                    sum[i] += filterW[filterIdx + (sliceSize * i) + fd] * in;
+                  }
+                }
+              }
+
+              // Store the results to the output buffer.
+              if (applyRelu) {
+                for (unsigned i = 0; i < depthUnroll; i++) {
+                  size_t outIdx =
+                      libjit_getXYZW(outWdims, n, outx, outy, d + i);
+                  float v = outW[outIdx] + sum[i];
+                  outW[outIdx] = MAX(v, 0);
+                }
+              } else {
+                for (unsigned i = 0; i < depthUnroll; i++) {
+                  outW[libjit_getXYZW(outWdims, n, outx, outy, d + i)] +=
+                      sum[i];
+                }
+              }
+            }
+          }
+        } // For each Y in the filter.
+      }   // For each X in the filter.
+    }     // For each D (the depth, or the output channel).
+  }       // For each block in the input channel.
+}
+
+/// The arguments of a libjit_convolution_f call, plus the identity of one of
+/// the threads that shard its work.
+struct libjit_conv_task {
+  float *outW;
+  const float *inW;
+  const float *filterW;
+  const float *biasW;
+  const size_t *outWdims;
+  const size_t *inWdims;
+  const size_t *filterWdims;
+  const size_t *biasWdims;
+  size_t filterSize;
+  size_t stride;
+  size_t *pads;
+  size_t group;
+  unsigned depthUnroll;
+  unsigned doRelu;
+  unsigned threadId;
+  unsigned nthreads;
+};
+
+/// Perform this thread's share of a sharded convolution. The work is split
+/// into (sample, depth-chunk) items, where a chunk is the existing
+/// 'depthUnroll' blocking of the output channels, and the items are dealt
+/// round-robin to the threads.
+void *libjit_convolution_f_worker(void *arg) {
+  auto *T = (libjit_conv_task *)arg;
+  size_t outCperG = T->outWdims[3] / T->group;
+  size_t chunksPerGroup = (outCperG + T->depthUnroll - 1) / T->depthUnroll;
+  size_t itemsPerSample = T->group * chunksPerGroup;
+  size_t numItems = T->inWdims[0] * itemsPerSample;
+
+  for (size_t w = T->threadId; w < numItems; w += T->nthreads) {
+    size_t n = w / itemsPerSample;
+    size_t g = (w % itemsPerSample) / chunksPerGroup;
+    size_t chunk = (w % itemsPerSample) % chunksPerGroup;
+    size_t dBegin = g * outCperG + chunk * T->depthUnroll;
+    size_t dEnd = MIN(dBegin + T->depthUnroll, (g + 1) * outCperG);
+    libjit_convolution_f_slice(T->outW, T->inW, T->filterW, T->biasW,
+                               T->outWdims, T->inWdims, T->filterWdims,
+                               T->biasWdims, T->filterSize, T->stride, T->pads,
+                               T->group, T->depthUnroll, T->doRelu, n, g,
+                               dBegin, dEnd);
+  }
+  return nullptr;
+}
+
+/// Compute the convolution output row \p cx of the sample \p n into \p
+/// rowBuf, which holds one row of the activation in [W, C] layout. The inner
+/// product is vectorized over the input channels, which are contiguous both
+/// in the NHWC input and in the DKKC filter. An optional relu is applied on
+/// the way out, so the activation never has to be revisited.
+void libjit_conv_pool_conv_row(float *rowBuf, const float *inW,
+                               const float *filterW, const float *biasW,
+                               const size_t *inWdims, const size_t *filterWdims,
+                               const size_t *convWdims, size_t filterSize,
+                               size_t stride, size_t pad_t, size_t pad_l,
+                               size_t group, unsigned doRelu, size_t n,
+                               size_t cx) {
+  size_t convW = convWdims[2];
+  size_t depth = convWdims[3];
+  size_t inCperG = inWdims[3] / group;
+  size_t outCperG = depth / group;
+
+  for (size_t g = 0; g < group; g++) {
+    for (size_t d = g * outCperG; d < (g + 1) * outCperG; d++) {
+      for (size_t ay = 0; ay < convW; ay++) {
+        float sum = biasW[d];
+        float8 sum8 = SplatFloat8(0.0f);
+
+        // For each element in the convolution-filter:
+        for (size_t fx = 0; fx < filterSize; fx++) {
+          ssize_t inx = (ssize_t)(cx * stride + fx) - (ssize_t)pad_t;
+          if (inx < 0 || inx >= (ssize_t)inWdims[1]) {
+            continue;
+          }
+          for (size_t fy = 0; fy < filterSize; fy++) {
+            ssize_t iny = (ssize_t)(ay * stride + fy) - (ssize_t)pad_l;
+            if (iny < 0 || iny >= (ssize_t)inWdims[2]) {
+              continue;
+            }
+
+            const float *in = &inW[libjit_getXYZW(
+                inWdims, n, (size_t)inx, (size_t)iny, g * inCperG)];
+            const float *flt =
+                &filterW[libjit_getXYZW(filterWdims, d, fx, fy, 0)];
+            size_t fd = 0;
+            for (; fd + 8 <= inCperG; fd += 8) {
+              sum8 += LoaduFloat8(in + fd) * LoaduFloat8(flt + fd);
+            }
+            for (; fd < inCperG; fd++) {
+              sum += in[fd] * flt[fd];
+            }
+          }
+        }
+
+        for (unsigned i = 0; i < 8; i++) {
+          sum += sum8[i];
+        }
+        if (doRelu && sum < 0) {
+          sum = 0;
+        }
+        rowBuf[ay * depth + d] = sum;
+      }
+    }
+  }
+}
+
 } // namespace
 
 extern "C" {
@@ -268,7 +523,8 @@ void libjit_convDKKC8_f(float *outW, const float *inW, const float *filterW,
 
     // Initialize the output frame for the N'th slice with the bias.
     // Later we will accumulate values into this slice.
-    libjit_conv_init_output_with_bias(n, outW, biasW, outWdims, biasWdims);
+    libjit_conv_init_output_with_bias(n, outW, biasW, outWdims, biasWdims, 0,
+                                      outWdims[3]);
 
     // For each group of input channels:
     for (size_t g = 0; g < group; g++) {
@@ -294,123 +550,161 @@ void libjit_convolution_f(float *outW, const float *inW, const float *filterW,
                           const size_t *inWdims, const size_t *filterWdims,
                           const size_t *biasWdims, size_t filterSize,
                           size_t stride, size_t *pads, size_t group,
-                          unsigned depthUnroll) {
-  size_t inChannels = inWdims[3];
-  size_t outChannels = outWdims[3];
-  size_t inCperG = inChannels / group;
-  size_t outCperG = outChannels / group;
-
-  // The output dims are calculated already from all of the pads,
-  // therefore we only need the top and left pads here to control the starting
-  // position.
-  size_t pad_t = pads[0];
-  size_t pad_l = pads[1];
-  // The size of the input-channel tile. High channel count allow for SIMD
-  // parallelism but create register pressure. Low channel count reduces the
-  // memory pressure and allows things to fit in cache, but require additional
-  // compute (horizontal add) to sum the values in the block. This value is a
-  // compromise between the two.
-  constexpr unsigned cbSize = 512;
-
-  // For each input in the batch:
-  for (size_t n = 0; n < inWdims[0]; n++) {
-
-    // Initialize the output frame for the N'th slice with the bias.
-    // Later we will accumulate values into this slice.
-    libjit_conv_init_output_with_bias(n, outW, biasW, outWdims, biasWdims);
+                          unsigned depthUnroll, unsigned doRelu,
+                          unsigned nthreads) {
+  libjit_conv_task task = {outW,  inW,  filterW, biasW,       outWdims,
+                           inWdims, filterWdims, biasWdims,   filterSize,
+                           stride, pads, group,  depthUnroll, doRelu, 0, 1};
+
+  if (nthreads <= 1) {
+    libjit_convolution_f_worker(&task);
+    return;
+  }
 
-    // For each group of input channels:
-    for (size_t g = 0; g < group; g++) {
-      // Process the body of the loop in tiles of "channel-block".
-      for (size_t cb = 0; cb < inCperG; cb += cbSize) {
-
-        // For each output channel in the group. Process 'depthUnroll' output
-        // layers together.
-        for (size_t d = g * outCperG; d < (g + 1) * outCperG;
-             d += depthUnroll) {
-
-          // For each element in the convolution-filter:
-          for (size_t fx = 0; fx < filterSize; fx++) {
-            for (size_t fy = 0; fy < filterSize; fy++) {
-
-              // For each convolution 'jump' in the input tensor:
-              for (size_t outx = 0; outx < outWdims[1]; outx++) {
-                for (size_t outy = 0; outy < outWdims[2]; outy++) {
-
-                  // Process 'depthUnroll' output pixels at once. Each scalar
-                  // here represents the convolution sum for one (x,y) point in
-                  // the output. We process the same pixel for different output
-                  // channel (D) values. The compiler should perform scalar
-                  // replacement of aggregates and split this tiny array to
-                  // registers.
-                  float sum[depthUnroll];
-                  for (unsigned i = 0; i < depthUnroll; i++) {
-                    sum[i] = 0;
-                  }
+  // Shard the work over the threads. Every thread, including this one,
+  // processes its share of the (sample, depth-chunk) work items; the chunks
+  // write disjoint channel ranges of the output, so no synchronization is
+  // needed beyond the final join.
+  libjit_conv_task tasks[nthreads];
+  pthread_t threads[nthreads];
+  for (unsigned t = 0; t < nthreads; t++) {
+    tasks[t] = task;
+    tasks[t].threadId = t;
+    tasks[t].nthreads = nthreads;
+  }
+  unsigned spawned = 0;
+  for (unsigned t = 1; t < nthreads; t++) {
+    if (pthread_create(&threads[t], nullptr, libjit_convolution_f_worker,
+                       &tasks[t])) {
+      // Could not spawn the thread; fold its share into this thread by
+      // running its task inline below.
+      break;
+    }
+    spawned = t;
+  }
+  // Run this thread's share, plus the shares of any threads that could not
+  // be spawned.
+  for (unsigned t = 0; t < nthreads; t++) {
+    if (t == 0 || t > spawned) {
+      libjit_convolution_f_worker(&tasks[t]);
+    }
+  }
+  for (unsigned t = 1; t <= spawned; t++) {
+    pthread_join(threads[t], nullptr);
+  }
+}
 
-                  // Calculate the specific input x,y that we process in this
-                  // iteration.
-                  ssize_t inx = (ssize_t)outx * stride - pad_t + fx;
-                  ssize_t iny = (ssize_t)outy * stride - pad_l + fy;
+/// Fused convolution, optional relu and max-pool. \p convWdims is the NHWC
+/// shape of the convolution activation, which never exists in memory as a
+/// whole tensor: the kernel materializes it into a ring buffer of the last
+/// \p poolKernel rows and pools each row strip while it is still cache
+/// resident. Row r lives in ring slot (r % poolKernel) and is overwritten
+/// poolKernel rows later, by which time no pooling window reads it anymore.
+/// Compared to running the convolution and the pool as separate kernels this
+/// removes a full write and read of the activation, which dominates the
+/// memory traffic of high-resolution layers.
+void libjit_conv_pool_max_f(float *outW, const float *inW, const float *filterW,
+                            const float *biasW, const size_t *outWdims,
+                            const size_t *inWdims, const size_t *filterWdims,
+                            const size_t *biasWdims, const size_t *convWdims,
+                            size_t convKernel, size_t convStride,
+                            size_t *convPads, size_t group, unsigned doRelu,
+                            size_t poolKernel, size_t poolStride,
+                            size_t *poolPads) {
+  (void)biasWdims;
+  size_t convH = convWdims[1];
+  size_t convW = convWdims[2];
+  size_t depth = convWdims[3];
+  size_t rowSize = convW * depth;
+  size_t conv_pad_t = convPads[0];
+  size_t conv_pad_l = convPads[1];
+  size_t pool_pad_t = poolPads[0];
+  size_t pool_pad_l = poolPads[1];
+
+  // The ring of convolution rows. The compiler picked the fusion only for
+  // shapes where this fits in the cache.
+  float convRows[poolKernel * rowSize];
 
-                  // Ignore index access below zero (this is due to padding).
-                  if (inx < 0 || iny < 0 || inx >= (ssize_t)inWdims[1] ||
-                      iny >= (ssize_t)inWdims[2]) {
-                    continue;
-                  }
+  // For each input in the batch:
+  for (size_t n = 0; n < outWdims[0]; n++) {
+    // The next convolution row that has not been materialized yet.
+    size_t nextRow = 0;
+
+    // For each (x,y) step in the pool output tensor:
+    ssize_t x = -(ssize_t)pool_pad_t;
+    for (size_t ax = 0; ax < outWdims[1]; x += poolStride, ax++) {
+      // Materialize the convolution rows this row of pooling windows reads.
+      // Consecutive window rows overlap by (poolKernel - poolStride) rows,
+      // which are reused from the ring instead of being recomputed.
+      size_t winBegin = (size_t)MAX(x, 0);
+      size_t winEnd = MIN((size_t)MAX(x + (ssize_t)poolKernel, 0), convH);
+      for (size_t cx = MAX(nextRow, winBegin); cx < winEnd; cx++) {
+        libjit_conv_pool_conv_row(&convRows[(cx % poolKernel) * rowSize], inW,
+                                  filterW, biasW, inWdims, filterWdims,
+                                  convWdims, convKernel, convStride, conv_pad_t,
+                                  conv_pad_l, group, doRelu, n, cx);
+      }
+      if (winEnd > nextRow) {
+        nextRow = winEnd;
+      }
 
-                  // Calculate the indices into the Filter and Input buffers.
-                  size_t inIdx = libjit_getXYZW(inWdims, n, (size_t)inx,
-                                                (size_t)iny, g * inCperG);
-                  size_t filterIdx = libjit_getXYZW(filterWdims, d, fx, fy, 0);
-                  size_t sliceSize =
-                      filterWdims[1] * filterWdims[2] * filterWdims[3];
-
-                  // Perform the heart of the convolution, 4 elements at a time
-                  // to reduce register pressure.
-                  for (size_t fd = cb, e = MIN(cb + cbSize, inCperG); fd < e;
-                       fd++) {
-                    float in = inW[inIdx + fd];
-                    for (unsigned i = 0; i < MIN(4, depthUnroll); i++) {
-                      sum[i] += filterW[filterIdx + (sliceSize * i) + fd] * in;
-                    }
-                  }
+      ssize_t y = -(ssize_t)pool_pad_l;
+      for (size_t ay = 0; ay < outWdims[2]; y += poolStride, ay++) {
+        float *out = &outW[libjit_getXYZW(outWdims, n, ax, ay, 0)];
+        int first = 1;
 
-                  // And run the innermost loop again for the second group of
-                  // depth slices:
-                  if (depthUnroll > 4) {
-                    for (size_t fd = cb, e = MIN(cb + cbSize, inCperG); fd < e;
-                         fd++) {
-                      float in = inW[inIdx + fd];
-                      for (unsigned i = 4; i < MIN(8, depthUnroll); i++) {
-                        sum[i] +=
-                            filterW[filterIdx + (sliceSize * i) + fd] * in;
-                      }
-                    }
-                  }
+        // For each element in the pool filter:
+        for (size_t fx = 0; fx < poolKernel; fx++) {
+          ssize_t ox = x + fx;
+          if (ox < 0 || ox >= (ssize_t)convH) {
+            continue;
+          }
+          const float *row = &convRows[((size_t)ox % poolKernel) * rowSize];
+          for (size_t fy = 0; fy < poolKernel; fy++) {
+            ssize_t oy = y + fy;
+            if (oy < 0 || oy >= (ssize_t)convW) {
+              continue;
+            }
 
-                  // Store the results to the output buffer.
-                  for (unsigned i = 0; i < depthUnroll; i++) {
-                    outW[libjit_getXYZW(outWdims, n, outx, outy, d + i)] +=
-                        sum[i];
-                  }
-                }
+            const float *in = &row[(size_t)oy * depth];
+            size_t z = 0;
+            if (first) {
+              // The first valid filter element initializes the output row.
+              first = 0;
+              for (; z + 8 <= depth; z += 8) {
+                StoreuFloat8(out + z, LoaduFloat8(in + z));
+              }
+              for (; z < depth; z++) {
+                out[z] = in[z];
+              }
+            } else {
+              for (; z + 8 <= depth; z += 8) {
+                StoreuFloat8(out + z, MaxFloat8(LoaduFloat8(out + z),
+                                                LoaduFloat8(in + z)));
+              }
+              for (; z < depth; z++) {
+                out[z] = MAX(out[z], in[z]);
               }
-            } // For each Y in the filter.
-          }   // For each X in the filter.
-        }     // For each D (the depth, or the output channel).
-      }       // For each block in the input channel.
-    }         // For each group in the input channel.
-  }           // For each N, the sample in the batch.
+            }
+          }
+        }
+      } // For each Y in the pool output.
+    }   // For each X in the pool output.
+  }     // For each N, the sample in the batch.
 }
 
+// The filter offset and the bias/output scaling parameters are arrays with
+// one entry per output channel. A per-tensor quantized filter passes the
+// same value in every entry; a channelwise-quantized filter passes the
+// parameters derived from each channel's own scale.
 void libjit_convolution_i8(
     int8_t *outW, const int8_t *inW, const int8_t *filterW, const int8_t *biasW,
     const size_t *outWdims, const size_t *inWdims, const size_t *filterWdims,
     const size_t *biasWdims, size_t filterSize, size_t stride, size_t *pads,
-    size_t group, int32_t outOffset, int32_t inOffset, int32_t filterOffset,
-    int32_t biasOffset, int32_t biasPre, int32_t biasPost, int32_t biasScale,
-    int32_t outPre, int32_t outPost, int32_t outScale, unsigned depthUnroll) {
+    size_t group, int32_t outOffset, int32_t inOffset,
+    const int32_t *filterOffset, int32_t biasOffset, const int32_t *biasPre,
+    const int32_t *biasPost, const int32_t *biasScale, const int32_t *outPre,
+    const int32_t *outPost, const int32_t *outScale, unsigned depthUnroll) {
   size_t inChannels = inWdims[3];
   size_t outChannels = outWdims[3];
   size_t inCperG = inChannels / group;
@@ -432,11 +726,15 @@ void libjit_convolution_i8(
           ssize_t y = -(ssize_t)pad_l;
           for (size_t ay = 0; ay < outWdims[2]; y += stride, ay++) {
             int32_t sum[depthUnroll];
+            int32x8 sumV[depthUnroll];
 
             for (unsigned i = 0; i < depthUnroll; i++) {
               // Scale the bias to match the scale of the matrix multiplication.
-              sum[i] = libjit_scale_i32i8((int32_t)biasW[d + i] - biasOffset,
-                                          biasPre, biasPost, biasScale, 0);
+              sum[i] =
+                  libjit_scale_i32i8((int32_t)biasW[d + i] - biasOffset,
+                                     biasPre[d + i], biasPost[d + i],
+                                     biasScale[d + i], 0);
+              sumV[i] = 0;
             }
 
             // For each element in the convolution-filter:
@@ -458,34 +756,41 @@ void libjit_convolution_i8(
                 size_t sliceSize =
                     filterWdims[1] * filterWdims[2] * filterWdims[3];
 
-                // Perform the innermost loop of the convolution using 4 vector
-                // registers.
-                for (size_t fd = 0; fd < inCperG; fd++) {
+                // Perform the innermost loop of the convolution on vector
+                // registers with eight 32-bit lanes. The int8 inputs and
+                // filters are widened on load; the subtraction of the offsets
+                // and the multiply-accumulate happen in 32 bits, so no
+                // intermediate result can overflow.
+                size_t fd = 0;
+                for (; fd + 8 <= inCperG; fd += 8) {
+                  int32x8 in = LoaduInt8x8ToInt32x8(&inW[inIdx + fd]) - inOffset;
+                  for (unsigned i = 0; i < depthUnroll; i++) {
+                    int32x8 flt = LoaduInt8x8ToInt32x8(
+                                      &filterW[filterIdx + (sliceSize * i) +
+                                               fd]) -
+                                  filterOffset[d + i];
+                    sumV[i] += flt * in;
+                  }
+                }
+
+                // Handle the remaining channels with scalar arithmetic.
+                for (; fd < inCperG; fd++) {
                   int32_t in = inW[inIdx + fd] - inOffset;
-                  for (unsigned i = 0; i < MIN(4, depthUnroll); i++) {
+                  for (unsigned i = 0; i < depthUnroll; i++) {
                     sum[i] += (filterW[filterIdx + (sliceSize * i) + fd] -
-                               filterOffset) *
+                               filterOffset[d + i]) *
                               in;
                   }
                 }
-
-                // And perform the innermost loop again with 4 more registers.
-                if (depthUnroll > 4)
-                  for (size_t fd = 0; fd < inCperG; fd++) {
-                    int32_t in = inW[inIdx + fd] - inOffset;
-                    for (unsigned i = 4; i < MIN(8, depthUnroll); i++) {
-                      sum[i] += (filterW[filterIdx + (sliceSize * i) + fd] -
-                                 filterOffset) *
-                                in;
-                    }
-                  }
               }
             }
 
             for (unsigned i = 0; i < depthUnroll; i++) {
-              // Scale the result back to the expected destination scale.
-              int32_t scaledSum = libjit_scale_i32i8(sum[i], outPre, outPost,
-                                                     outScale, outOffset);
+              // Fold the vector lanes into the scalar accumulator and scale
+              // the result back to the expected destination scale.
+              int32_t scaledSum = libjit_scale_i32i8(
+                  sum[i] + SumInt32x8(sumV[i]), outPre[d + i], outPost[d + i],
+                  outScale[d + i], outOffset);
               outW[libjit_getXYZW(outWdims, n, ax, ay, d + i)] =
                   libjit_clip(scaledSum);
             }
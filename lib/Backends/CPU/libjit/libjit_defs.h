@@ -21,6 +21,8 @@
 
 typedef float float4 __attribute__((ext_vector_type(4)));
 typedef float float8 __attribute__((ext_vector_type(8)));
+typedef int8_t int8x8 __attribute__((ext_vector_type(8)));
+typedef int32_t int32x8 __attribute__((ext_vector_type(8)));
 
 /// Loads a simd float8 value from \p ptr.
 #define LoadFloat8(PTR) *((const float8 *)(PTR))
@@ -54,6 +56,163 @@ inline void AdduFloat8(float *p, float8 v) {
   StoreuFloat8(p, LoaduFloat8(p) + v);
 }
 
+/// Perform an unaligned load of eight int8 values, widened to int32 lanes.
+inline int32x8 LoaduInt8x8ToInt32x8(const int8_t *p) {
+  int8x8 res;
+  memcpy(&res, p, sizeof(int8x8));
+  return __builtin_convertvector(res, int32x8);
+}
+
+/// \returns the sum of the lanes of \p v.
+inline int32_t SumInt32x8(int32x8 v) {
+  return v[0] + v[1] + v[2] + v[3] + v[4] + v[5] + v[6] + v[7];
+}
+
+/// Perform an unaligned store of eight int8 values.
+inline void StoreuInt8x8(int8_t *p, int8x8 v) { memcpy(p, &v, sizeof(int8x8)); }
+
+/// \returns an int32x8 with every lane set to \p v.
+inline int32x8 SplatInt32x8(int32_t v) {
+  int32x8 res = {v, v, v, v, v, v, v, v};
+  return res;
+}
+
+/// \returns a vector with the lanes of \p a where \p mask is set, and the
+/// lanes of \p b elsewhere. \p mask is the all-ones/all-zeros lane mask that
+/// vector comparisons produce.
+inline int32x8 SelectInt32x8(int32x8 mask, int32x8 a, int32x8 b) {
+  return (a & mask) | (b & ~mask);
+}
+
+/// \returns the lane-wise minimum of \p a and \p b.
+inline int32x8 MinInt32x8(int32x8 a, int32x8 b) {
+  return SelectInt32x8(a < b, a, b);
+}
+
+/// \returns the lane-wise maximum of \p a and \p b.
+inline int32x8 MaxInt32x8(int32x8 a, int32x8 b) {
+  return SelectInt32x8(a > b, a, b);
+}
+
+/// \returns the lanes of \p v clamped to the int8 range and narrowed.
+inline int8x8 ClipInt32x8ToInt8x8(int32x8 v) {
+  v = MaxInt32x8(v, SplatInt32x8(-128));
+  v = MinInt32x8(v, SplatInt32x8(127));
+  return __builtin_convertvector(v, int8x8);
+}
+
+/// \returns the bits of \p v reinterpreted as an int32x8.
+inline int32x8 Float8AsInt32x8(float8 v) {
+  int32x8 res;
+  memcpy(&res, &v, sizeof(res));
+  return res;
+}
+
+/// \returns the bits of \p v reinterpreted as a float8.
+inline float8 Int32x8AsFloat8(int32x8 v) {
+  float8 res;
+  memcpy(&res, &v, sizeof(res));
+  return res;
+}
+
+/// \returns a float8 with every lane set to \p v.
+inline float8 SplatFloat8(float v) {
+  float8 res = {v, v, v, v, v, v, v, v};
+  return res;
+}
+
+/// \returns a vector with the lanes of \p a where \p mask is set, and the
+/// lanes of \p b elsewhere. \p mask is the all-ones/all-zeros lane mask that
+/// vector comparisons produce.
+inline float8 SelectFloat8(int32x8 mask, float8 a, float8 b) {
+  return Int32x8AsFloat8((Float8AsInt32x8(a) & mask) |
+                         (Float8AsInt32x8(b) & ~mask));
+}
+
+/// \returns the lane-wise minimum of \p a and \p b.
+inline float8 MinFloat8(float8 a, float8 b) {
+  return SelectFloat8(a < b, a, b);
+}
+
+/// \returns the lane-wise maximum of \p a and \p b.
+inline float8 MaxFloat8(float8 a, float8 b) {
+  return SelectFloat8(a > b, a, b);
+}
+
+/// \returns every lane of \p v rounded to the nearest 32-bit integer. Ties
+/// round away from zero, unlike the round-to-even of nearbyintf(); the two
+/// only differ on values that fall exactly halfway between two integers.
+inline int32x8 RoundFloat8ToInt32x8(float8 v) {
+  float8 half = SelectFloat8(v < 0.0f, SplatFloat8(-0.5f), SplatFloat8(0.5f));
+  return __builtin_convertvector(v + half, int32x8);
+}
+
+/// \returns the lane-wise single-precision exponential of \p x, computed
+/// with the Cephes polynomial approximation. The result is accurate to
+/// about one ulp; inputs are clamped to the range where the result is a
+/// normal float.
+inline float8 ExpFloat8(float8 x) {
+  x = MinFloat8(x, SplatFloat8(88.3762626647949f));
+  x = MaxFloat8(x, SplatFloat8(-87.3365478515625f));
+
+  // Decompose exp(x) into 2^n * exp(r), where n = round(x * log2(e)) and
+  // |r| <= 0.5 * ln(2).
+  float8 fx = x * 1.44269504088896341f + 0.5f;
+  float8 nf = __builtin_convertvector(__builtin_convertvector(fx, int32x8),
+                                      float8);
+  // Truncation rounds towards zero; correct it to round down.
+  nf = SelectFloat8(nf > fx, nf - 1.0f, nf);
+  // ln(2) is split into two constants so that the reduction is exact.
+  x -= nf * 0.693359375f;
+  x += nf * 2.12194440e-4f;
+
+  float8 z = x * 1.9875691500e-4f + 1.3981999507e-3f;
+  z = z * x + 8.3334519073e-3f;
+  z = z * x + 4.1665795894e-2f;
+  z = z * x + 1.6666665459e-1f;
+  z = z * x + 5.0000001201e-1f;
+  z = z * x * x + x + 1.0f;
+
+  // Scale by 2^n by constructing the exponent bits directly.
+  int32x8 pow2n = (__builtin_convertvector(nf, int32x8) + 127) << 23;
+  return z * Int32x8AsFloat8(pow2n);
+}
+
+/// \returns the lane-wise single-precision natural logarithm of \p x,
+/// computed with the Cephes polynomial approximation. The input must be
+/// positive; zero, negative and denormal inputs give undefined results.
+inline float8 LogFloat8(float8 x) {
+  // Decompose x into m * 2^e with m in [0.5, 1) by manipulating the bits
+  // of the float representation directly.
+  int32x8 ix = Float8AsInt32x8(x);
+  int32x8 e = ((ix >> 23) & 0xff) - 126;
+  ix = (ix & 0x007fffff) | 0x3f000000;
+  float8 m = Int32x8AsFloat8(ix);
+
+  // Normalize m to [sqrt(1/2), sqrt(2)), adjusting the exponent. The mask
+  // lanes are -1 when set, so adding the mask decrements the exponent.
+  int32x8 mask = m < 0.707106781186547524f;
+  e += mask;
+  m += SelectFloat8(mask, m, SplatFloat8(0.0f));
+  m -= 1.0f;
+
+  float8 z = m * m;
+  float8 p = m * 7.0376836292e-2f - 1.1514610310e-1f;
+  p = p * m + 1.1676998740e-1f;
+  p = p * m - 1.2420140846e-1f;
+  p = p * m + 1.4249322787e-1f;
+  p = p * m - 1.6668057665e-1f;
+  p = p * m + 2.0000714765e-1f;
+  p = p * m - 2.4999993993e-1f;
+  p = p * m + 3.3333331174e-1f;
+
+  float8 fe = __builtin_convertvector(e, float8);
+  float8 y = m * z * p;
+  y += fe * -2.12194440e-4f;
+  y -= 0.5f * z;
+  return m + y + fe * 0.693359375f;
+}
+
 /// \returns the index of the element at x,y,z,w,q,r.
 inline size_t libjit_getXYZWQR(const size_t *dims, size_t x, size_t y, size_t z,
                                size_t w, size_t q, size_t r) {
@@ -109,4 +268,13 @@ inline int32_t libjit_scale_i32i8(int32_t input, int32_t pre, int32_t post,
   return ((((input >> pre) * scale) + rtn) >> post) + offset;
 }
 
+/// Scales eight 32-bit integer lanes at once using the integer
+/// shift-mult-shift method, keeping the whole pipeline in vector registers.
+/// See libjit_scale_i32i8 for the semantics.
+inline int32x8 libjit_scale_i32x8(int32x8 input, int32_t pre, int32_t post,
+                                  int32_t scale, int32_t offset) {
+  int rtn = (post > 0) ? (1 << (post - 1)) : 0;
+  return ((((input >> pre) * scale) + rtn) >> post) + offset;
+}
+
 #endif // GLOW_BACKENDS_CPU_LIBJIT_LIBJIT_DEFS_H
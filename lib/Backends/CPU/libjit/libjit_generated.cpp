@@ -0,0 +1,79 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cmath>
+#include <cstddef>
+
+extern "C" {
+
+/// This file stamps out whole-buffer float kernels for the data-parallel
+/// instructions whose scalar semantics are declared in ClassGen (see
+/// InstrBuilder::scalarKernel()). Every instruction annotated there gets a
+/// kernel here by construction; the plain counted loops below are written so
+/// that clang's loop vectorizer turns them into SIMD code under the -ffast-math
+/// flags this library is built with.
+
+/// Kernel with a single input buffer:
+/// dest[i] = expr(IN0[i]).
+#define DEF_DATA_PARALLEL_KERNEL_1(CLASS, NAME, EXPR, IN0)                     \
+  void libjit_##NAME##_generated_f(float *dest, const float *IN0, size_t n) {  \
+    for (size_t i = 0; i < n; i++) {                                           \
+      dest[i] = EXPR;                                                          \
+    }                                                                          \
+  }
+
+/// Kernel with two input buffers:
+/// dest[i] = expr(IN0[i], IN1[i]).
+#define DEF_DATA_PARALLEL_KERNEL_2(CLASS, NAME, EXPR, IN0, IN1)                \
+  void libjit_##NAME##_generated_f(float *dest, const float *IN0,              \
+                                   const float *IN1, size_t n) {               \
+    for (size_t i = 0; i < n; i++) {                                           \
+      dest[i] = EXPR;                                                          \
+    }                                                                          \
+  }
+
+/// Kernel with three input buffers:
+/// dest[i] = expr(IN0[i], IN1[i], IN2[i]).
+#define DEF_DATA_PARALLEL_KERNEL_3(CLASS, NAME, EXPR, IN0, IN1, IN2)           \
+  void libjit_##NAME##_generated_f(float *dest, const float *IN0,              \
+                                   const float *IN1, const float *IN2,         \
+                                   size_t n) {                                 \
+    for (size_t i = 0; i < n; i++) {                                           \
+      dest[i] = EXPR;                                                          \
+    }                                                                          \
+  }
+
+/// Kernel with no input buffers and a float immediate:
+/// dest[i] = expr(imm).
+#define DEF_DATA_PARALLEL_KERNEL_0_IMM(CLASS, NAME, EXPR)                      \
+  void libjit_##NAME##_generated_f(float *dest, float imm, size_t n) {         \
+    for (size_t i = 0; i < n; i++) {                                           \
+      dest[i] = EXPR;                                                          \
+    }                                                                          \
+  }
+
+/// Kernel with a single input buffer and a float immediate:
+/// dest[i] = expr(IN0[i], imm).
+#define DEF_DATA_PARALLEL_KERNEL_1_IMM(CLASS, NAME, EXPR, IN0)                 \
+  void libjit_##NAME##_generated_f(float *dest, const float *IN0, float imm,   \
+                                   size_t n) {                                 \
+    for (size_t i = 0; i < n; i++) {                                           \
+      dest[i] = EXPR;                                                          \
+    }                                                                          \
+  }
+
+#include "AutoGenInstrKernels.def"
+
+} // extern "C"
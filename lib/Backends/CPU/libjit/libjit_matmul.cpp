@@ -15,6 +15,9 @@
  */
 #include "libjit_defs.h"
 
+#include <cstdlib>
+#include <pthread.h>
+
 namespace {
 
 /// Macros for accessing submatrices of a matmul using the leading dimension.
@@ -143,6 +146,108 @@ void pack_matrix_b(size_t n, size_t k, const float *b, size_t ldb,
   }
 }
 
+/// \returns the number of floats in the packed form of the fully-tiled region
+/// of an \p m x \p k matrix.  Each kc-wide tile of k contributes one packed
+/// copy of the full mr-row groups of A; the ragged rows are not packed.
+size_t packed_a_floats(size_t m, size_t k) { return (m / mr) * mr * k; }
+
+/// \returns the number of floats in the packed form of the fully-tiled region
+/// of a \p k x \p n matrix.  Note that nc is not a multiple of nr, so each
+/// tile packs only its full nr-column groups.
+size_t packed_b_floats(size_t n, size_t k) {
+  size_t total = 0;
+  for (size_t p = 0; p < k; p += kc) {
+    size_t pb = MIN(k - p, kc);
+    for (size_t j = 0; j < n; j += nc) {
+      size_t jb = MIN(n - j, nc);
+      total += (jb / nr) * nr * pb;
+    }
+  }
+  return total;
+}
+
+/// Pack every (mc x kc) block of the \p m x \p k column-major matrix \p a into
+/// \p a_to.  The block for tile (i, p) starts at offset p * mTiled + i * pb,
+/// where mTiled is the number of full mr-row groups; since mc is a multiple of
+/// mr, all blocks below a given i are fully packed and the offsets are dense.
+void pack_matrix_a_full(size_t m, size_t k, const float *a, size_t lda,
+                        float *a_to) {
+  size_t mTiled = (m / mr) * mr;
+  for (size_t p = 0; p < k; p += kc) {
+    size_t pb = MIN(k - p, kc);
+    for (size_t i = 0; i < m; i += mc) {
+      size_t ib = MIN(m - i, mc);
+      // A trailing block shorter than mr has no full row group to pack; it is
+      // handled entirely by the ragged-edge path.
+      if (ib < mr) {
+        continue;
+      }
+      pack_matrix_a<regsA>(ib, pb, &A(i, p), lda, a_to + p * mTiled + i * pb);
+    }
+  }
+}
+
+/// Pack every (kc x nc) panel of the \p k x \p n column-major matrix \p b into
+/// \p b_to.  Panels are laid out in the (p, j) iteration order of the outer
+/// kernel, so consumers can walk the buffer incrementally.
+void pack_matrix_b_full(size_t n, size_t k, const float *b, size_t ldb,
+                        float *b_to) {
+  for (size_t p = 0; p < k; p += kc) {
+    size_t pb = MIN(k - p, kc);
+    for (size_t j = 0; j < n; j += nc) {
+      size_t jb = MIN(n - j, nc);
+      pack_matrix_b<regsB>(jb, pb, &B(p, j), ldb, b_to);
+      b_to += (jb / nr) * nr * pb;
+    }
+  }
+}
+
+/// A cache of packed copies of constant weight matrices, keyed by the address
+/// of the weight buffer.  Constant weights have a stable address for the
+/// lifetime of a compiled function, so FC-heavy models pay the packing cost
+/// once instead of on every inference.  Entries are never evicted; once the
+/// table fills up, further matrices are packed per call.
+struct libjit_packed_a_entry {
+  const float *key;
+  size_t m;
+  size_t k;
+  const float *packed;
+};
+constexpr unsigned packedACacheSize = 16;
+libjit_packed_a_entry packedACache[packedACacheSize];
+pthread_mutex_t packedACacheLock = PTHREAD_MUTEX_INITIALIZER;
+
+/// \returns a packed copy of the \p m x \p k constant matrix \p a with leading
+/// dimension \p lda, packing and caching it on the first call.  \returns null
+/// if the cache is full, in which case the caller packs a transient copy.  The
+/// lock is held while packing so that concurrent callers see a complete entry.
+const float *libjit_matmul_cached_packed_a(const float *a, size_t m, size_t k,
+                                           size_t lda) {
+  pthread_mutex_lock(&packedACacheLock);
+  libjit_packed_a_entry *free_entry = nullptr;
+  for (unsigned idx = 0; idx < packedACacheSize; idx++) {
+    auto &entry = packedACache[idx];
+    if (entry.key == a && entry.m == m && entry.k == k) {
+      pthread_mutex_unlock(&packedACacheLock);
+      return entry.packed;
+    }
+    if (!entry.key && !free_entry) {
+      free_entry = &entry;
+    }
+  }
+  float *packed = nullptr;
+  if (free_entry &&
+      (packed = (float *)malloc(packed_a_floats(m, k) * sizeof(float)))) {
+    pack_matrix_a_full(m, k, a, lda, packed);
+    free_entry->key = a;
+    free_entry->m = m;
+    free_entry->k = k;
+    free_entry->packed = packed;
+  }
+  pthread_mutex_unlock(&packedACacheLock);
+  return packed;
+}
+
 /// Inner kernel for packed matrices.  The order of the M and N loops matters,
 /// because packed matrices need to be more more sensitive to cache locality,
 /// and N strides over the B matrix, which is very large and will blow out the
@@ -169,36 +274,20 @@ void libjit_matmul_inner_unpacked(int m, int n, int k, const float *a, int lda,
   }
 }
 
-/// Compute a portion of C one block at a time.  Handle ragged edges with calls
-/// to a slow but general helper.
-template <bool pack>
-void libjit_matmul_inner(int m, int n, int k, const float *a, int lda,
-                         const float *b, int ldb, float *c, int ldc,
-                         float *packedB) {
-  // The tiling scheme naturally divides the input matrices into 2 parts each;
-  // one tiled section, and three "ragged" edges.
-  //
-  // --------------------    -------
-  // | A00*B00 | A00*B01|    | A00 |   -------------
-  // -------------------- += ------- * | B00 | B01 |
-  // | A10*B00 | A10*B01|    | A10 |   -------------
-  // --------------------    -------
-  //
-  // We can process this as 4 separate matrix multiplications.  A00*B00 is the
-  // perfectly-tiled portion, which we handly with a 4x16 dot-product kernel.
-  // The ragged edges are (ideally) less critical, so we handle them with a call
-  // to a general matrix-multiplication for odd sizes.
-  float packedA[m * k] __attribute__((aligned(64)));
-  if (pack) {
-    pack_matrix_a<regsA>(m, k, &A(0, 0), lda, packedA);
-  }
-
-  if (pack) {
-    libjit_matmul_inner_packed(m, n, k, packedA, packedB, c, ldc);
-  } else {
-    libjit_matmul_inner_unpacked(m, n, k, a, lda, b, ldb, c, ldc);
-  }
-
+/// Compute the three "ragged" edges of an (m x k) * (k x n) block whose
+/// fully-tiled portion was handled by a fast kernel.
+///
+/// --------------------    -------
+/// | A00*B00 | A00*B01|    | A00 |   -------------
+/// -------------------- += ------- * | B00 | B01 |
+/// | A10*B00 | A10*B01|    | A10 |   -------------
+/// --------------------    -------
+///
+/// A00*B00 is the perfectly-tiled portion.  The ragged edges are (ideally)
+/// less critical, so we handle them with a call to a general
+/// matrix-multiplication for odd sizes.
+void libjit_matmul_inner_edges(int m, int n, int k, const float *a, int lda,
+                               const float *b, int ldb, float *c, int ldc) {
   size_t i = (m / mr) * mr;
   size_t j = (n / nr) * nr;
   if (i < m) {
@@ -213,6 +302,16 @@ void libjit_matmul_inner(int m, int n, int k, const float *a, int lda,
   }
 }
 
+/// Compute a block of C from pre-packed blocks of A and B, then patch up the
+/// ragged edges from the original (unpacked) matrices.
+void libjit_matmul_inner_prepacked(int m, int n, int k, const float *a,
+                                   int lda, const float *b, int ldb, float *c,
+                                   int ldc, const float *packedA,
+                                   const float *packedB) {
+  libjit_matmul_inner_packed(m, n, k, packedA, packedB, c, ldc);
+  libjit_matmul_inner_edges(m, n, k, a, lda, b, ldb, c, ldc);
+}
+
 /// Tile A into mc * kc blocks, where mc and kc are chosen to approximately fit
 /// the L2 cache on recent Intel processors (e.g., 256 KB for Skylake).  Stream
 /// kc * n panels of B through memory to compute each mc * n block of C.
@@ -221,26 +320,79 @@ void libjit_matmul_inner(int m, int n, int k, const float *a, int lda,
 /// \p c is a \p m x \p n column-major matrix.
 /// \p lda, \p ldb, and \p ldc are the leading dimensions of A, B, and C,
 /// respectively.
-template <bool pack>
 void __attribute__((noinline))
-libjit_matmul_outer(size_t m, size_t n, size_t k, const float *a, size_t lda,
-                    const float *b, size_t ldb, float *c, size_t ldc) {
-  float packedB[kc * nc] __attribute__((aligned(64)));
-
+libjit_matmul_outer_unpacked(size_t m, size_t n, size_t k, const float *a,
+                             size_t lda, const float *b, size_t ldb, float *c,
+                             size_t ldc) {
   for (size_t p = 0; p < k; p += kc) {
     size_t pb = MIN(k - p, kc);
     for (size_t j = 0; j < n; j += nc) {
       size_t jb = MIN(n - j, nc);
-      if (pack) {
-        pack_matrix_b<regsB>(jb, pb, &B(p, j), ldb, packedB);
+      for (size_t i = 0; i < m; i += mc) {
+        size_t ib = MIN(m - i, mc);
+        libjit_matmul_inner_unpacked(ib, jb, pb, &A(i, p), lda, &B(p, j), ldb,
+                                     &C(i, j), ldc);
+        libjit_matmul_inner_edges(ib, jb, pb, &A(i, p), lda, &B(p, j), ldb,
+                                  &C(i, j), ldc);
       }
+    }
+  }
+}
+
+/// The part of a packed matrix multiplication that one worker thread performs.
+struct libjit_matmul_task {
+  size_t m;
+  size_t n;
+  size_t k;
+  const float *a;
+  size_t lda;
+  const float *b;
+  size_t ldb;
+  float *c;
+  size_t ldc;
+  const float *packedA;
+  const float *packedB;
+  unsigned threadId;
+  unsigned nthreads;
+};
+
+/// Run the packed outer kernel over the mc-blocks of C rows that belong to
+/// this worker.  Block ownership depends only on the row index, so the k-tiles
+/// of a given block of C are always accumulated by the same thread and no
+/// synchronization on C is needed.
+void *libjit_matmul_f_worker(void *arg) {
+  auto *T = (libjit_matmul_task *)arg;
+  size_t m = T->m;
+  size_t n = T->n;
+  size_t k = T->k;
+  const float *a = T->a;
+  size_t lda = T->lda;
+  const float *b = T->b;
+  size_t ldb = T->ldb;
+  float *c = T->c;
+  size_t ldc = T->ldc;
+  size_t mTiled = (m / mr) * mr;
+  const float *packedB = T->packedB;
+
+  for (size_t p = 0; p < k; p += kc) {
+    size_t pb = MIN(k - p, kc);
+    for (size_t j = 0; j < n; j += nc) {
+      size_t jb = MIN(n - j, nc);
       for (size_t i = 0; i < m; i += mc) {
+        if ((i / mc) % T->nthreads != T->threadId) {
+          continue;
+        }
         size_t ib = MIN(m - i, mc);
-        libjit_matmul_inner<pack>(ib, jb, pb, &A(i, p), lda, &B(p, j), ldb,
-                                  &C(i, j), ldc, packedB);
+        libjit_matmul_inner_prepacked(ib, jb, pb, &A(i, p), lda, &B(p, j), ldb,
+                                      &C(i, j), ldc,
+                                      T->packedA + p * mTiled + i * pb,
+                                      packedB);
       }
+      // Advance past this panel; panels are packed in (p, j) iteration order.
+      packedB += (jb / nr) * nr * pb;
     }
   }
+  return nullptr;
 }
 
 #undef C
@@ -256,29 +408,160 @@ extern "C" {
 /// \p c is a m x n matrix, so \p cDims = {m, n}
 /// \p a is a m x k matrix, so \p aDims = {m, k}
 /// \p b is a k x n matrix, so \p bDims = {k, n}
+/// \p rhsIsConstant is non-zero when \p b is a constant weight, in which case
+/// its packed form is cached across calls.
+/// \p nthreads is the number of threads to shard the packed kernel over.
+/// \p usePacked selects the packed outer kernel over the unpacked one. The
+/// compiler passes the pack_threshold heuristic by default, or the measured
+/// winner for this shape when kernel autotuning is enabled.
 void libjit_matmul_f(float *c, const float *a, const float *b,
                      const size_t *cDims, const size_t *aDims,
-                     const size_t *bDims) {
+                     const size_t *bDims, unsigned rhsIsConstant,
+                     unsigned nthreads, unsigned usePacked) {
   memset(c, 0, cDims[0] * cDims[1] * sizeof(float));
   // Call the matrix multiplication routine with appropriate dimensions and
   // leading dimensions. The "leading dimension" for a row-major matrix is equal
   // to the number of columns in the matrix.  For a, this is k; for b and c,
   // this is n.
   //
-  // This "outer" helper assumes the matrices are given in column-major format
-  // (the packing algorithm is more effective with column-major matrices), while
-  // the input is row-major. So we compute C += B * A, which is equivalent.
+  // The helpers assume the matrices are given in column-major format (the
+  // packing algorithm is more effective with column-major matrices), while the
+  // input is row-major. So we compute C += B * A, which is equivalent.  Note
+  // that this makes the row-major \p b operand the column-major "A" matrix of
+  // the helpers, so the cached packed weights are packed A blocks.
   //
   // The matrix multiplication routine is heavily inspired by:
   // https://github.com/flame/how-to-optimize-gemm
-  int m = cDims[1];
-  int n = cDims[0];
-  int k = aDims[1];
-  bool pack = m >= pack_threshold;
-  if (pack) {
-    libjit_matmul_outer<true>(m, n, k, b, bDims[1], a, aDims[1], c, cDims[1]);
+  size_t m = cDims[1];
+  size_t n = cDims[0];
+  size_t k = aDims[1];
+  if (!usePacked) {
+    libjit_matmul_outer_unpacked(m, n, k, b, bDims[1], a, aDims[1], c,
+                                 cDims[1]);
+    return;
+  }
+
+  // Pack both operands up front: the weights come from the cache when \p b is
+  // constant, and the activations panel is small (kc * n per tile).  Packing
+  // once and sharing the buffers keeps the worker threads compute-only.
+  const float *packedA =
+      rhsIsConstant ? libjit_matmul_cached_packed_a(b, m, k, bDims[1])
+                    : nullptr;
+  float *ownedA = nullptr;
+  if (!packedA) {
+    ownedA = (float *)malloc(packed_a_floats(m, k) * sizeof(float));
+    pack_matrix_a_full(m, k, b, bDims[1], ownedA);
+    packedA = ownedA;
+  }
+  float *packedB = (float *)malloc(packed_b_floats(n, k) * sizeof(float));
+  pack_matrix_b_full(n, k, a, aDims[1], packedB);
+
+  if (nthreads < 1) {
+    nthreads = 1;
+  }
+  libjit_matmul_task tasks[nthreads];
+  for (unsigned tid = 0; tid < nthreads; tid++) {
+    tasks[tid] = {m, n,        k,       b,       bDims[1], a,       aDims[1],
+                  c, cDims[1], packedA, packedB, tid,      nthreads};
+  }
+
+  if (nthreads == 1) {
+    libjit_matmul_f_worker(&tasks[0]);
   } else {
-    libjit_matmul_outer<false>(m, n, k, b, bDims[1], a, aDims[1], c, cDims[1]);
+    pthread_t threads[nthreads];
+    unsigned spawned = 0;
+    for (unsigned tid = 1; tid < nthreads; tid++) {
+      if (pthread_create(&threads[tid], nullptr, libjit_matmul_f_worker,
+                         &tasks[tid]) != 0) {
+        break;
+      }
+      spawned++;
+    }
+    libjit_matmul_f_worker(&tasks[0]);
+    // If a thread could not be spawned, run its share inline.
+    for (unsigned tid = spawned + 1; tid < nthreads; tid++) {
+      libjit_matmul_f_worker(&tasks[tid]);
+    }
+    for (unsigned tid = 1; tid <= spawned; tid++) {
+      pthread_join(threads[tid], nullptr);
+    }
+  }
+
+  free(packedB);
+  free(ownedA);
+}
+
+/// Performs c = relu(a * b + bias), where c, a, and b are row-major matrices
+/// with the same shapes as in libjit_matmul_f and \p bias has cDims[1]
+/// elements. The k-tiles of each block of C are accumulated back-to-back, so
+/// the bias and the activation are applied while the block is still cache
+/// resident instead of in a separate read-modify-write pass over the whole
+/// output. This ordering gives up the packed outer kernel, which is a good
+/// trade for the small-batch fully-connected layers the fusion targets.
+void libjit_fc_relu_f(float *c, const float *a, const float *b,
+                      const float *bias, const size_t *cDims,
+                      const size_t *aDims, const size_t *bDims) {
+  memset(c, 0, cDims[0] * cDims[1] * sizeof(float));
+  // The same column-major transposition trick as libjit_matmul_f: compute
+  // C += B * A so the row-major operands can be passed to the column-major
+  // helpers unchanged. The helper "m" index is then the output feature,
+  // which is also the bias index.
+  size_t m = cDims[1];
+  size_t n = cDims[0];
+  size_t k = aDims[1];
+  const float *ha = b;
+  size_t lda = bDims[1];
+  const float *hb = a;
+  size_t ldb = aDims[1];
+  size_t ldc = cDims[1];
+  for (size_t j = 0; j < n; j += nc) {
+    size_t jb = MIN(n - j, nc);
+    for (size_t i = 0; i < m; i += mc) {
+      size_t ib = MIN(m - i, mc);
+      for (size_t p = 0; p < k; p += kc) {
+        size_t pb = MIN(k - p, kc);
+        libjit_matmul_inner_unpacked(ib, jb, pb, &ha[p * lda + i], lda,
+                                     &hb[j * ldb + p], ldb, &c[j * ldc + i],
+                                     ldc);
+        libjit_matmul_inner_edges(ib, jb, pb, &ha[p * lda + i], lda,
+                                  &hb[j * ldb + p], ldb, &c[j * ldc + i], ldc);
+      }
+      // The block is complete: add the bias and apply the relu while it is
+      // still hot.
+      for (size_t jj = j; jj < j + jb; jj++) {
+        for (size_t ii = i; ii < i + ib; ii++) {
+          float v = c[jj * ldc + ii] + bias[ii];
+          c[jj * ldc + ii] = MAX(v, 0);
+        }
+      }
+    }
+  }
+}
+
+/// Performs the matrix multiplication c = a * b, where \p b is a CSR-encoded
+/// sparse matrix: \p b points at k + 1 uint32_t row pointers, followed by
+/// \p numNonZeros uint32_t column indices and \p numNonZeros float values.
+/// Each stored non-zero is scattered into the rows of \p c, so the cost is
+/// proportional to the number of non-zeros instead of k * n.
+void libjit_matmul_csr_f(float *c, const float *a, const float *b,
+                         const size_t *cDims, const size_t *aDims,
+                         size_t numNonZeros) {
+  size_t m = cDims[0];
+  size_t n = cDims[1];
+  size_t k = aDims[1];
+  const uint32_t *rowPtr = (const uint32_t *)b;
+  const uint32_t *colIdx = rowPtr + k + 1;
+  const float *values = (const float *)(colIdx + numNonZeros);
+  memset(c, 0, m * n * sizeof(float));
+  for (size_t x = 0; x < m; x++) {
+    float *cRow = &c[x * n];
+    const float *aRow = &a[x * k];
+    for (size_t i = 0; i < k; i++) {
+      float l = aRow[i];
+      for (uint32_t j = rowPtr[i], e = rowPtr[i + 1]; j < e; j++) {
+        cRow[colIdx[j]] += l * values[j];
+      }
+    }
   }
 }
 
@@ -300,4 +583,76 @@ void libjit_matmul_i8(int8_t *outW, const int8_t *lhsW, const int8_t *rhsW,
     }
   }
 }
+
+/// The arguments of a libjit_batchmatmul_f call, plus the identity of one of
+/// the threads that shard its work.
+struct libjit_batchmatmul_task {
+  float *c;
+  const float *a;
+  const float *b;
+  const size_t *cDims;
+  const size_t *aDims;
+  const size_t *bDims;
+  unsigned threadId;
+  unsigned nthreads;
+};
+
+/// Perform this thread's share of a batched matrix multiplication. The batch
+/// entries are dealt round-robin to the threads, and every thread runs the
+/// single-threaded matmul on its own entries, so any packed panels stay
+/// thread-private and no synchronization is needed beyond the final join.
+static void *libjit_batchmatmul_f_worker(void *arg) {
+  auto *T = (libjit_batchmatmul_task *)arg;
+  size_t cStride = T->cDims[1] * T->cDims[2];
+  size_t aStride = T->aDims[1] * T->aDims[2];
+  size_t bStride = T->bDims[1] * T->bDims[2];
+  for (size_t i = T->threadId; i < T->cDims[0]; i += T->nthreads) {
+    libjit_matmul_f(T->c + i * cStride, T->a + i * aStride, T->b + i * bStride,
+                    T->cDims + 1, T->aDims + 1, T->bDims + 1,
+                    /* rhsIsConstant */ 0, /* nthreads */ 1,
+                    /* usePacked */ T->cDims[2] >= pack_threshold);
+  }
+  return nullptr;
+}
+
+/// Performs the batched matrix multiplication c[i] = a[i] * b[i] for every
+/// batch entry, where the entries are row-major matrices.
+/// \p c is a N x m x n tensor, so \p cDims = {N, m, n}
+/// \p a is a N x m x k tensor, so \p aDims = {N, m, k}
+/// \p b is a N x k x n tensor, so \p bDims = {N, k, n}
+/// \p nthreads is the number of threads the batch is sharded over.
+void libjit_batchmatmul_f(float *c, const float *a, const float *b,
+                          const size_t *cDims, const size_t *aDims,
+                          const size_t *bDims, unsigned nthreads) {
+  if (nthreads < 1) {
+    nthreads = 1;
+  }
+  libjit_batchmatmul_task tasks[nthreads];
+  for (unsigned tid = 0; tid < nthreads; tid++) {
+    tasks[tid] = {c, a, b, cDims, aDims, bDims, tid, nthreads};
+  }
+
+  if (nthreads == 1 || cDims[0] < 2) {
+    libjit_batchmatmul_f_worker(&tasks[0]);
+    return;
+  }
+
+  pthread_t threads[nthreads];
+  unsigned spawned = 0;
+  for (unsigned tid = 1; tid < nthreads; tid++) {
+    if (pthread_create(&threads[tid], nullptr, libjit_batchmatmul_f_worker,
+                       &tasks[tid]) != 0) {
+      break;
+    }
+    spawned++;
+  }
+  libjit_batchmatmul_f_worker(&tasks[0]);
+  // If a thread could not be spawned, run its share inline.
+  for (unsigned tid = spawned + 1; tid < nthreads; tid++) {
+    libjit_batchmatmul_f_worker(&tasks[tid]);
+  }
+  for (unsigned tid = 1; tid <= spawned; tid++) {
+    pthread_join(threads[tid], nullptr);
+  }
+}
 }
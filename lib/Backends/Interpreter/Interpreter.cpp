@@ -20,6 +20,7 @@
 #include "glow/Graph/Graph.h"
 #include "glow/Graph/Nodes.h"
 #include "glow/IR/IR.h"
+#include "glow/Optimizer/Optimizer.h"
 
 using namespace glow;
 
@@ -35,6 +36,7 @@ bool Interpreter::isOpSupported(Kinded::Kind opKind, ElemKind elementTy) const {
     case Kinded::Kind::AddNodeKind:
     case Kinded::Kind::BatchedAddNodeKind:
     case Kinded::Kind::BatchedReduceAddNodeKind:
+    case Kinded::Kind::BroadcastNodeKind:
     case Kinded::Kind::CmpLTENodeKind:
     case Kinded::Kind::ConcatNodeKind:
     case Kinded::Kind::ConvolutionNodeKind:
@@ -42,6 +44,7 @@ bool Interpreter::isOpSupported(Kinded::Kind opKind, ElemKind elementTy) const {
     case Kinded::Kind::DivNodeKind:
     case Kinded::Kind::FullyConnectedNodeKind:
     case Kinded::Kind::GatherNodeKind:
+    case Kinded::Kind::InsertTensorNodeKind:
     case Kinded::Kind::MatMulNodeKind:
     case Kinded::Kind::MaxNodeKind:
     case Kinded::Kind::MinNodeKind:
@@ -52,9 +55,11 @@ bool Interpreter::isOpSupported(Kinded::Kind opKind, ElemKind elementTy) const {
     case Kinded::Kind::ReluNodeKind:
     case Kinded::Kind::RescaleQuantizedNodeKind:
     case Kinded::Kind::ReshapeNodeKind:
+    case Kinded::Kind::ScatterAssignNodeKind:
     case Kinded::Kind::SelectNodeKind:
     case Kinded::Kind::SigmoidNodeKind:
     case Kinded::Kind::SliceNodeKind:
+    case Kinded::Kind::SplatNodeKind:
     case Kinded::Kind::SubNodeKind:
     case Kinded::Kind::TanhNodeKind:
     case Kinded::Kind::TopKNodeKind:
@@ -65,15 +70,73 @@ bool Interpreter::isOpSupported(Kinded::Kind opKind, ElemKind elementTy) const {
     }
   }
 
+  // Int16 is a middle operating point for models that lose too much
+  // accuracy at int8. Only the generic data movement and arithmetic
+  // kernels understand it; the specialized int8 kernels (Convolution,
+  // FullyConnected, ...) do not.
+  if (elementTy == ElemKind::Int16QTy) {
+    switch (opKind) {
+    case Kinded::Kind::AddNodeKind:
+    case Kinded::Kind::BroadcastNodeKind:
+    case Kinded::Kind::ConcatNodeKind:
+    case Kinded::Kind::DequantizeNodeKind:
+    case Kinded::Kind::DivNodeKind:
+    case Kinded::Kind::InsertTensorNodeKind:
+    case Kinded::Kind::MaxNodeKind:
+    case Kinded::Kind::MinNodeKind:
+    case Kinded::Kind::MulNodeKind:
+    case Kinded::Kind::QuantizeNodeKind:
+    case Kinded::Kind::RescaleQuantizedNodeKind:
+    case Kinded::Kind::ReshapeNodeKind:
+    case Kinded::Kind::SliceNodeKind:
+    case Kinded::Kind::SplatNodeKind:
+    case Kinded::Kind::SubNodeKind:
+    case Kinded::Kind::TransposeNodeKind:
+      return true;
+    default:
+      return false;
+    }
+  }
+
   return true;
 }
 
 bool Interpreter::shouldLower(const Node *N) const {
   if (N->getKind() == Kinded::Kind::ConvolutionNodeKind)
     return false;
+  // Broadcasts are executed as a single strided-read kernel instead of a
+  // chain of materialized tiles.
+  if (N->getKind() == Kinded::Kind::BroadcastNodeKind)
+    return false;
+  // Float batched matmuls are executed natively with the batch sharded over
+  // the thread pool, instead of a chain of slices and serial matmuls.
+  if (N->getKind() == Kinded::Kind::BatchMatMulNodeKind &&
+      N->getNthResult(0).getType()->getElementType() == ElemKind::FloatTy)
+    return false;
+  // The fused recurrent cells are executed natively so the gate activations
+  // stay in a per-row scratch buffer instead of round-tripping through
+  // memory between the small ops of the expanded form.
+  if ((N->getKind() == Kinded::Kind::LSTMCellNodeKind ||
+       N->getKind() == Kinded::Kind::GRUCellNodeKind) &&
+      N->getNthResult(0).getType()->getElementType() == ElemKind::FloatTy)
+    return false;
+  // The optimizer updates are executed natively as one fused pass over
+  // each weight buffer, instead of a chain of elementwise nodes.
+  if ((N->getKind() == Kinded::Kind::SGDNodeKind ||
+       N->getKind() == Kinded::Kind::AdamNodeKind ||
+       N->getKind() == Kinded::Kind::RMSPropNodeKind) &&
+      N->getNthResult(0).getType()->getElementType() == ElemKind::FloatTy)
+    return false;
   return true;
 }
 
+bool Interpreter::transformPostLowering(Function *F,
+                                        CompilationMode mode) const {
+  // Sum-over-gather chains run as one fused kernel that never materializes
+  // the gathered intermediate.
+  return fuseGatherReduceAdd(F);
+}
+
 namespace glow {
 Backend *createInterpreter() { return new Interpreter(); }
 } // namespace glow
@@ -40,6 +40,12 @@ public:
   bool isOpSupported(Kinded::Kind opKind, ElemKind elementTy) const override;
 
   bool shouldLower(const Node *N) const override;
+
+  bool transformPostLowering(Function *F, CompilationMode mode) const override;
+
+  /// The interpreter executes matrix multiplications with CSR-encoded
+  /// weights directly.
+  bool supportsSparseWeights() const override { return true; }
   /// @}
 };
 
@@ -16,14 +16,85 @@
 
 #include "InterpreterFunction.h"
 
+#include "glow/CodeGen/MemoryAllocator.h"
 #include "glow/IR/IR.h"
 #include "glow/IR/IRUtils.h"
 #include "glow/IR/Instrs.h"
+#include "glow/Support/Memory.h"
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/Support/Casting.h"
+#include "llvm/Support/CommandLine.h"
+
+#include <algorithm>
+#include <array>
 
 using namespace glow;
 
+static llvm::cl::opt<unsigned> interpreterNumThreads(
+    "interpreter-num-threads",
+    llvm::cl::desc("Number of threads that the interpreter shards its "
+                   "convolution and elementwise loops over (0 uses all "
+                   "hardware threads, 1 disables threading)"),
+    llvm::cl::init(0));
+
+InterpreterThreadPool::InterpreterThreadPool(unsigned numWorkers) {
+  for (unsigned i = 1; i < numWorkers; i++) {
+    workers_.emplace_back([this, i] { workerLoop(i); });
+  }
+}
+
+InterpreterThreadPool::~InterpreterThreadPool() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  start_.notify_all();
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+}
+
+void InterpreterThreadPool::workerLoop(unsigned id) {
+  uint64_t lastGeneration = 0;
+  while (true) {
+    const std::function<void(unsigned, unsigned)> *job;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      start_.wait(lock,
+                  [&] { return stop_ || generation_ != lastGeneration; });
+      if (stop_) {
+        return;
+      }
+      lastGeneration = generation_;
+      job = job_;
+    }
+    (*job)(id, getNumWorkers());
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (--pending_ == 0) {
+        done_.notify_one();
+      }
+    }
+  }
+}
+
+void InterpreterThreadPool::run(
+    const std::function<void(unsigned, unsigned)> &fn) {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    job_ = &fn;
+    pending_ = workers_.size();
+    generation_++;
+  }
+  start_.notify_all();
+  // The calling thread takes part as worker 0.
+  fn(0, getNumWorkers());
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_.wait(lock, [&] { return pending_ == 0; });
+  job_ = nullptr;
+}
+
 InterpreterFunction::InterpreterFunction(std::unique_ptr<IRFunction> F)
     : F_(std::move(F)) {
   for (auto &v : F_->getGraph()->getParent()->getVars()) {
@@ -35,15 +106,51 @@ InterpreterFunction::InterpreterFunction(std::unique_ptr<IRFunction> F)
   for (auto *W : F_->getWeights()) {
     getOrCreateTensor(W);
   }
+
+  // Pack all of the activations into one slab. The sizes and live intervals
+  // are known before execution, so the layout is computed once here and the
+  // backing tensors are reused across execute() calls instead of being
+  // allocated and freed on every run.
+  MemoryAllocator activationsAllocator(0);
+  std::vector<OfflineAllocation> buffers;
+  llvm::DenseMap<const Value *, size_t> bufferIdx;
+  size_t instrIdx = 0;
+  for (const auto &I : F_->getInstrs()) {
+    if (auto *A = llvm::dyn_cast<AllocActivationInst>(&I)) {
+      assert(!bufferIdx.count(A) && "Allocation already made!");
+      bufferIdx[A] = buffers.size();
+      buffers.push_back({A->getSizeInBytes(), instrIdx, F_->getInstrs().size(),
+                         MemoryAllocator::npos});
+    } else if (auto *D = llvm::dyn_cast<DeallocActivationInst>(&I)) {
+      auto *A = D->getAlloc();
+      assert(bufferIdx.count(A) && "Invalid deallocation!");
+      buffers[bufferIdx[A]].end = instrIdx;
+    }
+    instrIdx++;
+  }
+  size_t slabSize = activationsAllocator.allocateAll(buffers);
+  assert(slabSize != MemoryAllocator::npos &&
+         "Could not pack the activations");
+  if (slabSize) {
+    activationsSlab_ =
+        reinterpret_cast<char *>(alignedAlloc(slabSize, TensorAlignment));
+    for (auto &A : bufferIdx) {
+      tensors_[A.first] = new Tensor(
+          activationsSlab_ + buffers[A.second].offset, A.first->getType());
+    }
+  }
 }
 
 InterpreterFunction::~InterpreterFunction() {
-  // Delete the tensors that are owned by this backend.
+  // Delete the tensors that are owned by this backend. The slab-backed
+  // activation tensors are unowned views, so deleting them does not touch
+  // the slab itself.
   for (auto p : tensors_) {
     delete p.second;
   }
   tensors_.clear();
   externalTensors_.clear();
+  alignedFree(activationsSlab_);
 }
 
 Tensor *InterpreterFunction::getTensor(const Value *v) const {
@@ -102,22 +209,66 @@ void InterpreterFunction::deleteTensor(const Value *v) {
   tensors_.erase(it);
 }
 
+void InterpreterFunction::parallelFor(
+    size_t range, const std::function<void(size_t, size_t)> &body) {
+  unsigned numThreads = interpreterNumThreads == 0
+                            ? std::thread::hardware_concurrency()
+                            : interpreterNumThreads.getValue();
+  if (numThreads < 1) {
+    numThreads = 1;
+  }
+  // Tiny ranges are not worth waking the pool for.
+  if (numThreads == 1 || range < 2 * numThreads) {
+    body(0, range);
+    return;
+  }
+  if (!threadPool_ || threadPool_->getNumWorkers() != numThreads) {
+    threadPool_.reset(new InterpreterThreadPool(numThreads));
+  }
+  threadPool_->run([&](unsigned id, unsigned numWorkers) {
+    size_t chunk = (range + numWorkers - 1) / numWorkers;
+    size_t begin = std::min((size_t)id * chunk, range);
+    size_t end = std::min(begin + chunk, range);
+    if (begin < end) {
+      body(begin, end);
+    }
+  });
+}
+
 void InterpreterFunction::execute() {
-// Do the forward pass.
+  // Dispatch each instruction through a dense function-pointer table indexed
+  // by the instruction kind. The Kind enum lists the IR instructions and
+  // values first and without gaps, so the table is small, built once, and the
+  // per-instruction dispatch is an indexed load plus an indirect call instead
+  // of a switch.
+  using FwdFn = void (*)(InterpreterFunction *, const Instruction *);
+
+  // The number of leading Kind entries that belong to the IR (instructions
+  // and values).
+  static constexpr size_t numIRKinds =
+#define DEF_VALUE(CLASS, NAME) 1 +
+#define DEF_INSTR(CLASS, NAME) 1 +
+#define DEF_BACKEND_SPECIFIC_INSTR(CLASS, NAME) 1 +
+#include "AutoGenInstr.def"
+      0;
+
+  static const std::array<FwdFn, numIRKinds> dispatchTable = [] {
+    std::array<FwdFn, numIRKinds> table{};
 #define DEF_VALUE(CLASS, NAME)
 #define DEF_INSTR(CLASS, NAME)                                                 \
-  case Kinded::Kind::CLASS##Kind: {                                            \
-    fwd##CLASS(llvm::cast<CLASS>(&I));                                         \
-    break;                                                                     \
-  }
+  table[(size_t)Kinded::Kind::CLASS##Kind] =                                   \
+      [](InterpreterFunction *IF, const Instruction *I) {                      \
+        IF->fwd##CLASS(llvm::cast<CLASS>(I));                                  \
+      };
 #define DEF_BACKEND_SPECIFIC_INSTR(CLASS, NAME)
-  // Dispatch the interpreter on each instruction in the program:
-  for (const auto &I : F_->getInstrs()) {
-    switch (I.getKind()) {
 #include "AutoGenInstr.def"
+    return table;
+  }();
 
-    default:
-      llvm_unreachable("Invalid instruction.");
-    }
+  // Do the forward pass.
+  for (const auto &I : F_->getInstrs()) {
+    FwdFn fn = dispatchTable[(size_t)I.getKind()];
+    assert(fn && "Invalid instruction.");
+    fn(this, &I);
   }
 }
@@ -21,12 +21,18 @@
 
 #include "llvm/ADT/ArrayRef.h"
 
+#include <condition_variable>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 namespace glow {
 
 class Context;
+class Instruction;
 class IRFunction;
 class Value;
 class Tensor;
@@ -38,6 +44,48 @@ class Variable;
 #define DEF_BACKEND_SPECIFIC_INSTR(CLASS, NAME)
 #include "AutoGenInstr.def"
 
+/// A minimal fork-join thread pool that the interpreter uses to shard its
+/// heavy loops. run() executes the same job on every worker, including the
+/// calling thread, and waits for all of them to finish; the workers sleep
+/// between jobs.
+class InterpreterThreadPool {
+  /// The spawned workers. The calling thread acts as worker 0, so this holds
+  /// one thread fewer than the number of workers.
+  std::vector<std::thread> workers_;
+  /// Protects all of the state below.
+  std::mutex mutex_;
+  /// Signalled when a new job is published or the pool shuts down.
+  std::condition_variable start_;
+  /// Signalled when the last worker finishes the current job.
+  std::condition_variable done_;
+  /// The job that the workers run, valid while a run() is in progress.
+  const std::function<void(unsigned, unsigned)> *job_{nullptr};
+  /// Incremented for every published job, so that the workers can tell a new
+  /// job from a spurious wakeup.
+  uint64_t generation_{0};
+  /// The number of spawned workers that have not finished the current job.
+  unsigned pending_{0};
+  /// Set when the pool shuts down.
+  bool stop_{false};
+
+  /// The loop that the spawned worker \p id runs. The calling thread of
+  /// run() acts as worker 0, so the spawned ids start at 1.
+  void workerLoop(unsigned id);
+
+public:
+  /// Ctor. Spawns \p numWorkers - 1 threads; the thread that calls run()
+  /// takes part as well.
+  explicit InterpreterThreadPool(unsigned numWorkers);
+  ~InterpreterThreadPool();
+
+  /// \returns the number of workers, including the calling thread.
+  unsigned getNumWorkers() const { return workers_.size() + 1; }
+
+  /// Run \p fn(workerId, numWorkers) on every worker, including the calling
+  /// thread, and wait until all of them finish.
+  void run(const std::function<void(unsigned, unsigned)> &fn);
+};
+
 /// Function "compiled" for execution by the interpreter.
 class InterpreterFunction final : public CompiledFunction {
   /// The IR to be executed.
@@ -46,6 +94,15 @@ class InterpreterFunction final : public CompiledFunction {
   std::unordered_map<const Value *, Tensor *> tensors_;
   /// Maps values to Tensors, that are *not* owned by this class.
   std::unordered_map<const Value *, Tensor *> externalTensors_;
+  /// The pool that parallelFor() shards work over, created on first use.
+  std::unique_ptr<InterpreterThreadPool> threadPool_;
+  /// Counts how many times each QuantizationProfile instruction has executed,
+  /// so that profiling can be sampled every Nth batch.
+  std::unordered_map<const Instruction *, uint64_t> profileSampleCounters_;
+  /// One packed buffer backing all of the activations. The activation sizes
+  /// and live intervals are static, so the buffer is laid out once in the
+  /// constructor and reused across execute() calls.
+  char *activationsSlab_{nullptr};
 
 public:
   InterpreterFunction(std::unique_ptr<IRFunction> F);
@@ -75,6 +132,13 @@ private:
   /// If a tensor is allocated for \p v then delete it.
   void deleteTensor(const Value *v);
 
+  /// Shard the half-open range [0, \p range) over the thread pool and run
+  /// \p body(begin, end) for every shard. Each shard is a contiguous
+  /// subrange, so the shards write disjoint parts of the output. Small
+  /// ranges, and pools of one thread, run inline on the calling thread.
+  void parallelFor(size_t range,
+                   const std::function<void(size_t, size_t)> &body);
+
   /// \returns a typed handle to the tensor that is stored at \p v.
   template <class ElemTy = float>
   Handle<ElemTy> getWeightHandle(Value *v) const {
@@ -97,6 +161,19 @@ private:
                                     Value *biasV, size_t filterSize,
                                     size_t stride, llvm::ArrayRef<size_t> pads,
                                     size_t group);
+  void fwdConvolutionInst_FloatIm2ColImpl(Value *inV, Value *outV,
+                                          Value *filterV, Value *biasV,
+                                          size_t filterSize, size_t stride,
+                                          llvm::ArrayRef<size_t> pads,
+                                          size_t group);
+
+  /// Generic quantized implementation of a binary arithmetic instruction:
+  /// both operands are dequantized, combined with \p f and the result is
+  /// quantized into \p destV. The Int16QTy paths use it, where the fp32
+  /// round-trip carries enough precision.
+  template <typename ElemTy, typename Fn>
+  void fwdElementBinaryQuantizedImpl(Value *destV, Value *lhsV, Value *rhsV,
+                                     Fn &&f);
   ///@}
 };
 
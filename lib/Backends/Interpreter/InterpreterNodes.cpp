@@ -19,13 +19,46 @@
 #include "glow/IR/Instrs.h"
 #include "glow/Quantization/Base/Base.h"
 #include "glow/Quantization/Base/Profile.h"
+#include "glow/Support/FastMath.h"
 
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/Casting.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <cstring>
+#include <vector>
+
 using namespace glow;
 
+static llvm::cl::opt<unsigned> profileSampleInterval(
+    "profile-sample-interval",
+    llvm::cl::desc("Update each quantization profile only every Nth "
+                   "execution; intermediate executions skip the histogram "
+                   "entirely (1 profiles every batch)"),
+    llvm::cl::init(1));
+
+static llvm::cl::opt<unsigned> profileSampleStride(
+    "profile-sample-stride",
+    llvm::cl::desc("Feed only every Nth element of a tensor into its "
+                   "quantization profile (1 observes all elements)"),
+    llvm::cl::init(1));
+
+static llvm::cl::opt<bool> interpreterFastSigmoidTanh(
+    "interpreter-fast-sigmoid-tanh",
+    llvm::cl::desc("Use the fast polynomial approximations of sigmoid and "
+                   "tanh instead of libm, at a small cost in accuracy"),
+    llvm::cl::init(false));
+
+/// \returns the flat offset of the element at (\p n, \p h, \p w, \p c) of a
+/// contiguous tensor with the NHWC shape \p dims. The hot kernels below index
+/// raw data pointers with this instead of going through Handle::at(), which
+/// re-derives the strides from the type on every access.
+static size_t flatNHWC(const ShapeNHWC &dims, size_t n, size_t h, size_t w,
+                       size_t c) {
+  return ((n * dims.h + h) * dims.w + w) * dims.c + c;
+}
+
 //===----------------------------------------------------------------------===//
 //                       Convolution
 //===----------------------------------------------------------------------===//
@@ -41,13 +74,16 @@ void InterpreterFunction::fwdConvolutionInst_FloatImpl(
     Value *inV, Value *outV, Value *filterV, Value *biasV, size_t filterSize,
     size_t stride, llvm::ArrayRef<size_t> pads, size_t group) {
 
-  auto inW = getWeightHandle(inV);
-  auto outW = getWeightHandle(outV);
-  auto filterW = getWeightHandle(filterV);
-  auto biasW = getWeightHandle(biasV);
+  // The tensors are contiguous, so the inner loops index raw data pointers
+  // directly instead of going through Handle::at().
+  const float *inP = getTensor(inV)->getRawDataPointer<float>();
+  float *outP = getTensor(outV)->getRawDataPointer<float>();
+  const float *filterP = getTensor(filterV)->getRawDataPointer<float>();
+  const float *biasP = getTensor(biasV)->getRawDataPointer<float>();
 
-  ShapeNHWC odim(outW.dims());
-  ShapeNHWC idim(inW.dims());
+  ShapeNHWC odim(outV->dims());
+  ShapeNHWC idim(inV->dims());
+  ShapeNHWC fdim(filterV->dims());
 
   assert(idim.c % group == 0 && "Input channels must be divisible by group.");
   assert(odim.c % group == 0 && "Output channels must be divisible by group.");
@@ -56,60 +92,144 @@ void InterpreterFunction::fwdConvolutionInst_FloatImpl(
 
   PaddingTLBR pdim(pads);
 
-  // For each input in the batch:
-  for (size_t n = 0; n < idim.n; n++) {
+  // Shard the (sample, output channel) pairs over the thread pool; every
+  // pair writes a disjoint slice of the output.
+  parallelFor(idim.n * odim.c, [&](size_t begin, size_t end) {
+    for (size_t item = begin; item < end; item++) {
+      size_t n = item / odim.c;
+      size_t d = item % odim.c;
+      size_t g = d / outCperG;
 
-    // For each group of input channels:
-    for (size_t g = 0; g < group; g++) {
+      // For each convolution 'jump' in the input tensor:
+      ssize_t x = -ssize_t(pdim.top);
+      for (size_t ax = 0; ax < odim.h; x += stride, ax++) {
+        ssize_t y = -ssize_t(pdim.left);
+        for (size_t ay = 0; ay < odim.w; y += stride, ay++) {
 
-      // For each output channel in the group:
-      for (size_t d = g * outCperG; d < (g + 1) * outCperG; d++) {
+          // For each element in the convolution-filter:
+          float sum = 0;
+          for (size_t fx = 0; fx < filterSize; fx++) {
+            for (size_t fy = 0; fy < filterSize; fy++) {
+              ssize_t ox = x + fx;
+              ssize_t oy = y + fy;
 
-        // For each convolution 'jump' in the input tensor:
-        ssize_t x = -ssize_t(pdim.top);
-        for (size_t ax = 0; ax < odim.h; x += stride, ax++) {
-          ssize_t y = -ssize_t(pdim.left);
-          for (size_t ay = 0; ay < odim.w; y += stride, ay++) {
+              // Ignore index access below zero (this is due to padding).
+              if (ox < 0 || oy < 0 || ox >= ssize_t(idim.h) ||
+                  oy >= ssize_t(idim.w)) {
+                continue;
+              }
+              // The filter and input channels are contiguous, so walk both
+              // rows with a flat index.
+              const float *filterRow = &filterP[flatNHWC(fdim, d, fx, fy, 0)];
+              const float *inRow = &inP[flatNHWC(idim, n, (size_t)ox,
+                                                 (size_t)oy, g * inCperG)];
+              for (size_t fd = 0; fd < inCperG; fd++) {
+                sum += filterRow[fd] * inRow[fd];
+              }
+            }
+          }
 
-            // For each element in the convolution-filter:
-            float sum = 0;
-            for (size_t fx = 0; fx < filterSize; fx++) {
-              for (size_t fy = 0; fy < filterSize; fy++) {
-                ssize_t ox = x + fx;
-                ssize_t oy = y + fy;
+          sum += biasP[d];
+          outP[flatNHWC(odim, n, ax, ay, d)] = sum;
+        } // W
+      }   // H
+    }     // (N, C)
+  });
+}
 
-                // Ignore index access below zero (this is due to padding).
-                if (ox < 0 || oy < 0 || ox >= ssize_t(idim.h) ||
-                    oy >= ssize_t(idim.w)) {
-                  continue;
-                }
-                for (size_t fd = 0; fd < inCperG; fd++) {
-                  sum += filterW.at({d, fx, fy, fd}) *
-                         inW.at({n, (size_t)ox, (size_t)oy, g * inCperG + fd});
-                }
+// This is the im2col + GEMM implementation of Convolution. It unrolls every
+// convolution window into a row of a patch matrix and multiplies that matrix
+// with the filter matrix, whose rows are already contiguous in the filter
+// tensor. With many filters per group each unrolled patch is reused many
+// times, which makes this much faster than the naive loop nest.
+void InterpreterFunction::fwdConvolutionInst_FloatIm2ColImpl(
+    Value *inV, Value *outV, Value *filterV, Value *biasV, size_t filterSize,
+    size_t stride, llvm::ArrayRef<size_t> pads, size_t group) {
+  const float *inP = getTensor(inV)->getRawDataPointer<float>();
+  float *outP = getTensor(outV)->getRawDataPointer<float>();
+  const float *filterP = getTensor(filterV)->getRawDataPointer<float>();
+  const float *biasP = getTensor(biasV)->getRawDataPointer<float>();
+
+  ShapeNHWC odim(outV->dims());
+  ShapeNHWC idim(inV->dims());
+
+  assert(idim.c % group == 0 && "Input channels must be divisible by group.");
+  assert(odim.c % group == 0 && "Output channels must be divisible by group.");
+  size_t inCperG = idim.c / group;
+  size_t outCperG = odim.c / group;
+
+  PaddingTLBR pdim(pads);
+
+  // Every row of the patch matrix holds one unrolled convolution window.
+  // The buffer is reused for every (sample, group) pair.
+  size_t patchSize = filterSize * filterSize * inCperG;
+  size_t numPatches = odim.h * odim.w;
+  std::vector<float> patches(numPatches * patchSize);
+
+  for (size_t n = 0; n < idim.n; n++) {
+    for (size_t g = 0; g < group; g++) {
+
+      // im2col: unroll the input windows into rows of the patch matrix.
+      parallelFor(numPatches, [&](size_t begin, size_t end) {
+        for (size_t m = begin; m < end; m++) {
+          size_t ax = m / odim.w;
+          size_t ay = m % odim.w;
+          float *patchRow = &patches[m * patchSize];
+          ssize_t x = ssize_t(ax * stride) - ssize_t(pdim.top);
+          ssize_t y = ssize_t(ay * stride) - ssize_t(pdim.left);
+          for (size_t fx = 0; fx < filterSize; fx++) {
+            for (size_t fy = 0; fy < filterSize; fy++) {
+              ssize_t ox = x + fx;
+              ssize_t oy = y + fy;
+              float *dst = &patchRow[(fx * filterSize + fy) * inCperG];
+              // Windows that hang over the edge are padded with zeros.
+              if (ox < 0 || oy < 0 || ox >= ssize_t(idim.h) ||
+                  oy >= ssize_t(idim.w)) {
+                memset(dst, 0, inCperG * sizeof(float));
+                continue;
               }
+              const float *src = &inP[flatNHWC(idim, n, (size_t)ox,
+                                               (size_t)oy, g * inCperG)];
+              memcpy(dst, src, inCperG * sizeof(float));
             }
-
-            sum += biasW.at({d});
-            outW.at({n, ax, ay, d}) = sum;
-          } // W
-        }   // H
-      }     // C
-    }       // G
-  }         // N
+          }
+        }
+      });
+
+      // GEMM: every output pixel is the dot product of its patch row with
+      // each filter row; both rows are contiguous.
+      parallelFor(numPatches, [&](size_t begin, size_t end) {
+        for (size_t m = begin; m < end; m++) {
+          size_t ax = m / odim.w;
+          size_t ay = m % odim.w;
+          const float *patchRow = &patches[m * patchSize];
+          float *outRow = &outP[flatNHWC(odim, n, ax, ay, g * outCperG)];
+          for (size_t d = 0; d < outCperG; d++) {
+            const float *filterRow = &filterP[(g * outCperG + d) * patchSize];
+            float sum = 0;
+            for (size_t k = 0; k < patchSize; k++) {
+              sum += patchRow[k] * filterRow[k];
+            }
+            outRow[d] = sum + biasP[g * outCperG + d];
+          }
+        }
+      });
+    } // G
+  }   // N
 }
 
 // This is the quantized i8 implementation of Convolution.
 void InterpreterFunction::fwdConvolutionInst_I8Impl(
     Value *inV, Value *outV, Value *filterV, Value *biasV, size_t filterSize,
     size_t stride, llvm::ArrayRef<size_t> pads, size_t group) {
-  auto inW = getWeightHandle<int8_t>(inV);
-  auto outW = getWeightHandle<int8_t>(outV);
-  auto filterW = getWeightHandle<int8_t>(filterV);
-  auto biasW = getWeightHandle<int8_t>(biasV);
+  const int8_t *inP = getTensor(inV)->getRawDataPointer<int8_t>();
+  int8_t *outP = getTensor(outV)->getRawDataPointer<int8_t>();
+  const int8_t *filterP = getTensor(filterV)->getRawDataPointer<int8_t>();
+  const int8_t *biasP = getTensor(biasV)->getRawDataPointer<int8_t>();
 
-  ShapeNHWC odim(outW.dims());
-  ShapeNHWC idim(inW.dims());
+  ShapeNHWC odim(outV->dims());
+  ShapeNHWC idim(inV->dims());
+  ShapeNHWC fdim(filterV->dims());
 
   assert(idim.c % group == 0 && "Input channels must be divisible by group.");
   assert(odim.c % group == 0 && "Output channels must be divisible by group.");
@@ -136,59 +256,78 @@ void InterpreterFunction::fwdConvolutionInst_I8Impl(
   // multiplication part of the calculation.
   float matMulScale = inScale * filterScale;
 
-  // For each input in the batch:
-  for (size_t n = 0; n < idim.n; n++) {
-    // For each group of input channels:
-    for (size_t g = 0; g < group; g++) {
+  // With a channelwise-quantized filter every output channel carries its
+  // own scale and offset; per-tensor filters use the same pair everywhere.
+  bool channelwise = filterTy->isChannelwiseQuantized();
+  llvm::ArrayRef<float> filterScales;
+  llvm::ArrayRef<int32_t> filterOffsets;
+  if (channelwise) {
+    filterScales = filterTy->getChannelScales();
+    filterOffsets = filterTy->getChannelOffsets();
+  }
 
-      // For each output channel in the group:
-      for (size_t d = g * outCperG; d < (g + 1) * outCperG; d++) {
+  // Shard the (sample, output channel) pairs over the thread pool; every
+  // pair writes a disjoint slice of the output.
+  parallelFor(idim.n * odim.c, [&](size_t begin, size_t end) {
+    for (size_t item = begin; item < end; item++) {
+      size_t n = item / odim.c;
+      size_t d = item % odim.c;
+      size_t g = d / outCperG;
 
-        // For each convolution 'jump' in the input tensor:
-        ssize_t x = -ssize_t(pdim.top);
-        for (size_t ax = 0; ax < odim.h; x += stride, ax++) {
-          ssize_t y = -ssize_t(pdim.left);
-          for (size_t ay = 0; ay < odim.w; y += stride, ay++) {
+      // The quantization parameters of this output channel.
+      int32_t chFilterOffset = channelwise ? filterOffsets[d] : filterOffset;
+      float chMatMulScale =
+          channelwise ? inScale * filterScales[d] : matMulScale;
 
-            // For each element in the convolution-filter:
-            int32_t sum = 0;
-            for (size_t fx = 0; fx < filterSize; fx++) {
-              for (size_t fy = 0; fy < filterSize; fy++) {
-                ssize_t ox = x + fx;
-                ssize_t oy = y + fy;
+      // For each convolution 'jump' in the input tensor:
+      ssize_t x = -ssize_t(pdim.top);
+      for (size_t ax = 0; ax < odim.h; x += stride, ax++) {
+        ssize_t y = -ssize_t(pdim.left);
+        for (size_t ay = 0; ay < odim.w; y += stride, ay++) {
 
-                // Ignore index access below zero (this is due to padding).
-                if (ox < 0 || oy < 0 || ox >= ssize_t(idim.h) ||
-                    oy >= ssize_t(idim.w)) {
-                  continue;
-                }
-                for (size_t fd = 0; fd < inCperG; fd++) {
+          // For each element in the convolution-filter:
+          int32_t sum = 0;
+          for (size_t fx = 0; fx < filterSize; fx++) {
+            for (size_t fy = 0; fy < filterSize; fy++) {
+              ssize_t ox = x + fx;
+              ssize_t oy = y + fy;
 
-                  int32_t F = filterW.at({d, fx, fy, fd});
-                  int32_t I =
-                      inW.at({n, (size_t)ox, (size_t)oy, g * inCperG + fd});
-                  // We represent the element multiplication with offset as
-                  // (value - offset).
-                  sum += (F - filterOffset) * (I - inOffset);
-                }
+              // Ignore index access below zero (this is due to padding).
+              if (ox < 0 || oy < 0 || ox >= ssize_t(idim.h) ||
+                  oy >= ssize_t(idim.w)) {
+                continue;
+              }
+              // The filter and input channels are contiguous, so walk both
+              // rows with a flat index.
+              const int8_t *filterRow = &filterP[flatNHWC(fdim, d, fx, fy, 0)];
+              const int8_t *inRow = &inP[flatNHWC(idim, n, (size_t)ox,
+                                                  (size_t)oy, g * inCperG)];
+              for (size_t fd = 0; fd < inCperG; fd++) {
+                int32_t F = filterRow[fd];
+                int32_t I = inRow[fd];
+                // We represent the element multiplication with offset as
+                // (value - offset).
+                sum += (F - chFilterOffset) * (I - inOffset);
               }
             }
+          }
 
-            // Scale the bias to match the scale of the matrix multiplication.
-            int32_t B = std::round(float(biasW.at({d}) - biasOffset) *
-                                   (biasScale / matMulScale));
+          // Scale the bias to match the scale of the matrix multiplication.
+          int32_t B = std::round(float(biasP[d] - biasOffset) *
+                                 (biasScale / chMatMulScale));
 
-            // Add the bias:
-            sum += B;
+          // Add the bias:
+          sum += B;
 
-            // Scale the result back to the expected destination scale.
-            outW.at({n, ax, ay, d}) = quantization::clip<int32_t, int8_t>(
-                std::round(float(sum) * (matMulScale / outScale) + outOffset));
-          } // W
-        }   // H
-      }     // C
-    }       // G
-  }         // N
+          // Scale the result back to the expected destination scale.
+          outP[flatNHWC(odim, n, ax, ay, d)] =
+              quantization::clip<int32_t, int8_t>(
+                  std::round(float(sum) * (chMatMulScale / outScale) +
+                             outOffset));
+        } // W
+      }   // H
+    }     // (N, C)
+  });
 }
 
 void InterpreterFunction::fwdConvolutionInst(const ConvolutionInst *I) {
@@ -203,6 +342,16 @@ void InterpreterFunction::fwdConvolutionInst(const ConvolutionInst *I) {
     return;
   }
 
+  // With many filters per group every unrolled input patch is reused many
+  // times, so the im2col + GEMM path wins despite the extra copy.
+  ShapeNHWC odim(I->getDest()->dims());
+  if (filterSize > 1 && odim.c / group >= 8) {
+    fwdConvolutionInst_FloatIm2ColImpl(I->getSrc(), I->getDest(),
+                                       I->getFilter(), I->getBias(),
+                                       filterSize, stride, pads, group);
+    return;
+  }
+
   fwdConvolutionInst_FloatImpl(I->getSrc(), I->getDest(), I->getFilter(),
                                I->getBias(), filterSize, stride, pads, group);
 }
@@ -290,8 +439,8 @@ static void fwdPoolMax(Tensor *inW, Tensor *outW, Handle<size_t> *SXY,
                        llvm::ArrayRef<size_t> pads) {
   ShapeNHWC odim(outW->dims());
   ShapeNHWC idim(inW->dims());
-  Handle<T> inHandle = inW->getHandle<T>();
-  Handle<T> outHandle = outW->getHandle<T>();
+  const T *inP = inW->getRawDataPointer<T>();
+  T *outP = outW->getRawDataPointer<T>();
   PaddingTLBR pdim(pads);
 
   // For each input in the batch:
@@ -321,7 +470,7 @@ static void fwdPoolMax(Tensor *inW, Tensor *outW, Handle<size_t> *SXY,
                 continue;
               }
 
-              T val = inHandle.at({n, (size_t)ox, (size_t)oy, z});
+              T val = inP[flatNHWC(idim, n, (size_t)ox, (size_t)oy, z)];
               if (first || (val >= max_value)) {
                 first = false;
                 max_value = val;
@@ -331,7 +480,7 @@ static void fwdPoolMax(Tensor *inW, Tensor *outW, Handle<size_t> *SXY,
             }
           }
 
-          outHandle.at({n, ax, ay, z}) = max_value;
+          outP[flatNHWC(odim, n, ax, ay, z)] = max_value;
 
           if (SXY) {
             SXY->at({n, ax, ay, z, 0}) = maxX;
@@ -382,8 +531,8 @@ void InterpreterFunction::fwdPoolAvgInst(const PoolAvgInst *I) {
   float filterArea = filterSize * filterSize;
 
   if (I->getSrc()->getType()->isQuantizedType()) {
-    auto inW = getWeightHandle<int8_t>(I->getSrc());
-    auto outW = getWeightHandle<int8_t>(I->getDest());
+    const int8_t *inP = getTensor(I->getSrc())->getRawDataPointer<int8_t>();
+    int8_t *outP = getTensor(I->getDest())->getRawDataPointer<int8_t>();
     TensorQuantizationParams inQP{I->getSrc()->getType()->getScale(),
                                   I->getSrc()->getType()->getOffset()};
     TensorQuantizationParams outQP{I->getDest()->getType()->getScale(),
@@ -411,11 +560,12 @@ void InterpreterFunction::fwdPoolAvgInst(const PoolAvgInst *I) {
                   continue;
                 }
 
-                sum += inW.at({n, (size_t)ox, (size_t)oy, z}) - inQP.offset;
+                sum += inP[flatNHWC(idim, n, (size_t)ox, (size_t)oy, z)] -
+                       inQP.offset;
               }
             }
             // Instead of dividing by filterArea, just change scale.
-            outW.at({n, ax, ay, z}) =
+            outP[flatNHWC(odim, n, ax, ay, z)] =
                 quantization::clip<int32_t, int8_t>(std::round(
                     float(sum) * (inQP.scale / outQP.scale / filterArea) +
                     outQP.offset));
@@ -427,8 +577,8 @@ void InterpreterFunction::fwdPoolAvgInst(const PoolAvgInst *I) {
     return;
   }
 
-  auto inW = getWeightHandle(I->getSrc());
-  auto outW = getWeightHandle(I->getDest());
+  const float *inP = getTensor(I->getSrc())->getRawDataPointer<float>();
+  float *outP = getTensor(I->getDest())->getRawDataPointer<float>();
 
   // For each input in the batch:
   for (size_t n = 0; n < odim.n; n++) {
@@ -452,10 +602,10 @@ void InterpreterFunction::fwdPoolAvgInst(const PoolAvgInst *I) {
                 continue;
               }
 
-              sum += inW.at({n, (size_t)ox, (size_t)oy, z});
+              sum += inP[flatNHWC(idim, n, (size_t)ox, (size_t)oy, z)];
             }
           }
-          outW.at({n, ax, ay, z}) = sum / filterArea;
+          outP[flatNHWC(odim, n, ax, ay, z)] = sum / filterArea;
         } // W
       }   // H
     }     // C
@@ -552,6 +702,13 @@ void InterpreterFunction::fwdSigmoidInst(const SigmoidInst *I) {
   auto inW = getWeightHandle(I->getSrc());
   auto outW = getWeightHandle(I->getDest());
 
+  if (interpreterFastSigmoidTanh) {
+    for (size_t i = 0, e = outW.size(); i < e; i++) {
+      outW.raw(i) = fastSigmoidf(inW.raw(i));
+    }
+    return;
+  }
+
   for (size_t i = 0, e = outW.size(); i < e; i++) {
     float val = inW.raw(i);
     outW.raw(i) = 1 / (1 + std::exp(-val));
@@ -562,6 +719,13 @@ void InterpreterFunction::fwdTanhInst(const TanhInst *I) {
   auto inW = getWeightHandle(I->getSrc());
   auto outW = getWeightHandle(I->getDest());
 
+  if (interpreterFastSigmoidTanh) {
+    for (size_t i = 0, e = inW.size(); i < e; i++) {
+      outW.raw(i) = fastTanhf(inW.raw(i));
+    }
+    return;
+  }
+
   for (size_t i = 0, e = inW.size(); i < e; i++) {
     float val = inW.raw(i);
     outW.raw(i) = std::tanh(val);
@@ -643,6 +807,118 @@ void InterpreterFunction::fwdCrossEntropyLossGradInst(
   }
 }
 
+//===----------------------------------------------------------------------===//
+//                       Training
+//===----------------------------------------------------------------------===//
+void InterpreterFunction::fwdSGDInst(const SGDInst *I) {
+  assert(!I->getWeight()->getType()->isQuantizedType() &&
+         "Quantized SGD is not supported");
+  const float *g = getTensor(I->getGradient())->getRawDataPointer<float>();
+  float *w = getTensor(I->getWeight())->getRawDataPointer<float>();
+  float *gsum = getTensor(I->getGsum())->getRawDataPointer<float>();
+
+  float L1Decay = I->getL1Decay();
+  float L2Decay = I->getL2Decay();
+  float negLearningRate = -I->getLearningRate();
+  float momentum = I->getMomentum();
+  float invBatchSize = 1.0f / I->getBatchSize();
+
+  // The whole update - gradient scaling, weight decay and momentum - is a
+  // single pass over the buffers: every term is applied while the element
+  // is hot, instead of a chain of elementwise instructions that each
+  // stream the tensors through memory again. The branches are loop
+  // invariant, so the inner loop vectorizes.
+  parallelFor(I->getWeight()->size(), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      float gij = g[i];
+      if (L1Decay != 0.0f) {
+        gij += L1Decay * (w[i] >= 0.0f ? 1.0f : -1.0f);
+      }
+      if (L2Decay != 0.0f) {
+        gij += L2Decay * w[i];
+      }
+      float dx = negLearningRate * gij * invBatchSize;
+      if (momentum > 0.0f) {
+        dx += momentum * gsum[i];
+        gsum[i] = dx;
+      }
+      w[i] += dx;
+    }
+  });
+}
+
+void InterpreterFunction::fwdAdamInst(const AdamInst *I) {
+  assert(!I->getWeight()->getType()->isQuantizedType() &&
+         "Quantized Adam is not supported");
+  const float *g = getTensor(I->getGradient())->getRawDataPointer<float>();
+  float *w = getTensor(I->getWeight())->getRawDataPointer<float>();
+  float *m = getTensor(I->getM())->getRawDataPointer<float>();
+  float *v = getTensor(I->getV())->getRawDataPointer<float>();
+  float *step = getTensor(I->getStep())->getRawDataPointer<float>();
+
+  float L1Decay = I->getL1Decay();
+  float L2Decay = I->getL2Decay();
+  float beta1 = I->getBeta1();
+  float beta2 = I->getBeta2();
+  float epsilon = I->getEpsilon();
+  float invBatchSize = 1.0f / I->getBatchSize();
+
+  // Advance the update count; the bias correction uses the new value.
+  step[0] += 1.0f;
+  // The first-moment bias correction folds into the step size and the
+  // second-moment correction into the denominator scale, so the inner
+  // loop does not divide by the corrections per element.
+  float stepSize = I->getLearningRate() / (1.0f - std::pow(beta1, step[0]));
+  float invSqrtBiasCorr2 =
+      1.0f / std::sqrt(1.0f - std::pow(beta2, step[0]));
+
+  parallelFor(I->getWeight()->size(), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      float gij = g[i];
+      if (L1Decay != 0.0f) {
+        gij += L1Decay * (w[i] >= 0.0f ? 1.0f : -1.0f);
+      }
+      if (L2Decay != 0.0f) {
+        gij += L2Decay * w[i];
+      }
+      gij *= invBatchSize;
+      m[i] = beta1 * m[i] + (1.0f - beta1) * gij;
+      v[i] = beta2 * v[i] + (1.0f - beta2) * gij * gij;
+      w[i] -= stepSize * m[i] / (std::sqrt(v[i]) * invSqrtBiasCorr2 + epsilon);
+    }
+  });
+}
+
+void InterpreterFunction::fwdRMSPropInst(const RMSPropInst *I) {
+  assert(!I->getWeight()->getType()->isQuantizedType() &&
+         "Quantized RMSProp is not supported");
+  const float *g = getTensor(I->getGradient())->getRawDataPointer<float>();
+  float *w = getTensor(I->getWeight())->getRawDataPointer<float>();
+  float *ms = getTensor(I->getMeanSquare())->getRawDataPointer<float>();
+
+  float L1Decay = I->getL1Decay();
+  float L2Decay = I->getL2Decay();
+  float decay = I->getDecay();
+  float epsilon = I->getEpsilon();
+  float learningRate = I->getLearningRate();
+  float invBatchSize = 1.0f / I->getBatchSize();
+
+  parallelFor(I->getWeight()->size(), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      float gij = g[i];
+      if (L1Decay != 0.0f) {
+        gij += L1Decay * (w[i] >= 0.0f ? 1.0f : -1.0f);
+      }
+      if (L2Decay != 0.0f) {
+        gij += L2Decay * w[i];
+      }
+      gij *= invBatchSize;
+      ms[i] = decay * ms[i] + (1.0f - decay) * gij * gij;
+      w[i] -= learningRate * gij / (std::sqrt(ms[i]) + epsilon);
+    }
+  });
+}
+
 //===----------------------------------------------------------------------===//
 //                       Tensor shape (transpose/concat/...)
 //===----------------------------------------------------------------------===//
@@ -685,6 +961,14 @@ void InterpreterFunction::fwdSplatInst(const glow::SplatInst *I) {
     return T->getHandle<int8_t>().clear(quantization::quantize(val, destQ));
   }
 
+  if (k == ElemKind::Int16QTy) {
+    auto destTy = I->getDest()->getType();
+    TensorQuantizationParams destQ{destTy->getScale(), destTy->getOffset()};
+    float val = I->getValue();
+    return T->getHandle<int16_t>().clear(
+        quantization::quantize<int16_t>(val, destQ));
+  }
+
   llvm_unreachable("Unsupported tensor type");
 }
 
@@ -702,11 +986,51 @@ void InterpreterFunction::fwdInsertTensorInst(const glow::InsertTensorInst *I) {
   TYPED_INSERT(size_t, ElemKind::IndexTy);
   TYPED_INSERT(float, ElemKind::FloatTy);
   TYPED_INSERT(int8_t, ElemKind::Int8QTy);
+  TYPED_INSERT(int16_t, ElemKind::Int16QTy);
 #undef TYPED_INSERT
 
   llvm_unreachable("Unsupported tensor type");
 }
 
+void InterpreterFunction::fwdBroadcastInst(const glow::BroadcastInst *I) {
+  Tensor *outT = getTensor(I->getDest());
+  Tensor *inT = getTensor(I->getSrc());
+  auto destDims = outT->dims();
+  auto srcDims = inT->dims();
+  size_t numDims = destDims.size();
+  size_t elemSize = outT->getType().getElementSize();
+  char *dest = outT->getUnsafePtr();
+  const char *src = inT->getUnsafePtr();
+
+  // The source strides, with zero in the stretched dimensions, so that the
+  // repeated reads come back to the same source elements. This works for any
+  // element type, so the kernel moves raw bytes.
+  size_t srcStrides[max_tensor_dimensions];
+  size_t stride = 1;
+  for (size_t i = numDims; i > 0; i--) {
+    srcStrides[i - 1] = (srcDims[i - 1] == 1) ? 0 : stride;
+    stride *= srcDims[i - 1];
+  }
+
+  size_t counters[max_tensor_dimensions] = {0};
+  size_t numElems = outT->size();
+  size_t srcIdx = 0;
+  for (size_t e = 0; e < numElems; e++) {
+    memcpy(dest + e * elemSize, src + srcIdx * elemSize, elemSize);
+    // Advance the destination odometer and the source index together.
+    for (size_t i = numDims; i > 0; i--) {
+      size_t d = i - 1;
+      counters[d]++;
+      srcIdx += srcStrides[d];
+      if (counters[d] < destDims[d]) {
+        break;
+      }
+      counters[d] = 0;
+      srcIdx -= srcStrides[d] * destDims[d];
+    }
+  }
+}
+
 void InterpreterFunction::fwdExtractTensorInst(
     const glow::ExtractTensorInst *I) {
   Tensor *outT = getTensor(I->getDest());
@@ -722,11 +1046,21 @@ void InterpreterFunction::fwdExtractTensorInst(
   TYPED_INSERT(size_t, ElemKind::IndexTy);
   TYPED_INSERT(float, ElemKind::FloatTy);
   TYPED_INSERT(int8_t, ElemKind::Int8QTy)
+  TYPED_INSERT(int16_t, ElemKind::Int16QTy)
 #undef TYPED_INSERT
 
   llvm_unreachable("Unsupported tensor type");
 }
 
+/// \returns element \p i of the index tensor \p T, which holds either the
+/// native size_t indices or compact 32-bit ones.
+static size_t getIndexElt(Tensor *T, size_t i) {
+  if (T->getElementType() == ElemKind::Int32ITy) {
+    return (size_t)T->getHandle<int32_t>().raw(i);
+  }
+  return T->getHandle<size_t>().raw(i);
+}
+
 void InterpreterFunction::fwdGatherInst(const glow::GatherInst *I) {
   Tensor *dataT = getTensor(I->getData());
   auto &dataTy = dataT->getType();
@@ -750,7 +1084,7 @@ void InterpreterFunction::fwdGatherInst(const glow::GatherInst *I) {
 
     // For each slice (small fragment) that we copy from the source memory:
     for (size_t i = 0, end = indicesT->size(); i < end; i++) {
-      size_t slice = indicesT->getHandle<size_t>().raw(i);
+      size_t slice = getIndexElt(indicesT, i);
       std::copy(
           &dataT->getUnsafePtr()[sampleStart + dataSliceSize * slice],
           &dataT->getUnsafePtr()[sampleStart + dataSliceSize * (slice + 1)],
@@ -772,7 +1106,7 @@ void InterpreterFunction::fwdScatterAssignInst(
   // For each index, copy from the slice at that index into the location in data
   // given the offset from the indices tensor.
   for (size_t i = 0, end = indicesT->size(); i < end; i++) {
-    size_t destDataIdx = indicesT->getHandle<size_t>().raw(i);
+    size_t destDataIdx = getIndexElt(indicesT, i);
     std::copy(&slicesT->getUnsafePtr()[i * dataSliceSize],
               &slicesT->getUnsafePtr()[(i + 1) * dataSliceSize],
               &dataT->getUnsafePtr()[dataSliceSize * destDataIdx]);
@@ -912,8 +1246,38 @@ void InterpreterFunction::fwdLocalResponseNormalizationGradInst(
 //                       Arithmetic operations
 //===----------------------------------------------------------------------===//
 
+template <typename ElemTy, typename Fn>
+void InterpreterFunction::fwdElementBinaryQuantizedImpl(Value *destV,
+                                                        Value *lhsV,
+                                                        Value *rhsV, Fn &&f) {
+  auto lhsTy = lhsV->getType();
+  auto rhsTy = rhsV->getType();
+  auto destTy = destV->getType();
+
+  TensorQuantizationParams lhsQ{lhsTy->getScale(), lhsTy->getOffset()};
+  TensorQuantizationParams rhsQ{rhsTy->getScale(), rhsTy->getOffset()};
+  TensorQuantizationParams destQ{destTy->getScale(), destTy->getOffset()};
+
+  ElemTy *outP = getTensor(destV)->getRawDataPointer<ElemTy>();
+  const ElemTy *lhsP = getTensor(lhsV)->getRawDataPointer<ElemTy>();
+  const ElemTy *rhsP = getTensor(rhsV)->getRawDataPointer<ElemTy>();
+  parallelFor(getTensor(destV)->size(), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      float res = f(quantization::dequantize(lhsP[i], lhsQ),
+                    quantization::dequantize(rhsP[i], rhsQ));
+      outP[i] = quantization::quantize<ElemTy>(res, destQ);
+    }
+  });
+}
+
 void InterpreterFunction::fwdElementAddInst(const ElementAddInst *I) {
   if (getTensor(I->getLHS())->getType().isQuantizedType()) {
+    if (I->getLHS()->getType()->getElementType() == ElemKind::Int16QTy) {
+      fwdElementBinaryQuantizedImpl<int16_t>(
+          I->getDest(), I->getLHS(), I->getRHS(),
+          [](float l, float r) { return l + r; });
+      return;
+    }
     auto lhsTy = I->getLHS()->getType();
     auto rhsTy = I->getRHS()->getType();
     auto destTy = I->getDest()->getType();
@@ -926,35 +1290,49 @@ void InterpreterFunction::fwdElementAddInst(const ElementAddInst *I) {
     int32_t rhsOffset = rhsTy->getOffset();
     int32_t destOffset = destTy->getOffset();
 
-    auto outW = getWeightHandle<int8_t>(I->getDest());
-    auto lhsW = getWeightHandle<int8_t>(I->getLHS());
-    auto rhsW = getWeightHandle<int8_t>(I->getRHS());
-    for (size_t i = 0, e = outW.size(); i < e; i++) {
-      int32_t L = lhsW.raw(i);
-      int32_t R = rhsW.raw(i);
-
-      // We increase the size of the integer up to 16 bits to prevent overflow.
-      const float largeScale = float(1) / (1 << 15);
-      // Scale both sides from 8-bit to 16-bits.
-      int32_t L32 = std::round(float(L - lhsOffset) * (lhsScale / largeScale));
-      int32_t R32 = std::round(float(R - rhsOffset) * (rhsScale / largeScale));
-      int32_t sum32 = L32 + R32;
-      sum32 = std::round(float(sum32) * (largeScale / destScale) + destOffset);
-      outW.raw(i) = quantization::clip<int32_t, int8_t>(sum32);
-    }
+    int8_t *outP = getTensor(I->getDest())->getRawDataPointer<int8_t>();
+    const int8_t *lhsP = getTensor(I->getLHS())->getRawDataPointer<int8_t>();
+    const int8_t *rhsP = getTensor(I->getRHS())->getRawDataPointer<int8_t>();
+    parallelFor(I->getDest()->size(), [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        int32_t L = lhsP[i];
+        int32_t R = rhsP[i];
+
+        // We increase the size of the integer up to 16 bits to prevent
+        // overflow.
+        const float largeScale = float(1) / (1 << 15);
+        // Scale both sides from 8-bit to 16-bits.
+        int32_t L32 =
+            std::round(float(L - lhsOffset) * (lhsScale / largeScale));
+        int32_t R32 =
+            std::round(float(R - rhsOffset) * (rhsScale / largeScale));
+        int32_t sum32 = L32 + R32;
+        sum32 =
+            std::round(float(sum32) * (largeScale / destScale) + destOffset);
+        outP[i] = quantization::clip<int32_t, int8_t>(sum32);
+      }
+    });
     return;
   }
 
-  auto outW = getWeightHandle(I->getDest());
-  auto lhsW = getWeightHandle(I->getLHS());
-  auto rhsW = getWeightHandle(I->getRHS());
-  for (size_t i = 0, e = outW.size(); i < e; i++) {
-    outW.raw(i) = lhsW.raw(i) + rhsW.raw(i);
-  }
+  float *outP = getTensor(I->getDest())->getRawDataPointer<float>();
+  const float *lhsP = getTensor(I->getLHS())->getRawDataPointer<float>();
+  const float *rhsP = getTensor(I->getRHS())->getRawDataPointer<float>();
+  parallelFor(I->getDest()->size(), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      outP[i] = lhsP[i] + rhsP[i];
+    }
+  });
 }
 
 void InterpreterFunction::fwdElementSubInst(const ElementSubInst *I) {
   if (getTensor(I->getLHS())->getType().isQuantizedType()) {
+    if (I->getLHS()->getType()->getElementType() == ElemKind::Int16QTy) {
+      fwdElementBinaryQuantizedImpl<int16_t>(
+          I->getDest(), I->getLHS(), I->getRHS(),
+          [](float l, float r) { return l - r; });
+      return;
+    }
     auto destTy = I->getDest()->getType();
     auto lhsTy = I->getLHS()->getType();
     auto rhsTy = I->getRHS()->getType();
@@ -967,30 +1345,40 @@ void InterpreterFunction::fwdElementSubInst(const ElementSubInst *I) {
     int32_t lhsOffset = lhsTy->getOffset();
     int32_t rhsOffset = rhsTy->getOffset();
 
-    auto outW = getWeightHandle<int8_t>(I->getDest());
-    auto lhsW = getWeightHandle<int8_t>(I->getLHS());
-    auto rhsW = getWeightHandle<int8_t>(I->getRHS());
-    for (size_t i = 0, e = outW.size(); i < e; i++) {
-      //    s_d * (i_d - o_d) = s_l * (i_l - o_l) - s_r * (i_r - o_r)
-      // => i_d = (s_l / s_d) * (i_l - o_l) - (s_r / s_d) * (i_r - o_r) + o_d
-      float l = (lhsScale / destScale) * float(lhsW.raw(i) - lhsOffset);
-      float r = (rhsScale / destScale) * float(rhsW.raw(i) - rhsOffset);
-      int32_t q = std::round(l - r + destOffset);
-      outW.raw(i) = quantization::clip<int32_t, int8_t>(q);
-    }
+    int8_t *outP = getTensor(I->getDest())->getRawDataPointer<int8_t>();
+    const int8_t *lhsP = getTensor(I->getLHS())->getRawDataPointer<int8_t>();
+    const int8_t *rhsP = getTensor(I->getRHS())->getRawDataPointer<int8_t>();
+    parallelFor(I->getDest()->size(), [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        //    s_d * (i_d - o_d) = s_l * (i_l - o_l) - s_r * (i_r - o_r)
+        // => i_d = (s_l / s_d) * (i_l - o_l) - (s_r / s_d) * (i_r - o_r) + o_d
+        float l = (lhsScale / destScale) * float(lhsP[i] - lhsOffset);
+        float r = (rhsScale / destScale) * float(rhsP[i] - rhsOffset);
+        int32_t q = std::round(l - r + destOffset);
+        outP[i] = quantization::clip<int32_t, int8_t>(q);
+      }
+    });
     return;
   }
 
-  auto outW = getWeightHandle(I->getDest());
-  auto lhsW = getWeightHandle(I->getLHS());
-  auto rhsW = getWeightHandle(I->getRHS());
-  for (size_t i = 0, e = outW.size(); i < e; i++) {
-    outW.raw(i) = lhsW.raw(i) - rhsW.raw(i);
-  }
+  float *outP = getTensor(I->getDest())->getRawDataPointer<float>();
+  const float *lhsP = getTensor(I->getLHS())->getRawDataPointer<float>();
+  const float *rhsP = getTensor(I->getRHS())->getRawDataPointer<float>();
+  parallelFor(I->getDest()->size(), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      outP[i] = lhsP[i] - rhsP[i];
+    }
+  });
 }
 
 void InterpreterFunction::fwdElementMulInst(const ElementMulInst *I) {
   if (getTensor(I->getLHS())->getType().isQuantizedType()) {
+    if (I->getLHS()->getType()->getElementType() == ElemKind::Int16QTy) {
+      fwdElementBinaryQuantizedImpl<int16_t>(
+          I->getDest(), I->getLHS(), I->getRHS(),
+          [](float l, float r) { return l * r; });
+      return;
+    }
     auto lhsTy = I->getLHS()->getType();
     auto rhsTy = I->getRHS()->getType();
     auto destTy = I->getDest()->getType();
@@ -999,28 +1387,38 @@ void InterpreterFunction::fwdElementMulInst(const ElementMulInst *I) {
     TensorQuantizationParams rhsQ{rhsTy->getScale(), rhsTy->getOffset()};
     TensorQuantizationParams destQ{destTy->getScale(), destTy->getOffset()};
 
-    auto outW = getWeightHandle<int8_t>(I->getDest());
-    auto lhsW = getWeightHandle<int8_t>(I->getLHS());
-    auto rhsW = getWeightHandle<int8_t>(I->getRHS());
+    int8_t *outP = getTensor(I->getDest())->getRawDataPointer<int8_t>();
+    const int8_t *lhsP = getTensor(I->getLHS())->getRawDataPointer<int8_t>();
+    const int8_t *rhsP = getTensor(I->getRHS())->getRawDataPointer<int8_t>();
     float scale = lhsQ.scale * rhsQ.scale / destQ.scale;
-    for (size_t i = 0, e = outW.size(); i < e; i++) {
-      int32_t mul = (lhsW.raw(i) - lhsQ.offset) * (rhsW.raw(i) - rhsQ.offset);
-      outW.raw(i) = quantization::clip<int32_t, int8_t>(
-          std::round(mul * scale) + destQ.offset);
-    }
+    parallelFor(I->getDest()->size(), [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        int32_t mul = (lhsP[i] - lhsQ.offset) * (rhsP[i] - rhsQ.offset);
+        outP[i] = quantization::clip<int32_t, int8_t>(std::round(mul * scale) +
+                                                      destQ.offset);
+      }
+    });
     return;
   }
 
-  auto outW = getWeightHandle(I->getDest());
-  auto lhsW = getWeightHandle(I->getLHS());
-  auto rhsW = getWeightHandle(I->getRHS());
-  for (size_t i = 0, e = outW.size(); i < e; i++) {
-    outW.raw(i) = lhsW.raw(i) * rhsW.raw(i);
-  }
+  float *outP = getTensor(I->getDest())->getRawDataPointer<float>();
+  const float *lhsP = getTensor(I->getLHS())->getRawDataPointer<float>();
+  const float *rhsP = getTensor(I->getRHS())->getRawDataPointer<float>();
+  parallelFor(I->getDest()->size(), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      outP[i] = lhsP[i] * rhsP[i];
+    }
+  });
 }
 
 void InterpreterFunction::fwdElementDivInst(const ElementDivInst *I) {
   if (getTensor(I->getLHS())->getType().isQuantizedType()) {
+    if (I->getLHS()->getType()->getElementType() == ElemKind::Int16QTy) {
+      fwdElementBinaryQuantizedImpl<int16_t>(
+          I->getDest(), I->getLHS(), I->getRHS(),
+          [](float l, float r) { return l / r; });
+      return;
+    }
     auto destTy = I->getDest()->getType();
     auto lhsTy = I->getLHS()->getType();
     auto rhsTy = I->getRHS()->getType();
@@ -1033,30 +1431,40 @@ void InterpreterFunction::fwdElementDivInst(const ElementDivInst *I) {
     int32_t lhsOffset = lhsTy->getOffset();
     int32_t rhsOffset = rhsTy->getOffset();
 
-    auto outW = getWeightHandle<int8_t>(I->getDest());
-    auto lhsW = getWeightHandle<int8_t>(I->getLHS());
-    auto rhsW = getWeightHandle<int8_t>(I->getRHS());
-    for (size_t i = 0, e = outW.size(); i < e; i++) {
-      //    s_d * (i_d - o_d) = (s_l * (i_l - o_l)) / (s_r * (i_r - o_r))
-      // => i_d = (s_l * (i_l - o_l)) / (s_d * s_r * (i_r - o_r)) + o_d
-      float l = lhsScale * float(lhsW.raw(i) - lhsOffset);
-      float r = rhsScale * destScale * float(rhsW.raw(i) - rhsOffset);
-      int32_t q = std::round(l / r + destOffset);
-      outW.raw(i) = quantization::clip<int32_t, int8_t>(q);
-    }
+    int8_t *outP = getTensor(I->getDest())->getRawDataPointer<int8_t>();
+    const int8_t *lhsP = getTensor(I->getLHS())->getRawDataPointer<int8_t>();
+    const int8_t *rhsP = getTensor(I->getRHS())->getRawDataPointer<int8_t>();
+    parallelFor(I->getDest()->size(), [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        //    s_d * (i_d - o_d) = (s_l * (i_l - o_l)) / (s_r * (i_r - o_r))
+        // => i_d = (s_l * (i_l - o_l)) / (s_d * s_r * (i_r - o_r)) + o_d
+        float l = lhsScale * float(lhsP[i] - lhsOffset);
+        float r = rhsScale * destScale * float(rhsP[i] - rhsOffset);
+        int32_t q = std::round(l / r + destOffset);
+        outP[i] = quantization::clip<int32_t, int8_t>(q);
+      }
+    });
     return;
   }
 
-  auto outW = getWeightHandle(I->getDest());
-  auto lhsW = getWeightHandle(I->getLHS());
-  auto rhsW = getWeightHandle(I->getRHS());
-  for (size_t i = 0, e = outW.size(); i < e; i++) {
-    outW.raw(i) = lhsW.raw(i) / rhsW.raw(i);
-  }
+  float *outP = getTensor(I->getDest())->getRawDataPointer<float>();
+  const float *lhsP = getTensor(I->getLHS())->getRawDataPointer<float>();
+  const float *rhsP = getTensor(I->getRHS())->getRawDataPointer<float>();
+  parallelFor(I->getDest()->size(), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      outP[i] = lhsP[i] / rhsP[i];
+    }
+  });
 }
 
 void InterpreterFunction::fwdElementMaxInst(const ElementMaxInst *I) {
   if (getTensor(I->getLHS())->getType().isQuantizedType()) {
+    if (I->getLHS()->getType()->getElementType() == ElemKind::Int16QTy) {
+      fwdElementBinaryQuantizedImpl<int16_t>(
+          I->getDest(), I->getLHS(), I->getRHS(),
+          [](float l, float r) { return std::max(l, r); });
+      return;
+    }
     auto lhsTy = I->getLHS()->getType();
     auto rhsTy = I->getRHS()->getType();
     auto destTy = I->getDest()->getType();
@@ -1065,34 +1473,41 @@ void InterpreterFunction::fwdElementMaxInst(const ElementMaxInst *I) {
     TensorQuantizationParams rhsQ{rhsTy->getScale(), rhsTy->getOffset()};
     TensorQuantizationParams destQ{destTy->getScale(), destTy->getOffset()};
 
-    auto outW = getWeightHandle<int8_t>(I->getDest());
-    auto lhsW = getWeightHandle<int8_t>(I->getLHS());
-    auto rhsW = getWeightHandle<int8_t>(I->getRHS());
-    for (size_t i = 0, e = outW.size(); i < e; i++) {
-      // Convert both sides to the destination scale and perform a regular
-      // comparison.
-      int8_t L = quantization::quantize(
-          quantization::dequantize(lhsW.raw(i), lhsQ), destQ);
-      int8_t R = quantization::quantize(
-          quantization::dequantize(rhsW.raw(i), rhsQ), destQ);
-      outW.raw(i) = std::max(L, R);
-    }
+    int8_t *outP = getTensor(I->getDest())->getRawDataPointer<int8_t>();
+    const int8_t *lhsP = getTensor(I->getLHS())->getRawDataPointer<int8_t>();
+    const int8_t *rhsP = getTensor(I->getRHS())->getRawDataPointer<int8_t>();
+    parallelFor(I->getDest()->size(), [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        // Convert both sides to the destination scale and perform a regular
+        // comparison.
+        int8_t L = quantization::quantize(
+            quantization::dequantize(lhsP[i], lhsQ), destQ);
+        int8_t R = quantization::quantize(
+            quantization::dequantize(rhsP[i], rhsQ), destQ);
+        outP[i] = std::max(L, R);
+      }
+    });
     return;
   }
 
-  auto *lhs = getTensor(I->getLHS());
-  auto *rhs = getTensor(I->getRHS());
-  auto *out = getTensor(I->getDest());
-  auto outW = out->getHandle();
-  auto lhsW = lhs->getHandle();
-  auto rhsW = rhs->getHandle();
-  for (size_t i = 0, e = outW.size(); i < e; i++) {
-    outW.raw(i) = std::max(lhsW.raw(i), rhsW.raw(i));
-  }
+  float *outP = getTensor(I->getDest())->getRawDataPointer<float>();
+  const float *lhsP = getTensor(I->getLHS())->getRawDataPointer<float>();
+  const float *rhsP = getTensor(I->getRHS())->getRawDataPointer<float>();
+  parallelFor(I->getDest()->size(), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      outP[i] = std::max(lhsP[i], rhsP[i]);
+    }
+  });
 }
 
 void InterpreterFunction::fwdElementMinInst(const ElementMinInst *I) {
   if (getTensor(I->getLHS())->getType().isQuantizedType()) {
+    if (I->getLHS()->getType()->getElementType() == ElemKind::Int16QTy) {
+      fwdElementBinaryQuantizedImpl<int16_t>(
+          I->getDest(), I->getLHS(), I->getRHS(),
+          [](float l, float r) { return std::min(l, r); });
+      return;
+    }
     auto lhsTy = I->getLHS()->getType();
     auto rhsTy = I->getRHS()->getType();
     auto destTy = I->getDest()->getType();
@@ -1101,27 +1516,31 @@ void InterpreterFunction::fwdElementMinInst(const ElementMinInst *I) {
     TensorQuantizationParams rhsQ{rhsTy->getScale(), rhsTy->getOffset()};
     TensorQuantizationParams destQ{destTy->getScale(), destTy->getOffset()};
 
-    auto outW = getWeightHandle<int8_t>(I->getDest());
-    auto lhsW = getWeightHandle<int8_t>(I->getLHS());
-    auto rhsW = getWeightHandle<int8_t>(I->getRHS());
-    for (size_t i = 0, e = outW.size(); i < e; i++) {
-      // Convert both sides to the destination scale and perform a regular
-      // comparison.
-      int8_t L = quantization::quantize(
-          quantization::dequantize(lhsW.raw(i), lhsQ), destQ);
-      int8_t R = quantization::quantize(
-          quantization::dequantize(rhsW.raw(i), rhsQ), destQ);
-      outW.raw(i) = std::min(L, R);
-    }
+    int8_t *outP = getTensor(I->getDest())->getRawDataPointer<int8_t>();
+    const int8_t *lhsP = getTensor(I->getLHS())->getRawDataPointer<int8_t>();
+    const int8_t *rhsP = getTensor(I->getRHS())->getRawDataPointer<int8_t>();
+    parallelFor(I->getDest()->size(), [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        // Convert both sides to the destination scale and perform a regular
+        // comparison.
+        int8_t L = quantization::quantize(
+            quantization::dequantize(lhsP[i], lhsQ), destQ);
+        int8_t R = quantization::quantize(
+            quantization::dequantize(rhsP[i], rhsQ), destQ);
+        outP[i] = std::min(L, R);
+      }
+    });
     return;
   }
 
-  auto outW = getWeightHandle(I->getDest());
-  auto lhsW = getWeightHandle(I->getLHS());
-  auto rhsW = getWeightHandle(I->getRHS());
-  for (size_t i = 0, e = outW.size(); i < e; i++) {
-    outW.raw(i) = std::min(lhsW.raw(i), rhsW.raw(i));
-  }
+  float *outP = getTensor(I->getDest())->getRawDataPointer<float>();
+  const float *lhsP = getTensor(I->getLHS())->getRawDataPointer<float>();
+  const float *rhsP = getTensor(I->getRHS())->getRawDataPointer<float>();
+  parallelFor(I->getDest()->size(), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      outP[i] = std::min(lhsP[i], rhsP[i]);
+    }
+  });
 }
 
 // For both quantized and non-quantized CmpLTE, we set the result to 1.0/0.0.
@@ -1223,20 +1642,18 @@ void InterpreterFunction::fwdElementSelectInst(
 
 void InterpreterFunction::fwdMatMulInst(const glow::MatMulInst *I) {
   if (getTensor(I->getLHS())->getType().isQuantizedType()) {
-    auto lhs = getTensor(I->getLHS())->getHandle<int8_t>();
-    auto rhs = getTensor(I->getRHS())->getHandle<int8_t>();
-
-    auto dest = getTensor(I->getDest())->getHandle<int8_t>();
+    const int8_t *lhsP = getTensor(I->getLHS())->getRawDataPointer<int8_t>();
+    const int8_t *rhsP = getTensor(I->getRHS())->getRawDataPointer<int8_t>();
+    int8_t *destP = getTensor(I->getDest())->getRawDataPointer<int8_t>();
 
-    auto destDim = dest.dims();
-    auto lhsDim = lhs.dims();
+    auto destDim = I->getDest()->dims();
+    auto lhsDim = I->getLHS()->dims();
+    auto rhsDim = I->getRHS()->dims();
 
     auto destTy = I->getDest()->getType();
     auto lhsTy = I->getLHS()->getType();
     auto rhsTy = I->getRHS()->getType();
 
-    dest.clear(0);
-
     // For matrix multiplication, if the offset is equal to zero the scale
     // is defined as the formula (L.scale * R.scale / D.scale).
     // In here we assume that the offset for all buffers is zero.
@@ -1245,50 +1662,131 @@ void InterpreterFunction::fwdMatMulInst(const glow::MatMulInst *I) {
     int32_t rhsOffset = rhsTy->getOffset();
     int32_t destOffset = destTy->getOffset();
 
+    // A channelwise-quantized RHS (the weights of a lowered fully-connected
+    // node) carries one scale/offset per column of the result.
+    bool channelwise = rhsTy->isChannelwiseQuantized();
+    llvm::ArrayRef<float> rhsScales;
+    llvm::ArrayRef<int32_t> rhsOffsets;
+    if (channelwise) {
+      assert(rhsTy->getChannelAxis() == 1 &&
+             "Expected per-column quantization of the RHS");
+      rhsScales = rhsTy->getChannelScales();
+      rhsOffsets = rhsTy->getChannelOffsets();
+    }
+
     // For each (x,y) in the destination matrix:
     for (size_t x = 0; x < destDim[0]; x++) {
+      const int8_t *lhsRow = &lhsP[x * lhsDim[1]];
       for (size_t y = 0; y < destDim[1]; y++) {
+        int32_t colRhsOffset = channelwise ? rhsOffsets[y] : rhsOffset;
+        float colScale =
+            channelwise
+                ? lhsTy->getScale() * rhsScales[y] / destTy->getScale()
+                : scale;
 
         // Perform DOT on the row an column.
         int32_t sum = 0;
         for (size_t i = 0; i < lhsDim[1]; i++) {
-          int32_t L = lhs.at({x, i});
-          int32_t R = rhs.at({i, y});
+          int32_t L = lhsRow[i];
+          int32_t R = rhsP[i * rhsDim[1] + y];
           // We represent the element multiplication with offset as
           // (value - offset).
-          sum += (L - lhsOffset) * (R - rhsOffset);
+          sum += (L - lhsOffset) * (R - colRhsOffset);
         }
 
-        dest.at({x, y}) = quantization::clip<int32_t, int8_t>(
-            std::round(scale * sum + destOffset));
+        destP[x * destDim[1] + y] = quantization::clip<int32_t, int8_t>(
+            std::round(colScale * sum + destOffset));
       }
     }
     return;
   }
 
-  auto lhs = getWeightHandle(I->getLHS());
-  auto rhs = getWeightHandle(I->getRHS());
-  auto dest = getWeightHandle(I->getDest());
-
-  auto destDim = dest.dims();
-  auto lhsDim = lhs.dims();
-
-  dest.clear(0);
+  const float *lhsP = getTensor(I->getLHS())->getRawDataPointer<float>();
+  const float *rhsP = getTensor(I->getRHS())->getRawDataPointer<float>();
+  float *destP = getTensor(I->getDest())->getRawDataPointer<float>();
+
+  auto destDim = I->getDest()->dims();
+  auto lhsDim = I->getLHS()->dims();
+  auto rhsDim = I->getRHS()->dims();
+
+  // A CSR-encoded RHS (a pruned weight matrix) is multiplied by scattering
+  // each stored non-zero into the rows of the destination, skipping the
+  // zeros entirely.
+  auto *rhsTy = I->getRHS()->getType();
+  if (rhsTy->isSparse()) {
+    const auto *rowPtr = reinterpret_cast<const uint32_t *>(rhsP);
+    const auto *colIdx = rowPtr + rhsDim[0] + 1;
+    const auto *values =
+        reinterpret_cast<const float *>(colIdx + rhsTy->getNumNonZeros());
+    for (size_t x = 0; x < destDim[0]; x++) {
+      float *destRow = &destP[x * destDim[1]];
+      std::fill(destRow, destRow + destDim[1], 0.0f);
+      const float *lhsRow = &lhsP[x * lhsDim[1]];
+      for (size_t i = 0; i < rhsDim[0]; i++) {
+        float l = lhsRow[i];
+        for (uint32_t j = rowPtr[i], e = rowPtr[i + 1]; j < e; j++) {
+          destRow[colIdx[j]] += l * values[j];
+        }
+      }
+    }
+    return;
+  }
 
   // For each (x,y) in the destination matrix:
   for (size_t x = 0; x < destDim[0]; x++) {
+    const float *lhsRow = &lhsP[x * lhsDim[1]];
     for (size_t y = 0; y < destDim[1]; y++) {
 
       // Perform DOT on the row an column.
       float sum = 0;
       for (size_t i = 0; i < lhsDim[1]; i++) {
-        sum += lhs.at({x, i}) * rhs.at({i, y});
+        sum += lhsRow[i] * rhsP[i * rhsDim[1] + y];
       }
-      dest.at({x, y}) = sum;
+      destP[x * destDim[1] + y] = sum;
     }
   }
 }
 
+void InterpreterFunction::fwdBatchMatMulInst(const glow::BatchMatMulInst *I) {
+  assert(!getTensor(I->getLHS())->getType().isQuantizedType() &&
+         "Quantized batched matmuls are lowered to slices and matmuls");
+  const float *lhsP = getTensor(I->getLHS())->getRawDataPointer<float>();
+  const float *rhsP = getTensor(I->getRHS())->getRawDataPointer<float>();
+  float *destP = getTensor(I->getDest())->getRawDataPointer<float>();
+
+  auto destDim = I->getDest()->dims();
+  auto lhsDim = I->getLHS()->dims();
+  auto rhsDim = I->getRHS()->dims();
+
+  size_t destStride = destDim[1] * destDim[2];
+  size_t lhsStride = lhsDim[1] * lhsDim[2];
+  size_t rhsStride = rhsDim[1] * rhsDim[2];
+
+  // The batch entries are independent small matmuls, so shard them over the
+  // pool.
+  parallelFor(destDim[0], [&](size_t begin, size_t end) {
+    for (size_t n = begin; n < end; n++) {
+      const float *lhsMat = &lhsP[n * lhsStride];
+      const float *rhsMat = &rhsP[n * rhsStride];
+      float *destMat = &destP[n * destStride];
+
+      // For each (x,y) in the destination matrix:
+      for (size_t x = 0; x < destDim[1]; x++) {
+        const float *lhsRow = &lhsMat[x * lhsDim[2]];
+        for (size_t y = 0; y < destDim[2]; y++) {
+
+          // Perform DOT on the row an column.
+          float sum = 0;
+          for (size_t i = 0; i < lhsDim[2]; i++) {
+            sum += lhsRow[i] * rhsMat[i * rhsDim[2] + y];
+          }
+          destMat[x * destDim[2] + y] = sum;
+        }
+      }
+    }
+  });
+}
+
 void InterpreterFunction::fwdBatchedAddInst(const glow::BatchedAddInst *I) {
   if (getTensor(I->getBatch())->getType().isQuantizedType()) {
     auto batch = getTensor(I->getBatch())->getHandle<int8_t>();
@@ -1427,29 +1925,52 @@ void InterpreterFunction::fwdBatchedReduceAddInst(
     }
   }
 
-  // Get unowned handles of the batch and dest with these new expanded dims.
-  auto eBatch = getTensor(batch)->getUnowned(eBatchDims);
-  auto eDest = getTensor(dest)->getUnowned(eDestDims);
-  auto eBatchH = eBatch.getHandle();
-  auto eDestH = eDest.getHandle();
-  eDestH.clear();
-
-  // We can use this loop for all shapes. Use the same indices for both the
-  // batch and dest, except for setting the axis index in the dest to 0.
-  for (size_t x = 0; x < eBatchDims[0]; x++) {
-    for (size_t y = 0; y < eBatchDims[1]; y++) {
-      for (size_t z = 0; z < eBatchDims[2]; z++) {
-        for (size_t w = 0; w < eBatchDims[3]; w++) {
-          for (size_t q = 0; q < eBatchDims[4]; q++) {
-            for (size_t r = 0; r < eBatchDims[5]; r++) {
-              size_t destIndices[] = {x, y, z, w, q, r};
-              destIndices[axis] = 0;
-              eDestH.at(destIndices) += eBatchH.at({x, y, z, w, q, r});
-            }
-          }
+  // View the batch as [pre x n x post], where n is the reduced dimension.
+  // The tensors are contiguous, so the reduction can work on raw elements.
+  auto batchDims = batch->dims();
+  size_t pre = 1, post = 1;
+  for (size_t i = 0; i < axis; i++) {
+    pre *= batchDims[i];
+  }
+  for (size_t i = axis + 1; i < batchDims.size(); i++) {
+    post *= batchDims[i];
+  }
+  size_t n = batchDims[axis];
+
+  auto eBatchH = getTensor(batch)->getHandle();
+  auto eDestH = getTensor(dest)->getHandle();
+
+  if (post > 1) {
+    // The reduced dimension is not innermost: accumulate whole inner slices
+    // into the destination slice.
+    eDestH.clear();
+    for (size_t p = 0; p < pre; p++) {
+      for (size_t a = 0; a < n; a++) {
+        for (size_t q = 0; q < post; q++) {
+          eDestH.raw(p * post + q) += eBatchH.raw((p * n + a) * post + q);
         }
       }
     }
+    return;
+  }
+
+  // Reducing the innermost dimension: a single running sum is one long
+  // dependency chain with poor ILP and, in fp32, linearly accumulating
+  // rounding error. Reduce into four parallel accumulators and combine them
+  // pairwise at the end.
+  for (size_t p = 0; p < pre; p++) {
+    float s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    size_t a = 0;
+    for (; a + 4 <= n; a += 4) {
+      s0 += eBatchH.raw(p * n + a);
+      s1 += eBatchH.raw(p * n + a + 1);
+      s2 += eBatchH.raw(p * n + a + 2);
+      s3 += eBatchH.raw(p * n + a + 3);
+    }
+    for (; a < n; a++) {
+      s0 += eBatchH.raw(p * n + a);
+    }
+    eDestH.raw(p) = (s0 + s1) + (s2 + s3);
   }
 }
 
@@ -1462,7 +1983,6 @@ void InterpreterFunction::fwdSparseLengthsSumInst(
 
   out->zero();
 
-  auto IH = indices->getHandle<size_t>();
   auto LH = lengths->getHandle<size_t>();
 
   size_t segments = lengths->dims()[0];
@@ -1484,7 +2004,7 @@ void InterpreterFunction::fwdSparseLengthsSumInst(
   size_t curIdx = 0;
   for (size_t i = 0; i < segments; i++) {
     for (size_t j = 0, e = LH.raw(i); j < e; j++) {
-      size_t offsetIn = IH.raw(curIdx++) * lineSize;
+      size_t offsetIn = getIndexElt(indices, curIdx++) * lineSize;
       size_t offsetOut = i * lineSize;
       for (size_t k = 0; k < lineSize; k++)
         OH.raw(offsetOut++) += DH.raw(offsetIn++);
@@ -1495,10 +2015,10 @@ void InterpreterFunction::fwdSparseLengthsSumInst(
 //===----------------------------------------------------------------------===//
 //                Instructions used by RNN
 //===----------------------------------------------------------------------===//
-template <typename T>
+template <typename T, typename IndexTy>
 static void fwdTopK(Tensor *outW, Tensor *indW, Tensor *inW, size_t k) {
   auto values = outW->getHandle<T>();
-  auto indices = indW->getHandle<size_t>();
+  auto indices = indW->getHandle<IndexTy>();
   auto in = inW->getHandle<T>();
   size_t n = in.dims().back();
 
@@ -1532,24 +2052,144 @@ void InterpreterFunction::fwdTopKInst(const TopKInst *I) {
   auto inW = getTensor(I->getInput());
   size_t k = I->getK();
 
+  bool indices32 = indW->getElementType() == ElemKind::Int32ITy;
   if (inW->getType().isQuantizedType()) {
-    fwdTopK<int8_t>(outW, indW, inW, k);
+    if (indices32) {
+      fwdTopK<int8_t, int32_t>(outW, indW, inW, k);
+    } else {
+      fwdTopK<int8_t, size_t>(outW, indW, inW, k);
+    }
   } else {
-    fwdTopK<float>(outW, indW, inW, k);
+    if (indices32) {
+      fwdTopK<float, int32_t>(outW, indW, inW, k);
+    } else {
+      fwdTopK<float, size_t>(outW, indW, inW, k);
+    }
   }
 }
 
+void InterpreterFunction::fwdLSTMCellInst(const LSTMCellInst *I) {
+  assert(I->getInput()->getElementType() == ElemKind::FloatTy &&
+         "Only float is supported");
+  const float *inP = getTensor(I->getInput())->getRawDataPointer<float>();
+  const float *hP = getTensor(I->getH())->getRawDataPointer<float>();
+  const float *cP = getTensor(I->getC())->getRawDataPointer<float>();
+  const float *wxP = getTensor(I->getWx())->getRawDataPointer<float>();
+  const float *whP = getTensor(I->getWh())->getRawDataPointer<float>();
+  const float *bP = getTensor(I->getBias())->getRawDataPointer<float>();
+  float *newHP = getTensor(I->getNewH())->getRawDataPointer<float>();
+  float *newCP = getTensor(I->getNewC())->getRawDataPointer<float>();
+
+  size_t batch = I->getH()->dims()[0];
+  size_t hidden = I->getH()->dims()[1];
+  size_t inputSize = I->getInput()->dims()[1];
+  size_t gates = 4 * hidden;
+
+  // Each batch row computes all of its gate pre-activations into one small
+  // scratch buffer and applies the gate math from there, so the
+  // pre-activations never round-trip through memory between the small ops
+  // of the expanded form.
+  parallelFor(batch, [&](size_t begin, size_t end) {
+    std::vector<float> pre(gates);
+    for (size_t b = begin; b < end; b++) {
+      for (size_t j = 0; j < gates; j++) {
+        pre[j] = bP[j];
+      }
+      const float *x = &inP[b * inputSize];
+      for (size_t k = 0; k < inputSize; k++) {
+        const float *w = &wxP[k * gates];
+        for (size_t j = 0; j < gates; j++) {
+          pre[j] += x[k] * w[j];
+        }
+      }
+      const float *h = &hP[b * hidden];
+      for (size_t k = 0; k < hidden; k++) {
+        const float *w = &whP[k * gates];
+        for (size_t j = 0; j < gates; j++) {
+          pre[j] += h[k] * w[j];
+        }
+      }
+      // The gates are packed in the order input, forget, cell, output.
+      for (size_t j = 0; j < hidden; j++) {
+        float ig = 1 / (1 + std::exp(-pre[j]));
+        float fg = 1 / (1 + std::exp(-pre[hidden + j]));
+        float gg = std::tanh(pre[2 * hidden + j]);
+        float og = 1 / (1 + std::exp(-pre[3 * hidden + j]));
+        float c = fg * cP[b * hidden + j] + ig * gg;
+        newCP[b * hidden + j] = c;
+        newHP[b * hidden + j] = og * std::tanh(c);
+      }
+    }
+  });
+}
+
+void InterpreterFunction::fwdGRUCellInst(const GRUCellInst *I) {
+  assert(I->getInput()->getElementType() == ElemKind::FloatTy &&
+         "Only float is supported");
+  const float *inP = getTensor(I->getInput())->getRawDataPointer<float>();
+  const float *hP = getTensor(I->getH())->getRawDataPointer<float>();
+  const float *wxP = getTensor(I->getWx())->getRawDataPointer<float>();
+  const float *whP = getTensor(I->getWh())->getRawDataPointer<float>();
+  const float *bxP = getTensor(I->getBx())->getRawDataPointer<float>();
+  const float *bhP = getTensor(I->getBh())->getRawDataPointer<float>();
+  float *newHP = getTensor(I->getNewH())->getRawDataPointer<float>();
+
+  size_t batch = I->getH()->dims()[0];
+  size_t hidden = I->getH()->dims()[1];
+  size_t inputSize = I->getInput()->dims()[1];
+  size_t gates = 3 * hidden;
+
+  // The input-side and recurrent pre-activations are kept apart because the
+  // reset gate scales only the recurrent part of the candidate ('linear
+  // before reset').
+  parallelFor(batch, [&](size_t begin, size_t end) {
+    std::vector<float> xPre(gates);
+    std::vector<float> hPre(gates);
+    for (size_t b = begin; b < end; b++) {
+      for (size_t j = 0; j < gates; j++) {
+        xPre[j] = bxP[j];
+        hPre[j] = bhP[j];
+      }
+      const float *x = &inP[b * inputSize];
+      for (size_t k = 0; k < inputSize; k++) {
+        const float *w = &wxP[k * gates];
+        for (size_t j = 0; j < gates; j++) {
+          xPre[j] += x[k] * w[j];
+        }
+      }
+      const float *h = &hP[b * hidden];
+      for (size_t k = 0; k < hidden; k++) {
+        const float *w = &whP[k * gates];
+        for (size_t j = 0; j < gates; j++) {
+          hPre[j] += h[k] * w[j];
+        }
+      }
+      // The gates are packed in the order update, reset, candidate.
+      for (size_t j = 0; j < hidden; j++) {
+        float zg = 1 / (1 + std::exp(-(xPre[j] + hPre[j])));
+        float rg = 1 / (1 + std::exp(-(xPre[hidden + j] + hPre[hidden + j])));
+        float cg = std::tanh(xPre[2 * hidden + j] + rg * hPre[2 * hidden + j]);
+        newHP[b * hidden + j] = zg * h[j] + (1 - zg) * cg;
+      }
+    }
+  });
+}
+
 //===----------------------------------------------------------------------===//
 //                  Tensor allocation operations
 //===----------------------------------------------------------------------===//
 
 void InterpreterFunction::fwdAllocActivationInst(const AllocActivationInst *I) {
+  // The activation tensors are placed into a packed slab when the function
+  // is constructed, so there is nothing to allocate here.
   getOrCreateTensor(I);
 }
 
 void InterpreterFunction::fwdDeallocActivationInst(
     const DeallocActivationInst *I) {
-  deleteTensor(I->getSrc());
+  // The slab backing the activations is reused across execute() calls, so
+  // the tensor stays registered and nothing is freed here.
+  (void)I;
 }
 
 /// Prints a value of the instruction's operand.
@@ -1571,6 +2211,15 @@ void InterpreterFunction::fwdDebugPrintInst(const DebugPrintInst *I) {
 
 void InterpreterFunction::fwdQuantizationProfileInst(
     const glow::QuantizationProfileInst *I) {
+  // When sampling is enabled only every Nth execution of each profile
+  // instruction observes its tensor. The skipped executions pay nothing,
+  // which makes calibration runs over large datasets nearly as fast as
+  // plain inference while the sampled histogram keeps the same shape.
+  if (profileSampleInterval > 1 &&
+      profileSampleCounters_[I]++ % profileSampleInterval != 0) {
+    return;
+  }
+
   auto inputTensor = getWeightHandle(I->getInputTensor());
   auto currentHistogram = getWeightHandle(I->getHistogram());
   auto computationInfo = getWeightHandle(I->getComputationInfo());
@@ -1580,7 +2229,7 @@ void InterpreterFunction::fwdQuantizationProfileInst(
 
   // Update current histogram, min and max based on the inputTensor data.
   quantization::generateTensorHistogram(inputTensor, currentHistogram, min,
-                                        max);
+                                        max, profileSampleStride);
 }
 /// Quantize floating point tensor. Scale and Offset are based on return type
 /// of the instruction \p I.
@@ -1591,24 +2240,56 @@ void InterpreterFunction::fwdQuantizeInst(const glow::QuantizeInst *I) {
   TensorQuantizationParams params{destTensor->getType().getScale(),
                                   destTensor->getType().getOffset()};
 
-  auto destHandle = destTensor->getHandle<int8_t>();
-  for (size_t i = 0, e = destHandle.size(); i < e; ++i) {
-    destHandle.raw(i) = quantization::quantize(srcHandle.raw(i), params);
+  // Channelwise-quantized destinations apply the scale/offset pair of the
+  // channel that each element belongs to.
+  const auto &destTy = destTensor->getType();
+  if (destTy.isChannelwiseQuantized()) {
+    auto destHandle = destTensor->getHandle<int8_t>();
+    auto scales = destTy.getChannelScales();
+    auto offsets = destTy.getChannelOffsets();
+    size_t numChannels = scales.size();
+    size_t chunk = destTy.getSliceSize(destTy.getChannelAxis() + 1);
+    for (size_t i = 0, e = destHandle.size(); i < e; ++i) {
+      size_t c = (i / chunk) % numChannels;
+      destHandle.raw(i) = quantization::quantize(srcHandle.raw(i),
+                                                 {scales[c], offsets[c]});
+    }
+    return;
   }
+
+  if (destTy.getElementType() == ElemKind::Int16QTy) {
+    auto destH = destTensor->getHandle<int16_t>();
+    for (size_t i = 0, e = destH.size(); i < e; ++i) {
+      destH.raw(i) = quantization::quantize<int16_t>(srcHandle.raw(i), params);
+    }
+    return;
+  }
+
+  quantization::quantizeBulk(destTensor->getRawDataPointer<int8_t>(),
+                             getTensor(I->getSrc())->getRawDataPointer<float>(),
+                             destTensor->size(), params);
 }
 /// Dequantize integer tensor. Scale and Offset are based
 /// on the source tensor type.
 void InterpreterFunction::fwdDequantizeInst(const glow::DequantizeInst *I) {
   auto *srcTensor = getTensor(I->getSrc());
-  auto destHandle = getWeightHandle(I->getDest());
+  auto *destTensor = getTensor(I->getDest());
 
   TensorQuantizationParams params{srcTensor->getType().getScale(),
                                   srcTensor->getType().getOffset()};
 
-  auto srcHandle = srcTensor->getHandle<int8_t>();
-  for (size_t i = 0, e = destHandle.size(); i < e; ++i) {
-    destHandle.raw(i) = quantization::dequantize(srcHandle.raw(i), params);
+  if (srcTensor->getElementType() == ElemKind::Int16QTy) {
+    auto srcH = srcTensor->getHandle<int16_t>();
+    auto destH = destTensor->getHandle<float>();
+    for (size_t i = 0, e = destH.size(); i < e; ++i) {
+      destH.raw(i) = quantization::dequantize(srcH.raw(i), params);
+    }
+    return;
   }
+
+  quantization::dequantizeBulk(destTensor->getRawDataPointer<float>(),
+                               srcTensor->getRawDataPointer<int8_t>(),
+                               destTensor->size(), params);
 }
 
 void InterpreterFunction::fwdRescaleQuantizedInst(
@@ -1621,6 +2302,16 @@ void InterpreterFunction::fwdRescaleQuantizedInst(
   TensorQuantizationParams srcQ{srcTy->getScale(), srcTy->getOffset()};
   TensorQuantizationParams destQ{destTy->getScale(), destTy->getOffset()};
 
+  if (srcTy->getElementType() == ElemKind::Int16QTy) {
+    auto srcH = getWeightHandle<int16_t>(src);
+    auto destH = getWeightHandle<int16_t>(dest);
+    for (size_t i = 0, e = destH.size(); i < e; ++i) {
+      float val = quantization::dequantize(srcH.raw(i), srcQ);
+      destH.raw(i) = quantization::quantize<int16_t>(val, destQ);
+    }
+    return;
+  }
+
   auto srcH = getWeightHandle<int8_t>(src);
   auto destH = getWeightHandle<int8_t>(dest);
 
@@ -1631,11 +2322,14 @@ void InterpreterFunction::fwdRescaleQuantizedInst(
 }
 
 void InterpreterFunction::fwdIntLookupTableInst(const IntLookupTableInst *I) {
-  auto srcH = getWeightHandle<int8_t>(I->getSrc());
-  auto destH = getWeightHandle<int8_t>(I->getDest());
-  auto mappingH = getWeightHandle<int8_t>(I->getMapping());
-
-  for (size_t i = 0, e = destH.size(); i < e; i++) {
-    destH.raw(i) = mappingH.raw((int)srcH.raw(i) + 128);
-  }
+  const int8_t *srcP = getTensor(I->getSrc())->getRawDataPointer<int8_t>();
+  int8_t *destP = getTensor(I->getDest())->getRawDataPointer<int8_t>();
+  const int8_t *mappingP =
+      getTensor(I->getMapping())->getRawDataPointer<int8_t>();
+
+  parallelFor(I->getDest()->size(), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      destP[i] = mappingP[(int)srcP[i] + 128];
+    }
+  });
 }
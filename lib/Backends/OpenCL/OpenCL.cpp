@@ -24,14 +24,23 @@
 #include "glow/IR/Instrs.h"
 #include "glow/Quantization/Base/Base.h"
 #include "glow/Support/Debug.h"
+#include "glow/Support/Memory.h"
 
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
 using namespace glow;
 using llvm::format;
 
@@ -56,10 +65,37 @@ static llvm::cl::opt<bool> doProfile("opencl-profile",
                                      llvm::cl::desc("Profile OpenCL kernels"),
                                      llvm::cl::init(false),
                                      llvm::cl::cat(OpenCLBackendCat));
+static llvm::cl::opt<std::string> programBinaryCacheDir(
+    "opencl-program-cache-dir",
+    llvm::cl::desc("Directory where compiled OpenCL program binaries are "
+                   "cached across process runs. An empty string disables "
+                   "the cache"),
+    llvm::cl::init(""), llvm::cl::cat(OpenCLBackendCat));
+static llvm::cl::opt<bool> tuneConvKernels(
+    "opencl-tune-conv",
+    llvm::cl::desc("Benchmark a set of convolution tile configurations on "
+                   "the device and use the fastest one per convolution "
+                   "shape"),
+    llvm::cl::init(false), llvm::cl::cat(OpenCLBackendCat));
+static llvm::cl::opt<bool> fuseElementwiseKernels(
+    "opencl-fuse-elementwise",
+    llvm::cl::desc("Combine chains of elementwise instructions into single "
+                   "generated kernels to reduce the number of kernel "
+                   "launches"),
+    llvm::cl::init(true), llvm::cl::cat(OpenCLBackendCat));
 } // namespace
 
+/// Defined in lib/CodeGen/MemoryAllocator.cpp.
+extern llvm::cl::opt<unsigned> activationRegionsOpt;
+
 namespace glow {
 Backend *createOCLBackend() { return new OCLBackend(); }
+
+bool isOCLBackendAvailable() {
+  cl_uint num{0};
+  cl_int err = clGetDeviceIDs(nullptr, CL_DEVICE_TYPE_ALL, 0, nullptr, &num);
+  return err == CL_SUCCESS && num > deviceId;
+}
 } // namespace glow
 
 static void dumpCompileLog(cl_device_id dev, cl_program prog) {
@@ -80,7 +116,8 @@ static void dumpCompileLog(cl_device_id dev, cl_program prog) {
 #endif
 }
 
-OpenCLFunction::OpenCLFunction(std::unique_ptr<IRFunction> F)
+OpenCLFunction::OpenCLFunction(std::unique_ptr<IRFunction> F,
+                               unsigned deviceAffinity)
     : F_(std::move(F)) {
   cl_uint num{0};
   cl_int err = clGetDeviceIDs(nullptr, CL_DEVICE_TYPE_ALL, 0, nullptr, &num);
@@ -90,20 +127,58 @@ OpenCLFunction::OpenCLFunction(std::unique_ptr<IRFunction> F)
   cl_device_id devices[num];
   err = clGetDeviceIDs(nullptr, CL_DEVICE_TYPE_ALL, num, devices, nullptr);
   GLOW_ASSERT(err == CL_SUCCESS && "clGetDeviceIDs Failed.");
-  deviceId_ = devices[deviceId];
+  // The affinity walks round-robin over the available devices, starting at
+  // the device selected on the command line.
+  deviceId_ = devices[(deviceId + deviceAffinity) % num];
+  // Detect integrated devices that share physical memory with the host;
+  // their buffers can be backed by host allocations and accessed without
+  // any copies.
+  cl_bool unified = CL_FALSE;
+  if (clGetDeviceInfo(deviceId_, CL_DEVICE_HOST_UNIFIED_MEMORY,
+                      sizeof(unified), &unified, nullptr) == CL_SUCCESS) {
+    unifiedMemory_ = (unified == CL_TRUE);
+  }
+  // Detect half precision support. The fp16 kernel variants are only
+  // compiled in on devices that expose the cl_khr_fp16 extension.
+  char extensions[4096] = {0};
+  if (clGetDeviceInfo(deviceId_, CL_DEVICE_EXTENSIONS, sizeof(extensions) - 1,
+                      extensions, nullptr) == CL_SUCCESS) {
+    supportsFp16_ = strstr(extensions, "cl_khr_fp16") != nullptr;
+  }
   context_ = clCreateContext(nullptr, 1, &deviceId_, nullptr, nullptr, nullptr);
   GLOW_ASSERT(context_ && "clCreateContext Failed.");
-  commands_ = clCreateCommandQueue(
-      context_, deviceId_, (doProfile) ? CL_QUEUE_PROFILING_ENABLE : 0, &err);
+  // Prefer an out-of-order queue: the dependencies between commands are
+  // expressed as event wait lists, so independent branches of the
+  // instruction stream run concurrently and enqueue overhead overlaps
+  // device compute.
+  cl_command_queue_properties props =
+      ((doProfile) ? CL_QUEUE_PROFILING_ENABLE : 0) |
+      CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE;
+  commands_ = clCreateCommandQueue(context_, deviceId_, props, &err);
+  outOfOrderQueue_ = (commands_ != nullptr);
+  if (!commands_) {
+    // The device does not support out-of-order execution; fall back to an
+    // in-order queue, where the enqueue order expresses the dependencies.
+    commands_ = clCreateCommandQueue(
+        context_, deviceId_, (doProfile) ? CL_QUEUE_PROFILING_ENABLE : 0,
+        &err);
+  }
   GLOW_ASSERT(commands_ && "clCreateCommandQueue Failed.");
 
   err = CL_SUCCESS;
   /// Create the program from the source.
-  createProgram(SHADER_CODE, {}, commands_);
+  std::vector<std::string> options;
+  if (supportsFp16_) {
+    options.push_back("-DSUPPORTS_FP16");
+  }
+  createProgram(SHADER_CODE, options, commands_);
   allocateMemory();
 }
 
 OpenCLFunction::~OpenCLFunction() {
+  if (doProfile) {
+    dumpKernelProfile();
+  }
   for (auto &kv : programsCache_) {
     auto prog = kv.second;
     clReleaseProgram(prog);
@@ -122,6 +197,8 @@ static std::string getKernelName(const char *baseName, ElemKind elemTy) {
   switch (elemTy) {
   case ElemKind::FloatTy:
     return name + "W";
+  case ElemKind::Float16Ty:
+    return name + "_fp16W";
   case ElemKind::Int8QTy:
     return name + "_i8W";
   case ElemKind::Int32QTy:
@@ -155,6 +232,82 @@ cl_kernel OpenCLFunction::createKernel(const std::string &name,
   return kernel;
 }
 
+/// \returns a string identifying the \p deviceId and its driver. It is part
+/// of the on-disk program cache key, so that a driver update or a different
+/// device invalidates the cached binaries.
+static std::string getDeviceVersionString(cl_device_id deviceId) {
+  char buf[256];
+  std::string result;
+  if (clGetDeviceInfo(deviceId, CL_DEVICE_NAME, sizeof(buf), buf, nullptr) ==
+      CL_SUCCESS) {
+    result += buf;
+  }
+  result += "/";
+  if (clGetDeviceInfo(deviceId, CL_DRIVER_VERSION, sizeof(buf), buf, nullptr) ==
+      CL_SUCCESS) {
+    result += buf;
+  }
+  return result;
+}
+
+/// Try to create a program for \p deviceId from the binary cached at \p path.
+/// \returns the program, or nullptr if the file does not exist or the driver
+/// rejects the binary.
+static cl_program tryLoadProgramBinary(cl_context ctx, cl_device_id deviceId,
+                                       const std::string &path) {
+  std::ifstream fs(path, std::ios::binary);
+  if (!fs) {
+    return nullptr;
+  }
+  std::vector<unsigned char> binary(
+      (std::istreambuf_iterator<char>(fs)), std::istreambuf_iterator<char>());
+  if (binary.empty()) {
+    return nullptr;
+  }
+  size_t binarySize = binary.size();
+  const unsigned char *binaryPtr = binary.data();
+  cl_int binaryStatus = CL_SUCCESS;
+  cl_int err = CL_SUCCESS;
+  cl_program program = clCreateProgramWithBinary(
+      ctx, 1, &deviceId, &binarySize, &binaryPtr, &binaryStatus, &err);
+  if (!program || err != CL_SUCCESS || binaryStatus != CL_SUCCESS) {
+    return nullptr;
+  }
+  return program;
+}
+
+/// Save the single-device binary of \p program to \p path. Writes to a
+/// temporary file first and renames it, so that concurrent processes never
+/// observe a partially written cache entry. Failures are silently ignored;
+/// the cache is only an optimization.
+static void saveProgramBinary(cl_program program, const std::string &path) {
+  size_t binarySize = 0;
+  cl_int err = clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES,
+                                sizeof(binarySize), &binarySize, nullptr);
+  if (err != CL_SUCCESS || binarySize == 0) {
+    return;
+  }
+  std::vector<unsigned char> binary(binarySize);
+  unsigned char *binaryPtr = binary.data();
+  err = clGetProgramInfo(program, CL_PROGRAM_BINARIES, sizeof(binaryPtr),
+                         &binaryPtr, nullptr);
+  if (err != CL_SUCCESS) {
+    return;
+  }
+  std::string tmpPath = path + ".tmp";
+  {
+    std::ofstream fs(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!fs) {
+      return;
+    }
+    fs.write(reinterpret_cast<const char *>(binary.data()), binary.size());
+    if (!fs) {
+      return;
+    }
+  }
+  rename(tmpPath.c_str(), path.c_str());
+}
+
 cl_program
 OpenCLFunction::createProgram(const std::string &source,
                               const std::vector<std::string> &options,
@@ -181,6 +334,29 @@ OpenCLFunction::createProgram(const std::string &source,
   if (program) {
     return program;
   }
+  // Check the on-disk cache of compiled program binaries. The file name is a
+  // hash of the device and driver identification, the program source and the
+  // compile options, so a stale binary can never be picked up.
+  std::string cachePath;
+  if (!programBinaryCacheDir.empty()) {
+    auto hash = llvm::hash_combine(getDeviceVersionString(deviceId), source,
+                                   combinedOptions);
+    llvm::sys::fs::create_directories(programBinaryCacheDir);
+    cachePath = programBinaryCacheDir + "/" +
+                llvm::utohexstr(static_cast<uint64_t>(hash)) + ".clbin";
+    if (cl_program cached = tryLoadProgramBinary(ctx, deviceId, cachePath)) {
+      // Binaries still need a (cheap) build step to be executable.
+      err = clBuildProgram(cached, 0, nullptr, combinedOptions.c_str(), nullptr,
+                           nullptr);
+      if (err == CL_SUCCESS) {
+        program = cached;
+        return program;
+      }
+      // The binary is unusable, e.g. produced by an incompatible compiler;
+      // fall back to compiling from source.
+      clReleaseProgram(cached);
+    }
+  }
   // Create a new compiled program.
   program = clCreateProgramWithSource(context_, 1, &src, nullptr, &err);
   GLOW_ASSERT(program && "clCreateProgramWithSource Failed.");
@@ -190,6 +366,9 @@ OpenCLFunction::createProgram(const std::string &source,
     dumpCompileLog(deviceId, program);
   }
   GLOW_ASSERT(err == CL_SUCCESS && "clBuildProgram Failed.");
+  if (!cachePath.empty()) {
+    saveProgramBinary(program, cachePath);
+  }
   // Add this program to the program cache.
   return program;
 }
@@ -293,10 +472,16 @@ void OpenCLFunction::enqueueKernel(cl_command_queue commands, cl_kernel kernel,
   GLOW_ASSERT(err == CL_SUCCESS && "Error in clGetKernelInfo.");
 
   cl_event event{nullptr};
-  err = clEnqueueNDRangeKernel(commands, kernel, global.size(), nullptr,
-                               &global[0], &local[0], 0, nullptr,
-                               doProfile ? &event : nullptr);
+  err = clEnqueueNDRangeKernel(
+      commands, kernel, global.size(), nullptr, &global[0], &local[0],
+      currentWaitList_.size(),
+      currentWaitList_.empty() ? nullptr : currentWaitList_.data(),
+      (outOfOrderQueue_ || doProfile) ? &event : nullptr);
   GLOW_ASSERT(err == CL_SUCCESS && "Error in clEnqueueNDRangeKernel.");
+  if (outOfOrderQueue_) {
+    // Subsequent kernels of the same instruction wait on this one.
+    currentWaitList_.assign(1, event);
+  }
   kernelLaunches.push_back(KernelLaunch(kernel, kernelName, event));
 }
 
@@ -316,22 +501,29 @@ void OpenCLFunction::enqueueKernel(cl_command_queue commands, cl_kernel kernel,
   GLOW_ASSERT(err == CL_SUCCESS && "Error in clGetKernelInfo.");
 
   cl_event event{nullptr};
-  err = clEnqueueNDRangeKernel(commands, kernel, global.size(), nullptr,
-                               &global[0], &local[0], 0, nullptr,
-                               doProfile ? &event : nullptr);
+  err = clEnqueueNDRangeKernel(
+      commands, kernel, global.size(), nullptr, &global[0], &local[0],
+      currentWaitList_.size(),
+      currentWaitList_.empty() ? nullptr : currentWaitList_.data(),
+      (outOfOrderQueue_ || doProfile) ? &event : nullptr);
   GLOW_ASSERT(err == CL_SUCCESS && "Error in clEnqueueNDRangeKernel.");
+  if (outOfOrderQueue_) {
+    // Subsequent kernels of the same instruction wait on this one.
+    currentWaitList_.assign(1, event);
+  }
   kernelLaunches.push_back(KernelLaunch(kernel, kernelName, event));
 }
 
-/// Analyze and dump the collected profiling information about the execution of
-/// OpenCL kernels.
-static void dumpProfileInfo(const std::vector<KernelLaunch> &kernelLaunches) {
+/// Analyze the collected profiling information about the execution of OpenCL
+/// kernels, dump the per-launch timings and accumulate the per-kernel
+/// durations into \p kernelProfile.
+static void
+dumpProfileInfo(const std::vector<KernelLaunch> &kernelLaunches,
+                std::unordered_map<std::string, cl_ulong> &kernelProfile) {
   if (!doProfile)
     return;
   cl_ulong total = 0;
 
-  std::unordered_map<std::string, cl_ulong> kernelToDuration;
-
   for (auto &kl : kernelLaunches) {
     auto &event = kl.event_;
     clWaitForEvents(1, &event);
@@ -346,7 +538,7 @@ static void dumpProfileInfo(const std::vector<KernelLaunch> &kernelLaunches) {
                             &time_end, NULL);
     // Duration (in nanoseconds).
     double duration = time_end - time_start;
-    kernelToDuration[name] += duration;
+    kernelProfile[name] += duration;
     total += duration;
     llvm::outs() << "OpenCl execution time for a launch of kernel " << name
                  << format(" is: %0.3f milliseconds\n", duration / 1000000.0);
@@ -354,11 +546,21 @@ static void dumpProfileInfo(const std::vector<KernelLaunch> &kernelLaunches) {
   llvm::outs() << format(
       "OpenCl total execution time is: %0.3f milliseconds \n",
       total / 1000000.0);
+}
+
+void OpenCLFunction::dumpKernelProfile() {
+  cl_ulong total = 0;
+  for (auto &kv : kernelProfile_) {
+    total += kv.second;
+  }
+  if (!total) {
+    return;
+  }
 
   // Build a sorted list of kernel durations.
   std::vector<std::pair<cl_ulong, std::string>> sortedKernelDurations;
-  sortedKernelDurations.reserve(kernelToDuration.size());
-  for (auto kv : kernelToDuration) {
+  sortedKernelDurations.reserve(kernelProfile_.size());
+  for (auto kv : kernelProfile_) {
     sortedKernelDurations.push_back(std::make_pair(kv.second, kv.first));
   }
   std::sort(sortedKernelDurations.begin(), sortedKernelDurations.end());
@@ -385,7 +587,57 @@ static void addStringOption(std::vector<std::string> &options,
   options.push_back("-D" + name + "=" + value);
 }
 
-void OpenCLFunction::executeConvolution(const OCLConvolutionInst *CC) {
+/// The tile configurations that the convolution autotuner benchmarks. The
+/// first entry matches the untuned defaults. All entries keep the loads of
+/// the A and B tiles evenly divisible over the workgroup, which the kernel
+/// requires.
+static const ConvTileConfig convTileCandidates[] = {
+    {16, 16, 4, 4, 4, 4, 4}, {8, 8, 4, 4, 4, 4, 4},
+    {16, 8, 4, 4, 4, 4, 4},  {8, 16, 4, 4, 4, 4, 4},
+    {16, 16, 8, 4, 4, 4, 4}, {16, 16, 4, 8, 4, 4, 4},
+    {16, 16, 8, 8, 4, 4, 4}, {16, 16, 4, 4, 4, 4, 8},
+};
+
+/// Read a convolution tile configuration from \p path into \p config.
+/// \returns true on success.
+static bool loadConvTileConfig(const std::string &path,
+                               ConvTileConfig &config) {
+  std::ifstream fs(path);
+  if (!fs) {
+    return false;
+  }
+  ConvTileConfig c;
+  if (!(fs >> c.wgs0 >> c.wgs1 >> c.wptn >> c.wptm >> c.vwn >> c.vwm >>
+        c.tsk)) {
+    return false;
+  }
+  config = c;
+  return true;
+}
+
+/// Save the convolution tile configuration \p config to \p path. Uses the
+/// same temp-file-and-rename scheme as the program binary cache; failures
+/// are silently ignored.
+static void saveConvTileConfig(const std::string &path,
+                               const ConvTileConfig &config) {
+  std::string tmpPath = path + ".tmp";
+  {
+    std::ofstream fs(tmpPath, std::ios::trunc);
+    if (!fs) {
+      return;
+    }
+    fs << config.wgs0 << " " << config.wgs1 << " " << config.wptn << " "
+       << config.wptm << " " << config.vwn << " " << config.vwm << " "
+       << config.tsk << "\n";
+    if (!fs) {
+      return;
+    }
+  }
+  rename(tmpPath.c_str(), path.c_str());
+}
+
+template <class ConvInstTy>
+void OpenCLFunction::executeConvolution(const ConvInstTy *CC) {
   auto input = CC->getSrc();
   auto output = CC->getDest();
   auto bias = CC->getBias();
@@ -420,6 +672,8 @@ void OpenCLFunction::executeConvolution(const OCLConvolutionInst *CC) {
   addIntOption(options, "v_fout", fdim.n);
   // Bias multiplier.
   addStringOption(options, "v_bmul", "(float)1");
+  // Apply a relu in the kernel epilogue for the fused variant.
+  addIntOption(options, "v_relu", isa<OCLConvolutionReluInst>(CC) ? 1 : 0);
 
   // Spacial dimensions of input.
   addIntOption(options, "v_imsi_0", idim.h);
@@ -433,12 +687,14 @@ void OpenCLFunction::executeConvolution(const OCLConvolutionInst *CC) {
   addStringOption(options, "v_pad_A", "0");
   addStringOption(options, "v_pad_B", "0");
 
-  // Determine the work groups sizes along h and w.
+  // Determine the device limits on the work groups sizes.
   size_t WIS[3];
   cl_int err = clGetDeviceInfo(deviceId_, CL_DEVICE_MAX_WORK_ITEM_SIZES,
                                sizeof(WIS), &WIS, nullptr);
   GLOW_ASSERT(err == CL_SUCCESS && "Could not execute clGetDeviceInfo");
-  size_t wg_size[3];
+
+  // The default tile configuration.
+  ConvTileConfig config{16, 16, 4, 4, 4, 4, 4};
   for (int id = 0; id < 2; ++id) {
     size_t defaultVal = 16;
     // Special case on CPUs devices, where a workgroup size could be 1,
@@ -446,67 +702,335 @@ void OpenCLFunction::executeConvolution(const OCLConvolutionInst *CC) {
     if (WIS[id] < defaultVal || (id == 0 && WIS[1] < defaultVal)) {
       defaultVal = WIS[1];
     }
-    addIntOption(options, "workgroup_size_" + std::to_string(id), defaultVal);
-    wg_size[id] = defaultVal;
+    (id == 0 ? config.wgs0 : config.wgs1) = defaultVal;
   }
-  // The tile-size in dimension K.
-  // Should be tunable.
-  addStringOption(options, "TSK", "4");
-  addIntOption(options, "TSK_UNROLL", 1);
-
-  // WPTN and WPTM should be tunable.
-  size_t WPTN = 4;
-  size_t WPTM = 4;
-  // The work-per-thread in dimension N.
-  addIntOption(options, "WPTN", WPTN);
-  // The work-per-thread in dimension M.
-  addIntOption(options, "WPTM", WPTM);
-
-  // Vector width in dimensions M and M.
-  // VWN and VWM should be tunable.
-  addStringOption(options, "VWM", "4");
-  addStringOption(options, "VWN", "4");
-
-  // Generate a tailor-made convolution kernel using the provided options based
-  // on the parameters of the current convolution.
-  auto prog = createProgram(FWD_CONV_CODE, options, commands_);
-  auto kernel = createKernel("conv_forward_mem", prog);
-  setKernelArg(kernel, 0, deviceBuffer_);
-  setKernelArg<cl_uint>(kernel, 1, tensors_[input]);
-  setKernelArg<cl_uint>(kernel, 2, tensors_[weights]);
-  setKernelArg<cl_uint>(kernel, 3, tensors_[bias]);
-  setKernelArg<cl_uint>(kernel, 4, tensors_[output]);
-
-  // Compute proper parameters for global work and workgroups.
+
   int group = 1;
-  auto fw_wgs0 = wg_size[0];
-  auto fw_wgs1 = wg_size[1];
-  int fw_wptn = WPTN;
-  int fw_wptm = WPTM;
-  int fw_div_N = fw_wptn * fw_wgs0;
-  int fw_div_M = fw_wptm * fw_wgs1;
   int N_FW_ = idim.h * idim.w;
   int M_FW_ = odim.c / group;
+
+  // Compile the convolution program for a given tile configuration, set its
+  // arguments and compute the global work and workgroup geometry.
+  auto setupKernel = [&](const ConvTileConfig &cfg, std::vector<size_t> &global,
+                         std::vector<size_t> &local) -> cl_kernel {
+    auto opts = options;
+    addIntOption(opts, "workgroup_size_0", cfg.wgs0);
+    addIntOption(opts, "workgroup_size_1", cfg.wgs1);
+    // The tile-size in dimension K.
+    addIntOption(opts, "TSK", cfg.tsk);
+    addIntOption(opts, "TSK_UNROLL", 1);
+    // The work-per-thread in dimensions N and M.
+    addIntOption(opts, "WPTN", cfg.wptn);
+    addIntOption(opts, "WPTM", cfg.wptm);
+    // Vector width in dimensions M and N.
+    addIntOption(opts, "VWM", cfg.vwm);
+    addIntOption(opts, "VWN", cfg.vwn);
+
+    // Generate a tailor-made convolution kernel using the provided options
+    // based on the parameters of the current convolution.
+    auto prog = createProgram(FWD_CONV_CODE, opts, commands_);
+    auto kernel = createKernel("conv_forward_mem", prog);
+    setKernelArg(kernel, 0, deviceBuffer_);
+    setKernelArg<cl_uint>(kernel, 1, tensors_[input]);
+    setKernelArg<cl_uint>(kernel, 2, tensors_[weights]);
+    setKernelArg<cl_uint>(kernel, 3, tensors_[bias]);
+    setKernelArg<cl_uint>(kernel, 4, tensors_[output]);
+
+    // Compute proper parameters for global work and workgroups.
+    int fw_div_N = cfg.wptn * cfg.wgs0;
+    int fw_div_M = cfg.wptm * cfg.wgs1;
+
+    // Set the size of a workgroup.
+    local = {cfg.wgs0, cfg.wgs1, 1};
+
+    // Set the global work size.
+    global = {((N_FW_ - 1) / fw_div_N + 1) * cfg.wgs0,
+              ((M_FW_ - 1) / fw_div_M + 1) * cfg.wgs1,
+              idim.n * (size_t)group};
+
+    // The global work for the N dimension (which covers all pixels) should
+    // be big enough to cover all outputs for the correctness.
+    if (global[0] * fw_div_N < odim.h * odim.w) {
+      global[0] = (odim.h * odim.w - 1) / fw_div_N + 1;
+    }
+    return kernel;
+  };
+
+  if (tuneConvKernels) {
+    // The shape-describing options uniquely identify the convolution for
+    // tuning purposes.
+    std::string shapeKey;
+    for (auto &opt : options) {
+      shapeKey.append(opt).append(" ");
+    }
+    auto cached = convTileConfigs_.find(shapeKey);
+    if (cached != convTileConfigs_.end()) {
+      config = cached->second;
+    } else {
+      // The winner is persisted next to the program binary cache, keyed by
+      // the device, driver and convolution shape.
+      std::string tunePath;
+      if (!programBinaryCacheDir.empty()) {
+        auto hash =
+            llvm::hash_combine(getDeviceVersionString(deviceId_), shapeKey);
+        llvm::sys::fs::create_directories(programBinaryCacheDir);
+        tunePath = programBinaryCacheDir + "/" +
+                   llvm::utohexstr(static_cast<uint64_t>(hash)) + ".clconv";
+      }
+      if (tunePath.empty() || !loadConvTileConfig(tunePath, config)) {
+        // Benchmark the candidate configurations on the actual device and
+        // input data. The inputs of this convolution are ready once the
+        // queue is drained, and every candidate computes the same (correct)
+        // output, so the extra runs are safe.
+        clFinish(commands_);
+        bool haveBest = false;
+        double bestTime = 0;
+        for (const auto &cand : convTileCandidates) {
+          if (cand.wgs0 > WIS[0] || cand.wgs1 > WIS[1]) {
+            continue;
+          }
+          std::vector<size_t> global, local;
+          cl_kernel kernel = setupKernel(cand, global, local);
+          size_t L;
+          clGetKernelWorkGroupInfo(kernel, deviceId_,
+                                   CL_KERNEL_WORK_GROUP_SIZE, sizeof(L), &L,
+                                   nullptr);
+          if (cand.wgs0 * cand.wgs1 > L) {
+            clReleaseKernel(kernel);
+            continue;
+          }
+          // One warm-up run, then time a few runs wall-clock. This does not
+          // depend on a profiling-enabled queue.
+          err = clEnqueueNDRangeKernel(commands_, kernel, global.size(),
+                                       nullptr, &global[0], &local[0], 0,
+                                       nullptr, nullptr);
+          GLOW_ASSERT(err == CL_SUCCESS && "Error in clEnqueueNDRangeKernel.");
+          clFinish(commands_);
+          auto start = std::chrono::steady_clock::now();
+          constexpr unsigned numRuns = 3;
+          for (unsigned run = 0; run < numRuns; run++) {
+            err = clEnqueueNDRangeKernel(commands_, kernel, global.size(),
+                                         nullptr, &global[0], &local[0], 0,
+                                         nullptr, nullptr);
+            GLOW_ASSERT(err == CL_SUCCESS &&
+                        "Error in clEnqueueNDRangeKernel.");
+          }
+          clFinish(commands_);
+          double time = std::chrono::duration<double>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+          clReleaseKernel(kernel);
+          if (!haveBest || time < bestTime) {
+            haveBest = true;
+            bestTime = time;
+            config = cand;
+          }
+        }
+        if (!tunePath.empty()) {
+          saveConvTileConfig(tunePath, config);
+        }
+      }
+      convTileConfigs_[shapeKey] = config;
+    }
+  }
+
+  std::vector<size_t> global, local;
+  cl_kernel kernel = setupKernel(config, global, local);
   size_t L;
   clGetKernelWorkGroupInfo(kernel, deviceId_, CL_KERNEL_WORK_GROUP_SIZE,
                            sizeof(L), &L, nullptr);
-  GLOW_ASSERT(fw_wgs0 * fw_wgs1 <= L && "Bad workgroup size");
+  GLOW_ASSERT(config.wgs0 * config.wgs1 <= L && "Bad workgroup size");
 
-  // Set the size of a workgroup.
-  std::vector<size_t> local = {fw_wgs0, fw_wgs1, 1};
+  enqueueKernel(commands_, kernel, deviceId_, global, local, kernelLaunches_);
+}
 
-  // Set the global work size.
-  std::vector<size_t> global = {((N_FW_ - 1) / fw_div_N + 1) * fw_wgs0,
-                                ((M_FW_ - 1) / fw_div_M + 1) * fw_wgs1,
-                                idim.n * group};
+void OpenCLFunction::updateDependencies(const Instruction *next) {
+  if (!outOfOrderQueue_) {
+    return;
+  }
+  // Register the instruction whose commands were enqueued last: subsequent
+  // readers of its outputs and writers of any of its operands must wait on
+  // its last event.
+  if (pendingInstr_ && kernelLaunches_.size() > pendingLaunches_) {
+    cl_event ev = kernelLaunches_.back().event_;
+    for (unsigned i = 0, e = pendingInstr_->getNumOperands(); i < e; i++) {
+      auto op = pendingInstr_->getOperand(i);
+      auto *origin = getOrigin(op.first);
+      if (op.second == OperandKind::In) {
+        readersSinceWrite_[origin].push_back(ev);
+      } else {
+        lastWriter_[origin] = ev;
+        readersSinceWrite_[origin].clear();
+      }
+    }
+  }
+  pendingInstr_ = next;
+  pendingLaunches_ = kernelLaunches_.size();
 
-  // The global work for the N dimension (which covers all pixels) should be big
-  // enough to cover all outputs for the correctness.
-  if (global[0] * fw_div_N < odim.h * odim.w) {
-    global[0] = (odim.h * odim.w - 1) / fw_div_N + 1;
+  // Build the wait list for the commands of \p next: reads wait on the last
+  // writer, writes additionally wait on all readers since that write.
+  currentWaitList_.clear();
+  if (!next) {
+    return;
+  }
+  for (unsigned i = 0, e = next->getNumOperands(); i < e; i++) {
+    auto op = next->getOperand(i);
+    auto *origin = getOrigin(op.first);
+    auto w = lastWriter_.find(origin);
+    if (w != lastWriter_.end()) {
+      currentWaitList_.push_back(w->second);
+    }
+    if (op.second != OperandKind::In) {
+      auto r = readersSinceWrite_.find(origin);
+      if (r != readersSinceWrite_.end()) {
+        currentWaitList_.insert(currentWaitList_.end(), r->second.begin(),
+                                r->second.end());
+      }
+    }
   }
+  // The same event may guard several operands; the wait list must not
+  // mention it twice.
+  std::sort(currentWaitList_.begin(), currentWaitList_.end());
+  currentWaitList_.erase(
+      std::unique(currentWaitList_.begin(), currentWaitList_.end()),
+      currentWaitList_.end());
+}
 
-  enqueueKernel(commands_, kernel, deviceId_, global, local, kernelLaunches_);
+/// \returns true if \p I is a floating point elementwise instruction that
+/// the fused kernel generator knows how to translate into an OpenCL
+/// expression.
+static bool isFusableElementwise(const Instruction &I) {
+  if (!I.isDataParallel() || I.hasPredicate() || !I.getNumOperands()) {
+    return false;
+  }
+  if (I.getOperand(0).first->getElementType() != ElemKind::FloatTy) {
+    return false;
+  }
+  switch (I.getKind()) {
+  case Kinded::Kind::ElementAddInstKind:
+  case Kinded::Kind::ElementSubInstKind:
+  case Kinded::Kind::ElementMulInstKind:
+  case Kinded::Kind::ElementDivInstKind:
+  case Kinded::Kind::ElementMaxInstKind:
+  case Kinded::Kind::ElementMinInstKind:
+  case Kinded::Kind::ElementCmpLTEInstKind:
+  case Kinded::Kind::ElementSelectInstKind:
+  case Kinded::Kind::ElementPowInstKind:
+  case Kinded::Kind::SplatInstKind:
+  case Kinded::Kind::TanhInstKind:
+  case Kinded::Kind::SigmoidInstKind:
+    return true;
+  default:
+    return false;
+  }
+}
+
+/// \returns \p v formatted as an OpenCL float literal.
+static std::string floatLiteral(float v) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.9ef", v);
+  return buf;
+}
+
+/// Generate the source of a kernel that computes the whole elementwise
+/// instruction chain \p chain in a single launch. Every buffer operand of
+/// the chain becomes an offset argument into the unified device buffer;
+/// \p bufferArgs receives the corresponding Values in kernel-argument
+/// order. A result produced inside the chain is forwarded to its readers
+/// in a register instead of being reloaded from memory.
+static std::string
+generateFusedKernel(llvm::ArrayRef<const Instruction *> chain,
+                    std::vector<const Value *> &bufferArgs) {
+  // The temporary variable holding every value computed by the chain.
+  std::unordered_map<const Value *, std::string> temps;
+  // The offset argument index assigned to every buffer operand.
+  std::unordered_map<const Value *, unsigned> argIdx;
+  auto getArg = [&](const Value *v) {
+    auto it = argIdx.find(v);
+    if (it == argIdx.end()) {
+      it = argIdx.emplace(v, bufferArgs.size()).first;
+      bufferArgs.push_back(v);
+    }
+    return "o" + std::to_string(it->second);
+  };
+  auto getSrc = [&](const Value *v) -> std::string {
+    auto t = temps.find(v);
+    if (t != temps.end()) {
+      return t->second;
+    }
+    return "mem[" + getArg(v) + " + i]";
+  };
+
+  std::string body;
+  for (size_t n = 0, e = chain.size(); n < e; n++) {
+    const Instruction *I = chain[n];
+    // The expressions match the per-instruction kernels in kernels.cl.
+    std::string expr;
+    switch (I->getKind()) {
+    case Kinded::Kind::ElementAddInstKind:
+      expr = getSrc(I->getOperand(1).first) + " + " +
+             getSrc(I->getOperand(2).first);
+      break;
+    case Kinded::Kind::ElementSubInstKind:
+      expr = getSrc(I->getOperand(1).first) + " - " +
+             getSrc(I->getOperand(2).first);
+      break;
+    case Kinded::Kind::ElementMulInstKind:
+      expr = getSrc(I->getOperand(1).first) + " * " +
+             getSrc(I->getOperand(2).first);
+      break;
+    case Kinded::Kind::ElementDivInstKind:
+      expr = getSrc(I->getOperand(1).first) + " / " +
+             getSrc(I->getOperand(2).first);
+      break;
+    case Kinded::Kind::ElementMaxInstKind:
+      expr = "max(" + getSrc(I->getOperand(1).first) + ", " +
+             getSrc(I->getOperand(2).first) + ")";
+      break;
+    case Kinded::Kind::ElementMinInstKind:
+      expr = "min(" + getSrc(I->getOperand(1).first) + ", " +
+             getSrc(I->getOperand(2).first) + ")";
+      break;
+    case Kinded::Kind::ElementCmpLTEInstKind:
+      expr = "(" + getSrc(I->getOperand(1).first) + " <= " +
+             getSrc(I->getOperand(2).first) + ") ? 1.0f : 0.0f";
+      break;
+    case Kinded::Kind::ElementSelectInstKind:
+      expr = "(" + getSrc(I->getOperand(1).first) + " != 0.0f) ? " +
+             getSrc(I->getOperand(2).first) + " : " +
+             getSrc(I->getOperand(3).first);
+      break;
+    case Kinded::Kind::ElementPowInstKind:
+      expr = "pow(" + getSrc(I->getOperand(1).first) + ", " +
+             floatLiteral(cast<ElementPowInst>(I)->getExp()) + ")";
+      break;
+    case Kinded::Kind::SplatInstKind:
+      expr = floatLiteral(cast<SplatInst>(I)->getValue());
+      break;
+    case Kinded::Kind::TanhInstKind:
+      expr = "1 - 2 / (exp(" + getSrc(I->getOperand(1).first) + " * 2) + 1)";
+      break;
+    case Kinded::Kind::SigmoidInstKind:
+      expr = "1 / (1 + exp(-" + getSrc(I->getOperand(1).first) + "))";
+      break;
+    default:
+      GLOW_UNREACHABLE("Unexpected instruction in an elementwise chain.");
+    }
+    std::string temp = "v" + std::to_string(n);
+    body += "  float " + temp + " = " + expr + ";\n";
+    // Store the result as well: the buffer may be read by instructions
+    // outside of the chain.
+    body += "  mem[" + getArg(I->getOperand(0).first) + " + i] = " + temp +
+            ";\n";
+    temps[I->getOperand(0).first] = temp;
+  }
+
+  std::string src = "__kernel void fusedW(__global float *mem";
+  for (size_t a = 0, e = bufferArgs.size(); a < e; a++) {
+    src += ", unsigned int o" + std::to_string(a);
+  }
+  src += ") {\n  size_t i = get_global_id(0);\n" + body + "}\n";
+  return src;
 }
 
 void OpenCLFunction::execute() {
@@ -515,6 +1039,10 @@ void OpenCLFunction::execute() {
   DEBUG_GLOW(llvm::dbgs() << "Copied " << copiedToDeviceBytes
                           << " bytes to OpenCL device\n");
 
+  // The instructions that were folded into an earlier fused elementwise
+  // kernel and must not be launched on their own.
+  std::unordered_set<const Instruction *> fusedInstrs;
+
   for (const auto &I : F_->getInstrs()) {
     // The kernels are named after the name of the instruction, plus the "W"
     // suffix to prevent name colissions for functions like 'tanh' that are also
@@ -533,13 +1061,111 @@ void OpenCLFunction::execute() {
       continue;
     }
 
+    // Skip the instructions that a fused elementwise kernel has already
+    // computed.
+    if (fusedInstrs.count(&I)) {
+      continue;
+    }
+
+    // Register the previously enqueued instruction with the dependency maps
+    // and build the event wait list for this one.
+    updateDependencies(&I);
+
+    // Combine a chain of consecutive elementwise instructions into a single
+    // generated kernel. The IR optimizer clusters such chains together, and
+    // a single launch per chain saves the per-kernel launch overhead that
+    // dominates for small tensors.
+    if (fuseElementwiseKernels && isFusableElementwise(I)) {
+      size_t numElements = I.getOperand(0).first->getType()->size();
+      std::vector<const Instruction *> chain{&I};
+      const auto &instrs = F_->getInstrs();
+      for (auto it = std::next(I.getIterator()), e = instrs.end(); it != e;
+           ++it) {
+        const Instruction &N = *it;
+        // Memory allocation instructions are NOPs and do not break a chain.
+        if (isa<AllocActivationInst>(N) || isa<DeallocActivationInst>(N) ||
+            isa<TensorViewInst>(N)) {
+          continue;
+        }
+        if (!isFusableElementwise(N) ||
+            N.getOperand(0).first->getType()->size() != numElements) {
+          break;
+        }
+        chain.push_back(&N);
+      }
+      if (chain.size() > 1) {
+        if (outOfOrderQueue_) {
+          // The wait list built by updateDependencies() covers only the
+          // chain head; extend it with the dependencies of the folded
+          // instructions.
+          for (size_t n = 1, ce = chain.size(); n < ce; n++) {
+            for (unsigned i = 0, oe = chain[n]->getNumOperands(); i < oe;
+                 i++) {
+              auto op = chain[n]->getOperand(i);
+              auto *origin = getOrigin(op.first);
+              auto w = lastWriter_.find(origin);
+              if (w != lastWriter_.end()) {
+                currentWaitList_.push_back(w->second);
+              }
+              if (op.second != OperandKind::In) {
+                auto r = readersSinceWrite_.find(origin);
+                if (r != readersSinceWrite_.end()) {
+                  currentWaitList_.insert(currentWaitList_.end(),
+                                          r->second.begin(), r->second.end());
+                }
+              }
+            }
+          }
+          std::sort(currentWaitList_.begin(), currentWaitList_.end());
+          currentWaitList_.erase(
+              std::unique(currentWaitList_.begin(), currentWaitList_.end()),
+              currentWaitList_.end());
+        }
+
+        std::vector<const Value *> bufferArgs;
+        std::string source = generateFusedKernel(chain, bufferArgs);
+        cl_program program = createProgram(source, {}, commands_);
+        cl_kernel kernel = createKernel("fusedW", program);
+        setKernelArg(kernel, 0, deviceBuffer_);
+        for (size_t a = 0, e = bufferArgs.size(); a < e; a++) {
+          setKernelArg<cl_uint>(kernel, a + 1, tensors_[bufferArgs[a]]);
+        }
+        enqueueKernel(commands_, kernel, deviceId_, {numElements},
+                      kernelLaunches_);
+
+        if (outOfOrderQueue_ && kernelLaunches_.size() > pendingLaunches_) {
+          // Register the folded instructions' reads and writes with the
+          // fused kernel's event. The chain head is registered through the
+          // regular pendingInstr_ mechanism.
+          cl_event ev = kernelLaunches_.back().event_;
+          for (size_t n = 1, ce = chain.size(); n < ce; n++) {
+            for (unsigned i = 0, oe = chain[n]->getNumOperands(); i < oe;
+                 i++) {
+              auto op = chain[n]->getOperand(i);
+              auto *origin = getOrigin(op.first);
+              if (op.second == OperandKind::In) {
+                readersSinceWrite_[origin].push_back(ev);
+              } else {
+                lastWriter_[origin] = ev;
+                readersSinceWrite_[origin].clear();
+              }
+            }
+          }
+        }
+        fusedInstrs.insert(chain.begin() + 1, chain.end());
+        continue;
+      }
+    }
+
     // Element-wise operations, except the copy instruction.
     if (I.isDataParallel() && !isa<CopyInst>(I)) {
       // Figure out how many element-wise elements are there to process:
       size_t global;
       if (I.isDataParallel()) {
         global = I.getOperand(0).first->getType()->size();
-        if (global % 16 == 0) {
+        if (elemTy == ElemKind::Float16Ty) {
+          // Only scalar fp16 kernel variants are defined.
+        } else if (global % 16 == 0) {
           // Start less kernels and let each kernel do more work using vector
           // instructions.
           global /= 16;
@@ -788,8 +1414,10 @@ void OpenCLFunction::execute() {
       GLOW_ASSERT(err == CL_SUCCESS && "Could not execute clGetDeviceInfo");
       // True if the tiled matrix multiplication kernel can be used. This is
       // only possible if the device allows workgroups with sizes which are at
-      // least as big as a tile.
-      bool useTiledMatMul = (WIS[0] >= TILE_DIM && WIS[1] >= TILE_DIM);
+      // least as big as a tile. There is no tiled variant for half
+      // precision.
+      bool useTiledMatMul = elemTy == ElemKind::FloatTy &&
+                            (WIS[0] >= TILE_DIM && WIS[1] >= TILE_DIM);
       cl_kernel kernel =
           createKernel(useTiledMatMul ? "matmul_tiled" : kernelName);
       setKernelArg(kernel, 0, deviceBuffer_);
@@ -855,6 +1483,11 @@ void OpenCLFunction::execute() {
       continue;
     }
 
+    if (auto *CC = dyn_cast<OCLConvolutionReluInst>(&I)) {
+      executeConvolution(CC);
+      continue;
+    }
+
     if (auto *CC = dyn_cast<ConvolutionInst>(&I)) {
       // This is a naive implementation that parallelizes using three dims:
       // the X and the Y in the output filter.
@@ -1019,6 +1652,34 @@ void OpenCLFunction::execute() {
       continue;
     }
 
+    if (auto *BI = dyn_cast<BroadcastInst>(&I)) {
+      // The kernel reads the source with stride zero in the stretched
+      // dimensions, so no tiled intermediate tensor is written.
+      GLOW_ASSERT(BI->getDest()->getType()->dims().size() <= 4 &&
+                  "This code supports only 4 and lower dimensional broadcasts");
+
+      cl_kernel kernel = createKernel(kernelName);
+      setKernelArg(kernel, 0, deviceBuffer_);
+      auto numArgs = setKernelArgsForBuffers(kernel, I, 1, tensors_);
+
+      // Pad the shapes to 4 dimensions with trailing ones.
+      std::vector<size_t> odim_vec = BI->getDest()->getType()->dims();
+      std::vector<size_t> idim_vec = BI->getSrc()->getType()->dims();
+      while (odim_vec.size() < 4) {
+        odim_vec.push_back(1);
+        idim_vec.push_back(1);
+      }
+
+      auto odim = ShapeNHWC(odim_vec);
+      auto idim = ShapeNHWC(idim_vec);
+
+      setKernelArg(kernel, numArgs + 1, odim);
+      setKernelArg(kernel, numArgs + 2, idim);
+      enqueueKernel(commands_, kernel, deviceId_, {odim.n, odim.h},
+                    kernelLaunches_);
+      continue;
+    }
+
     if (auto *TR = dyn_cast<TransposeInst>(&I)) {
       // This is a naive implementation that parallelizes using one dimension,
       // the N (batch size).
@@ -1065,10 +1726,12 @@ void OpenCLFunction::execute() {
       size_t srcOff = tensors_[src];
       size_t sizeInBytes = dest->getSizeInBytes();
       cl_event event{nullptr};
-      cl_int err = clEnqueueCopyBuffer(commands_, deviceBuffer_, deviceBuffer_,
-                                       srcOff, destOff, sizeInBytes, 0, nullptr,
-                                       doProfile ? &event : nullptr);
-      if (doProfile) {
+      cl_int err = clEnqueueCopyBuffer(
+          commands_, deviceBuffer_, deviceBuffer_, srcOff, destOff,
+          sizeInBytes, currentWaitList_.size(),
+          currentWaitList_.empty() ? nullptr : currentWaitList_.data(),
+          (outOfOrderQueue_ || doProfile) ? &event : nullptr);
+      if (outOfOrderQueue_ || doProfile) {
         kernelLaunches_.emplace_back(KernelLaunch("copy", event));
       }
       GLOW_ASSERT(err == CL_SUCCESS && "Error in clEnqueueCopyBuffer.");
@@ -1111,6 +1774,28 @@ void OpenCLFunction::execute() {
       continue;
     }
 
+    if (auto *TK = dyn_cast<TopKInst>(&I)) {
+      cl_kernel kernel = createKernel(kernelName);
+      setKernelArg(kernel, 0, deviceBuffer_);
+      auto numArgs = setKernelArgsForBuffers(kernel, I, 1, tensors_);
+
+      auto *input = TK->getInput();
+      assert(input->getElementType() == ElemKind::FloatTy &&
+             "At the moment only floats are supported");
+
+      // The size of the last dimension, which the selection runs over.
+      size_t n = input->dims().back();
+      // The number of independent rows to select from.
+      size_t numRows = input->size() / n;
+
+      setKernelArg<cl_uint>(kernel, numArgs + 1, TK->getK());
+      setKernelArg<cl_uint>(kernel, numArgs + 2, n);
+
+      // Parallelize on the rows of the input.
+      enqueueKernel(commands_, kernel, deviceId_, {numRows}, kernelLaunches_);
+      continue;
+    }
+
     if (auto *SAI = dyn_cast<ScatterAssignInst>(&I)) {
       cl_kernel kernel = createKernel(kernelName);
       setKernelArg(kernel, 0, deviceBuffer_);
@@ -1191,13 +1876,25 @@ void OpenCLFunction::execute() {
   clFinish(commands_);
 
   // Output profiling information.
-  dumpProfileInfo(kernelLaunches_);
+  dumpProfileInfo(kernelLaunches_, kernelProfile_);
 
   for (auto &kl : kernelLaunches_) {
-    clReleaseKernel(kl.kernel_);
+    if (kl.kernel_) {
+      clReleaseKernel(kl.kernel_);
+    }
+    if (kl.event_) {
+      clReleaseEvent(kl.event_);
+    }
   }
   kernelLaunches_.clear();
 
+  // The dependency state only describes the commands of this run.
+  lastWriter_.clear();
+  readersSinceWrite_.clear();
+  currentWaitList_.clear();
+  pendingInstr_ = nullptr;
+  pendingLaunches_ = 0;
+
   auto copiedFromDeviceBytes = copyMutableWeightsFromDevice();
   (void)copiedFromDeviceBytes;
   DEBUG_GLOW(llvm::dbgs() << "Copied " << copiedFromDeviceBytes
@@ -1217,6 +1914,21 @@ size_t OpenCLFunction::copyValueToDevice(const Value *v, void *buf) {
       buf = T->getUnsafePtr();
     }
     size_t valueOffset = it->second;
+    if (hostBuffer_) {
+      // The buffer is host-resident: map the region (a no-op copy-wise on a
+      // unified-memory device) and fill it with a plain memcpy.
+      cl_int err = CL_SUCCESS;
+      void *mapped = clEnqueueMapBuffer(
+          commands_, deviceBuffer_, /* blocking_map */ CL_TRUE, CL_MAP_WRITE,
+          valueOffset, sizeInBytes, /* num_events_in_wait_list */ 0,
+          /* event_list */ nullptr, /* event */ nullptr, &err);
+      GLOW_ASSERT(mapped && err == CL_SUCCESS && "clEnqueueMapBuffer Failed.");
+      memcpy(mapped, buf, sizeInBytes);
+      err = clEnqueueUnmapMemObject(commands_, deviceBuffer_, mapped, 0,
+                                    nullptr, nullptr);
+      GLOW_ASSERT(err == CL_SUCCESS && "clEnqueueUnmapMemObject Failed.");
+      return sizeInBytes;
+    }
     cl_event event{nullptr};
     cl_int err = clEnqueueWriteBuffer(
         commands_, deviceBuffer_, /* blocking_read */ CL_FALSE, valueOffset,
@@ -1244,6 +1956,21 @@ size_t OpenCLFunction::copyValueFromDevice(const Value *v, void *buf) {
       buf = T->getUnsafePtr();
     }
     size_t valueOffset = it->second;
+    if (hostBuffer_) {
+      // The buffer is host-resident: map the region (a no-op copy-wise on a
+      // unified-memory device) and read it with a plain memcpy.
+      cl_int err = CL_SUCCESS;
+      void *mapped = clEnqueueMapBuffer(
+          commands_, deviceBuffer_, /* blocking_map */ CL_TRUE, CL_MAP_READ,
+          valueOffset, sizeInBytes, /* num_events_in_wait_list */ 0,
+          /* event_list */ nullptr, /* event */ nullptr, &err);
+      GLOW_ASSERT(mapped && err == CL_SUCCESS && "clEnqueueMapBuffer Failed.");
+      memcpy(buf, mapped, sizeInBytes);
+      err = clEnqueueUnmapMemObject(commands_, deviceBuffer_, mapped, 0,
+                                    nullptr, nullptr);
+      GLOW_ASSERT(err == CL_SUCCESS && "clEnqueueUnmapMemObject Failed.");
+      return sizeInBytes;
+    }
     cl_event event{nullptr};
     cl_int err = clEnqueueReadBuffer(
         commands_, deviceBuffer_, /* blocking_read */ CL_FALSE, valueOffset,
@@ -1269,6 +1996,9 @@ size_t OpenCLFunction::copyMutableWeightsToDevice() {
     if (auto *W = dyn_cast<WeightVar>(it.first)) {
       if (W->getMutability() == WeightVar::MutabilityKind::Constant)
         continue;
+      // Skip the weights whose old device contents are never read.
+      if (!mutableInputs_.count(W))
+        continue;
     }
     copiedBytes += copyValueToDevice(it.first);
   }
@@ -1305,6 +2035,9 @@ size_t OpenCLFunction::copyMutableWeightsFromDevice() {
     if (auto *W = dyn_cast<WeightVar>(it.first)) {
       if (W->getMutability() == WeightVar::MutabilityKind::Constant)
         continue;
+      // Skip the weights that this function never writes.
+      if (!mutableOutputs_.count(W))
+        continue;
     }
     copiedBytes += copyValueFromDevice(it.first);
   }
@@ -1313,8 +2046,11 @@ size_t OpenCLFunction::copyMutableWeightsFromDevice() {
 }
 
 void OpenCLFunction::allocateMemory() {
-  /// The allocator assigns device memory addresses to the buffers.
-  MemoryAllocator allocator(0xFFFFFFFF);
+  /// The allocators assign device memory addresses to the buffers. The
+  /// weights and the activations live in separate arenas, so that the
+  /// activation arena can be replicated for pipelined execution.
+  MemoryAllocator weightsAllocator(0xFFFFFFFF);
+  MemoryAllocator activationsAllocator(0xFFFFFFFF);
   for (auto &v : F_->getGraph()->getParent()->getVars()) {
     auto *w = F_->getWeightForNode(v);
     assert(!externalTensors_.count(w) && "The tensor is already registered");
@@ -1325,63 +2061,117 @@ void OpenCLFunction::allocateMemory() {
   for (auto it : externalTensors_) {
     Tensor *T = it.second;
     size_t sizeInBytes = T->getType().getSizeInBytes();
-    size_t addr = allocator.allocate(sizeInBytes);
+    size_t addr = weightsAllocator.allocate(sizeInBytes);
     // Associate the new buffer with the weight value.
     tensors_[it.first] = addr;
   }
 
-  // Assign device-space addresses to the activations.
+  // Classify the mutable weights by how the instruction stream uses them,
+  // so that every run only uploads the actual inputs and only downloads the
+  // actual outputs. A weight whose first use is a direct @out operand is
+  // entirely overwritten before it is read and needs no upload; accesses
+  // through tensorviews are conservatively treated as reads.
+  std::unordered_set<const Value *> seenWeights;
+  for (const auto &I : F_->getInstrs()) {
+    for (unsigned i = 0, e = I.getNumOperands(); i < e; i++) {
+      auto op = I.getOperand(i);
+      auto *W = llvm::dyn_cast<WeightVar>(getOrigin(op.first));
+      if (!W || W->getMutability() == WeightVar::MutabilityKind::Constant) {
+        continue;
+      }
+      if (op.second != OperandKind::In) {
+        mutableOutputs_.insert(W);
+      }
+      if (seenWeights.insert(W).second &&
+          !(op.first == W && op.second == OperandKind::Out)) {
+        mutableInputs_.insert(W);
+      }
+    }
+  }
+
+  // Assign addresses to the activations, relative to the base of the
+  // activation region for now.
   for (const auto &I : F_->getInstrs()) {
     if (auto *A = llvm::dyn_cast<AllocActivationInst>(&I)) {
       auto numBytes = I.getSizeInBytes();
-      size_t addr = allocator.allocate(numBytes);
+      size_t addr = activationsAllocator.allocate(numBytes);
       assert(!tensors_.count(A) && "Allocation already made!");
       tensors_[A] = addr;
+      activationValues_.push_back(A);
       continue;
     }
 
     if (auto *TV = llvm::dyn_cast<TensorViewInst>(&I)) {
-      // Calculate and store the length of the offset into the base, using the
-      // source of the tensorview.
+      // Calculate the offset of the view from the start of its origin
+      // allocation, in elements, accumulated over the whole tensorview chain.
       assert(!tensors_.count(TV) && "Allocation already made!");
-      size_t offsetLength = TV->getOffsets().empty() ? 0 : TV->getOffsets()[0];
-      auto *tvSource = TV->getSrc();
-      if (tvSource->dims().size() > 1) {
-        for (size_t i = 1; i < tvSource->dims().size(); ++i) {
-          offsetLength *= tvSource->dims()[i];
-        }
-      }
-      assert(tensors_.count(tvSource) && "Source allocation not found!");
+      size_t offsetLength = calculateTensorViewOffset(TV);
+      auto *tvOrigin = getOrigin(TV);
+      assert(tensors_.count(tvOrigin) && "Origin allocation not found!");
       tensors_[TV] =
-          tensors_[tvSource] + (offsetLength * TV->getType()->getElementSize());
+          tensors_[tvOrigin] + (offsetLength * TV->getType()->getElementSize());
+      if (llvm::isa<AllocActivationInst>(tvOrigin)) {
+        activationValues_.push_back(TV);
+      }
       continue;
     }
 
     if (auto *D = llvm::dyn_cast<DeallocActivationInst>(&I)) {
       auto *A = D->getAlloc();
       assert(tensors_.count(A) && "Invalid deallocation!");
-      allocator.deallocate(tensors_[A]);
+      activationsAllocator.deallocate(tensors_[A]);
       continue;
     }
   }
 
-  // Ask the memory allocator how much memory is required. What was the high
-  // watermark for this program.
-  size_t requiredSpace = allocator.getMaxMemoryUsage();
-  DEBUG_GLOW(llvm::dbgs() << "Allocated GPU memory block of size: "
-                          << requiredSpace << "\n");
+  numActivationRegions_ = activationRegionsOpt < 1 ? 1 : activationRegionsOpt;
+  activationsStride_ = activationsAllocator.getRegionStride();
 
-  // Release the memory from the previous run.
-  if (deviceBuffer_) {
-    freeDeviceBuffer(deviceBuffer_);
-    deviceBuffer_ = nullptr;
+  // The activations live above the weights, one copy of the arena per
+  // region. Rebase the relative activation addresses onto region zero.
+  size_t activationsBase =
+      alignedSize(weightsAllocator.getMaxMemoryUsage(), TensorAlignment);
+  for (auto *v : activationValues_) {
+    tensors_[v] += activationsBase;
   }
 
+  // The required device memory covers the weights and all of the activation
+  // regions.
+  size_t requiredSpace =
+      activationsBase + numActivationRegions_ * activationsStride_;
+  DEBUG_GLOW(llvm::dbgs() << "Allocated GPU memory block of size: "
+                          << requiredSpace << "\n");
+
+  // The arena is allocated once here at function init and persists until the
+  // function is destroyed, so the runs only pay the I/O transfers and never
+  // the buffer creation or the first-touch costs.
+  assert(!deviceBuffer_ && "The device buffer is allocated at init only");
   deviceBuffer_ = allocDeviceBuffer(requiredSpace);
   // Copy constant weights just once.
   copyConstantWeightsToDevice();
 }
 
+unsigned OpenCLFunction::getNumActivationRegions() const {
+  return numActivationRegions_;
+}
+
+void OpenCLFunction::setActivationRegion(unsigned region) {
+  assert(region < numActivationRegions_ && "Invalid activation region");
+  if (region == activationRegion_) {
+    return;
+  }
+  // Shift the device addresses of the activations into the new region. The
+  // regions have identical layouts, so the whole arena moves by a multiple
+  // of the stride. The weights are shared by all of the regions and do not
+  // move.
+  size_t oldBase = activationRegion_ * activationsStride_;
+  size_t newBase = region * activationsStride_;
+  for (auto *v : activationValues_) {
+    tensors_[v] = tensors_[v] - oldBase + newBase;
+  }
+  activationRegion_ = region;
+}
+
 Tensor *OpenCLFunction::getTensor(const Value *v) const {
   assert(externalTensors_.count(v) && "Unknown value");
   auto ie = externalTensors_.find(v);
@@ -1392,15 +2182,53 @@ cl_mem OpenCLFunction::allocDeviceBuffer(size_t size) {
   const size_t alignment = 128;
   // Always allocate buffers properly aligned to hold values of any type.
   size = alignedSize(size, alignment);
+  if (unifiedMemory_) {
+    // On a unified-memory device, back the buffer with a page-aligned host
+    // allocation. Mapping it is then zero-copy and the per-run weight
+    // transfers reduce to plain memcpys instead of DMA round-trips.
+    hostBuffer_ = pageAlignedAlloc(size);
+    hostBufferSize_ = size;
+    auto buf = clCreateBuffer(context_, CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR,
+                              size, hostBuffer_, nullptr);
+    if (buf) {
+      return buf;
+    }
+    // The driver refused the host pointer; fall back to device memory.
+    pageAlignedFree(hostBuffer_, hostBufferSize_);
+    hostBuffer_ = nullptr;
+    hostBufferSize_ = 0;
+  }
   auto buf =
       clCreateBuffer(context_, CL_MEM_READ_WRITE, size, nullptr, nullptr);
   GLOW_ASSERT(buf && "Allocation failed!");
   return buf;
 }
 
-void OpenCLFunction::freeDeviceBuffer(cl_mem buf) { clReleaseMemObject(buf); }
+void OpenCLFunction::freeDeviceBuffer(cl_mem buf) {
+  clReleaseMemObject(buf);
+  if (hostBuffer_) {
+    pageAlignedFree(hostBuffer_, hostBufferSize_);
+    hostBuffer_ = nullptr;
+    hostBufferSize_ = 0;
+  }
+}
+
+bool OCLBackend::shouldLower(const Node *N) const {
+  // Broadcasts are executed as a single strided-read kernel instead of a
+  // chain of materialized tiles. Only the float kernel exists.
+  if (N->getKind() == Kinded::Kind::BroadcastNodeKind &&
+      N->getNthResult(0).getType()->getElementType() == ElemKind::FloatTy)
+    return false;
+  return true;
+}
 
 std::unique_ptr<CompiledFunction>
 OCLBackend::compile(std::unique_ptr<IRFunction> IR) const {
   return llvm::make_unique<OpenCLFunction>(std::move(IR));
 }
+
+std::unique_ptr<CompiledFunction>
+OCLBackend::compile(std::unique_ptr<IRFunction> IR,
+                    unsigned deviceAffinity) const {
+  return llvm::make_unique<OpenCLFunction>(std::move(IR), deviceAffinity);
+}
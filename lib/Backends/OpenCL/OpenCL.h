@@ -24,6 +24,7 @@
 #include "llvm/ADT/ArrayRef.h"
 
 #include <unordered_map>
+#include <unordered_set>
 
 #if defined(__APPLE__) || defined(__MACOSX)
 #include "OpenCL/opencl.h"
@@ -34,6 +35,7 @@
 namespace glow {
 
 class IRFunction;
+class Instruction;
 class OCLConvolutionInst;
 class Value;
 
@@ -55,6 +57,19 @@ struct KernelLaunch {
       : kernel_(nullptr), name_(name), event_(event) {}
 };
 
+/// A tile configuration for the parameterized forward convolution kernel.
+/// See kernels_fwd_conv.cl for the meaning of the parameters.
+struct ConvTileConfig {
+  /// Workgroup sizes along the two spacial dimensions.
+  size_t wgs0, wgs1;
+  /// Work-per-thread in dimensions N and M.
+  size_t wptn, wptm;
+  /// Vector widths in dimensions N and M.
+  size_t vwn, vwm;
+  /// The tile size in dimension K.
+  size_t tsk;
+};
+
 /// A Glow IR function compiled for OpenCL.
 class OpenCLFunction final : public CompiledFunction {
   /// A helper type representing a key for the program's cache.
@@ -85,20 +100,92 @@ class OpenCLFunction final : public CompiledFunction {
   /// different set of macro definitions) and/or for a different device and
   /// would result in different programs.
   std::unordered_map<ProgramKey, cl_program, ProgramKeyHash> programsCache_;
-  /// A pointer to the on-device memory buffer.
+  /// A pointer to the on-device memory buffer that holds the weights and the
+  /// activation arena. Allocated once at function init and reused by every
+  /// run, so the per-run cost is only the input/output transfers.
   cl_mem deviceBuffer_{0};
+  /// Whether the device shares physical memory with the host
+  /// (CL_DEVICE_HOST_UNIFIED_MEMORY), e.g. an integrated GPU.
+  bool unifiedMemory_{false};
+  /// Whether the device supports half precision arithmetic (cl_khr_fp16).
+  /// The fp16 kernel variants are only compiled in when it does.
+  bool supportsFp16_{false};
+  /// On unified-memory devices, the page-aligned host allocation that backs
+  /// \ref deviceBuffer_ via CL_MEM_USE_HOST_PTR. Mapping the buffer is then
+  /// zero-copy, so weight transfers reduce to plain memcpys.
+  void *hostBuffer_{nullptr};
+  /// The size of \ref hostBuffer_ in bytes.
+  size_t hostBufferSize_{0};
   /// Information about kernel launches.
   std::vector<KernelLaunch> kernelLaunches_;
+  /// The values whose device addresses lie in the activation region: the
+  /// alloc activations and the tensorviews into them. Their entries in \ref
+  /// tensors_ are shifted when another region is selected.
+  std::vector<const Value *> activationValues_;
+  /// The stride between the activation regions in the device buffer.
+  size_t activationsStride_{0};
+  /// The number of independent activation regions in the device buffer.
+  unsigned numActivationRegions_{1};
+  /// The region that execute() runs against.
+  unsigned activationRegion_{0};
+  /// The mutable weights that the instruction stream reads before it writes
+  /// them: the per-run inputs, which must be uploaded before every
+  /// execution. The other mutable weights keep their device contents from
+  /// the previous run or are overwritten before being read.
+  std::unordered_set<const Value *> mutableInputs_;
+  /// The mutable weights that the instruction stream writes: the per-run
+  /// outputs, which must be downloaded after every execution.
+  std::unordered_set<const Value *> mutableOutputs_;
+  /// The winning convolution tile configuration per convolution shape, as
+  /// selected by the autotuner. The key is the set of shape-describing
+  /// compile options of the convolution kernel.
+  std::unordered_map<std::string, ConvTileConfig> convTileConfigs_;
+  /// The device execution time accumulated by every kernel across all
+  /// executions, in nanoseconds. Only filled when profiling is enabled.
+  std::unordered_map<std::string, cl_ulong> kernelProfile_;
+  /// Whether \ref commands_ is an out-of-order queue. On such a queue the
+  /// enqueue order does not express the dependencies between commands, so
+  /// they are expressed explicitly as cl_event wait lists; independent
+  /// branches of the instruction stream then run concurrently.
+  bool outOfOrderQueue_{false};
+  /// The wait list for the commands of the instruction that is currently
+  /// being enqueued. Kernels enqueued for the same instruction are chained
+  /// through this list.
+  std::vector<cl_event> currentWaitList_;
+  /// The event of the last enqueued command that writes every buffer, keyed
+  /// by the buffer's origin allocation.
+  std::unordered_map<const Value *, cl_event> lastWriter_;
+  /// The events of the commands that read every buffer since it was last
+  /// written. A subsequent write must wait on all of them.
+  std::unordered_map<const Value *, std::vector<cl_event>> readersSinceWrite_;
+  /// The instruction whose commands were enqueued last and still need to be
+  /// registered with the dependency maps above.
+  const Instruction *pendingInstr_{nullptr};
+  /// The size of \ref kernelLaunches_ when \ref pendingInstr_ started
+  /// enqueueing, used to tell whether it produced any commands.
+  size_t pendingLaunches_{0};
 
 public:
-  /// Ctor.
-  explicit OpenCLFunction(std::unique_ptr<IRFunction> F);
+  /// Ctor. \p deviceAffinity selects the OpenCL device relative to the one
+  /// given on the command line, so that the partitions of a FunctionDAG can
+  /// be spread over several devices.
+  explicit OpenCLFunction(std::unique_ptr<IRFunction> F,
+                          unsigned deviceAffinity = 0);
 
   /// @name CompiledFunction interface
   ///@{
   ~OpenCLFunction() override;
 
   void execute() override;
+
+  unsigned getNumActivationRegions() const override;
+
+  void setActivationRegion(unsigned region) override;
+
+  /// Prints the per-kernel device execution times accumulated by the
+  /// executions so far, as measured through cl_event profiling. A no-op
+  /// unless the function runs with -opencl-profile.
+  void dumpKernelProfile() override;
   ///@}
 
 private:
@@ -128,8 +215,10 @@ private:
   void fillBuffer(cl_mem buffer, size_t start, size_t len, float value,
                   ElemKind elemKind);
 
-  /// Execution a convolution instruction which uses NCHW format.
-  void executeConvolution(const OCLConvolutionInst *CC);
+  /// Execution a convolution instruction which uses NCHW format. \p ConvInstTy
+  /// is either OCLConvolutionInst or OCLConvolutionReluInst; the latter
+  /// applies a relu in the kernel epilogue.
+  template <class ConvInstTy> void executeConvolution(const ConvInstTy *CC);
   /// Allocate a device buffer of required \p size.
   cl_mem allocDeviceBuffer(size_t size);
   /// Frees a device buffer.
@@ -155,6 +244,12 @@ private:
                      llvm::ArrayRef<size_t> local,
                      std::vector<KernelLaunch> &kernelLaunches);
 
+  /// Register the event of the instruction whose commands were enqueued
+  /// last with the dependency maps, and build the event wait list for the
+  /// commands of \p next. Pass nullptr for \p next to only flush the
+  /// registration. A no-op on an in-order queue.
+  void updateDependencies(const Instruction *next);
+
   /// \returns a pointer to the tensor that is saved under \p v.
   Tensor *getTensor(const Value *v) const;
 };
@@ -173,8 +268,14 @@ public:
   std::unique_ptr<CompiledFunction>
   compile(std::unique_ptr<IRFunction> IR) const override;
 
+  std::unique_ptr<CompiledFunction>
+  compile(std::unique_ptr<IRFunction> IR,
+          unsigned deviceAffinity) const override;
+
   bool transformPostLowering(Function *F, CompilationMode mode) const override;
 
+  bool shouldLower(const Node *N) const override;
+
   bool isOpSupported(Kinded::Kind opKind, ElemKind elementTy) const override {
     // Check quantization support.
     if (elementTy == ElemKind::Int8QTy) {
@@ -197,6 +298,14 @@ public:
         return false;
       }
     }
+    // The OpenCL kernels have no int16 variants.
+    if (elementTy == ElemKind::Int16QTy) {
+      return false;
+    }
+    // The index-consuming OpenCL kernels read size_t indices only.
+    if (elementTy == ElemKind::Int32ITy) {
+      return false;
+    }
     return true;
   };
   /// @}
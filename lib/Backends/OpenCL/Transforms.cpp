@@ -35,6 +35,31 @@ bool OCLBackend::transformPostLowering(Function *F,
 
   bool changed = false;
   for (auto &node : F->getNodes()) {
+    // After lowering a relu is a Max against a zero splat. When its input is
+    // a non-quantized convolution that feeds nothing else, fold the relu into
+    // the convolution kernel, which applies it while the result is still in
+    // registers. This match must come before the plain convolution conversion
+    // below, or the convolution is converted on its own first.
+    if (auto *MX = dyn_cast<MaxNode>(&node)) {
+      auto *splat = dyn_cast<SplatNode>(MX->getLHS());
+      NodeValue other = MX->getRHS();
+      if (!splat) {
+        splat = dyn_cast<SplatNode>(MX->getRHS());
+        other = MX->getLHS();
+      }
+      if (!splat || splat->getValue() != 0.0f) {
+        continue;
+      }
+      auto *CN = dyn_cast<ConvolutionNode>(other);
+      if (!CN || CN->getNumUsers() != 1 ||
+          CN->getInput()->getType(0)->isQuantizedType()) {
+        continue;
+      }
+      auto *NR = convertConvToNCHWConv<OCLConvolutionReluNode>(CN, F);
+      NodeValue(&node, 0).replaceAllUsesOfWith(NR);
+      changed = true;
+      continue;
+    }
     if (auto *CN = dyn_cast<ConvolutionNode>(&node)) {
       if (CN->getInput()->getType(0)->isQuantizedType()) {
         continue;
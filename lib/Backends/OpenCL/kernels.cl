@@ -1175,6 +1175,29 @@ DEFINE_OPENCL_TRANSPOSE_KERNEL(transpose, float)
 
 #undef DEFINE_OPENCL_TRANSPOSE_KERNEL
 
+__kernel void broadcastK(__global float *dest, __global float *src,
+                         ShapeNHWC odim, ShapeNHWC idim) {
+  size_t d0 = get_global_id(0);
+  size_t d1 = get_global_id(1);
+  // Read the source with index zero in the stretched dimensions, so the
+  // repetition happens while writing the destination and no tiled
+  // intermediate is materialized.
+  size_t s0 = (idim.n == 1) ? 0 : d0;
+  size_t s1 = (idim.h == 1) ? 0 : d1;
+  for (size_t d2 = 0; d2 < odim.w; d2++) {
+    size_t s2 = (idim.w == 1) ? 0 : d2;
+    for (size_t d3 = 0; d3 < odim.c; d3++) {
+      size_t s3 = (idim.c == 1) ? 0 : d3;
+      dest[getNHWC(odim, d0, d1, d2, d3)] = src[getNHWC(idim, s0, s1, s2, s3)];
+    }
+  }
+}
+
+__kernel void broadcastW(__global void *mem, cl_uint32_t dest,
+                         cl_uint32_t src, ShapeNHWC odim, ShapeNHWC idim) {
+  broadcastK(&mem[dest], &mem[src], odim, idim);
+}
+
 __kernel void inserttensorK(__global float *dest, __global float *src,
                             ShapeNHWC odim, ShapeNHWC idim, ShapeNHWC offset,
                             cl_uint32_t count, cl_uint32_t axis) {
@@ -1291,4 +1314,230 @@ __kernel void scatterassignW(__global void *mem,
    scatterassignK(&mem[data], &mem[indices], &mem[slices], sliceSize);
 }
 
+__kernel void topkK(__global float *values, __global cl_uint64_t *indices,
+                    __global float *input, __global void *scratch,
+                    cl_uint32_t k, cl_uint32_t n) {
+  size_t row = get_global_id(0);
+  __global float *in = &input[row * n];
+  __global float *outV = &values[row * k];
+  __global cl_uint64_t *outI = &indices[row * k];
+
+  // Select the k largest elements of the row by repeated scans. Ties pick
+  // the smaller index first, like the CPU implementations.
+  for (cl_uint32_t i = 0; i < k; i++) {
+    float maxVal = 0;
+    cl_uint64_t maxIdx = n;
+    for (cl_uint32_t j = 0; j < n; j++) {
+      // Skip the elements that were already selected.
+      bool taken = false;
+      for (cl_uint32_t t = 0; t < i; t++) {
+        taken |= (outI[t] == j);
+      }
+      if (taken) {
+        continue;
+      }
+      if (maxIdx == n || in[j] > maxVal) {
+        maxVal = in[j];
+        maxIdx = j;
+      }
+    }
+    outV[i] = maxVal;
+    outI[i] = maxIdx;
+  }
+}
+
+__kernel void topkW(__global void *mem, cl_uint32_t values,
+                    cl_uint32_t indices, cl_uint32_t input,
+                    cl_uint32_t scratch, cl_uint32_t k, cl_uint32_t n) {
+  topkK(&mem[values], &mem[indices], &mem[input], &mem[scratch], k, n);
+}
+
+/// The half precision kernel variants. They are only compiled in on devices
+/// that expose the cl_khr_fp16 extension; the backend passes SUPPORTS_FP16
+/// when it detects the extension.
+#ifdef SUPPORTS_FP16
+#pragma OPENCL EXTENSION cl_khr_fp16 : enable
+
+/// Macro to define a kernel for data-parallel binary operations on half
+/// precision operands. Only the scalar variant is defined: the kernels are
+/// bound by memory traffic, which loading half elements already cuts in two.
+/// \p name the name of the kernel
+/// \p body the operation to be performed
+#define DEFINE_OPENCL_BINARY_DATA_PARALLEL_KERNEL_FP16(name, body)             \
+  __kernel void name##_fp16K(__global half *dest, __global half *lhs,          \
+                             __global half *rhs) {                             \
+    size_t i = get_global_id(0);                                               \
+    half LHS = lhs[i];                                                         \
+    half RHS = rhs[i];                                                         \
+    dest[i] = body;                                                            \
+  }                                                                            \
+  __kernel void name##_fp16W(__global void *mem, cl_uint32_t dest,             \
+                             cl_uint32_t lhs, cl_uint32_t rhs) {               \
+    name##_fp16K(&mem[dest], &mem[lhs], &mem[rhs]);                            \
+  }
+
+/// Macro to define a kernel for data-parallel unary operations on half
+/// precision operands.
+/// \p name the name of the kernel
+/// \p body the operation to be performed
+#define DEFINE_OPENCL_UNARY_DATA_PARALLEL_KERNEL_FP16(name, body)              \
+  __kernel void name##_fp16K(__global half *dest, __global half *src) {        \
+    size_t i = get_global_id(0);                                               \
+    half SRC = src[i];                                                         \
+    dest[i] = body;                                                            \
+  }                                                                            \
+  __kernel void name##_fp16W(__global void *mem, cl_uint32_t dest,             \
+                             cl_uint32_t src) {                                \
+    name##_fp16K(&mem[dest], &mem[src]);                                       \
+  }
+
+/// Macro to define a kernel for data-parallel operations on a half precision
+/// operand and a float immediate operand, which is converted to half inside
+/// the kernel.
+/// \p name the name of the kernel
+/// \p body the operation to be performed
+#define DEFINE_OPENCL_BINARY_DATA_PARALLEL_KERNEL_WITH_IMM_OPERAND_FP16(       \
+    name, body)                                                                \
+  __kernel void name##_fp16K(__global half *dest, __global half *src,          \
+                             half val) {                                       \
+    size_t i = get_global_id(0);                                               \
+    half SRC = src[i];                                                         \
+    dest[i] = body;                                                            \
+  }                                                                            \
+  __kernel void name##_fp16W(__global void *mem, cl_uint32_t dest,             \
+                             cl_uint32_t src, float val) {                     \
+    name##_fp16K(&mem[dest], &mem[src], (half)val);                            \
+  }
+
+DEFINE_OPENCL_BINARY_DATA_PARALLEL_KERNEL_FP16(elementadd, LHS + RHS)
+DEFINE_OPENCL_BINARY_DATA_PARALLEL_KERNEL_FP16(elementsub, LHS - RHS)
+DEFINE_OPENCL_BINARY_DATA_PARALLEL_KERNEL_FP16(elementmul, LHS * RHS)
+DEFINE_OPENCL_BINARY_DATA_PARALLEL_KERNEL_FP16(elementdiv, LHS / RHS)
+DEFINE_OPENCL_BINARY_DATA_PARALLEL_KERNEL_FP16(elementmax, max(LHS, RHS))
+DEFINE_OPENCL_BINARY_DATA_PARALLEL_KERNEL_FP16(elementmin, min(LHS, RHS))
+
+DEFINE_OPENCL_UNARY_DATA_PARALLEL_KERNEL_FP16(tanh,
+                                              1 - 2 / (exp(SRC * 2) + 1))
+DEFINE_OPENCL_UNARY_DATA_PARALLEL_KERNEL_FP16(sigmoid, 1 / (1 + exp(-SRC)))
+
+DEFINE_OPENCL_BINARY_DATA_PARALLEL_KERNEL_WITH_IMM_OPERAND_FP16(
+    elementpow, pow(SRC, val))
+
+#undef DEFINE_OPENCL_BINARY_DATA_PARALLEL_KERNEL_WITH_IMM_OPERAND_FP16
+#undef DEFINE_OPENCL_UNARY_DATA_PARALLEL_KERNEL_FP16
+#undef DEFINE_OPENCL_BINARY_DATA_PARALLEL_KERNEL_FP16
+
+__kernel void splat_fp16K(__global half *dest, float val) {
+  size_t i = get_global_id(0);
+  dest[i] = (half)val;
+}
+
+__kernel void splat_fp16W(__global void *mem, cl_uint32_t dest, float val) {
+  splat_fp16K(&mem[dest], val);
+}
+
+__kernel void elementcmplte_fp16K(__global half *dest, __global half *LHS,
+                                  __global half *RHS) {
+  size_t i = get_global_id(0);
+  dest[i] = (LHS[i] <= RHS[i]) ? (half)1.0f : (half)0.0f;
+}
+
+__kernel void elementcmplte_fp16W(__global void *mem, cl_uint32_t dest,
+                                  cl_uint32_t LHS, cl_uint32_t RHS) {
+  elementcmplte_fp16K(&mem[dest], &mem[LHS], &mem[RHS]);
+}
+
+__kernel void elementselect_fp16K(__global half *dest, __global half *cond,
+                                  __global half *lhs, __global half *rhs) {
+  size_t i = get_global_id(0);
+  dest[i] = (cond[i] != (half)0.0f) ? lhs[i] : rhs[i];
+}
+
+__kernel void elementselect_fp16W(__global void *mem, cl_uint32_t dest,
+                                  cl_uint32_t cond, cl_uint32_t lhs,
+                                  cl_uint32_t rhs) {
+  elementselect_fp16K(&mem[dest], &mem[cond], &mem[lhs], &mem[rhs]);
+}
+
+__kernel void matmul_fp16K(__global half *dest, __global half *lhs,
+                           __global half *rhs, ShapeNHWC ddim, ShapeNHWC ldim,
+                           ShapeNHWC rdim) {
+  // For each X in the destination matrix.
+  size_t x = get_global_id(0);
+  // For each Y in the destination matrix.
+  size_t y = get_global_id(1);
+
+  // Perform DOT on the row an column. Accumulate in single precision to
+  // keep the accuracy of long dot products.
+  float sum = 0;
+  for (size_t i = 0; i < ldim.h; i++) {
+    sum += convert_float(lhs[getNHWC(ldim, x, i, 0, 0)]) *
+           convert_float(rhs[getNHWC(rdim, i, y, 0, 0)]);
+  }
+
+  dest[getNHWC(ddim, x, y, 0, 0)] = (half)sum;
+}
+
+__kernel void matmul_fp16W(__global void *mem, cl_uint32_t dest,
+                           cl_uint32_t lhs, cl_uint32_t rhs, ShapeNHWC ddim,
+                           ShapeNHWC ldim, ShapeNHWC rdim) {
+  matmul_fp16K(&mem[dest], &mem[lhs], &mem[rhs], ddim, ldim, rdim);
+}
+
+__kernel void convolution_fp16K(__global half *dest, __global half *src,
+                                __global half *filter, __global half *bias,
+                                cl_uint32_t filterSize, cl_uint32_t stride,
+                                PaddingTLBR pads, ShapeNHWC odim,
+                                ShapeNHWC idim, ShapeNHWC filterDim) {
+  size_t ax = get_global_id(0);
+  size_t ay = get_global_id(1);
+  size_t d = get_global_id(2);
+
+  typedef int ssize_t;
+  // For each convolution 'jump' in the input tensor:
+  ssize_t x = -(ssize_t)pads.top + ax * stride;
+  ssize_t y = -(ssize_t)pads.left + ay * stride;
+
+  // For each input in the batch:
+  for (size_t n = 0; n < idim.n; n++) {
+
+    // For each element in the convolution-filter. Accumulate in single
+    // precision to keep the accuracy of deep filters.
+    float sum = 0;
+    for (size_t fx = 0; fx < filterSize; fx++) {
+      for (size_t fy = 0; fy < filterSize; fy++) {
+        ssize_t ox = x + fx;
+        ssize_t oy = y + fy;
+
+        // Ignore index access below zero (this is due to padding).
+        if (ox < 0 || oy < 0 || ox >= (ssize_t)idim.h ||
+            oy >= (ssize_t)idim.w) {
+          continue;
+        }
+
+        for (size_t fd = 0; fd < idim.c; fd++) {
+          sum += convert_float(filter[getNHWC(filterDim, d, fx, fy, fd)]) *
+                 convert_float(src[getNHWC(idim, n, (size_t)ox, (size_t)oy,
+                                           fd)]);
+        }
+      }
+    }
+
+    sum += convert_float(bias[d]);
+    dest[getNHWC(odim, n, ax, ay, d)] = (half)sum;
+  } // N
+}
+
+__kernel void convolution_fp16W(__global void *mem, cl_uint32_t dest,
+                                cl_uint32_t src, cl_uint32_t filter,
+                                cl_uint32_t bias, cl_uint32_t filterSize,
+                                cl_uint32_t stride, PaddingTLBR pads,
+                                ShapeNHWC odim, ShapeNHWC idim,
+                                ShapeNHWC filterDim) {
+  convolution_fp16K(&mem[dest], &mem[src], &mem[filter], &mem[bias],
+                    filterSize, stride, pads, odim, idim, filterDim);
+}
+
+#endif // SUPPORTS_FP16
+
 )";
@@ -312,8 +312,14 @@ conv_forward_mem(__global void *mem, unsigned im_in_offset, unsigned wg_offset,
       for (int_tp wn = 0; wn < WPTN; ++wn) {
         int_tp globalCol = offN + tidn + wn * RTSN;
         if (globalRow < MM && globalCol < NN) {
-          Cptr[globalRow * NN + globalCol] =
+          Dtype result =
               ((Dtype *)(&(Creg[wm][wn / VWN])))[wn % VWN] + v_bmul * biasval;
+#if v_relu
+          // The fused activation is free here compared to a separate
+          // elementwise pass over the output in global memory.
+          result = fmax(result, (Dtype)0);
+#endif
+          Cptr[globalRow * NN + globalCol] = result;
         }
       }
     }
@@ -18,6 +18,11 @@
 #include "glow/Base/Tensor.h"
 #include "glow/Support/Support.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
 using namespace glow;
 
 #if WITH_PNG
@@ -60,8 +65,13 @@ std::tuple<size_t, size_t, bool> glow::getPngInfo(const char *filename) {
   return std::make_tuple(height, width, isGray);
 }
 
-bool glow::readPngImage(Tensor *T, const char *filename,
-                        std::pair<float, float> range) {
+/// Decodes the png file \p filename into \p rows, an array of \p height
+/// heap-allocated rows of 8-bit samples that the caller frees with
+/// freePngRows(). On success \returns false and sets the image geometry in
+/// \p width, \p height and \p numChannels, and whether the rows carry an
+/// alpha channel in \p hasAlpha.
+static bool decodePng(const char *filename, png_bytep **rows, size_t *width,
+                      size_t *height, size_t *numChannels, bool *hasAlpha) {
   unsigned char header[8];
   // open file and test for it being a png.
   FILE *fp = fopen(filename, "rb");
@@ -99,20 +109,20 @@ bool glow::readPngImage(Tensor *T, const char *filename,
   png_set_sig_bytes(png_ptr, 8);
   png_read_info(png_ptr, info_ptr);
 
-  size_t width = png_get_image_width(png_ptr, info_ptr);
-  size_t height = png_get_image_height(png_ptr, info_ptr);
+  *width = png_get_image_width(png_ptr, info_ptr);
+  *height = png_get_image_height(png_ptr, info_ptr);
   int color_type = png_get_color_type(png_ptr, info_ptr);
   int bit_depth = png_get_bit_depth(png_ptr, info_ptr);
 
   const bool isGray = color_type == PNG_COLOR_TYPE_GRAY;
-  const size_t numChannels = isGray ? 1 : 3;
+  *numChannels = isGray ? 1 : 3;
 
   (void)bit_depth;
   assert(bit_depth == 8 && "Invalid image");
   assert((color_type == PNG_COLOR_TYPE_RGB_ALPHA ||
           color_type == PNG_COLOR_TYPE_RGB || isGray) &&
          "Invalid image");
-  bool hasAlpha = (color_type == PNG_COLOR_TYPE_RGB_ALPHA);
+  *hasAlpha = (color_type == PNG_COLOR_TYPE_RGB_ALPHA);
 
   int number_of_passes = png_set_interlace_handling(png_ptr);
   (void)number_of_passes;
@@ -125,42 +135,112 @@ bool glow::readPngImage(Tensor *T, const char *filename,
     return true;
   }
 
-  auto *row_pointers = (png_bytep *)malloc(sizeof(png_bytep) * height);
-  for (size_t y = 0; y < height; y++) {
+  auto *row_pointers = (png_bytep *)malloc(sizeof(png_bytep) * *height);
+  for (size_t y = 0; y < *height; y++) {
     row_pointers[y] = (png_byte *)malloc(png_get_rowbytes(png_ptr, info_ptr));
   }
 
   png_read_image(png_ptr, row_pointers);
   png_read_end(png_ptr, info_ptr);
 
-  T->reset(ElemKind::FloatTy, {width, height, numChannels});
-  auto H = T->getHandle<>();
+  png_destroy_read_struct(&png_ptr, &info_ptr, (png_infopp)NULL);
+  fclose(fp);
 
-  float scale = ((range.second - range.first) / 255.0);
-  float bias = range.first;
+  *rows = row_pointers;
+  return false;
+}
 
+/// Frees the \p height rows \p rows allocated by decodePng().
+static void freePngRows(png_bytep *rows, size_t height) {
+  for (size_t y = 0; y < height; y++) {
+    free(rows[y]);
+  }
+  free(rows);
+}
+
+/// Translates the decoded rows \p rows through the 256-entry table \p lut
+/// into the tensor data \p data, dropping the alpha channel when the rows
+/// carry one. Without alpha the row layout matches the tensor layout, so
+/// the translation is a single dense, vectorizable pass per row.
+template <typename ElemTy>
+static void translateRows(png_bytep *rows, const ElemTy *lut, ElemTy *data,
+                          size_t width, size_t height, size_t numChannels,
+                          bool hasAlpha) {
   for (size_t row_n = 0; row_n < height; row_n++) {
-    png_byte *row = row_pointers[row_n];
-    for (size_t col_n = 0; col_n < width; col_n++) {
-      png_byte *ptr =
-          &(row[col_n * (hasAlpha ? (numChannels + 1) : numChannels)]);
-      if (isGray) {
-        H.at({row_n, col_n, 0}) = float(ptr[0]) * scale + bias;
-      } else {
-        H.at({row_n, col_n, 0}) = float(ptr[0]) * scale + bias;
-        H.at({row_n, col_n, 1}) = float(ptr[1]) * scale + bias;
-        H.at({row_n, col_n, 2}) = float(ptr[2]) * scale + bias;
+    const png_byte *src = rows[row_n];
+    ElemTy *dst = data + row_n * height * numChannels;
+    if (!hasAlpha) {
+      for (size_t i = 0, e = width * numChannels; i < e; i++) {
+        dst[i] = lut[src[i]];
+      }
+    } else {
+      for (size_t col_n = 0; col_n < width; col_n++) {
+        for (size_t z = 0; z < numChannels; z++) {
+          dst[col_n * numChannels + z] =
+              lut[src[col_n * (numChannels + 1) + z]];
+        }
       }
     }
   }
+}
 
-  for (size_t y = 0; y < height; y++) {
-    free(row_pointers[y]);
+bool glow::readPngImage(Tensor *T, const char *filename,
+                        std::pair<float, float> range) {
+  png_bytep *rows;
+  size_t width, height, numChannels;
+  bool hasAlpha;
+  if (decodePng(filename, &rows, &width, &height, &numChannels, &hasAlpha)) {
+    return true;
   }
-  free(row_pointers);
-  png_destroy_read_struct(&png_ptr, &info_ptr, (png_infopp)NULL);
-  fclose(fp);
 
+  T->reset(ElemKind::FloatTy, {width, height, numChannels});
+
+  // Normalization maps each of the 256 possible sample values to one float,
+  // so it is one table lookup per pixel instead of a multiply-add.
+  float scale = ((range.second - range.first) / 255.0);
+  float bias = range.first;
+  float lut[256];
+  for (unsigned i = 0; i < 256; i++) {
+    lut[i] = float(i) * scale + bias;
+  }
+
+  translateRows(rows, lut, reinterpret_cast<float *>(T->getUnsafePtr()),
+                width, height, numChannels, hasAlpha);
+
+  freePngRows(rows, height);
+  return false;
+}
+
+bool glow::readPngImageInt8(Tensor *T, const char *filename,
+                            std::pair<float, float> range, float quantScale,
+                            int32_t quantOffset) {
+  png_bytep *rows;
+  size_t width, height, numChannels;
+  bool hasAlpha;
+  if (decodePng(filename, &rows, &width, &height, &numChannels, &hasAlpha)) {
+    return true;
+  }
+
+  T->reset(ElemKind::Int8QTy, {width, height, numChannels}, quantScale,
+           quantOffset);
+
+  // Fold the normalization and the quantization into one table: every
+  // possible sample value maps to one int8 value, so the image never goes
+  // through a float intermediate.
+  float scale = ((range.second - range.first) / 255.0);
+  float bias = range.first;
+  int8_t lut[256];
+  for (unsigned i = 0; i < 256; i++) {
+    int32_t q =
+        (int32_t)std::round((float(i) * scale + bias) / quantScale) +
+        quantOffset;
+    lut[i] = (int8_t)std::max(-128, std::min(127, q));
+  }
+
+  translateRows(rows, lut, reinterpret_cast<int8_t *>(T->getUnsafePtr()),
+                width, height, numChannels, hasAlpha);
+
+  freePngRows(rows, height);
   return false;
 }
 
@@ -258,8 +338,213 @@ bool glow::readPngImage(Tensor *T, const char *filename,
   GLOW_ASSERT(false && "Not configured with libpng");
 }
 
+bool glow::readPngImageInt8(Tensor *T, const char *filename,
+                            std::pair<float, float> range, float quantScale,
+                            int32_t quantOffset) {
+  GLOW_ASSERT(false && "Not configured with libpng");
+}
+
 bool glow::writePngImage(Tensor *T, const char *filename,
                          std::pair<float, float> range) {
   GLOW_ASSERT(false && "Not configured with libpng");
 }
 #endif
+
+#if WITH_JPEG
+#include <jpeglib.h>
+
+#include <csetjmp>
+
+/// The libjpeg error manager extended with a jump target, so a corrupt file
+/// fails the read instead of the library's default exit().
+struct JpegErrorContext {
+  jpeg_error_mgr mgr;
+  jmp_buf jump;
+};
+
+/// The error_exit handler installed by the readers: returns control to the
+/// setjmp() site in the reader.
+static void jpegErrorExit(j_common_ptr cinfo) {
+  auto *ctx = reinterpret_cast<JpegErrorContext *>(cinfo->err);
+  longjmp(ctx->jump, 1);
+}
+
+std::tuple<size_t, size_t, bool> glow::getJpegInfo(const char *filename) {
+  FILE *fp = fopen(filename, "rb");
+  GLOW_ASSERT(fp && "Can't open image file.");
+
+  jpeg_decompress_struct cinfo;
+  JpegErrorContext err;
+  cinfo.err = jpeg_std_error(&err.mgr);
+  err.mgr.error_exit = jpegErrorExit;
+  int sjmp = setjmp(err.jump);
+  GLOW_ASSERT(!sjmp && "Invalid image file.");
+
+  jpeg_create_decompress(&cinfo);
+  jpeg_stdio_src(&cinfo, fp);
+  jpeg_read_header(&cinfo, TRUE);
+
+  size_t height = cinfo.image_height;
+  size_t width = cinfo.image_width;
+  const bool isGray = cinfo.num_components == 1;
+
+  jpeg_destroy_decompress(&cinfo);
+  fclose(fp);
+
+  return std::make_tuple(height, width, isGray);
+}
+
+bool glow::readJpegImage(Tensor *T, const char *filename,
+                         std::pair<float, float> range) {
+  FILE *fp = fopen(filename, "rb");
+  // Can't open the file.
+  if (!fp) {
+    return true;
+  }
+
+  jpeg_decompress_struct cinfo;
+  JpegErrorContext err;
+  cinfo.err = jpeg_std_error(&err.mgr);
+  err.mgr.error_exit = jpegErrorExit;
+  if (setjmp(err.jump)) {
+    jpeg_destroy_decompress(&cinfo);
+    fclose(fp);
+    return true;
+  }
+
+  jpeg_create_decompress(&cinfo);
+  jpeg_stdio_src(&cinfo, fp);
+  jpeg_read_header(&cinfo, TRUE);
+
+  // Let the library do the color conversion; with libjpeg-turbo both the
+  // iDCT and the conversion run in its SIMD paths.
+  cinfo.out_color_space =
+      cinfo.num_components == 1 ? JCS_GRAYSCALE : JCS_RGB;
+  jpeg_start_decompress(&cinfo);
+
+  size_t width = cinfo.output_width;
+  size_t height = cinfo.output_height;
+  size_t numChannels = cinfo.output_components;
+
+  T->reset(ElemKind::FloatTy, {width, height, numChannels});
+
+  // The same one-lookup-per-pixel normalization as the png reader.
+  float scale = ((range.second - range.first) / 255.0);
+  float bias = range.first;
+  float lut[256];
+  for (unsigned i = 0; i < 256; i++) {
+    lut[i] = float(i) * scale + bias;
+  }
+
+  // Translate every scanline straight from the decoder's row buffer into
+  // the tensor; the image never exists as a separate 8-bit copy.
+  auto *data = reinterpret_cast<float *>(T->getUnsafePtr());
+  std::vector<JSAMPLE> rowBuf(width * numChannels);
+  JSAMPROW rowPtr = rowBuf.data();
+  for (size_t y = 0; y < height; y++) {
+    jpeg_read_scanlines(&cinfo, &rowPtr, 1);
+    float *dst = data + y * width * numChannels;
+    for (size_t i = 0, e = width * numChannels; i < e; i++) {
+      dst[i] = lut[rowBuf[i]];
+    }
+  }
+
+  jpeg_finish_decompress(&cinfo);
+  jpeg_destroy_decompress(&cinfo);
+  fclose(fp);
+  return false;
+}
+
+#else
+std::tuple<size_t, size_t, bool> glow::getJpegInfo(const char *filename) {
+  GLOW_ASSERT(false && "Not configured with libjpeg");
+}
+
+bool glow::readJpegImage(Tensor *T, const char *filename,
+                         std::pair<float, float> range) {
+  GLOW_ASSERT(false && "Not configured with libjpeg");
+}
+#endif
+
+/// \returns true when \p filename starts with the JPEG start-of-image
+/// marker. Dispatching on the signature instead of the extension keeps
+/// misnamed files working.
+static bool isJpegFile(const char *filename) {
+  FILE *fp = fopen(filename, "rb");
+  if (!fp) {
+    return false;
+  }
+  unsigned char sig[2];
+  size_t n = fread(sig, 1, 2, fp);
+  fclose(fp);
+  return n == 2 && sig[0] == 0xFF && sig[1] == 0xD8;
+}
+
+bool glow::readImage(Tensor *T, const char *filename,
+                     std::pair<float, float> range) {
+  return isJpegFile(filename) ? readJpegImage(T, filename, range)
+                              : readPngImage(T, filename, range);
+}
+
+std::tuple<size_t, size_t, bool> glow::getImageInfo(const char *filename) {
+  return isJpegFile(filename) ? getJpegInfo(filename) : getPngInfo(filename);
+}
+
+bool glow::readImages(llvm::ArrayRef<std::string> filenames, Tensor *batch,
+                      std::pair<float, float> range) {
+  assert(!filenames.empty() && "There must be at least one image");
+
+  // Get the first image's dimensions; all images must match them.
+  size_t imgHeight, imgWidth;
+  bool isGray;
+  std::tie(imgHeight, imgWidth, isGray) = getImageInfo(filenames[0].c_str());
+  const size_t numChannels = isGray ? 1 : 3;
+
+  size_t numImages = filenames.size();
+  batch->reset(ElemKind::FloatTy,
+               {numImages, imgHeight, imgWidth, numChannels});
+
+  // Decode the images in parallel, each one directly into its slice of the
+  // batch. readImage() reuses the slice's buffer because the view already
+  // has the exact type of the decoded image.
+  std::atomic<bool> failed{false};
+  unsigned numThreads =
+      std::min<size_t>(std::thread::hardware_concurrency(), numImages);
+  numThreads = std::max(numThreads, 1u);
+  size_t perThread = (numImages + numThreads - 1) / numThreads;
+
+  auto decodeRange = [&](size_t begin, size_t end) {
+    for (size_t n = begin; n < end && !failed; n++) {
+      Tensor slice = batch->getUnowned(
+          {imgHeight, imgWidth, numChannels}, {n, 0, 0, 0});
+      char *slicePtr = slice.getUnsafePtr();
+      if (readImage(&slice, filenames[n].c_str(), range) ||
+          slice.getUnsafePtr() != slicePtr) {
+        // Decoding failed, or the image's dimensions did not match the batch
+        // and the decoder allocated a fresh buffer.
+        failed = true;
+        return;
+      }
+    }
+  };
+
+  if (numThreads == 1) {
+    decodeRange(0, numImages);
+  } else {
+    std::vector<std::thread> workers;
+    for (size_t begin = 0; begin < numImages; begin += perThread) {
+      workers.emplace_back(decodeRange, begin,
+                           std::min(begin + perThread, numImages));
+    }
+    for (auto &t : workers) {
+      t.join();
+    }
+  }
+
+  return failed;
+}
+
+bool glow::readPngImages(llvm::ArrayRef<std::string> filenames, Tensor *batch,
+                         std::pair<float, float> range) {
+  return readImages(filenames, batch, range);
+}
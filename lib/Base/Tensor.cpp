@@ -19,10 +19,38 @@
 #include "llvm/Support/NativeFormatting.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <thread>
+
 using namespace glow;
 
 namespace {
 
+/// Tensors with a payload of at least this many bytes are zeroed using
+/// multiple threads. The threshold is high enough that the cost of spawning
+/// threads is negligible compared to the fill itself.
+constexpr size_t parallelFillMinBytes = 64 << 20;
+
+/// Zero \p numBytes bytes starting at \p data using several threads. Each
+/// thread clears a contiguous chunk so all stores stay sequential.
+static void parallelZero(char *data, size_t numBytes) {
+  unsigned numThreads = std::thread::hardware_concurrency();
+  if (numThreads < 2) {
+    memset(data, 0, numBytes);
+    return;
+  }
+
+  size_t chunk = alignedSize(numBytes / numThreads, TensorAlignment);
+  std::vector<std::thread> workers;
+  for (size_t start = 0; start < numBytes; start += chunk) {
+    size_t len = std::min(chunk, numBytes - start);
+    workers.emplace_back([=] { memset(data + start, 0, len); });
+  }
+  for (auto &t : workers) {
+    t.join();
+  }
+}
+
+
 /// This is a helper method that's used in the visualization of tensors.
 template <class ElemTy> static char valueToChar(ElemTy val) {
   char ch = ' ';
@@ -263,18 +291,144 @@ static void transposeSelectImpl(Handle<ElemTy> &src, Handle<ElemTy> &dest,
     transposeGenericImpl(src, dest, srcCoor, destCoor, shuffle);
   }
 }
+
+/// Describes a shuffle that is equivalent to transposing a (rows x cols)
+/// matrix independently in each of \p numSlices outer slices.
+struct Transpose2DParams {
+  size_t numSlices;
+  size_t rows;
+  size_t cols;
+};
+
+/// Try to express \p shuffle over \p srcDims as a per-slice 2D matrix
+/// transpose. This matches any permutation that keeps a leading prefix of
+/// dimensions in place and swaps two contiguous groups of the remaining
+/// dimensions, which covers plain 2D transposes as well as the common
+/// NHWC<->NCHW shuffles. On success fills \p params and \returns true.
+static bool matchTranspose2D(llvm::ArrayRef<size_t> srcDims,
+                             llvm::ArrayRef<unsigned> shuffle,
+                             Transpose2DParams &params) {
+  size_t n = shuffle.size();
+
+  // Skip the leading dimensions that stay in place.
+  size_t p = 0;
+  while (p < n && shuffle[p] == p) {
+    p++;
+  }
+  if (p == n || n - p < 2) {
+    return false;
+  }
+
+  // The remaining dimensions must be a rotation: group B (source dims
+  // s..n-1) followed by group A (source dims p..s-1).
+  size_t s = shuffle[p];
+  if (s <= p || s >= n) {
+    return false;
+  }
+  size_t bLen = n - s;
+  for (size_t i = 0; i < bLen; i++) {
+    if (shuffle[p + i] != s + i) {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < s - p; i++) {
+    if (shuffle[p + bLen + i] != p + i) {
+      return false;
+    }
+  }
+
+  params.numSlices = 1;
+  for (size_t i = 0; i < p; i++) {
+    params.numSlices *= srcDims[i];
+  }
+  params.rows = 1;
+  for (size_t i = p; i < s; i++) {
+    params.rows *= srcDims[i];
+  }
+  params.cols = 1;
+  for (size_t i = s; i < n; i++) {
+    params.cols *= srcDims[i];
+  }
+  return true;
+}
+
+/// Transpose the (rows x cols) row-major matrices in the slice range
+/// [\p sliceBegin, \p sliceEnd) of \p src into \p dest using cache tiles.
+template <class ElemTy>
+static void transposeSlicesBlocked(const ElemTy *src, ElemTy *dest,
+                                   const Transpose2DParams &params,
+                                   size_t sliceBegin, size_t sliceEnd) {
+  constexpr size_t block = 8;
+  size_t rows = params.rows, cols = params.cols;
+  for (size_t s = sliceBegin; s < sliceEnd; s++) {
+    const ElemTy *srcS = src + s * rows * cols;
+    ElemTy *destS = dest + s * rows * cols;
+    for (size_t r = 0; r < rows; r += block) {
+      size_t re = std::min(r + block, rows);
+      for (size_t c = 0; c < cols; c += block) {
+        size_t ce = std::min(c + block, cols);
+        // The compiler vectorizes this fixed-trip-count tile; all loads and
+        // stores stay within one cache-tile of each matrix.
+        for (size_t br = r; br < re; br++) {
+          for (size_t bc = c; bc < ce; bc++) {
+            destS[bc * rows + br] = srcS[br * cols + bc];
+          }
+        }
+      }
+    }
+  }
+}
+
+/// Transposes above this many elements are split across threads.
+constexpr size_t parallelTransposeMinElems = 1 << 20;
+
+/// Blocked per-slice transpose of \p src into \p dest, parallelized across
+/// the outer slices when the tensor is large enough.
+template <class ElemTy>
+static void transposeBlockedImpl(Tensor *src, Tensor *dest,
+                                 const Transpose2DParams &params) {
+  const ElemTy *srcData = src->getRawDataPointer<ElemTy>();
+  ElemTy *destData = dest->getRawDataPointer<ElemTy>();
+
+  size_t totalElems = params.numSlices * params.rows * params.cols;
+  unsigned numThreads = std::thread::hardware_concurrency();
+  if (totalElems < parallelTransposeMinElems || numThreads < 2 ||
+      params.numSlices < 2) {
+    transposeSlicesBlocked(srcData, destData, params, 0, params.numSlices);
+    return;
+  }
+
+  numThreads = std::min<size_t>(numThreads, params.numSlices);
+  size_t slicesPerThread = (params.numSlices + numThreads - 1) / numThreads;
+  std::vector<std::thread> workers;
+  for (size_t begin = 0; begin < params.numSlices; begin += slicesPerThread) {
+    size_t end = std::min(begin + slicesPerThread, params.numSlices);
+    workers.emplace_back([=] {
+      transposeSlicesBlocked(srcData, destData, params, begin, end);
+    });
+  }
+  for (auto &t : workers) {
+    t.join();
+  }
+}
 } // namespace
 
 void glow::dumpAsciiImpl(Tensor *T, llvm::raw_ostream &os) {
   switch (T->getElementType()) {
   case ElemKind::FloatTy:
     return dumpAsciiGenericImpl(T->getHandle<float>(), os);
+  case ElemKind::Float16Ty:
+    return dumpAsciiGenericImpl(T->getHandle<float16_t>(), os);
   case ElemKind::Int8QTy:
     return dumpAsciiGenericImpl(T->getHandle<int8_t>(), os);
+  case ElemKind::Int16QTy:
+    return dumpAsciiGenericImpl(T->getHandle<int16_t>(), os);
   case ElemKind::Int32QTy:
     return dumpAsciiGenericImpl(T->getHandle<int32_t>(), os);
   case ElemKind::IndexTy:
     return dumpAsciiGenericImpl(T->getHandle<size_t>(), os);
+  case ElemKind::Int32ITy:
+    return dumpAsciiGenericImpl(T->getHandle<int32_t>(), os);
   }
 }
 
@@ -284,12 +438,18 @@ void glow::dumpImpl(Tensor *T, llvm::raw_ostream &os) {
   switch (T->getElementType()) {
   case ElemKind::FloatTy:
     return dumpGenericImpl(T->getHandle<float>(), os);
+  case ElemKind::Float16Ty:
+    return dumpGenericImpl(T->getHandle<float16_t>(), os);
   case ElemKind::Int8QTy:
     return dumpGenericImpl(T->getHandle<int8_t>(), os);
+  case ElemKind::Int16QTy:
+    return dumpGenericImpl(T->getHandle<int16_t>(), os);
   case ElemKind::Int32QTy:
     return dumpGenericImpl(T->getHandle<int32_t>(), os);
   case ElemKind::IndexTy:
     return dumpGenericImpl(T->getHandle<size_t>(), os);
+  case ElemKind::Int32ITy:
+    return dumpGenericImpl(T->getHandle<int32_t>(), os);
   }
 }
 
@@ -311,6 +471,28 @@ void glow::genericTranspose(Tensor *src, Tensor *dest,
   auto destType = Type::newShape(src->getType(), {newSizes, origDims.size()});
   dest->reset(destType);
 
+  // Use the blocked kernel whenever the shuffle reduces to per-slice 2D
+  // matrix transposes (this covers NHWC<->NCHW and plain 2D transposes).
+  Transpose2DParams params;
+  if (src->isContiguous() && matchTranspose2D(origDims, shuffle, params)) {
+    switch (src->getElementType()) {
+    case ElemKind::FloatTy:
+      return transposeBlockedImpl<float>(src, dest, params);
+    case ElemKind::Float16Ty:
+      return transposeBlockedImpl<float16_t>(src, dest, params);
+    case ElemKind::Int8QTy:
+      return transposeBlockedImpl<int8_t>(src, dest, params);
+    case ElemKind::Int16QTy:
+      return transposeBlockedImpl<int16_t>(src, dest, params);
+    case ElemKind::Int32QTy:
+      return transposeBlockedImpl<int32_t>(src, dest, params);
+    case ElemKind::IndexTy:
+      return transposeBlockedImpl<size_t>(src, dest, params);
+    case ElemKind::Int32ITy:
+      return transposeBlockedImpl<int32_t>(src, dest, params);
+    }
+  }
+
   switch (src->getElementType()) {
   case ElemKind::FloatTy: {
     auto srcH = src->getHandle<float>();
@@ -318,12 +500,24 @@ void glow::genericTranspose(Tensor *src, Tensor *dest,
     transposeSelectImpl(srcH, destH, shuffle);
     return;
   }
+  case ElemKind::Float16Ty: {
+    auto srcH = src->getHandle<float16_t>();
+    auto destH = dest->getHandle<float16_t>();
+    transposeSelectImpl(srcH, destH, shuffle);
+    return;
+  }
   case ElemKind::Int8QTy: {
     auto srcH = src->getHandle<int8_t>();
     auto destH = dest->getHandle<int8_t>();
     transposeSelectImpl(srcH, destH, shuffle);
     return;
   }
+  case ElemKind::Int16QTy: {
+    auto srcH = src->getHandle<int16_t>();
+    auto destH = dest->getHandle<int16_t>();
+    transposeSelectImpl(srcH, destH, shuffle);
+    return;
+  }
   case ElemKind::Int32QTy: {
     auto srcH = src->getHandle<int32_t>();
     auto destH = dest->getHandle<int32_t>();
@@ -336,6 +530,12 @@ void glow::genericTranspose(Tensor *src, Tensor *dest,
     transposeSelectImpl(srcH, destH, shuffle);
     return;
   }
+  case ElemKind::Int32ITy: {
+    auto srcH = src->getHandle<int32_t>();
+    auto destH = dest->getHandle<int32_t>();
+    transposeSelectImpl(srcH, destH, shuffle);
+    return;
+  }
   }
 }
 
@@ -347,6 +547,17 @@ ShapeVector glow::expandDimsToMax(llvm::ArrayRef<size_t> currDims) {
   return newDims;
 }
 
+void Tensor::zero() {
+  assert(isContiguous() && "Cannot zero a strided view");
+  ensureOwnPayload();
+  size_t numBytes = type_.getSizeInBytes();
+  if (numBytes >= parallelFillMinBytes) {
+    parallelZero(getData(), numBytes);
+    return;
+  }
+  memset(getData(), 0, numBytes);
+}
+
 void Tensor::initPayload(InitKind init, float val, PseudoRNG &PRNG) {
   switch (init) {
   case InitKind::Zero:
@@ -359,10 +570,18 @@ void Tensor::initPayload(InitKind init, float val, PseudoRNG &PRNG) {
       getHandle<float>().clear(val);
       break;
     }
+    case ElemKind::Float16Ty: {
+      getHandle<float16_t>().clear(val);
+      break;
+    }
     case ElemKind::Int8QTy: {
       getHandle<int8_t>().clear(val);
       break;
     };
+    case ElemKind::Int16QTy: {
+      getHandle<int16_t>().clear(val);
+      break;
+    }
     case ElemKind::Int32QTy: {
       getHandle<int32_t>().clear(val);
       break;
@@ -371,6 +590,10 @@ void Tensor::initPayload(InitKind init, float val, PseudoRNG &PRNG) {
       getHandle<size_t>().clear(val);
       break;
     }
+    case ElemKind::Int32ITy: {
+      getHandle<int32_t>().clear(val);
+      break;
+    }
     }
     break;
   }
@@ -381,10 +604,18 @@ void Tensor::initPayload(InitKind init, float val, PseudoRNG &PRNG) {
       getHandle<float>().initXavier(val, PRNG);
       break;
     }
+    case ElemKind::Float16Ty: {
+      getHandle<float16_t>().initXavier(val, PRNG);
+      break;
+    }
     case ElemKind::Int8QTy: {
       getHandle<int8_t>().initXavier(val, PRNG);
       break;
     };
+    case ElemKind::Int16QTy: {
+      getHandle<int16_t>().initXavier(val, PRNG);
+      break;
+    }
     case ElemKind::Int32QTy: {
       getHandle<int32_t>().initXavier(val, PRNG);
       break;
@@ -393,8 +624,134 @@ void Tensor::initPayload(InitKind init, float val, PseudoRNG &PRNG) {
       getHandle<size_t>().initXavier(val, PRNG);
       break;
     }
+    case ElemKind::Int32ITy: {
+      getHandle<int32_t>().initXavier(val, PRNG);
+      break;
+    }
     }
     break;
   }
   }
 }
+
+namespace {
+/// Copy the payload of \p src into \p dest, converting every element through
+/// fp32.
+template <class DestTy, class SrcTy>
+void convertPayload(Tensor *dest, Tensor *src) {
+  auto destH = dest->getHandle<DestTy>();
+  auto srcH = src->getHandle<SrcTy>();
+  for (size_t i = 0, e = srcH.size(); i < e; i++) {
+    destH.raw(i) = float(srcH.raw(i));
+  }
+}
+} // namespace
+
+Tensor Tensor::getCopyConvertedToType(ElemKind newKind) const {
+  ElemKind origKind = getElementType();
+  assert(((origKind == ElemKind::FloatTy && newKind == ElemKind::Float16Ty) ||
+          (origKind == ElemKind::Float16Ty && newKind == ElemKind::FloatTy)) &&
+         "Only float <-> float16 conversions are supported");
+
+  Tensor result(newKind, dims());
+  // The handles need a non-const tensor; the payload is only read.
+  auto *src = const_cast<Tensor *>(this);
+  if (origKind == ElemKind::FloatTy) {
+    convertPayload<float16_t, float>(&result, src);
+  } else {
+    convertPayload<float, float16_t>(&result, src);
+  }
+  return result;
+}
+
+uint64_t Tensor::hash() const {
+  assert(isContiguous() && "Cannot hash a strided view");
+  const char *data = getData();
+  size_t numBytes = getSizeInBytes();
+
+  // A simple 64-bit multiply-and-mix hash in the spirit of xxhash. The body
+  // consumes one 8-byte word per iteration and the loop carries only one
+  // multiplication, so it vectorizes and pipelines well.
+  const uint64_t prime1 = 0x9e3779b185ebca87ULL;
+  const uint64_t prime2 = 0xc2b2ae3d27d4eb4fULL;
+  uint64_t state = prime1 ^ (numBytes * prime2);
+
+  size_t numWords = numBytes / sizeof(uint64_t);
+  for (size_t i = 0; i < numWords; i++) {
+    uint64_t word;
+    memcpy(&word, data + i * sizeof(uint64_t), sizeof(word));
+    state = (state ^ word) * prime2;
+    state ^= state >> 29;
+  }
+
+  // Consume the trailing bytes.
+  uint64_t tail = 0;
+  size_t tailBytes = numBytes % sizeof(uint64_t);
+  if (tailBytes) {
+    memcpy(&tail, data + numWords * sizeof(uint64_t), tailBytes);
+    state = (state ^ tail) * prime2;
+    state ^= state >> 29;
+  }
+
+  // Final avalanche.
+  state *= prime1;
+  state ^= state >> 32;
+  return state;
+}
+
+Tensor glow::sparsifyTensorCSR(const Tensor *src) {
+  const Type &ty = src->getType();
+  assert(ty.getElementType() == ElemKind::FloatTy && !ty.isSparse() &&
+         ty.dims().size() == 2 && "Expected a dense float matrix");
+  size_t numRows = ty.dims()[0];
+  size_t numCols = ty.dims()[1];
+  const float *data = src->getRawDataPointer<float>();
+
+  size_t numNonZeros = 0;
+  for (size_t i = 0, e = ty.size(); i < e; i++) {
+    numNonZeros += (data[i] != 0.0f);
+  }
+
+  Type sparseTy = Type::newSparse(ty, numNonZeros);
+  Tensor result(sparseTy);
+  auto *rowPtr = reinterpret_cast<uint32_t *>(result.getUnsafePtr());
+  auto *colIdx = rowPtr + numRows + 1;
+  auto *values = reinterpret_cast<float *>(colIdx + numNonZeros);
+
+  size_t pos = 0;
+  for (size_t r = 0; r < numRows; r++) {
+    rowPtr[r] = pos;
+    const float *row = &data[r * numCols];
+    for (size_t c = 0; c < numCols; c++) {
+      if (row[c] != 0.0f) {
+        colIdx[pos] = c;
+        values[pos] = row[c];
+        pos++;
+      }
+    }
+  }
+  rowPtr[numRows] = pos;
+  assert(pos == numNonZeros && "Wrong non-zero count");
+  return result;
+}
+
+Tensor glow::densifyTensorCSR(const Tensor *src) {
+  const Type &ty = src->getType();
+  assert(ty.isSparse() && "Expected a CSR-encoded matrix");
+  size_t numRows = ty.dims()[0];
+  size_t numCols = ty.dims()[1];
+  const auto *rowPtr = reinterpret_cast<const uint32_t *>(src->getUnsafePtr());
+  const auto *colIdx = rowPtr + numRows + 1;
+  const auto *values =
+      reinterpret_cast<const float *>(colIdx + ty.getNumNonZeros());
+
+  Tensor result(ElemKind::FloatTy, ty.dims());
+  result.zero();
+  float *data = result.getRawDataPointer<float>();
+  for (size_t r = 0; r < numRows; r++) {
+    for (uint32_t i = rowPtr[r], e = rowPtr[r + 1]; i < e; i++) {
+      data[r * numCols + colIdx[i]] = values[i];
+    }
+  }
+  return result;
+}
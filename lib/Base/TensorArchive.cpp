@@ -0,0 +1,213 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "glow/Base/TensorArchive.h"
+#include "glow/Support/Compiler.h"
+#include "glow/Support/Memory.h"
+
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace glow;
+
+namespace {
+
+/// The first bytes of every archive file.
+constexpr char archiveMagic[8] = {'G', 'L', 'O', 'W', 'T', 'E', 'N', 'S'};
+/// Bumped when the layout of the header or the records changes.
+constexpr uint64_t archiveVersion = 1;
+
+/// The archive starts with this header, followed by \ref numTensors records
+/// and the payloads. The fields are in host byte order: the archive is a
+/// per-host cache of a parsed dataset, not an interchange format.
+struct ArchiveHeader {
+  char magic[8];
+  uint64_t version;
+  uint64_t numTensors;
+};
+
+/// Describes one archived tensor: its type and where its payload lives in
+/// the file. Quantized element kinds carry their scale and offset; the
+/// fields are zero otherwise.
+struct ArchiveRecord {
+  uint64_t elemKind;
+  uint64_t numDims;
+  uint64_t dims[max_tensor_dimensions];
+  double scale;
+  int64_t offset;
+  uint64_t dataOffset;
+  uint64_t dataSize;
+};
+
+/// \returns the type described by the record \p r.
+Type recordToType(const ArchiveRecord &r) {
+  GLOW_ASSERT(r.numDims <= max_tensor_dimensions &&
+              "Corrupt archive record");
+  llvm::SmallVector<size_t, max_tensor_dimensions> dims;
+  for (uint64_t i = 0; i < r.numDims; i++) {
+    dims.push_back(r.dims[i]);
+  }
+  auto kind = (ElemKind)r.elemKind;
+  if (kind == ElemKind::Int8QTy || kind == ElemKind::Int16QTy ||
+      kind == ElemKind::Int32QTy) {
+    return Type(kind, dims, (float)r.scale, (int32_t)r.offset);
+  }
+  return Type(kind, dims);
+}
+
+} // namespace
+
+TensorArchive::TensorArchive(llvm::StringRef path) {
+  int fd = open(path.str().c_str(), O_RDONLY);
+  GLOW_ASSERT(fd != -1 && "Could not open the tensor archive");
+  struct stat st;
+  GLOW_ASSERT(fstat(fd, &st) == 0 && "Could not stat the tensor archive");
+  mappedSize_ = st.st_size;
+  base_ = (uint8_t *)mmap(nullptr, mappedSize_, PROT_READ, MAP_SHARED, fd, 0);
+  // The mapping keeps its own reference to the file.
+  close(fd);
+  GLOW_ASSERT(base_ != MAP_FAILED && "Could not map the tensor archive");
+
+  GLOW_ASSERT(mappedSize_ >= sizeof(ArchiveHeader) &&
+              "The file is too small to be a tensor archive");
+  auto *hdr = (const ArchiveHeader *)base_;
+  GLOW_ASSERT(memcmp(hdr->magic, archiveMagic, sizeof(archiveMagic)) == 0 &&
+              "The file is not a tensor archive");
+  GLOW_ASSERT(hdr->version == archiveVersion &&
+              "Unsupported tensor archive version");
+
+  auto *records = (const ArchiveRecord *)(base_ + sizeof(ArchiveHeader));
+  for (uint64_t i = 0; i < hdr->numTensors; i++) {
+    const ArchiveRecord &r = records[i];
+    Type ty = recordToType(r);
+    GLOW_ASSERT(ty.getSizeInBytes() == r.dataSize &&
+                r.dataOffset + r.dataSize <= mappedSize_ &&
+                "Corrupt archive record");
+    entries_.emplace_back(ty, (size_t)r.dataOffset);
+  }
+}
+
+TensorArchive::~TensorArchive() {
+  if (base_) {
+    munmap(base_, mappedSize_);
+  }
+}
+
+Tensor TensorArchive::getTensor(size_t idx) {
+  assert(idx < entries_.size() && "Invalid tensor index");
+  auto &entry = entries_[idx];
+  return Tensor(base_ + entry.second, &entry.first);
+}
+
+Tensor TensorArchive::getBatch(size_t idx, size_t first, size_t count) {
+  assert(idx < entries_.size() && "Invalid tensor index");
+  auto &entry = entries_[idx];
+  auto dims = entry.first.dims();
+  assert(dims.size() > 0 && first + count <= dims[0] &&
+         "The batch does not fit in the tensor");
+
+  llvm::SmallVector<size_t, max_tensor_dimensions> batchDims(dims.begin(),
+                                                             dims.end());
+  batchDims[0] = count;
+  Type batchTy = Type::newShape(entry.first, batchDims);
+
+  // The view references its type, so hand out a pointer with a stable
+  // address. The distinct batch shapes of a run are few - typically one -
+  // so a linear scan over the already created types is fine.
+  TypeRef ty = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (auto &t : viewTypes_) {
+      if (t.isEqual(batchTy)) {
+        ty = &t;
+        break;
+      }
+    }
+    if (!ty) {
+      viewTypes_.push_back(batchTy);
+      ty = &viewTypes_.back();
+    }
+  }
+
+  size_t sliceBytes = entry.first.getSizeInBytes() / dims[0];
+  return Tensor(base_ + entry.second + first * sliceBytes, ty);
+}
+
+void TensorArchive::write(llvm::StringRef path,
+                          llvm::ArrayRef<const Tensor *> tensors) {
+  assert(!tensors.empty() && "Expected at least one tensor");
+
+  // Lay out the payloads behind the records, aligned like tensor payloads
+  // so the mapped views have the alignment the kernels expect.
+  size_t offset =
+      sizeof(ArchiveHeader) + tensors.size() * sizeof(ArchiveRecord);
+  std::vector<ArchiveRecord> records;
+  for (const auto *T : tensors) {
+    const Type &ty = T->getType();
+    ArchiveRecord r;
+    memset(&r, 0, sizeof(r));
+    r.elemKind = (uint64_t)ty.getElementType();
+    r.numDims = ty.dims().size();
+    for (size_t i = 0, e = ty.dims().size(); i < e; i++) {
+      r.dims[i] = ty.dims()[i];
+    }
+    if (ty.isQuantizedType()) {
+      r.scale = ty.getScale();
+      r.offset = ty.getOffset();
+    }
+    offset = alignedSize(offset, TensorAlignment);
+    r.dataOffset = offset;
+    r.dataSize = ty.getSizeInBytes();
+    offset += r.dataSize;
+    records.push_back(r);
+  }
+
+  std::ofstream out(path.str(), std::ios::binary | std::ios::trunc);
+  GLOW_ASSERT(out.is_open() && "Could not create the tensor archive");
+
+  ArchiveHeader hdr;
+  memcpy(hdr.magic, archiveMagic, sizeof(archiveMagic));
+  hdr.version = archiveVersion;
+  hdr.numTensors = tensors.size();
+  out.write((const char *)&hdr, sizeof(hdr));
+  out.write((const char *)records.data(),
+            records.size() * sizeof(ArchiveRecord));
+
+  for (size_t i = 0, e = tensors.size(); i < e; i++) {
+    // Pad up to the aligned payload offset.
+    size_t pos = out.tellp();
+    for (; pos < records[i].dataOffset; pos++) {
+      out.put(0);
+    }
+    out.write(tensors[i]->getUnsafePtr(), records[i].dataSize);
+  }
+  GLOW_ASSERT(out.good() && "Could not write the tensor archive");
+}
+
+bool TensorArchive::isArchive(llvm::StringRef path) {
+  std::ifstream in(path.str(), std::ios::binary);
+  ArchiveHeader hdr;
+  if (!in.read((char *)&hdr, sizeof(hdr))) {
+    return false;
+  }
+  return memcmp(hdr.magic, archiveMagic, sizeof(archiveMagic)) == 0 &&
+         hdr.version == archiveVersion;
+}
@@ -0,0 +1,40 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "glow/Base/Traits.h"
+
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/Allocator.h"
+
+#include <mutex>
+
+using namespace glow;
+
+namespace {
+/// The process-wide arena of interned names. The StringSet stores each
+/// distinct name once, in its bump allocator; the entries are never erased,
+/// so the returned references stay valid for the lifetime of the process.
+llvm::StringSet<llvm::BumpPtrAllocator> internedNames;
+std::mutex internedNamesMutex;
+} // namespace
+
+llvm::StringRef glow::internName(llvm::StringRef name) {
+  if (name.empty()) {
+    return llvm::StringRef("", 0);
+  }
+  std::lock_guard<std::mutex> lock(internedNamesMutex);
+  return internedNames.insert(name).first->first();
+}
@@ -37,6 +37,10 @@ llvm::raw_ostream &operator<<(llvm::raw_ostream &os, const Type &type) {
     os << "]";
   }
 
+  if (type.isSparse()) {
+    os << "[CSR:" << type.getNumNonZeros() << ']';
+  }
+
   os << '<';
   for (unsigned i = 0; i < type.numSizes_; ++i) {
     if (i) {
@@ -14,46 +14,237 @@
  * limitations under the License.
  */
 
+#define DEBUG_TYPE "memory-allocator"
+
 #include "glow/CodeGen/MemoryAllocator.h"
 #include "glow/Support/Memory.h"
+#include "glow/Support/Statistic.h"
+
+#include "llvm/Support/CommandLine.h"
 
-#include "llvm/Support/Casting.h"
+#include <algorithm>
+#include <cassert>
 
 using namespace glow;
 
+GLOW_STATISTIC(numBytesReused, "Bytes placed into recycled free segments");
+GLOW_STATISTIC(numBytesGrown, "Bytes of fresh arena space allocated");
+
+/// The number of independent copies of the activation arena that the backends
+/// lay out. With two regions, a client can alternate in-flight batches
+/// between the regions and overlap the input upload and output download of
+/// one batch with the compute of the other.
+llvm::cl::opt<unsigned> activationRegionsOpt(
+    "activation-regions", llvm::cl::init(1),
+    llvm::cl::desc("Number of independent activation regions to lay out"));
+
 const size_t MemoryAllocator::npos = -1;
 
+void MemoryAllocator::insertFreeSegment(size_t begin, size_t size) {
+  freeByAddr_[begin] = size;
+  freeBySize_.emplace(size, begin);
+  fragmentedBytes_ += size;
+  maxFragmentedBytes_ = std::max(maxFragmentedBytes_, fragmentedBytes_);
+}
+
+void MemoryAllocator::removeFreeSegment(size_t begin, size_t size) {
+  freeByAddr_.erase(begin);
+  auto range = freeBySize_.equal_range(size);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second == begin) {
+      freeBySize_.erase(it);
+      break;
+    }
+  }
+  fragmentedBytes_ -= size;
+}
+
+size_t MemoryAllocator::getRegionStride() const {
+  return alignedSize(maxMemoryAllocated_, TensorAlignment);
+}
+
 size_t MemoryAllocator::allocate(size_t size) {
   // Always allocate buffers properly aligned to hold values of any type.
+  return allocate(size, TensorAlignment);
+}
+
+size_t MemoryAllocator::allocate(size_t size, size_t alignment) {
+  assert(alignment >= TensorAlignment && !(alignment & (alignment - 1)) &&
+         "Alignment must be a power of two and at least TensorAlignment");
   size = alignedSize(size, TensorAlignment);
-  size_t prev = 0;
-  for (auto it = allocations_.begin(), e = allocations_.end(); it != e; it++) {
-    if (it->begin_ - prev >= size) {
-      allocations_.emplace(it, prev, prev + size);
-      maxMemoryAllocated_ = std::max(maxMemoryAllocated_, prev + size);
-      return prev;
+  size_t segBegin = npos;
+  size_t segmentSize = 0;
+
+  // \returns the placement address inside the free segment
+  // [b .. b + bSize), or npos if the segment cannot hold an aligned
+  // allocation of this size.
+  auto alignedFit = [=](size_t b, size_t bSize) -> size_t {
+    size_t aligned = alignedSize(b, alignment);
+    if (aligned + size > b + bSize) {
+      return npos;
+    }
+    return aligned;
+  };
+
+  if (strategy_ == Strategy::BestFit) {
+    // Pick the smallest free segment that is large enough. A segment may be
+    // large enough yet fail the alignment, so keep probing upward.
+    for (auto it = freeBySize_.lower_bound(size); it != freeBySize_.end();
+         ++it) {
+      if (alignedFit(it->second, it->first) != npos) {
+        segBegin = it->second;
+        segmentSize = it->first;
+        break;
+      }
+    }
+  } else {
+    // Pick the lowest-addressed free segment that is large enough.
+    for (auto &f : freeByAddr_) {
+      if (alignedFit(f.first, f.second) != npos) {
+        segBegin = f.first;
+        segmentSize = f.second;
+        break;
+      }
     }
-    prev = it->end_;
   }
-  // Could not find a place for the new buffer in the middle of the list. Push
-  // the new allocation to the end of the stack.
 
-  // Check that we are not allocating memory beyond the pool size.
-  if (poolSize_ && (prev + size) > poolSize_) {
-    return npos;
+  size_t begin;
+  if (segBegin != npos) {
+    numBytesReused += size;
+    begin = alignedFit(segBegin, segmentSize);
+    removeFreeSegment(segBegin, segmentSize);
+    // Return the alignment padding and the tail of the segment to the free
+    // list.
+    if (begin > segBegin) {
+      insertFreeSegment(segBegin, begin - segBegin);
+    }
+    size_t segEnd = segBegin + segmentSize;
+    if (segEnd > begin + size) {
+      insertFreeSegment(begin + size, segEnd - (begin + size));
+    }
+  } else {
+    // No free segment fits; grow at the frontier.
+    numBytesGrown += size;
+    begin = alignedSize(frontier_, alignment);
+    // Check that we are not allocating memory beyond the pool size.
+    if (poolSize_ && (begin + size) > poolSize_) {
+      return npos;
+    }
+    // The padding skipped for alignment stays available as a free segment,
+    // coalesced with a hole that happens to end at the old frontier.
+    if (begin > frontier_) {
+      size_t padBegin = frontier_;
+      auto it = freeByAddr_.lower_bound(padBegin);
+      if (it != freeByAddr_.begin()) {
+        auto prev = std::prev(it);
+        if (prev->first + prev->second == padBegin) {
+          padBegin = prev->first;
+          removeFreeSegment(prev->first, prev->second);
+        }
+      }
+      insertFreeSegment(padBegin, begin - padBegin);
+    }
+    frontier_ = begin + size;
+  }
+
+  allocations_[begin] = begin + size;
+  maxMemoryAllocated_ = std::max(maxMemoryAllocated_, begin + size);
+  return begin;
+}
+
+size_t MemoryAllocator::allocateAll(std::vector<OfflineAllocation> &buffers) {
+  assert(allocations_.empty() && "Online allocations are still live");
+
+  // Place the large buffers first: small buffers fill the holes the large
+  // ones leave, while a small buffer placed early can pin a large one high.
+  std::vector<OfflineAllocation *> order;
+  order.reserve(buffers.size());
+  for (auto &b : buffers) {
+    order.push_back(&b);
   }
+  std::sort(order.begin(), order.end(),
+            [](const OfflineAllocation *a, const OfflineAllocation *b) {
+              if (a->size != b->size) {
+                return a->size > b->size;
+              }
+              return a->begin < b->begin;
+            });
 
-  allocations_.emplace_back(prev, prev + size);
-  maxMemoryAllocated_ = std::max(maxMemoryAllocated_, prev + size);
-  return prev;
+  std::vector<const OfflineAllocation *> placed;
+  placed.reserve(buffers.size());
+  size_t total = 0;
+  for (auto *b : order) {
+    size_t size = alignedSize(b->size, TensorAlignment);
+    // Collect the placed buffers whose live interval overlaps this one;
+    // only those constrain the address choice.
+    std::vector<const OfflineAllocation *> overlapping;
+    for (auto *p : placed) {
+      if (p->begin < b->end && b->begin < p->end) {
+        overlapping.push_back(p);
+      }
+    }
+    std::sort(overlapping.begin(), overlapping.end(),
+              [](const OfflineAllocation *a, const OfflineAllocation *b) {
+                return a->offset < b->offset;
+              });
+    // Scan the address space bottom-up and settle in the first gap between
+    // time-overlapping buffers that is large enough.
+    size_t offset = 0;
+    for (auto *p : overlapping) {
+      if (p->offset >= offset + size) {
+        break;
+      }
+      offset = std::max(offset, p->offset + alignedSize(p->size,
+                                                        TensorAlignment));
+    }
+    if (poolSize_ && offset + size > poolSize_) {
+      return npos;
+    }
+    b->offset = offset;
+    placed.push_back(b);
+    total = std::max(total, offset + size);
+  }
+  maxMemoryAllocated_ = std::max(maxMemoryAllocated_, total);
+  return total;
 }
 
 void MemoryAllocator::deallocate(size_t ptr) {
-  for (auto it = allocations_.begin(), e = allocations_.end(); it != e; it++) {
-    if (it->begin_ == ptr) {
-      allocations_.erase(it);
-      return;
+  auto it = allocations_.find(ptr);
+  assert(it != allocations_.end() && "Unknown buffer to deallocate");
+  size_t begin = it->first;
+  size_t end = it->second;
+  allocations_.erase(it);
+
+  if (end == frontier_) {
+    // The freed block was the top allocation; the frontier retreats to the
+    // end of the highest remaining allocation.
+    frontier_ = allocations_.empty() ? 0 : allocations_.rbegin()->second;
+    // A free segment that ended right below the freed block is now above the
+    // frontier and becomes part of the implicitly free region.
+    auto reclaimed = freeByAddr_.lower_bound(frontier_);
+    if (reclaimed != freeByAddr_.end()) {
+      assert(reclaimed->first + reclaimed->second <= begin &&
+             "Free segment above the frontier must end at the freed block");
+      removeFreeSegment(reclaimed->first, reclaimed->second);
     }
+    return;
+  }
+
+  // Coalesce with a preceding free segment that ends at the freed block.
+  auto next = freeByAddr_.lower_bound(begin);
+  if (next != freeByAddr_.begin()) {
+    auto prev = std::prev(next);
+    if (prev->first + prev->second == begin) {
+      begin = prev->first;
+      removeFreeSegment(prev->first, prev->second);
+    }
+  }
+  // Coalesce with a following free segment that starts at the freed block's
+  // end.
+  auto after = freeByAddr_.find(end);
+  if (after != freeByAddr_.end()) {
+    end += after->second;
+    removeFreeSegment(after->first, after->second);
   }
-  assert(false && "Unknown buffer to allocate");
+  insertFreeSegment(begin, end - begin);
 }
@@ -18,13 +18,27 @@
 
 #include "glow/Backends/Backend.h"
 #include "glow/Graph/Graph.h"
+#include "glow/Graph/Nodes.h"
 #include "glow/IR/IR.h"
 #include "glow/IR/IRBuilder.h"
 #include "glow/IR/Instrs.h"
 #include "glow/Optimizer/Optimizer.h"
+#include "glow/Quantization/Base/Profile.h"
+#include "glow/Support/Memory.h"
+#include "glow/Support/Statistic.h"
 
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <thread>
 
 using namespace glow;
 
@@ -36,6 +50,18 @@ static llvm::cl::opt<std::string>
 
 static llvm::cl::opt<bool> dumpIR("dump-ir",
                                   llvm::cl::desc("Prints IR to stdout"));
+
+static llvm::cl::opt<std::string> backendProbeCache(
+    "backend-probe-cache",
+    llvm::cl::desc("File that caches the backend auto-selection decision "
+                   "for this host; an empty name disables the cache"),
+    llvm::cl::value_desc("file"));
+
+static llvm::cl::opt<bool> enableCompileCache(
+    "compile-cache",
+    llvm::cl::desc("Reuse compiled functions across structurally identical "
+                   "compilations instead of invoking the backend again"),
+    llvm::cl::init(true));
 } // namespace
 
 ExecutionEngine::ExecutionEngine(BackendKind backendKind)
@@ -45,16 +71,103 @@ ExecutionEngine::ExecutionEngine(BackendKind backendKind)
 void ExecutionEngine::setBackend(BackendKind backendKind) {
   backend_.reset(createBackend(backendKind));
   function_.reset();
+  // The cached functions were compiled for the old backend.
+  compileCache_.clear();
+  functionHash_ = 0;
 }
 
-ExecutionEngine::~ExecutionEngine() = default;
+ExecutionEngine::~ExecutionEngine() {
+  // Stop the runAsync() worker after it drained the queue.
+  if (runWorker_.joinable()) {
+    {
+      std::unique_lock<std::mutex> lock(runQueueMutex_);
+      runWorkerStop_ = true;
+    }
+    runQueueCV_.notify_all();
+    runWorker_.join();
+  }
+  // Stop the batching worker after it drained its queue.
+  if (batchedWorker_.joinable()) {
+    {
+      std::unique_lock<std::mutex> lock(batchedQueueMutex_);
+      batchedWorkerStop_ = true;
+    }
+    batchedQueueCV_.notify_all();
+    batchedWorker_.join();
+  }
+  // Wait for an in-flight background compilation.
+  if (compileWorker_.joinable()) {
+    compileWorker_.join();
+  }
+}
 
 void ExecutionEngine::run(llvm::ArrayRef<Variable *> vars,
                           llvm::ArrayRef<Tensor *> inputs) {
-  assert(function_ && "No function has been compiled");
+  // Install a function compiled in the background, if one is ready. The
+  // swap happens between runs, so the outgoing function finishes its last
+  // execution before it is destroyed.
+  {
+    std::lock_guard<std::mutex> lock(pendingFunctionMutex_);
+    if (pendingFunction_) {
+      function_ = std::move(pendingFunction_);
+    }
+  }
   assert(inputs.size() == vars.size() &&
          "The number of inputs does not match the number of variables");
 
+  // When several batch-size variants are compiled, the leading dimension of
+  // the first input selects the one to run, and the variables are remapped
+  // to the variant's own public variables.
+  if (!batchVariants_.empty()) {
+    assert(!inputs.empty() && "Batch dispatch requires at least one input");
+    size_t batch = inputs[0]->dims()[0];
+    BatchVariant *variant = nullptr;
+    for (auto &BV : batchVariants_) {
+      if (BV.batchSize == batch) {
+        variant = &BV;
+        break;
+      }
+    }
+    if (!variant && bucketedDispatch_) {
+      // Route a variable-length input to the smallest bucket that fits.
+      for (auto &BV : batchVariants_) {
+        if (BV.batchSize >= batch &&
+            (!variant || BV.batchSize < variant->batchSize)) {
+          variant = &BV;
+        }
+      }
+      assert(variant && "No bucket fits the input length");
+      // Load the real rows and zero-pad the bucket's tail. The padded rows
+      // are computed and discarded; the bucket list bounds how many.
+      for (int i = 0, e = vars.size(); i < e; i++) {
+        assert(vars[i]->getVisibilityKind() == VisibilityKind::Public &&
+               "Trying to update a private variable");
+        Variable *v = variant->varMap.lookup(vars[i]);
+        auto &payload = (v ? v : vars[i])->getPayload();
+        size_t inBytes = inputs[i]->getSizeInBytes();
+        size_t varBytes = payload.getSizeInBytes();
+        assert(inBytes == varBytes / variant->batchSize * batch &&
+               "Input is not a leading slice of the bucket variable");
+        std::memcpy(payload.getUnsafePtr(), inputs[i]->getUnsafePtr(),
+                    inBytes);
+        std::memset(payload.getUnsafePtr() + inBytes, 0, varBytes - inBytes);
+      }
+      variant->function->execute();
+      return;
+    }
+    assert(variant && "No compiled variant matches the input batch size");
+    for (int i = 0, e = vars.size(); i < e; i++) {
+      assert(vars[i]->getVisibilityKind() == VisibilityKind::Public &&
+             "Trying to update a private variable");
+      Variable *v = variant->varMap.lookup(vars[i]);
+      loadValueFromTensor(v ? v : vars[i], inputs[i]);
+    }
+    variant->function->execute();
+    return;
+  }
+
+  assert(function_ && "No function has been compiled");
+
   // Update the input variables.
   for (int i = 0, e = vars.size(); i < e; i++) {
     assert(vars[i]->getVisibilityKind() == VisibilityKind::Public &&
@@ -65,6 +178,379 @@ void ExecutionEngine::run(llvm::ArrayRef<Variable *> vars,
   function_->execute();
 }
 
+ExecutionContext::ExecutionContext(CompiledFunction *function)
+    : function_(function) {
+  size_t weightsSize = function_->getMutableWeightsSize();
+  if (weightsSize) {
+    mutableWeights_ = alignedAlloc(weightsSize, TensorAlignment);
+  }
+  size_t activationsSize = function_->getActivationsSize();
+  if (activationsSize) {
+    activations_ = alignedAlloc(activationsSize, TensorAlignment);
+  }
+}
+
+ExecutionContext::~ExecutionContext() {
+  alignedFree(mutableWeights_);
+  alignedFree(activations_);
+}
+
+Tensor ExecutionContext::getTensor(const Variable *v) const {
+  auto offset = function_->getMutableWeightOffset(v);
+  return Tensor(static_cast<char *>(mutableWeights_) + offset, v->getType());
+}
+
+void ExecutionContext::execute() {
+  function_->executeWithContext(mutableWeights_, activations_);
+}
+
+std::unique_ptr<ExecutionContext> ExecutionEngine::createContext() {
+  assert(function_ && "No function has been compiled");
+  assert(function_->getMutableWeightsSize() &&
+         "Backend does not support execution contexts");
+  auto ctx =
+      std::unique_ptr<ExecutionContext>(new ExecutionContext(function_.get()));
+  // Seed the context with the current values of the public variables, so
+  // that a fresh context behaves like run() would.
+  for (auto *v : M_.getVars()) {
+    if (v->getVisibilityKind() != VisibilityKind::Public) {
+      continue;
+    }
+    ctx->getTensor(v).copyFrom(&v->getPayload());
+  }
+  return ctx;
+}
+
+void ExecutionEngine::runWithContext(ExecutionContext *ctx,
+                                     llvm::ArrayRef<Variable *> vars,
+                                     llvm::ArrayRef<Tensor *> inputs) {
+  assert(inputs.size() == vars.size() &&
+         "The number of inputs does not match the number of variables");
+  // Update the context's copies of the input variables.
+  for (int i = 0, e = vars.size(); i < e; i++) {
+    assert(vars[i]->getVisibilityKind() == VisibilityKind::Public &&
+           "Trying to update a private variable");
+    ctx->getTensor(vars[i]).copyFrom(inputs[i]);
+  }
+  ctx->execute();
+}
+
+void ExecutionEngine::runWithBoundIO(llvm::ArrayRef<Variable *> vars,
+                                     llvm::ArrayRef<void *> buffers) {
+  assert(function_ && "No function has been compiled");
+  assert(buffers.size() == vars.size() &&
+         "The number of buffers does not match the number of variables");
+  assert(backend_->supportsBoundIO() &&
+         "Backend does not observe payloads rebound after compilation");
+
+  // Rebind the payload of every bound variable to the caller's buffer. The
+  // original payloads are saved and restored below; moving a Tensor only
+  // swaps its members, so the unowned temporaries never free the payload
+  // memory.
+  std::vector<Tensor> saved;
+  saved.reserve(vars.size());
+  for (int i = 0, e = vars.size(); i < e; i++) {
+    assert(vars[i]->getVisibilityKind() == VisibilityKind::Public &&
+           "Trying to bind a private variable");
+    saved.emplace_back(std::move(vars[i]->getPayload()));
+    vars[i]->getPayload() = Tensor(buffers[i], vars[i]->getType());
+  }
+
+  function_->execute();
+
+  // Restore the original payloads. The results of the run are left in the
+  // bound output buffers.
+  for (int i = 0, e = vars.size(); i < e; i++) {
+    vars[i]->getPayload() = std::move(saved[i]);
+  }
+}
+
+void ExecutionEngine::runSharded(llvm::ArrayRef<Variable *> vars,
+                                 llvm::ArrayRef<Tensor *> inputs,
+                                 llvm::ArrayRef<Variable *> outputVars,
+                                 llvm::ArrayRef<Tensor *> results) {
+  assert(function_ && "No function has been compiled");
+  assert(inputs.size() == vars.size() &&
+         "The number of inputs does not match the number of variables");
+  assert(results.size() == outputVars.size() &&
+         "The number of results does not match the number of variables");
+  assert(!vars.empty() && "Expected at least one input");
+
+  // The function is compiled for the shard batch size; the inputs carry a
+  // multiple of it.
+  size_t shardBatch = vars[0]->dims()[0];
+  size_t totalBatch = inputs[0]->dims()[0];
+  assert(totalBatch % shardBatch == 0 &&
+         "The batch must divide evenly into shards of the compiled size");
+  size_t numShards = totalBatch / shardBatch;
+
+  // One private context per shard. The contexts are independent, so the
+  // shards execute concurrently.
+  std::vector<std::unique_ptr<ExecutionContext>> contexts;
+  for (size_t s = 0; s < numShards; s++) {
+    contexts.push_back(createContext());
+  }
+
+  auto runShard = [&](size_t s) {
+    auto *ctx = contexts[s].get();
+    // Load this shard's slice of every input. The batch is the outermost
+    // dimension, so a slice of consecutive samples is contiguous.
+    for (size_t i = 0, e = vars.size(); i < e; i++) {
+      auto t = ctx->getTensor(vars[i]);
+      size_t shardBytes = t.getSizeInBytes();
+      assert(inputs[i]->getSizeInBytes() == shardBytes * numShards &&
+             "Input does not hold one slice of every shard");
+      std::memcpy(t.getUnsafePtr(),
+                  inputs[i]->getUnsafePtr() + s * shardBytes, shardBytes);
+    }
+    ctx->execute();
+    // Reassemble this shard's slice of every result.
+    for (size_t i = 0, e = outputVars.size(); i < e; i++) {
+      auto t = ctx->getTensor(outputVars[i]);
+      size_t shardBytes = t.getSizeInBytes();
+      assert(results[i]->getSizeInBytes() == shardBytes * numShards &&
+             "Result does not hold one slice of every shard");
+      std::memcpy(results[i]->getUnsafePtr() + s * shardBytes,
+                  t.getUnsafePtr(), shardBytes);
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (size_t s = 0; s < numShards; s++) {
+    workers.emplace_back(runShard, s);
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+}
+
+void ExecutionEngine::runProfile(Function *F, size_t iterations,
+                                 llvm::ArrayRef<Variable *> vars,
+                                 llvm::ArrayRef<Tensor *> inputs,
+                                 unsigned numThreads) {
+  assert(function_ && "No function has been compiled");
+  assert(!inputs.empty() && "No inputs");
+  assert(inputs.size() == vars.size() &&
+         "The number of inputs does not match the number of variables");
+
+  if (numThreads == 0) {
+    numThreads = std::thread::hardware_concurrency();
+  }
+  numThreads = std::max<unsigned>(
+      1, std::min<unsigned>(numThreads, iterations ? iterations : 1));
+
+  // One private context per worker. The histogram and computationInfo
+  // variables live in the mutable weights arena, so each worker accumulates
+  // an independent profile without synchronizing on the shared state that
+  // forces calibration to run serially otherwise.
+  std::vector<std::unique_ptr<ExecutionContext>> contexts;
+  for (unsigned t = 0; t < numThreads; t++) {
+    contexts.push_back(createContext());
+  }
+
+  // The workers pull batch indices from a shared counter, so a slow batch
+  // does not stall the rest of the dataset.
+  std::atomic<size_t> nextBatch{0};
+  auto profileWorker = [&](unsigned t) {
+    auto *ctx = contexts[t].get();
+    for (size_t i = nextBatch++; i < iterations; i = nextBatch++) {
+      // Load the i-th slice of every input into the context, like
+      // updateInputsAndRunNetwork() does for run().
+      for (size_t j = 0, e = vars.size(); j < e; j++) {
+        auto in = ctx->getTensor(vars[j]);
+        size_t slc = (i * in.dims()[0]) % inputs[j]->dims()[0];
+        in.copyConsecutiveSlices(inputs[j], slc);
+      }
+      ctx->execute();
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (unsigned t = 0; t < numThreads; t++) {
+    workers.emplace_back(profileWorker, t);
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+
+  // Merge every worker's accumulators into the profile variables of \p F,
+  // where generateNodeQuantizationInfos() reads them.
+  for (auto &node : F->getNodes()) {
+    auto *QPN = llvm::dyn_cast<QuantizationProfileNode>(&node);
+    if (!QPN) {
+      continue;
+    }
+    auto histogram = QPN->getHistogramVar()->getHandle<float>();
+    auto CI = QPN->getComputationInfoVar()->getHandle<float>();
+    float &min = CI.raw(0);
+    float &max = CI.raw(1);
+
+    for (auto &ctx : contexts) {
+      Tensor ctxHistogram = ctx->getTensor(QPN->getHistogramVar());
+      Tensor ctxCI = ctx->getTensor(QPN->getComputationInfoVar());
+      auto ctxCIH = ctxCI.getHandle<float>();
+      quantization::mergeTensorHistogram(histogram,
+                                         ctxHistogram.getHandle<float>(), min,
+                                         max, ctxCIH.raw(0), ctxCIH.raw(1));
+    }
+  }
+}
+
+std::future<void> ExecutionEngine::runAsync(llvm::ArrayRef<Variable *> vars,
+                                            llvm::ArrayRef<Tensor *> inputs) {
+  assert(function_ && "No function has been compiled");
+  RunRequest request;
+  request.vars.assign(vars.begin(), vars.end());
+  request.inputs.assign(inputs.begin(), inputs.end());
+  auto future = request.done.get_future();
+
+  std::unique_lock<std::mutex> lock(runQueueMutex_);
+  // Start the worker on the first request.
+  if (!runWorker_.joinable()) {
+    runWorker_ = std::thread([this] { runWorkerLoop(); });
+  }
+  // The queue is bounded: block the caller instead of buffering an
+  // unbounded amount of work.
+  runQueueCV_.wait(lock,
+                   [this] { return runQueue_.size() < maxPendingRequests; });
+  runQueue_.push_back(std::move(request));
+  lock.unlock();
+  runQueueCV_.notify_all();
+  return future;
+}
+
+void ExecutionEngine::runWorkerLoop() {
+  std::unique_lock<std::mutex> lock(runQueueMutex_);
+  while (true) {
+    runQueueCV_.wait(
+        lock, [this] { return runWorkerStop_ || !runQueue_.empty(); });
+    if (runQueue_.empty()) {
+      // Told to stop and the queue is drained.
+      return;
+    }
+    RunRequest request = std::move(runQueue_.front());
+    runQueue_.pop_front();
+    // A queue slot became free; unblock a waiting producer. Execute the
+    // request outside of the lock, so producers queue new requests while
+    // the function runs.
+    lock.unlock();
+    runQueueCV_.notify_all();
+    run(request.vars, request.inputs);
+    request.done.set_value();
+    lock.lock();
+  }
+}
+
+void ExecutionEngine::enableBatching(CompilationMode mode, Function *F,
+                                     size_t maxBatch,
+                                     unsigned timeoutMicroseconds) {
+  assert(maxBatch > 1 && "Coalescing needs a batch of at least two");
+  assert(!batchedWorker_.joinable() && "Batching is already enabled");
+  // The coalesced clone shares the weights with \p F; densify them once
+  // before cloning.
+  if (!backend_->supportsSparseWeights()) {
+    densifySparseWeights(F);
+  }
+  auto name = F->getName().str() + ".coalesced" + std::to_string(maxBatch);
+  auto *FB = F->cloneWithNewBatch(name, maxBatch, &batchedVarMap_);
+  auto IR = generateIR(mode, FB);
+  batchedFunction_ = backend_->compile(std::move(IR));
+  batchedMaxBatch_ = maxBatch;
+  batchedTimeoutUs_ = timeoutMicroseconds;
+  batchedWorker_ = std::thread([this] { batchedWorkerLoop(); });
+}
+
+std::future<void> ExecutionEngine::runBatched(
+    llvm::ArrayRef<Variable *> vars, llvm::ArrayRef<Tensor *> inputs,
+    llvm::ArrayRef<Variable *> outputVars, llvm::ArrayRef<Tensor *> results) {
+  assert(batchedFunction_ && "Batching has not been enabled");
+  assert(inputs.size() == vars.size() &&
+         "The number of inputs does not match the number of variables");
+  assert(results.size() == outputVars.size() &&
+         "The number of results does not match the number of variables");
+  BatchedRequest request;
+  request.vars.assign(vars.begin(), vars.end());
+  request.inputs.assign(inputs.begin(), inputs.end());
+  request.outputVars.assign(outputVars.begin(), outputVars.end());
+  request.results.assign(results.begin(), results.end());
+  auto future = request.done.get_future();
+
+  std::unique_lock<std::mutex> lock(batchedQueueMutex_);
+  // The queue is bounded like the runAsync() queue: block the caller
+  // instead of buffering an unbounded amount of work.
+  batchedQueueCV_.wait(lock, [this] {
+    return batchedQueue_.size() < maxPendingRequests;
+  });
+  batchedQueue_.push_back(std::move(request));
+  lock.unlock();
+  batchedQueueCV_.notify_all();
+  return future;
+}
+
+void ExecutionEngine::batchedWorkerLoop() {
+  std::unique_lock<std::mutex> lock(batchedQueueMutex_);
+  while (true) {
+    batchedQueueCV_.wait(
+        lock, [this] { return batchedWorkerStop_ || !batchedQueue_.empty(); });
+    if (batchedQueue_.empty()) {
+      // Told to stop and the queue is drained.
+      return;
+    }
+    // Wait for a full batch, but only up to the deadline: the requests
+    // already queued must not pay more than the configured latency for the
+    // stragglers.
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::microseconds(batchedTimeoutUs_);
+    batchedQueueCV_.wait_until(lock, deadline, [this] {
+      return batchedWorkerStop_ || batchedQueue_.size() >= batchedMaxBatch_;
+    });
+
+    // Claim up to a full batch of requests and release the queue, so new
+    // requests accumulate while this batch executes.
+    std::vector<BatchedRequest> batch;
+    while (!batchedQueue_.empty() && batch.size() < batchedMaxBatch_) {
+      batch.push_back(std::move(batchedQueue_.front()));
+      batchedQueue_.pop_front();
+    }
+    lock.unlock();
+    batchedQueueCV_.notify_all();
+
+    // Gather every request's inputs into its row of the coalesced
+    // variables. A partially filled batch leaves the remaining rows stale;
+    // their results are never read.
+    for (size_t r = 0, numReqs = batch.size(); r < numReqs; r++) {
+      auto &req = batch[r];
+      for (size_t i = 0, e = req.vars.size(); i < e; i++) {
+        Variable *BV = batchedVarMap_.lookup(req.vars[i]);
+        auto &payload = (BV ? BV : req.vars[i])->getPayload();
+        size_t rowBytes = req.inputs[i]->getSizeInBytes();
+        assert(payload.getSizeInBytes() == rowBytes * batchedMaxBatch_ &&
+               "Input is not one row of the coalesced variable");
+        std::memcpy(payload.getUnsafePtr() + r * rowBytes,
+                    req.inputs[i]->getUnsafePtr(), rowBytes);
+      }
+    }
+
+    batchedFunction_->execute();
+
+    // Scatter each request's rows of the results back and wake the caller.
+    for (size_t r = 0, numReqs = batch.size(); r < numReqs; r++) {
+      auto &req = batch[r];
+      for (size_t i = 0, e = req.outputVars.size(); i < e; i++) {
+        Variable *BV = batchedVarMap_.lookup(req.outputVars[i]);
+        auto &payload = (BV ? BV : req.outputVars[i])->getPayload();
+        size_t rowBytes = req.results[i]->getSizeInBytes();
+        assert(payload.getSizeInBytes() == rowBytes * batchedMaxBatch_ &&
+               "Result is not one row of the coalesced variable");
+        std::memcpy(req.results[i]->getUnsafePtr(),
+                    payload.getUnsafePtr() + r * rowBytes, rowBytes);
+      }
+      req.done.set_value();
+    }
+    lock.lock();
+  }
+}
+
 void ExecutionEngine::runBatch(size_t iterations,
                                llvm::ArrayRef<Variable *> vars,
                                llvm::ArrayRef<Tensor *> inputs) {
@@ -87,6 +573,249 @@ void ExecutionEngine::runBatch(size_t iterations,
   }
 }
 
+void ExecutionEngine::runBatchPrefetch(size_t iterations,
+                                       llvm::ArrayRef<Variable *> vars,
+                                       llvm::ArrayRef<Tensor *> inputs) {
+  static size_t trainCounter = 0;
+
+  assert(function_ && "No function has been compiled");
+  assert(!inputs.empty() && "No inputs");
+  assert(inputs.size() == vars.size() &&
+         "The number of inputs does not match the number of variables");
+
+  // This is the size of one batch (the number of samples in the batch).
+  size_t batchSize = vars[0]->getType()->dims()[0];
+
+  // One staging tensor per input variable and buffer half. The prefetcher
+  // fills one half while the training step consumes the other.
+  constexpr unsigned numBuffers = 2;
+  std::vector<Tensor> buffers[numBuffers];
+  for (unsigned b = 0; b < numBuffers; b++) {
+    for (auto *v : vars) {
+      buffers[b].emplace_back(v->getType());
+    }
+  }
+
+  std::mutex mtx;
+  std::condition_variable cv;
+  bool ready[numBuffers] = {false, false};
+
+  std::thread prefetcher([&] {
+    size_t counter = trainCounter;
+    for (size_t i = 0; i < iterations; i++) {
+      unsigned b = i % numBuffers;
+      {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, [&] { return !ready[b]; });
+      }
+      for (size_t j = 0, e = inputs.size(); j < e; j++) {
+        size_t slc = counter % inputs[j]->dims()[0];
+        buffers[b][j].copyConsecutiveSlices(inputs[j], slc);
+      }
+      {
+        std::lock_guard<std::mutex> lock(mtx);
+        ready[b] = true;
+      }
+      cv.notify_all();
+      counter += batchSize;
+    }
+  });
+
+  for (size_t i = 0; i < iterations; i++) {
+    unsigned b = i % numBuffers;
+    {
+      std::unique_lock<std::mutex> lock(mtx);
+      cv.wait(lock, [&] { return ready[b]; });
+    }
+    // Install the staged micro-batch and hand the buffer half back to the
+    // prefetcher before running the network.
+    for (size_t j = 0, e = vars.size(); j < e; j++) {
+      vars[j]->getPayload().copyFrom(&buffers[b][j]);
+    }
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      ready[b] = false;
+    }
+    cv.notify_all();
+    function_->execute();
+  }
+  prefetcher.join();
+
+  trainCounter += iterations * batchSize;
+}
+
+void ExecutionEngine::compileUpdate(CompilationMode mode, Function *F) {
+  // Record the gradient accumulator variables before the graph is
+  // optimized away from under us: they are exactly the variables that the
+  // update function clears with a splat save after consuming them.
+  // runBatchParallel() reduces the per-worker copies of these variables.
+  gradAccVars_.clear();
+  for (auto &node : F->getNodes()) {
+    auto *save = llvm::dyn_cast<SaveNode>(&node);
+    if (!save || !llvm::isa<SplatNode>(save->getInput().getNode())) {
+      continue;
+    }
+    gradAccVars_.push_back(llvm::cast<Variable>(save->getOutput().getNode()));
+  }
+  updateFunction_ = backend_->compile(generateIR(mode, F));
+}
+
+void ExecutionEngine::runBatch(size_t iterations,
+                               llvm::ArrayRef<Variable *> vars,
+                               llvm::ArrayRef<Tensor *> inputs,
+                               size_t accumSteps) {
+  static size_t trainCounter = 0;
+
+  assert(function_ && "No function has been compiled");
+  assert(updateFunction_ && "No update function has been compiled");
+  assert(accumSteps > 0 && "Invalid number of accumulation steps");
+  assert(!inputs.empty() && "No inputs");
+  assert(inputs.size() == vars.size() &&
+         "The number of inputs does not match the number of variables");
+
+  // This is the size of one batch (the number of samples in the batch).
+  size_t batchSize = vars[0]->getType()->dims()[0];
+
+  for (size_t i = 0; i < iterations; i++) {
+    // Run the forward and backward pass of one micro-batch; the gradients
+    // accumulate into the gradient variables.
+    updateInputsAndRunNetwork(vars, inputs, trainCounter);
+    trainCounter += batchSize;
+
+    // Apply the weight update once per accumulation cycle. The update
+    // also clears the accumulators for the next cycle.
+    if ((i + 1) % accumSteps == 0) {
+      updateFunction_->execute();
+    }
+  }
+}
+
+void ExecutionEngine::runBatchParallel(size_t iterations,
+                                       llvm::ArrayRef<Variable *> vars,
+                                       llvm::ArrayRef<Tensor *> inputs,
+                                       unsigned numWorkers) {
+  static size_t trainCounter = 0;
+
+  assert(function_ && "No function has been compiled");
+  assert(updateFunction_ && "No update function has been compiled");
+  assert(!gradAccVars_.empty() &&
+         "The function was not differentiated with gradient accumulation");
+  assert(!inputs.empty() && "No inputs");
+  assert(inputs.size() == vars.size() &&
+         "The number of inputs does not match the number of variables");
+
+  if (numWorkers == 0) {
+    numWorkers = std::thread::hardware_concurrency();
+  }
+  numWorkers = std::max<unsigned>(1, numWorkers);
+
+  // This is the size of one micro-batch (the number of samples per worker).
+  size_t batchSize = vars[0]->getType()->dims()[0];
+
+  // One private context per worker. The weights are private variables, so
+  // every context reads the one shared copy; the inputs and the gradient
+  // accumulators are public, so every worker owns a private copy of them.
+  std::vector<std::unique_ptr<ExecutionContext>> contexts;
+  for (unsigned w = 0; w < numWorkers; w++) {
+    contexts.push_back(createContext());
+  }
+
+  // The workers run one micro-batch per step and then wait out the serial
+  // reduce-and-update phase: the update writes the shared weights, so it
+  // must not overlap with a forward pass reading them.
+  std::mutex mtx;
+  std::condition_variable cv;
+  size_t step = 0;
+  size_t base = 0;
+  unsigned done = 0;
+  bool stop = false;
+
+  auto trainWorker = [&](unsigned w) {
+    size_t lastStep = 0;
+    while (true) {
+      size_t sampleIdx;
+      {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, [&] { return stop || step != lastStep; });
+        if (stop) {
+          return;
+        }
+        lastStep = step;
+        sampleIdx = base + w * batchSize;
+      }
+      auto *ctx = contexts[w].get();
+      // This worker's share of the step starts from a zero gradient; the
+      // reduction below sums the shares.
+      for (auto *GA : gradAccVars_) {
+        ctx->getTensor(GA).zero();
+      }
+      // Load this worker's micro-batch slice of every input, like
+      // updateInputsAndRunNetwork() does for runBatch().
+      for (size_t j = 0, e = vars.size(); j < e; j++) {
+        auto in = ctx->getTensor(vars[j]);
+        in.copyConsecutiveSlices(inputs[j], sampleIdx % inputs[j]->dims()[0]);
+      }
+      ctx->execute();
+      {
+        std::lock_guard<std::mutex> lock(mtx);
+        done++;
+      }
+      cv.notify_all();
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (unsigned w = 0; w < numWorkers; w++) {
+    workers.emplace_back(trainWorker, w);
+  }
+
+  for (size_t i = 0; i < iterations; i++) {
+    // Release the workers on the next step.
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      base = trainCounter;
+      done = 0;
+      step++;
+    }
+    cv.notify_all();
+    // Wait for every worker's backward pass.
+    {
+      std::unique_lock<std::mutex> lock(mtx);
+      cv.wait(lock, [&] { return done == numWorkers; });
+    }
+    // Reduce the per-worker gradients into the shared accumulators, where
+    // the update function reads them. The shared payloads hold zeros here:
+    // the accumulators are zero-initialized and the update clears them
+    // after every cycle, like in the serial accumulation path.
+    for (auto *GA : gradAccVars_) {
+      assert(GA->getType()->getElementType() == ElemKind::FloatTy &&
+             "Gradients are float tensors");
+      auto *sum = reinterpret_cast<float *>(GA->getPayload().getUnsafePtr());
+      size_t numElem = GA->getType()->size();
+      for (auto &ctx : contexts) {
+        Tensor t = ctx->getTensor(GA);
+        auto *part = reinterpret_cast<const float *>(t.getUnsafePtr());
+        for (size_t e = 0; e < numElem; e++) {
+          sum[e] += part[e];
+        }
+      }
+    }
+    // Apply the weight update once per step. The update also clears the
+    // shared accumulators for the next cycle.
+    updateFunction_->execute();
+    trainCounter += batchSize * numWorkers;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    stop = true;
+  }
+  cv.notify_all();
+  for (auto &w : workers) {
+    w.join();
+  }
+}
+
 void ExecutionEngine::updateInputsAndRunNetwork(llvm::ArrayRef<Variable *> vars,
                                                 llvm::ArrayRef<Tensor *> inputs,
                                                 size_t sampleIdx) {
@@ -122,6 +851,12 @@ void ExecutionEngine::loadValueFromTensor(Variable *v, Tensor *input) {
 
 std::unique_ptr<IRFunction> ExecutionEngine::generateIR(CompilationMode mode,
                                                         Function *F) {
+  return generateIR(mode, F, *backend_);
+}
+
+std::unique_ptr<IRFunction>
+ExecutionEngine::generateIR(CompilationMode mode, Function *F,
+                            Backend &backend) {
   // Verify the function pre-optimization/lowering.
   F->verify();
 
@@ -129,20 +864,20 @@ std::unique_ptr<IRFunction> ExecutionEngine::generateIR(CompilationMode mode,
   ::glow::optimize(F, mode);
 
   // Allow the backend to transform the graph prior to lowering.
-  if (backend_->transformPreLowering(F, mode)) {
+  if (backend.transformPreLowering(F, mode)) {
     // Optimize the graph again after the backend transformation.
     // In particular, DCE is very likely to be useful.
     ::glow::optimize(F, mode);
   }
 
   // Lower the graph into a sequence of low-level linear algebra operations.
-  ::glow::lower(F, *backend_);
+  ::glow::lower(F, backend);
 
   // Optimize the graph again.
   ::glow::optimize(F, mode);
 
   // Allow the backend to transform the graph after lowering.
-  if (backend_->transformPostLowering(F, mode)) {
+  if (backend.transformPostLowering(F, mode)) {
     // Optimize the graph again after the backend transformation.
     // In particular, DCE is very likely to be useful.
     ::glow::optimize(F, mode);
@@ -155,7 +890,10 @@ std::unique_ptr<IRFunction> ExecutionEngine::generateIR(CompilationMode mode,
   IR->generateIR();
 
   // Optimize the generated IR.
-  ::glow::optimize(*IR, mode, *backend_);
+  ::glow::optimize(*IR, mode, backend);
+
+  // The footprint of the optimized IR is final; record it for reporting.
+  memoryUsage_ = collectMemoryUsage(*IR);
 
   // If requested, dump IR to stdout and/or dot file for debugging.
   if (dumpIR) {
@@ -168,11 +906,525 @@ std::unique_ptr<IRFunction> ExecutionEngine::generateIR(CompilationMode mode,
   return IR;
 }
 
+/// \returns a structural hash of the optimized IR \p IR. The hash covers
+/// the printed form of every instruction - the instruction kinds, the
+/// types and the parameters - and the identity of the variables that back
+/// the weights. The weight contents do not participate, so functions that
+/// differ only in the values of their weights hash alike and can share
+/// compiled code.
+static size_t structuralHash(const IRFunction *IR) {
+  std::string text;
+  llvm::raw_string_ostream os(text);
+  for (const auto &I : IR->getInstrs()) {
+    I.dump(os);
+    os << '\n';
+  }
+  llvm::hash_code hash = llvm::hash_value(os.str());
+  // The weights participate by reference: the backends resolve them
+  // through the variable payloads, so a cached function is only valid for
+  // a graph over the same variables.
+  for (auto *v : IR->getGraph()->getParent()->getVars()) {
+    if (!IR->getWeightForNode(v)) {
+      continue;
+    }
+    hash = llvm::hash_combine(hash, reinterpret_cast<uintptr_t>(v));
+  }
+  return hash;
+}
+
 void ExecutionEngine::compile(CompilationMode mode, Function *F) {
-  function_ = backend_->compile(generateIR(mode, F));
+  // Collect a fresh set of pass statistics for this compilation.
+  clearPassStats();
+  // A single-batch compilation replaces any batch-size variants.
+  batchVariants_.clear();
+  bucketedDispatch_ = false;
+  // Backends without sparse kernels fall back to the dense representation.
+  if (!backend_->supportsSparseWeights()) {
+    densifySparseWeights(F);
+  }
+  auto IR = generateIR(mode, F);
+
+  if (!enableCompileCache) {
+    function_ = backend_->compile(std::move(IR));
+  } else {
+    size_t hash = structuralHash(IR.get());
+    if (!function_ || hash != functionHash_) {
+      // Stash the installed function for later reuse, then look for a
+      // cached compilation of the same structure before invoking the
+      // backend.
+      if (function_) {
+        compileCache_[functionHash_] = std::move(function_);
+      }
+      auto it = compileCache_.find(hash);
+      if (it != compileCache_.end()) {
+        function_ = std::move(it->second);
+        compileCache_.erase(it);
+      } else {
+        function_ = backend_->compile(std::move(IR));
+      }
+      functionHash_ = hash;
+    }
+    // Otherwise the installed function already implements this IR; keep
+    // serving it.
+  }
+  if (passStatsEnabled()) {
+    dumpPassStats(llvm::outs());
+  }
+  if (statisticsEnabled()) {
+    dumpStatistics(llvm::outs());
+  }
+}
+
+void ExecutionEngine::compile(CompilationMode mode, Function *F,
+                              llvm::ArrayRef<size_t> batchSizes) {
+  assert(!batchSizes.empty() && "No batch sizes to compile for");
+  clearPassStats();
+  batchVariants_.clear();
+  bucketedDispatch_ = false;
+  // The weights are shared between the variants; densify them once before
+  // cloning.
+  if (!backend_->supportsSparseWeights()) {
+    densifySparseWeights(F);
+  }
+  for (size_t batchSize : batchSizes) {
+    BatchVariant variant;
+    variant.batchSize = batchSize;
+    auto name = F->getName().str() + ".batch" + std::to_string(batchSize);
+    auto *FB = F->cloneWithNewBatch(name, batchSize, &variant.varMap);
+    auto IR = generateIR(mode, FB);
+    variant.function = backend_->compile(std::move(IR));
+    batchVariants_.push_back(std::move(variant));
+  }
+}
+
+void ExecutionEngine::compileBucketed(CompilationMode mode, Function *F,
+                                      llvm::ArrayRef<size_t> buckets) {
+  compile(mode, F, buckets);
+  bucketedDispatch_ = true;
+}
+
+size_t ExecutionEngine::selectBucket(size_t length) const {
+  assert(bucketedDispatch_ && "No bucketed compilation");
+  size_t best = 0;
+  for (auto &BV : batchVariants_) {
+    if (BV.batchSize >= length && (best == 0 || BV.batchSize < best)) {
+      best = BV.batchSize;
+    }
+  }
+  assert(best && "No bucket fits this length");
+  return best;
+}
+
+Variable *ExecutionEngine::getVariantVariable(Variable *v,
+                                              size_t batchSize) const {
+  for (auto &BV : batchVariants_) {
+    if (BV.batchSize != batchSize) {
+      continue;
+    }
+    Variable *NV = BV.varMap.lookup(v);
+    return NV ? NV : v;
+  }
+  GLOW_UNREACHABLE("No compiled variant for this batch size");
+}
+
+/// \returns the name of the backend kind \p kind, used by the per-host
+/// backend selection cache.
+static const char *backendKindName(BackendKind kind) {
+  switch (kind) {
+  case BackendKind::Interpreter:
+    return "Interpreter";
+  case BackendKind::OpenCL:
+    return "OpenCL";
+  case BackendKind::CPU:
+    return "CPU";
+  }
+
+  llvm_unreachable("unreachable");
+}
+
+BackendKind ExecutionEngine::selectBackend(Function *F,
+                                           llvm::ArrayRef<Variable *> vars,
+                                           llvm::ArrayRef<Tensor *> inputs,
+                                           llvm::ArrayRef<BackendKind> candidates) {
+  assert(!candidates.empty() && "Expected at least one candidate backend");
+
+  // A previous startup on this host may have probed already.
+  if (!backendProbeCache.empty()) {
+    std::ifstream in(backendProbeCache);
+    std::string name;
+    if (in >> name) {
+      for (auto kind : candidates) {
+        if (name == backendKindName(kind) && isBackendAvailable(kind)) {
+          setBackend(kind);
+          compile(CompilationMode::Infer, F);
+          return kind;
+        }
+      }
+    }
+  }
+
+  BackendKind best = candidates[0];
+  double bestTime = std::numeric_limits<double>::max();
+  for (auto kind : candidates) {
+    if (!isBackendAvailable(kind)) {
+      continue;
+    }
+    setBackend(kind);
+    compile(CompilationMode::Infer, F);
+    // The first run pays one-time costs - JIT finalization, device program
+    // builds - that should not count against the backend.
+    run(vars, inputs);
+    // Take the fastest of a few runs as the least noisy estimate.
+    double elapsed = std::numeric_limits<double>::max();
+    for (unsigned i = 0; i < 3; i++) {
+      auto start = std::chrono::steady_clock::now();
+      run(vars, inputs);
+      std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+      elapsed = std::min(elapsed, d.count());
+    }
+    if (elapsed < bestTime) {
+      bestTime = elapsed;
+      best = kind;
+    }
+  }
+  assert(bestTime < std::numeric_limits<double>::max() &&
+         "No candidate backend is available");
+
+  // Leave the engine serving the winner.
+  setBackend(best);
+  compile(CompilationMode::Infer, F);
+
+  if (!backendProbeCache.empty()) {
+    std::ofstream out(backendProbeCache);
+    out << backendKindName(best) << "\n";
+  }
+  return best;
+}
+
+std::future<void> ExecutionEngine::compileAsync(CompilationMode mode,
+                                                Function *F) {
+  // At most one background compilation is in flight.
+  if (compileWorker_.joinable()) {
+    compileWorker_.join();
+  }
+  // Compile a clone of the function, so the optimizer mutates a private
+  // copy of the graph while \p F keeps describing the function that is
+  // serving runs.
+  Function *cloned =
+      F->clone(F->getName().str() + "_recompile" +
+               std::to_string(recompileCounter_++));
+
+  // Graph nodes and IR values come out of thread-local slab allocators, and
+  // the slabs are reclaimed when their thread exits. The cloned graph and
+  // the generated IR outlive the worker - the graph stays in the module and
+  // some backends keep the IR inside the compiled function - so all graph
+  // mutation and IRGen must happen on this thread. Only the backend code
+  // generation, which allocates no graph or IR objects, runs on the worker.
+  auto IR = generateIR(mode, cloned);
+
+  std::promise<void> compiled;
+  auto future = compiled.get_future();
+  compileWorker_ = std::thread(
+      [this, IR = std::move(IR), done = std::move(compiled)]() mutable {
+        auto function = backend_->compile(std::move(IR));
+        // Publish the new function; run() installs it between executions,
+        // so the outgoing function never disappears mid-run.
+        {
+          std::lock_guard<std::mutex> lock(pendingFunctionMutex_);
+          pendingFunction_ = std::move(function);
+        }
+        done.set_value();
+      });
+  return future;
+}
+
+void ExecutionEngine::compileDAG(CompilationMode mode, const FunctionDAG &dag) {
+  clearPassStats();
+  dagStages_.clear();
+  dagChannels_.clear();
+
+  // Compile every partition. The device affinity walks round-robin, so on
+  // backends with several devices consecutive partitions land on different
+  // devices.
+  llvm::DenseMap<Function *, unsigned> stageIndex;
+  unsigned affinity = 0;
+  for (auto *F : dag.getFunctions()) {
+    DAGStage stage;
+    stage.F = F;
+    stage.function = backend_->compile(generateIR(mode, F), affinity);
+    stageIndex[F] = affinity++;
+    dagStages_.push_back(std::move(stage));
+  }
+
+  // Turn the boundary variable pairs into mailboxes between the stages.
+  for (const auto &b : dag.getBoundaries()) {
+    BoundaryChannel ch;
+    ch.out = b.out;
+    ch.in = b.in;
+    ch.producer = stageIndex[b.producer];
+    ch.consumer = stageIndex[b.consumer];
+    dagChannels_.push_back(ch);
+  }
+
+  if (passStatsEnabled()) {
+    dumpPassStats(llvm::outs());
+  }
+  if (statisticsEnabled()) {
+    dumpStatistics(llvm::outs());
+  }
+}
+
+void ExecutionEngine::compileDAG(CompilationMode mode, const FunctionDAG &dag,
+                                 llvm::ArrayRef<BackendKind> kinds) {
+  assert(kinds.size() == dag.getFunctions().size() &&
+         "One backend kind is required per partition");
+  clearPassStats();
+  dagStages_.clear();
+  dagChannels_.clear();
+
+  // Compile every partition with a backend instance of its own kind. Each
+  // stage owns a private backend, so stages that the pipelined executor
+  // runs concurrently never share backend state, and a partition placed on
+  // e.g. the OpenCL device coexists with host partitions.
+  llvm::DenseMap<Function *, unsigned> stageIndex;
+  unsigned idx = 0;
+  for (auto *F : dag.getFunctions()) {
+    DAGStage stage;
+    stage.F = F;
+    stage.backend.reset(createBackend(kinds[idx]));
+    stage.function = stage.backend->compile(generateIR(mode, F, *stage.backend));
+    stageIndex[F] = idx++;
+    dagStages_.push_back(std::move(stage));
+  }
+
+  // Turn the boundary variable pairs into mailboxes between the stages. The
+  // boundary payloads live in host memory on both sides: the device-bound
+  // stages copy them in and out as part of their execution, so the mailbox
+  // handoff doubles as the host-device transfer and overlaps with the
+  // compute of the other stages.
+  for (const auto &b : dag.getBoundaries()) {
+    BoundaryChannel ch;
+    ch.out = b.out;
+    ch.in = b.in;
+    ch.producer = stageIndex[b.producer];
+    ch.consumer = stageIndex[b.consumer];
+    dagChannels_.push_back(ch);
+  }
+
+  if (passStatsEnabled()) {
+    dumpPassStats(llvm::outs());
+  }
+  if (statisticsEnabled()) {
+    dumpStatistics(llvm::outs());
+  }
+}
+
+/// \returns true if backend \p B reports support for the kind of \p node at
+/// the element type of each of its results.
+static bool backendSupportsNode(const Backend &B, const Node &node) {
+  for (unsigned i = 0, e = node.getNumResults(); i < e; i++) {
+    if (!B.isOpSupported(node.getKind(), node.getNthResult(i).getElementType())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::vector<BackendKind>
+ExecutionEngine::assignDAGBackends(const FunctionDAG &dag,
+                                   BackendKind preferred,
+                                   BackendKind fallback) const {
+  std::vector<BackendKind> kinds;
+  kinds.reserve(dag.getFunctions().size());
+  if (!isBackendAvailable(preferred)) {
+    kinds.assign(dag.getFunctions().size(), fallback);
+    return kinds;
+  }
+  std::unique_ptr<Backend> probe(createBackend(preferred));
+  for (auto *F : dag.getFunctions()) {
+    // Send a partition to the preferred backend only when it carries dense
+    // compute that amortizes the boundary transfers. Partitions of cheap
+    // data-movement operators - the gather/topk tails of retrieval models,
+    // for example - stay on the fallback backend.
+    bool denseCompute = false;
+    bool supported = true;
+    for (auto &N : F->getNodes()) {
+      denseCompute |= N.getKind() == Kinded::Kind::ConvolutionNodeKind ||
+                      N.getKind() == Kinded::Kind::MatMulNodeKind ||
+                      N.getKind() == Kinded::Kind::FullyConnectedNodeKind;
+      supported &= backendSupportsNode(*probe, N);
+    }
+    kinds.push_back(denseCompute && supported ? preferred : fallback);
+  }
+  return kinds;
+}
+
+/// \returns true if some node of \p F reads the variable \p V.
+static bool functionReadsVar(Function *F, Variable *V) {
+  for (auto &N : F->getNodes()) {
+    for (unsigned i = 0, e = N.getNumInputs(); i < e; i++) {
+      if (N.getNthInput(i).getNode() == V && !N.isOverwrittenNthInput(i)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void ExecutionEngine::runDAG(llvm::ArrayRef<Variable *> vars,
+                             llvm::ArrayRef<Tensor *> inputs) {
+  assert(!dagStages_.empty() && "No DAG has been compiled");
+  assert(inputs.size() == vars.size() &&
+         "The number of inputs does not match the number of variables");
+
+  // Update the input variables.
+  for (int i = 0, e = vars.size(); i < e; i++) {
+    assert(vars[i]->getVisibilityKind() == VisibilityKind::Public &&
+           "Trying to update a private variable");
+    loadValueFromTensor(vars[i], inputs[i]);
+  }
+
+  // The partitions are topologically sorted, so executing them in order
+  // satisfies all dependencies. Hand the boundary variables over before
+  // their consumer runs.
+  for (unsigned s = 0, e = dagStages_.size(); s < e; s++) {
+    for (auto &ch : dagChannels_) {
+      if (ch.consumer == s) {
+        ch.in->getPayload().copyFrom(&ch.out->getPayload());
+      }
+    }
+    dagStages_[s].function->execute();
+  }
+}
+
+void ExecutionEngine::runDAGBatch(size_t iterations,
+                                  llvm::ArrayRef<Variable *> vars,
+                                  llvm::ArrayRef<Tensor *> inputs) {
+  assert(!dagStages_.empty() && "No DAG has been compiled");
+  assert(inputs.size() == vars.size() &&
+         "The number of inputs does not match the number of variables");
+
+  // Assign every external input to the earliest stage that reads it. An
+  // input that feeds several stages would make the pipeline stages race on
+  // its payload, so in that case fall back to running the batches
+  // sequentially.
+  std::vector<std::vector<unsigned>> stageInputs(dagStages_.size());
+  bool pipelineSafe = true;
+  for (unsigned i = 0, e = vars.size(); i < e; i++) {
+    unsigned readers = 0;
+    unsigned first = 0;
+    for (unsigned s = 0, se = dagStages_.size(); s < se; s++) {
+      if (functionReadsVar(dagStages_[s].F, vars[i])) {
+        if (!readers) {
+          first = s;
+        }
+        readers++;
+      }
+    }
+    pipelineSafe &= (readers <= 1);
+    stageInputs[first].push_back(i);
+  }
+
+  size_t batchSize = vars.empty() ? 1 : vars[0]->getType()->dims()[0];
+
+  if (!pipelineSafe || dagStages_.size() < 2) {
+    for (size_t k = 0; k < iterations; k++) {
+      for (unsigned i = 0, e = vars.size(); i < e; i++) {
+        loadValueFromTensorSlice(vars[i], inputs[i], k * batchSize);
+      }
+      for (unsigned s = 0, e = dagStages_.size(); s < e; s++) {
+        for (auto &ch : dagChannels_) {
+          if (ch.consumer == s) {
+            ch.in->getPayload().copyFrom(&ch.out->getPayload());
+          }
+        }
+        dagStages_[s].function->execute();
+      }
+    }
+    return;
+  }
+
+  // One worker thread per stage. A stage waits until all its inbound
+  // mailboxes hold the current batch, executes, releases the inbound
+  // mailboxes, and hands its boundary outputs over as soon as the
+  // consumer's mailbox is free again - so its next batch can start while
+  // the consumers still work on this one.
+  std::mutex mu;
+  std::condition_variable cv;
+  for (auto &ch : dagChannels_) {
+    ch.full = false;
+  }
+
+  auto worker = [&](unsigned s) {
+    for (size_t k = 0; k < iterations; k++) {
+      // Load this stage's external inputs for batch k.
+      for (auto idx : stageInputs[s]) {
+        loadValueFromTensorSlice(vars[idx], inputs[idx], k * batchSize);
+      }
+      // Wait until every inbound mailbox holds batch k.
+      {
+        std::unique_lock<std::mutex> lock(mu);
+        cv.wait(lock, [&] {
+          for (auto &ch : dagChannels_) {
+            if (ch.consumer == s && !ch.full) {
+              return false;
+            }
+          }
+          return true;
+        });
+      }
+
+      dagStages_[s].function->execute();
+
+      {
+        std::unique_lock<std::mutex> lock(mu);
+        // This batch's inbound values have been consumed; the producers may
+        // refill the mailboxes.
+        for (auto &ch : dagChannels_) {
+          if (ch.consumer == s) {
+            ch.full = false;
+          }
+        }
+        cv.notify_all();
+        // Hand the outputs over to the consumers. The copy runs outside of
+        // the lock: only this stage writes its outbound channels, and the
+        // consumer does not read a mailbox until it is marked full, so
+        // several stages can transfer large boundary tensors concurrently
+        // instead of serializing the handoffs on the pipeline lock.
+        for (auto &ch : dagChannels_) {
+          if (ch.producer != s) {
+            continue;
+          }
+          cv.wait(lock, [&] { return !ch.full; });
+          lock.unlock();
+          ch.in->getPayload().copyFrom(&ch.out->getPayload());
+          lock.lock();
+          ch.full = true;
+        }
+        cv.notify_all();
+      }
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (unsigned s = 0, e = dagStages_.size(); s < e; s++) {
+    workers.emplace_back(worker, s);
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
 }
 
 void ExecutionEngine::save(CompilationMode mode, Function *F,
                            llvm::StringRef outputDir) {
   backend_->save(generateIR(mode, F), outputDir);
 }
+
+void ExecutionEngine::save(CompilationMode mode, llvm::ArrayRef<Function *> Fs,
+                           llvm::StringRef outputDir) {
+  std::vector<std::unique_ptr<IRFunction>> IRs;
+  for (auto *F : Fs) {
+    IRs.push_back(generateIR(mode, F));
+  }
+  backend_->save(std::move(IRs), outputDir);
+}
@@ -23,13 +23,24 @@
 
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/Casting.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <cstring>
+
 using namespace glow;
 
 using llvm::cast;
 using llvm::isa;
 
+static llvm::cl::opt<unsigned> gradCheckpointInterval(
+    "grad-checkpoint-interval",
+    llvm::cl::desc("Keep only every Nth forward activation alive across the "
+                   "backward pass and recompute the segments in between from "
+                   "the preceding checkpoint, trading compute for training "
+                   "memory (0 disables gradient checkpointing)"),
+    llvm::cl::init(0));
+
 void GraphGradMapper::addGradient(NodeValue activation, NodeValue grad) {
   if (map_.count(activation)) {
     auto curr = map_[activation];
@@ -63,9 +74,47 @@ Function *glow::differentiate(Function *F, const TrainingConfig &conf,
     newFuncName = tmpName;
   }
 
+  // Hashes the bit pattern of a float, for mixing the training parameters
+  // into the cache key.
+  auto hashFloat = [](float f) {
+    int32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return bits;
+  };
+
+  // Memoize the gradient expansion on the structure of the forward function
+  // and the training configuration, so that recompiling an unchanged function
+  // (e.g. after a change elsewhere in the module) reuses the previously
+  // generated gradient graph. The unit-test mode that collects variable
+  // gradients bypasses the cache because it must fill in \p varGrads.
+  uint64_t cacheKey = 0;
+  auto &gradCache = F->getParent()->getGradFunctionCache();
+  if (!varGrads) {
+    cacheKey = llvm::hash_combine(
+        F->getStructuralHash(), llvm::hash_value(newFuncName),
+        (unsigned)conf.optimizer, hashFloat(conf.L1Decay),
+        hashFloat(conf.L2Decay), hashFloat(conf.learningRate),
+        hashFloat(conf.momentum), hashFloat(conf.beta1),
+        hashFloat(conf.beta2), hashFloat(conf.rmsDecay),
+        hashFloat(conf.epsilon), conf.batchSize, conf.accumSteps,
+        gradCheckpointInterval.getValue());
+    auto cacheIt = gradCache.find(cacheKey);
+    if (cacheIt != gradCache.end()) {
+      return cacheIt->second;
+    }
+  }
+
   // Clone the function.
   Function *G = F->clone(newFuncName);
 
+  // With gradient accumulation the weight update lives in a companion
+  // function, compiled and run separately once per accumulation cycle.
+  Function *updateFunc = nullptr;
+  if (conf.accumSteps > 1 && !varGrads) {
+    updateFunc =
+        F->getParent()->createFunction(G->getName().str() + "_update");
+  }
+
   using Kind = glow::Kinded::Kind;
   GraphGradMapper map(G);
 
@@ -76,17 +125,98 @@ Function *glow::differentiate(Function *F, const TrainingConfig &conf,
 
   PostOrderVisitor pov;
   for (auto &N : G->getNodes()) {
-    N.visit(nullptr, &pov);
+    visitPostOrder(&N, pov);
   }
 
   auto nodes = pov.getPostOrder();
 
+  // With gradient checkpointing, the forward nodes are split into segments
+  // of checkpointInterval nodes, and only the last activation of each
+  // segment stays alive across the backward pass. The interior of a segment
+  // is recomputed from the preceding checkpoint right before its gradients
+  // are taken, so the scheduler can recycle the interior activation buffers
+  // early and peak training memory scales with the segment length instead
+  // of the full network depth. An interval of one keeps every activation
+  // and checkpoints nothing, so it degenerates to the interval-zero case.
+  unsigned checkpointInterval =
+      gradCheckpointInterval > 1 ? gradCheckpointInterval.getValue() : 0;
+
+  // The interior (non-checkpoint) nodes of each segment, in forward order,
+  // and the segment each of them belongs to.
+  std::vector<std::vector<Node *>> segments;
+  llvm::DenseMap<const Node *, size_t> segmentOf;
+  if (checkpointInterval) {
+    size_t fwdIdx = 0;
+    for (auto *N : nodes) {
+      // Only intermediate computations are worth recomputing: variables and
+      // splats own their storage anyway, and nodes with side effects must
+      // not run twice.
+      if (isa<Variable>(N) || isa<SaveNode>(N) || isa<SplatNode>(N) ||
+          N->hasSideEffects()) {
+        continue;
+      }
+      size_t seg = fwdIdx / checkpointInterval;
+      bool isCheckpoint = (fwdIdx % checkpointInterval) == 0;
+      fwdIdx++;
+      if (isCheckpoint) {
+        continue;
+      }
+      if (segments.size() <= seg) {
+        segments.resize(seg + 1);
+      }
+      segments[seg].push_back(N);
+      segmentOf[N] = seg;
+    }
+  }
+
+  // The recomputation clone of every interior node whose segment has been
+  // materialized so far.
+  llvm::DenseMap<const Node *, Node *> recomputed;
+  std::vector<bool> segmentDone(segments.size(), false);
+
+  // Emit the recomputation clones for the interior of segment \p seg, in
+  // forward order, rewiring their intra-segment inputs to the clones so the
+  // recomputed chain grows from the preceding checkpoint.
+  auto materializeSegment = [&](size_t seg) {
+    if (seg >= segments.size() || segmentDone[seg]) {
+      return;
+    }
+    segmentDone[seg] = true;
+    for (auto *N : segments[seg]) {
+      Node *C = N->clone();
+      for (unsigned i = 0, e = C->getNumInputs(); i < e; i++) {
+        auto in = C->getNthInput(i);
+        auto cloneIt = recomputed.find(in.getNode());
+        if (cloneIt != recomputed.end()) {
+          C->setNthInput(i, NodeValue(cloneIt->second, in.getResNo()));
+        }
+      }
+      recomputed[N] = C;
+      toAppend.push_back(C);
+    }
+  };
+
   for (auto it = nodes.rbegin(), e = nodes.rend(); it != e; it++) {
     Node *N = *it;
     if (isa<Variable>(N)) {
       continue;
     }
 
+    // Make sure that every interior activation this node's gradient may
+    // reference has a recomputation clone before the gradient is created.
+    if (checkpointInterval) {
+      auto segIt = segmentOf.find(N);
+      if (segIt != segmentOf.end()) {
+        materializeSegment(segIt->second);
+      }
+      for (unsigned i = 0, ie = N->getNumInputs(); i < ie; i++) {
+        auto inIt = segmentOf.find(N->getNthInput(i).getNode());
+        if (inIt != segmentOf.end()) {
+          materializeSegment(inIt->second);
+        }
+      }
+    }
+
 #define CONVERT_TO_GRAD_NODE(NodeKind)                                         \
   if (N->getKind() == Kind::NodeKind##Kind) {                                  \
     toAppend.push_back(cast<NodeKind>(N)->getGrad(map));                       \
@@ -252,13 +382,76 @@ Function *glow::differentiate(Function *F, const TrainingConfig &conf,
       continue;
     }
 
-    auto X = new SGDNode(V->getName(), map.getGradient(V), V, conf.L1Decay,
-                         conf.L2Decay, conf.learningRate, conf.momentum,
-                         conf.batchSize);
-    toAppend.push_back(X);
-    // Now update the weight with the value computed by SGD.
-    auto *save = new SaveNode(V->getName().str() + ".saveGrad", {X, 0}, V);
-    toAppend.push_back(save);
+    // When accumulating micro-batch gradients, the gradient is summed into
+    // a dedicated variable here and the optimizer runs in the companion
+    // update function, consuming the accumulated gradient scaled by the
+    // full effective batch. The accumulator is public so that it lives in
+    // the mutable weights arena: execution contexts then hold a private
+    // copy per worker, which is what lets runBatchParallel() run
+    // micro-batches concurrently without racing on the gradients.
+    NodeValue gradient = map.getGradient(V);
+    unsigned batchSize = conf.batchSize;
+    if (updateFunc) {
+      auto *GA = G->getParent()->createVariable(
+          V->getType(), V->getName().str() + ".gradAcc",
+          VisibilityKind::Public, Variable::TrainKind::Broadcast, 0);
+      auto *sum =
+          G->createAdd(V->getName().str() + ".gradAcc.sum", GA, gradient);
+      G->createSave(V->getName().str() + ".gradAcc.save", sum, GA);
+      gradient = GA;
+      batchSize = conf.batchSize * conf.accumSteps;
+    }
+
+    Node *X = nullptr;
+    switch (conf.optimizer) {
+    case OptimizerKind::SGD:
+      X = new SGDNode(V->getName(), gradient, V, conf.L1Decay, conf.L2Decay,
+                      conf.learningRate, conf.momentum, batchSize);
+      break;
+    case OptimizerKind::Adam:
+      X = new AdamNode(V->getName(), gradient, V, conf.L1Decay, conf.L2Decay,
+                       conf.learningRate, conf.beta1, conf.beta2, conf.epsilon,
+                       batchSize);
+      break;
+    case OptimizerKind::RMSProp:
+      X = new RMSPropNode(V->getName(), gradient, V, conf.L1Decay,
+                          conf.L2Decay, conf.learningRate, conf.rmsDecay,
+                          conf.epsilon, batchSize);
+      break;
+    }
+
+    if (!updateFunc) {
+      toAppend.push_back(X);
+      // Now update the weight with the value computed by SGD.
+      auto *save = new SaveNode(V->getName().str() + ".saveGrad", {X, 0}, V);
+      toAppend.push_back(save);
+      continue;
+    }
+
+    updateFunc->addNode(X);
+    // Update the weight with the value computed by the optimizer.
+    updateFunc->createSave(V->getName().str() + ".saveGrad", {X, 0}, V);
+    // Clear the accumulator for the next cycle. The scheduler orders this
+    // save after the optimizer's read of the accumulator.
+    auto *zero = updateFunc->createSplat(V->getName().str() + ".gradAcc.zero",
+                                         gradient.getType(), 0);
+    updateFunc->createSave(V->getName().str() + ".gradAcc.clear", zero,
+                           llvm::cast<Variable>(gradient.getNode()));
+  }
+
+  // Redirect every reference to an interior activation from the backward
+  // nodes to its recomputation clone, so the original activation's last use
+  // is in the forward pass and its buffer can be recycled there.
+  if (checkpointInterval) {
+    for (auto *BN : toAppend) {
+      for (unsigned i = 0, e = BN->getNumInputs(); i < e; i++) {
+        auto in = BN->getNthInput(i);
+        auto cloneIt = recomputed.find(in.getNode());
+        if (cloneIt != recomputed.end() && cloneIt->second != BN) {
+          BN->setNthInput(i, NodeValue(cloneIt->second, in.getResNo()));
+        }
+      }
+    }
   }
 
   // Add all of the new variables and instructions.
@@ -266,5 +459,9 @@ Function *glow::differentiate(Function *F, const TrainingConfig &conf,
     G->addNode(I);
   }
 
+  if (!varGrads) {
+    gradCache[cacheKey] = G;
+  }
+
   return G;
 }
@@ -16,6 +16,7 @@
 
 #include "glow/Graph/Graph.h"
 #include "glow/Graph/Nodes.h"
+#include "glow/Graph/Utils.h"
 #include "glow/Support/Support.h"
 
 #include "llvm/ADT/DenseMap.h"
@@ -24,6 +25,7 @@
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <algorithm>
 #include <fstream>
 #include <unordered_set>
 
@@ -50,6 +52,13 @@ Function *Module::createFunction(llvm::StringRef name) {
   return F;
 }
 
+void Module::eraseFunction(Function *F) {
+  auto it = std::find(functions_.begin(), functions_.end(), F);
+  assert(it != functions_.end() && "Function not in the module");
+  functions_.erase(it);
+  delete F;
+}
+
 Module::~Module() {
   for (auto *F : functions_) {
     delete F;
@@ -288,13 +297,16 @@ TypeRef Module::uniqueTypeWithNewShape(TypeRef T, llvm::ArrayRef<size_t> dims) {
 }
 
 TypeRef Module::uniqueType(const Type &T) {
-  for (auto &tp : types_) {
-    if (T.isEqual(tp)) {
-      return &tp;
+  auto &bucket = typesByHash_[static_cast<size_t>(hash_value(T))];
+  for (Type *tp : bucket) {
+    if (T.isEqual(*tp)) {
+      return tp;
     }
   }
 
-  return &*types_.insert(types_.begin(), T);
+  Type *uniqued = &*types_.insert(types_.begin(), T);
+  bucket.push_back(uniqued);
+  return uniqued;
 }
 
 TypeRef Module::getVoidTy() { return uniqueType(Type()); }
@@ -318,7 +330,8 @@ Variable *Module::createVariable(TypeRef T, llvm::StringRef name,
                                  VisibilityKind visibility,
                                  Variable::TrainKind train, float val) {
   auto FT = uniqueType(*T);
-  return addVar(new Variable(name, FT, visibility, train, val, getPRNG()));
+  return addVar(
+      new Variable(name, FT, visibility, train, val, getPRNG(), deferInit_));
 }
 
 Variable *Module::createVariable(ElemKind T, llvm::ArrayRef<size_t> dims,
@@ -642,16 +655,11 @@ Node *Function::createBroadcast(llvm::StringRef name, NodeValue input,
       createReshape(name.str() + ".reshape", input,
                     llvm::ArrayRef<size_t>(reshapeDims, newShape.size()));
 
-  // Create a Tile (which is really a Concat) in each direction that needs to be
-  // broadcasted.
-  for (size_t i = 0; i < newShape.size(); i++) {
-    if (reshapeDims[i] == 1 && newShape[i] != 1) {
-      currNode = createTile(name.str() + ".tile" + std::to_string(i), currNode,
-                            newShape[i], i);
-    }
-  }
-
-  return currNode;
+  // A single node stretches the size-one dimensions while writing the result.
+  // The backends repeat the data inside the kernel, so no intermediate tiled
+  // tensors are materialized.
+  auto OT = getParent()->uniqueTypeWithNewShape(input.getType(), newShape);
+  return addNode(new BroadcastNode(name, OT, currNode));
 }
 
 /// \returns true if \p T1 and T2 has the exact same type except for dimension
@@ -740,6 +748,16 @@ InsertTensorNode *Function::createTile(llvm::StringRef name, NodeValue input,
   return addNode(new InsertTensorNode(name, zero, input, start, tiles, axis));
 }
 
+InsertTensorNode *Function::createInsertTensor(llvm::StringRef name,
+                                               NodeValue big, NodeValue small,
+                                               llvm::ArrayRef<size_t> start,
+                                               unsigned count, unsigned axis) {
+  assert(start.size() == big.dims().size() &&
+         "Start must have one offset per dimension of big.");
+  return addNode(
+      new InsertTensorNode(name, big, small, start.vec(), count, axis));
+}
+
 SliceNode *Function::createSlice(llvm::StringRef name, NodeValue input,
                                  llvm::ArrayRef<size_t> start, TypeRef outTy) {
   assert(input.dims().size() == start.size() &&
@@ -1001,6 +1019,13 @@ CmpLTENode *Function::createCmpLTE(llvm::StringRef name, NodeValue LHS,
   return addNode(new CmpLTENode(name, OT, LHS, RHS));
 }
 
+CmpLTENode *Function::createCmpLTE(llvm::StringRef name, TypeRef T,
+                                   NodeValue LHS, NodeValue RHS) {
+  assert(LHS.dims() == RHS.dims() && "Invalid operand shapes");
+  TypeRef OT = getParent()->uniqueType(*T);
+  return addNode(new CmpLTENode(name, OT, LHS, RHS));
+}
+
 CmpEQNode *Function::createCmpEQ(llvm::StringRef name, NodeValue LHS,
                                  NodeValue RHS) {
   assert(LHS.dims() == RHS.dims() && "Invalid operand shapes");
@@ -1008,6 +1033,13 @@ CmpEQNode *Function::createCmpEQ(llvm::StringRef name, NodeValue LHS,
   return addNode(new CmpEQNode(name, OT, LHS, RHS));
 }
 
+CmpEQNode *Function::createCmpEQ(llvm::StringRef name, TypeRef T, NodeValue LHS,
+                                 NodeValue RHS) {
+  assert(LHS.dims() == RHS.dims() && "Invalid operand shapes");
+  TypeRef OT = getParent()->uniqueType(*T);
+  return addNode(new CmpEQNode(name, OT, LHS, RHS));
+}
+
 PowNode *Function::createPow(llvm::StringRef name, NodeValue Base, float exp) {
   return addNode(new PowNode(name, Base.getType(), Base, exp));
 }
@@ -1059,6 +1091,24 @@ MatMulNode *Function::createMatMul(llvm::StringRef name, NodeValue lhs,
   return createMatMul(name, ty, lhs, rhs);
 }
 
+BatchMatMulNode *Function::createBatchMatMul(llvm::StringRef name,
+                                             TypeRef outTy, NodeValue lhs,
+                                             NodeValue rhs) {
+  return addNode(
+      new BatchMatMulNode(name, getParent()->uniqueType(*outTy), lhs, rhs));
+}
+
+BatchMatMulNode *Function::createBatchMatMul(llvm::StringRef name,
+                                             NodeValue lhs, NodeValue rhs) {
+  auto LDims = lhs.dims();
+  auto RDims = rhs.dims();
+  assert(lhs.getType()->getElementType() == rhs.getType()->getElementType());
+
+  auto ty = getParent()->uniqueTypeWithNewShape(
+      lhs.getType(), {LDims[0], LDims[1], RDims[2]});
+  return createBatchMatMul(name, ty, lhs, rhs);
+}
+
 BatchedReduceAddNode *Function::createBatchedReduceAdd(llvm::StringRef name,
                                                        TypeRef outTy,
                                                        NodeValue batch,
@@ -1232,14 +1282,21 @@ IntLookupTableNode *Function::createIntSigmoid(llvm::StringRef name,
 
 TopKNode *Function::createTopK(llvm::StringRef name, NodeValue input,
                                size_t k) {
+  return createTopK(name, input, k, ElemKind::IndexTy);
+}
+
+TopKNode *Function::createTopK(llvm::StringRef name, NodeValue input, size_t k,
+                               ElemKind indexKind) {
   auto inDims = input.dims();
   assert(inDims.size() > 0);
   assert(k <= inDims.back());
+  assert((indexKind == ElemKind::IndexTy || indexKind == ElemKind::Int32ITy) &&
+         "Invalid index element kind");
   ShapeVector outDims(inDims.begin(), inDims.end());
   outDims.back() = k;
   auto OT = getParent()->uniqueTypeWithNewShape(input.getType(), outDims);
   return addNode(new TopKNode(
-      name, OT, getParent()->uniqueType(ElemKind::IndexTy, outDims), input, k));
+      name, OT, getParent()->uniqueType(indexKind, outDims), input, k));
 }
 
 GatherNode *Function::createGather(llvm::StringRef name, NodeValue data,
@@ -1684,6 +1741,36 @@ void Function::createLSTM(llvm::StringRef namePrefix,
   }
 };
 
+LSTMCellNode *Function::createLSTMCell(llvm::StringRef name, NodeValue input,
+                                       NodeValue H, NodeValue C, NodeValue Wx,
+                                       NodeValue Wh, NodeValue bias) {
+  assert(input.dims().size() == 2 && H.dims().size() == 2 &&
+         "Expected 2D input and state");
+  size_t hiddenSize = H.dims()[1];
+  assert(C.dims() == H.dims() && "Hidden and cell states must match");
+  assert(Wx.dims()[0] == input.dims()[1] &&
+         Wx.dims()[1] == 4 * hiddenSize && "Invalid Wx shape");
+  assert(Wh.dims()[0] == hiddenSize && Wh.dims()[1] == 4 * hiddenSize &&
+         "Invalid Wh shape");
+  assert(bias.dims()[0] == 4 * hiddenSize && "Invalid bias shape");
+  return addNode(new LSTMCellNode(name, input, H, C, Wx, Wh, bias));
+}
+
+GRUCellNode *Function::createGRUCell(llvm::StringRef name, NodeValue input,
+                                     NodeValue H, NodeValue Wx, NodeValue Wh,
+                                     NodeValue bx, NodeValue bh) {
+  assert(input.dims().size() == 2 && H.dims().size() == 2 &&
+         "Expected 2D input and state");
+  size_t hiddenSize = H.dims()[1];
+  assert(Wx.dims()[0] == input.dims()[1] &&
+         Wx.dims()[1] == 3 * hiddenSize && "Invalid Wx shape");
+  assert(Wh.dims()[0] == hiddenSize && Wh.dims()[1] == 3 * hiddenSize &&
+         "Invalid Wh shape");
+  assert(bx.dims()[0] == 3 * hiddenSize && bh.dims()[0] == 3 * hiddenSize &&
+         "Invalid bias shape");
+  return addNode(new GRUCellNode(name, input, H, Wx, Wh, bx, bh));
+}
+
 //===----------------------------------------------------------------------===//
 //                   Graph dumping and printing
 //===----------------------------------------------------------------------===//
@@ -1701,37 +1788,43 @@ class FunctionDottyPrinter : public AbstractDottyPrinter {
   // A set of already visited (during graph walk) nodes.
   std::unordered_set<Node *> visitedNodes_{};
 
-  /// Recursively traverses inputs of node \p N using Deep First Search.
-  /// Each node will be visited no more than once. The method also dumps
-  /// edges with their port identifiers in dotty format.
-  void visitNode(Node *N) {
-    if (visitedNodes_.find(N) != visitedNodes_.end())
-      return;
-    visitedNodes_.insert(N);
-
-    // Print edges for the predicate field, if it's used.
-    if (N->hasPredicate()) {
-      auto pred = N->getPredicate();
-      size_t resNo = pred.getResNo();
-      std::ostringstream edge;
-      edge << uniqueVertexName(pred) << ":" << pred->getOutputName(resNo).str()
-           << " -> " << uniqueVertexName(N) << ":w";
-      dumpEdgeStyle(N, 0, pred, edge);
-      edges_.insert(edge.str());
-      visitNode(pred);
-    }
+  /// Traverses the inputs of the node \p root using depth first search with
+  /// an explicit worklist, so deep graphs do not exhaust the call stack. Each
+  /// node is visited no more than once. The method also dumps edges with
+  /// their port identifiers in dotty format.
+  void visitNode(Node *root) {
+    std::vector<Node *> worklist{root};
+    while (!worklist.empty()) {
+      Node *N = worklist.back();
+      worklist.pop_back();
+      if (!visitedNodes_.insert(N).second)
+        continue;
 
-    for (size_t i = 0; i < N->getNumInputs(); i++) {
-      Node *to = N->getNthInput(i).getNode();
-      size_t resNo = N->getNthInput(i).getResNo();
+      // Print edges for the predicate field, if it's used.
+      if (N->hasPredicate()) {
+        auto pred = N->getPredicate();
+        size_t resNo = pred.getResNo();
+        std::ostringstream edge;
+        edge << uniqueVertexName(pred) << ":"
+             << pred->getOutputName(resNo).str() << " -> "
+             << uniqueVertexName(N) << ":w";
+        dumpEdgeStyle(N, 0, pred, edge);
+        edges_.insert(edge.str());
+        worklist.push_back(pred);
+      }
 
-      std::ostringstream edge;
-      edge << uniqueVertexName(to) << ":" << to->getOutputName(resNo).str()
-           << " -> " << uniqueVertexName(N) << ":" << N->getInputName(i).str();
-      dumpEdgeStyle(N, i, to, edge);
-      edges_.insert(edge.str());
+      for (size_t i = 0; i < N->getNumInputs(); i++) {
+        Node *to = N->getNthInput(i).getNode();
+        size_t resNo = N->getNthInput(i).getResNo();
 
-      visitNode(to);
+        std::ostringstream edge;
+        edge << uniqueVertexName(to) << ":" << to->getOutputName(resNo).str()
+             << " -> " << uniqueVertexName(N) << ":" << N->getInputName(i).str();
+        dumpEdgeStyle(N, i, to, edge);
+        edges_.insert(edge.str());
+
+        worklist.push_back(to);
+      }
     }
   }
 
@@ -1784,18 +1877,56 @@ Node *Function::getNodeByName(llvm::StringRef name) {
 void Module::eraseVariable(VariablesList::iterator I) {
   if (I == vars_.end())
     return;
+  // The variable may sit in the cached post order of any function of the
+  // module; drop it from their caches before it is freed.
+  for (auto *F : functions_) {
+    F->forgetDirtyNode(*I);
+  }
+  variableByName_.erase((*I)->getName());
   delete *I;
   vars_.erase(I);
 }
 
 void Function::eraseNode(NodesList::iterator I) { nodes_.erase(I); }
 
-Variable *Module::getVariableByName(llvm::StringRef name) {
-  for (auto *V : getVars()) {
-    if (V->getName() == name)
-      return V;
+llvm::hash_code Function::getStructuralHash() const {
+  // Number the nodes in post-order so that the numbering depends only on the
+  // structure of the graph, not on the addresses of the nodes.
+  auto order = getPostOrder();
+  llvm::DenseMap<const Node *, unsigned> idx;
+  idx.reserve(order.size());
+  for (const Node *N : order) {
+    unsigned i = idx.size();
+    idx[N] = i;
   }
-  return nullptr;
+
+  llvm::hash_code hash = llvm::hash_value(order.size());
+  for (Node *N : order) {
+    hash = llvm::hash_combine(hash, N->getHash());
+    // Mix in the edges: for every input, the index of the node it comes from
+    // and the result number it uses.
+    for (unsigned i = 0, e = N->getNumInputs(); i < e; i++) {
+      auto input = N->getNthInput(i);
+      hash = llvm::hash_combine(hash, idx.lookup(input.getNode()),
+                                input.getResNo());
+    }
+  }
+  return hash;
+}
+
+llvm::ArrayRef<Node *> Function::getPostOrder() const {
+  if (!postOrderValid_) {
+    // The visitor does not mutate the function; it only orders the nodes.
+    GraphPostOrderVisitor visitor(*const_cast<Function *>(this));
+    auto order = visitor.getPostOrder();
+    cachedPostOrder_.assign(order.begin(), order.end());
+    postOrderValid_ = true;
+  }
+  return cachedPostOrder_;
+}
+
+Variable *Module::getVariableByName(llvm::StringRef name) {
+  return variableByName_.lookup(name);
 }
 
 void Module::eraseVariable(Variable *N) {
@@ -1808,7 +1939,10 @@ void Function::eraseNode(Node *N) {
   if (Variable *V = dyn_cast<Variable>(N)) {
     return getParent()->eraseVariable(V);
   }
-  auto I = std::find(nodes_.begin(), nodes_.end(), *N);
+  // Match by identity, not by structural equality: the function may contain
+  // several structurally identical nodes, and only \p N itself must go.
+  auto I = std::find_if(nodes_.begin(), nodes_.end(),
+                        [N](const Node &node) { return &node == N; });
   assert(I != nodes_.end() && "Could not find node to delete!");
   eraseNode(I);
 }
@@ -1817,43 +1951,53 @@ Function *Function::clone(llvm::StringRef newName,
                           llvm::DenseMap<Node *, Node *> *map) {
   Module *M = getParent();
   auto *newF = M->createFunction(newName);
+  size_t numNodes = getNodes().size();
+
+  // Assigns each node in this function a dense index. Pre-sized so that
+  // filling it never rehashes.
+  llvm::DenseMap<Node *, unsigned> nodeIdx;
+  nodeIdx.reserve(numNodes);
 
-  // Maps current nodes to new nodes.
-  llvm::DenseMap<Node *, Node *> currToNew;
+  // The clone of the node with index \p i, in the iteration order of this
+  // function's node list.
+  std::vector<Node *> newNodes;
+  newNodes.reserve(numNodes);
 
-  // Clone all of the nodes in the function.
+  // Clone all of the nodes in the function in one pass.
   for (auto &N : getNodes()) {
     Node *copy = N.clone();
     // Record the copy relationship between the graphs.
-    currToNew[&N] = copy;
+    nodeIdx[&N] = newNodes.size();
+    newNodes.push_back(copy);
     newF->addNode(copy);
   }
 
   // At this point we have a new invalid function that points into nodes in the
   // original function. Here we update the links between the nodes in the new
-  // function.
-  for (auto &N : newF->getNodes()) {
+  // function through the dense remap table.
+  for (Node *copy : newNodes) {
     // Fix each one of the inputs of this node.
-    for (unsigned inp = 0, e = N.getNumInputs(); inp < e; inp++) {
-      auto input = N.getNthInput(inp);
+    for (unsigned inp = 0, e = copy->getNumInputs(); inp < e; inp++) {
+      auto input = copy->getNthInput(inp);
 
-      auto it = currToNew.find(input.getNode());
-      if (it == currToNew.end()) {
+      auto it = nodeIdx.find(input.getNode());
+      if (it == nodeIdx.end()) {
         assert(isa<Variable>(input.getNode()) &&
                "Could not find a mapping for some node!");
         continue;
       }
 
       // Update the node with the edge to the current graph.
-      N.setNthInput(inp, NodeValue(it->second, input.getResNo()));
+      copy->setNthInput(inp, NodeValue(newNodes[it->second],
+                                       input.getResNo()));
     }
   }
 
   // Record the node mapping into the external map.
   if (map) {
     assert(map->empty() && "The external map must be empty");
-    for (auto it : currToNew) {
-      map->insert(it);
+    for (auto it : nodeIdx) {
+      map->insert({it.first, newNodes[it.second]});
     }
   }
 
@@ -1861,6 +2005,98 @@ Function *Function::clone(llvm::StringRef newName,
   return newF;
 }
 
+Function *
+Function::cloneWithNewBatch(llvm::StringRef newName, size_t batchSize,
+                            llvm::DenseMap<Variable *, Variable *> *varMap) {
+  Module *M = getParent();
+
+  // Infer the batch size this function was built for: the leading dimension
+  // of the first public variable it uses.
+  size_t oldBatch = 0;
+  for (auto &N : nodes_) {
+    for (unsigned i = 0, e = N.getNumInputs(); i < e && !oldBatch; i++) {
+      auto *V = dyn_cast<Variable>(N.getNthInput(i));
+      if (V && V->getVisibilityKind() == VisibilityKind::Public &&
+          V->dims().size()) {
+        oldBatch = V->dims()[0];
+      }
+    }
+    if (oldBatch) {
+      break;
+    }
+  }
+  assert(oldBatch && "Could not infer the batch size of the function");
+
+  Function *newF = clone(newName);
+
+  // Replace the public variables whose leading dimension is the batch with
+  // new variables sized for the new batch, rewiring only the uses inside the
+  // clone. The private variables - the weights - stay shared.
+  llvm::DenseMap<Variable *, Variable *> replaced;
+  for (auto &N : newF->getNodes()) {
+    for (unsigned i = 0, e = N.getNumInputs(); i < e; i++) {
+      auto *V = dyn_cast<Variable>(N.getNthInput(i));
+      if (!V || V->getVisibilityKind() != VisibilityKind::Public ||
+          V->dims().empty() || V->dims()[0] != oldBatch) {
+        continue;
+      }
+      auto it = replaced.find(V);
+      Variable *NV;
+      if (it != replaced.end()) {
+        NV = it->second;
+      } else {
+        auto dims = V->dims().vec();
+        dims[0] = batchSize;
+        NV = M->createVariable(
+            M->uniqueTypeWithNewShape(V->getType(), dims),
+            V->getName().str() + "." + std::to_string(batchSize),
+            V->getVisibilityKind(), V->getTrainKind());
+        replaced[V] = NV;
+      }
+      N.setNthInput(i, NV);
+    }
+  }
+
+  // Scale every node result whose leading dimension is the old batch.
+  for (auto &N : newF->getNodes()) {
+    for (unsigned r = 0, e = N.getNumResults(); r < e; r++) {
+      auto dims = N.dims(r);
+      if (dims.empty() || dims[0] != oldBatch) {
+        continue;
+      }
+      auto newDims = dims.vec();
+      newDims[0] = batchSize;
+      N.setType(r, M->uniqueTypeWithNewShape(N.getType(r), newDims));
+    }
+  }
+
+  // Reshapes carry their shape as a member that must agree with the result
+  // type; rebuild the ones that reshape the batch dimension. The inputs are
+  // already retyped, so the replacements verify against the new batch.
+  std::vector<Node *> reshapes;
+  for (auto &N : newF->getNodes()) {
+    if (auto *RN = dyn_cast<ReshapeNode>(&N)) {
+      if (RN->getDims().size() && RN->getDims()[0] == oldBatch) {
+        reshapes.push_back(RN);
+      }
+    }
+  }
+  for (Node *N : reshapes) {
+    auto *RN = cast<ReshapeNode>(N);
+    auto dims = RN->getDims().vec();
+    dims[0] = batchSize;
+    auto *NR = newF->createReshape(RN->getName(), RN->getInput(), dims);
+    NodeValue(N, 0).replaceAllUsesOfWith(NR);
+    newF->eraseNode(N);
+  }
+
+  if (varMap) {
+    assert(varMap->empty() && "The external map must be empty");
+    *varMap = std::move(replaced);
+  }
+  return newF;
+}
+
 /// Verify the input \p idx of a node \p N. Check that the node \p N is in the
 /// use-list of the corresponding input node.
 static void verifyNodeInput(const Node &N, size_t idx) {
@@ -1878,6 +2114,20 @@ static void verifyNodeInput(const Node &N, size_t idx) {
 }
 
 void Function::verify() const {
+#ifndef NDEBUG
+  // Debug builds always check the whole function.
+  verifyFull();
+#else
+  // Release builds only re-verify the nodes that were added or mutated since
+  // the last verification.
+  for (const Node *N : dirtyNodes_) {
+    N->verify();
+  }
+  dirtyNodes_.clear();
+#endif
+}
+
+void Function::verifyFull() const {
   std::unordered_map<std::string, const Node *> NameToNode;
 
   for (auto *V : getParent()->getVars()) {
@@ -1984,4 +2234,7 @@ void Function::verify() const {
              "Implicit read after write memory dependency may not be honored");
     }
   }
+
+  // A full sweep covers everything the incremental path would have checked.
+  dirtyNodes_.clear();
 }
@@ -17,10 +17,29 @@
 #include "glow/Base/Type.h"
 #include "glow/Graph/Graph.h"
 #include "glow/Graph/Nodes.h"
+#include "glow/Support/Memory.h"
 #include "glow/Support/Support.h"
 
 using namespace glow;
 
+namespace {
+
+/// \returns the calling thread's node allocator.
+SlabAllocator &getNodeAllocator() {
+  thread_local SlabAllocator allocator;
+  return allocator;
+}
+
+} // namespace
+
+void *Node::operator new(size_t size) {
+  return getNodeAllocator().allocate(size);
+}
+
+void Node::operator delete(void *ptr, size_t size) {
+  getNodeAllocator().deallocate(ptr, size);
+}
+
 void NodeUse::setOperand(NodeHandle &other) {
   if (other && site_->getNode()) {
     assert(site_->getType() == other.getType() &&
@@ -66,6 +85,11 @@ TypeRef Node::getType(unsigned idx) const {
   return types_[idx];
 }
 
+void Node::setType(unsigned idx, TypeRef T) {
+  assert(idx < numRes_ && "Result number does not exist.");
+  types_[idx] = T;
+}
+
 ElemKind Node::getElementType(unsigned resNo) const {
   TypeRef TR = getType(resNo);
   return TR->getElementType();
@@ -131,6 +155,12 @@ void NodeHandle::setOperand(Node *v, unsigned resNo) {
     resNo_ = resNo;
     v->addUse(NodeUse(this));
   }
+
+  // The owning node changed one of its operands; remember it for the next
+  // incremental verification.
+  if (parent_ && parent_->getParent()) {
+    parent_->getParent()->markNodeDirty(parent_);
+  }
 }
 
 const NodeValue Node::getPredicate() const { return predicate_; }
@@ -381,11 +411,13 @@ Function *llvm::ilist_traits<Node>::getContainingFunction() {
 void llvm::ilist_traits<Node>::addNodeToList(Node *node) {
   assert(node->getParent() == nullptr && "Already in a list!");
   node->setParent(getContainingFunction());
+  node->getParent()->markNodeDirty(node);
 }
 
 void llvm::ilist_traits<Node>::removeNodeFromList(Node *node) {
   // When an instruction is removed from a function, clear the parent pointer.
   assert(node->getParent() && "Not in a list!");
+  node->getParent()->forgetDirtyNode(node);
   node->setParent(nullptr);
 }
 
@@ -398,6 +430,9 @@ void llvm::ilist_traits<Node>::transferNodesFromList(
     return;
 
   // Update the parent fields in the nodes.
-  for (; first != last; ++first)
+  for (; first != last; ++first) {
+    L2.getContainingFunction()->forgetDirtyNode(&*first);
     first->setParent(ThisParent);
+    ThisParent->markNodeDirty(&*first);
+  }
 }
@@ -21,8 +21,22 @@
 
 using namespace glow;
 
-void Variable::initPayload(PseudoRNG &PRNG) {
+void Variable::ensurePayload() const {
+  if (payloadReady_) {
+    return;
+  }
+  payloadReady_ = true;
+  // Note that this makes the order of the deferred random fills follow the
+  // order of the first accesses, not the order of variable creation.
+  const_cast<Variable *>(this)->initPayload(*PRNG_, deferInit_);
+}
+
+void Variable::initPayload(PseudoRNG &PRNG, bool skipInit) {
   payload_.reset(*getType());
+  // The caller promised to fill the payload; only the allocation is needed.
+  if (skipInit) {
+    return;
+  }
   switch (getTrainKind()) {
   case TrainKind::None:
     getPayload().initPayload(Tensor::InitKind::Zero, 0, PRNG);
@@ -330,6 +344,30 @@ void MatMulNode::verify() const {
   assert(RDims[1] == DDims[1] && "Invalid matrix dims");
 }
 
+void BatchMatMulNode::verify() const {
+  auto lhs = getLHS();
+  auto rhs = getRHS();
+  auto dest = getResult();
+
+  auto LDims = lhs.dims();
+  auto RDims = rhs.dims();
+  auto DDims = dest.dims();
+  (void)LDims;
+  (void)RDims;
+  (void)DDims;
+  assert(DDims.size() == 3);
+  auto elem = dest.getType()->getElementType();
+  (void)elem;
+  assert(lhs.getType()->getElementType() == elem);
+  assert(rhs.getType()->getElementType() == elem);
+
+  assert(LDims[0] == DDims[0] && RDims[0] == DDims[0] &&
+         "Mismatched batch size");
+  assert(LDims[1] == DDims[1] && "Invalid matrix dims");
+  assert(RDims[2] == DDims[2] && "Invalid matrix dims");
+  assert(LDims[2] == RDims[1] && "Invalid matrix dims");
+}
+
 void SigmoidNode::verify() const { verifySigmoid(getInput(), getResult()); }
 
 void SigmoidGradNode::verify() const {
@@ -393,6 +431,19 @@ void TransposeNode::verify() const {
   assert(dest.dims().equals(shape) && "Invalid transpose dims");
 }
 
+void BroadcastNode::verify() const {
+  auto dest = getResult();
+  auto src = getInput();
+  (void)dest;
+  (void)src;
+  assert(dest.dims().size() == src.dims().size() &&
+         "Invalid number of dimensions");
+  for (size_t i = 0, e = dest.dims().size(); i < e; i++) {
+    assert((src.dims()[i] == dest.dims()[i] || src.dims()[i] == 1) &&
+           "Invalid broadcast dims");
+  }
+}
+
 void SplatNode::verify() const {}
 
 void InsertTensorNode::verify() const {
@@ -536,6 +587,16 @@ void SGDNode::verify() const {
          "Invalid weight or gradient type");
 }
 
+void AdamNode::verify() const {
+  assert(getGradient().getType() == getWeight().getType() &&
+         "Invalid weight or gradient type");
+}
+
+void RMSPropNode::verify() const {
+  assert(getGradient().getType() == getWeight().getType() &&
+         "Invalid weight or gradient type");
+}
+
 void QuantizationProfileNode::verify() const {
   // Make sure that input tensor is a floating point type.
   assert(getInput().getElementType() == ElemKind::FloatTy &&
@@ -594,9 +655,51 @@ void TopKNode::verify() const {
   }
 }
 
+void LSTMCellNode::verify() const {
+  auto batch = getInput().dims()[0];
+  auto inputSize = getInput().dims()[1];
+  auto hiddenSize = getH().dims()[1];
+  (void)batch;
+  (void)inputSize;
+  (void)hiddenSize;
+  assert(getInput().dims().size() == 2 && "Input should be 2 dimensional");
+  assert(getH().dims().size() == 2 && getH().dims()[0] == batch &&
+         "Invalid hidden state shape");
+  checkSameType(getH(), getC());
+  checkSameType(getH(), getNewH());
+  checkSameType(getC(), getNewC());
+  assert(getWx().dims().size() == 2 && getWx().dims()[0] == inputSize &&
+         getWx().dims()[1] == 4 * hiddenSize && "Invalid Wx shape");
+  assert(getWh().dims().size() == 2 && getWh().dims()[0] == hiddenSize &&
+         getWh().dims()[1] == 4 * hiddenSize && "Invalid Wh shape");
+  assert(getBias().dims().size() == 1 &&
+         getBias().dims()[0] == 4 * hiddenSize && "Invalid bias shape");
+}
+
+void GRUCellNode::verify() const {
+  auto batch = getInput().dims()[0];
+  auto inputSize = getInput().dims()[1];
+  auto hiddenSize = getH().dims()[1];
+  (void)batch;
+  (void)inputSize;
+  (void)hiddenSize;
+  assert(getInput().dims().size() == 2 && "Input should be 2 dimensional");
+  assert(getH().dims().size() == 2 && getH().dims()[0] == batch &&
+         "Invalid hidden state shape");
+  checkSameType(getH(), getNewH());
+  assert(getWx().dims().size() == 2 && getWx().dims()[0] == inputSize &&
+         getWx().dims()[1] == 3 * hiddenSize && "Invalid Wx shape");
+  assert(getWh().dims().size() == 2 && getWh().dims()[0] == hiddenSize &&
+         getWh().dims()[1] == 3 * hiddenSize && "Invalid Wh shape");
+  assert(getBx().dims().size() == 1 && getBx().dims()[0] == 3 * hiddenSize &&
+         "Invalid Bx shape");
+  assert(getBh().dims().size() == 1 && getBh().dims()[0] == 3 * hiddenSize &&
+         "Invalid Bh shape");
+}
+
 void GatherNode::verify() const {
   assert(getResult().getElementType() == getData().getElementType());
-  assert(getIndices().getElementType() == ElemKind::IndexTy);
+  assert(getIndices().getType()->isIndexType());
   assert(getResult().dims().size() ==
          getData().dims().size() + getIndices().dims().size() - 1);
   if (getResult().getType()->isQuantizedType()) {
@@ -0,0 +1,952 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "glow/Graph/Serializer.h"
+
+#include "glow/Base/Tensor.h"
+#include "glow/Graph/Graph.h"
+#include "glow/Graph/Nodes.h"
+#include "glow/Graph/Utils.h"
+#include "glow/Support/Compiler.h"
+
+#include "llvm/Support/Casting.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace glow;
+
+/// The graph file is a stream of self-delimiting records:
+///
+///   GraphFileHeader
+///   type records    (one per unique type)
+///   variable records (one per variable, in reference order)
+///   node records    (one per node, in topological order)
+///
+/// Node operands are encoded as (id, result number) pairs, where ids number
+/// the variables first and then the nodes in file order, so every operand
+/// refers to a record that precedes it and the reader can resolve references
+/// in a single pass. The node kind numbering and the record layouts are part
+/// of the format and are covered by the version field in the header.
+///
+/// The weights file holds the raw variable payloads, each aligned to 64
+/// bytes; variable records address them by (offset, size). The loader maps
+/// the weights file and points the variable payloads straight into the
+/// mapping, so no weight data is copied or even touched at load time.
+namespace {
+
+/// The leading bytes of a graph file ("GGRB") and a weights file ("GWTB").
+constexpr uint32_t graphFileMagic = 0x42524747;
+constexpr uint32_t weightsFileMagic = 0x42545747;
+/// The version of the format that this code reads and writes.
+constexpr uint32_t serializerVersion = 1;
+/// The alignment of each payload within the weights file. Matches the
+/// alignment that Tensor uses for heap allocations, so kernels can make the
+/// same assumptions about mapped and malloc'ed weights.
+constexpr uint64_t weightsAlignment = 64;
+
+struct GraphFileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t numTypes;
+  uint64_t numVariables;
+  uint64_t numNodes;
+};
+
+struct WeightsFileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t numEntries;
+};
+
+/// The leading bytes of a checkpoint file ("GCKP").
+constexpr uint32_t checkpointFileMagic = 0x504b4347;
+
+/// A checkpoint file is one index of (name, type, offset, size) entries
+/// followed by the raw variable payloads, each aligned to
+/// \ref weightsAlignment. Restoring maps the file and copies the payloads
+/// into the matching variables by name.
+struct CheckpointFileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t numEntries;
+};
+
+/// Serializes POD values, strings and arrays into a growing byte buffer.
+/// All multi-byte fields are host-endian.
+class RecordWriter {
+  std::string buffer_;
+
+public:
+  template <typename T> void write(T value) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Can only serialize trivially copyable types");
+    buffer_.append(reinterpret_cast<const char *>(&value), sizeof(T));
+  }
+
+  void writeString(llvm::StringRef str) {
+    write<uint32_t>(str.size());
+    buffer_.append(str.data(), str.size());
+  }
+
+  /// Writes \p array as a length-prefixed sequence of \p StorageT elements.
+  template <typename StorageT, typename T>
+  void writeArray(llvm::ArrayRef<T> array) {
+    write<uint64_t>(array.size());
+    for (const T &element : array) {
+      write<StorageT>(static_cast<StorageT>(element));
+    }
+  }
+
+  llvm::StringRef str() const { return buffer_; }
+};
+
+/// Reads the records back out of a byte range, with bounds checking.
+class RecordReader {
+public:
+  explicit RecordReader(llvm::StringRef data)
+      : cursor_(data.begin()), end_(data.end()) {}
+
+  template <typename T> T read() {
+    GLOW_ASSERT(sizeof(T) <= (size_t)(end_ - cursor_) &&
+                "Truncated graph file");
+    T value;
+    memcpy(&value, cursor_, sizeof(T));
+    cursor_ += sizeof(T);
+    return value;
+  }
+
+  std::string readString() {
+    uint32_t size = read<uint32_t>();
+    GLOW_ASSERT(size <= (size_t)(end_ - cursor_) && "Truncated graph file");
+    std::string result(cursor_, size);
+    cursor_ += size;
+    return result;
+  }
+
+  template <typename StorageT, typename T = StorageT>
+  std::vector<T> readArray() {
+    uint64_t size = read<uint64_t>();
+    std::vector<T> result;
+    result.reserve(size);
+    for (uint64_t i = 0; i < size; i++) {
+      result.push_back(static_cast<T>(read<StorageT>()));
+    }
+    return result;
+  }
+
+  bool atEnd() const { return cursor_ == end_; }
+
+private:
+  const char *cursor_;
+  const char *end_;
+};
+
+/// Writes the graph and weights files for one function.
+class FunctionSerializer {
+  Function &F_;
+  /// The three record sections of the graph file.
+  RecordWriter types_;
+  RecordWriter variables_;
+  RecordWriter nodes_;
+  /// The unique types referenced so far, and their ids.
+  std::vector<TypeRef> typeTable_;
+  std::unordered_map<TypeRef, uint32_t> typeIds_;
+  /// Maps every serialized variable and node to its id.
+  std::unordered_map<const Node *, uint32_t> nodeIds_;
+
+  /// \returns the id of \p ty, appending a new type record on first use.
+  uint32_t getTypeId(TypeRef ty) {
+    auto it = typeIds_.find(ty);
+    if (it != typeIds_.end()) {
+      return it->second;
+    }
+
+    types_.write<uint8_t>(static_cast<uint8_t>(ty->getElementType()));
+    types_.writeArray<uint64_t>(ty->dims());
+    if (ty->isQuantizedType()) {
+      types_.write<float>(ty->getScale());
+      types_.write<int32_t>(ty->getOffset());
+      types_.write<uint8_t>(ty->isChannelwiseQuantized());
+      if (ty->isChannelwiseQuantized()) {
+        types_.write<uint32_t>(ty->getChannelAxis());
+        types_.writeArray<float>(ty->getChannelScales());
+        types_.writeArray<int32_t>(ty->getChannelOffsets());
+      }
+    }
+
+    uint32_t id = typeTable_.size();
+    typeTable_.push_back(ty);
+    typeIds_[ty] = id;
+    return id;
+  }
+
+  /// Writes the operand \p value as an (id, result number) pair.
+  void writeInput(NodeValue value) {
+    auto it = nodeIds_.find(value.getNode());
+    GLOW_ASSERT(it != nodeIds_.end() &&
+                "Node operands must precede the node in topological order");
+    nodes_.write<uint32_t>(it->second);
+    nodes_.write<uint32_t>(value.getResNo());
+  }
+
+  /// Writes the record of \p V, whose payload occupies \p size bytes at
+  /// \p offset in the weights file.
+  void writeVariable(Variable *V, uint64_t offset, uint64_t size) {
+    variables_.writeString(V->getName());
+    variables_.write<uint32_t>(getTypeId(V->getType()));
+    variables_.write<uint8_t>(static_cast<uint8_t>(V->getVisibilityKind()));
+    variables_.write<uint8_t>(static_cast<uint8_t>(V->getTrainKind()));
+    variables_.write<float>(V->getValue());
+    variables_.write<uint64_t>(offset);
+    variables_.write<uint64_t>(size);
+  }
+
+  /// Writes the record of the node \p N.
+  void writeNode(Node *N);
+
+public:
+  explicit FunctionSerializer(Function &F) : F_(F) {}
+
+  void save(llvm::StringRef graphFileName, llvm::StringRef weightsFileName);
+};
+
+void FunctionSerializer::writeNode(Node *N) {
+  GLOW_ASSERT(!N->hasPredicate() &&
+              "Cannot serialize nodes with predicates");
+
+  nodes_.write<uint32_t>(static_cast<uint32_t>(N->getKind()));
+  nodes_.writeString(N->getName());
+
+  // Save has no results; its record carries just the two operands.
+  if (auto *SN = llvm::dyn_cast<SaveNode>(N)) {
+    writeInput(SN->getInput());
+    writeInput(SN->getOutput());
+    return;
+  }
+
+  // Every other record starts with the type of the first result. Creators
+  // that compute their result type use it for verification at load time.
+  nodes_.write<uint32_t>(getTypeId(N->getType(0)));
+
+  switch (N->getKind()) {
+  case Kinded::Kind::ConvolutionNodeKind: {
+    auto *C = llvm::cast<ConvolutionNode>(N);
+    writeInput(C->getInput());
+    writeInput(C->getFilter());
+    writeInput(C->getBias());
+    nodes_.write<uint64_t>(C->getKernel());
+    nodes_.write<uint64_t>(C->getStride());
+    nodes_.writeArray<uint64_t>(C->getPads());
+    nodes_.write<uint64_t>(C->getGroup());
+    break;
+  }
+
+#define POOL_NODE_CASE(NODE_NAME_)                                             \
+  case Kinded::Kind::NODE_NAME_##NodeKind: {                                   \
+    auto *P = llvm::cast<NODE_NAME_##Node>(N);                                 \
+    writeInput(P->getInput());                                                 \
+    nodes_.write<uint64_t>(P->getKernel());                                    \
+    nodes_.write<uint64_t>(P->getStride());                                    \
+    nodes_.writeArray<uint64_t>(P->getPads());                                 \
+    break;                                                                     \
+  }
+    POOL_NODE_CASE(PoolMax)
+    POOL_NODE_CASE(PoolAvg)
+#undef POOL_NODE_CASE
+
+  case Kinded::Kind::FullyConnectedNodeKind: {
+    auto *FC = llvm::cast<FullyConnectedNode>(N);
+    writeInput(FC->getInput());
+    writeInput(FC->getWeights());
+    writeInput(FC->getBias());
+    break;
+  }
+
+  case Kinded::Kind::SoftMaxNodeKind: {
+    auto *SM = llvm::cast<SoftMaxNode>(N);
+    writeInput(SM->getInput());
+    writeInput(SM->getSelected());
+    break;
+  }
+
+#define UNARY_NODE_CASE(NODE_NAME_)                                            \
+  case Kinded::Kind::NODE_NAME_##NodeKind: {                                   \
+    writeInput(llvm::cast<NODE_NAME_##Node>(N)->getInput());                   \
+    break;                                                                     \
+  }
+    UNARY_NODE_CASE(Relu)
+    UNARY_NODE_CASE(Sigmoid)
+    UNARY_NODE_CASE(Tanh)
+    UNARY_NODE_CASE(Log)
+    UNARY_NODE_CASE(Quantize)
+    UNARY_NODE_CASE(Dequantize)
+    UNARY_NODE_CASE(RescaleQuantized)
+#undef UNARY_NODE_CASE
+
+#define BINARY_NODE_CASE(NODE_NAME_)                                           \
+  case Kinded::Kind::NODE_NAME_##NodeKind: {                                   \
+    auto *B = llvm::cast<NODE_NAME_##Node>(N);                                 \
+    writeInput(B->getLHS());                                                   \
+    writeInput(B->getRHS());                                                   \
+    break;                                                                     \
+  }
+    BINARY_NODE_CASE(Add)
+    BINARY_NODE_CASE(Mul)
+    BINARY_NODE_CASE(Sub)
+    BINARY_NODE_CASE(Div)
+    BINARY_NODE_CASE(Max)
+    BINARY_NODE_CASE(Min)
+    BINARY_NODE_CASE(CmpLTE)
+    BINARY_NODE_CASE(CmpEQ)
+    BINARY_NODE_CASE(MatMul)
+#undef BINARY_NODE_CASE
+
+  case Kinded::Kind::PowNodeKind: {
+    auto *P = llvm::cast<PowNode>(N);
+    writeInput(P->getBase());
+    nodes_.write<float>(P->getExp());
+    break;
+  }
+
+  case Kinded::Kind::SelectNodeKind: {
+    auto *S = llvm::cast<SelectNode>(N);
+    writeInput(S->getCond());
+    writeInput(S->getLHS());
+    writeInput(S->getRHS());
+    break;
+  }
+
+  case Kinded::Kind::BatchedAddNodeKind: {
+    auto *BA = llvm::cast<BatchedAddNode>(N);
+    writeInput(BA->getBatch());
+    writeInput(BA->getSlice());
+    break;
+  }
+
+  case Kinded::Kind::BatchedReduceAddNodeKind: {
+    auto *BR = llvm::cast<BatchedReduceAddNode>(N);
+    writeInput(BR->getBatch());
+    nodes_.write<uint64_t>(BR->getAxis());
+    break;
+  }
+
+  case Kinded::Kind::ReshapeNodeKind: {
+    auto *R = llvm::cast<ReshapeNode>(N);
+    writeInput(R->getInput());
+    nodes_.writeArray<uint64_t>(R->getDims());
+    break;
+  }
+
+  case Kinded::Kind::TransposeNodeKind: {
+    auto *T = llvm::cast<TransposeNode>(N);
+    writeInput(T->getInput());
+    nodes_.writeArray<uint32_t>(T->getShuffle());
+    break;
+  }
+
+  case Kinded::Kind::ConcatNodeKind: {
+    auto *C = llvm::cast<ConcatNode>(N);
+    nodes_.write<uint32_t>(C->getInputs().size());
+    for (const NodeValue &input : C->getInputs()) {
+      writeInput(input);
+    }
+    nodes_.write<uint32_t>(C->getDim());
+    break;
+  }
+
+  case Kinded::Kind::SliceNodeKind: {
+    auto *S = llvm::cast<SliceNode>(N);
+    writeInput(S->getInput());
+    nodes_.writeArray<uint64_t>(S->getStart());
+    break;
+  }
+
+  case Kinded::Kind::InsertTensorNodeKind: {
+    auto *IT = llvm::cast<InsertTensorNode>(N);
+    writeInput(IT->getBig());
+    writeInput(IT->getSmall());
+    nodes_.writeArray<uint64_t>(IT->getStart());
+    nodes_.write<uint64_t>(IT->getCount());
+    nodes_.write<uint64_t>(IT->getAxis());
+    break;
+  }
+
+  case Kinded::Kind::GatherNodeKind: {
+    auto *G = llvm::cast<GatherNode>(N);
+    writeInput(G->getData());
+    writeInput(G->getIndices());
+    nodes_.write<uint32_t>(G->getBatchDims());
+    break;
+  }
+
+  case Kinded::Kind::SplatNodeKind: {
+    nodes_.write<float>(llvm::cast<SplatNode>(N)->getValue());
+    break;
+  }
+
+  case Kinded::Kind::IntLookupTableNodeKind: {
+    auto *LT = llvm::cast<IntLookupTableNode>(N);
+    writeInput(LT->getInput());
+    writeInput(LT->getMapping());
+    break;
+  }
+
+  case Kinded::Kind::TopKNodeKind: {
+    auto *TK = llvm::cast<TopKNode>(N);
+    writeInput(TK->getInput());
+    nodes_.write<uint64_t>(TK->getK());
+    break;
+  }
+
+  default:
+    llvm::errs() << "Cannot serialize node: " << N->getDebugDesc() << "\n";
+    GLOW_UNREACHABLE("Node kind is not supported by the graph serializer");
+  }
+}
+
+void FunctionSerializer::save(llvm::StringRef graphFileName,
+                              llvm::StringRef weightsFileName) {
+  // Order the graph so that every node comes after its operands. The
+  // traversal starts only from the roots of \ref F_, so variables that
+  // belong to other functions in the module are not dragged in.
+  PostOrderVisitor visitor;
+  for (auto &N : F_.getNodes()) {
+    if (N.getNumUsers() == 0) {
+      visitPostOrder(&N, visitor);
+    }
+  }
+
+  std::vector<Variable *> variableOrder;
+  std::vector<Node *> nodeOrder;
+  for (Node *N : visitor.getPostOrder()) {
+    if (auto *V = llvm::dyn_cast<Variable>(N)) {
+      variableOrder.push_back(V);
+    } else {
+      nodeOrder.push_back(N);
+    }
+  }
+  GLOW_ASSERT(nodeOrder.size() == F_.getNodes().size() &&
+              "Every node must be reachable from the roots of the function");
+
+  // Write the weights file and assign ids and payload ranges to the
+  // variables.
+  std::error_code EC;
+  llvm::raw_fd_ostream weightsStream(weightsFileName, EC,
+                                     llvm::sys::fs::F_None);
+  GLOW_ASSERT(!EC && "Unable to create the weights file");
+
+  WeightsFileHeader weightsHeader;
+  weightsHeader.magic = weightsFileMagic;
+  weightsHeader.version = serializerVersion;
+  weightsHeader.numEntries = variableOrder.size();
+  weightsStream.write(reinterpret_cast<const char *>(&weightsHeader),
+                      sizeof(weightsHeader));
+
+  uint64_t pos = sizeof(weightsHeader);
+  for (size_t i = 0, e = variableOrder.size(); i < e; i++) {
+    Variable *V = variableOrder[i];
+    while (pos % weightsAlignment) {
+      weightsStream << '\0';
+      pos++;
+    }
+    uint64_t size = V->getPayload().getSizeInBytes();
+    weightsStream.write(V->getPayload().getUnsafePtr(), size);
+    nodeIds_[V] = i;
+    writeVariable(V, pos, size);
+    pos += size;
+  }
+
+  // Write the node records. The post-order guarantees that the operands of
+  // each node already carry ids.
+  for (size_t i = 0, e = nodeOrder.size(); i < e; i++) {
+    nodeIds_[nodeOrder[i]] = variableOrder.size() + i;
+    writeNode(nodeOrder[i]);
+  }
+
+  // Assemble the graph file.
+  llvm::raw_fd_ostream graphStream(graphFileName, EC, llvm::sys::fs::F_None);
+  GLOW_ASSERT(!EC && "Unable to create the graph file");
+
+  GraphFileHeader header;
+  header.magic = graphFileMagic;
+  header.version = serializerVersion;
+  header.numTypes = typeTable_.size();
+  header.numVariables = variableOrder.size();
+  header.numNodes = nodeOrder.size();
+  graphStream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  graphStream << types_.str() << variables_.str() << nodes_.str();
+}
+
+} // namespace
+
+void glow::saveFunction(Function &F, llvm::StringRef graphFileName,
+                        llvm::StringRef weightsFileName) {
+  FunctionSerializer(F).save(graphFileName, weightsFileName);
+}
+
+/// Reads one type record from \p reader and \returns it uniqued in \p M.
+static TypeRef readType(Module &M, RecordReader &reader) {
+  auto elemKind = static_cast<ElemKind>(reader.read<uint8_t>());
+  auto dims = reader.readArray<uint64_t, size_t>();
+
+  bool isQuantized = elemKind == ElemKind::Int8QTy ||
+                     elemKind == ElemKind::Int16QTy ||
+                     elemKind == ElemKind::Int32QTy;
+  if (!isQuantized) {
+    return M.uniqueType(Type(elemKind, dims));
+  }
+
+  float scale = reader.read<float>();
+  int32_t offset = reader.read<int32_t>();
+  Type ty(elemKind, dims, scale, offset);
+  if (reader.read<uint8_t>()) {
+    uint32_t axis = reader.read<uint32_t>();
+    auto scales = reader.readArray<float>();
+    auto offsets = reader.readArray<int32_t>();
+    ty = Type::newChannelwise(ty, scales, offsets, axis);
+  }
+  return M.uniqueType(ty);
+}
+
+std::unique_ptr<llvm::MemoryBuffer>
+glow::loadFunction(Function &F, llvm::StringRef graphFileName,
+                   llvm::StringRef weightsFileName) {
+  GLOW_ASSERT(F.getNodes().empty() && "Loading into a non-empty function");
+  Module &M = *F.getParent();
+
+  auto graphOrErr = llvm::MemoryBuffer::getFile(graphFileName);
+  GLOW_ASSERT(!graphOrErr.getError() && "Unable to open the graph file");
+  std::unique_ptr<llvm::MemoryBuffer> graph = std::move(*graphOrErr);
+
+  // Map the weights without requiring a null terminator, so the buffer stays
+  // a plain read-only mapping of the file.
+  auto weightsOrErr = llvm::MemoryBuffer::getFile(weightsFileName, /*FileSize=*/
+                                                  -1,
+                                                  /*RequiresNullTerminator=*/
+                                                  false);
+  GLOW_ASSERT(!weightsOrErr.getError() && "Unable to open the weights file");
+  std::unique_ptr<llvm::MemoryBuffer> weights = std::move(*weightsOrErr);
+
+  GLOW_ASSERT(graph->getBufferSize() >= sizeof(GraphFileHeader) &&
+              "Truncated graph file");
+  GraphFileHeader header;
+  memcpy(&header, graph->getBufferStart(), sizeof(header));
+  GLOW_ASSERT(header.magic == graphFileMagic && "Not a graph file");
+  GLOW_ASSERT(header.version == serializerVersion &&
+              "Unsupported graph file version");
+
+  GLOW_ASSERT(weights->getBufferSize() >= sizeof(WeightsFileHeader) &&
+              "Truncated weights file");
+  WeightsFileHeader weightsHeader;
+  memcpy(&weightsHeader, weights->getBufferStart(), sizeof(weightsHeader));
+  GLOW_ASSERT(weightsHeader.magic == weightsFileMagic &&
+              "Not a weights file");
+  GLOW_ASSERT(weightsHeader.version == serializerVersion &&
+              "Unsupported weights file version");
+  GLOW_ASSERT(weightsHeader.numEntries == header.numVariables &&
+              "The weights file does not match the graph file");
+
+  RecordReader reader(graph->getBuffer().drop_front(sizeof(header)));
+
+  std::vector<TypeRef> types;
+  types.reserve(header.numTypes);
+  for (uint64_t i = 0; i < header.numTypes; i++) {
+    types.push_back(readType(M, reader));
+  }
+  auto getType = [&](uint32_t id) -> TypeRef {
+    GLOW_ASSERT(id < types.size() && "Invalid type id");
+    return types[id];
+  };
+
+  /// Every variable and node, by its id in the file.
+  std::vector<Node *> nodesById;
+  nodesById.reserve(header.numVariables + header.numNodes);
+  auto readInput = [&]() -> NodeValue {
+    uint32_t id = reader.read<uint32_t>();
+    uint32_t resNo = reader.read<uint32_t>();
+    GLOW_ASSERT(id < nodesById.size() && "Operand refers to a later record");
+    return NodeValue(nodesById[id], resNo);
+  };
+
+  // Recreate the variables, aliasing their payloads into the mapped weights
+  // file. The mapping is read-only; writing through a payload would fault.
+  for (uint64_t i = 0; i < header.numVariables; i++) {
+    std::string name = reader.readString();
+    TypeRef ty = getType(reader.read<uint32_t>());
+    auto visibility = static_cast<VisibilityKind>(reader.read<uint8_t>());
+    auto train = static_cast<Variable::TrainKind>(reader.read<uint8_t>());
+    float val = reader.read<float>();
+    uint64_t offset = reader.read<uint64_t>();
+    uint64_t size = reader.read<uint64_t>();
+
+    GLOW_ASSERT(offset + size <= weights->getBufferSize() &&
+                "Payload lies outside of the weights file");
+    GLOW_ASSERT(size == ty->getSizeInBytes() &&
+                "Payload size does not match the variable type");
+
+    Variable *V = M.createVariable(ty, name, visibility, train, val);
+    V->getPayload() =
+        Tensor(const_cast<char *>(weights->getBufferStart() + offset), ty);
+    nodesById.push_back(V);
+  }
+
+  // Recreate the nodes. The records appear in topological order, so all of
+  // the operands are resolvable by the time a node is read.
+  for (uint64_t i = 0; i < header.numNodes; i++) {
+    auto kind = static_cast<Kinded::Kind>(reader.read<uint32_t>());
+    std::string name = reader.readString();
+
+    if (kind == Kinded::Kind::SaveNodeKind) {
+      NodeValue input = readInput();
+      NodeValue output = readInput();
+      nodesById.push_back(
+          F.createSave(name, input, llvm::cast<Variable>(output.getNode())));
+      continue;
+    }
+
+    TypeRef ty = getType(reader.read<uint32_t>());
+    Node *N = nullptr;
+
+    switch (kind) {
+    case Kinded::Kind::ConvolutionNodeKind: {
+      NodeValue input = readInput();
+      NodeValue filter = readInput();
+      NodeValue bias = readInput();
+      auto kernel = reader.read<uint64_t>();
+      auto stride = reader.read<uint64_t>();
+      auto pads = reader.readArray<uint64_t, size_t>();
+      auto group = reader.read<uint64_t>();
+      N = F.createConv(name, input, filter, bias, ty, kernel, stride, pads,
+                       group);
+      break;
+    }
+
+#define POOL_NODE_CASE(NODE_NAME_, CREATE_FN_)                                 \
+  case Kinded::Kind::NODE_NAME_##NodeKind: {                                   \
+    NodeValue input = readInput();                                             \
+    auto kernel = reader.read<uint64_t>();                                     \
+    auto stride = reader.read<uint64_t>();                                     \
+    auto pads = reader.readArray<uint64_t, size_t>();                          \
+    N = F.CREATE_FN_(name, input, kernel, stride, pads);                       \
+    break;                                                                     \
+  }
+      POOL_NODE_CASE(PoolMax, createPoolMax)
+      POOL_NODE_CASE(PoolAvg, createPoolAvg)
+#undef POOL_NODE_CASE
+
+    case Kinded::Kind::FullyConnectedNodeKind: {
+      NodeValue input = readInput();
+      NodeValue weights = readInput();
+      NodeValue bias = readInput();
+      N = F.createFullyConnected(name, input, weights.getNode(),
+                                 bias.getNode(), ty);
+      break;
+    }
+
+    case Kinded::Kind::SoftMaxNodeKind: {
+      NodeValue input = readInput();
+      NodeValue selected = readInput();
+      N = F.createSoftMax(name, input, selected);
+      break;
+    }
+
+#define UNARY_NODE_CASE(NODE_NAME_, CREATE_EXPR_)                              \
+  case Kinded::Kind::NODE_NAME_##NodeKind: {                                   \
+    NodeValue input = readInput();                                             \
+    N = CREATE_EXPR_;                                                          \
+    break;                                                                     \
+  }
+      UNARY_NODE_CASE(Relu, F.createRELU(name, input))
+      UNARY_NODE_CASE(Sigmoid, F.createSigmoid(name, input))
+      UNARY_NODE_CASE(Tanh, F.createTanh(name, input))
+      UNARY_NODE_CASE(Log, F.createLog(name, input))
+      UNARY_NODE_CASE(Quantize, F.createQuantize(name, input, ty))
+      UNARY_NODE_CASE(Dequantize, F.createDequantize(name, input))
+      UNARY_NODE_CASE(RescaleQuantized,
+                      F.createRescaleQuantized(name, input, ty))
+#undef UNARY_NODE_CASE
+
+#define BINARY_NODE_CASE(NODE_NAME_)                                           \
+  case Kinded::Kind::NODE_NAME_##NodeKind: {                                   \
+    NodeValue LHS = readInput();                                               \
+    NodeValue RHS = readInput();                                               \
+    N = F.create##NODE_NAME_(name, ty, LHS, RHS);                              \
+    break;                                                                     \
+  }
+      BINARY_NODE_CASE(Add)
+      BINARY_NODE_CASE(Mul)
+      BINARY_NODE_CASE(Sub)
+      BINARY_NODE_CASE(Div)
+      BINARY_NODE_CASE(Max)
+      BINARY_NODE_CASE(Min)
+      BINARY_NODE_CASE(CmpLTE)
+      BINARY_NODE_CASE(CmpEQ)
+      BINARY_NODE_CASE(MatMul)
+#undef BINARY_NODE_CASE
+
+    case Kinded::Kind::PowNodeKind: {
+      NodeValue base = readInput();
+      float exp = reader.read<float>();
+      N = F.createPow(name, base, exp);
+      break;
+    }
+
+    case Kinded::Kind::SelectNodeKind: {
+      NodeValue cond = readInput();
+      NodeValue LHS = readInput();
+      NodeValue RHS = readInput();
+      N = F.createSelect(name, ty, cond, LHS, RHS);
+      break;
+    }
+
+    case Kinded::Kind::BatchedAddNodeKind: {
+      NodeValue batch = readInput();
+      NodeValue slice = readInput();
+      N = F.createBatchedAdd(name, ty, batch, slice);
+      break;
+    }
+
+    case Kinded::Kind::BatchedReduceAddNodeKind: {
+      NodeValue batch = readInput();
+      auto axis = reader.read<uint64_t>();
+      N = F.createBatchedReduceAdd(name, ty, batch, axis);
+      break;
+    }
+
+    case Kinded::Kind::ReshapeNodeKind: {
+      NodeValue input = readInput();
+      auto dims = reader.readArray<uint64_t, size_t>();
+      N = F.createReshape(name, input, dims);
+      break;
+    }
+
+    case Kinded::Kind::TransposeNodeKind: {
+      NodeValue input = readInput();
+      auto shuffle = reader.readArray<uint32_t, unsigned>();
+      N = F.createTranspose(name, input, shuffle);
+      break;
+    }
+
+    case Kinded::Kind::ConcatNodeKind: {
+      uint32_t numInputs = reader.read<uint32_t>();
+      std::vector<NodeValue> inputs;
+      inputs.reserve(numInputs);
+      for (uint32_t in = 0; in < numInputs; in++) {
+        inputs.push_back(readInput());
+      }
+      uint32_t dim = reader.read<uint32_t>();
+      N = F.createConcat(name, inputs, dim, ty);
+      break;
+    }
+
+    case Kinded::Kind::SliceNodeKind: {
+      NodeValue input = readInput();
+      auto start = reader.readArray<uint64_t, size_t>();
+      N = F.createSlice(name, input, start, ty);
+      break;
+    }
+
+    case Kinded::Kind::InsertTensorNodeKind: {
+      NodeValue big = readInput();
+      NodeValue small = readInput();
+      auto start = reader.readArray<uint64_t, size_t>();
+      auto count = reader.read<uint64_t>();
+      auto axis = reader.read<uint64_t>();
+      N = F.createInsertTensor(name, big, small, start,
+                               static_cast<unsigned>(count),
+                               static_cast<unsigned>(axis));
+      break;
+    }
+
+    case Kinded::Kind::GatherNodeKind: {
+      NodeValue data = readInput();
+      NodeValue indices = readInput();
+      uint32_t batchDims = reader.read<uint32_t>();
+      N = F.createGather(name, data, indices, batchDims);
+      break;
+    }
+
+    case Kinded::Kind::SplatNodeKind: {
+      float value = reader.read<float>();
+      N = F.createSplat(name, ty, value);
+      break;
+    }
+
+    case Kinded::Kind::IntLookupTableNodeKind: {
+      NodeValue input = readInput();
+      NodeValue mapping = readInput();
+      N = F.addNode(new IntLookupTableNode(name, ty, input, mapping));
+      break;
+    }
+
+    case Kinded::Kind::TopKNodeKind: {
+      NodeValue input = readInput();
+      auto k = reader.read<uint64_t>();
+      N = F.createTopK(name, input, k);
+      break;
+    }
+
+    default:
+      GLOW_UNREACHABLE("Node kind is not supported by the graph serializer");
+    }
+
+    // Creators that compute their own result type must arrive at the type
+    // that was serialized.
+    GLOW_ASSERT(N->getType(0) == ty &&
+                "Restored node has an unexpected result type");
+    nodesById.push_back(N);
+  }
+
+  GLOW_ASSERT(reader.atEnd() && "Trailing bytes in the graph file");
+  return weights;
+}
+
+/// Writes all \p size bytes of \p data to \p fd at file offset \p offset.
+static void pwriteAll(int fd, const char *data, uint64_t size,
+                      uint64_t offset) {
+  while (size) {
+    ssize_t written = ::pwrite(fd, data, size, offset);
+    GLOW_ASSERT(written > 0 && "Unable to write the checkpoint file");
+    data += written;
+    size -= written;
+    offset += written;
+  }
+}
+
+void glow::saveCheckpoint(Module &M, llvm::StringRef checkpointFileName,
+                          unsigned numThreads) {
+  std::vector<Variable *> vars(M.getVars().begin(), M.getVars().end());
+
+  // The payload offsets depend on the size of the index, which depends only
+  // on the names and shapes; size the index in a dry pass first.
+  uint64_t indexSize = 0;
+  for (Variable *V : vars) {
+    indexSize += sizeof(uint32_t) + V->getName().size(); // Name.
+    indexSize += sizeof(uint8_t);                        // Element kind.
+    indexSize += sizeof(uint64_t) +
+                 V->dims().size() * sizeof(uint64_t); // Dimensions.
+    indexSize += 2 * sizeof(uint64_t);                // Offset and size.
+  }
+
+  // Lay out the payloads after the index, each aligned like in the weights
+  // file, and write the index records.
+  struct PayloadRange {
+    const char *data;
+    uint64_t offset;
+    uint64_t size;
+  };
+  std::vector<PayloadRange> ranges;
+  ranges.reserve(vars.size());
+
+  RecordWriter index;
+  uint64_t pos = sizeof(CheckpointFileHeader) + indexSize;
+  for (Variable *V : vars) {
+    pos = (pos + weightsAlignment - 1) / weightsAlignment * weightsAlignment;
+    uint64_t size = V->getPayload().getSizeInBytes();
+    index.writeString(V->getName());
+    index.write<uint8_t>(static_cast<uint8_t>(V->getElementType()));
+    index.writeArray<uint64_t>(V->dims());
+    index.write<uint64_t>(pos);
+    index.write<uint64_t>(size);
+    ranges.push_back({V->getPayload().getUnsafePtr(), pos, size});
+    pos += size;
+  }
+  GLOW_ASSERT(index.str().size() == indexSize && "Invalid index layout");
+
+  int fd = ::open(checkpointFileName.str().c_str(),
+                  O_CREAT | O_TRUNC | O_WRONLY, 0644);
+  GLOW_ASSERT(fd >= 0 && "Unable to create the checkpoint file");
+  int err = ::ftruncate(fd, pos);
+  GLOW_ASSERT(!err && "Unable to size the checkpoint file");
+
+  CheckpointFileHeader header;
+  header.magic = checkpointFileMagic;
+  header.version = serializerVersion;
+  header.numEntries = vars.size();
+  pwriteAll(fd, reinterpret_cast<const char *>(&header), sizeof(header), 0);
+  pwriteAll(fd, index.str().data(), indexSize, sizeof(header));
+
+  // Write the payloads at their precomputed offsets, sharded over the
+  // writer threads. The ranges are disjoint, so the writers need no
+  // synchronization and the cost is bounded by the disk bandwidth.
+  if (!numThreads) {
+    numThreads = std::thread::hardware_concurrency();
+  }
+  numThreads = std::max<unsigned>(
+      1, std::min<unsigned>(numThreads, ranges.size()));
+  auto writeShard = [&](unsigned t) {
+    for (size_t i = t, e = ranges.size(); i < e; i += numThreads) {
+      pwriteAll(fd, ranges[i].data, ranges[i].size, ranges[i].offset);
+    }
+  };
+  std::vector<std::thread> writers;
+  for (unsigned t = 1; t < numThreads; t++) {
+    writers.emplace_back(writeShard, t);
+  }
+  writeShard(0);
+  for (auto &w : writers) {
+    w.join();
+  }
+  ::close(fd);
+}
+
+void glow::loadCheckpoint(Module &M, llvm::StringRef checkpointFileName) {
+  // Map the checkpoint without requiring a null terminator, so the buffer
+  // stays a plain read-only mapping of the file and the payloads stream
+  // through the page cache instead of an extra read buffer.
+  auto bufOrErr =
+      llvm::MemoryBuffer::getFile(checkpointFileName, /*FileSize=*/-1,
+                                  /*RequiresNullTerminator=*/false);
+  GLOW_ASSERT(!bufOrErr.getError() && "Unable to open the checkpoint file");
+  std::unique_ptr<llvm::MemoryBuffer> buf = std::move(*bufOrErr);
+
+  GLOW_ASSERT(buf->getBufferSize() >= sizeof(CheckpointFileHeader) &&
+              "Truncated checkpoint file");
+  CheckpointFileHeader header;
+  memcpy(&header, buf->getBufferStart(), sizeof(header));
+  GLOW_ASSERT(header.magic == checkpointFileMagic && "Not a checkpoint file");
+  GLOW_ASSERT(header.version == serializerVersion &&
+              "Unsupported checkpoint file version");
+
+  RecordReader reader(buf->getBuffer().drop_front(sizeof(header)));
+  for (uint64_t i = 0; i < header.numEntries; i++) {
+    auto name = reader.readString();
+    auto elemKind = static_cast<ElemKind>(reader.read<uint8_t>());
+    auto dims = reader.readArray<uint64_t, size_t>();
+    auto offset = reader.read<uint64_t>();
+    auto size = reader.read<uint64_t>();
+
+    Variable *V = M.getVariableByName(name);
+    GLOW_ASSERT(V && "The checkpoint names a variable the module lacks");
+    GLOW_ASSERT(V->getElementType() == elemKind && V->dims().vec() == dims &&
+                "The checkpoint entry does not match the variable type");
+    GLOW_ASSERT(size == V->getPayload().getSizeInBytes() &&
+                "The checkpoint entry does not match the variable size");
+    GLOW_ASSERT(offset + size <= buf->getBufferSize() &&
+                "Truncated checkpoint file");
+    memcpy(V->getPayload().getUnsafePtr(), buf->getBufferStart() + offset,
+           size);
+  }
+}
@@ -20,10 +20,13 @@
 #include "glow/IR/IR.h"
 #include "glow/Support/Debug.h"
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/Support/Casting.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <memory>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -45,6 +48,8 @@ protected:
   Function &G_;
   /// Scheduled nodes.
   NodesPtrList &scheduled_;
+  /// Maps each scheduled node to its concurrency stream.
+  llvm::DenseMap<const Node *, unsigned> nodeStreams_;
 
 public:
   Scheduler(Function &G, NodesPtrList &scheduled)
@@ -56,6 +61,58 @@ public:
   virtual void schedule() = 0;
 
   NodesPtrList &getSchedule() { return scheduled_; }
+
+  /// Partitions the computed schedule into dependency-respecting concurrency
+  /// streams. Each stream is a chain of dependent nodes: a node joins the
+  /// stream of an input that is currently the last node of its stream, and
+  /// opens a new stream otherwise. Nodes on different streams may still
+  /// consume each other's results and must synchronize on their operand
+  /// producers, but independent branches of the graph always end up on
+  /// different streams and can execute concurrently.
+  void assignStreams() {
+    /// The last node that was assigned to each stream.
+    llvm::DenseMap<unsigned, const Node *> streamTail;
+    unsigned numStreams = 0;
+
+    for (Node *N : scheduled_) {
+      // Variables are memory, not computation; they do not belong to any
+      // stream.
+      if (isa<Variable>(N)) {
+        continue;
+      }
+
+      unsigned stream = 0;
+      bool joined = false;
+      auto tryJoin = [&](const Node *in) {
+        if (joined || isa<Variable>(in)) {
+          return;
+        }
+        auto it = nodeStreams_.find(in);
+        if (it == nodeStreams_.end() || streamTail[it->second] != in) {
+          return;
+        }
+        stream = it->second;
+        joined = true;
+      };
+
+      for (unsigned i = 0, e = N->getNumInputs(); i < e; i++) {
+        tryJoin(N->getNthInput(i).getNode());
+      }
+      if (N->hasPredicate()) {
+        tryJoin(N->getPredicate().getNode());
+      }
+      if (!joined) {
+        stream = numStreams++;
+      }
+      nodeStreams_[N] = stream;
+      streamTail[stream] = N;
+    }
+  }
+
+  /// \returns the stream assignment computed by assignStreams().
+  const llvm::DenseMap<const Node *, unsigned> &getNodeStreams() const {
+    return nodeStreams_;
+  }
 };
 
 /// This is a scheduler based on the generalized the paper "Generalizations of
@@ -96,8 +153,7 @@ class ChildMemSizeBasedScheduler : public Scheduler {
   void computeNodeComputationMaxMemorySize() {
     // Traverse nodes in such a way, that dependnecies are processed
     // before the node using them.
-    GraphPostOrderVisitor visitor(G_);
-    for (auto *N : visitor.getPostOrder()) {
+    for (auto *N : G_.getPostOrder()) {
       size_t maxSize = (N->getNumInputs() > 0)
                            ? std::max(resultMemSize_[N->getNthInput(0)],
                                       maxMemSize_[N->getNthInput(0)])
@@ -215,16 +271,226 @@ public:
   }
 };
 
-void IRFunction::scheduleGraph(NodesPtrList &Schedule) {
+/// A list scheduler that greedily minimizes the peak size of the live
+/// activation set. All data-ready nodes are kept in a ready list, and at
+/// every step the scheduler picks the candidate whose execution results in
+/// the smallest amount of live memory, preferring nodes that free more of
+/// their inputs. Unlike the Sethi-Ullman style scheduler above, which orders
+/// the children of each node in isolation, this scheduler compares all ready
+/// nodes against each other, which matters on wide, concat-heavy graphs.
+class PeakMemoryListScheduler : public Scheduler {
+  /// Dense numbering of the nodes in the function.
+  std::unordered_map<const Node *, size_t> nodeIdx_;
+  /// The nodes, indexed by their dense number.
+  std::vector<Node *> nodes_;
+  /// The nodes that must be scheduled before the node (inputs, predicate and
+  /// implicit memory dependencies).
+  std::vector<llvm::SmallVector<size_t, 4>> deps_;
+  /// The nodes that wait for the node to be scheduled.
+  std::vector<llvm::SmallVector<size_t, 4>> succs_;
+  /// Number of unscheduled dependencies per node.
+  std::vector<unsigned> depsLeft_;
+  /// Number of unscheduled in-function users per node. When it drops to zero
+  /// the node's results are dead.
+  std::vector<unsigned> usesLeft_;
+  /// Bytes that the results of each node occupy.
+  std::vector<size_t> resultSize_;
+
+  /// \returns the bytes held by the results of \p N.
+  static size_t sizeOfResults(const Node *N) {
+    size_t resultSize = 0;
+    for (size_t idx = 0, e = N->getNumResults(); idx < e; ++idx) {
+      resultSize += N->getType(idx)->getSizeInBytes();
+    }
+    return resultSize;
+  }
+
+  /// Records the dependency: \p from must be scheduled before \p to.
+  void addDep(Node *from, Node *to) {
+    // Variables are always available; they are scheduled before the nodes.
+    if (isa<Variable>(from)) {
+      return;
+    }
+    deps_[nodeIdx_[to]].push_back(nodeIdx_[from]);
+    succs_[nodeIdx_[from]].push_back(nodeIdx_[to]);
+  }
+
+  /// Builds the dependency structure of the function.
+  void buildDeps() {
+    for (auto &N : G_.getNodes()) {
+      nodeIdx_[&N] = nodes_.size();
+      nodes_.push_back(&N);
+    }
+    size_t numNodes = nodes_.size();
+    deps_.resize(numNodes);
+    succs_.resize(numNodes);
+    depsLeft_.assign(numNodes, 0);
+    usesLeft_.assign(numNodes, 0);
+    resultSize_.resize(numNodes);
+
+    for (size_t i = 0; i < numNodes; ++i) {
+      Node *N = nodes_[i];
+      resultSize_[i] = sizeOfResults(N);
+
+      for (size_t idx = 0, e = N->getNumInputs(); idx < e; ++idx) {
+        addDep(N->getNthInput(idx), N);
+      }
+      if (N->hasPredicate()) {
+        addDep(N->getPredicate(), N);
+      }
+      // We don't model memory dependencies, but we still need to honor them:
+      // a SaveNode must run after the last use of the variable it overwrites.
+      if (auto *save = dyn_cast<SaveNode>(N)) {
+        Variable *output = save->getVariable();
+        for (NodeUse &use : output->getUsers()) {
+          Node *user = use.getUser();
+          if (user == save || &G_ != user->getParent()) {
+            continue;
+          }
+          addDep(user, save);
+        }
+      }
+    }
+
+    for (size_t i = 0; i < numNodes; ++i) {
+      depsLeft_[i] = deps_[i].size();
+      usesLeft_[i] = succs_[i].size();
+    }
+  }
+
+  /// \returns the change in live memory caused by scheduling node \p i:
+  /// the bytes its results allocate minus the bytes of the inputs that die.
+  ssize_t memoryDelta(size_t i) const {
+    ssize_t delta = resultSize_[i];
+    // Count every distinct dependency whose last unscheduled user this is.
+    llvm::SmallVector<size_t, 4> counted;
+    for (size_t dep : deps_[i]) {
+      if (std::find(counted.begin(), counted.end(), dep) != counted.end()) {
+        continue;
+      }
+      counted.push_back(dep);
+      unsigned usesFromHere =
+          std::count(succs_[dep].begin(), succs_[dep].end(), i);
+      if (usesLeft_[dep] == usesFromHere) {
+        delta -= resultSize_[dep];
+      }
+    }
+    return delta;
+  }
+
+  void scheduleNodes() {
+    size_t numNodes = nodes_.size();
+    // The data-ready nodes.
+    std::vector<size_t> ready;
+    for (size_t i = 0; i < numNodes; ++i) {
+      if (depsLeft_[i] == 0) {
+        ready.push_back(i);
+      }
+    }
+
+    size_t liveSize = 0;
+    size_t peakSize = 0;
+    size_t numScheduled = 0;
+
+    while (!ready.empty()) {
+      // Pick the ready node with the smallest memory delta; prefer the one
+      // that frees the most memory on a tie.
+      size_t bestPos = 0;
+      ssize_t bestDelta = memoryDelta(ready[0]);
+      for (size_t pos = 1, e = ready.size(); pos < e; ++pos) {
+        ssize_t delta = memoryDelta(ready[pos]);
+        if (delta < bestDelta) {
+          bestDelta = delta;
+          bestPos = pos;
+        }
+      }
+      size_t i = ready[bestPos];
+      ready.erase(ready.begin() + bestPos);
+
+      scheduled_.push_back(nodes_[i]);
+      numScheduled++;
+
+      // Update the live set: the results of the node become live, and every
+      // input whose last user was just scheduled dies.
+      liveSize += resultSize_[i];
+      if (liveSize > peakSize) {
+        peakSize = liveSize;
+      }
+      for (size_t dep : deps_[i]) {
+        assert(usesLeft_[dep] > 0 && "Dependency released too many times");
+        if (--usesLeft_[dep] == 0) {
+          liveSize -= resultSize_[dep];
+        }
+      }
+
+      // Release the successors that became data-ready.
+      for (size_t succ : succs_[i]) {
+        assert(depsLeft_[succ] > 0 && "Successor released too many times");
+        if (--depsLeft_[succ] == 0) {
+          ready.push_back(succ);
+        }
+      }
+    }
+
+    assert(numScheduled == numNodes && "Cyclic dependency in the graph");
+    (void)numScheduled;
+    DEBUG_GLOW(llvm::outs() << "Peak live activation memory for "
+                            << G_.getName() << ": " << peakSize
+                            << " bytes\n");
+  }
+
+public:
+  PeakMemoryListScheduler(Function &G, NodesPtrList &Schedule)
+      : Scheduler(G, Schedule) {}
+
+  ~PeakMemoryListScheduler() override = default;
+
+  void schedule() override {
+    buildDeps();
+    scheduleNodes();
+  }
+};
+
+namespace {
+/// The scheduler to use when lowering the graph into IR.
+enum class SchedulerKind {
+  ChildMemSizeBased,
+  PeakMemoryList,
+};
+} // namespace
+
+static llvm::cl::opt<SchedulerKind> graphSchedulerOpt(
+    "graph-scheduler",
+    llvm::cl::desc("Scheduler to use when ordering the graph for IRGen"),
+    llvm::cl::Optional,
+    llvm::cl::values(clEnumValN(SchedulerKind::ChildMemSizeBased, "child-mem",
+                                "Sethi-Ullman style child-memory scheduler"),
+                     clEnumValN(SchedulerKind::PeakMemoryList, "list",
+                                "List scheduler minimizing peak live memory")),
+    llvm::cl::init(SchedulerKind::ChildMemSizeBased));
+
+void IRFunction::scheduleGraph(NodesPtrList &Schedule,
+                               llvm::DenseMap<const Node *, unsigned> &streams) {
   Schedule.clear();
   for (auto &N : G_->getParent()->getVars()) {
     Schedule.push_back(N);
   }
-  ChildMemSizeBasedScheduler CMSBScheduler(*G_, Schedule);
-  CMSBScheduler.schedule();
-  assert(CMSBScheduler.getSchedule().size() ==
+  std::unique_ptr<Scheduler> scheduler;
+  switch (graphSchedulerOpt) {
+  case SchedulerKind::ChildMemSizeBased:
+    scheduler.reset(new ChildMemSizeBasedScheduler(*G_, Schedule));
+    break;
+  case SchedulerKind::PeakMemoryList:
+    scheduler.reset(new PeakMemoryListScheduler(*G_, Schedule));
+    break;
+  }
+  scheduler->schedule();
+  assert(scheduler->getSchedule().size() ==
              G_->getNodes().size() + G_->getParent()->getVars().size() &&
          "All graph nodes have to be scheduled");
+  // Annotate the schedule with concurrency streams for the backends.
+  scheduler->assignStreams();
+  streams = scheduler->getNodeStreams();
 }
 
 } // namespace glow
@@ -18,6 +18,7 @@
 #include "glow/Graph/Graph.h"
 #include "glow/IR/IRUtils.h"
 #include "glow/IR/Instrs.h"
+#include "glow/Support/Memory.h"
 #include "glow/Support/Support.h"
 
 #include "llvm/Support/Casting.h"
@@ -93,6 +94,22 @@ void Instruction::setOperand(unsigned idx, Value *v) {
     ops_[idx].first = v;
     v->addUse(Use(idx, this));
   }
+
+  // The operand change can redirect a tensor-view chain to a different
+  // buffer. Drop the cached origin of this instruction and of every view
+  // that looks through it.
+  if (isa<TensorViewInst>(this)) {
+    llvm::SmallVector<Instruction *, 4> worklist{this};
+    while (!worklist.empty()) {
+      Instruction *I = worklist.pop_back_val();
+      I->cachedOrigin_ = nullptr;
+      for (const auto &U : I->getUsers()) {
+        if (isa<TensorViewInst>(U.get())) {
+          worklist.push_back(U.get());
+        }
+      }
+    }
+  }
 }
 
 Instruction::Operand Instruction::getOperand(unsigned idx) const {
@@ -134,6 +151,24 @@ void Value::verifyUseList(const InstructionNumbering &InstrNumbering) const {
   }
 }
 
+namespace {
+
+/// \returns the calling thread's IR object allocator.
+SlabAllocator &getIRAllocator() {
+  thread_local SlabAllocator allocator;
+  return allocator;
+}
+
+} // namespace
+
+void *Value::operator new(size_t size) {
+  return getIRAllocator().allocate(size);
+}
+
+void Value::operator delete(void *ptr, size_t size) {
+  getIRAllocator().deallocate(ptr, size);
+}
+
 void Instruction::destroyInstruction(Instruction *I) {
   switch (I->getKind()) {
   default:
@@ -201,6 +236,8 @@ void IRFunction::clear() {
   // iplist's destructor is going to destroy the InstList.
   instrs_.clearAndLeakNodesUnsafely();
   weights_.clear();
+  instrStreams_.clear();
+  numStreams_ = 0;
 
   G_ = nullptr;
 }
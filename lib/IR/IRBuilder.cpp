@@ -136,9 +136,10 @@ TopKInst *IRBuilder::createTopKOp(Value *input, size_t k) {
   outDims.back() = k;
   auto outTy = F_->getGraph()->getParent()->uniqueTypeWithNewShape(
       input->getType(), outDims);
-  // Allocate enough scratch space to hold N values and N indices.
-  auto *scratch = createAllocActivationInst("topk.scratch", ElemKind::IndexTy,
-                                            {inDims.back() * 2});
+  // Allocate enough scratch space to hold K values and K indices, which is
+  // all the bounded-heap selection in the kernel needs.
+  auto *scratch =
+      createAllocActivationInst("topk.scratch", ElemKind::IndexTy, {k * 2});
   createSplatInst("topk.zero.scratch", scratch, 0);
   auto *values = createAllocActivationInst("topk.values", outTy);
   auto *indices =
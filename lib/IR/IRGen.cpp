@@ -16,6 +16,7 @@
 
 #include "glow/Graph/Graph.h"
 #include "glow/Graph/Nodes.h"
+#include "glow/Graph/Utils.h"
 #include "glow/IR/IR.h"
 #include "glow/IR/IRBuilder.h"
 
@@ -68,6 +69,9 @@ struct IRGenVisitor : NodeWalker {
   IRFunction *F_;
   /// The builder that adds instructions into the function.
   IRBuilder builder_;
+  /// The concurrency stream of every scheduled node, computed by the
+  /// scheduler. The instructions emitted for a node inherit its stream.
+  const llvm::DenseMap<const Node *, unsigned> &nodeStreams_;
 
 public:
   bool shouldVisit(Node *parent, Node *N) override {
@@ -75,7 +79,9 @@ public:
     return !visited_.count(N);
   }
 
-  explicit IRGenVisitor(IRFunction *M) : F_(M), builder_(F_) {}
+  explicit IRGenVisitor(IRFunction *M,
+                        const llvm::DenseMap<const Node *, unsigned> &streams)
+      : F_(M), builder_(F_), nodeStreams_(streams) {}
 
   /// \returns the generated instruction for the node \p N.
   Value *valueForNode(NodeValue N) {
@@ -104,6 +110,26 @@ public:
   void post(Node *parent, Node *N) override {
     visited_.insert(N);
 
+    // Remember where the instruction list ends, so that the instructions
+    // emitted for \p N below can be annotated with its stream.
+    auto &instrs = F_->getInstrs();
+    bool wasEmpty = instrs.empty();
+    auto lastBefore = wasEmpty ? instrs.end() : std::prev(instrs.end());
+
+    emitNodeIR(N);
+
+    auto it = nodeStreams_.find(N);
+    if (it != nodeStreams_.end()) {
+      for (auto cur = wasEmpty ? instrs.begin() : std::next(lastBefore),
+                e = instrs.end();
+           cur != e; ++cur) {
+        F_->setInstrStream(&*cur, it->second);
+      }
+    }
+  }
+
+  /// Emits the instructions that implement the node \p N.
+  void emitNodeIR(Node *N) {
     switch (N->getKind()) {
     default:
       llvm_unreachable("Unhandled node; perhaps the node should have been "
@@ -357,6 +383,57 @@ public:
       registerIR(LRG->getGradOfInputNamedInput(), srcGrad);
       break;
     }
+    case glow::Kinded::Kind::SGDNodeKind: {
+      auto *S = cast<SGDNode>(N);
+      auto *W = valueForNode(S->getWeight());
+      auto *G = valueForNode(S->getGradient());
+      // The momentum accumulator lives in its own weight, so it persists
+      // across iterations like the gsum variable that lowering creates.
+      // It stays untouched when the momentum is zero.
+      auto *Gsum = builder_.createWeightVar(W->getType(), "gsum",
+                                            WeightVar::MutabilityKind::Mutable);
+      builder_.createSGDInst(N->getName(), G, W, Gsum, S->getL1Decay(),
+                             S->getL2Decay(), S->getLearningRate(),
+                             S->getMomentum(), S->getBatchSize());
+      // The weight is updated in place.
+      registerIR(S->getUpdatedWeight(), W);
+      break;
+    }
+    case glow::Kinded::Kind::AdamNodeKind: {
+      auto *A = cast<AdamNode>(N);
+      auto *W = valueForNode(A->getWeight());
+      auto *G = valueForNode(A->getGradient());
+      // The gradient moments and the step count persist across iterations.
+      auto *M = builder_.createWeightVar(W->getType(), "adam.m",
+                                         WeightVar::MutabilityKind::Mutable);
+      auto *V = builder_.createWeightVar(W->getType(), "adam.v",
+                                         WeightVar::MutabilityKind::Mutable);
+      auto *step =
+          builder_.createWeightVar(ElemKind::FloatTy, {1}, "adam.step",
+                                   WeightVar::MutabilityKind::Mutable);
+      builder_.createAdamInst(N->getName(), G, W, M, V, step, A->getL1Decay(),
+                              A->getL2Decay(), A->getLearningRate(),
+                              A->getBeta1(), A->getBeta2(), A->getEpsilon(),
+                              A->getBatchSize());
+      // The weight is updated in place.
+      registerIR(A->getUpdatedWeight(), W);
+      break;
+    }
+    case glow::Kinded::Kind::RMSPropNodeKind: {
+      auto *R = cast<RMSPropNode>(N);
+      auto *W = valueForNode(R->getWeight());
+      auto *G = valueForNode(R->getGradient());
+      // The squared-gradient average persists across iterations.
+      auto *MS = builder_.createWeightVar(W->getType(), "rmsprop.ms",
+                                          WeightVar::MutabilityKind::Mutable);
+      builder_.createRMSPropInst(N->getName(), G, W, MS, R->getL1Decay(),
+                                 R->getL2Decay(), R->getLearningRate(),
+                                 R->getDecay(), R->getEpsilon(),
+                                 R->getBatchSize());
+      // The weight is updated in place.
+      registerIR(R->getUpdatedWeight(), W);
+      break;
+    }
     case glow::Kinded::Kind::SaveNodeKind: {
       auto *R = cast<SaveNode>(N);
       auto *src = valueForNode(R->getInput());
@@ -393,6 +470,33 @@ public:
       V->setName(N->getName());
       break;
     }
+    case glow::Kinded::Kind::LSTMCellNodeKind: {
+      auto *LC = cast<LSTMCellNode>(N);
+      auto *newH = builder_.createAllocActivationInst(
+          "lstm.newh", LC->getNewH().getType());
+      auto *newC = builder_.createAllocActivationInst(
+          "lstm.newc", LC->getNewC().getType());
+      auto *V = builder_.createLSTMCellInst(
+          N->getName(), newH, newC, valueForNode(LC->getInput()),
+          valueForNode(LC->getH()), valueForNode(LC->getC()),
+          valueForNode(LC->getWx()), valueForNode(LC->getWh()),
+          valueForNode(LC->getBias()));
+      registerIR(LC->getNewH(), V->getNewH());
+      registerIR(LC->getNewC(), V->getNewC());
+      break;
+    }
+    case glow::Kinded::Kind::GRUCellNodeKind: {
+      auto *GC = cast<GRUCellNode>(N);
+      auto *newH = builder_.createAllocActivationInst(
+          "gru.newh", GC->getNewH().getType());
+      auto *V = builder_.createGRUCellInst(
+          N->getName(), newH, valueForNode(GC->getInput()),
+          valueForNode(GC->getH()), valueForNode(GC->getWx()),
+          valueForNode(GC->getWh()), valueForNode(GC->getBx()),
+          valueForNode(GC->getBh()));
+      registerIR(GC->getNewH(), V->getNewH());
+      break;
+    }
     }
   }
 };
@@ -401,12 +505,13 @@ public:
 
 void IRFunction::generateIR() {
   G_->verify();
-  // Schedule the nodes.
+  // Schedule the nodes and partition the schedule into concurrency streams.
   NodesPtrList ScheduledNodes;
-  scheduleGraph(ScheduledNodes);
-  IRGenVisitor irgen(this);
+  llvm::DenseMap<const Node *, unsigned> nodeStreams;
+  scheduleGraph(ScheduledNodes, nodeStreams);
+  IRGenVisitor irgen(this, nodeStreams);
 
   for (auto &N : ScheduledNodes) {
-    N->visit(nullptr, &irgen);
+    visitPostOrder(N, irgen);
   }
 }
@@ -25,17 +25,30 @@ using llvm::isa;
 
 bool glow::isTensorView(glow::Value *v) { return isa<TensorViewInst>(v); }
 
-Value *glow::getAllocationOrigin(Value *V) {
-  while (true) {
-    if (auto *AI = dyn_cast<AllocActivationInst>(V))
-      return AI;
-    if (auto *TVI = dyn_cast<TensorViewInst>(V)) {
-      V = TVI->getSrc();
-      continue;
+size_t glow::calculateTensorViewOffset(const TensorViewInst *TVI) {
+  // Accumulate the element offsets of every tensorview on the path down to
+  // the origin allocation. Each level's offsets are flattened in row-major
+  // order over the dimensions of that level's source.
+  size_t offset = 0;
+  for (const Value *V = TVI; (TVI = dyn_cast<TensorViewInst>(V));
+       V = TVI->getSrc()) {
+    auto dims = TVI->getSrc()->dims();
+    auto offsets = TVI->getOffsets();
+    assert(offsets.size() == dims.size() &&
+           "TensorView must have an offset per source dimension");
+    size_t index = 0, slice = 1;
+    for (int i = dims.size() - 1; i >= 0; i--) {
+      index += slice * offsets[i];
+      slice *= dims[i];
     }
-    return nullptr;
+    offset += index;
   }
-  return nullptr;
+  return offset;
+}
+
+Value *glow::getAllocationOrigin(Value *V) {
+  auto *origin = getOrigin(V);
+  return isa<AllocActivationInst>(origin) ? origin : nullptr;
 }
 
 Value *glow::getOrigin(Value *V) {
@@ -43,11 +56,15 @@ Value *glow::getOrigin(Value *V) {
 }
 
 const Value *glow::getOrigin(const Value *V) {
-  while (true) {
-    auto *TVI = dyn_cast<TensorViewInst>(V);
-    if (!TVI)
-      return V;
-    V = TVI->getSrc();
-  }
-  return V;
+  auto *TVI = dyn_cast<TensorViewInst>(V);
+  if (!TVI)
+    return V;
+  if (Value *cached = TVI->getCachedOrigin())
+    return cached;
+  // Resolve the source recursively, so that every view of the chain gets the
+  // origin memoized and subsequent queries on any of them are O(1). The
+  // cache is reset by Instruction::setOperand when a view is redirected.
+  auto *origin = const_cast<Value *>(getOrigin(TVI->getSrc()));
+  TVI->setCachedOrigin(origin);
+  return origin;
 }
@@ -0,0 +1,64 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "glow/IR/MemoryUsage.h"
+#include "glow/IR/IR.h"
+#include "glow/IR/Instrs.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/Casting.h"
+
+using namespace glow;
+using llvm::dyn_cast;
+
+MemoryUsageReport glow::collectMemoryUsage(const IRFunction &M) {
+  MemoryUsageReport report;
+
+  for (auto &W : M.getWeights()) {
+    if (W->getMutability() == WeightVar::MutabilityKind::Constant) {
+      report.constantWeightBytes += W->getSizeInBytes();
+    } else {
+      report.mutableWeightBytes += W->getSizeInBytes();
+    }
+  }
+
+  // Walk the linear instruction sequence and simulate the allocations. The
+  // index of every live buffer in the lifetimes list is recorded so that the
+  // matching dealloc can close the interval.
+  llvm::DenseMap<const Value *, size_t> liveBuffers;
+  size_t liveBytes = 0;
+  size_t instrIdx = 0;
+  size_t numInstrs = M.getInstrs().size();
+  for (auto &I : M.getInstrs()) {
+    if (auto *A = dyn_cast<AllocActivationInst>(&I)) {
+      liveBuffers[A] = report.activationLifetimes.size();
+      report.activationLifetimes.push_back(
+          {A->getName().str(), A->getSizeInBytes(), instrIdx, numInstrs});
+      liveBytes += A->getSizeInBytes();
+      report.peakActivationBytes =
+          std::max(report.peakActivationBytes, liveBytes);
+    } else if (auto *D = dyn_cast<DeallocActivationInst>(&I)) {
+      auto it = liveBuffers.find(D->getAlloc());
+      assert(it != liveBuffers.end() && "Dealloc of an unknown buffer");
+      report.activationLifetimes[it->second].freedAt = instrIdx;
+      liveBytes -= D->getAlloc()->getSizeInBytes();
+      liveBuffers.erase(it);
+    }
+    instrIdx++;
+  }
+
+  return report;
+}
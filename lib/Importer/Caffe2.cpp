@@ -20,22 +20,38 @@
 #include "glow/Graph/Nodes.h"
 
 #include "llvm/Support/Casting.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/MemoryBuffer.h"
 
 #include "caffe.pb.h"
+#include <google/protobuf/arena.h>
 #include <google/protobuf/io/coded_stream.h>
 #include <google/protobuf/io/zero_copy_stream_impl.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
-#include <fstream>
 #include <iostream>
 #include <string>
+#include <utility>
 #include <vector>
 
 using namespace glow;
 using llvm::cast;
 
+static llvm::cl::opt<unsigned> maxProtoSizeMB(
+    "caffe2-max-proto-size",
+    llvm::cl::desc("Maximum accepted size of a caffe2 protobuf file, in "
+                   "megabytes (capped at the 2GB protobuf limit)"),
+    llvm::cl::init(2047));
+
+/// \returns the configured protobuf size limit in bytes.
+static int protoSizeLimit() {
+  return (int)std::min<uint64_t>(uint64_t(maxProtoSizeMB) * 1024 * 1024,
+                                 MAX_PROTO_SIZE);
+}
+
 using ArgumentDictionaryTy =
     std::unordered_map<std::string, const caffe2::Argument *>;
 
@@ -98,27 +114,37 @@ unsigned getSizeHW(ArgumentDictionaryTy &dict, const std::string &name,
   return defaultValue;
 }
 
-bool caffe2ModelLoader::loadProtoFile(caffe2::NetDef &net,
-                                      const std::string &filename) {
-  std::ifstream ff(filename, std::ios::in | std::ios::binary);
-  GLOW_ASSERT(ff && "Can't find the model or network files.");
+caffe2::NetDef *caffe2ModelLoader::loadProtoFile(google::protobuf::Arena &arena,
+                                                 const std::string &filename) {
+  // Map the file instead of reading it: the parser pulls the bytes straight
+  // out of the page cache, and no second copy of a multi-GB init_net is ever
+  // materialized.
+  auto bufferOrErr = llvm::MemoryBuffer::getFile(filename);
+  GLOW_ASSERT(bufferOrErr && "Can't find the model or network files.");
+  auto &buffer = *bufferOrErr.get();
+  GLOW_ASSERT(buffer.getBufferSize() <= (size_t)protoSizeLimit() &&
+              "The file exceeds the protobuf size limit.");
+
+  // The messages go on the arena, which packs the millions of small tensor
+  // protos of a large weight file into big contiguous blocks and frees them
+  // all at once.
+  auto *net = google::protobuf::Arena::CreateMessage<caffe2::NetDef>(&arena);
 
   bool parseNet = false;
+  google::protobuf::io::ArrayInputStream arrayStr(buffer.getBufferStart(),
+                                                  buffer.getBufferSize());
   if (filename.find(".pbtxt") != std::string::npos) {
-    std::string str((std::istreambuf_iterator<char>(ff)),
-                    std::istreambuf_iterator<char>());
-    parseNet = google::protobuf::TextFormat::ParseFromString(str, &net);
+    parseNet = google::protobuf::TextFormat::Parse(&arrayStr, net);
   } else {
     // Construct and configure a Coded Input Stream
-    google::protobuf::io::IstreamInputStream filestr(&ff);
-    google::protobuf::io::CodedInputStream codedstr(&filestr);
+    google::protobuf::io::CodedInputStream codedstr(&arrayStr);
     // Don't warn about large file sizes.
-    codedstr.SetTotalBytesLimit(MAX_PROTO_SIZE, MAX_PROTO_SIZE);
-    parseNet = net.ParseFromCodedStream(&codedstr);
+    codedstr.SetTotalBytesLimit(protoSizeLimit(), protoSizeLimit());
+    parseNet = net->ParseFromCodedStream(&codedstr);
   }
 
   GLOW_ASSERT(parseNet && "Failed to parse the network descriptor.");
-  return true;
+  return net;
 }
 
 bool caffe2ModelLoader::getBroadcast(const ArgumentDictionaryTy &dict) {
@@ -177,10 +203,10 @@ void caffe2ModelLoader::loadOperator(const caffe2::OperatorDef &op) {
     auto *bias = G_.getParent()->createVariable("conv.bias", biasTensor);
 
     // Caffe passes the input as NCHW, and we expect the input to be NHWC.
-    auto *tr = G_.createTranspose(opName, in, NCHW2NHWC);
+    NodeValue tr = createTransposeOrFold(opName, in, NCHW2NHWC);
 
     // Calculate the size and allocate the output buffer.
-    ShapeNHWC idim = ShapeNHWC(tr->getResult().dims());
+    ShapeNHWC idim = ShapeNHWC(tr.dims());
     auto outSz =
         calculateConvPoolOutputDims(idim.h, idim.w, kernel, stride, pads);
     std::array<size_t, 4> outDims = {
@@ -203,7 +229,7 @@ void caffe2ModelLoader::loadOperator(const caffe2::OperatorDef &op) {
     unsigned kernel = getSizeHW(dict, "kernel", 0);
     std::vector<size_t> pads = getPads(dict);
 
-    auto *tr = G_.createTranspose(opName, in, NCHW2NHWC);
+    NodeValue tr = createTransposeOrFold(opName, in, NCHW2NHWC);
 
     // If 'global_pooling' is set then the operation will pool over the size of
     // the input by doing: kernel = height/width.
@@ -413,7 +439,62 @@ void caffe2ModelLoader::loadNetwork(caffe2::NetDef &net) {
   }
 }
 
+/// Materialize the payload of the GivenTensorFill-family operator \p op into
+/// \p T. This only touches \p op and \p T, so independent fills can run on
+/// different threads.
+static void loadGivenTensorFill(const caffe2::OperatorDef &op, Tensor *T) {
+  /*
+   output: "conv1_w"
+   name: ""
+   type: "GivenTensorFill"
+   arg {
+   name: "shape"
+   ints: 96
+   ints: 3
+   ints: 11
+   ints: 11
+   }
+   arg {
+   name: "values"
+   floats: -0.028315347
+   */
+  ArgumentDictionaryTy dict = loadArgumentMap(op);
+  const std::string &typeName = op.type();
+  (void)typeName;
+
+  auto dim = getShape(dict["shape"]);
+
+  size_t i = 0;
+  if (dict["values"]->floats_size()) {
+    assert(typeName != "GivenTensorIntFill" &&
+           typeName != "GivenTensorInt64Fill");
+    T->reset(ElemKind::FloatTy, dim);
+    auto TH = T->getHandle<>();
+    for (auto num : dict["values"]->floats()) {
+      TH.raw(i++) = num;
+    }
+  } else if (dict["values"]->ints_size()) {
+    T->reset(ElemKind::IndexTy, dim);
+    auto TH = T->getHandle<size_t>();
+    for (auto num : dict["values"]->ints()) {
+      assert(0 <= num && num < (1LL << 32) &&
+             "Only uint32 integers are supported");
+      TH.raw(i++) = num;
+    }
+  } else {
+    unexpectedNodeError(op, "Unsupported data type for GivenTensorFill.");
+  }
+
+  assert(i == T->size() && "The number of serialized values does not "
+                           "match the size of the tensor.");
+}
+
 void caffe2ModelLoader::loadWeights(caffe2::NetDef &net) {
+  // The GivenTensorFill decodes are independent of each other and dominate
+  // the load time, so the serial pass below only allocates and registers
+  // their tensors and the payloads are materialized in parallel afterwards.
+  std::vector<std::pair<const caffe2::OperatorDef *, Tensor *>> fills;
+
   for (auto &op : net.op()) {
     ArgumentDictionaryTy dict = loadArgumentMap(op);
     const std::string &typeName = op.type();
@@ -421,52 +502,11 @@ void caffe2ModelLoader::loadWeights(caffe2::NetDef &net) {
     /// Load tensors with values:
     if (typeName == "GivenTensorFill" || typeName == "GivenTensorIntFill" ||
         typeName == "GivenTensorInt64Fill") {
-      /*
-       output: "conv1_w"
-       name: ""
-       type: "GivenTensorFill"
-       arg {
-       name: "shape"
-       ints: 96
-       ints: 3
-       ints: 11
-       ints: 11
-       }
-       arg {
-       name: "values"
-       floats: -0.028315347
-       */
-
       auto *T = new Tensor();
       for (auto &o : op.output()) {
         tensors_[o] = T;
       }
-
-      auto dim = getShape(dict["shape"]);
-
-      size_t i = 0;
-      if (dict["values"]->floats_size()) {
-        assert(typeName != "GivenTensorIntFill" &&
-               typeName != "GivenTensorInt64Fill");
-        T->reset(ElemKind::FloatTy, dim);
-        auto TH = T->getHandle<>();
-        for (auto num : dict["values"]->floats()) {
-          TH.raw(i++) = num;
-        }
-      } else if (dict["values"]->ints_size()) {
-        T->reset(ElemKind::IndexTy, dim);
-        auto TH = T->getHandle<size_t>();
-        for (auto num : dict["values"]->ints()) {
-          assert(0 <= num && num < (1LL << 32) &&
-                 "Only uint32 integers are supported");
-          TH.raw(i++) = num;
-        }
-      } else {
-        unexpectedNodeError(op, "Unsupported data type for GivenTensorFill.");
-      }
-
-      assert(i == T->size() && "The number of serialized values does not "
-                               "match the size of the tensor.");
+      fills.emplace_back(&op, T);
       continue;
     }
 
@@ -532,6 +572,8 @@ void caffe2ModelLoader::loadWeights(caffe2::NetDef &net) {
                    << " random numbers. This could be source of discrepancy.\n";
 #endif // NDEBUG
       // Uniformly generate random numbers in [tensorMin; tensorMax).
+      // This stays on the serial path: the module PRNG is not thread-safe,
+      // and a fixed draw order keeps the runs reproducible.
       for (size_t i = 0, e = T->size(); i != e; i++) {
         TH.raw(i) =
             G_.getParent()->getPRNG().nextRandReal(tensorMin, tensorMax);
@@ -541,6 +583,10 @@ void caffe2ModelLoader::loadWeights(caffe2::NetDef &net) {
 
     unexpectedNodeError(op, "Unsupported weight kind");
   }
+
+  parallelForIndices(fills.size(), [&](size_t i) {
+    loadGivenTensorFill(*fills[i].first, fills[i].second);
+  });
 }
 
 caffe2ModelLoader::caffe2ModelLoader(const std::string &netDescFilename,
@@ -549,13 +595,15 @@ caffe2ModelLoader::caffe2ModelLoader(const std::string &netDescFilename,
                                      llvm::ArrayRef<Tensor *> tensors,
                                      Function &F)
     : CommonOperatorLoader(names, tensors, F) {
-  // The caffe2 weights that we are deserializing.
-  caffe2::NetDef weightsDef;
+  // The arena that owns the deserialized protos for the duration of the
+  // load.
+  google::protobuf::Arena arena;
+
   // The caffe2 network descriptor that we are deserializing.
-  caffe2::NetDef networkDef;
+  caffe2::NetDef *networkDef = loadProtoFile(arena, netDescFilename);
+  // The caffe2 weights that we are deserializing.
+  caffe2::NetDef *weightsDef = loadProtoFile(arena, netWeightFilename);
 
-  loadProtoFile(networkDef, netDescFilename);
-  loadProtoFile(weightsDef, netWeightFilename);
-  loadWeights(weightsDef);
-  loadNetwork(networkDef);
+  loadWeights(*weightsDef);
+  loadNetwork(*networkDef);
 }
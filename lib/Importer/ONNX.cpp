@@ -118,7 +118,11 @@ std::vector<size_t> getPads(const ArgumentDictionaryTy &dict) {
   return {0, 0, 0, 0};
 }
 
-/// Loads tensor \p T from the input \p in.
+/// Loads tensor \p T from the input \p in. Raw-format tensors already have
+/// the exact memory layout of a tensor payload, so \p T aliases the proto
+/// buffer instead of copying it; such tensors must only be read, and only
+/// while the proto that owns \p in is alive. Both hold during a load: the
+/// registered tensors are consumed before the loader constructor returns.
 static void loadTensor(const onnx::TensorProto &in, Tensor *T) {
   std::vector<size_t> dim;
   for (auto d : in.dims()) {
@@ -126,18 +130,18 @@ static void loadTensor(const onnx::TensorProto &in, Tensor *T) {
   }
 
   if (in.data_type() == onnx::TensorProto::FLOAT) {
-    T->reset(ElemKind::FloatTy, dim);
-
     if (in.float_data_size() > 0) {
+      T->reset(ElemKind::FloatTy, dim);
       auto TH = T->getHandle<>();
       size_t i = 0;
       for (auto f : in.float_data()) {
         TH.raw(i++) = f;
       }
     } else if (in.has_raw_data()) {
-      std::istringstream inStream(in.raw_data(), std::stringstream::binary);
-      inStream.read((char *)T->getRawDataPointer<float>(),
-                    T->size() * sizeof(float));
+      Type ty(ElemKind::FloatTy, dim);
+      assert(in.raw_data().size() == ty.getSizeInBytes() &&
+             "The size of the raw data does not match the tensor shape.");
+      *T = Tensor((void *)in.raw_data().data(), &ty);
     } else {
       assert(false && "Unsupported Tensor format.");
     }
@@ -267,10 +271,10 @@ bool ONNXModelLoader::loadOperator(const onnx::NodeProto &op) {
     auto *bias = G_.getParent()->createVariable("conv.bias", biasTensor);
 
     // ONNX passes the input as NCHW, and we expect the input to be NHWC.
-    auto *tr = G_.createTranspose(opName, in, NCHW2NHWC);
+    NodeValue tr = createTransposeOrFold(opName, in, NCHW2NHWC);
 
     // Calculate the size and allocate the output buffer.
-    ShapeNHWC idim = ShapeNHWC(tr->getResult().dims());
+    ShapeNHWC idim = ShapeNHWC(tr.dims());
     auto outSz =
         calculateConvPoolOutputDims(idim.h, idim.w, kernel, stride, pads);
     std::array<size_t, 4> outDims = {
@@ -295,7 +299,7 @@ bool ONNXModelLoader::loadOperator(const onnx::NodeProto &op) {
 
     std::vector<size_t> pads = getPads(dict);
 
-    auto *tr = G_.createTranspose(opName, in, NCHW2NHWC);
+    NodeValue tr = createTransposeOrFold(opName, in, NCHW2NHWC);
 
     // If 'global_pooling' is set then the operation will pool over the size of
     // the input by doing: kernel = height/width.
@@ -326,7 +330,7 @@ bool ONNXModelLoader::loadOperator(const onnx::NodeProto &op) {
 
     size_t kernel = in->dims(0)[2];
     std::vector<size_t> pads = getPads(dict);
-    auto *tr = G_.createTranspose(opName, in, NCHW2NHWC);
+    NodeValue tr = createTransposeOrFold(opName, in, NCHW2NHWC);
     Node *node = G_.createPoolAvg(opName, tr, kernel, stride, pads);
     auto *N = G_.createTranspose(opName, node, NHWC2NCHW);
     addNodeAsOutput(op, N);
@@ -450,21 +454,43 @@ static void loadShape(const onnx::TypeProto &in, Tensor *T) {
 /// Loads tensor \p T from the input \p in.
 void ONNXModelLoader::loadInputs(onnx::GraphProto &net) {
   for (const auto &in : net.input()) {
-    Tensor *T = new Tensor();
-    loadShape(in.type(), T);
-    tensors_[in.name()] = T;
+    // Weights that were registered ahead of time also appear in the input
+    // list; they keep their payloads.
+    if (tensors_.count(in.name())) {
+      continue;
+    }
+    // The remaining inputs are fed at run time, so they become public
+    // variables: the optimizer must not treat them as constants, and the
+    // caller binds fresh values into them before every run.
+    Tensor T;
+    loadShape(in.type(), &T);
+    createAndRememberVariable(in.name(), T, VisibilityKind::Public,
+                              Variable::TrainKind::None);
   }
 }
 
 void ONNXModelLoader::loadInitializers(onnx::GraphProto &net) {
-  // Load the network initializaers:
+  // Only remember where each initializer lives. The payloads are decoded one
+  // at a time when an operator first consumes them, so initializers that the
+  // network never references are never materialized, and the transient
+  // memory of a load is bounded by the largest single tensor instead of by
+  // the whole model.
   for (const auto &in : net.initializer()) {
-    Tensor *T = new Tensor();
-    loadTensor(in, T);
-    tensors_[in.name()] = T;
+    pendingInitializers_[in.name()] = &in;
   }
 }
 
+Tensor *ONNXModelLoader::getTensorByName(llvm::StringRef name) {
+  auto it = pendingInitializers_.find(name);
+  if (it != pendingInitializers_.end()) {
+    auto *T = new Tensor();
+    loadTensor(*it->second, T);
+    tensors_[it->first] = T;
+    pendingInitializers_.erase(it);
+  }
+  return ProtobufLoader::getTensorByName(name);
+}
+
 void ONNXModelLoader::setOutputNodes(onnx::GraphProto &net) {
   assert(net.output_size() && "Network needs external outputs defined.");
 
@@ -488,9 +514,10 @@ bool ONNXModelLoader::loadNetwork(onnx::GraphProto &net) {
   return true;
 }
 
-std::unique_ptr<ONNXModelLoader> ONNXModelLoader::parse(const void *onnxModel,
-                                                        size_t onnxModelSize,
-                                                        Function &F) {
+std::unique_ptr<ONNXModelLoader>
+ONNXModelLoader::parse(const void *onnxModel, size_t onnxModelSize,
+                       Function &F, llvm::ArrayRef<const char *> weightNames,
+                       llvm::ArrayRef<Tensor *> weightTensors) {
   std::unique_ptr<ONNXModelLoader> onnxLoader(new ONNXModelLoader(F));
 
   onnx::GraphProto modelDef;
@@ -498,6 +525,15 @@ std::unique_ptr<ONNXModelLoader> ONNXModelLoader::parse(const void *onnxModel,
     return nullptr;
   }
 
+  // Register the provided weights. The payloads are moved into the loader
+  // and consumed as private variables when the network references them.
+  assert(weightNames.size() == weightTensors.size() &&
+         "Invalid initialization list");
+  for (size_t i = 0, e = weightNames.size(); i < e; i++) {
+    onnxLoader->tensors_[weightNames[i]] =
+        new Tensor(std::move(*weightTensors[i]));
+  }
+
   onnxLoader->loadInputs(modelDef);
   if (!onnxLoader->loadNetwork(modelDef)) {
     return nullptr;
@@ -523,4 +559,7 @@ ONNXModelLoader::ONNXModelLoader(const std::string &modelDescFilename,
   if (loadNetwork(modelDef)) {
     setOutputNodes(modelDef);
   }
+  // The registered protos point into \ref modelDef, which dies with this
+  // constructor; drop whatever the network did not consume.
+  pendingInitializers_.clear();
 }
@@ -16,8 +16,10 @@
 
 #include "glow/Importer/ProtobufLoader.h"
 
+#include <atomic>
 #include <cassert>
 #include <string>
+#include <thread>
 
 namespace glow {
 
@@ -28,6 +30,35 @@ bool isArrayConstant(llvm::ArrayRef<size_t> a) {
   return true;
 }
 
+void parallelForIndices(size_t n, const std::function<void(size_t)> &fn) {
+  size_t numThreads = std::thread::hardware_concurrency();
+  numThreads = std::max<size_t>(1, std::min(numThreads, n));
+  if (numThreads == 1) {
+    for (size_t i = 0; i < n; i++) {
+      fn(i);
+    }
+    return;
+  }
+
+  // The indices are handed out through a shared counter instead of being
+  // pre-partitioned, because the cost per index varies wildly between tiny
+  // bias vectors and full weight matrices.
+  std::atomic<size_t> next{0};
+  auto worker = [&]() {
+    for (size_t i = next++; i < n; i = next++) {
+      fn(i);
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (size_t t = 0; t < numThreads; t++) {
+    workers.emplace_back(worker);
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+}
+
 Tensor *ProtobufLoader::getTensorByName(llvm::StringRef name) {
   assert(tensors_.count(name) &&
          "There is no tensor registered with this name.");
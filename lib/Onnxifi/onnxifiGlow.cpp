@@ -15,6 +15,24 @@
  */
 #include "onnx/onnxifi.h"
 
+#include "glow/Backends/Backend.h"
+#include "glow/ExecutionEngine/ExecutionEngine.h"
+#include "glow/Graph/Graph.h"
+#include "glow/Graph/Nodes.h"
+#include "glow/Importer/ONNX.h"
+#include "glow/Optimizer/Optimizer.h"
+
+#include "llvm/ADT/Hashing.h"
+#include "llvm/Support/Casting.h"
+
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
 /**
  * This file contains implementation of the onnxifi interface.
  * Documentation on the functions implementing onnxifi interface in
@@ -23,25 +41,409 @@
  * implemented: https://github.com/onnx/onnx/blob/master/onnx/onnxifi.h.
  */
 
+namespace {
+
+using namespace glow;
+
+/// A single-shot synchronization event backing an onnxEvent.
+class EventImpl {
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  bool signalled_{false};
+
+public:
+  void signal() {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      signalled_ = true;
+    }
+    cond_.notify_all();
+  }
+
+  void wait() {
+    std::unique_lock<std::mutex> guard(mutex_);
+    cond_.wait(guard, [this] { return signalled_; });
+  }
+};
+
+/// An initialized backend. Each shared graph owns its own ExecutionEngine,
+/// because an engine serves one compiled function; the backend only
+/// remembers which kind of engine its graphs create.
+struct BackendImpl {
+  BackendKind kind;
+};
+
+/// \returns the backend kinds that are compiled into this library, in the
+/// order that onnxGetBackendIDs reports them: the fastest one first.
+static std::vector<BackendKind> availableBackendKinds() {
+  std::vector<BackendKind> kinds;
+  for (BackendKind kind :
+       {BackendKind::CPU, BackendKind::OpenCL, BackendKind::Interpreter}) {
+    if (isBackendAvailable(kind)) {
+      kinds.push_back(kind);
+    }
+  }
+  return kinds;
+}
+
+/// \returns the size in bytes of one element of the ONNXIFI data type
+/// \p dataType, or 0 when the data type is not supported.
+static size_t onnxifiElementSize(onnxEnum dataType) {
+  switch (dataType) {
+  case ONNXIFI_DATATYPE_FLOAT32:
+    return 4;
+  case ONNXIFI_DATATYPE_INT64:
+    return 8;
+  default:
+    return 0;
+  }
+}
+
+/// A loaded and compiled model, shared by every onnxGraph handle that was
+/// initialized with the same serialized graph, weights and backend kind.
+/// Frameworks create one handle per worker thread for the same model;
+/// sharing keeps one copy of the weights and one compiled function instead
+/// of replicating a multi-hundred-megabyte model per handle.
+class SharedGraph {
+  ExecutionEngine engine_;
+  /// The glow function built from the ONNX model.
+  Function *F_;
+  /// Keeps the name-to-node mapping of the model alive for I/O binding.
+  std::unique_ptr<ONNXModelLoader> loader_;
+  /// Set once the first handle's onnxSetGraphIO call has compiled the
+  /// function.
+  bool compiled_{false};
+  /// The output variables fixed at compile time, under their model output
+  /// names. Every handle must bind exactly this set of outputs.
+  std::vector<std::pair<std::string, Variable *>> outputs_;
+  /// Serializes compilation, and the runs of handles that execute against
+  /// the shared variable payloads because the backend has no execution
+  /// contexts.
+  std::mutex mutex_;
+
+  friend class GraphHandle;
+
+public:
+  explicit SharedGraph(BackendKind kind) : engine_(kind) {
+    F_ = engine_.getModule().createFunction("onnxifi");
+  }
+
+  /// Parses \p onnxModel and registers the weights in \p weightDescriptors.
+  onnxStatus init(const void *onnxModel, size_t onnxModelSize,
+                  uint32_t weightCount,
+                  const onnxTensorDescriptor *weightDescriptors);
+};
+
+/// One onnxGraph handle over a SharedGraph: the per-handle I/O bindings and
+/// execution context. Handles of the same model run concurrently, each in
+/// its own context, against the one compiled function.
+class GraphHandle {
+  std::shared_ptr<SharedGraph> shared_;
+  /// This handle's private execution context, when the backend supports
+  /// contexts; otherwise the handle runs against the shared payloads under
+  /// the shared mutex.
+  std::unique_ptr<ExecutionContext> ctx_;
+
+  /// The input variables, and unowned tensors over the caller buffers that
+  /// feed them.
+  std::vector<Variable *> inputVars_;
+  std::vector<std::unique_ptr<Tensor>> inputTensors_;
+  std::vector<Tensor *> inputTensorPtrs_;
+  /// The output variables and the caller buffers that receive them.
+  std::vector<std::pair<Variable *, void *>> outputs_;
+
+  /// Serializes the runs of this handle; also protects the I/O bindings.
+  std::mutex runMutex_;
+  /// Tracks the runs that are still in flight, so release can drain them.
+  std::mutex pendingMutex_;
+  std::condition_variable pendingCond_;
+  unsigned pendingRuns_{0};
+
+public:
+  explicit GraphHandle(std::shared_ptr<SharedGraph> shared)
+      : shared_(std::move(shared)) {}
+
+  /// Binds the caller buffers to the graph inputs and outputs. The first
+  /// call over the underlying shared graph fixes its outputs and compiles
+  /// the function.
+  onnxStatus setIO(uint32_t inputsCount,
+                   const onnxTensorDescriptor *inputDescriptors,
+                   uint32_t outputsCount,
+                   const onnxTensorDescriptor *outputDescriptors);
+
+  /// Queues one asynchronous run: waits for \p inputEvent (when present),
+  /// executes the compiled function over the bound buffers and signals
+  /// \p outputEvent. The runs of one handle execute in turn; handles with
+  /// execution contexts run concurrently with the other handles of the
+  /// same model.
+  onnxStatus run(EventImpl *inputEvent, EventImpl *outputEvent);
+
+  /// Blocks until every queued run has completed.
+  void drain() {
+    std::unique_lock<std::mutex> guard(pendingMutex_);
+    pendingCond_.wait(guard, [this] { return pendingRuns_ == 0; });
+  }
+};
+
+/// The live shared graphs, keyed by the hash of their backend kind, model
+/// bytes and weights. The entries are weak, so a shared graph lives exactly
+/// as long as its handles; a stale entry is replaced on the next miss.
+std::mutex registryMutex;
+std::unordered_map<size_t, std::weak_ptr<SharedGraph>> sharedGraphs;
+
+/// \returns a hash over everything that determines a compiled graph: the
+/// backend kind \p kind, the serialized model \p onnxModel and the names,
+/// shapes and payloads of the weights in \p weightDescriptors.
+static size_t
+hashGraphDescriptor(BackendKind kind, const void *onnxModel,
+                    size_t onnxModelSize, uint32_t weightCount,
+                    const onnxTensorDescriptor *weightDescriptors) {
+  auto hash = llvm::hash_combine(
+      (unsigned)kind,
+      llvm::hash_value(
+          llvm::StringRef((const char *)onnxModel, onnxModelSize)));
+  for (uint32_t i = 0; i < weightCount; i++) {
+    const onnxTensorDescriptor &descriptor = weightDescriptors[i];
+    size_t size = onnxifiElementSize(descriptor.dataType);
+    hash = llvm::hash_combine(
+        hash,
+        llvm::hash_value(
+            llvm::StringRef(descriptor.name ? descriptor.name : "")),
+        descriptor.dataType);
+    for (uint32_t d = 0; d < descriptor.dimensions; d++) {
+      size *= descriptor.shape[d];
+      hash = llvm::hash_combine(hash, descriptor.shape[d]);
+    }
+    if (size && descriptor.buffer) {
+      hash = llvm::hash_combine(
+          hash, llvm::hash_value(llvm::StringRef(
+                    (const char *)(uintptr_t)descriptor.buffer, size)));
+    }
+  }
+  return hash;
+}
+
+/// Builds the tensor described by \p descriptor in \p T, copying the payload
+/// out of the caller buffer. \returns false if the data type is not
+/// supported.
+static bool loadTensorDescriptor(Tensor &T,
+                                 const onnxTensorDescriptor &descriptor) {
+  std::vector<size_t> dims;
+  for (uint32_t i = 0; i < descriptor.dimensions; i++) {
+    dims.push_back(descriptor.shape[i]);
+  }
+
+  switch (descriptor.dataType) {
+  case ONNXIFI_DATATYPE_FLOAT32:
+    T.reset(ElemKind::FloatTy, dims);
+    break;
+  case ONNXIFI_DATATYPE_INT64:
+    // Glow represents index data as size_t, which is also 8 bytes wide.
+    T.reset(ElemKind::IndexTy, dims);
+    break;
+  default:
+    return false;
+  }
+
+  memcpy(T.getUnsafePtr(), (const void *)(uintptr_t)descriptor.buffer,
+         T.getSizeInBytes());
+  return true;
+}
+
+onnxStatus SharedGraph::init(const void *onnxModel, size_t onnxModelSize,
+                             uint32_t weightCount,
+                             const onnxTensorDescriptor *weightDescriptors) {
+  // Decode the weights out of the caller buffers, which are only valid for
+  // the duration of this call.
+  std::vector<const char *> weightNames;
+  std::vector<Tensor> weights(weightCount);
+  std::vector<Tensor *> weightPtrs;
+  for (uint32_t i = 0; i < weightCount; i++) {
+    const onnxTensorDescriptor &descriptor = weightDescriptors[i];
+    if (!descriptor.name || !descriptor.buffer) {
+      return ONNXIFI_STATUS_INVALID_POINTER;
+    }
+    if (descriptor.memoryType != ONNXIFI_MEMORY_TYPE_CPU) {
+      return ONNXIFI_STATUS_INVALID_MEMORY_TYPE;
+    }
+    if (!loadTensorDescriptor(weights[i], descriptor)) {
+      return ONNXIFI_STATUS_UNSUPPORTED_DATATYPE;
+    }
+    weightNames.push_back(descriptor.name);
+    weightPtrs.push_back(&weights[i]);
+  }
+
+  loader_ = ONNXModelLoader::parse(onnxModel, onnxModelSize, *F_, weightNames,
+                                   weightPtrs);
+  if (!loader_) {
+    return ONNXIFI_STATUS_UNSUPPORTED_OPERATOR;
+  }
+  return ONNXIFI_STATUS_SUCCESS;
+}
+
+onnxStatus GraphHandle::setIO(uint32_t inputsCount,
+                              const onnxTensorDescriptor *inputDescriptors,
+                              uint32_t outputsCount,
+                              const onnxTensorDescriptor *outputDescriptors) {
+  std::lock_guard<std::mutex> ioGuard(runMutex_);
+  std::lock_guard<std::mutex> guard(shared_->mutex_);
+
+  // The outputs have to be saved before the function is compiled, so the
+  // first binding over the shared graph fixes its set of outputs; every
+  // binding after that, from this handle or another one, only resolves
+  // against it.
+  if (!shared_->compiled_) {
+    for (uint32_t i = 0; i < outputsCount; i++) {
+      const char *name = outputDescriptors[i].name;
+      if (!name || !shared_->loader_->hasNodeByName(name)) {
+        return ONNXIFI_STATUS_INVALID_NAME;
+      }
+      auto *save = shared_->F_->createSave(
+          std::string("save_") + name, shared_->loader_->getNodeByName(name));
+      shared_->outputs_.emplace_back(name, save->getVariable());
+    }
+    shared_->engine_.compile(CompilationMode::Infer, shared_->F_);
+    shared_->compiled_ = true;
+  } else if (outputsCount != shared_->outputs_.size()) {
+    return ONNXIFI_STATUS_INVALID_NAME;
+  }
+
+  outputs_.clear();
+  for (uint32_t i = 0; i < outputsCount; i++) {
+    const onnxTensorDescriptor &descriptor = outputDescriptors[i];
+    if (descriptor.memoryType != ONNXIFI_MEMORY_TYPE_CPU) {
+      return ONNXIFI_STATUS_INVALID_MEMORY_TYPE;
+    }
+    Variable *V = nullptr;
+    for (auto &output : shared_->outputs_) {
+      if (descriptor.name && output.first == descriptor.name) {
+        V = output.second;
+        break;
+      }
+    }
+    if (!V) {
+      return ONNXIFI_STATUS_INVALID_NAME;
+    }
+    outputs_.emplace_back(V, (void *)(uintptr_t)descriptor.buffer);
+  }
+
+  inputVars_.clear();
+  inputTensors_.clear();
+  inputTensorPtrs_.clear();
+  for (uint32_t i = 0; i < inputsCount; i++) {
+    const onnxTensorDescriptor &descriptor = inputDescriptors[i];
+    if (descriptor.memoryType != ONNXIFI_MEMORY_TYPE_CPU) {
+      return ONNXIFI_STATUS_INVALID_MEMORY_TYPE;
+    }
+    if (!descriptor.name ||
+        !shared_->loader_->hasNodeByName(descriptor.name)) {
+      return ONNXIFI_STATUS_INVALID_NAME;
+    }
+    auto *V = llvm::dyn_cast<Variable>(
+        shared_->loader_->getNodeByName(descriptor.name));
+    if (!V) {
+      return ONNXIFI_STATUS_INVALID_NAME;
+    }
+
+    // The input tensor aliases the caller buffer; the values are copied into
+    // the execution state when a run executes.
+    inputVars_.push_back(V);
+    inputTensors_.emplace_back(
+        new Tensor((void *)(uintptr_t)descriptor.buffer, V->getType()));
+    inputTensorPtrs_.push_back(inputTensors_.back().get());
+  }
+
+  // Give this handle a private execution context when the backend supports
+  // them, so the handles of a shared model run concurrently.
+  if (!ctx_ && shared_->engine_.supportsContexts()) {
+    ctx_ = shared_->engine_.createContext();
+  }
+
+  return ONNXIFI_STATUS_SUCCESS;
+}
+
+onnxStatus GraphHandle::run(EventImpl *inputEvent, EventImpl *outputEvent) {
+  if (!shared_->compiled_) {
+    return ONNXIFI_STATUS_INVALID_GRAPH;
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(pendingMutex_);
+    pendingRuns_++;
+  }
+
+  std::thread([this, inputEvent, outputEvent] {
+    if (inputEvent) {
+      inputEvent->wait();
+    }
+
+    {
+      // The runs of a handle execute one at a time; queued runs pipeline
+      // behind the one in flight.
+      std::lock_guard<std::mutex> guard(runMutex_);
+      if (ctx_) {
+        shared_->engine_.runWithContext(ctx_.get(), inputVars_,
+                                        inputTensorPtrs_);
+        for (auto &output : outputs_) {
+          Tensor result = ctx_->getTensor(output.first);
+          memcpy(output.second, result.getUnsafePtr(),
+                 result.getSizeInBytes());
+        }
+      } else {
+        // No execution contexts on this backend: the handles of the shared
+        // model take turns over the shared variable payloads.
+        std::lock_guard<std::mutex> sharedGuard(shared_->mutex_);
+        shared_->engine_.run(inputVars_, inputTensorPtrs_);
+        for (auto &output : outputs_) {
+          Tensor &payload = output.first->getPayload();
+          memcpy(output.second, payload.getUnsafePtr(),
+                 payload.getSizeInBytes());
+        }
+      }
+    }
+
+    outputEvent->signal();
+    {
+      std::lock_guard<std::mutex> guard(pendingMutex_);
+      pendingRuns_--;
+      // Notify while still holding the mutex: once the count hits zero,
+      // drain() may return and the handle may be deleted, so a notify
+      // after unlocking could touch a destroyed condition variable when
+      // another worker's notify (or a spurious wakeup) wakes drain()
+      // first.
+      pendingCond_.notify_all();
+    }
+  }).detach();
+
+  return ONNXIFI_STATUS_SUCCESS;
+}
+
+} // namespace
+
 /// Return stable IDs of available backends on the system.
 /// \param backendIDs output parameter and represents pointer to the memory
 ///                   where the backend IDs will be returned. If it's NULL, numBackends
 ///                   will be populated with the number of backends supported.
 /// \param numBackends input/output parameter.
 ///                    As an input, it specifies the capacity allocated in the backendIDs.
-///                    As an output, it specifies the number of actual available backends. 
+///                    As an output, it specifies the number of actual available backends.
 ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI
 onnxGetBackendIDs(onnxBackendID* backendIDs, size_t* numBackends) {
   if (!numBackends) {
     return ONNXIFI_STATUS_INVALID_POINTER;
   }
-  if (!backendIDs) {
-    *numBackends = 1;
+
+  auto kinds = availableBackendKinds();
+  if (!backendIDs || *numBackends < kinds.size()) {
+    *numBackends = kinds.size();
     return ONNXIFI_STATUS_FALLBACK;
   }
 
-  *numBackends = 1;
-  *backendIDs = 0;
+  *numBackends = kinds.size();
+  for (size_t i = 0; i < kinds.size(); i++) {
+    // The ID encodes the backend kind directly; there is no per-ID state.
+    backendIDs[i] = (onnxBackendID)(uintptr_t)kinds[i];
+  }
   return ONNXIFI_STATUS_SUCCESS;
 }
 
@@ -50,6 +452,7 @@ onnxGetBackendIDs(onnxBackendID* backendIDs, size_t* numBackends) {
 /// (onnxBackend, onnxGraph, onnxEvent) before calling this function.
 ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI
 onnxReleaseBackendID(onnxBackendID backendID) {
+  // Backend IDs carry no state.
   return ONNXIFI_STATUS_SUCCESS;
 }
 
@@ -92,12 +495,22 @@ ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI onnxInitBackend(
     return ONNXIFI_STATUS_INVALID_POINTER;
   }
 
+  auto kind = (BackendKind)(uintptr_t)backendID;
+  if (!isBackendAvailable(kind)) {
+    return ONNXIFI_STATUS_INVALID_ID;
+  }
+
+  *backend = new BackendImpl{kind};
   return ONNXIFI_STATUS_SUCCESS;
 }
 
 /// Deinitialize an ONNXIFI backend and release associated resources.
 ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI
 onnxReleaseBackend(onnxBackend backend) {
+  if (!backend) {
+    return ONNXIFI_STATUS_INVALID_BACKEND;
+  }
+  delete static_cast<BackendImpl *>(backend);
   return ONNXIFI_STATUS_SUCCESS;
 }
 
@@ -108,24 +521,37 @@ onnxInitEvent(onnxBackend backend, onnxEvent* event) {
     return ONNXIFI_STATUS_INVALID_POINTER;
   }
 
+  *event = new EventImpl();
   return ONNXIFI_STATUS_SUCCESS;
 }
 
 /// Change the state of the ONNXIFI event \p event to signalled.
 ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI
 onnxSignalEvent(onnxEvent event) {
+  if (!event) {
+    return ONNXIFI_STATUS_INVALID_EVENT;
+  }
+  static_cast<EventImpl *>(event)->signal();
   return ONNXIFI_STATUS_SUCCESS;
 }
 
 /// Wait until an ONNXIFI event is signalled.
 ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI
 onnxWaitEvent(onnxEvent event) {
+  if (!event) {
+    return ONNXIFI_STATUS_INVALID_EVENT;
+  }
+  static_cast<EventImpl *>(event)->wait();
   return ONNXIFI_STATUS_SUCCESS;
 }
 
 /// Deinitialize an ONNXIFI event and release associated resources.
 ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI
 onnxReleaseEvent(onnxEvent event) {
+  if (!event) {
+    return ONNXIFI_STATUS_INVALID_EVENT;
+  }
+  delete static_cast<EventImpl *>(event);
   return ONNXIFI_STATUS_SUCCESS;
 }
 
@@ -137,13 +563,41 @@ ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI onnxInitGraph(
     uint32_t weightCount,
     const onnxTensorDescriptor* weightDescriptors,
     onnxGraph* graph) {
-  if (!onnxModel || !weightDescriptors || !graph) {
+  if (!onnxModel || !graph || (weightCount && !weightDescriptors)) {
     return ONNXIFI_STATUS_INVALID_POINTER;
   }
   if (!onnxModelSize) {
     return ONNXIFI_STATUS_INVALID_SIZE;
   }
-  
+  if (!backend) {
+    return ONNXIFI_STATUS_INVALID_BACKEND;
+  }
+
+  auto kind = static_cast<BackendImpl *>(backend)->kind;
+
+  // A handle over an already loaded model shares its weights and its
+  // compiled function instead of loading a second copy.
+  size_t hash = hashGraphDescriptor(kind, onnxModel, onnxModelSize,
+                                    weightCount, weightDescriptors);
+  std::shared_ptr<SharedGraph> shared;
+  {
+    std::lock_guard<std::mutex> guard(registryMutex);
+    auto it = sharedGraphs.find(hash);
+    if (it != sharedGraphs.end()) {
+      shared = it->second.lock();
+    }
+    if (!shared) {
+      shared = std::make_shared<SharedGraph>(kind);
+      onnxStatus status = shared->init(onnxModel, onnxModelSize, weightCount,
+                                       weightDescriptors);
+      if (status != ONNXIFI_STATUS_SUCCESS) {
+        return status;
+      }
+      sharedGraphs[hash] = shared;
+    }
+  }
+
+  *graph = new GraphHandle(std::move(shared));
   return ONNXIFI_STATUS_SUCCESS;
 }
 
@@ -154,11 +608,18 @@ ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI onnxSetGraphIO(
     const onnxTensorDescriptor* inputDescriptors,
     uint32_t outputsCount,
     const onnxTensorDescriptor* outputDescriptors) {
-  if (!inputDescriptors || !outputDescriptors) {
+  if ((inputsCount && !inputDescriptors) ||
+      (outputsCount && !outputDescriptors)) {
     return ONNXIFI_STATUS_INVALID_POINTER;
   }
+  if (!graph) {
+    return ONNXIFI_STATUS_INVALID_GRAPH;
+  }
 
-  return ONNXIFI_STATUS_SUCCESS;
+  return static_cast<GraphHandle *>(graph)->setIO(inputsCount,
+                                                  inputDescriptors,
+                                                  outputsCount,
+                                                  outputDescriptors);
 }
 
 /// Asynchronously execute operations in an ONNXIFI graph using pre-specified
@@ -170,13 +631,38 @@ ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI onnxRunGraph(
   if (!inputFence || !outputFence) {
     return ONNXIFI_STATUS_INVALID_POINTER;
   }
+  if (!graph) {
+    return ONNXIFI_STATUS_INVALID_GRAPH;
+  }
+  if (inputFence->type != ONNXIFI_SYNCHRONIZATION_EVENT ||
+      outputFence->type != ONNXIFI_SYNCHRONIZATION_EVENT) {
+    return ONNXIFI_STATUS_INVALID_FENCE_TYPE;
+  }
 
-  return ONNXIFI_STATUS_SUCCESS;
+  // The output event is created here and handed to the caller, who waits on
+  // it and releases it once the results have been consumed.
+  auto *outputEvent = new EventImpl();
+  outputFence->event = outputEvent;
+
+  onnxStatus status = static_cast<GraphHandle *>(graph)->run(
+      static_cast<EventImpl *>(inputFence->event), outputEvent);
+  if (status != ONNXIFI_STATUS_SUCCESS) {
+    delete outputEvent;
+    outputFence->event = nullptr;
+  }
+  return status;
 }
 
 /// Deinitialize an ONNXIFI graph and release associated resources.
 /// It blocks until all in-flight inference operations complete.
 ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI
 onnxReleaseGraph(onnxGraph graph) {
+  if (!graph) {
+    return ONNXIFI_STATUS_INVALID_GRAPH;
+  }
+
+  auto *handle = static_cast<GraphHandle *>(graph);
+  handle->drain();
+  delete handle;
   return ONNXIFI_STATUS_SUCCESS;
 }
@@ -13,16 +13,25 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#define DEBUG_TYPE "graph-optimizer"
 
+#include "glow/Backends/Backend.h"
+#include "glow/Backends/CompiledFunction.h"
 #include "glow/Graph/Graph.h"
 #include "glow/Graph/Node.h"
 #include "glow/Graph/Nodes.h"
 #include "glow/Optimizer/Optimizer.h"
 #include "glow/Quantization/Base/Base.h"
+#include "glow/IR/IR.h"
+#include "glow/Support/PassStats.h"
+#include "glow/Support/Statistic.h"
 
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/CommandLine.h"
 
+#include <map>
+#include <memory>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -31,13 +40,17 @@ llvm::cl::opt<unsigned> constVarDedupSizeOpt(
     "const_var_dedup_size",
     llvm::cl::desc(
         "Max number of elements allowed for deduplicating constant variables"),
-    llvm::cl::Optional, llvm::cl::init(256), llvm::cl::cat(graphOptCat));
+    llvm::cl::Optional, llvm::cl::init(1 << 20), llvm::cl::cat(graphOptCat));
 
 using namespace glow;
 using llvm::cast;
 using llvm::dyn_cast;
 using llvm::isa;
 
+GLOW_STATISTIC(numDCEErased, "Number of dead nodes and variables erased");
+GLOW_STATISTIC(numCSEReplaced,
+               "Number of nodes replaced by an equivalent node");
+
 static bool shouldDeleteNode(Node *N) {
   // In general, nodes who have side effects are retained.
   if (N->hasSideEffects()) {
@@ -64,47 +77,51 @@ static void DCE(Function *F) {
   auto &nodes = F->getNodes();
   auto &vars = F->getParent()->getVars();
 
-  std::vector<VariablesList::iterator> erasedVars{};
-  std::vector<NodesList::iterator> erasedNodes{};
-
-  // Remove unused nodes. Do not remove unused vars because they are the
-  // interface to the user program.
-  bool changedLocally = true;
-  do {
-    changedLocally = false;
-    for (auto it = nodes.begin(), e = nodes.end(); it != e;) {
-      if (!shouldDeleteNode(&*it)) {
-        ++it;
-        continue;
-      }
-
-      erasedNodes.push_back(it);
-      ++it;
-      changedLocally = true;
+  // Seed the worklist with every node and variable that is dead right now.
+  // When a node is erased its inputs lose a user and may become dead in
+  // turn, so only those producers are revisited, which keeps the cleanup
+  // linear in the size of the graph.
+  std::vector<Node *> worklist;
+  std::unordered_set<Node *> inWorklist;
+  auto enqueue = [&](Node *N) {
+    if (shouldDeleteNode(N) && inWorklist.insert(N).second) {
+      worklist.push_back(N);
     }
+  };
+  for (auto &N : nodes) {
+    enqueue(&N);
+  }
+  for (auto *V : vars) {
+    enqueue(V);
+  }
 
-    while (!erasedNodes.empty()) {
-      auto it = erasedNodes.back();
-      F->eraseNode(it);
-      erasedNodes.pop_back();
+  while (!worklist.empty()) {
+    Node *N = worklist.back();
+    worklist.pop_back();
+    inWorklist.erase(N);
+    if (!shouldDeleteNode(N)) {
+      continue;
     }
 
-  } while (changedLocally);
+    // Remember the inputs; erasing the node drops their use counts.
+    llvm::SmallVector<Node *, 6> inputs;
+    for (unsigned i = 0, e = N->getNumInputs(); i < e; i++) {
+      inputs.push_back(N->getNthInput(i).getNode());
+    }
+    if (N->hasPredicate()) {
+      inputs.push_back(N->getPredicate().getNode());
+    }
 
-  // Delete unused variables.
-  for (auto it = vars.begin(), e = vars.end(); it != e;) {
-    if (!shouldDeleteNode(*it)) {
-      ++it;
-      continue;
+    ++numDCEErased;
+    if (auto *V = dyn_cast<Variable>(N)) {
+      F->getParent()->eraseVariable(V);
+    } else {
+      F->eraseNode(N);
     }
-    erasedVars.push_back(it);
-    ++it;
-  }
 
-  while (!erasedVars.empty()) {
-    auto it = erasedVars.back();
-    F->getParent()->eraseVariable(it);
-    erasedVars.pop_back();
+    for (Node *in : inputs) {
+      enqueue(in);
+    }
   }
 }
 
@@ -1148,6 +1165,118 @@ static void optimizeArithmeticNodes(Function *F) {
 }
 
 /// Statically transpose private variables.
+/// Assign a single layout to regions of layout-agnostic nodes.
+///
+/// Local transformations insert Transpose nodes around individual layers, so
+/// consecutive layers often flip the same tensor back and forth between
+/// layouts. This pass grows a region upwards from every transpose through
+/// single-use elementwise nodes whose semantics do not depend on the tensor
+/// layout - unary activations and arithmetic against a splat - and when the
+/// region is bounded by an inverse transpose, re-expresses the whole region
+/// in the original layout. Both boundary transposes then become dead, so
+/// conversions remain only where a region genuinely changes layout.
+static void optimizeLayoutRegions(Function *F) {
+  auto &nodes = F->getNodes();
+  for (auto &node : nodes) {
+    auto *T2 = dyn_cast<TransposeNode>(&node);
+    if (!T2) {
+      continue;
+    }
+
+    // Walk up through the layout-agnostic region that feeds this transpose.
+    llvm::SmallVector<Node *, 8> region;
+    NodeValue cur = T2->getInput();
+    TransposeNode *T1 = nullptr;
+    while (true) {
+      Node *N = cur.getNode();
+      if (auto *T = dyn_cast<TransposeNode>(N)) {
+        T1 = T;
+        break;
+      }
+      unsigned mainIdx = 0;
+      if (isa<ReluNode>(N) || isa<SigmoidNode>(N) || isa<TanhNode>(N)) {
+        mainIdx = 0;
+      } else if (isa<AddNode>(N) || isa<MulNode>(N) || isa<SubNode>(N) ||
+                 isa<DivNode>(N) || isa<MaxNode>(N) || isa<MinNode>(N)) {
+        // Exactly one of the operands must be a splat, which can be
+        // recreated in any layout.
+        bool lhsSplat = isa<SplatNode>(N->getNthInput(0).getNode());
+        bool rhsSplat = isa<SplatNode>(N->getNthInput(1).getNode());
+        if (lhsSplat == rhsSplat) {
+          break;
+        }
+        mainIdx = lhsSplat ? 1 : 0;
+      } else {
+        break;
+      }
+      // The rewrite removes the node, so its result must not be observable
+      // elsewhere.
+      if (N->getNumUsers() != 1) {
+        break;
+      }
+      region.push_back(N);
+      cur = N->getNthInput(mainIdx);
+    }
+    // An empty region means two adjacent transposes, which optimizeTranspose
+    // already folds.
+    if (!T1 || region.empty() ||
+        !isIdentityShuffle(T1->getShuffle(), T2->getShuffle())) {
+      continue;
+    }
+
+    // Re-create the region in the layout of T1's input.
+    NodeValue v = T1->getInput();
+    for (auto it = region.rbegin(), e = region.rend(); it != e; ++it) {
+      Node *N = *it;
+      switch (N->getKind()) {
+      case Kinded::Kind::ReluNodeKind:
+        v = F->createRELU(N->getName(), v);
+        break;
+      case Kinded::Kind::SigmoidNodeKind:
+        v = F->createSigmoid(N->getName(), v);
+        break;
+      case Kinded::Kind::TanhNodeKind:
+        v = F->createTanh(N->getName(), v);
+        break;
+      default: {
+        NodeValue lhs = N->getNthInput(0);
+        NodeValue rhs = N->getNthInput(1);
+        bool lhsSplat = isa<SplatNode>(lhs.getNode());
+        auto *splat = cast<SplatNode>((lhsSplat ? lhs : rhs).getNode());
+        NodeValue newSplat =
+            F->createSplat(splat->getName(), v.getType(), splat->getValue());
+        NodeValue newLhs = lhsSplat ? newSplat : v;
+        NodeValue newRhs = lhsSplat ? v : newSplat;
+        switch (N->getKind()) {
+        case Kinded::Kind::AddNodeKind:
+          v = F->createAdd(N->getName(), newLhs, newRhs);
+          break;
+        case Kinded::Kind::MulNodeKind:
+          v = F->createMul(N->getName(), newLhs, newRhs);
+          break;
+        case Kinded::Kind::SubNodeKind:
+          v = F->createSub(N->getName(), newLhs, newRhs);
+          break;
+        case Kinded::Kind::DivNodeKind:
+          v = F->createDiv(N->getName(), newLhs, newRhs);
+          break;
+        case Kinded::Kind::MaxNodeKind:
+          v = F->createMax(N->getName(), newLhs, newRhs);
+          break;
+        case Kinded::Kind::MinNodeKind:
+          v = F->createMin(N->getName(), newLhs, newRhs);
+          break;
+        default:
+          llvm_unreachable("Unexpected node kind in a layout region");
+        }
+        break;
+      }
+      }
+    }
+    NodeValue(T2, 0).replaceAllUsesOfWith(v);
+  }
+}
+
 static void optimizeTranspose(Function *F) {
   auto &nodes = F->getNodes();
 
@@ -1223,6 +1352,7 @@ struct CSEVisitor : NodeWalker {
     // Replace current node by a found node, which is
     // equivalent to it.
     assert(N->isEqual(*foundN));
+    ++numCSEReplaced;
     for (unsigned i = 0; i < N->getNumResults(); i++) {
       NodeValue FV(foundN, i);
       N->getNthResult(i).replaceAllUsesOfWith(FV);
@@ -1243,19 +1373,12 @@ struct CSEVisitor : NodeWalker {
 /// the Variable to balance collisions with hash calclulation time.
 struct VarsHasherDedup {
   size_t operator()(Variable *V) const {
-    auto hash = llvm::hash_value(V->getType());
-    auto &T = V->getPayload();
-    // Only use the first 8 elements in the hash. It's likely that if two
-    // tensors have different content they will diverge quickly. Fall back to
-    // full equality check in VarsEqDedup.
-    constexpr size_t maxNumEls = 8;
-    size_t numEls = std::min(T.getType().size(), maxNumEls);
-    size_t bufSize = T.getType().getElementSize() * numEls;
-    auto *data = T.getUnsafePtr();
-    for (size_t i = 0; i < bufSize; i++) {
-      hash = llvm::hash_combine(hash, data[i]);
-    }
-    return hash;
+    // Combine the type with the content hash of the whole payload. The full
+    // content hash makes collisions between distinct weights all but
+    // impossible, so the equality predicate almost never runs a comparison
+    // between tensors that do not match.
+    return llvm::hash_combine(llvm::hash_value(V->getType()),
+                              V->getPayload().hash());
   }
 };
 
@@ -1274,8 +1397,8 @@ struct VarsEqDedup {
            "Should only be comparing Variables with same VisibilityKind.");
     assert(lhs->getTrainKind() == rhs->getTrainKind() &&
            "Should only be comparing Variables with same TrainKind.");
-    // Only combine Vars if their data matches exactly, so allowed error is 0.0.
-    return lhs->getPayload().isEqual(rhs->getPayload(), /* allowedError */ 0.0);
+    // Only combine Vars if their data matches bit for bit.
+    return lhs->getPayload().isBitwiseEqual(rhs->getPayload());
   }
 };
 
@@ -1312,8 +1435,8 @@ static void deduplicateConstants(Module *M) {
 
   for (auto &V : M->getVars()) {
     // Only perform deduplication on vars of small enough size. Otherwise just
-    // skip them. constVarDedupSizeOpt defaults to 256 as a heuristic, to keep
-    // compile time reasonable.
+    // skip them. The content hash makes a single pass over the payload, so
+    // the default covers all but the very largest weights.
     size_t maxNumEls = constVarDedupSizeOpt;
     size_t numEls = V->getType()->size();
     if (numEls > maxNumEls) {
@@ -1511,11 +1634,35 @@ static void optimizeQuantization(Function *F) {
             V->getTrainKind(), 1.0);
         // Quantize V into NV.
         auto srcHandle = V->getHandle();
-        auto destHandle = NV->getHandle<int8_t>();
-        TensorQuantizationParams params{Q->getResult().getType()->getScale(),
-                                        Q->getResult().getType()->getOffset()};
-        for (size_t i = 0, e = destHandle.size(); i < e; ++i) {
-          destHandle.raw(i) = quantization::quantize(srcHandle.raw(i), params);
+        auto *destTy = Q->getResult().getType();
+        if (destTy->isChannelwiseQuantized()) {
+          // Apply the scale/offset pair of the channel each element
+          // belongs to.
+          auto destHandle = NV->getHandle<int8_t>();
+          auto scales = destTy->getChannelScales();
+          auto offsets = destTy->getChannelOffsets();
+          size_t numChannels = scales.size();
+          size_t chunk = destTy->getSliceSize(destTy->getChannelAxis() + 1);
+          for (size_t i = 0, e = destHandle.size(); i < e; ++i) {
+            size_t c = (i / chunk) % numChannels;
+            destHandle.raw(i) = quantization::quantize(
+                srcHandle.raw(i), {scales[c], offsets[c]});
+          }
+        } else if (destTy->getElementType() == ElemKind::Int16QTy) {
+          auto destHandle = NV->getHandle<int16_t>();
+          TensorQuantizationParams params{destTy->getScale(),
+                                          destTy->getOffset()};
+          for (size_t i = 0, e = destHandle.size(); i < e; ++i) {
+            destHandle.raw(i) =
+                quantization::quantize<int16_t>(srcHandle.raw(i), params);
+          }
+        } else {
+          TensorQuantizationParams params{destTy->getScale(),
+                                          destTy->getOffset()};
+          quantization::quantizeBulk(
+              NV->getPayload().getRawDataPointer<int8_t>(),
+              V->getPayload().getRawDataPointer<float>(), srcHandle.size(),
+              params);
         }
         Q->getResult().replaceAllUsesOfWith(NV);
         continue;
@@ -1528,6 +1675,16 @@ static void optimizeQuantization(Function *F) {
         DQ->getResult().replaceAllUsesOfWith(Q->getInput());
         continue;
       }
+
+      if (auto *RS = dyn_cast<RescaleQuantizedNode>(DQ->getInput())) {
+        // Dequantize(Rescale(X)) -> Dequantize(X)
+        // The dequantization undoes any rescaling, so reading the value
+        // before the rescale skips one requantization rounding step.
+        auto *newDQ = F->createDequantize(DQ->getName(), RS->getInput());
+        worklist.push_back(newDQ);
+        DQ->getResult().replaceAllUsesOfWith(newDQ);
+        continue;
+      }
     }
 
     if (auto *RS = dyn_cast<RescaleQuantizedNode>(node)) {
@@ -1740,61 +1897,372 @@ static bool sinkRescaleQuantizedNode(Function *F) {
   return changed;
 }
 
-void glow::optimize(Function *F, CompilationMode mode) {
-  // Sink transpose operations in an attempt to cancel them out.
-  // Perform code sinking until a fixed-point is reached.
-  // On big functions, the number of iterations until the fixpoint
-  // is usually at most 2 or 3 iterations.
-  while (sinkCode(F)) {
-    // Perform Dead Code Elimination between rounds of code sinking.
-    DCE(F);
+
+/// \returns true if the contents of the variable \p V will not change during
+/// the lifetime of the program: it is private, it is not updated by training,
+/// and no node overwrites it.
+static bool isConstantVariable(Variable *V) {
+  return V->isPrivate() && !V->isTraining() && !hasWriters(V);
+}
+
+/// Compile-time constant folding.
+///
+/// Finds the parts of \p F that depend only on constant variables - shape
+/// computations, pre-scaled weights, transposed filters and the like - and
+/// evaluates them once at compile time instead of on every inference. The
+/// foldable subgraph is cloned into a temporary function, compiled for the
+/// Interpreter backend and executed, and its outputs are materialized as
+/// private variables that replace the computed values in \p F.
+static void constantFold(Function *F) {
+  auto *M = F->getParent();
+
+  // Classify the foldable nodes: nodes without side effects or predicates
+  // whose inputs are constant variables or other foldable nodes. The
+  // post-order walk visits inputs before their users.
+  std::unordered_set<Node *> foldable;
+  for (Node *N : F->getPostOrder()) {
+    if (isa<Variable>(N) || N->hasSideEffects() || N->hasPredicate()) {
+      continue;
+    }
+    bool inputsAreConst = true;
+    for (unsigned i = 0, e = N->getNumInputs(); i < e; i++) {
+      Node *in = N->getNthInput(i).getNode();
+      if (auto *V = dyn_cast<Variable>(in)) {
+        if (isConstantVariable(V)) {
+          continue;
+        }
+      } else if (foldable.count(in)) {
+        continue;
+      }
+      inputsAreConst = false;
+      break;
+    }
+    if (inputsAreConst) {
+      foldable.insert(N);
+    }
+  }
+
+  // Collect the frontier: foldable results that are consumed by nodes
+  // outside of the foldable set. Splats are cheaper to recompute than to
+  // materialize, so they do not count as a frontier on their own.
+  std::vector<NodeValue> frontier;
+  for (Node *N : F->getPostOrder()) {
+    if (!foldable.count(N) || isa<SplatNode>(N)) {
+      continue;
+    }
+    for (unsigned r = 0, e = N->getNumResults(); r < e; r++) {
+      NodeValue NV(N, r);
+      bool escapes = false;
+      for (auto &U : N->getUsers()) {
+        Node *user = U.getUser();
+        if (foldable.count(user)) {
+          continue;
+        }
+        for (unsigned i = 0, ie = user->getNumInputs(); i < ie; i++) {
+          if (user->getNthInput(i) == NV) {
+            escapes = true;
+            break;
+          }
+        }
+        if (escapes) {
+          break;
+        }
+      }
+      if (escapes) {
+        frontier.push_back(NV);
+      }
+    }
+  }
+  if (frontier.empty()) {
+    return;
+  }
+
+  // Clone the function, and strip the clone of its side-effecting nodes;
+  // only the constant part needs to execute. Erasing a save may expose
+  // another side-effecting node with no users, hence the fixpoint loop.
+  llvm::DenseMap<Node *, Node *> currToNew;
+  auto *tmpF = F->clone(F->getName().str() + "_constfold", &currToNew);
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    auto &nodes = tmpF->getNodes();
+    for (auto it = nodes.begin(), e = nodes.end(); it != e;) {
+      Node *N = &*it++;
+      if (N->hasSideEffects() && !N->hasUsers()) {
+        tmpF->eraseNode(N);
+        changed = true;
+      }
+    }
+  }
+
+  // Save every frontier value into a fresh private variable.
+  std::vector<std::pair<NodeValue, Variable *>> materialized;
+  for (auto &NV : frontier) {
+    auto *mapped = currToNew[NV.getNode()];
+    assert(mapped && "Frontier node is missing from the clone");
+    auto *out =
+        M->createVariable(NV.getType(), "constfold." + NV.getNode()->getName().str(),
+                          VisibilityKind::Private, Variable::TrainKind::None);
+    tmpF->createSave("constfold.save", NodeValue(mapped, NV.getResNo()), out);
+    materialized.push_back({NV, out});
+  }
+
+  // Drop everything that does not feed the saves, then compile the clone for
+  // the Interpreter and run it once.
+  DCE(tmpF);
+  std::unique_ptr<Backend> backend(createBackend(BackendKind::Interpreter));
+  ::glow::lower(tmpF, *backend);
+  auto IR = llvm::make_unique<IRFunction>(tmpF);
+  IR->generateIR();
+  backend->compile(std::move(IR))->execute();
+
+  // Rewrite the consumers of each frontier value to read the computed
+  // variable, and clean up the now-dead subgraph.
+  for (auto &entry : materialized) {
+    entry.first.replaceAllUsesOfWith(entry.second);
+  }
+  M->eraseFunction(tmpF);
+  DCE(F);
+}
+
+void FunctionPassPipeline::add(llvm::StringRef name,
+                               std::function<bool(Function *)> run) {
+  passes_.push_back({name.str(), std::move(run)});
+}
+
+bool FunctionPassPipeline::run(Function *F) const {
+  // Reports the current size of \p F to the pass timers.
+  auto countNodes = [F] { return static_cast<int64_t>(F->getNodes().size()); };
+
+  bool everChanged = false;
+  for (unsigned iter = 0; iter < maxIterations_; iter++) {
+    bool changed = false;
+    for (const auto &P : passes_) {
+      ScopedPassTimer timer(P.name.c_str(), countNodes);
+      changed |= P.run(F);
+    }
+    everChanged |= changed;
+    // Stop as soon as a whole iteration reaches a fixpoint.
+    if (!changed) {
+      break;
+    }
   }
+  return everChanged;
+}
+
+/// Adapts the pass \p f, which does not report modifications, by comparing
+/// the function's structural hash around the invocation.
+static std::function<bool(Function *)> detectChangesByHash(void (*f)(Function *)) {
+  return [f](Function *F) {
+    auto before = F->getStructuralHash();
+    f(F);
+    return before != F->getStructuralHash();
+  };
+}
+
+FunctionPassPipeline
+glow::createDefaultGraphOptimizationPipeline(CompilationMode mode) {
+  FunctionPassPipeline pipeline;
+
+  // Sink transpose operations in an attempt to cancel them out. Perform code
+  // sinking until a fixed-point is reached, with Dead Code Elimination
+  // between the rounds. On big functions the fixpoint is usually reached
+  // within 2 or 3 iterations.
+  pipeline.add("sinkCode", [](Function *F) {
+    bool changed = false;
+    while (sinkCode(F)) {
+      changed = true;
+      DCE(F);
+    }
+    return changed;
+  });
 
   // Optimize the pooling operation.
-  optimizePool(F);
+  pipeline.add("optimizePool", detectChangesByHash(optimizePool));
 
   // Perform Common Subexpression Elimination.
-  CSE(F);
+  pipeline.add("CSE", detectChangesByHash(CSE));
 
   // Merge multiple matmul nodes into a single large matmul.
-  mergeMatMul(F);
+  pipeline.add("mergeMatMul", detectChangesByHash(mergeMatMul));
 
   // Merge multiple batched adds into a larger batched add.
-  mergeBatchedAdd(F);
+  pipeline.add("mergeBatchedAdd", detectChangesByHash(mergeBatchedAdd));
 
   // Perform Dead Code Elimination.
-  DCE(F);
+  pipeline.add("DCE", detectChangesByHash(DCE));
 
   if (mode == CompilationMode::Infer) {
     // Merge batch normalization operations.
-    optimizeBatchNorm(F);
+    pipeline.add("optimizeBatchNorm", detectChangesByHash(optimizeBatchNorm));
 
     // Constant-fold transpose operations.
-    optimizeTranspose(F);
+    pipeline.add("optimizeTranspose", detectChangesByHash(optimizeTranspose));
+
+    // Evaluate the subgraphs that depend only on constant variables.
+    pipeline.add("constantFold", detectChangesByHash(constantFold));
   }
 
   // Perform Common Subexpression Elimination.
-  CSE(F);
+  pipeline.add("CSE", detectChangesByHash(CSE));
 
   // Optimize Concat nodes.
-  optimizeConcatNodes(F);
+  pipeline.add("optimizeConcatNodes", detectChangesByHash(optimizeConcatNodes));
 
   // Optimize arithmetic nodes based on algebraic identities.
-  optimizeArithmeticNodes(F);
+  pipeline.add("optimizeArithmeticNodes",
+               detectChangesByHash(optimizeArithmeticNodes));
+
+  // Cancel inverse transposes around regions of layout-agnostic nodes.
+  pipeline.add("optimizeLayoutRegions", detectChangesByHash(optimizeLayoutRegions));
 
   // Optimize Tensor shape transformations.
-  optimizeSliceOfSplat(F);
+  pipeline.add("optimizeSliceOfSplat", detectChangesByHash(optimizeSliceOfSplat));
 
-  optimizeReshape(F);
+  pipeline.add("optimizeReshape", detectChangesByHash(optimizeReshape));
 
   // Optimize things that are related to quantization.
-  optimizeQuantization(F);
+  pipeline.add("optimizeQuantization", detectChangesByHash(optimizeQuantization));
 
-  while (sinkRescaleQuantizedNode(F)) {
-    DCE(F);
-    optimizeQuantization(F);
-  }
+  pipeline.add("sinkRescaleQuantizedNode", [](Function *F) {
+    bool changed = false;
+    while (sinkRescaleQuantizedNode(F)) {
+      changed = true;
+      DCE(F);
+      optimizeQuantization(F);
+    }
+    return changed;
+  });
 
   // Perform Dead Code Elimination.
-  DCE(F);
+  pipeline.add("DCE", detectChangesByHash(DCE));
+
+  return pipeline;
+}
+
+/// \returns the pipelines registered for specific functions, keyed by the
+/// function name.
+static std::map<std::string, FunctionPassPipeline> &getPipelineRegistry() {
+  static std::map<std::string, FunctionPassPipeline> registry;
+  return registry;
+}
+
+void glow::registerOptimizationPipeline(llvm::StringRef functionName,
+                                        FunctionPassPipeline pipeline) {
+  getPipelineRegistry()[functionName.str()] = std::move(pipeline);
+}
+
+void glow::optimize(Function *F, CompilationMode mode) {
+  // A pipeline registered for this function overrides the default cascade.
+  auto &registry = getPipelineRegistry();
+  auto it = registry.find(F->getName().str());
+  if (it != registry.end()) {
+    it->second.run(F);
+    return;
+  }
+
+  createDefaultGraphOptimizationPipeline(mode).run(F);
+}
+
+bool glow::fuseGatherReduceAdd(Function *F) {
+  auto *M = F->getParent();
+  bool changed = false;
+  for (auto &node : F->getNodes()) {
+    auto *BRA = dyn_cast<BatchedReduceAddNode>(&node);
+    if (!BRA || BRA->getAxis() != 0) {
+      continue;
+    }
+    auto *G = dyn_cast<GatherNode>(BRA->getBatch());
+    if (!G || !G->hasOneUse() || G->getBatchDims() != 0 ||
+        G->getIndices().dims().size() != 1 ||
+        G->getResult().getType()->isQuantizedType()) {
+      continue;
+    }
+    // The sum over all gathered rows is a SparseLengthsSum with a single
+    // segment that spans the whole index vector.
+    auto *lengths =
+        M->createVariable(ElemKind::IndexTy, {1}, "sls.lengths",
+                          VisibilityKind::Private, Variable::TrainKind::None);
+    lengths->getHandle<size_t>().raw(0) = G->getIndices().dims()[0];
+    auto *SLS = F->createSparseLengthsSum(BRA->getName(), G->getData(),
+                                          G->getIndices(), lengths);
+    // Drop the leading singleton segment dimension.
+    auto *RN =
+        F->createReshape(BRA->getName(), SLS, BRA->getResult().dims());
+    BRA->getResult().replaceAllUsesOfWith(RN);
+    changed = true;
+  }
+  return changed;
+}
+
+/// \returns true if every user of \p V consumes it as the weights of a
+/// fully-connected node or as the RHS of a matrix multiplication, i.e. as an
+/// operand with a sparse kernel.
+static bool usedOnlyAsMatMulWeights(Variable *V) {
+  for (auto &U : V->getUsers()) {
+    auto *N = U.getUser();
+    if (auto *FC = dyn_cast<FullyConnectedNode>(N)) {
+      if (FC->getWeights().getNode() == V) {
+        continue;
+      }
+    }
+    if (auto *MM = dyn_cast<MatMulNode>(N)) {
+      if (MM->getRHS().getNode() == V) {
+        continue;
+      }
+    }
+    return false;
+  }
+  return true;
+}
+
+void glow::sparsifyWeights(Function *F, float minSparsity) {
+  auto *M = F->getParent();
+  // Converting a variable adds its replacement to the module; iterate over a
+  // copy of the variable list.
+  auto vars = M->getVars();
+  for (auto *V : vars) {
+    // Only private float weight matrices that are not being trained can
+    // change their representation behind the graph's back.
+    if (!V->isPrivate() || V->isTraining() ||
+        V->getElementType() != ElemKind::FloatTy || V->dims().size() != 2 ||
+        V->getType()->isSparse() || !V->hasUsers() ||
+        !usedOnlyAsMatMulWeights(V)) {
+      continue;
+    }
+    auto H = V->getHandle<float>();
+    size_t numZeros = 0;
+    for (size_t i = 0, e = H.size(); i < e; i++) {
+      numZeros += (H.raw(i) == 0.0f);
+    }
+    if (float(numZeros) < minSparsity * float(H.size())) {
+      continue;
+    }
+    Tensor csr = sparsifyTensorCSR(&V->getPayload());
+    auto *NV =
+        M->createVariable(M->uniqueType(csr.getType()), V->getName(),
+                          V->getVisibilityKind(), V->getTrainKind(),
+                          V->getValue());
+    NV->getPayload() = std::move(csr);
+    NodeValue(V, 0).replaceAllUsesOfWith(NV);
+    M->eraseVariable(V);
+  }
+}
+
+void glow::densifySparseWeights(Function *F) {
+  auto *M = F->getParent();
+  auto vars = M->getVars();
+  for (auto *V : vars) {
+    if (!V->getType()->isSparse()) {
+      continue;
+    }
+    Tensor dense = densifyTensorCSR(&V->getPayload());
+    auto *NV =
+        M->createVariable(M->uniqueType(dense.getType()), V->getName(),
+                          V->getVisibilityKind(), V->getTrainKind(),
+                          V->getValue());
+    NV->getPayload() = std::move(dense);
+    NodeValue(V, 0).replaceAllUsesOfWith(NV);
+    M->eraseVariable(V);
+  }
 }
@@ -23,6 +23,8 @@
 #include "glow/IR/Instrs.h"
 #include "glow/Optimizer/Optimizer.h"
 #include "glow/Support/Debug.h"
+#include "glow/Support/PassStats.h"
+#include "glow/Support/Statistic.h"
 
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/CommandLine.h"
@@ -30,6 +32,7 @@
 #include "llvm/Support/raw_ostream.h"
 
 #include <iostream>
+#include <memory>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -52,6 +55,12 @@ using llvm::cast;
 using llvm::dyn_cast;
 using llvm::isa;
 
+GLOW_STATISTIC(numDeadAllocsDeleted, "Number of unused allocations deleted");
+GLOW_STATISTIC(numBuffersShared,
+               "Number of buffer pairs coalesced into one allocation");
+GLOW_STATISTIC(numDeadStoresEliminated,
+               "Number of instructions erased for writing unobserved values");
+
 /// Live interval of a memory buffer.
 /// It represents a sequence of instructions [begin, end) where this buffer
 /// holds a value.
@@ -370,6 +379,7 @@ static void deleteDeadAllocs(IRFunction &M) {
       continue;
     }
     if (isa<AllocActivationInst>(I) && !I->hasUsers()) {
+      ++numDeadAllocsDeleted;
       M.eraseInstruction(I);
     }
   }
@@ -699,6 +709,54 @@ getCompatibleValueForReplacement(IRBuilder &B, Instruction *Before,
 }
 
 /// Moves an interval from one interval list to another.
+/// A reusable wrapper around the liveness information: the live intervals of
+/// all memory locations and the instruction numbering they are based on.
+/// The analysis is computed lazily and cached, so several passes within one
+/// optimize() invocation share a single computation. A pass that changes the
+/// instruction sequence must call invalidate(); a pass that keeps the
+/// intervals up to date itself (like shareBuffers) may keep using the cached
+/// state.
+class LiveIntervalsAnalysis {
+  /// The function being analyzed.
+  IRFunction &M_;
+  /// Cached live intervals of every memory location.
+  LiveIntervalsMap intervalsMap_;
+  /// Cached instruction numbering the intervals refer to.
+  std::unique_ptr<LiveIntervalsInstructionNumbering> instrNumbering_;
+  /// True if the cached state matches the current instruction sequence.
+  bool valid_{false};
+
+  /// Recomputes the cached state if it is out of date.
+  void ensure() {
+    if (valid_) {
+      return;
+    }
+    intervalsMap_.clear();
+    calculateLiveIntervals(M_, intervalsMap_);
+    instrNumbering_.reset(new LiveIntervalsInstructionNumbering(M_));
+    valid_ = true;
+  }
+
+public:
+  explicit LiveIntervalsAnalysis(IRFunction &M) : M_(M) {}
+
+  /// \returns the live intervals of every memory location.
+  LiveIntervalsMap &getIntervals() {
+    ensure();
+    return intervalsMap_;
+  }
+
+  /// \returns the instruction numbering the intervals are based on.
+  const LiveIntervalsInstructionNumbering &getInstrNumbering() {
+    ensure();
+    return *instrNumbering_;
+  }
+
+  /// Drops the cached state. Must be called by any pass that adds, removes
+  /// or reorders instructions without maintaining the intervals itself.
+  void invalidate() { valid_ = false; }
+};
+
 static void moveInterval(Intervals &from, Intervals &to, Interval &interval) {
   auto fromIt = std::find(from.begin(), from.end(), interval);
   assert(fromIt != from.end() && "Interval should exist in the from list");
@@ -1121,8 +1179,10 @@ static void tryToShareBuffersForInstr(
       // The buffers can be reused in principle, thus try to share the buffers.
       BufferSharingOptimizer opt(M, intervalsMap, instrNumbering, I, instIdx,
                                  dest, src);
-      if (opt.tryToShareBuffers())
+      if (opt.tryToShareBuffers()) {
+        ++numBuffersShared;
         return;
+      }
     }
   }
 }
@@ -1137,13 +1197,15 @@ static void tryToShareBuffersForInstr(
 /// do not need to be observable. Typically, two live intervals are considred as
 /// candidates for sharing if they occur in the same instruction, but it is not
 /// strictly necessary.
-static void shareBuffers(IRFunction &M) {
+static void shareBuffers(IRFunction &M, LiveIntervalsAnalysis &liveness) {
   InstructionPtrSet erasedInstructions;
-  // Build a list of live intervals for each memory location
-  // which is either a WeightVar or a an Allocation.
-  LiveIntervalsMap intervalsMap;
-  calculateLiveIntervals(M, intervalsMap);
-  LiveIntervalsInstructionNumbering instrNumbering(M);
+  // The live intervals of each memory location, which is either a WeightVar
+  // or an Allocation, together with the numbering they refer to. The pass
+  // keeps the intervals up to date as it coalesces buffers, so the shared
+  // analysis stays valid.
+  LiveIntervalsMap &intervalsMap = liveness.getIntervals();
+  const LiveIntervalsInstructionNumbering &instrNumbering =
+      liveness.getInstrNumbering();
 
   // Get the source of the copy. This memory location may have been
   // modified by any instruction that used it as an @out or @inout
@@ -1167,6 +1229,225 @@ static void shareBuffers(IRFunction &M) {
   // Fix eventual issues with tensorviews that shareBuffers may
   // introduce by extending live interval lifetimes.
   sinkTensorViews(M);
+  // The fix-up passes above reorder instructions.
+  liveness.invalidate();
+}
+
+/// Share buffers between activations whose live ranges do not overlap.
+///
+/// shareBuffers only coalesces buffers that meet in the same instruction,
+/// typically the source and destination of a copy. This pass considers all
+/// pairs of activations: it computes the overall live range of every
+/// AllocActivationInst from the shared liveness analysis and greedily assigns
+/// each activation, in order of increasing range start, to the first
+/// previously placed buffer of the same type whose range has already ended.
+/// Because all instructions form a single basic block, the live ranges form
+/// an interval graph and this greedy scan is an optimal coloring of it.
+static void shareDisjointActivations(IRFunction &M,
+                                     LiveIntervalsAnalysis &liveness) {
+  auto &intervalsMap = liveness.getIntervals();
+
+  /// An activation together with its overall live range.
+  struct Range {
+    AllocActivationInst *alloc;
+    size_t begin;
+    size_t end;
+  };
+  std::vector<Range> ranges;
+
+  for (auto &I : M.getInstrs()) {
+    auto *A = dyn_cast<AllocActivationInst>(&I);
+    if (!A) {
+      continue;
+    }
+    // Tensor views alias the buffer under a different type. Stay away from
+    // them; shareBuffers already handles the profitable copy cases.
+    bool hasViews = false;
+    for (const auto &U : A->getUsers()) {
+      if (isa<TensorViewInst>(U.get())) {
+        hasViews = true;
+        break;
+      }
+    }
+    if (hasViews) {
+      continue;
+    }
+    auto it = intervalsMap.find(A);
+    if (it == intervalsMap.end() || it->second.empty()) {
+      continue;
+    }
+    // The intervals are sorted, so the overall live range spans from the
+    // first write into the buffer to the last use of its last value.
+    ranges.push_back({A, it->second.front().begin_, it->second.back().end_});
+  }
+
+  // Process the activations in order of increasing live range start.
+  std::sort(ranges.begin(), ranges.end(),
+            [](const Range &LHS, const Range &RHS) {
+              return LHS.begin < RHS.begin;
+            });
+
+  /// A buffer that was already placed: the representative activation and the
+  /// point where its (possibly extended) live range ends.
+  struct Slot {
+    AllocActivationInst *alloc;
+    size_t end;
+  };
+  std::vector<Slot> slots;
+  bool changed = false;
+
+  for (auto &R : ranges) {
+    Slot *avail = nullptr;
+    for (auto &S : slots) {
+      // Require the previous range to end strictly before this one begins,
+      // and an identical type so that no view is needed.
+      if (S.end < R.begin && S.alloc->getType() == R.alloc->getType()) {
+        avail = &S;
+        break;
+      }
+    }
+    if (!avail) {
+      slots.push_back({R.alloc, R.end});
+      continue;
+    }
+    DEBUG_GLOW(llvm::dbgs() << "Reuse buffers: use buffer of "
+                            << avail->alloc->getName() << " as a buffer for "
+                            << R.alloc->getName() << "\n");
+    // Redirect all users of this activation into the representative buffer.
+    // The now-unused alloc and its dealloc are removed below.
+    replaceAllNonDeallocUsersWith(R.alloc, avail->alloc);
+    avail->end = R.end;
+    changed = true;
+  }
+
+  if (!changed) {
+    return;
+  }
+  // Remove the allocs and deallocs of the merged activations, and move the
+  // allocs and deallocs of the representatives to span their extended live
+  // ranges.
+  deleteDeadAllocs(M);
+  hoistDealloc(M);
+  sinkAllocas(M);
+  liveness.invalidate();
+}
+
+/// Cluster chains of data-parallel instructions.
+///
+/// Backends that support kernel stacking compile consecutive shape-compatible
+/// data-parallel instructions into a single fused kernel that traverses
+/// memory once. IRGen, however, interleaves the elementwise instructions of a
+/// chain with allocs and unrelated instructions, which breaks up the bundles.
+/// This pass sinks every data-parallel instruction right before its first
+/// user when that user is a shape-compatible data-parallel instruction and no
+/// instruction in between accesses the moved instruction's buffers, so that
+/// e.g. a Mul->Add->Relu chain forms one contiguous bundle. The intermediate
+/// buffers of the clustered chain are then collapsed by the in-place buffer
+/// sharing above.
+static void clusterDataParallelChains(IRFunction &M) {
+  auto &instrs = M.getInstrs();
+
+  // Collect the buffers read and written by \p I, reduced to their
+  // allocation origins.
+  auto collectAccesses = [](const Instruction *I,
+                            llvm::SmallVectorImpl<const Value *> &reads,
+                            llvm::SmallVectorImpl<const Value *> &writes) {
+    for (const auto &op : I->getOperands()) {
+      const Value *origin = getOrigin(op.first);
+      if (op.second != OperandKind::Out) {
+        reads.push_back(origin);
+      }
+      if (op.second != OperandKind::In) {
+        writes.push_back(origin);
+      }
+    }
+  };
+
+  auto contains = [](llvm::SmallVectorImpl<const Value *> &set,
+                     const Value *V) {
+    return std::find(set.begin(), set.end(), V) != set.end();
+  };
+
+  // Process the candidates bottom-up, so that the tail of a chain is already
+  // in place when the instructions feeding it are sunk towards it.
+  llvm::SmallVector<Instruction *, 32> candidates;
+  for (auto &I : instrs) {
+    if (I.isDataParallel()) {
+      candidates.push_back(&I);
+    }
+  }
+
+  for (auto it = candidates.rbegin(), e = candidates.rend(); it != e; ++it) {
+    Instruction *A = *it;
+    llvm::SmallVector<const Value *, 4> reads;
+    llvm::SmallVector<const Value *, 4> writes;
+    collectAccesses(A, reads, writes);
+
+    // Walk forward until the first instruction that touches a buffer written
+    // by \p A, which is either the instruction to sink in front of or a
+    // reason to bail.
+    for (auto cur = std::next(A->getIterator()), end = instrs.end();
+         cur != end; ++cur) {
+      Instruction *X = &*cur;
+      // Do not move across the memory management instructions of the
+      // affected buffers.
+      if (isa<AllocActivationInst>(X) || isa<DeallocActivationInst>(X) ||
+          isa<TensorViewInst>(X)) {
+        const Value *origin = getOrigin(X->getNumOperands()
+                                            ? X->getOperand(0).first
+                                            : static_cast<Value *>(X));
+        if (contains(reads, origin) || contains(writes, origin)) {
+          break;
+        }
+        continue;
+      }
+
+      bool touchesResult = false;
+      bool readsResult = false;
+      bool clobbersInput = false;
+      for (const auto &op : X->getOperands()) {
+        const Value *origin = getOrigin(op.first);
+        if (contains(writes, origin)) {
+          touchesResult = true;
+          if (op.second != OperandKind::Out) {
+            readsResult = true;
+          }
+        }
+        if (op.second != OperandKind::In && contains(reads, origin)) {
+          clobbersInput = true;
+        }
+      }
+
+      if (touchesResult) {
+        // \p X is the first user (or clobber) of the result. Sink \p A in
+        // front of it when this extends a data-parallel bundle.
+        if (readsResult && !clobbersInput && X->isDataParallel() &&
+            X->getNumOperands() && A->getNumOperands() &&
+            X->getOperand(0).first->size() == A->getOperand(0).first->size()) {
+          // Sink above the run of data-parallel instructions that already
+          // ends at \p X, so an existing cluster is extended upward instead
+          // of being split by the insertion. Every instruction between \p A
+          // and \p X was checked above not to touch A's buffers, so any
+          // position in that range is safe.
+          auto pos = cur;
+          while (pos != instrs.begin()) {
+            auto prev = std::prev(pos);
+            if (&*prev == A || !prev->isDataParallel()) {
+              break;
+            }
+            pos = prev;
+          }
+          if (std::next(A->getIterator()) != pos) {
+            M.moveInstruction(&*pos, A);
+          }
+        }
+        break;
+      }
+      if (clobbersInput) {
+        break;
+      }
+    }
+  }
 }
 
 /// Dead Store Elimination.
@@ -1241,6 +1522,7 @@ static void eliminateDeadStores(IRFunction &M) {
     if (numMutatedOperands > 0 &&
         numMutatedOperands == numNonReadMutatedOperands) {
       erasedInstructions.insert(I);
+      ++numDeadStoresEliminated;
       // Do not process any reads of operands, because
       // this instruction will be eliminated.
       continue;
@@ -1261,37 +1543,48 @@ static void eliminateDeadStores(IRFunction &M) {
 }
 
 /// \returns true if the first dimension in \p offsets has a non-zero value.
-static bool isOnlyOffsetInFirstDim(llvm::ArrayRef<size_t> offsets) {
-  if (offsets.size() > 1) {
-    for (size_t i = 1; i < offsets.size(); ++i) {
-      if (offsets[i] != 0) {
-        return false;
-      }
+/// \returns true if the region of \p bigDims described by \p sliceDims and
+/// \p offsets occupies a contiguous block of memory. This is the case when
+/// the slice differs from the whole tensor in at most one axis, every axis
+/// before it is a unit dimension, and every axis after it is taken whole.
+/// The common cases are a slice along the first dimension and, for batch-one
+/// tensors, a slice along the second.
+static bool isContiguousSlice(llvm::ArrayRef<size_t> offsets,
+                              llvm::ArrayRef<size_t> sliceDims,
+                              llvm::ArrayRef<size_t> bigDims) {
+  assert(sliceDims.size() == bigDims.size() &&
+         "Slice and tensor dims must have same number of dims.");
+  // Find the first axis where the slice does not cover the whole tensor.
+  size_t firstPartialAxis = 0;
+  while (firstPartialAxis < bigDims.size() &&
+         offsets[firstPartialAxis] == 0 &&
+         sliceDims[firstPartialAxis] == bigDims[firstPartialAxis]) {
+    firstPartialAxis++;
+  }
+  // The slice covers the whole tensor.
+  if (firstPartialAxis == bigDims.size()) {
+    return true;
+  }
+  // All axes before the partial one must be unit dimensions, so that the
+  // partial axis is the outermost non-trivial one.
+  for (size_t i = 0; i < firstPartialAxis; i++) {
+    if (bigDims[i] != 1) {
+      return false;
     }
   }
-  return true;
-}
-
-/// \returns true if the dimensions of \p sourceDims, other than the first
-/// dimension, all equal the dimensions in \p destDims.
-static bool allButFirstDimsEqual(llvm::ArrayRef<size_t> sourceDims,
-                                 llvm::ArrayRef<size_t> destDims) {
-  assert(sourceDims.size() == destDims.size() &&
-         "Source and dest dims must have same number of dims.");
-  if (sourceDims.size() > 1) {
-    for (size_t i = 1; i < sourceDims.size(); ++i) {
-      if (sourceDims[i] != destDims[i]) {
-        return false;
-      }
+  // All axes after the partial one must be taken whole.
+  for (size_t i = firstPartialAxis + 1; i < bigDims.size(); i++) {
+    if (offsets[i] != 0 || sliceDims[i] != bigDims[i]) {
+      return false;
     }
   }
   return true;
 }
 
-/// Replace InsertTensors that are only offset in the first dimension with
-/// writing directly into the destination using TensorViews with the same
-/// offsets. This is possible because this means the underlying memory is
-/// contiguous in this case.
+/// Replace InsertTensors that write a contiguous region of their destination
+/// with writing directly into the destination using TensorViews with the same
+/// offsets. This places e.g. the inputs of a concat inside the concat's own
+/// allocation and eliminates the copies entirely.
 void optimizeInserts(IRFunction &M) {
   auto &instrs = M.getInstrs();
   InstructionPtrSet erasedInstructions;
@@ -1314,10 +1607,10 @@ void optimizeInserts(IRFunction &M) {
       continue;
     }
 
-    // TVI with offsets currently only works for this optimization if the insert
-    // is only into the first dimension. This is because the tensor memory must
-    // be contiguous.
-    if (!isOnlyOffsetInFirstDim(ITI->getOffsets())) {
+    // The insert can only be replaced by a view of the destination if the
+    // region it writes is contiguous in the destination's memory.
+    if (!isContiguousSlice(ITI->getOffsets(), ITI->getSrc()->dims(),
+                           ITI->getDest()->dims())) {
       continue;
     }
 
@@ -1336,13 +1629,7 @@ void optimizeInserts(IRFunction &M) {
       continue;
     }
 
-    // Make sure that all but the first dimension of the inserttensor's source
-    // and dest are equal. This means that the writes to the destination of the
-    // insert are contiguous.
     auto *insertDest = ITI->getDest();
-    if (!allButFirstDimsEqual(insertSourceAAI->dims(), insertDest->dims())) {
-      continue;
-    }
 
     // Find the original writer into insertSourceAAI.
     Instruction *origWriter = nullptr;
@@ -1381,10 +1668,8 @@ void optimizeInserts(IRFunction &M) {
   eraseInstructions(M, erasedInstructions);
 }
 
-/// Replace ExtractTensors that are only offset in the first dimension with
-/// reading directly from the destination using TensorViews with the same
-/// offsets. This is possible because this means the underlying memory is
-/// contiguous in this case.
+/// Replace ExtractTensors that read a contiguous region of their source with
+/// reading directly from the source using TensorViews with the same offsets.
 void optimizeExtracts(IRFunction &M) {
   auto &instrs = M.getInstrs();
   InstructionPtrSet erasedInstructions;
@@ -1397,10 +1682,10 @@ void optimizeExtracts(IRFunction &M) {
       continue;
     }
 
-    // TVI with offsets currently only works for this optimization if the
-    // extract is only into the first dimension. This is because the tensor
-    // memory must be contiguous.
-    if (!isOnlyOffsetInFirstDim(ETI->getOffsets())) {
+    // The extract can only be replaced by a view of the source if the region
+    // it reads is contiguous in the source's memory.
+    if (!isContiguousSlice(ETI->getOffsets(), ETI->getDest()->dims(),
+                           ETI->getSrc()->dims())) {
       continue;
     }
 
@@ -1420,12 +1705,6 @@ void optimizeExtracts(IRFunction &M) {
       continue;
     }
 
-    // Make sure that all but the first dimension of the extract's source and
-    // dest are equal. This means that the accesses are contiguous.
-    if (!allButFirstDimsEqual(extractSrc->dims(), extractDestAAI->dims())) {
-      continue;
-    }
-
     // Create a new TensorView of the the original source of the ExtractTensor,
     // and with the same offset as the ExtractTensor.
     auto *TVI =
@@ -1598,31 +1877,52 @@ void glow::optimize(IRFunction &M, CompilationMode mode, const Backend &B) {
   if (!optimizeIR)
     return;
 
-  performPeepholeOptimizations(M);
+  // Reports the current size of \p M to the pass timers.
+  auto countInstrs = [&M] {
+    return static_cast<int64_t>(M.getInstrs().size());
+  };
+
+  GLOW_TIMED_PASS("performPeepholeOptimizations", countInstrs,
+                  performPeepholeOptimizations(M));
 
-  eliminateDeadStores(M);
+  GLOW_TIMED_PASS("eliminateDeadStores", countInstrs, eliminateDeadStores(M));
 
   // Replace applicable InsertTensors and ExtractTensors with TensorViews.
-  optimizeInserts(M);
-  optimizeExtracts(M);
+  GLOW_TIMED_PASS("optimizeInserts", countInstrs, optimizeInserts(M));
+  GLOW_TIMED_PASS("optimizeExtracts", countInstrs, optimizeExtracts(M));
+
+  // The liveness analysis shared by the passes below. Passes that mutate the
+  // instruction sequence invalidate it; it is recomputed lazily on the next
+  // request.
+  LiveIntervalsAnalysis liveness(M);
 
   // Reuse buffers from previous operations.
-  if (B.shouldShareBuffers())
-    shareBuffers(M);
+  if (B.shouldShareBuffers()) {
+    GLOW_TIMED_PASS("shareBuffers", countInstrs, shareBuffers(M, liveness));
+    // Coalesce the remaining activations whose live ranges do not overlap.
+    GLOW_TIMED_PASS("shareDisjointActivations", countInstrs,
+                    shareDisjointActivations(M, liveness));
+  }
+
+  GLOW_TIMED_PASS("performPeepholeOptimizations", countInstrs,
+                  performPeepholeOptimizations(M));
 
-  performPeepholeOptimizations(M);
+  // Group chains of elementwise instructions so that backends can compile
+  // them into fused kernels.
+  GLOW_TIMED_PASS("clusterDataParallelChains", countInstrs,
+                  clusterDataParallelChains(M));
 
   // Shorten the lifetime of buffers.
-  hoistDealloc(M);
-  sinkAllocas(M);
+  GLOW_TIMED_PASS("hoistDealloc", countInstrs, hoistDealloc(M));
+  GLOW_TIMED_PASS("sinkAllocas", countInstrs, sinkAllocas(M));
 
   // Perform Dead Store Elimination.
-  eliminateDeadStores(M);
+  GLOW_TIMED_PASS("eliminateDeadStores", countInstrs, eliminateDeadStores(M));
 
-  deleteDeadAllocs(M);
+  GLOW_TIMED_PASS("deleteDeadAllocs", countInstrs, deleteDeadAllocs(M));
 
   // Turn read-only weights into constant weights.
-  makeWeightsConst(M);
+  GLOW_TIMED_PASS("makeWeightsConst", countInstrs, makeWeightsConst(M));
 
   // Perform a debug instrumentation if required.
   performDebugInstrumentation(M);
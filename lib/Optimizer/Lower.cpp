@@ -252,22 +252,12 @@ void lowerQuantizedSigmoidNode(Function *F, SigmoidNode *SN) {
   SN->getResult().replaceAllUsesOfWith(rescaleOutputNode);
 }
 
-void lowerSGDNode(Function *F, SGDNode &SGD) {
-  NodeValue W = SGD.getWeight();
-  NodeValue G = SGD.getGradient();
-
-  /// Described in the paper: Alex Krizhevsky [2014]
-  // "One weird trick for parallelizing convolutional neural networks"
-
-  float momentum = SGD.getMomentum();
-
-  assert(W.dims() == G.dims() && "Invalid variables sizes for SGDNode");
-
-  float L1Decay = SGD.getL1Decay();
-  float L2Decay = SGD.getL2Decay();
-  float learningRate = SGD.getLearningRate();
-  float batchSize = SGD.getBatchSize();
-
+/// \returns the gradient \p G with the L1/L2 weight-decay terms of \p W
+/// added and divided by \p batchSize, the shared front end of the optimizer
+/// lowerings.
+static NodeValue regularizeGradient(Function *F, NodeValue W, NodeValue G,
+                                    float L1Decay, float L2Decay,
+                                    float batchSize) {
   // All computations here are within the same type.
   auto type = G.getType();
 
@@ -295,6 +285,27 @@ void lowerSGDNode(Function *F, SGDNode &SGD) {
     auto *batchSizeSplat = F->createSplat("batchSizeSplat", type, batchSize);
     gij = F->createDiv("gij_div_batchSz", gij, batchSizeSplat);
   }
+  return gij;
+}
+
+void lowerSGDNode(Function *F, SGDNode &SGD) {
+  NodeValue W = SGD.getWeight();
+  NodeValue G = SGD.getGradient();
+
+  /// Described in the paper: Alex Krizhevsky [2014]
+  // "One weird trick for parallelizing convolutional neural networks"
+
+  float momentum = SGD.getMomentum();
+
+  assert(W.dims() == G.dims() && "Invalid variables sizes for SGDNode");
+
+  float learningRate = SGD.getLearningRate();
+
+  // All computations here are within the same type.
+  auto type = G.getType();
+
+  NodeValue gij = regularizeGradient(F, W, G, SGD.getL1Decay(),
+                                     SGD.getL2Decay(), SGD.getBatchSize());
 
   auto *negLearningRateSplat =
       F->createSplat("learningRateSplat", type, -learningRate);
@@ -319,6 +330,129 @@ void lowerSGDNode(Function *F, SGDNode &SGD) {
   SGD.getUpdatedWeight().replaceAllUsesOfWith(newW);
 }
 
+/// Expand an Adam update into elementwise nodes, for backends without the
+/// fused Adam instruction. The moments and the running powers of the betas
+/// live in private variables, like the momentum sum of lowerSGDNode().
+void lowerAdamNode(Function *F, AdamNode &A) {
+  NodeValue W = A.getWeight();
+  NodeValue G = A.getGradient();
+
+  assert(W.dims() == G.dims() && "Invalid variables sizes for AdamNode");
+
+  // All computations here are within the same type.
+  auto type = G.getType();
+
+  NodeValue gij = regularizeGradient(F, W, G, A.getL1Decay(), A.getL2Decay(),
+                                     A.getBatchSize());
+
+  // The first and second gradient moments, and the running powers of the
+  // betas that drive the bias corrections: they start at one and gain one
+  // beta factor per update.
+  Variable *M = F->getParent()->createVariable(
+      W->getType(0), "adam.m", VisibilityKind::Private,
+      Variable::TrainKind::Broadcast, 0);
+  Variable *V = F->getParent()->createVariable(
+      W->getType(0), "adam.v", VisibilityKind::Private,
+      Variable::TrainKind::Broadcast, 0);
+  Variable *B1t = F->getParent()->createVariable(
+      W->getType(0), "adam.beta1t", VisibilityKind::Private,
+      Variable::TrainKind::Broadcast, 1);
+  Variable *B2t = F->getParent()->createVariable(
+      W->getType(0), "adam.beta2t", VisibilityKind::Private,
+      Variable::TrainKind::Broadcast, 1);
+
+  float beta1 = A.getBeta1();
+  float beta2 = A.getBeta2();
+  auto *beta1Splat = F->createSplat("beta1Splat", type, beta1);
+  auto *beta2Splat = F->createSplat("beta2Splat", type, beta2);
+  auto *oneMinusBeta1Splat = F->createSplat("oneMinusBeta1Splat", type,
+                                            1.0f - beta1);
+  auto *oneMinusBeta2Splat = F->createSplat("oneMinusBeta2Splat", type,
+                                            1.0f - beta2);
+  auto *oneSplat = F->createSplat("oneSplat", type, 1);
+  auto *epsilonSplat = F->createSplat("epsilonSplat", type, A.getEpsilon());
+  auto *learningRateSplat =
+      F->createSplat("learningRateSplat", type, A.getLearningRate());
+
+  // m := beta1 * m + (1 - beta1) * gij.
+  auto *newM = F->createAdd("newM", F->createMul("mScaled", beta1Splat, M),
+                            F->createMul("gScaled", oneMinusBeta1Splat, gij));
+  F->createSave("save.m", newM, M);
+
+  // v := beta2 * v + (1 - beta2) * gij^2.
+  auto *gijSq = F->createMul("gijSq", gij, gij);
+  auto *newV =
+      F->createAdd("newV", F->createMul("vScaled", beta2Splat, V),
+                   F->createMul("gSqScaled", oneMinusBeta2Splat, gijSq));
+  F->createSave("save.v", newV, V);
+
+  // Advance the beta powers for the bias corrections.
+  auto *newB1t = F->createMul("newBeta1t", B1t, beta1Splat);
+  F->createSave("save.beta1t", newB1t, B1t);
+  auto *newB2t = F->createMul("newBeta2t", B2t, beta2Splat);
+  F->createSave("save.beta2t", newB2t, B2t);
+
+  // w -= lr / (1 - beta1^t) * m / (sqrt(v) / sqrt(1 - beta2^t) + epsilon),
+  // the same shape as the fused instruction: the first-moment bias
+  // correction folds into the step size and the second-moment correction
+  // into the denominator scale.
+  auto *stepSize =
+      F->createDiv("stepSize", learningRateSplat,
+                   F->createSub("biasCorr1", oneSplat, newB1t));
+  auto *sqrtBiasCorr2 = F->createPow(
+      "sqrtBiasCorr2", F->createSub("biasCorr2", oneSplat, newB2t), 0.5f);
+  auto *sqrtV = F->createPow("sqrtV", newV, 0.5f);
+  auto *denom = F->createAdd(
+      "denom", F->createDiv("sqrtVCorr", sqrtV, sqrtBiasCorr2), epsilonSplat);
+  auto *dx =
+      F->createMul("dx", stepSize, F->createDiv("mOverDenom", newM, denom));
+  auto *newW = F->createSub("newW", W, dx);
+  A.getUpdatedWeight().replaceAllUsesOfWith(newW);
+}
+
+/// Expand an RMSProp update into elementwise nodes, for backends without
+/// the fused RMSProp instruction.
+void lowerRMSPropNode(Function *F, RMSPropNode &R) {
+  NodeValue W = R.getWeight();
+  NodeValue G = R.getGradient();
+
+  assert(W.dims() == G.dims() && "Invalid variables sizes for RMSPropNode");
+
+  // All computations here are within the same type.
+  auto type = G.getType();
+
+  NodeValue gij = regularizeGradient(F, W, G, R.getL1Decay(), R.getL2Decay(),
+                                     R.getBatchSize());
+
+  // The running mean of the squared gradient.
+  Variable *MS = F->getParent()->createVariable(
+      W->getType(0), "rmsprop.ms", VisibilityKind::Private,
+      Variable::TrainKind::Broadcast, 0);
+
+  float decay = R.getDecay();
+  auto *decaySplat = F->createSplat("decaySplat", type, decay);
+  auto *oneMinusDecaySplat =
+      F->createSplat("oneMinusDecaySplat", type, 1.0f - decay);
+  auto *epsilonSplat = F->createSplat("epsilonSplat", type, R.getEpsilon());
+  auto *learningRateSplat =
+      F->createSplat("learningRateSplat", type, R.getLearningRate());
+
+  // ms := decay * ms + (1 - decay) * gij^2.
+  auto *gijSq = F->createMul("gijSq", gij, gij);
+  auto *newMS =
+      F->createAdd("newMS", F->createMul("msScaled", decaySplat, MS),
+                   F->createMul("gSqScaled", oneMinusDecaySplat, gijSq));
+  F->createSave("save.ms", newMS, MS);
+
+  // w -= lr * gij / (sqrt(ms) + epsilon).
+  auto *sqrtMS = F->createPow("sqrtMS", newMS, 0.5f);
+  auto *denom = F->createAdd("denom", sqrtMS, epsilonSplat);
+  auto *dx = F->createDiv(
+      "dx", F->createMul("gijScaled", learningRateSplat, gij), denom);
+  auto *newW = F->createSub("newW", W, dx);
+  R.getUpdatedWeight().replaceAllUsesOfWith(newW);
+}
+
 void lowerBatchNormalizationNode(Function *F, BatchNormalizationNode &BN) {
   auto in = BN.getInput();
   auto out = BN.getResult();
@@ -576,12 +710,154 @@ void lowerGroupConvolutionNode(Function *F, ConvolutionNode &BNG) {
   BNG.getResult().replaceAllUsesOfWith(result);
 }
 
+void lowerLSTMCellNode(Function *F, LSTMCellNode &LC) {
+  // Expand the fused timestep: two wide GEMMs compute all of the gate
+  // pre-activations at once, and the gates are sliced out of the packed
+  // result for the elementwise math.
+  NodeValue in = LC.getInput();
+  NodeValue H = LC.getH();
+  NodeValue C = LC.getC();
+  size_t batch = H.dims()[0];
+  size_t hidden = H.dims()[1];
+
+  auto *xW = F->createMatMul("lstm.xw", in, LC.getWx());
+  auto *hW = F->createMatMul("lstm.hw", H, LC.getWh());
+  auto *sum = F->createAdd("lstm.gates", xW, hW);
+  auto *pre = F->createBatchedAdd("lstm.gates.bias", sum, LC.getBias());
+
+  auto gate = [&](size_t idx, const char *name) {
+    return F->createSlice(name, pre, {0, idx * hidden},
+                          {batch, (idx + 1) * hidden});
+  };
+  // The gates are packed in the order input, forget, cell, output.
+  auto *It = F->createSigmoid("lstm.i", gate(0, "lstm.i.pre"));
+  auto *Ft = F->createSigmoid("lstm.f", gate(1, "lstm.f.pre"));
+  auto *Gt = F->createTanh("lstm.g", gate(2, "lstm.g.pre"));
+  auto *Ot = F->createSigmoid("lstm.o", gate(3, "lstm.o.pre"));
+
+  auto *newC = F->createAdd("lstm.newc", F->createMul("lstm.fc", Ft, C),
+                            F->createMul("lstm.ig", It, Gt));
+  auto *newH =
+      F->createMul("lstm.newh", Ot, F->createTanh("lstm.tanhc", newC));
+
+  LC.getNewC().replaceAllUsesOfWith(newC);
+  LC.getNewH().replaceAllUsesOfWith(newH);
+}
+
+void lowerGRUCellNode(Function *F, GRUCellNode &GC) {
+  NodeValue in = GC.getInput();
+  NodeValue H = GC.getH();
+  size_t batch = H.dims()[0];
+  size_t hidden = H.dims()[1];
+
+  auto *xPre = F->createBatchedAdd(
+      "gru.x.bias", F->createMatMul("gru.xw", in, GC.getWx()), GC.getBx());
+  auto *hPre = F->createBatchedAdd(
+      "gru.h.bias", F->createMatMul("gru.hw", H, GC.getWh()), GC.getBh());
+
+  auto gate = [&](Node *pre, size_t idx, const char *name) {
+    return F->createSlice(name, pre, {0, idx * hidden},
+                          {batch, (idx + 1) * hidden});
+  };
+  // The gates are packed in the order update, reset, candidate.
+  auto *Zt = F->createSigmoid(
+      "gru.z", F->createAdd("gru.z.pre", gate(xPre, 0, "gru.xz"),
+                            gate(hPre, 0, "gru.hz")));
+  auto *Rt = F->createSigmoid(
+      "gru.r", F->createAdd("gru.r.pre", gate(xPre, 1, "gru.xr"),
+                            gate(hPre, 1, "gru.hr")));
+  // Linear before reset: the reset gate scales the recurrent pre-activation
+  // of the candidate after the matrix multiply.
+  auto *Ct = F->createTanh(
+      "gru.c",
+      F->createAdd("gru.c.pre", gate(xPre, 2, "gru.xc"),
+                   F->createMul("gru.rh", Rt, gate(hPre, 2, "gru.hc"))));
+
+  auto *ones = F->createSplat("gru.ones", H.getType(), 1.0);
+  auto *newH =
+      F->createAdd("gru.newh", F->createMul("gru.zh", Zt, H),
+                   F->createMul("gru.zc",
+                                F->createSub("gru.1-z", ones, Zt), Ct));
+
+  GC.getNewH().replaceAllUsesOfWith(newH);
+}
+
+/// \returns true if backend \p B reports support for the kind of \p node at
+/// the element type of each of its results.
+static bool isNodeSupported(const Backend &B, const Node *node) {
+  for (unsigned i = 0, e = node->getNumResults(); i < e; i++) {
+    if (!B.isOpSupported(node->getKind(),
+                         node->getNthResult(i).getElementType())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// The fallback expansion of a broadcast, for backends without a native
+/// broadcast kernel: a Tile (which is really an InsertTensor) in each
+/// direction that needs to be stretched.
+void lowerBroadcastNode(Function *F, BroadcastNode &BN) {
+  auto input = BN.getInput();
+  auto destDims = BN.getResult().dims();
+  auto name = BN.getName();
+
+  Node *currNode = input;
+  for (size_t i = 0, e = destDims.size(); i < e; i++) {
+    if (input.dims()[i] == 1 && destDims[i] != 1) {
+      currNode = F->createTile(name.str() + ".tile" + std::to_string(i),
+                               currNode, destDims[i], i);
+    }
+  }
+
+  BN.getResult().replaceAllUsesOfWith(currNode);
+}
+
+/// The fallback expansion of a batched matrix multiplication, for backends
+/// without a native batched kernel: multiply each pair of slices with a
+/// regular MatMul and stack the results back together.
+void lowerBatchMatMulNode(Function *F, BatchMatMulNode &BMM) {
+  auto name = BMM.getName();
+  auto lhs = BMM.getLHS();
+  auto rhs = BMM.getRHS();
+  size_t numBatches = lhs.dims()[0];
+  size_t A = lhs.dims()[1];
+  size_t Z = lhs.dims()[2];
+  size_t B = rhs.dims()[2];
+
+  std::vector<NodeValue> results;
+  results.reserve(numBatches);
+  for (size_t i = 0; i < numBatches; i++) {
+    auto *lhsSlice = F->createSlice(name.str() + ".lhs" + std::to_string(i),
+                                    lhs, {i, 0, 0}, {i + 1, A, Z});
+    auto *rhsSlice = F->createSlice(name.str() + ".rhs" + std::to_string(i),
+                                    rhs, {i, 0, 0}, {i + 1, Z, B});
+    auto *lhs2D = F->createReshape(name.str() + ".lhs2d" + std::to_string(i),
+                                   lhsSlice, {A, Z});
+    auto *rhs2D = F->createReshape(name.str() + ".rhs2d" + std::to_string(i),
+                                   rhsSlice, {Z, B});
+    auto *mul = F->createMatMul(name.str() + ".mul" + std::to_string(i),
+                                lhs2D, rhs2D);
+    results.push_back(F->createReshape(
+        name.str() + ".res" + std::to_string(i), mul, {1, A, B}));
+  }
+  auto *concat = F->createConcat(name, results, 0);
+
+  BMM.getResult().replaceAllUsesOfWith(concat);
+}
+
 void glow::lower(Function *F, const Backend &B) {
   auto &nodes = F->getNodes();
 
   for (auto &N : nodes) {
     auto *node = &N;
     if (!B.shouldLower(node)) {
+      // The backend executes this operator natively and wants it kept
+      // intact. A backend that skips the decomposition of an operator it
+      // cannot actually execute is a bug.
+      bool supported = isNodeSupported(B, node);
+      (void)supported;
+      assert(supported && "Backend kept a node it does not support");
       continue;
     }
     if (auto *RN = dyn_cast<RegressionNode>(node)) {
@@ -610,12 +886,24 @@ void glow::lower(Function *F, const Backend &B) {
       lowerSigmoidGradNode(F, *SG);
     } else if (auto *SGD = dyn_cast<SGDNode>(node)) {
       lowerSGDNode(F, *SGD);
+    } else if (auto *AD = dyn_cast<AdamNode>(node)) {
+      lowerAdamNode(F, *AD);
+    } else if (auto *RP = dyn_cast<RMSPropNode>(node)) {
+      lowerRMSPropNode(F, *RP);
     } else if (auto *BN = dyn_cast<BatchNormalizationNode>(node)) {
       lowerBatchNormalizationNode(F, *BN);
     } else if (auto *MVN = dyn_cast<MeanVarNormalizationNode>(node)) {
       lowerMeanVarNormalizationNode(F, *MVN);
     } else if (auto *BNG = dyn_cast<BatchNormalizationGradNode>(node)) {
       lowerBatchNormalizationGradNode(F, *BNG);
+    } else if (auto *LC = dyn_cast<LSTMCellNode>(node)) {
+      lowerLSTMCellNode(F, *LC);
+    } else if (auto *GC = dyn_cast<GRUCellNode>(node)) {
+      lowerGRUCellNode(F, *GC);
+    } else if (auto *BN = dyn_cast<BroadcastNode>(node)) {
+      lowerBroadcastNode(F, *BN);
+    } else if (auto *BMM = dyn_cast<BatchMatMulNode>(node)) {
+      lowerBatchMatMulNode(F, *BMM);
     } else if (auto *CN = dyn_cast<ConvolutionNode>(node)) {
       if (CN->getGroup() > 1)
         lowerGroupConvolutionNode(F, *CN);
@@ -632,7 +920,10 @@ void glow::lower(Function *F, const Backend &B) {
 
   for (auto it = F->getNodes().begin(), e = F->getNodes().end(); it != e;) {
     auto cur = &*(it++);
-    if (dyn_cast<SGDNode>(cur))
+    // Optimizer nodes that the backend executes natively are kept intact.
+    if ((llvm::isa<SGDNode>(cur) || llvm::isa<AdamNode>(cur) ||
+         llvm::isa<RMSPropNode>(cur)) &&
+        B.shouldLower(cur))
       F->eraseNode(cur);
   }
 }
@@ -19,10 +19,15 @@
 #include "glow/Graph/Graph.h"
 #include "glow/Graph/Utils.h"
 
+#include "glow/Graph/Nodes.h"
+
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/Casting.h"
 
+#include <vector>
+
 using namespace glow;
 using llvm::isa;
 
@@ -88,8 +93,7 @@ NodeFunctionMap selectBasicBlockPartitions(Function *F) {
 
   // Visit graph nodes in reverse post order so that a node's inputs are already
   // assigned to a partition before it is assigned.
-  GraphPostOrderVisitor visitor(*F);
-  for (auto *node : visitor.getPostOrder()) {
+  for (auto *node : F->getPostOrder()) {
     if (isa<Variable>(node))
       continue;
 
@@ -112,6 +116,273 @@ NodeFunctionMap selectBasicBlockPartitions(Function *F) {
   return mapping;
 }
 
+/// Estimated cost of executing a node: arithmetic work and memory traffic.
+struct NodeCost {
+  /// Floating point operations performed by the node.
+  uint64_t flops;
+  /// Bytes read and written by the node.
+  uint64_t bytes;
+
+  /// \returns the cost folded into one comparable number. Memory traffic is
+  /// weighted the same as arithmetic, which treats bandwidth-bound
+  /// elementwise nodes and compute-bound matrix nodes evenly.
+  uint64_t scalar() const { return flops + bytes; }
+};
+
+/// \returns a cost estimate for \p node, derived from the shapes of its
+/// operands: FLOPs for the matrix and convolution nodes that dominate
+/// compute, the number of output elements for everything else, and the bytes
+/// moved through all inputs and results.
+NodeCost estimateNodeCost(Node *node) {
+  NodeCost cost{0, 0};
+  for (unsigned i = 0, e = node->getNumInputs(); i < e; i++) {
+    cost.bytes += node->getNthInput(i).getType()->getSizeInBytes();
+  }
+  for (unsigned r = 0, e = node->getNumResults(); r < e; r++) {
+    cost.bytes += node->getNthResult(r).getType()->getSizeInBytes();
+  }
+
+  switch (node->getKind()) {
+  case Kinded::Kind::MatMulNodeKind: {
+    auto *MM = llvm::cast<MatMulNode>(node);
+    auto lhsDims = MM->getLHS().dims();
+    // A (m x k) * (k x n) matmul performs m*n*k multiply-accumulates.
+    cost.flops = 2 * uint64_t(MM->getResult().getType()->size()) *
+                 lhsDims[lhsDims.size() - 1];
+    break;
+  }
+  case Kinded::Kind::ConvolutionNodeKind: {
+    auto *CN = llvm::cast<ConvolutionNode>(node);
+    auto idim = CN->getInput().dims();
+    uint64_t kernelOps =
+        uint64_t(CN->getKernel()) * CN->getKernel() * idim[3];
+    cost.flops = 2 * uint64_t(CN->getResult().getType()->size()) * kernelOps;
+    break;
+  }
+  default:
+    // Assume one operation per output element.
+    for (unsigned r = 0, e = node->getNumResults(); r < e; r++) {
+      cost.flops += node->getNthResult(r).getType()->size();
+    }
+    break;
+  }
+  return cost;
+}
+
+/// \returns the total size in bytes of all the results of \p node.
+uint64_t nodeResultBytes(Node *node) {
+  uint64_t bytes = 0;
+  for (unsigned r = 0, e = node->getNumResults(); r < e; r++) {
+    bytes += node->getNthResult(r).getType()->getSizeInBytes();
+  }
+  return bytes;
+}
+
+/// Computes a linear liveness over the dependency-ordered nodes \p order,
+/// with \p position giving each node's index. \returns for every position
+/// \p i the number of bytes of results that are defined at or before \p i
+/// and used after \p i. This mirrors, at the granularity of graph nodes, the
+/// activation live intervals the IR optimizer computes over instructions.
+std::vector<uint64_t>
+computeCrossingBytes(const std::vector<Node *> &order,
+                     llvm::DenseMap<Node *, size_t> &position) {
+  std::vector<uint64_t> crossing(order.size());
+  std::vector<uint64_t> lastUse(order.size());
+  for (size_t i = 0, e = order.size(); i < e; i++) {
+    lastUse[i] = i;
+    for (auto &U : order[i]->getUsers()) {
+      auto it = position.find(U.getUser());
+      if (it != position.end()) {
+        lastUse[i] = std::max(lastUse[i], uint64_t(it->second));
+      }
+    }
+  }
+  uint64_t live = 0;
+  for (size_t i = 0, e = order.size(); i < e; i++) {
+    if (lastUse[i] > i) {
+      live += nodeResultBytes(order[i]);
+    }
+    // Retire the values whose last use is this node.
+    for (unsigned in = 0, ie = order[i]->getNumInputs(); in < ie; in++) {
+      Node *producer = order[i]->getNthInput(in).getNode();
+      auto it = position.find(producer);
+      if (it == position.end() || lastUse[it->second] != i) {
+        continue;
+      }
+      live -= std::min(live, nodeResultBytes(producer));
+      // Mark as retired so that a second input from the same producer does
+      // not retire it twice.
+      lastUse[it->second] = it->second;
+    }
+    crossing[i] = live;
+  }
+  return crossing;
+}
+
+/// Assign nodes to \p numPartitions partitions of roughly equal cost.
+/// The post-order linearization places every producer before its consumers,
+/// so cutting it into contiguous segments always yields an acyclic partition
+/// graph. The cut between two segments is placed, within a tolerance around
+/// the balanced cost target, at the point where the fewest bytes are live
+/// across the boundary, since every crossing value becomes a Variable that
+/// has to travel between devices.
+NodeFunctionMap selectCostBalancedPartitions(Function *F,
+                                             unsigned numPartitions) {
+  assert(numPartitions > 0 && "Invalid number of partitions");
+  NodeFunctionMap mapping;
+
+  // Linearize the computation in dependency order.
+  std::vector<Node *> order;
+  for (auto *node : F->getPostOrder()) {
+    if (!isa<Variable>(node)) {
+      order.push_back(node);
+    }
+  }
+  if (order.empty()) {
+    return mapping;
+  }
+  // Every partition needs at least one node, so more partitions than nodes
+  // cannot be honored; the excess would also underflow the boundary
+  // arithmetic below.
+  if (numPartitions > order.size()) {
+    numPartitions = order.size();
+  }
+
+  // Per-node scalar costs and the total.
+  std::vector<uint64_t> costs(order.size());
+  uint64_t totalCost = 0;
+  llvm::DenseMap<Node *, size_t> position;
+  for (size_t i = 0, e = order.size(); i < e; i++) {
+    costs[i] = estimateNodeCost(order[i]).scalar();
+    totalCost += costs[i];
+    position[order[i]] = i;
+  }
+
+  // The bytes that are live across the cut after each position.
+  std::vector<uint64_t> crossing = computeCrossingBytes(order, position);
+
+  // Cut the linearization into segments. Each segment accumulates cost until
+  // the balanced target, then extends by up to 25% if a cheaper boundary
+  // (fewer crossing bytes) shows up.
+  uint64_t target = std::max<uint64_t>(totalCost / numPartitions, 1);
+  size_t begin = 0;
+  for (unsigned p = 0; p < numPartitions && begin < order.size(); p++) {
+    size_t end = begin;
+    uint64_t acc = 0;
+    // The remaining partitions need at least one node each.
+    size_t lastAllowed = order.size() - (numPartitions - p - 1) - 1;
+    if (p + 1 == numPartitions) {
+      end = order.size() - 1;
+    } else {
+      while (end < lastAllowed && acc + costs[end] < target) {
+        acc += costs[end++];
+      }
+      // Look ahead for a cheaper boundary within the tolerance.
+      size_t best = end;
+      uint64_t lookahead = acc;
+      for (size_t j = end; j < lastAllowed; j++) {
+        lookahead += costs[j];
+        if (lookahead > target + target / 4) {
+          break;
+        }
+        if (crossing[j] < crossing[best]) {
+          best = j;
+        }
+      }
+      end = best;
+    }
+
+    auto *newF = F->getParent()->createFunction(
+        std::string(F->getName()) + "_part" + std::to_string(mapping.size()));
+    mapping.create(order[begin], newF);
+    for (size_t i = begin + 1; i <= end; i++) {
+      mapping.add(order[i], newF);
+    }
+    begin = end + 1;
+  }
+  return mapping;
+}
+
+/// Assign nodes to as few partitions as possible such that the estimated
+/// peak memory footprint of every partition - live activation bytes from the
+/// linear liveness, the working set of the node itself, and the weights the
+/// partition touches - stays within \p budgetBytes. A single node whose
+/// footprint alone exceeds the budget still gets its own partition, since a
+/// node cannot be split.
+NodeFunctionMap selectMemoryBudgetPartitions(Function *F,
+                                             uint64_t budgetBytes) {
+  NodeFunctionMap mapping;
+
+  std::vector<Node *> order;
+  for (auto *node : F->getPostOrder()) {
+    if (!isa<Variable>(node)) {
+      order.push_back(node);
+    }
+  }
+  if (order.empty()) {
+    return mapping;
+  }
+  llvm::DenseMap<Node *, size_t> position;
+  for (size_t i = 0, e = order.size(); i < e; i++) {
+    position[order[i]] = i;
+  }
+  std::vector<uint64_t> crossing = computeCrossingBytes(order, position);
+
+  Function *currF = nullptr;
+  uint64_t weightBytes = 0;
+  uint64_t peakActivationBytes = 0;
+  llvm::DenseSet<Variable *> countedWeights;
+
+  for (size_t i = 0, e = order.size(); i < e; i++) {
+    Node *node = order[i];
+
+    // The activation footprint while this node executes: everything live
+    // across this position plus the node's own inputs and results.
+    uint64_t workingSet = crossing[i] + nodeResultBytes(node);
+    uint64_t newWeightBytes = 0;
+    llvm::SmallVector<Variable *, 4> nodeWeights;
+    for (unsigned in = 0, ie = node->getNumInputs(); in < ie; in++) {
+      Node *producer = node->getNthInput(in).getNode();
+      if (auto *V = llvm::dyn_cast<Variable>(producer)) {
+        nodeWeights.push_back(V);
+        if (!countedWeights.count(V)) {
+          newWeightBytes += V->getType()->getSizeInBytes();
+        }
+      } else {
+        workingSet += node->getNthInput(in).getType()->getSizeInBytes();
+      }
+    }
+
+    uint64_t newPeak = std::max(peakActivationBytes, workingSet);
+    bool fits =
+        currF && newPeak + weightBytes + newWeightBytes <= budgetBytes;
+    if (!fits) {
+      // Open a new partition for this node.
+      currF = F->getParent()->createFunction(
+          std::string(F->getName()) + "_part" + std::to_string(mapping.size()));
+      mapping.create(node, currF);
+      weightBytes = 0;
+      peakActivationBytes = workingSet;
+      countedWeights.clear();
+      newWeightBytes = 0;
+      for (auto *V : nodeWeights) {
+        if (countedWeights.insert(V).second) {
+          weightBytes += V->getType()->getSizeInBytes();
+        }
+      }
+      continue;
+    }
+
+    mapping.add(node, currF);
+    peakActivationBytes = newPeak;
+    weightBytes += newWeightBytes;
+    for (auto *V : nodeWeights) {
+      countedWeights.insert(V);
+    }
+  }
+  return mapping;
+}
+
 /// Given a function \p F and partitioning \p mapping, \return a FunctionDAG
 /// that contains appropriately-partitioned functions and their dependences.
 FunctionDAG doPartitioning(Function *F, NodeFunctionMap &mapping) {
@@ -126,9 +397,16 @@ FunctionDAG doPartitioning(Function *F, NodeFunctionMap &mapping) {
     mapping[&N]->addNode(clone);
   }
 
-  // For any dependency that crosses a partition, add a variable and save
-  // node. Record the dependence in the function graph.
-  llvm::DenseMap<Node *, Variable *> variables;
+  // For any dependency that crosses a partition, add a pair of variables:
+  // the producer saves into the "out" side and the consumer reads the "in"
+  // side. The executor of the DAG copies between the two; keeping the sides
+  // distinct lets a pipelined executor overlap the producer's next batch
+  // with the consumer's current one. The variables are public so that they
+  // are not folded into constants, which would freeze the value of the
+  // first batch into the consumer. Record the dependence and the boundary
+  // in the function graph.
+  llvm::DenseMap<Node *, Variable *> outVariables;
+  llvm::DenseMap<std::pair<Node *, Function *>, Variable *> inVariables;
   for (auto *F : mapping.getFunctions()) {
     for (auto &N : F->getNodes()) {
       for (unsigned inp = 0, e = N.getNumInputs(); inp < e; inp++) {
@@ -143,20 +421,34 @@ FunctionDAG doPartitioning(Function *F, NodeFunctionMap &mapping) {
         // Add this dependence to the FunctionDAG.
         G.add(F, inputF);
 
-        // If we've already created a variable for this dependence, use it.
-        auto it = variables.find(input.getNode());
-        if (it != variables.end()) {
-          N.setNthInput(inp, it->second);
-          continue;
+        // Create (or reuse) the variable that the producer saves into.
+        Variable *outV;
+        auto oit = outVariables.find(input.getNode());
+        if (oit != outVariables.end()) {
+          outV = oit->second;
+        } else {
+          outV = mod->createVariable(
+              input.getType(), std::string(input->getName()) + "_out",
+              VisibilityKind::Public, Variable::TrainKind::None);
+          inputF->createSave("tmp", input, outV);
+          outVariables[input.getNode()] = outV;
         }
 
-        // Create a new variable to represent this dependence.
-        auto *tmp = mod->createVariable(
-            input.getType(), std::string(input->getName()) + "_tmp",
-            VisibilityKind::Private, Variable::TrainKind::None);
-        inputF->createSave("tmp", input, tmp);
-        variables[input.getNode()] = tmp;
-        N.setNthInput(inp, tmp);
+        // Create (or reuse) the variable that this partition reads, and
+        // record the boundary.
+        Variable *inV;
+        auto key = std::make_pair(input.getNode(), F);
+        auto iit = inVariables.find(key);
+        if (iit != inVariables.end()) {
+          inV = iit->second;
+        } else {
+          inV = mod->createVariable(
+              input.getType(), std::string(input->getName()) + "_in",
+              VisibilityKind::Public, Variable::TrainKind::None);
+          inVariables[key] = inV;
+          G.addBoundary(inputF, F, outV, inV);
+        }
+        N.setNthInput(inp, inV);
       }
     }
   }
@@ -208,3 +500,17 @@ FunctionDAG glow::partition(Function *F) {
   assert(G.verify());
   return G;
 }
+
+FunctionDAG glow::partition(Function *F, unsigned numPartitions) {
+  NodeFunctionMap partitionMap = selectCostBalancedPartitions(F, numPartitions);
+  auto G = doPartitioning(F, partitionMap);
+  assert(G.verify());
+  return G;
+}
+
+FunctionDAG glow::partitionByMemoryBudget(Function *F, uint64_t budgetBytes) {
+  NodeFunctionMap partitionMap = selectMemoryBudgetPartitions(F, budgetBytes);
+  auto G = doPartitioning(F, partitionMap);
+  assert(G.verify());
+  return G;
+}
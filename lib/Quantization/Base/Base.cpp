@@ -21,13 +21,26 @@
 namespace glow {
 namespace quantization {
 
-int8_t quantize(float input, const TensorQuantizationParams &TQP) {
-  float result = input / TQP.scale + TQP.offset;
-  return quantization::clip<int32_t, int8_t>((int32_t)nearbyintf(result));
+void quantizeBulk(int8_t *dest, const float *src, size_t count,
+                  const TensorQuantizationParams &TQP) {
+  // Hoist the division out of the loop and keep the body down to a
+  // multiply, a round and a clip, which the compiler turns into vector
+  // float-to-int conversion and pack instructions.
+  float invScale = 1.0f / TQP.scale;
+  float offset = (float)TQP.offset;
+  for (size_t i = 0; i < count; i++) {
+    int32_t result = (int32_t)nearbyintf(src[i] * invScale + offset);
+    dest[i] = quantization::clip<int32_t, int8_t>(result);
+  }
 }
 
-float dequantize(int8_t input, const TensorQuantizationParams &TQP) {
-  return TQP.scale * (input - TQP.offset);
+void dequantizeBulk(float *dest, const int8_t *src, size_t count,
+                    const TensorQuantizationParams &TQP) {
+  float scale = TQP.scale;
+  int32_t offset = TQP.offset;
+  for (size_t i = 0; i < count; i++) {
+    dest[i] = scale * (src[i] - offset);
+  }
 }
 
 QuantizationTransform32To8 quantizeScaleOffset32To8(float scale,
@@ -137,12 +150,15 @@ QuantizationTransform32To8 quantizeScaleOffset32To8(float scale,
 }
 
 TensorQuantizationParams chooseQuantizationParams(float min, float max,
-                                                  Schema schema) {
+                                                  Schema schema,
+                                                  unsigned precision) {
   assert(min <= max && "min must not be bigger than max");
+  assert(precision >= 2 && precision <= 16 && "Invalid precision");
 
-  // Given 8 bit precision.
-  const int32_t qmin = std::numeric_limits<int8_t>::min();
-  const int32_t qmax = std::numeric_limits<int8_t>::max();
+  // The representable range of a signed integer with the given number of
+  // bits.
+  const int32_t qmin = -(1 << (precision - 1));
+  const int32_t qmax = (1 << (precision - 1)) - 1;
 
   // We extend the [min, max] interval to ensure that it contains 0.
   // Otherwise, we would not meet the requirement that 0 be an exactly
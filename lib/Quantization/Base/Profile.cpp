@@ -33,12 +33,69 @@ static size_t getBin(size_t nBins, float binWidth, float minValue,
   return result;
 }
 
+/// Rescale the histogram \p existingHistogram, which spans the value range
+/// [\p min, \p max], so that it spans [\p newMin, \p newMax] with the same
+/// number of bins. The new range must contain the old one, so every source
+/// bin overlaps at most two destination bins.
+static void rescaleHistogram(Handle<float> existingHistogram, float min,
+                             float max, float newMin, float newMax) {
+  size_t nBins = existingHistogram.size();
+
+  float destBinWidth = (newMax - newMin) / nBins;
+  float srcBinWidth = (max - min) / nBins;
+
+  std::vector<float> scaledHistogram(nBins);
+
+  for (size_t i = 0; i < nBins; ++i) {
+    if (existingHistogram.raw(i) == 0)
+      continue;
+
+    float srcBinBegin = min + srcBinWidth * i;
+    size_t destBin = (srcBinBegin - newMin) / destBinWidth;
+    float destBinEnd = newMin + destBinWidth * (destBin + 1);
+
+    float srcBinEnd = srcBinBegin + srcBinWidth;
+    size_t destBinToVerify = (srcBinEnd - newMin) / destBinWidth;
+    // Make sure that destination bin is mapped at most to 2 final bins, based
+    // on that redistribute percentage is calculated.
+    assert(destBinToVerify <= destBin + 2);
+    (void)destBinToVerify;
+
+    // Calculate how much we need to redistribute.
+    uint64_t dstBinCnt = static_cast<uint64_t>(std::min(
+        static_cast<float>(round((destBinEnd - srcBinBegin) / srcBinWidth *
+                                 existingHistogram.raw(i))),
+        existingHistogram.raw(i)));
+
+    size_t newBin = getBin(nBins, destBinWidth, newMin, srcBinBegin);
+    scaledHistogram[newBin] += dstBinCnt;
+
+    if (dstBinCnt < existingHistogram.raw(i)) {
+      size_t newBin =
+          getBin(nBins, destBinWidth, newMin, srcBinBegin + destBinWidth);
+      scaledHistogram[newBin] += existingHistogram.raw(i) - dstBinCnt;
+    }
+  }
+
+  // Copy scaled histogram back to the existing histogram.
+  for (size_t i = 0, e = scaledHistogram.size(); i < e; ++i) {
+    existingHistogram.raw(i) = scaledHistogram[i];
+  }
+}
+
 void generateTensorHistogram(const Handle<float> inputTensor,
                              Handle<float> existingHistogram, float &min,
-                             float &max) {
-  auto minMaxPos = inputTensor.minMaxArg();
-  float minInput = inputTensor.raw(minMaxPos.first);
-  float maxInput = inputTensor.raw(minMaxPos.second);
+                             float &max, size_t sampleStride) {
+  assert(sampleStride > 0 && "Sample stride must be positive");
+  // Scan only the sampled elements for the range. Strides above one may miss
+  // an outlier in this tensor, but across a calibration run the sampled
+  // extrema converge to the true ones.
+  float minInput = inputTensor.raw(0);
+  float maxInput = inputTensor.raw(0);
+  for (size_t i = 0, e = inputTensor.size(); i < e; i += sampleStride) {
+    minInput = std::min(minInput, inputTensor.raw(i));
+    maxInput = std::max(maxInput, inputTensor.raw(i));
+  }
 
   if (existingHistogram.isZero()) {
     min = minInput;
@@ -52,46 +109,7 @@ void generateTensorHistogram(const Handle<float> inputTensor,
     float newMin = std::min(minInput, min);
     float newMax = std::max(maxInput, max);
 
-    float destBinWidth = (newMax - newMin) / nBins;
-    float srcBinWidth = (max - min) / nBins;
-
-    std::vector<float> scaledHistogram(nBins);
-
-    for (size_t i = 0; i < nBins; ++i) {
-      if (existingHistogram.raw(i) == 0)
-        continue;
-
-      float srcBinBegin = min + srcBinWidth * i;
-      size_t destBin = (srcBinBegin - newMin) / destBinWidth;
-      float destBinEnd = newMin + destBinWidth * (destBin + 1);
-
-      float srcBinEnd = srcBinBegin + srcBinWidth;
-      size_t destBinToVerify = (srcBinEnd - newMin) / destBinWidth;
-      // Make sure that destination bin is mapped at most to 2 final bins, based
-      // on that redistribute percentage is calculated.
-      assert(destBinToVerify <= destBin + 2);
-      (void)destBinToVerify;
-
-      // Calculate how much we need to redistribute.
-      uint64_t dstBinCnt = static_cast<uint64_t>(std::min(
-          static_cast<float>(round((destBinEnd - srcBinBegin) / srcBinWidth *
-                                   existingHistogram.raw(i))),
-          existingHistogram.raw(i)));
-
-      size_t newBin = getBin(nBins, destBinWidth, newMin, srcBinBegin);
-      scaledHistogram[newBin] += dstBinCnt;
-
-      if (dstBinCnt < existingHistogram.raw(i)) {
-        size_t newBin =
-            getBin(nBins, destBinWidth, newMin, srcBinBegin + destBinWidth);
-        scaledHistogram[newBin] += existingHistogram.raw(i) - dstBinCnt;
-      }
-    }
-
-    // Copy scaled histogram back to the existing histogram.
-    for (size_t i = 0, e = scaledHistogram.size(); i < e; ++i) {
-      existingHistogram.raw(i) = scaledHistogram[i];
-    }
+    rescaleHistogram(existingHistogram, min, max, newMin, newMax);
 
     // Update global min and max.
     min = newMin;
@@ -99,11 +117,59 @@ void generateTensorHistogram(const Handle<float> inputTensor,
   }
 
   float binWidth = (max - min) / nBins;
-  for (size_t i = 0, e = inputTensor.size(); i < e; ++i) {
+  for (size_t i = 0, e = inputTensor.size(); i < e; i += sampleStride) {
     size_t newBin = getBin(nBins, binWidth, min, inputTensor.raw(i));
     existingHistogram.raw(newBin)++;
   }
 }
 
+void mergeTensorHistogram(Handle<float> destHistogram,
+                          const Handle<float> srcHistogram, float &destMin,
+                          float &destMax, float srcMin, float srcMax) {
+  size_t nBins = destHistogram.size();
+  assert(srcHistogram.size() == nBins &&
+         "Histograms must have the same number of bins");
+
+  // A source that observed nothing contributes nothing, and its min/max are
+  // uninitialized.
+  if (srcHistogram.isZero()) {
+    return;
+  }
+
+  // An empty destination simply adopts the source profile.
+  if (destHistogram.isZero()) {
+    for (size_t i = 0; i < nBins; ++i) {
+      destHistogram.raw(i) = srcHistogram.raw(i);
+    }
+    destMin = srcMin;
+    destMax = srcMax;
+    return;
+  }
+
+  float newMin = std::min(destMin, srcMin);
+  float newMax = std::max(destMax, srcMax);
+
+  // Rescale both histograms to the union of the two ranges, then add the
+  // source counts into the destination.
+  if (newMin < destMin || newMax > destMax) {
+    rescaleHistogram(destHistogram, destMin, destMax, newMin, newMax);
+  }
+
+  Tensor scaledSrc(ElemKind::FloatTy, {nBins});
+  auto scaledSrcH = scaledSrc.getHandle<float>();
+  for (size_t i = 0; i < nBins; ++i) {
+    scaledSrcH.raw(i) = srcHistogram.raw(i);
+  }
+  if (newMin < srcMin || newMax > srcMax) {
+    rescaleHistogram(scaledSrcH, srcMin, srcMax, newMin, newMax);
+  }
+  for (size_t i = 0; i < nBins; ++i) {
+    destHistogram.raw(i) += scaledSrcH.raw(i);
+  }
+
+  destMin = newMin;
+  destMax = newMax;
+}
+
 } // namespace quantization
 } // namespace glow
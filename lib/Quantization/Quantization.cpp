@@ -18,11 +18,36 @@
 
 #include "glow/ExecutionEngine/ExecutionEngine.h"
 
+#include "llvm/Support/CommandLine.h"
+
 #include <cmath>
+#include <limits>
 #include <unordered_set>
 #include <vector>
 
 using llvm::cast;
+using llvm::dyn_cast;
+
+static llvm::cl::opt<bool> enableChannelwise(
+    "quantization-per-channel",
+    llvm::cl::desc("Quantize the weights of Convolution and FullyConnected "
+                   "nodes with one scale/offset per output channel instead "
+                   "of one pair for the whole tensor"),
+    llvm::cl::init(false));
+
+static llvm::cl::opt<glow::ElemKind> quantizationPrecision(
+    "quantization-precision",
+    llvm::cl::desc("The integer representation that quantized tensors use"),
+    llvm::cl::values(
+        clEnumValN(glow::ElemKind::Int8QTy, "i8", "8-bit quantization"),
+        clEnumValN(glow::ElemKind::Int16QTy, "i16", "16-bit quantization")),
+    llvm::cl::init(glow::ElemKind::Int8QTy));
+
+/// \returns the number of bits of the integer representation selected by
+/// -quantization-precision.
+static unsigned quantizationNumBits() {
+  return quantizationPrecision == glow::ElemKind::Int16QTy ? 16 : 8;
+}
 
 namespace glow {
 namespace quantization {
@@ -46,7 +71,8 @@ generateNodeQuantizationInfos(const Function *F, Schema schema) {
       // TODO: Ideally tensor quantization params should be calculated
       // based on the histogram distribution. Use simplistic approach for now.
       (void)histogram;
-      TensorQuantizationParams TQP = chooseQuantizationParams(min, max, schema);
+      TensorQuantizationParams TQP =
+          chooseQuantizationParams(min, max, schema, quantizationNumBits());
 
       quantizationInfos.emplace_back(fullOutputName, TQP);
     }
@@ -55,6 +81,50 @@ generateNodeQuantizationInfos(const Function *F, Schema schema) {
   return quantizationInfos;
 }
 
+/// \returns the quantized weight type \p QT extended with one scale/offset
+/// pair per channel along dimension \p axis, computed from the payload of
+/// the weight variable \p V. Unlike activations, weights are known at
+/// compile time, so their per-channel ranges come straight from the data
+/// instead of the profile.
+static Type channelwiseWeightType(const Type &QT, Variable *V, unsigned axis) {
+  auto H = V->getPayload().getHandle<float>();
+  size_t numChannels = V->getType()->dims()[axis];
+  // The number of consecutive elements that share one channel index.
+  size_t chunk = V->getType()->getSliceSize(axis + 1);
+
+  std::vector<float> mins(numChannels, std::numeric_limits<float>::max());
+  std::vector<float> maxes(numChannels, std::numeric_limits<float>::lowest());
+  for (size_t i = 0, e = H.size(); i < e; i++) {
+    size_t c = (i / chunk) % numChannels;
+    mins[c] = std::min(mins[c], H.raw(i));
+    maxes[c] = std::max(maxes[c], H.raw(i));
+  }
+
+  std::vector<float> scales(numChannels);
+  std::vector<int32_t> offsets(numChannels);
+  for (size_t c = 0; c < numChannels; c++) {
+    TensorQuantizationParams TQP = chooseQuantizationParams(mins[c], maxes[c]);
+    scales[c] = TQP.scale;
+    offsets[c] = TQP.offset;
+  }
+  return Type::newChannelwise(QT, scales, offsets, axis);
+}
+
+/// \returns the channel axis of input number \p idx of \p node when that
+/// input is a weight tensor that should be quantized channelwise, or -1
+/// otherwise. Convolution filters are [outC, kh, kw, inC] and
+/// fully-connected weights are [in, out].
+static int channelwiseWeightAxis(const Node *node, unsigned idx) {
+  switch (node->getKind()) {
+  case Kinded::Kind::ConvolutionNodeKind:
+    return idx == 1 ? 0 : -1;
+  case Kinded::Kind::FullyConnectedNodeKind:
+    return idx == 1 ? 1 : -1;
+  default:
+    return -1;
+  }
+}
+
 /// Quantize all inputs for \p node and return back pointers to the newly
 /// created qunatization nodes.
 static llvm::SmallVector<NodeValue, 6>
@@ -78,9 +148,22 @@ quantizeInputs(Function *F, Node *node,
 
     const TensorQuantizationParams &TQP =
         nodeToTQP.find(nodeOutputName)->second;
-    auto QT = F->getParent()->uniqueType(ElemKind::Int8QTy, NV.dims(),
+    auto QT = F->getParent()->uniqueType(quantizationPrecision, NV.dims(),
                                          TQP.scale, TQP.offset);
 
+    // Weight tensors get one scale/offset per output channel when enabled:
+    // a single per-tensor scale wastes most of the int8 range on
+    // depthwise-style filters whose channels have very different
+    // magnitudes. The channelwise kernels operate on int8, so the option
+    // does not apply to the other precisions.
+    int axis = channelwiseWeightAxis(node, i);
+    if (enableChannelwise && quantizationPrecision == ElemKind::Int8QTy &&
+        axis >= 0) {
+      if (auto *V = dyn_cast<Variable>(NV.getNode())) {
+        QT = F->getParent()->uniqueType(channelwiseWeightType(*QT, V, axis));
+      }
+    }
+
     Node *quantizeNode = F->createQuantize("quantize", NV, QT);
     quantizedInputs.push_back(quantizeNode);
   }
@@ -99,6 +182,10 @@ static bool canBeQuantized(const Node *node) {
     auto *gather = cast<GatherNode>(node);
     return gather->getData().getElementType() == ElemKind::FloatTy;
   }
+  case Kinded::Kind::ScatterAssignNodeKind: {
+    auto *SA = cast<ScatterAssignNode>(node);
+    return SA->getData().getElementType() == ElemKind::FloatTy;
+  }
   default:
     // Let the general procedure handle this node kind.
     break;
@@ -123,6 +210,24 @@ static bool canBeQuantized(const Node *node) {
 /// \param quantizedInputs Array of already quantized inputs to the result node.
 /// \param qParams Tensor quantization parameters for all outputs of the
 ///        \p node.
+/// Builds the 256-entry int8 to int8 mapping that applies the scalar
+/// function \p f to every value representable by the quantized input type
+/// \p inTy and requantizes the result with \p outParams. Quantized unary ops
+/// are lowered into IntLookupTable nodes with such a mapping, collapsing the
+/// whole op into a table gather.
+template <typename FunTy>
+static std::vector<int8_t>
+createMappingForUnaryOp(TypeRef inTy, const TensorQuantizationParams &outParams,
+                        FunTy f) {
+  TensorQuantizationParams inParams{inTy->getScale(), inTy->getOffset()};
+  std::vector<int8_t> mapping(256);
+  for (size_t i = 0; i < 256; i++) {
+    float x = quantization::dequantize(static_cast<int8_t>(i - 128), inParams);
+    mapping[i] = quantization::quantize(f(x), outParams);
+  }
+  return mapping;
+}
+
 static Node *quantizeNode(Function *F, Node *node,
                           llvm::MutableArrayRef<NodeValue> quantizedInputs,
                           llvm::ArrayRef<TensorQuantizationParams> qParams) {
@@ -134,7 +239,7 @@ static Node *quantizeNode(Function *F, Node *node,
     assert(quantizedInputs.size() == 3 && "Invalid number of inputs");
     assert(qParams.size() == 1 && "Invalid number of quantized outputs");
     auto QT =
-        F->getParent()->uniqueType(ElemKind::Int8QTy, FC->getResult().dims(),
+        F->getParent()->uniqueType(quantizationPrecision, FC->getResult().dims(),
                                    qParams[0].scale, qParams[0].offset);
     quantizedNode =
         F->createFullyConnected(FC->getName(), quantizedInputs[0],
@@ -147,7 +252,7 @@ static Node *quantizeNode(Function *F, Node *node,
     assert(quantizedInputs.size() == 3 && "Invalid number of inputs");
     assert(qParams.size() == 1 && "Invalid number of quantized outputs");
     auto QT =
-        F->getParent()->uniqueType(ElemKind::Int8QTy, CV->getResult().dims(),
+        F->getParent()->uniqueType(quantizationPrecision, CV->getResult().dims(),
                                    qParams[0].scale, qParams[0].offset);
     quantizedNode =
         F->createConv(CV->getName(), quantizedInputs[0], quantizedInputs[1],
@@ -161,7 +266,7 @@ static Node *quantizeNode(Function *F, Node *node,
     assert(qParams.size() == 1 && "Invalid number of quantized outputs");
 
     auto QT =
-        F->getParent()->uniqueType(ElemKind::Int8QTy, S->getResult().dims(),
+        F->getParent()->uniqueType(quantizationPrecision, S->getResult().dims(),
                                    quantizedInputs[0].getType()->getScale(),
                                    quantizedInputs[0].getType()->getOffset());
 
@@ -185,6 +290,17 @@ static Node *quantizeNode(Function *F, Node *node,
         F->createTranspose(T->getName(), quantizedInputs[0], T->getShuffle());
     break;
   }
+  case Kinded::Kind::BroadcastNodeKind: {
+    auto *B = cast<BroadcastNode>(node);
+    assert(quantizedInputs.size() == 1 && "Invalid number of inputs");
+    assert(qParams.size() == 1 && "Invalid number of quantized outputs");
+    // The input of a broadcast already has the rank of the result, so the
+    // rebuilt broadcast needs no extra axis alignment.
+    quantizedNode =
+        F->createBroadcast(B->getName(), quantizedInputs[0],
+                           B->getResult().dims(), /* axis */ 0);
+    break;
+  }
   case Kinded::Kind::ReshapeNodeKind: {
     auto *R = cast<ReshapeNode>(node);
     assert(quantizedInputs.size() == 1 && "Invalid number of inputs");
@@ -219,7 +335,7 @@ static Node *quantizeNode(Function *F, Node *node,
     assert(quantizedInputs.size() == 2 && "Invalid number of inputs");         \
     assert(qParams.size() == 1 && "Invalid number of quantized outputs");      \
     auto outTy =                                                               \
-        F->getParent()->uniqueType(ElemKind::Int8QTy, AN->getResult().dims(),  \
+        F->getParent()->uniqueType(quantizationPrecision, AN->getResult().dims(),  \
                                    qParams[0].scale, qParams[0].offset);     \
     quantizedNode = F->create##NODE_NAME_(                                     \
         AN->getName(), outTy, quantizedInputs[0], quantizedInputs[1]);         \
@@ -240,7 +356,7 @@ static Node *quantizeNode(Function *F, Node *node,
     // same {S,O} params.
     for (size_t qi = 0, e = quantizedInputs.size(); qi < e; qi++) {
       auto argOutTy = F->getParent()->uniqueType(
-          ElemKind::Int8QTy, quantizedInputs[qi].dims(), qParams[0].scale,
+          quantizationPrecision, quantizedInputs[qi].dims(), qParams[0].scale,
           qParams[0].offset);
 
       quantizedInputs[qi] = F->createRescaleQuantized(
@@ -248,7 +364,7 @@ static Node *quantizeNode(Function *F, Node *node,
     }
 
     auto outTy =
-        F->getParent()->uniqueType(ElemKind::Int8QTy, C->getResult().dims(),
+        F->getParent()->uniqueType(quantizationPrecision, C->getResult().dims(),
                                    qParams[0].scale, qParams[0].offset);
     quantizedNode =
         F->createConcat(node->getName(), quantizedInputs, C->getDim(), outTy);
@@ -265,6 +381,72 @@ static Node *quantizeNode(Function *F, Node *node,
 
     break;
   }
+  case Kinded::Kind::SelectNodeKind: {
+    auto *S = cast<SelectNode>(node);
+    assert(quantizedInputs.size() == 3 && "Invalid number of inputs");
+    assert(qParams.size() == 1 && "Invalid number of quantized outputs");
+
+    auto outTy =
+        F->getParent()->uniqueType(quantizationPrecision, S->getResult().dims(),
+                                   qParams[0].scale, qParams[0].offset);
+    quantizedNode = F->createSelect(S->getName(), outTy, quantizedInputs[0],
+                                    quantizedInputs[1], quantizedInputs[2]);
+    break;
+  }
+  case Kinded::Kind::InsertTensorNodeKind: {
+    auto *IT = cast<InsertTensorNode>(node);
+    assert(quantizedInputs.size() == 2 && "Invalid number of inputs");
+    assert(qParams.size() == 1 && "Invalid number of quantized outputs");
+
+    // InsertTensor just moves tensors around, so both tensors must share
+    // the {S,O} params of the output for the copies to need no arithmetic.
+    for (size_t qi = 0, e = quantizedInputs.size(); qi < e; qi++) {
+      auto argOutTy = F->getParent()->uniqueType(
+          quantizationPrecision, quantizedInputs[qi].dims(), qParams[0].scale,
+          qParams[0].offset);
+
+      quantizedInputs[qi] = F->createRescaleQuantized(
+          quantizedInputs[qi]->getName(), quantizedInputs[qi], argOutTy);
+    }
+
+    quantizedNode = F->createInsertTensor(IT->getName(), quantizedInputs[0],
+                                          quantizedInputs[1], IT->getStart(),
+                                          IT->getCount(), IT->getAxis());
+    break;
+  }
+  case Kinded::Kind::ScatterAssignNodeKind: {
+    auto *SA = cast<ScatterAssignNode>(node);
+    // ScatterAssign has 3 inputs, but the indices should not be quantized.
+    assert(quantizedInputs.size() == 2 && "Invalid number of inputs");
+    assert(qParams.size() == 1 && "Invalid number of quantized outputs");
+
+    // ScatterAssign copies slices into data without arithmetic, so both
+    // tensors must share the {S,O} params of the output.
+    for (size_t qi = 0, e = quantizedInputs.size(); qi < e; qi++) {
+      auto argOutTy = F->getParent()->uniqueType(
+          quantizationPrecision, quantizedInputs[qi].dims(), qParams[0].scale,
+          qParams[0].offset);
+
+      quantizedInputs[qi] = F->createRescaleQuantized(
+          quantizedInputs[qi]->getName(), quantizedInputs[qi], argOutTy);
+    }
+
+    quantizedNode =
+        F->createScatterAssign(SA->getName(), quantizedInputs[0],
+                               SA->getIndices(), quantizedInputs[1]);
+    break;
+  }
+  case Kinded::Kind::SplatNodeKind: {
+    auto *SP = cast<SplatNode>(node);
+    assert(quantizedInputs.empty() && "Invalid number of inputs");
+    assert(qParams.size() == 1 && "Invalid number of quantized outputs");
+
+    auto outTy =
+        F->getParent()->uniqueType(quantizationPrecision, SP->getResult().dims(),
+                                   qParams[0].scale, qParams[0].offset);
+    quantizedNode = F->createSplat(SP->getName(), outTy, SP->getValue());
+    break;
+  }
   case Kinded::Kind::TopKNodeKind: {
     auto *topK = cast<TopKNode>(node);
     assert(quantizedInputs.size() == 1 && "Invalid number of inputs");
@@ -280,9 +462,15 @@ static Node *quantizeNode(Function *F, Node *node,
     assert(quantizedInputs.size() == 1 && "Invalid number of inputs");
     assert(qParams.size() == 1 && "Invalid number of quantized outputs");
 
-    // Note: This should either be lowered into an IntLookupTable, or
-    // implemented via a backend-specific Node/Inst.
-    quantizedNode = F->createTanh(TN->getName(), quantizedInputs[0]);
+    // Lower the quantized tanh into a lookup table. The 256-entry mapping is
+    // computed from the actual input and output quantization parameters, so
+    // the whole op executes as a table gather.
+    quantizedNode = F->createIntLookupTable(
+        TN->getName(), quantizedInputs[0],
+        createMappingForUnaryOp(quantizedInputs[0].getType(), qParams[0],
+                                tanhf),
+        F->getParent()->uniqueType(quantizationPrecision, TN->getResult().dims(),
+                                   qParams[0].scale, qParams[0].offset));
     break;
   }
   case Kinded::Kind::SigmoidNodeKind: {
@@ -290,9 +478,13 @@ static Node *quantizeNode(Function *F, Node *node,
     assert(quantizedInputs.size() == 1 && "Invalid number of inputs");
     assert(qParams.size() == 1 && "Invalid number of quantized outputs");
 
-    // Note: This should either be lowered into an IntLookupTable, or
-    // implemented via a backend-specific Node/Inst.
-    quantizedNode = F->createSigmoid(SN->getName(), quantizedInputs[0]);
+    // Lower the quantized sigmoid into a lookup table, like tanh above.
+    quantizedNode = F->createIntLookupTable(
+        SN->getName(), quantizedInputs[0],
+        createMappingForUnaryOp(quantizedInputs[0].getType(), qParams[0],
+                                [](float x) { return 1 / (1 + expf(-x)); }),
+        F->getParent()->uniqueType(quantizationPrecision, SN->getResult().dims(),
+                                   qParams[0].scale, qParams[0].offset));
     break;
   }
   default:
@@ -341,7 +533,7 @@ postProcessQuantizedNode(Function *F, Node *quantizedNode,
     // {S,O} as the input. Make sure that rescale is applied to comply with
     // the taken profile from the node.
     auto outTy =
-        F->getParent()->uniqueType(ElemKind::Int8QTy, quantizedNode->dims(0),
+        F->getParent()->uniqueType(quantizationPrecision, quantizedNode->dims(0),
                                    qParams[0].scale, qParams[0].offset);
     return F->createRescaleQuantized(quantizedNode->getName(), quantizedNode,
                                      outTy);
@@ -380,7 +572,7 @@ quantizeFunction(const ExecutionEngine &EE,
     // the backend. Not all backends support particular quantized operation and
     // also we should not quantize Index type inputs.
     if (canBeQuantized(node) &&
-        EE.isOpSupported(node->getKind(), ElemKind::Int8QTy)) {
+        EE.isOpSupported(node->getKind(), quantizationPrecision)) {
       // 1) Quantize all of the inputs based on the profiles.
       //    Quantize only floating point inputs.
       auto quantizedInputs = quantizeInputs(G, node, nodeToTQP);
@@ -399,7 +591,7 @@ quantizeFunction(const ExecutionEngine &EE,
         // Dequantize only quantized outputs.
         // In case output was not quantized we still need to relink the node.
         if (quantizedNode->getNthResult(outNum).getElementType() !=
-            ElemKind::Int8QTy) {
+            quantizationPrecision) {
           node->getNthResult(outNum).replaceAllUsesOfWith(
               quantizedNode->getNthResult(outNum));
           continue;
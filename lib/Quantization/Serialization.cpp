@@ -22,6 +22,8 @@
 #include "llvm/Support/YAMLTraits.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <tuple>
+
 namespace llvm {
 namespace yaml {
 
@@ -72,4 +74,185 @@ deserializeFromYaml(llvm::StringRef fileName) {
   return result;
 }
 
+/// The binary profile format is a single open-addressing hash table:
+///
+///   BinaryProfileHeader
+///   BinaryProfileSlot[header.numSlots]
+///   string blob (NUL-terminated node output names)
+///
+/// All fields are host-endian and the slot table is 8-byte aligned, so a
+/// reader can point structs straight into the mapped file. The table is
+/// sized to at most 50% load and probed linearly, which makes lookups O(1)
+/// on average. The format is versioned through the header so it can evolve
+/// without breaking deployed profiles.
+namespace {
+
+/// The leading bytes of every binary profile file ("GQPB").
+constexpr uint32_t binaryProfileMagic = 0x42505147;
+/// The version of the format that this code reads and writes.
+constexpr uint32_t binaryProfileVersion = 1;
+
+struct BinaryProfileHeader {
+  uint32_t magic;
+  uint32_t version;
+  /// The number of occupied slots in the table.
+  uint32_t numEntries;
+  /// The total number of slots in the table. Always a power of two.
+  uint32_t numSlots;
+};
+
+struct BinaryProfileSlot {
+  /// Offset of the entry's name within the string blob, or emptySlot.
+  uint64_t nameOffset;
+  float scale;
+  int32_t offset;
+};
+
+/// Marks a slot that holds no entry.
+constexpr uint64_t emptySlot = ~0ULL;
+
+} // namespace
+
+/// \returns a stable FNV-1a hash of \p name. The hash is part of the file
+/// format, so it must not change between writer and reader builds.
+static uint64_t hashProfileName(llvm::StringRef name) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (char c : name) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+void serializeToBinary(llvm::StringRef fileName,
+                       llvm::ArrayRef<NodeQuantizationInfo> quantizationInfos) {
+  // Size the table to a power of two with at most 50% load.
+  size_t numSlots = 1;
+  while (numSlots < quantizationInfos.size() * 2) {
+    numSlots *= 2;
+  }
+
+  std::vector<BinaryProfileSlot> slots(numSlots,
+                                       {emptySlot, 0.0f, 0});
+  std::string names;
+
+  for (const auto &info : quantizationInfos) {
+    size_t slot = hashProfileName(info.nodeOutputName_) & (numSlots - 1);
+    while (slots[slot].nameOffset != emptySlot) {
+      slot = (slot + 1) & (numSlots - 1);
+    }
+    slots[slot].nameOffset = names.size();
+    slots[slot].scale = info.Scale();
+    slots[slot].offset = info.Offset();
+    names.append(info.nodeOutputName_);
+    names.push_back('\0');
+  }
+
+  BinaryProfileHeader header;
+  header.magic = binaryProfileMagic;
+  header.version = binaryProfileVersion;
+  header.numEntries = quantizationInfos.size();
+  header.numSlots = numSlots;
+
+  std::error_code EC;
+  llvm::raw_fd_ostream outputStream(fileName, EC, llvm::sys::fs::F_None);
+  GLOW_ASSERT(!EC && "Unable to create output stream");
+
+  outputStream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  outputStream.write(reinterpret_cast<const char *>(slots.data()),
+                     slots.size() * sizeof(BinaryProfileSlot));
+  outputStream.write(names.data(), names.size());
+}
+
+/// Validate the mapped profile in \p buffer.
+/// \returns its header, slot table and string blob.
+static std::tuple<const BinaryProfileHeader *, const BinaryProfileSlot *,
+                  const char *>
+mapBinaryProfile(const llvm::MemoryBuffer &buffer) {
+  GLOW_ASSERT(buffer.getBufferSize() >= sizeof(BinaryProfileHeader) &&
+              "Binary profile file is truncated");
+  auto *header =
+      reinterpret_cast<const BinaryProfileHeader *>(buffer.getBufferStart());
+  GLOW_ASSERT(header->magic == binaryProfileMagic &&
+              "Not a binary quantization profile");
+  GLOW_ASSERT(header->version == binaryProfileVersion &&
+              "Unsupported binary profile version");
+  GLOW_ASSERT(buffer.getBufferSize() >=
+                  sizeof(BinaryProfileHeader) +
+                      header->numSlots * sizeof(BinaryProfileSlot) &&
+              "Binary profile file is truncated");
+  auto *slots = reinterpret_cast<const BinaryProfileSlot *>(header + 1);
+  const char *names = reinterpret_cast<const char *>(slots + header->numSlots);
+  return std::make_tuple(header, slots, names);
+}
+
+std::vector<NodeQuantizationInfo>
+deserializeFromBinary(llvm::StringRef fileName) {
+  BinaryQuantizationProfile profile(fileName);
+
+  std::vector<NodeQuantizationInfo> result;
+  result.reserve(profile.size());
+  // Walk the slot table and materialize every occupied slot.
+  profile.forEach([&](llvm::StringRef name, TensorQuantizationParams params) {
+    result.emplace_back(name.str(), params);
+  });
+  return result;
+}
+
+BinaryQuantizationProfile::BinaryQuantizationProfile(llvm::StringRef fileName) {
+  // getFile() maps the file into memory when it is large enough for the
+  // mapping to pay off.
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> file =
+      llvm::MemoryBuffer::getFile(fileName);
+  GLOW_ASSERT(!file.getError() && "Unable to open file");
+  buffer_ = std::move(*file);
+  // Validate the header and table bounds once, up front.
+  mapBinaryProfile(*buffer_);
+}
+
+BinaryQuantizationProfile::~BinaryQuantizationProfile() = default;
+
+bool BinaryQuantizationProfile::lookup(llvm::StringRef nodeOutputName,
+                                       TensorQuantizationParams &params) const {
+  const BinaryProfileHeader *header;
+  const BinaryProfileSlot *slots;
+  const char *names;
+  std::tie(header, slots, names) = mapBinaryProfile(*buffer_);
+
+  size_t slot = hashProfileName(nodeOutputName) & (header->numSlots - 1);
+  while (slots[slot].nameOffset != emptySlot) {
+    if (nodeOutputName == names + slots[slot].nameOffset) {
+      params.scale = slots[slot].scale;
+      params.offset = slots[slot].offset;
+      return true;
+    }
+    slot = (slot + 1) & (header->numSlots - 1);
+  }
+  return false;
+}
+
+void BinaryQuantizationProfile::forEach(
+    const std::function<void(llvm::StringRef, TensorQuantizationParams)> &fn)
+    const {
+  const BinaryProfileHeader *header;
+  const BinaryProfileSlot *slots;
+  const char *names;
+  std::tie(header, slots, names) = mapBinaryProfile(*buffer_);
+
+  for (size_t i = 0, e = header->numSlots; i < e; ++i) {
+    if (slots[i].nameOffset == emptySlot) {
+      continue;
+    }
+    fn(names + slots[i].nameOffset, {slots[i].scale, slots[i].offset});
+  }
+}
+
+size_t BinaryQuantizationProfile::size() const {
+  const BinaryProfileHeader *header;
+  const BinaryProfileSlot *slots;
+  const char *names;
+  std::tie(header, slots, names) = mapBinaryProfile(*buffer_);
+  return header->numEntries;
+}
+
 } // namespace glow
@@ -0,0 +1,215 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "glow/Support/Memory.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <vector>
+
+using namespace glow;
+
+namespace {
+
+/// Payloads of at most this size are pooled; anything bigger goes straight to
+/// the system allocator.
+constexpr size_t maxPooledSize = 16 << 20;
+
+/// The smallest pooled size class.
+constexpr size_t minPooledSize = 64;
+
+/// Upper bound on the number of bytes a single thread may keep cached. When
+/// the cap is reached, deallocated buffers are freed instead of recycled.
+constexpr size_t maxCachedBytesPerThread = 256 << 20;
+
+/// Number of power-of-two size classes between minPooledSize and
+/// maxPooledSize.
+constexpr unsigned numSizeClasses = 19;
+
+/// \returns the size class index for \p size, assuming it is poolable.
+unsigned sizeClassFor(size_t size) {
+  unsigned cls = 0;
+  size_t classSize = minPooledSize;
+  while (classSize < size) {
+    classSize <<= 1;
+    cls++;
+  }
+  assert(cls < numSizeClasses && "Size is not poolable");
+  return cls;
+}
+
+/// \returns the allocation size of size class \p cls.
+size_t sizeOfClass(unsigned cls) { return minPooledSize << cls; }
+
+/// A per-thread pool of recycled payload buffers, bucketed by power-of-two
+/// size classes. Buffers allocated on one thread and freed on another simply
+/// migrate to the freeing thread's pool.
+class TensorPool {
+  /// Free buffers for each size class.
+  std::vector<void *> freeLists_[numSizeClasses];
+  /// Total number of bytes currently cached in \ref freeLists_.
+  size_t cachedBytes_{0};
+
+public:
+  void *allocate(size_t size) {
+    unsigned cls = sizeClassFor(size);
+    auto &fl = freeLists_[cls];
+    if (!fl.empty()) {
+      void *ptr = fl.back();
+      fl.pop_back();
+      cachedBytes_ -= sizeOfClass(cls);
+      return ptr;
+    }
+    return alignedAlloc(sizeOfClass(cls), TensorAlignment);
+  }
+
+  void deallocate(void *ptr, size_t size) {
+    unsigned cls = sizeClassFor(size);
+    if (cachedBytes_ + sizeOfClass(cls) > maxCachedBytesPerThread) {
+      alignedFree(ptr);
+      return;
+    }
+    freeLists_[cls].push_back(ptr);
+    cachedBytes_ += sizeOfClass(cls);
+  }
+
+  void reserve(size_t size, size_t bytes) {
+    unsigned cls = sizeClassFor(size);
+    size_t classSize = sizeOfClass(cls);
+    while (bytes >= classSize &&
+           cachedBytes_ + classSize <= maxCachedBytesPerThread) {
+      freeLists_[cls].push_back(alignedAlloc(classSize, TensorAlignment));
+      cachedBytes_ += classSize;
+      bytes -= classSize;
+    }
+  }
+
+  ~TensorPool() {
+    for (auto &fl : freeLists_) {
+      for (void *ptr : fl) {
+        alignedFree(ptr);
+      }
+    }
+  }
+};
+
+/// \returns the calling thread's payload pool.
+TensorPool &getThreadPool() {
+  thread_local TensorPool pool;
+  return pool;
+}
+
+} // namespace
+
+void *glow::allocateTensorPayload(size_t size) {
+  if (size == 0 || size > maxPooledSize) {
+    return alignedAlloc(size, TensorAlignment);
+  }
+  return getThreadPool().allocate(size);
+}
+
+void glow::deallocateTensorPayload(void *ptr, size_t size) {
+  if (!ptr) {
+    return;
+  }
+  if (size == 0 || size > maxPooledSize) {
+    alignedFree(ptr);
+    return;
+  }
+  getThreadPool().deallocate(ptr, size);
+}
+
+void glow::reserveTensorPool(size_t size, size_t bytes) {
+  if (size == 0 || size > maxPooledSize) {
+    return;
+  }
+  getThreadPool().reserve(size, bytes);
+}
+
+void *SlabAllocator::allocate(size_t size) {
+  size_t rounded = (size + granularity - 1) & ~(granularity - 1);
+  if (rounded > maxSlabAllocSize) {
+    return ::malloc(size);
+  }
+  auto &head = freeLists_[rounded / granularity - 1];
+  if (head) {
+    void *ptr = head;
+    head = *reinterpret_cast<void **>(ptr);
+    return ptr;
+  }
+  if (slabUsed_ + rounded > slabSize) {
+    slabs_.push_back(static_cast<char *>(::malloc(slabSize)));
+    slabUsed_ = 0;
+  }
+  void *ptr = slabs_.back() + slabUsed_;
+  slabUsed_ += rounded;
+  return ptr;
+}
+
+void SlabAllocator::deallocate(void *ptr, size_t size) {
+  size_t rounded = (size + granularity - 1) & ~(granularity - 1);
+  if (rounded > maxSlabAllocSize) {
+    ::free(ptr);
+    return;
+  }
+  auto &head = freeLists_[rounded / granularity - 1];
+  *reinterpret_cast<void **>(ptr) = head;
+  head = ptr;
+}
+
+SlabAllocator::~SlabAllocator() {
+  for (char *slab : slabs_) {
+    ::free(slab);
+  }
+}
+
+size_t glow::getPageSize() {
+  static const size_t pageSize = sysconf(_SC_PAGESIZE);
+  return pageSize;
+}
+
+void *glow::pageAlignedAlloc(size_t size, bool pinned, bool hugePages) {
+  size_t mapSize = alignedSize(size, getPageSize());
+  void *ptr = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  assert(ptr != MAP_FAILED && "mmap failed");
+
+#ifdef MADV_HUGEPAGE
+  if (hugePages) {
+    // Best effort; the kernel may not support transparent huge pages.
+    madvise(ptr, mapSize, MADV_HUGEPAGE);
+  }
+#else
+  (void)hugePages;
+#endif
+
+  if (pinned) {
+    // Best effort; pinning may exceed RLIMIT_MEMLOCK for unprivileged
+    // processes, in which case the buffer simply stays pageable.
+    mlock(ptr, mapSize);
+  }
+
+  return ptr;
+}
+
+void glow::pageAlignedFree(void *ptr, size_t size) {
+  if (!ptr) {
+    return;
+  }
+  // munmap releases any mlock on the region as well.
+  munmap(ptr, alignedSize(size, getPageSize()));
+}
@@ -0,0 +1,66 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "glow/Support/PassStats.h"
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <vector>
+
+using namespace glow;
+
+static llvm::cl::opt<bool> enablePassStats(
+    "glow-pass-stats",
+    llvm::cl::desc("Collect and print per-pass compile time statistics"));
+
+/// The statistics collected since the last call to clearPassStats().
+static std::vector<PassStat> passStats;
+
+bool glow::passStatsEnabled() { return enablePassStats; }
+
+llvm::ArrayRef<PassStat> glow::getPassStats() { return passStats; }
+
+void glow::clearPassStats() { passStats.clear(); }
+
+void glow::dumpPassStats(llvm::raw_ostream &os) {
+  for (const auto &S : passStats) {
+    os << S.name << "," << llvm::format("%.6f", S.seconds) << ","
+       << S.unitsBefore << "," << S.unitsAfter << "\n";
+  }
+}
+
+ScopedPassTimer::ScopedPassTimer(const char *name,
+                                 std::function<int64_t()> countUnits)
+    : name_(name) {
+  if (!enablePassStats) {
+    return;
+  }
+  countUnits_ = std::move(countUnits);
+  unitsBefore_ = countUnits_();
+  start_ = std::chrono::steady_clock::now();
+}
+
+ScopedPassTimer::~ScopedPassTimer() {
+  if (!countUnits_) {
+    return;
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start_;
+  passStats.push_back(
+      {name_, elapsed.count(), unitsBefore_, countUnits_()});
+}
@@ -17,7 +17,11 @@
 #include "glow/Support/Random.h"
 #include "llvm/Support/CommandLine.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <thread>
+#include <vector>
 
 static llvm::cl::opt<glow::PseudoRNG::result_type>
     pseudoRandomSeed("pseudo-random-seed",
@@ -40,4 +44,58 @@ double PseudoRNG::nextRandReal(double a, double b) {
   return std::uniform_real_distribution<double>(a, b)(engine_);
 }
 
+FastPRNG::FastPRNG(uint64_t stream) {
+  // Expand the global seed and the stream id into the generator state with
+  // splitmix64, as the xoshiro authors recommend.
+  uint64_t z = pseudoRandomSeed.getValue() +
+               0x9e3779b97f4a7c15ULL * (stream + 1);
+  for (auto &s : s_) {
+    z += 0x9e3779b97f4a7c15ULL;
+    uint64_t x = z;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    s = x ^ (x >> 31);
+  }
+}
+
+void fillUniform(float *data, size_t size, float low, float high,
+                 uint64_t stream) {
+  // Each chunk is drawn from its own stream, so the values at a given index
+  // do not depend on how many threads execute the chunks.
+  constexpr size_t chunkSize = 1 << 16;
+  size_t numChunks = (size + chunkSize - 1) / chunkSize;
+
+  auto fillChunk = [=](size_t chunk) {
+    FastPRNG G(stream + 0x9e3779b9ULL * chunk);
+    size_t begin = chunk * chunkSize;
+    size_t end = std::min(begin + chunkSize, size);
+    for (size_t i = begin; i < end; i++) {
+      data[i] = G.nextFloat(low, high);
+    }
+  };
+
+  unsigned hw = std::thread::hardware_concurrency();
+  size_t numThreads = std::min<size_t>(hw ? hw : 1, numChunks);
+  if (numThreads <= 1) {
+    for (size_t chunk = 0; chunk < numChunks; chunk++) {
+      fillChunk(chunk);
+    }
+    return;
+  }
+
+  std::atomic<size_t> nextChunk{0};
+  std::vector<std::thread> workers;
+  for (size_t t = 0; t < numThreads; t++) {
+    workers.emplace_back([&] {
+      for (size_t chunk = nextChunk++; chunk < numChunks;
+           chunk = nextChunk++) {
+        fillChunk(chunk);
+      }
+    });
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+}
+
 } // namespace glow
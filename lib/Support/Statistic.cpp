@@ -0,0 +1,70 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "glow/Support/Statistic.h"
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+static llvm::cl::opt<bool>
+    glowStats("glow-stats",
+              llvm::cl::desc("Collect and print statistics counters that "
+                             "quantify the work done by each optimization"),
+              llvm::cl::init(false));
+
+namespace {
+/// The registry of counters that fired, in registration order. Guarded by
+/// registryMutex.
+std::vector<glow::Statistic *> registry;
+std::mutex registryMutex;
+} // namespace
+
+namespace glow {
+
+bool statisticsEnabled() { return glowStats; }
+
+void Statistic::registerStatistic() {
+  std::lock_guard<std::mutex> lock(registryMutex);
+  if (!registered_.load(std::memory_order_relaxed)) {
+    registry.push_back(this);
+    registered_.store(true, std::memory_order_release);
+  }
+}
+
+void dumpStatistics(llvm::raw_ostream &os) {
+  std::vector<Statistic *> stats;
+  {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    stats = registry;
+  }
+  std::sort(stats.begin(), stats.end(), [](Statistic *a, Statistic *b) {
+    int c = strcmp(a->getDebugType(), b->getDebugType());
+    return c < 0 || (c == 0 && strcmp(a->getName(), b->getName()) < 0);
+  });
+  os << "=== Statistics ===\n";
+  for (auto *s : stats) {
+    os << llvm::format("%8llu", (unsigned long long)s->getValue()) << " "
+       << s->getDebugType() << " - " << s->getDesc() << "\n";
+  }
+}
+
+} // namespace glow
@@ -18,7 +18,16 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cstring>
 #include <limits>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 namespace glow {
 
@@ -31,21 +40,113 @@ public:
   virtual void teardown() = 0;
 };
 
-/// Run a benchmark \p reps times and report the best execution time.
-double bench(Benchmark *b, size_t reps) {
-  double best = std::numeric_limits<double>::max();
+/// Statistics of one benchmark run. All times are in seconds per iteration.
+/// Counter fields are zero when hardware counters are unavailable.
+struct BenchStats {
+  double min;
+  double median;
+  double p95;
+  double p99;
+  double cyclesPerRun;
+  double instructionsPerRun;
+};
+
+#ifdef __linux__
+/// A hardware performance counter read through perf_event_open. The counter
+/// silently disables itself when the kernel denies access, so benchmarks work
+/// unchanged on locked-down machines.
+class PerfCounter {
+  int fd_{-1};
+
+public:
+  explicit PerfCounter(unsigned config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd_ = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+  }
+  ~PerfCounter() {
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+  }
+  void start() {
+    if (fd_ >= 0) {
+      ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+  /// \returns the counter value since start(), or zero when unavailable.
+  uint64_t stop() {
+    if (fd_ < 0) {
+      return 0;
+    }
+    ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+    uint64_t count = 0;
+    if (read(fd_, &count, sizeof(count)) != sizeof(count)) {
+      return 0;
+    }
+    return count;
+  }
+};
+#endif
+
+/// Run a benchmark \p reps times after \p warmup untimed iterations and
+/// \returns timing statistics. Warmup absorbs JIT compilation and lets the
+/// clock ramp up; samples slower than three times the median are discarded
+/// as outliers (scheduler preemption, interrupts) before the percentiles
+/// are computed.
+BenchStats benchStats(Benchmark *b, size_t reps, size_t warmup = 3) {
   b->setup();
+  for (size_t i = 0; i < warmup; i++) {
+    b->run();
+  }
+
+#ifdef __linux__
+  PerfCounter cycles(PERF_COUNT_HW_CPU_CYCLES);
+  PerfCounter instructions(PERF_COUNT_HW_INSTRUCTIONS);
+  cycles.start();
+  instructions.start();
+#endif
+
+  std::vector<double> samples;
+  samples.reserve(reps);
   for (size_t i = 0; i < reps; i++) {
     auto start = std::chrono::high_resolution_clock::now();
     b->run();
     auto end = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration<double>(end - start).count();
-    best = std::min(best, duration);
+    samples.push_back(std::chrono::duration<double>(end - start).count());
   }
+
+  BenchStats stats;
+  stats.cyclesPerRun = 0;
+  stats.instructionsPerRun = 0;
+#ifdef __linux__
+  stats.cyclesPerRun = double(cycles.stop()) / reps;
+  stats.instructionsPerRun = double(instructions.stop()) / reps;
+#endif
   b->teardown();
-  return best;
+
+  std::sort(samples.begin(), samples.end());
+  double median = samples[samples.size() / 2];
+  while (samples.size() > 1 && samples.back() > 3 * median) {
+    samples.pop_back();
+  }
+  stats.min = samples.front();
+  stats.median = samples[samples.size() / 2];
+  stats.p95 = samples[(samples.size() - 1) * 95 / 100];
+  stats.p99 = samples[(samples.size() - 1) * 99 / 100];
+  return stats;
 }
 
+/// Run a benchmark \p reps times and report the best execution time.
+double bench(Benchmark *b, size_t reps) { return benchStats(b, reps).min; }
+
 } // namespace glow
 
 #endif // GLOW_TESTS_BENCHMARK_H
@@ -0,0 +1,177 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+#include "Bench.h"
+
+using namespace glow;
+
+extern "C" {
+// Forward declare functions from libjit.
+extern void libjit_convolution_f(float *outW, const float *inW,
+                                 const float *filterW, const float *biasW,
+                                 const size_t *outWdims, const size_t *inWdims,
+                                 const size_t *filterWdims,
+                                 const size_t *biasWdims, size_t filterSize,
+                                 size_t stride, size_t *pads, size_t group,
+                                 unsigned depthUnroll, unsigned nthreads);
+}
+
+/// Benchmark one convolution layer shape against libjit_convolution_f.
+/// The tensors are in the NHWC layout that the kernel expects.
+class ConvBench : public Benchmark {
+  /// Tensors.
+  std::vector<float> in;
+  std::vector<float> filter;
+  std::vector<float> bias;
+  std::vector<float> out;
+
+  /// Dimensions expressed in libjit's format.
+  size_t inDims[4];
+  size_t filterDims[4];
+  size_t biasDims[1];
+  size_t outDims[4];
+
+  size_t kernel_;
+  size_t stride_;
+  size_t pads_[2];
+  unsigned nthreads_;
+
+public:
+  ConvBench(size_t inHW, size_t inC, size_t outC, size_t kernel, size_t stride,
+            size_t pad, unsigned nthreads)
+      : kernel_(kernel), stride_(stride), pads_{pad, pad},
+        nthreads_(nthreads) {
+    size_t outHW = (inHW + 2 * pad - kernel) / stride + 1;
+    inDims[0] = 1;
+    inDims[1] = inHW;
+    inDims[2] = inHW;
+    inDims[3] = inC;
+    filterDims[0] = outC;
+    filterDims[1] = kernel;
+    filterDims[2] = kernel;
+    filterDims[3] = inC;
+    biasDims[0] = outC;
+    outDims[0] = 1;
+    outDims[1] = outHW;
+    outDims[2] = outHW;
+    outDims[3] = outC;
+  }
+
+  virtual void setup() override {
+    in.resize(inDims[0] * inDims[1] * inDims[2] * inDims[3]);
+    filter.resize(filterDims[0] * filterDims[1] * filterDims[2] *
+                  filterDims[3]);
+    bias.resize(biasDims[0]);
+    out.resize(outDims[0] * outDims[1] * outDims[2] * outDims[3]);
+    randomize(in);
+    randomize(filter);
+    randomize(bias);
+  }
+
+  virtual void run() override {
+    // Process eight output depth slices together when the depth allows it,
+    // like the code generator does.
+    unsigned depthUnroll = (outDims[3] % 8) == 0 ? 8 : 1;
+    libjit_convolution_f(out.data(), in.data(), filter.data(), bias.data(),
+                         outDims, inDims, filterDims, biasDims, kernel_,
+                         stride_, pads_, /* group */ 1, depthUnroll,
+                         nthreads_);
+  }
+
+  virtual void teardown() override {}
+
+  /// \returns the number of floating point operations of one run, in
+  /// billions: one multiply and one add per filter tap and output element.
+  double gflops() const {
+    return 2.0 * outDims[1] * outDims[2] * outDims[3] * kernel_ * kernel_ *
+           inDims[3] / 1e9;
+  }
+
+private:
+  void randomize(std::vector<float> &v) {
+    std::mt19937 gen;
+    std::uniform_real_distribution<> dis(-1.0, 1.0);
+    for (auto &x : v) {
+      x = dis(gen);
+    }
+  }
+};
+
+/// One layer shape of the sweep.
+struct ConvShape {
+  const char *name;
+  size_t inHW;
+  size_t inC;
+  size_t outC;
+  size_t kernel;
+  size_t stride;
+  size_t pad;
+};
+
+/// The distinct convolution shapes of resnet50 and vgg19, the layers that
+/// dominate our real workloads.
+static const ConvShape shapes[] = {
+    {"resnet50.conv1", 224, 3, 64, 7, 2, 3},
+    {"resnet50.res2.1x1a", 56, 256, 64, 1, 1, 0},
+    {"resnet50.res2.3x3", 56, 64, 64, 3, 1, 1},
+    {"resnet50.res2.1x1b", 56, 64, 256, 1, 1, 0},
+    {"resnet50.res3.1x1a", 28, 512, 128, 1, 1, 0},
+    {"resnet50.res3.3x3", 28, 128, 128, 3, 1, 1},
+    {"resnet50.res3.1x1b", 28, 128, 512, 1, 1, 0},
+    {"resnet50.res4.1x1a", 14, 1024, 256, 1, 1, 0},
+    {"resnet50.res4.3x3", 14, 256, 256, 3, 1, 1},
+    {"resnet50.res4.1x1b", 14, 256, 1024, 1, 1, 0},
+    {"resnet50.res5.1x1a", 7, 2048, 512, 1, 1, 0},
+    {"resnet50.res5.3x3", 7, 512, 512, 3, 1, 1},
+    {"resnet50.res5.1x1b", 7, 512, 2048, 1, 1, 0},
+    {"vgg19.conv1_1", 224, 3, 64, 3, 1, 1},
+    {"vgg19.conv1_2", 224, 64, 64, 3, 1, 1},
+    {"vgg19.conv2_1", 112, 64, 128, 3, 1, 1},
+    {"vgg19.conv2_2", 112, 128, 128, 3, 1, 1},
+    {"vgg19.conv3_1", 56, 128, 256, 3, 1, 1},
+    {"vgg19.conv3_2", 56, 256, 256, 3, 1, 1},
+    {"vgg19.conv4_1", 28, 256, 512, 3, 1, 1},
+    {"vgg19.conv4_2", 28, 512, 512, 3, 1, 1},
+    {"vgg19.conv5", 14, 512, 512, 3, 1, 1},
+};
+
+/// Usage: ConvBench [peak gflops/s] [nthreads]
+/// When the machine's peak is given, each shape also reports the fraction of
+/// the peak it achieves, so per-shape kernel regressions stand out.
+int main(int argc, char **argv) {
+  constexpr int reps = 10;
+  double peak = argc > 1 ? atof(argv[1]) : 0.0;
+  unsigned nthreads = argc > 2 ? atoi(argv[2]) : 1;
+
+  printf("layer, inHW, inC, outC, kernel, stride, gflops/s%s\n",
+         peak > 0.0 ? ", %peak" : "");
+  for (const auto &shape : shapes) {
+    ConvBench b(shape.inHW, shape.inC, shape.outC, shape.kernel, shape.stride,
+                shape.pad, nthreads);
+    auto time = bench(&b, reps);
+    double rate = b.gflops() / time;
+    printf("%-20s, %4zu, %4zu, %4zu, %zu, %zu, %7.2lf", shape.name,
+           shape.inHW, shape.inC, shape.outC, shape.kernel, shape.stride,
+           rate);
+    if (peak > 0.0) {
+      printf(", %5.1lf%%", 100.0 * rate / peak);
+    }
+    printf("\n");
+  }
+}
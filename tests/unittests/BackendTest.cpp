@@ -148,6 +148,45 @@ TEST_P(BackendTest, debugPrint) {
   function->execute();
 }
 
+TEST_P(BackendTest, dynamicRequestBatching) {
+  auto &mod = EE_.getModule();
+  Function *F = mod.createFunction("main");
+  auto *input =
+      mod.createVariable(ElemKind::FloatTy, {1, 4}, "input",
+                         VisibilityKind::Public, Variable::TrainKind::None);
+  auto *save = F->createSave("ret", F->createTanh("tanh", input));
+  auto *output = save->getVariable();
+
+  EE_.enableBatching(CompilationMode::Infer, F, /* maxBatch */ 4,
+                     /* timeoutMicroseconds */ 1000);
+
+  // Queue more requests than one coalesced batch carries, so the worker
+  // executes both full and partially filled batches. Every request must
+  // get its own rows back regardless of how the batches were cut.
+  const size_t numRequests = 6;
+  std::vector<Tensor> inputs(numRequests);
+  std::vector<Tensor> results(numRequests);
+  std::vector<std::future<void>> futures;
+  for (size_t r = 0; r < numRequests; r++) {
+    inputs[r].reset(ElemKind::FloatTy, {1, 4});
+    inputs[r].getHandle().randomize(-2.0, 2.0, mod.getPRNG());
+    results[r].reset(ElemKind::FloatTy, {1, 4});
+    futures.push_back(
+        EE_.runBatched({input}, {&inputs[r]}, {output}, {&results[r]}));
+  }
+  for (auto &f : futures) {
+    f.get();
+  }
+
+  for (size_t r = 0; r < numRequests; r++) {
+    auto in = inputs[r].getHandle();
+    auto out = results[r].getHandle();
+    for (size_t j = 0; j < 4; j++) {
+      EXPECT_NEAR(out.at({0, j}), std::tanh(in.at({0, j})), 1E-4);
+    }
+  }
+}
+
 INSTANTIATE_TEST_CASE_P(Interpreter, BackendTest,
                         ::testing::Values(BackendKind::Interpreter));
 
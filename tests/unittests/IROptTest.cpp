@@ -713,3 +713,39 @@ TEST(Optimizer, bufferReuseWithoutDefsPlusCasts) {
   EXPECT_EQ(inputCast ? getOrigin(inputCast) : nullptr, input);
   EXPECT_EQ(inputCast ? inputCast->getOperand(0).first : nullptr, input);
 }
+
+/// Check that clustering data-parallel chains extends an existing cluster
+/// upward instead of splitting it: when a producer is sunk towards a user
+/// that already follows a data-parallel run, the producer lands above the
+/// run, not between the run and the user.
+TEST(Optimizer, clusterKeepsExistingRunsIntact) {
+  Module mod;
+  Function *F = mod.createFunction("clusterKeepsExistingRunsIntact");
+  IRFunction M(F);
+  IRBuilder bb(&M);
+
+  auto *input = bb.createWeightVar(glow::ElemKind::FloatTy, {64}, "input",
+                                   WeightVar::MutabilityKind::Mutable);
+  auto *output = bb.createWeightVar(glow::ElemKind::FloatTy, {64}, "output",
+                                    WeightVar::MutabilityKind::Mutable);
+  auto *tmp1 =
+      bb.createAllocActivationInst("tmp1", glow::ElemKind::FloatTy, {64});
+  auto *tmp2 =
+      bb.createAllocActivationInst("tmp2", glow::ElemKind::FloatTy, {64});
+
+  // The splat feeds the second add further down; the first add directly
+  // above it already forms a cluster with it.
+  auto *splat = bb.createSplatInst("splat", tmp2, 1.0);
+  auto *def = bb.createElementAddInst("def", tmp1, input, input);
+  auto *use = bb.createElementAddInst("use", output, tmp1, tmp2);
+
+  bb.createDeallocActivationInst("dealloc1", tmp1);
+  bb.createDeallocActivationInst("dealloc2", tmp2);
+
+  optimize(M, CompilationMode::Infer, MockBackend());
+
+  // The defining add must still be the instruction directly above its user.
+  EXPECT_EQ(&*std::prev(use->getIterator()), def);
+  // The splat stayed above the bundle instead of splitting it.
+  EXPECT_EQ(&*std::prev(def->getIterator()), splat);
+}
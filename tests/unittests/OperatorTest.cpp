@@ -2591,6 +2591,122 @@ TEST_P(InterpOnly, SparseLengthsSum) {
   EXPECT_TRUE(expected.isEqual(result));
 }
 
+TEST_P(InterpAndCPU, LSTMCell) {
+  const size_t batch = 2;
+  const size_t inputSize = 3;
+  const size_t hidden = 4;
+
+  auto *X = mod_.createVariable(ElemKind::FloatTy, {batch, inputSize}, "X");
+  auto *H = mod_.createVariable(ElemKind::FloatTy, {batch, hidden}, "H");
+  auto *C = mod_.createVariable(ElemKind::FloatTy, {batch, hidden}, "C");
+  auto *Wx =
+      mod_.createVariable(ElemKind::FloatTy, {inputSize, 4 * hidden}, "Wx");
+  auto *Wh = mod_.createVariable(ElemKind::FloatTy, {hidden, 4 * hidden}, "Wh");
+  auto *B = mod_.createVariable(ElemKind::FloatTy, {4 * hidden}, "B");
+  for (auto *V : {X, H, C, Wx, Wh, B}) {
+    V->getPayload().getHandle().randomize(-1.0, 1.0, mod_.getPRNG());
+  }
+
+  // Capture the inputs before the compilation may touch them.
+  Tensor x = X->getPayload().clone();
+  Tensor h = H->getPayload().clone();
+  Tensor c = C->getPayload().clone();
+  Tensor wx = Wx->getPayload().clone();
+  Tensor wh = Wh->getPayload().clone();
+  Tensor b = B->getPayload().clone();
+
+  auto *cell = F_->createLSTMCell("lstm", X, H, C, Wx, Wh, B);
+  auto *saveH = F_->createSave("newH", cell->getNewH());
+  auto *saveC = F_->createSave("newC", cell->getNewC());
+
+  EE_.compile(CompilationMode::Infer, F_);
+  EE_.run({}, {});
+
+  auto resH = llvm::cast<Variable>(saveH->getOutput())->getHandle();
+  auto resC = llvm::cast<Variable>(saveC->getOutput())->getHandle();
+
+  auto sigmoid = [](float v) { return 1 / (1 + std::exp(-v)); };
+  // The gates are packed in the order input, forget, cell, output.
+  for (size_t i = 0; i < batch; i++) {
+    std::vector<float> pre(4 * hidden);
+    for (size_t j = 0; j < 4 * hidden; j++) {
+      pre[j] = b.getHandle().at({j});
+      for (size_t k = 0; k < inputSize; k++) {
+        pre[j] += x.getHandle().at({i, k}) * wx.getHandle().at({k, j});
+      }
+      for (size_t k = 0; k < hidden; k++) {
+        pre[j] += h.getHandle().at({i, k}) * wh.getHandle().at({k, j});
+      }
+    }
+    for (size_t j = 0; j < hidden; j++) {
+      float ig = sigmoid(pre[j]);
+      float fg = sigmoid(pre[hidden + j]);
+      float gg = std::tanh(pre[2 * hidden + j]);
+      float og = sigmoid(pre[3 * hidden + j]);
+      float newC = fg * c.getHandle().at({i, j}) + ig * gg;
+      EXPECT_NEAR(resC.at({i, j}), newC, 1E-4);
+      EXPECT_NEAR(resH.at({i, j}), og * std::tanh(newC), 1E-4);
+    }
+  }
+}
+
+TEST_P(InterpAndCPU, GRUCell) {
+  const size_t batch = 2;
+  const size_t inputSize = 3;
+  const size_t hidden = 4;
+
+  auto *X = mod_.createVariable(ElemKind::FloatTy, {batch, inputSize}, "X");
+  auto *H = mod_.createVariable(ElemKind::FloatTy, {batch, hidden}, "H");
+  auto *Wx =
+      mod_.createVariable(ElemKind::FloatTy, {inputSize, 3 * hidden}, "Wx");
+  auto *Wh = mod_.createVariable(ElemKind::FloatTy, {hidden, 3 * hidden}, "Wh");
+  auto *Bx = mod_.createVariable(ElemKind::FloatTy, {3 * hidden}, "Bx");
+  auto *Bh = mod_.createVariable(ElemKind::FloatTy, {3 * hidden}, "Bh");
+  for (auto *V : {X, H, Wx, Wh, Bx, Bh}) {
+    V->getPayload().getHandle().randomize(-1.0, 1.0, mod_.getPRNG());
+  }
+
+  Tensor x = X->getPayload().clone();
+  Tensor h = H->getPayload().clone();
+  Tensor wx = Wx->getPayload().clone();
+  Tensor wh = Wh->getPayload().clone();
+  Tensor bx = Bx->getPayload().clone();
+  Tensor bh = Bh->getPayload().clone();
+
+  auto *cell = F_->createGRUCell("gru", X, H, Wx, Wh, Bx, Bh);
+  auto *saveH = F_->createSave("newH", cell->getNewH());
+
+  EE_.compile(CompilationMode::Infer, F_);
+  EE_.run({}, {});
+
+  auto resH = llvm::cast<Variable>(saveH->getOutput())->getHandle();
+
+  auto sigmoid = [](float v) { return 1 / (1 + std::exp(-v)); };
+  // The gates are packed in the order update, reset, candidate, and the
+  // candidate uses the linear-before-reset formulation.
+  for (size_t i = 0; i < batch; i++) {
+    std::vector<float> xPre(3 * hidden);
+    std::vector<float> hPre(3 * hidden);
+    for (size_t j = 0; j < 3 * hidden; j++) {
+      xPre[j] = bx.getHandle().at({j});
+      hPre[j] = bh.getHandle().at({j});
+      for (size_t k = 0; k < inputSize; k++) {
+        xPre[j] += x.getHandle().at({i, k}) * wx.getHandle().at({k, j});
+      }
+      for (size_t k = 0; k < hidden; k++) {
+        hPre[j] += h.getHandle().at({i, k}) * wh.getHandle().at({k, j});
+      }
+    }
+    for (size_t j = 0; j < hidden; j++) {
+      float zg = sigmoid(xPre[j] + hPre[j]);
+      float rg = sigmoid(xPre[hidden + j] + hPre[hidden + j]);
+      float cg = std::tanh(xPre[2 * hidden + j] + rg * hPre[2 * hidden + j]);
+      float newH = zg * h.getHandle().at({i, j}) + (1 - zg) * cg;
+      EXPECT_NEAR(resH.at({i, j}), newH, 1E-4);
+    }
+  }
+}
+
 INSTANTIATE_TEST_CASE_P(Interpreter, InterpOnly,
                         ::testing::Values(BackendKind::Interpreter));
 
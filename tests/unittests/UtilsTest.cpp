@@ -14,8 +14,14 @@
  * limitations under the License.
  */
 
+#include "glow/Base/Tensor.h"
+#include "glow/Support/MappedFile.h"
 #include "glow/Support/Random.h"
 
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+
 #include "gtest/gtest.h"
 
 using namespace glow;
@@ -49,3 +55,51 @@ TEST(Utils, deterministicPRNG) {
     EXPECT_EQ(dist(genA), dist(genB));
   }
 }
+
+// Test that a tensor can alias a read-only memory mapping of a weight file.
+TEST(Utils, mappedFileTensor) {
+  llvm::SmallString<64> path;
+  ASSERT_FALSE(
+      llvm::sys::fs::createTemporaryFile("mapped-weights", "bin", path));
+
+  // Write a small payload of known floats.
+  float payload[8];
+  for (unsigned i = 0; i < 8; i++) {
+    payload[i] = i * 0.5f;
+  }
+  {
+    std::error_code EC;
+    llvm::raw_fd_ostream out(path, EC, llvm::sys::fs::F_None);
+    ASSERT_FALSE(EC);
+    out.write(reinterpret_cast<char *>(payload), sizeof(payload));
+  }
+
+  MappedFile file;
+  ASSERT_TRUE(file.map(path));
+  EXPECT_EQ(file.size(), sizeof(payload));
+
+  // Alias the mapping with an unowned tensor and verify the contents.
+  Type ty(ElemKind::FloatTy, {2, 4});
+  Tensor weights(file.data(), &ty);
+  auto H = weights.getHandle<>();
+  for (unsigned i = 0; i < 8; i++) {
+    EXPECT_EQ(H.raw(i), i * 0.5f);
+  }
+
+  llvm::sys::fs::remove(path);
+}
+
+// Test the page-aligned allocation modes.
+TEST(Utils, pageAlignedAlloc) {
+  size_t pageSize = getPageSize();
+  EXPECT_GE(pageSize, 512);
+
+  for (bool pinned : {false, true}) {
+    void *ptr = pageAlignedAlloc(3 * pageSize + 100, pinned);
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) % pageSize, 0);
+    // The buffer must be usable across its entire requested size.
+    memset(ptr, 0xab, 3 * pageSize + 100);
+    pageAlignedFree(ptr, 3 * pageSize + 100);
+  }
+}
@@ -54,6 +54,30 @@ TEST_F(GraphOptz, DCE) {
   EXPECT_EQ(mod_.getVars().size(), 0);
 }
 
+/// Check that erasing one of two structurally identical nodes removes that
+/// exact node - not the first structural match - and that DCE therefore
+/// deletes the dead twin rather than the live one.
+TEST_F(GraphOptz, eraseStructurallyEqualTwin) {
+  Node *K = mod_.createVariable(ElemKind::FloatTy, {4, 10}, "input");
+  Node *live = F_->createRELU("relu_live", K);
+  Node *dead = F_->createRELU("relu_dead", K);
+  auto *save = F_->createSave("ret", live);
+  EXPECT_EQ(F_->getNodes().size(), 3);
+
+  F_->eraseNode(dead);
+
+  EXPECT_EQ(F_->getNodes().size(), 2);
+  bool liveFound = false;
+  for (auto &N : F_->getNodes()) {
+    liveFound |= &N == live;
+  }
+  EXPECT_TRUE(liveFound);
+
+  // The live twin still feeds the save and survives the optimizer.
+  ::glow::optimize(F_, CompilationMode::Infer);
+  EXPECT_EQ(save->getInput().getNode(), live);
+}
+
 TEST_F(GraphOptz, liveCodeNotEliminated) {
   Node *K = mod_.createVariable(ElemKind::FloatTy, {4, 320, 200, 3}, "input");
   auto *Ex = mod_.createVariable(ElemKind::IndexTy, {4, 1}, "Ex");
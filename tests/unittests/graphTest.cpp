@@ -159,7 +159,7 @@ TEST(Graph, useListIteration) {
   // Check that the first user of K is conv1.
   EXPECT_EQ(K->getUsers().begin()->getUser(), conv1);
   // Check that the second user of K is conv2.
-  EXPECT_EQ((++K->getUsers().begin())->getUser(), conv2);
+  EXPECT_EQ(K->getUsers()[1].getUser(), conv2);
 }
 
 TEST(Graph, simpleTestFC) {
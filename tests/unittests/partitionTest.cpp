@@ -163,6 +163,170 @@ TEST_F(PartitionTest, Train) {
   ASSERT_EQ(G.getFunctions().size(), 6);
 }
 
+TEST_F(PartitionTest, Boundaries) {
+  auto *input =
+      mod_.createVariable(ElemKind::FloatTy, {1, 8}, "input",
+                          VisibilityKind::Public, Variable::TrainKind::None);
+  auto *FC1 = F_->createFullyConnected("fc1", input, 8);
+  auto *FC2 = F_->createFullyConnected("fc2", FC1, 8);
+  F_->createSave("save", FC2);
+
+  auto G = glow::partition(F_);
+  ASSERT_EQ(G.getFunctions().size(), 2);
+  ASSERT_EQ(G.getBoundaries().size(), 1);
+
+  // Each boundary is a pair of distinct public variables of the same type,
+  // so the executor can copy the out side into the in side while the
+  // producer already overwrites the out side with the next batch.
+  for (const auto &b : G.getBoundaries()) {
+    EXPECT_NE(b.out, b.in);
+    EXPECT_EQ(b.out->getType(), b.in->getType());
+    EXPECT_EQ(b.out->getVisibilityKind(), VisibilityKind::Public);
+    EXPECT_EQ(b.in->getVisibilityKind(), VisibilityKind::Public);
+    EXPECT_NE(b.producer, b.consumer);
+  }
+}
+
+TEST_F(PartitionTest, DAGExecution) {
+  auto *input =
+      mod_.createVariable(ElemKind::FloatTy, {1, 32}, "input",
+                          VisibilityKind::Public, Variable::TrainKind::None);
+
+  // Initial FC.
+  Node *I = F_->createFullyConnected("initial_fc", input, 16);
+  I = F_->createSigmoid("initial_sigmoid", I);
+
+  // Left branch.
+  Node *L = F_->createFullyConnected("left_fc", I, 16);
+  L = F_->createSigmoid("left_sigmoid", L);
+
+  // Right branch.
+  Node *R = F_->createFullyConnected("right_fc", I, 16);
+  R = F_->createSigmoid("right_sigmoid", R);
+
+  // Join branches.
+  auto *mul = F_->createMul("mul", L, R);
+  auto *save = F_->createSave("ret", mul);
+  auto &res = save->getVariable()->getPayload();
+
+  auto G = glow::partition(F_);
+  ASSERT_EQ(G.getFunctions().size(), 4);
+
+  Tensor in(ElemKind::FloatTy, {1, 32});
+  in.getHandle().randomize(-1.0, 1.0, mod_.getPRNG());
+
+  // Infer using the un-partitioned graph.
+  ExecutionEngine refEE;
+  refEE.compile(CompilationMode::Infer, F_);
+  refEE.run({input}, {&in});
+  Tensor ref = res.clone();
+
+  // Infer over the compiled partitions.
+  ExecutionEngine EE;
+  EE.compileDAG(CompilationMode::Infer, G);
+  EE.runDAG({input}, {&in});
+  Tensor test = res.clone();
+  EXPECT_TRUE(ref.isEqual(test));
+}
+
+TEST_F(PartitionTest, DAGPipelinedBatches) {
+  auto *input =
+      mod_.createVariable(ElemKind::FloatTy, {1, 8}, "input",
+                          VisibilityKind::Public, Variable::TrainKind::None);
+  Node *I = F_->createFullyConnected("fc1", input, 8);
+  I = F_->createSigmoid("sigmoid1", I);
+  I = F_->createFullyConnected("fc2", I, 8);
+  I = F_->createSigmoid("sigmoid2", I);
+  auto *save = F_->createSave("ret", I);
+  auto &res = save->getVariable()->getPayload();
+
+  auto G = glow::partition(F_);
+  ASSERT_GE(G.getFunctions().size(), 2);
+
+  const size_t numBatches = 3;
+  Tensor in(ElemKind::FloatTy, {numBatches, 8});
+  in.getHandle().randomize(-1.0, 1.0, mod_.getPRNG());
+
+  // After the pipeline drains, the result variable holds the output of the
+  // last batch. Compute that output with the un-partitioned graph.
+  Tensor lastBatch(ElemKind::FloatTy, {1, 8});
+  for (size_t j = 0; j < 8; j++) {
+    lastBatch.getHandle().at({0, j}) =
+        in.getHandle().at({numBatches - 1, j});
+  }
+  ExecutionEngine refEE;
+  refEE.compile(CompilationMode::Infer, F_);
+  refEE.run({input}, {&lastBatch});
+  Tensor ref = res.clone();
+
+  // Pipeline the batches through the compiled partitions.
+  ExecutionEngine EE;
+  EE.compileDAG(CompilationMode::Infer, G);
+  EE.runDAGBatch(numBatches, {input}, {&in});
+  Tensor test = res.clone();
+  EXPECT_TRUE(ref.isEqual(test));
+}
+
+TEST_F(PartitionTest, HeterogeneousDAGExecution) {
+  auto *input =
+      mod_.createVariable(ElemKind::FloatTy, {1, 8}, "input",
+                          VisibilityKind::Public, Variable::TrainKind::None);
+  Node *I = F_->createFullyConnected("fc1", input, 8);
+  I = F_->createSigmoid("sigmoid1", I);
+  I = F_->createFullyConnected("fc2", I, 8);
+  I = F_->createSigmoid("sigmoid2", I);
+  auto *save = F_->createSave("ret", I);
+  auto &res = save->getVariable()->getPayload();
+
+  auto G = glow::partition(F_);
+  ASSERT_GE(G.getFunctions().size(), 2);
+
+  Tensor in(ElemKind::FloatTy, {1, 8});
+  in.getHandle().randomize(-1.0, 1.0, mod_.getPRNG());
+
+  // Infer using the un-partitioned graph.
+  ExecutionEngine refEE;
+  refEE.compile(CompilationMode::Infer, F_);
+  refEE.run({input}, {&in});
+  Tensor ref = res.clone();
+
+  // Compile every partition with a private backend instance of its
+  // assigned kind and run the mixed stages.
+  ExecutionEngine EE;
+  auto kinds = EE.assignDAGBackends(G, BackendKind::Interpreter,
+                                    BackendKind::Interpreter);
+  ASSERT_EQ(kinds.size(), G.getFunctions().size());
+  EE.compileDAG(CompilationMode::Infer, G, kinds);
+  EE.runDAG({input}, {&in});
+  Tensor test = res.clone();
+  EXPECT_TRUE(ref.isEqual(test));
+}
+
+#ifdef GLOW_WITH_CPU
+TEST_F(PartitionTest, AssignDAGBackendsKeepsTailsOnFallback) {
+  auto *input =
+      mod_.createVariable(ElemKind::FloatTy, {1, 8}, "input",
+                          VisibilityKind::Public, Variable::TrainKind::None);
+  auto *FC1 = F_->createFullyConnected("fc1", input, 8);
+  auto *FC2 = F_->createFullyConnected("fc2", FC1, 8);
+  auto *add = F_->createAdd("add", FC1, FC2);
+  F_->createSave("save", add);
+
+  auto G = glow::partition(F_);
+  ASSERT_EQ(G.getFunctions().size(), 3);
+
+  // The FC partitions carry dense compute and go to the preferred backend;
+  // the add/save tail is data movement and stays on the fallback.
+  ExecutionEngine EE;
+  auto kinds =
+      EE.assignDAGBackends(G, BackendKind::CPU, BackendKind::Interpreter);
+  ASSERT_EQ(kinds.size(), 3);
+  EXPECT_EQ(kinds[0], BackendKind::CPU);
+  EXPECT_EQ(kinds[1], BackendKind::CPU);
+  EXPECT_EQ(kinds[2], BackendKind::Interpreter);
+}
+#endif // GLOW_WITH_CPU
+
 TEST_F(PartitionTest, VerifyTopo) {
   auto *F1 = mod_.createFunction("F1");
   auto *F2 = mod_.createFunction("F2");
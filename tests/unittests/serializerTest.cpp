@@ -0,0 +1,116 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "glow/ExecutionEngine/ExecutionEngine.h"
+#include "glow/Graph/Graph.h"
+#include "glow/Graph/Nodes.h"
+#include "glow/Graph/Serializer.h"
+
+#include "gtest/gtest.h"
+
+#include "llvm/Support/FileSystem.h"
+
+using namespace glow;
+
+/// \returns the path of a fresh temporary file with the suffix \p suffix.
+static std::string makeTempFile(llvm::StringRef suffix) {
+  llvm::SmallString<64> path;
+  EXPECT_FALSE(llvm::sys::fs::createTemporaryFile("serializer", suffix, path));
+  return path.str().str();
+}
+
+/// Build a small inference network into \p F: an FC layer followed by a
+/// RELU, saved into a variable named "ret".
+static Variable *buildNetwork(Module &mod, Function *F) {
+  auto *input =
+      mod.createVariable(ElemKind::FloatTy, {1, 8}, "input",
+                         VisibilityKind::Public, Variable::TrainKind::None);
+  Node *O = F->createFullyConnected("fc", input, 6);
+  O = F->createRELU("relu", O);
+  F->createSave("ret", O);
+  return input;
+}
+
+TEST(Serializer, roundTripStructure) {
+  ExecutionEngine EE;
+  auto &mod = EE.getModule();
+  auto *F = mod.createFunction("main");
+  buildNetwork(mod, F);
+
+  auto graphFile = makeTempFile("graph");
+  auto weightsFile = makeTempFile("weights");
+  saveFunction(*F, graphFile, weightsFile);
+
+  ExecutionEngine EE2;
+  auto &mod2 = EE2.getModule();
+  auto *F2 = mod2.createFunction("loaded");
+  auto mapping = loadFunction(*F2, graphFile, weightsFile);
+  ASSERT_TRUE(mapping != nullptr);
+
+  // The loaded function has the same nodes, and every variable round-trips
+  // with its name, type and payload.
+  EXPECT_EQ(F2->getNodes().size(), F->getNodes().size());
+  EXPECT_EQ(mod2.getVars().size(), mod.getVars().size());
+  for (auto *V : mod.getVars()) {
+    auto *V2 = mod2.getVariableByName(V->getName());
+    ASSERT_TRUE(V2 != nullptr);
+    EXPECT_TRUE(V2->getType()->isEqual(*V->getType()));
+    EXPECT_TRUE(V2->getPayload().isEqual(V->getPayload()));
+  }
+
+  llvm::sys::fs::remove(graphFile);
+  llvm::sys::fs::remove(weightsFile);
+}
+
+TEST(Serializer, roundTripInference) {
+  ExecutionEngine EE;
+  auto &mod = EE.getModule();
+  auto *F = mod.createFunction("main");
+  auto *input = buildNetwork(mod, F);
+  input->getPayload().getHandle().randomize(-1.0, 1.0, mod.getPRNG());
+
+  // Save before compiling: the serializer captures the graph, and the
+  // compilation below optimizes the original function in place.
+  auto graphFile = makeTempFile("graph");
+  auto weightsFile = makeTempFile("weights");
+  saveFunction(*F, graphFile, weightsFile);
+
+  // Reference: run the original function. The input values were baked into
+  // the saved payloads, so no inputs need to be bound.
+  EE.compile(CompilationMode::Infer, F);
+  EE.run({}, {});
+  Tensor ref = mod.getVariableByName("ret")->getPayload().clone();
+
+  // Load into a fresh module and run the loaded graph.
+  ExecutionEngine EE2;
+  auto &mod2 = EE2.getModule();
+  auto *F2 = mod2.createFunction("loaded");
+  auto mapping = loadFunction(*F2, graphFile, weightsFile);
+  ASSERT_TRUE(mapping != nullptr);
+
+  // The loaded payloads alias the read-only mapping; give the output
+  // variable an owned payload to receive the results.
+  auto *ret2 = mod2.getVariableByName("ret");
+  ret2->getPayload().reset(*ret2->getType());
+
+  EE2.compile(CompilationMode::Infer, F2);
+  EE2.run({}, {});
+
+  EXPECT_TRUE(ref.isEqual(ret2->getPayload()));
+
+  llvm::sys::fs::remove(graphFile);
+  llvm::sys::fs::remove(weightsFile);
+}
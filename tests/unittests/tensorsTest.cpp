@@ -112,6 +112,21 @@ TEST(Tensor, isZero) {
   }
 }
 
+TEST(Tensor, clearAndZero) {
+  // Use a size that is not a multiple of the block sizes used by the fill
+  // fast paths.
+  Tensor T(ElemKind::FloatTy, {3, 101});
+  auto H = T.getHandle<>();
+
+  H.clear(1.5);
+  for (size_t i = 0, e = H.size(); i < e; i++) {
+    EXPECT_EQ(H.raw(i), 1.5);
+  }
+
+  T.zero();
+  EXPECT_TRUE(H.isZero());
+}
+
 TEST(Tensor, inBounds) {
   Tensor A(ElemKind::FloatTy, {15, 5, 3});
 
@@ -618,3 +633,100 @@ TEST(Type, compare) {
   EXPECT_FALSE(T1.isEqual(T3));
   EXPECT_FALSE(T1.isEqual(T4));
 }
+
+TEST(Tensor, stridedViews) {
+  // 2x3x4 tensor filled with consecutive numbers.
+  Tensor T(ElemKind::FloatTy, {2, 3, 4});
+  auto H = T.getHandle<>();
+  for (size_t i = 0, e = H.size(); i < e; i++) {
+    H.raw(i) = i;
+  }
+
+  // A view of a single batch element is contiguous.
+  Tensor batch = T.getUnownedView({1, 3, 4}, {1, 0, 0});
+  EXPECT_TRUE(batch.isContiguous());
+  auto BH = batch.getHandle<>();
+  EXPECT_EQ(BH.at({0, 0, 0}), H.at({1, 0, 0}));
+  EXPECT_EQ(BH.at({0, 2, 3}), H.at({1, 2, 3}));
+
+  // A channel split is not contiguous, but aliases the same data.
+  Tensor split = T.getUnownedView({2, 3, 2}, {0, 0, 1});
+  EXPECT_FALSE(split.isContiguous());
+  auto SH = split.getHandle<>();
+  for (size_t n = 0; n < 2; n++) {
+    for (size_t h = 0; h < 3; h++) {
+      for (size_t c = 0; c < 2; c++) {
+        EXPECT_EQ(SH.at({n, h, c}), H.at({n, h, c + 1}));
+      }
+    }
+  }
+
+  // Writes through the view are visible in the parent tensor.
+  SH.at({1, 2, 0}) = -1.0f;
+  EXPECT_EQ(H.at({1, 2, 1}), -1.0f);
+}
+
+TEST(Tensor, float16) {
+  // Exact small values survive the round trip unchanged.
+  Tensor T(ElemKind::Float16Ty, {4});
+  auto H = T.getHandle<float16_t>();
+  H.at({0}) = 0.5f;
+  H.at({1}) = -2.0f;
+  H.at({2}) = 0.0f;
+  H.at({3}) = 100.0f;
+  EXPECT_EQ(float(H.at({0})), 0.5f);
+  EXPECT_EQ(float(H.at({1})), -2.0f);
+  EXPECT_EQ(float(H.at({2})), 0.0f);
+  EXPECT_EQ(float(H.at({3})), 100.0f);
+
+  // Arithmetic accumulates in fp32.
+  EXPECT_EQ(float(H.at({0})) + float(H.at({1})), -1.5f);
+
+  // Converting a float tensor to float16 and back loses at most the
+  // precision of the 10-bit mantissa.
+  PseudoRNG PRNG;
+  Tensor A(ElemKind::FloatTy, {10, 10});
+  A.getHandle<>().randomize(-10, 10, PRNG);
+  Tensor halfA = A.getCopyConvertedToType(ElemKind::Float16Ty);
+  EXPECT_EQ(halfA.getElementType(), ElemKind::Float16Ty);
+  Tensor backA = halfA.getCopyConvertedToType(ElemKind::FloatTy);
+  EXPECT_TRUE(A.isEqual(backA, 0.01));
+}
+
+TEST(Tensor, hashAndBitwiseEqual) {
+  PseudoRNG PRNG;
+  Tensor A(ElemKind::FloatTy, {7, 13});
+  A.getHandle<>().randomize(-1, 1, PRNG);
+
+  Tensor B;
+  B.copyFrom(&A);
+  EXPECT_TRUE(A.isBitwiseEqual(B));
+  EXPECT_EQ(A.hash(), B.hash());
+
+  // A single flipped element changes both the comparison and the hash.
+  B.getHandle<>().at({3, 5}) += 1.0f;
+  EXPECT_FALSE(A.isBitwiseEqual(B));
+  EXPECT_NE(A.hash(), B.hash());
+
+  // Tensors of different types never compare equal.
+  Tensor C(ElemKind::FloatTy, {13, 7});
+  EXPECT_FALSE(A.isBitwiseEqual(C));
+}
+
+TEST(Tensor, copyOnWriteClone) {
+  PseudoRNG PRNG;
+  Tensor A(ElemKind::FloatTy, {8, 8});
+  A.getHandle<>().randomize(-1, 1, PRNG);
+
+  Tensor B = A.clone();
+  Tensor C = B.clone();
+  EXPECT_TRUE(A.isBitwiseEqual(B));
+  EXPECT_TRUE(A.isBitwiseEqual(C));
+
+  // Writing through one tensor must not change its clones.
+  float orig = A.getHandle<>().at({3, 3});
+  A.getHandle<>().at({3, 3}) = orig + 10;
+  EXPECT_EQ(B.getHandle<>().at({3, 3}), orig);
+  EXPECT_EQ(C.getHandle<>().at({3, 3}), orig);
+  EXPECT_EQ(A.getHandle<>().at({3, 3}), orig + 10);
+}
@@ -23,6 +23,55 @@ BB.newBackendSpecificInstr("CPUMaxSplat")
     .dataParallel()
     .autoIRGen();
 
+BB.newBackendSpecificInstr("CPUMulSplat")
+    .addOperand("Dest", OperandKind::Out)
+    .addOperand("Src", OperandKind::In)
+    .addMember(MemberType::Float, "SplatValue")
+    .inplaceOperand({"Dest", "Src"})
+    .dataParallel()
+    .autoIRGen();
+
+BB.newBackendSpecificInstr("CPUSubSplat")
+    .addOperand("Dest", OperandKind::Out)
+    .addOperand("Src", OperandKind::In)
+    .addMember(MemberType::Float, "SplatValue")
+    .inplaceOperand({"Dest", "Src"})
+    .dataParallel()
+    .autoIRGen();
+
+BB.newBackendSpecificInstr("CPUConvPool")
+    .addOperand("Dest", OperandKind::Out)
+    .addOperand("Src", OperandKind::In)
+    .addOperand("Filter", OperandKind::In)
+    .addOperand("Bias", OperandKind::In)
+    .addMember(MemberType::SizeT, "ConvKernel")
+    .addMember(MemberType::SizeT, "ConvStride")
+    .addMember(MemberType::VectorSizeT, "ConvPads")
+    .addMember(MemberType::SizeT, "Group")
+    .addMember(MemberType::Unsigned, "DoRelu")
+    .addMember(MemberType::SizeT, "PoolKernel")
+    .addMember(MemberType::SizeT, "PoolStride")
+    .addMember(MemberType::VectorSizeT, "PoolPads")
+    .autoIRGen();
+
+BB.newBackendSpecificInstr("CPUConvRelu")
+    .addOperand("Dest", OperandKind::Out)
+    .addOperand("Src", OperandKind::In)
+    .addOperand("Filter", OperandKind::In)
+    .addOperand("Bias", OperandKind::In)
+    .addMember(MemberType::SizeT, "Kernel")
+    .addMember(MemberType::SizeT, "Stride")
+    .addMember(MemberType::VectorSizeT, "Pads")
+    .addMember(MemberType::SizeT, "Group")
+    .autoIRGen();
+
+BB.newBackendSpecificInstr("CPUFCRelu")
+    .addOperand("Dest", OperandKind::Out)
+    .addOperand("Src", OperandKind::In)
+    .addOperand("Weights", OperandKind::In)
+    .addOperand("Bias", OperandKind::In)
+    .autoIRGen();
+
 BB.newBackendSpecificInstr("CPUConvDKKC8")
     .addOperand("Dest", OperandKind::Out)
     .addOperand("Src", OperandKind::In)
@@ -20,6 +20,49 @@ void CPUMaxSplatInst::verify() const {
   assert(getSrc()->dims() == getDest()->dims() && "Invalid shape");
 }
 
+void CPUMulSplatInst::verify() const {
+  assert(getSrc()->getType() == getDest()->getType() && "Invalid type");
+  assert(getSrc()->dims() == getDest()->dims() && "Invalid shape");
+}
+
+void CPUSubSplatInst::verify() const {
+  assert(getSrc()->getType() == getDest()->getType() && "Invalid type");
+  assert(getSrc()->dims() == getDest()->dims() && "Invalid shape");
+}
+
+void CPUConvPoolInst::verify() const {
+  assert(getSrc()->dims()[3] % getGroup() == 0 &&
+         "Input channels must be divisible by group.");
+  assert(getDest()->getElementType() == ElemKind::FloatTy &&
+         "Invalid Element Type");
+  assert(getSrc()->getElementType() == getFilter()->getElementType() &&
+         "Invalid Element Type");
+  assert(getSrc()->getElementType() == getBias()->getElementType() &&
+         "Invalid Element Type");
+}
+
+void CPUConvReluInst::verify() const {
+  assert(getSrc()->dims()[3] % getGroup() == 0 &&
+         "Input channels must be divisible by group.");
+  assert(getDest()->dims()[3] % getGroup() == 0 &&
+         "Output channels must be divisible by group.");
+  assert(getDest()->getElementType() == ElemKind::FloatTy &&
+         "Invalid Element Type");
+  assert(getSrc()->getElementType() == getFilter()->getElementType() &&
+         "Invalid Element Type");
+  assert(getSrc()->getElementType() == getBias()->getElementType() &&
+         "Invalid Element Type");
+}
+
+void CPUFCReluInst::verify() const {
+  assert(getDest()->getElementType() == ElemKind::FloatTy &&
+         "Invalid Element Type");
+  assert(getSrc()->getElementType() == getWeights()->getElementType() &&
+         "Invalid Element Type");
+  assert(getSrc()->getElementType() == getBias()->getElementType() &&
+         "Invalid Element Type");
+}
+
 void CPUConvDKKC8Inst::verify() const {
   assert(getSrc()->dims()[3] % getGroup() == 0 &&
          "Input channels must be divisible by group.");
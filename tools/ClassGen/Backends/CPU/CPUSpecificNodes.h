@@ -21,6 +21,59 @@ BB.newBackendSpecificNode("CPUMaxSplat")
     .addMember(MemberType::Float, "SplatValue")
     .setDocstring("A Max node with one splat input; CPU specific.");
 
+BB.newBackendSpecificNode("CPUMulSplat")
+    .addInput("Input")
+    .addResult("Input.getType()")
+    .addMember(MemberType::Float, "SplatValue")
+    .setDocstring("A Mul node with one splat input; CPU specific.");
+
+BB.newBackendSpecificNode("CPUSubSplat")
+    .addInput("Input")
+    .addResult("Input.getType()")
+    .addMember(MemberType::Float, "SplatValue")
+    .setDocstring("A Sub node subtracting a splat value from its input; "
+                  "CPU specific.");
+
+BB.newBackendSpecificNode("CPUConvPool")
+    .addInput("Input")
+    .addInput("Filter")
+    .addInput("Bias")
+    .addMember(MemberType::SizeT, "ConvKernel")
+    .addMember(MemberType::SizeT, "ConvStride")
+    .addMember(MemberType::VectorSizeT, "ConvPads")
+    .addMember(MemberType::SizeT, "Group")
+    .addMember(MemberType::Unsigned, "DoRelu")
+    .addMember(MemberType::SizeT, "PoolKernel")
+    .addMember(MemberType::SizeT, "PoolStride")
+    .addMember(MemberType::VectorSizeT, "PoolPads")
+    .addResultFromCtorArg()
+    .setDocstring("A convolution, an optional relu and a max-pool executed as "
+                  "one kernel. The convolution activation is materialized in "
+                  "cache-resident row strips that the pool consumes in place; "
+                  "it never exists in memory as a whole tensor.");
+
+BB.newBackendSpecificNode("CPUConvRelu")
+    .addInput("Input")
+    .addInput("Filter")
+    .addInput("Bias")
+    .addMember(MemberType::SizeT, "Kernel")
+    .addMember(MemberType::SizeT, "Stride")
+    .addMember(MemberType::VectorSizeT, "Pads")
+    .addMember(MemberType::SizeT, "Group")
+    .addResultFromCtorArg()
+    .setDocstring("A convolution with a fused relu. The activation is applied "
+                  "in the accumulator epilogue of the convolution kernel "
+                  "instead of a separate pass over the output.");
+
+BB.newBackendSpecificNode("CPUFCRelu")
+    .addInput("Input")
+    .addInput("Weights")
+    .addInput("Bias")
+    .addResultFromCtorArg()
+    .setDocstring("A fully-connected layer with a fused relu: "
+                  "relu(Input * Weights + Bias). The bias and the activation "
+                  "are applied while the output tile is still cache resident.");
+
 BB.newNode("CPUConvDKKC8")
     .addInput("Input")
     .addInput("Filter")
@@ -20,6 +20,51 @@ void CPUMaxSplatNode::verify() const {
   assert(getInput().dims() == getResult().dims() && "Invalid shape");
 }
 
+void CPUMulSplatNode::verify() const {
+  assert(getInput().getType() == getResult().getType() && "Invalid type");
+  assert(getInput().dims() == getResult().dims() && "Invalid shape");
+}
+
+void CPUSubSplatNode::verify() const {
+  assert(getInput().getType() == getResult().getType() && "Invalid type");
+  assert(getInput().dims() == getResult().dims() && "Invalid shape");
+}
+
+void CPUConvPoolNode::verify() const {
+  ShapeNHWC idim(getInput().getType()->dims());
+  ShapeNHWC odim(getResult().getType()->dims());
+  auto convSz = calculateConvPoolOutputDims(idim.h, idim.w, getConvKernel(),
+                                            getConvStride(), getConvPads());
+  auto poolSz = calculateConvPoolOutputDims(convSz.first, convSz.second,
+                                            getPoolKernel(), getPoolStride(),
+                                            getPoolPads());
+  ShapeNHWC exp(idim.n, poolSz.first, poolSz.second, getBias().dims()[0]);
+  (void)exp;
+  assert(exp == odim && "Invalid output dimensions");
+}
+
+void CPUConvReluNode::verify() const {
+  ShapeNHWC idim(getInput().getType()->dims());
+  ShapeNHWC odim(getResult().getType()->dims());
+  auto outSz = calculateConvPoolOutputDims(idim.h, idim.w, getKernel(),
+                                           getStride(), getPads());
+  ShapeNHWC exp(idim.n, outSz.first, outSz.second, getBias().dims()[0]);
+  (void)exp;
+  assert(exp == odim && "Invalid output dimensions");
+}
+
+void CPUFCReluNode::verify() const {
+  assert(getInput().dims().size() == 2 && "Input must be 2 dimensional.");
+  assert(getWeights().dims().size() == 2 && "Weights must be 2 dimensional.");
+  assert(getInput().dims()[1] == getWeights().dims()[0] &&
+         "Mismatch on dimensions.");
+  assert(getBias().dims()[0] == getWeights().dims()[1] &&
+         "Inconsistent bias dimensions.");
+  assert(getResult().dims()[0] == getInput().dims()[0] &&
+         getResult().dims()[1] == getWeights().dims()[1] &&
+         "Invalid output dimensions");
+}
+
 void CPUConvDKKC8Node::verify() const {
   ShapeNHWC idim(getInput().getType()->dims());
   ShapeNHWC odim(getResult().getType()->dims());
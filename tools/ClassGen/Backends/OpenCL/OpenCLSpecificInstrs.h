@@ -27,6 +27,17 @@ BB.newBackendSpecificInstr("OCLConvolution")
     .autoIRGen()
     .autoVerify(VerifyKind::SameElementType, {"Dest", "Src", "Filter", "Bias"});
 
+BB.newBackendSpecificInstr("OCLConvolutionRelu")
+    .addOperand("Dest", OperandKind::Out)
+    .addOperand("Src", OperandKind::In)
+    .addOperand("Filter", OperandKind::In)
+    .addOperand("Bias", OperandKind::In)
+    .addMember(MemberType::SizeT, "Kernel")
+    .addMember(MemberType::SizeT, "Stride")
+    .addMember(MemberType::VectorSizeT, "Pads")
+    .autoIRGen()
+    .autoVerify(VerifyKind::SameElementType, {"Dest", "Src", "Filter", "Bias"});
+
 BB.newBackendSpecificInstr("OCLPoolAvg")
     .addOperand("Dest", OperandKind::Out)
     .addOperand("Src", OperandKind::In)
@@ -28,6 +28,19 @@ BB.newNode("OCLConvolution")
         "This is an OpenCL-specific convolution implementation where the "
         "filter, the bias and the input are in the HCHW format");
 
+BB.newNode("OCLConvolutionRelu")
+    .addInput("Input")
+    .addInput("Filter")
+    .addInput("Bias")
+    .addMember(MemberType::SizeT, "Kernel")
+    .addMember(MemberType::SizeT, "Stride")
+    .addMember(MemberType::VectorSizeT, "Pads")
+    .addResultFromCtorArg()
+    .setDocstring(
+        "An OCLConvolution with a fused relu. The activation is applied in "
+        "the epilogue of the convolution kernel while the result is still in "
+        "registers, so it never round-trips through global memory");
+
 BB.newNode("OCLPoolAvg")
     .addInput("Input")
     .addMember(MemberType::SizeT, "Kernel")
@@ -26,6 +26,16 @@ void OCLConvolutionNode::verify() const {
   assert(exp == odim && "Invalid output dimensions");
 }
 
+void OCLConvolutionReluNode::verify() const {
+  ShapeNCHW idim(getInput().getType()->dims());
+  ShapeNCHW odim(getResult().getType()->dims());
+  auto outSz = calculateConvPoolOutputDims(idim.h, idim.w, getKernel(),
+                                           getStride(), getPads());
+  ShapeNCHW exp(idim.n, getBias().dims()[0], outSz.first, outSz.second);
+  (void)exp;
+  assert(exp == odim && "Invalid output dimensions");
+}
+
 void OCLPoolAvgNode::verify() const {}
 
 void OCLPoolMaxNode::verify() const {}
@@ -37,7 +37,7 @@ void InstrBuilder::emitCtor(std::ostream &os) const {
 
   // Extra class members:
   for (const auto &op : members_) {
-    os << ", " << getStorageTypename(op.first) << " " << op.second;
+    os << ", " << getCtorArgTypename(op.first) << " " << op.second;
   }
 
   // Initialize the base clases:
@@ -53,6 +53,11 @@ void InstrBuilder::emitCtor(std::ostream &os) const {
 
   // Initialize the members:
   for (const auto &op : members_) {
+    if (isVectorType(op.first)) {
+      os << ", " << op.second << "_(" << op.second << ".begin(), " << op.second
+         << ".end())";
+      continue;
+    }
     os << ", " << op.second << "_(" << op.second << ")";
   }
 
@@ -76,8 +81,8 @@ void InstrBuilder::emitIRBuilderMethods(std::ostream &osH,
 
   // Extra class members:
   for (const auto &op : members_) {
-    osH << ", " << getStorageTypename(op.first) << " " << op.second;
-    osB << ", " << getStorageTypename(op.first) << " " << op.second;
+    osH << ", " << getCtorArgTypename(op.first) << " " << op.second;
+    osB << ", " << getCtorArgTypename(op.first) << " " << op.second;
   }
 
   osH << ");\n";
@@ -237,6 +242,13 @@ void InstrBuilder::emitClass(std::ostream &os) const {
         }
         break;
       }
+      case VerifyKind::IndexElementType: {
+        for (size_t i = 0, e = pair.second.size(); i < e; i++) {
+          os << "    assert(get" << pair.second[i]
+             << "()->getType()->isIndexType() && \"Invalid Element Type\");\n";
+        }
+        break;
+      }
       case VerifyKind::NoVerify: {
         assert(autoVerificationPairs_.size() == 1);
         os << "    // Nothing to verify.\n";
@@ -266,13 +278,41 @@ InstrBuilder::~InstrBuilder() {
   emitCppMethods(cppStream);
   emitIRBuilderMethods(builderHeaderStream, builderCppStream);
   emitAutoIRGen(irGenStream);
+  emitDataParallelKernel(kernelsStream);
+}
+
+void InstrBuilder::emitDataParallelKernel(std::ostream &os) const {
+  if (!isDataParallel_ || scalarKernel_.empty()) {
+    return;
+  }
+  // Collect the input buffers of the kernel: the In operands, in order.
+  std::vector<std::string> ins;
+  for (const auto &op : operands_) {
+    if (op.second == OperandKind::In) {
+      ins.push_back(op.first);
+    }
+  }
+  // An instruction with a float member passes it to the kernel as the
+  // scalar immediate.
+  bool hasImm = false;
+  for (const auto &op : members_) {
+    if (op.first == MemberType::Float) {
+      hasImm = true;
+    }
+  }
+  os << "DEF_DATA_PARALLEL_KERNEL_" << ins.size() << (hasImm ? "_IMM" : "")
+     << "(" << name_ << ", " << glow::tolower(name_) << ", " << scalarKernel_;
+  for (const auto &in : ins) {
+    os << ", " << in;
+  }
+  os << ")\n";
 }
 
 void InstrBuilder::addGradientInstr(
     llvm::ArrayRef<llvm::StringRef> originalFields,
     llvm::ArrayRef<llvm::StringRef> gradFields) {
   InstrBuilder GI(headerStream, cppStream, defStream, builderHeaderStream,
-                  builderCppStream, irGenStream, name_ + "Grad",
+                  builderCppStream, irGenStream, kernelsStream, name_ + "Grad",
                   isBackendSpecific_);
 
   // The new 'Grad' class will have all of the fields of the current class.
@@ -38,6 +38,7 @@ enum class VerifyKind : unsigned char {
   SameShape,
   SameType,
   SameElementType,
+  IndexElementType,
   NoVerify,
 };
 
@@ -92,12 +93,20 @@ class InstrBuilder {
   std::ofstream &builderCppStream;
   /// The IRGen stream.
   std::ofstream &irGenStream;
+  /// The data-parallel kernels stream.
+  std::ofstream &kernelsStream;
 
   /// Specifies if this Instr is backend specific.
   bool isBackendSpecific_{false};
 
   bool isDataParallel_{false};
 
+  /// The scalar expression that computes one output element of a
+  /// data-parallel instruction, written in terms of the In-operand names
+  /// indexed with 'i' (e.g. "LHS[i] + RHS[i]") and 'imm' for the
+  /// instruction's float member. If empty, no kernel is generated.
+  std::string scalarKernel_;
+
   /// \returns the index of the operand with the name \p name. Aborts if no such
   /// name.
   unsigned getOperandIndexByName(llvm::StringRef name) const;
@@ -105,10 +114,11 @@ class InstrBuilder {
 public:
   InstrBuilder(std::ofstream &H, std::ofstream &C, std::ofstream &D,
                std::ofstream &BH, std::ofstream &BC, std::ofstream &I,
-               const std::string &name, bool isBackendSpecific)
+               std::ofstream &K, const std::string &name,
+               bool isBackendSpecific)
       : name_(name), headerStream(H), cppStream(C), defStream(D),
         builderHeaderStream(BH), builderCppStream(BC), irGenStream(I),
-        isBackendSpecific_(isBackendSpecific) {
+        kernelsStream(K), isBackendSpecific_(isBackendSpecific) {
     defStream << (isBackendSpecific_ ? "DEF_BACKEND_SPECIFIC_INSTR("
                                      : "DEF_INSTR(")
               << name << "Inst, " << glow::tolower(name) << ")\n";
@@ -170,7 +180,10 @@ public:
   /// Automatically generates verification of type \p verif
   InstrBuilder &autoVerify(VerifyKind verif,
                            llvm::ArrayRef<llvm::StringRef> operands = {""}) {
-    if (verif != VerifyKind::NoVerify) {
+    // The unary verifications check every listed operand on its own; the
+    // relational ones need at least a pair.
+    if (verif != VerifyKind::NoVerify &&
+        verif != VerifyKind::IndexElementType) {
       assert(operands.size() > 1 && "Must list 2 or more operands.");
     }
     auto newPair = std::make_pair(verif, std::vector<std::string>());
@@ -185,6 +198,17 @@ public:
     return *this;
   }
 
+  /// Attach the scalar expression \p expr that computes one output element
+  /// of this data-parallel instruction. The expression refers to the
+  /// In-operand names indexed with 'i' (e.g. "LHS[i] + RHS[i]") and to the
+  /// instruction's float member as 'imm'. A kernel definition is emitted to
+  /// the data-parallel kernels file, from which the backends stamp out
+  /// SIMD-friendly elementwise loops.
+  InstrBuilder &scalarKernel(const std::string &expr) {
+    scalarKernel_ = expr;
+    return *this;
+  }
+
   ~InstrBuilder();
 
 private:
@@ -229,6 +253,10 @@ private:
 
   /// Adds a case to AutoIRGen for generating this Instr from a Node.
   void emitAutoIRGen(std::ostream &os) const;
+
+  /// Emits the data-parallel kernel definition for this instruction, if a
+  /// scalar kernel expression was attached.
+  void emitDataParallelKernel(std::ostream &os) const;
 };
 
 class Builder {
@@ -238,6 +266,7 @@ class Builder {
   std::ofstream &builderHeaderStream;
   std::ofstream &builderCppStream;
   std::ofstream &irGenStream;
+  std::ofstream &kernelsStream;
   // First defined instruction.
   std::string firstInstr;
   // Last defined instruction.
@@ -248,9 +277,10 @@ public:
   /// point to the header file, cpp file and enum definition file, as well as
   /// the builder and IR Gen files.
   Builder(std::ofstream &H, std::ofstream &C, std::ofstream &D,
-          std::ofstream &BH, std::ofstream &BC, std::ofstream &I)
+          std::ofstream &BH, std::ofstream &BC, std::ofstream &I,
+          std::ofstream &K)
       : headerStream(H), cppStream(C), defStream(D), builderHeaderStream(BH),
-        builderCppStream(BC), irGenStream(I) {
+        builderCppStream(BC), irGenStream(I), kernelsStream(K) {
     cppStream << "#include \"glow/IR/IR.h\"\n"
                  "#include \"glow/IR/Instrs.h\"\n"
                  "#include \"glow/Base/Type.h\"\n"
@@ -273,6 +303,32 @@ public:
                      << "#include \"glow/IR/IR.h\"\n"
                      << "#include \"glow/IR/Instrs.h\"\n\n"
                      << "using namespace glow;\n";
+
+    kernelsStream
+        << "// Data-parallel kernel definitions. Each line describes the\n"
+           "// scalar computation of one output element of a data-parallel\n"
+           "// instruction:\n"
+           "//   DEF_DATA_PARALLEL_KERNEL_<N>(CLASS, NAME, EXPR, IN...)\n"
+           "// where N is the number of input buffers, the INs name them,\n"
+           "// and EXPR computes element 'i' from those names. The _IMM\n"
+           "// variants additionally receive the instruction's float member\n"
+           "// as the scalar 'imm'. Consumers define the macros for the\n"
+           "// arities they care about; the rest default to nothing.\n"
+           "#ifndef DEF_DATA_PARALLEL_KERNEL_1\n"
+           "#define DEF_DATA_PARALLEL_KERNEL_1(CLASS, NAME, EXPR, A)\n"
+           "#endif\n"
+           "#ifndef DEF_DATA_PARALLEL_KERNEL_2\n"
+           "#define DEF_DATA_PARALLEL_KERNEL_2(CLASS, NAME, EXPR, A, B)\n"
+           "#endif\n"
+           "#ifndef DEF_DATA_PARALLEL_KERNEL_3\n"
+           "#define DEF_DATA_PARALLEL_KERNEL_3(CLASS, NAME, EXPR, A, B, C)\n"
+           "#endif\n"
+           "#ifndef DEF_DATA_PARALLEL_KERNEL_0_IMM\n"
+           "#define DEF_DATA_PARALLEL_KERNEL_0_IMM(CLASS, NAME, EXPR)\n"
+           "#endif\n"
+           "#ifndef DEF_DATA_PARALLEL_KERNEL_1_IMM\n"
+           "#define DEF_DATA_PARALLEL_KERNEL_1_IMM(CLASS, NAME, EXPR, A)\n"
+           "#endif\n";
   }
 
   ~Builder() {
@@ -284,6 +340,12 @@ public:
                  "#undef DEF_INSTR\n"
                  "#undef DEF_BACKEND_SPECIFIC_INSTR\n"
                  "#undef DEF_VALUE";
+
+    kernelsStream << "#undef DEF_DATA_PARALLEL_KERNEL_1\n"
+                     "#undef DEF_DATA_PARALLEL_KERNEL_2\n"
+                     "#undef DEF_DATA_PARALLEL_KERNEL_3\n"
+                     "#undef DEF_DATA_PARALLEL_KERNEL_0_IMM\n"
+                     "#undef DEF_DATA_PARALLEL_KERNEL_1_IMM\n";
   }
 
   /// Declare a new instruction and generate code for it.
@@ -293,7 +355,8 @@ public:
     lastInstr = name;
     const bool isBackendSpecific = false;
     return InstrBuilder(headerStream, cppStream, defStream, builderHeaderStream,
-                        builderCppStream, irGenStream, name, isBackendSpecific);
+                        builderCppStream, irGenStream, kernelsStream, name,
+                        isBackendSpecific);
   }
 
   /// Declare a new backend-specific instruction and generate code for it.
@@ -303,7 +366,8 @@ public:
     lastInstr = name;
     const bool isBackendSpecific = true;
     return InstrBuilder(headerStream, cppStream, defStream, builderHeaderStream,
-                        builderCppStream, irGenStream, name, isBackendSpecific);
+                        builderCppStream, irGenStream, kernelsStream, name,
+                        isBackendSpecific);
   }
 
   /// Declare the instruction in the def file but don't generate code for it.
@@ -20,16 +20,16 @@
 #include <iostream>
 
 int main(int argc, char **argv) {
-  if (argc != 7) {
-    std::cerr
-        << "Usage: " << argv[0]
-        << " header.h impl.cpp enums.def irbuilder.h irbuilder.cpp irgen.h\n";
+  if (argc != 8) {
+    std::cerr << "Usage: " << argv[0]
+              << " header.h impl.cpp enums.def irbuilder.h irbuilder.cpp "
+                 "irgen.h kernels.def\n";
     return -1;
   }
 
   std::cout << "Writing instr descriptors to:\n\t" << argv[1] << "\n\t"
             << argv[2] << "\n\t" << argv[3] << "\n\t" << argv[4] << "\n\t"
-            << argv[5] << "\n\t" << argv[6] << "\n";
+            << argv[5] << "\n\t" << argv[6] << "\n\t" << argv[7] << "\n";
 
   std::ofstream headerStream(argv[1]);
   std::ofstream cppStream(argv[2]);
@@ -37,9 +37,10 @@ int main(int argc, char **argv) {
   std::ofstream builderHeaderStream(argv[4]);
   std::ofstream builderCppStream(argv[5]);
   std::ofstream irGenStream(argv[6]);
+  std::ofstream kernelsStream(argv[7]);
 
   Builder BB(headerStream, cppStream, defStream, builderHeaderStream,
-             builderCppStream, irGenStream);
+             builderCppStream, irGenStream, kernelsStream);
 
   //===--------------------------------------------------------------------===//
   //               Memory / Buffer Management
@@ -70,7 +71,8 @@ int main(int argc, char **argv) {
       .addOperand("Src", OperandKind::In)
       .setType("Src->getType()")
       .inplaceOperand({"Dest", "Src"})
-      .dataParallel();
+      .dataParallel()
+      .scalarKernel("Src[i]");
 
   //===--------------------------------------------------------------------===//
   //                   Convolution / Pool / FC
@@ -172,6 +174,56 @@ int main(int argc, char **argv) {
       .addOperand("Labelsgrad", OperandKind::Out)
       .autoVerify(VerifyKind::NoVerify);
 
+  //===--------------------------------------------------------------------===//
+  //                      Training
+  //===--------------------------------------------------------------------===//
+
+  /// Applies one SGD update step to Weight in place: the gradient scaling,
+  /// the L1/L2 weight decay and the momentum (accumulated in Gsum) are
+  /// fused into a single pass over the buffers.
+  BB.newInstr("SGD")
+      .addOperand("Gradient", OperandKind::In)
+      .addOperand("Weight", OperandKind::InOut)
+      .addOperand("Gsum", OperandKind::InOut)
+      .addMember(MemberType::Float, "L1Decay")
+      .addMember(MemberType::Float, "L2Decay")
+      .addMember(MemberType::Float, "LearningRate")
+      .addMember(MemberType::Float, "Momentum")
+      .addMember(MemberType::Unsigned, "BatchSize")
+      .autoVerify(VerifyKind::SameType, {"Gradient", "Weight", "Gsum"});
+
+  /// Applies one fused Adam update step to Weight in place. M and V
+  /// accumulate the first and the second gradient moments and Step counts
+  /// the updates for the bias correction.
+  BB.newInstr("Adam")
+      .addOperand("Gradient", OperandKind::In)
+      .addOperand("Weight", OperandKind::InOut)
+      .addOperand("M", OperandKind::InOut)
+      .addOperand("V", OperandKind::InOut)
+      .addOperand("Step", OperandKind::InOut)
+      .addMember(MemberType::Float, "L1Decay")
+      .addMember(MemberType::Float, "L2Decay")
+      .addMember(MemberType::Float, "LearningRate")
+      .addMember(MemberType::Float, "Beta1")
+      .addMember(MemberType::Float, "Beta2")
+      .addMember(MemberType::Float, "Epsilon")
+      .addMember(MemberType::Unsigned, "BatchSize")
+      .autoVerify(VerifyKind::SameType, {"Gradient", "Weight", "M", "V"});
+
+  /// Applies one fused RMSProp update step to Weight in place. MeanSquare
+  /// accumulates the running average of the squared gradients.
+  BB.newInstr("RMSProp")
+      .addOperand("Gradient", OperandKind::In)
+      .addOperand("Weight", OperandKind::InOut)
+      .addOperand("MeanSquare", OperandKind::InOut)
+      .addMember(MemberType::Float, "L1Decay")
+      .addMember(MemberType::Float, "L2Decay")
+      .addMember(MemberType::Float, "LearningRate")
+      .addMember(MemberType::Float, "Decay")
+      .addMember(MemberType::Float, "Epsilon")
+      .addMember(MemberType::Unsigned, "BatchSize")
+      .autoVerify(VerifyKind::SameType, {"Gradient", "Weight", "MeanSquare"});
+
   //===--------------------------------------------------------------------===//
   //                      Arithmetic
   //===--------------------------------------------------------------------===//
@@ -185,6 +237,13 @@ int main(int argc, char **argv) {
       .autoIRGen()
       .autoVerify(VerifyKind::SameElementType, {"Dest", "LHS", "RHS"});
 
+  BB.newInstr("BatchMatMul")
+      .addOperand("Dest", OperandKind::Out)
+      .addOperand("LHS", OperandKind::In)
+      .addOperand("RHS", OperandKind::In)
+      .autoIRGen()
+      .autoVerify(VerifyKind::SameElementType, {"Dest", "LHS", "RHS"});
+
   /// Accumulates all of the layers in the batch along the Axis dimension and
   /// produce a tensor that has the same dimensions as the input tensor without
   /// the Axis dimension.
@@ -202,7 +261,7 @@ int main(int argc, char **argv) {
       .addOperand("Lengths", OperandKind::In)
       .autoIRGen()
       .autoVerify(VerifyKind::SameElementType, {"Dest", "Data"})
-      .autoVerify(VerifyKind::SameElementType, {"Indices", "ElemKind::IndexTy"})
+      .autoVerify(VerifyKind::IndexElementType, {"Indices"})
       .autoVerify(VerifyKind::SameElementType,
                   {"Lengths", "ElemKind::IndexTy"});
 
@@ -221,6 +280,7 @@ int main(int argc, char **argv) {
       .addOperand("RHS", OperandKind::In)
       .inplaceOperand({"Dest", "LHS", "RHS"})
       .dataParallel()
+      .scalarKernel("LHS[i] + RHS[i]")
       .autoVerify(VerifyKind::SameShape, {"Dest", "LHS", "RHS"})
       .autoIRGen("Add");
 
@@ -230,6 +290,7 @@ int main(int argc, char **argv) {
       .addOperand("RHS", OperandKind::In)
       .inplaceOperand({"Dest", "LHS", "RHS"})
       .dataParallel()
+      .scalarKernel("LHS[i] - RHS[i]")
       .autoVerify(VerifyKind::SameShape, {"Dest", "LHS", "RHS"})
       .autoIRGen("Sub");
 
@@ -239,6 +300,7 @@ int main(int argc, char **argv) {
       .addOperand("RHS", OperandKind::In)
       .inplaceOperand({"Dest", "LHS", "RHS"})
       .dataParallel()
+      .scalarKernel("LHS[i] * RHS[i]")
       .autoVerify(VerifyKind::SameShape, {"Dest", "LHS", "RHS"})
       .autoIRGen("Mul");
 
@@ -248,6 +310,7 @@ int main(int argc, char **argv) {
       .addOperand("RHS", OperandKind::In)
       .inplaceOperand({"Dest", "LHS", "RHS"})
       .dataParallel()
+      .scalarKernel("LHS[i] / RHS[i]")
       .autoVerify(VerifyKind::SameShape, {"Dest", "LHS", "RHS"})
       .autoIRGen("Div");
 
@@ -257,6 +320,7 @@ int main(int argc, char **argv) {
       .addOperand("RHS", OperandKind::In)
       .inplaceOperand({"Dest", "LHS", "RHS"})
       .dataParallel()
+      .scalarKernel("LHS[i] > RHS[i] ? LHS[i] : RHS[i]")
       .autoVerify(VerifyKind::SameShape, {"Dest", "LHS", "RHS"})
       .autoIRGen("Max");
 
@@ -266,6 +330,7 @@ int main(int argc, char **argv) {
       .addOperand("RHS", OperandKind::In)
       .inplaceOperand({"Dest", "LHS", "RHS"})
       .dataParallel()
+      .scalarKernel("LHS[i] < RHS[i] ? LHS[i] : RHS[i]")
       .autoVerify(VerifyKind::SameShape, {"Dest", "LHS", "RHS"})
       .autoIRGen("Min");
 
@@ -275,6 +340,7 @@ int main(int argc, char **argv) {
       .addOperand("RHS", OperandKind::In)
       .inplaceOperand({"Dest", "LHS", "RHS"})
       .dataParallel()
+      .scalarKernel("LHS[i] <= RHS[i] ? 1 : 0")
       .autoVerify(VerifyKind::SameShape, {"Dest", "LHS", "RHS"})
       .autoIRGen("CmpLTE");
 
@@ -284,6 +350,7 @@ int main(int argc, char **argv) {
       .addOperand("RHS", OperandKind::In)
       .inplaceOperand({"Dest", "LHS", "RHS"})
       .dataParallel()
+      .scalarKernel("LHS[i] == RHS[i] ? 1 : 0")
       .autoVerify(VerifyKind::SameShape, {"Dest", "LHS", "RHS"})
       .autoIRGen("CmpEQ");
 
@@ -293,6 +360,7 @@ int main(int argc, char **argv) {
       .addMember(MemberType::Float, "Exp")
       .inplaceOperand({"Dest", "Base"})
       .dataParallel()
+      .scalarKernel("powf(Base[i], imm)")
       .autoVerify(VerifyKind::SameShape, {"Dest", "Base"})
       .autoIRGen("Pow");
 
@@ -304,6 +372,7 @@ int main(int argc, char **argv) {
           "Src",
       })
       .dataParallel()
+      .scalarKernel("logf(Src[i])")
       .autoVerify(VerifyKind::SameType, {"Dest", "Src"})
       .autoIRGen("Log");
 
@@ -314,6 +383,7 @@ int main(int argc, char **argv) {
       .addOperand("RHS", OperandKind::In)
       .inplaceOperand({"Dest", "LHS", "RHS", "Cond"})
       .dataParallel()
+      .scalarKernel("Cond[i] != 0 ? LHS[i] : RHS[i]")
       .autoVerify(VerifyKind::SameShape, {"Dest", "Cond", "LHS", "RHS"})
       .autoIRGen("Select");
 
@@ -329,6 +399,7 @@ int main(int argc, char **argv) {
           "Src",
       })
       .dataParallel()
+      .scalarKernel("1 / (1 + expf(-Src[i]))")
       .autoVerify(VerifyKind::SameType, {"Dest", "Src"})
       .autoIRGen();
 
@@ -340,6 +411,7 @@ int main(int argc, char **argv) {
           "Src",
       })
       .dataParallel()
+      .scalarKernel("tanhf(Src[i])")
       .autoVerify(VerifyKind::SameType, {"Dest", "Src"})
       .autoIRGen();
 
@@ -354,10 +426,17 @@ int main(int argc, char **argv) {
       .autoVerify(VerifyKind::SameElementType, {"Dest", "Src"})
       .autoIRGen();
 
+  BB.newInstr("Broadcast")
+      .addOperand("Dest", OperandKind::Out)
+      .addOperand("Src", OperandKind::In)
+      .autoVerify(VerifyKind::SameElementType, {"Dest", "Src"})
+      .autoIRGen();
+
   BB.newInstr("Splat")
       .addMember(MemberType::Float, "Value")
       .addOperand("Dest", OperandKind::Out)
       .dataParallel()
+      .scalarKernel("imm")
       .autoVerify(VerifyKind::NoVerify)
       .autoIRGen();
 
@@ -380,15 +459,14 @@ int main(int argc, char **argv) {
       .addOperand("Indices", OperandKind::In)
       .addMember(MemberType::Unsigned, "BatchDims")
       .autoVerify(VerifyKind::SameElementType, {"Dest", "Data"})
-      .autoVerify(VerifyKind::SameElementType, {"Indices", "ElemKind::IndexTy"})
+      .autoVerify(VerifyKind::IndexElementType, {"Indices"})
       .autoIRGen();
 
   BB.newInstr("ScatterAssign")
       .addOperand("Data", OperandKind::InOut)
       .addOperand("Indices", OperandKind::In)
       .addOperand("Slices", OperandKind::In)
-      .autoVerify(VerifyKind::SameElementType,
-                  {"Indices", "ElemKind::IndexTy"});
+      .autoVerify(VerifyKind::IndexElementType, {"Indices"});
 
   //===--------------------------------------------------------------------===//
   //             Instructions used for debugging/profiling/printing
@@ -455,6 +533,30 @@ int main(int argc, char **argv) {
       .autoVerify(VerifyKind::SameElementType, {"Values", "Input"})
       .autoVerify(VerifyKind::SameShape, {"Values", "Indices"});
 
+  BB.newInstr("LSTMCell")
+      .addOperand("NewH", OperandKind::Out)
+      .addOperand("NewC", OperandKind::Out)
+      .addOperand("Input", OperandKind::In)
+      .addOperand("H", OperandKind::In)
+      .addOperand("C", OperandKind::In)
+      .addOperand("Wx", OperandKind::In)
+      .addOperand("Wh", OperandKind::In)
+      .addOperand("Bias", OperandKind::In)
+      .autoVerify(VerifyKind::SameElementType, {"NewH", "Input"})
+      .autoVerify(VerifyKind::SameShape, {"NewH", "H"})
+      .autoVerify(VerifyKind::SameShape, {"NewC", "C"});
+
+  BB.newInstr("GRUCell")
+      .addOperand("NewH", OperandKind::Out)
+      .addOperand("Input", OperandKind::In)
+      .addOperand("H", OperandKind::In)
+      .addOperand("Wx", OperandKind::In)
+      .addOperand("Wh", OperandKind::In)
+      .addOperand("Bx", OperandKind::In)
+      .addOperand("Bh", OperandKind::In)
+      .autoVerify(VerifyKind::SameElementType, {"NewH", "Input"})
+      .autoVerify(VerifyKind::SameShape, {"NewH", "H"});
+
   //===--------------------------------------------------------------------===//
   //                Backend-Specific Instructions
   //===--------------------------------------------------------------------===//
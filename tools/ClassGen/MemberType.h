@@ -32,6 +32,11 @@ enum class MemberType : unsigned {
   VectorNodeValue,
 };
 
+inline bool isVectorType(MemberType ty) {
+  return ty == MemberType::VectorFloat || ty == MemberType::VectorNodeValue ||
+         ty == MemberType::VectorSizeT || ty == MemberType::VectorUnsigned;
+}
+
 inline const char *getReturnTypename(MemberType type) {
   const char *returnTypes[] = {"TypeRef",
                                "float",
@@ -46,16 +51,19 @@ inline const char *getReturnTypename(MemberType type) {
   return returnTypes[(int)type];
 }
 
+/// Vector members are stored in SmallVectors whose inline capacity covers
+/// the common arities (shapes, pads and kernel lists), so constructing,
+/// copying and destroying a node does not touch the heap in the common case.
 inline const char *getStorageTypename(MemberType type) {
   const char *storageTypes[] = {"TypeRef",
                                 "float",
                                 "unsigned",
                                 "size_t",
                                 "std::string",
-                                "std::vector<float>",
-                                "std::vector<unsigned>",
-                                "std::vector<size_t>",
-                                "std::vector<NodeHandle>",
+                                "llvm::SmallVector<float, 4>",
+                                "llvm::SmallVector<unsigned, 4>",
+                                "llvm::SmallVector<size_t, 6>",
+                                "llvm::SmallVector<NodeHandle, 2>",
                                 nullptr};
   return storageTypes[(int)type];
 }
@@ -66,9 +74,9 @@ inline const char *getCtorArgTypename(MemberType type) {
                                 "unsigned",
                                 "size_t",
                                 "std::string",
-                                "std::vector<float>",
-                                "std::vector<unsigned>",
-                                "std::vector<size_t>",
+                                "llvm::ArrayRef<float>",
+                                "llvm::ArrayRef<unsigned>",
+                                "llvm::ArrayRef<size_t>",
                                 "std::vector<NodeValue>",
                                 nullptr};
   return ctorArgTypes[(int)type];
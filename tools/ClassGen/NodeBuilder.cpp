@@ -16,6 +16,8 @@
 
 #include "NodeBuilder.h"
 
+#include <algorithm>
+
 void NodeBuilder::emitEnumModePrinters(std::ostream &os) const {
   os << "\nconst char *" << name_ << "Node::getModeStr(" << name_
      << "Node::Mode m) {\n";
@@ -65,16 +67,19 @@ void NodeBuilder::emitCtor(std::ostream &os) const {
        << "this, " << op << ")";
   }
 
-  // Initialize the members:
-  for (const auto &op : members_) {
-    if (op.first != MemberType::VectorNodeValue) {
-      os << ", " << op.second << "_(" << op.second << ")";
+  // Initialize the members, following the declaration order. The operand
+  // vectors are filled in the constructor body instead, because their
+  // elements need a parent pointer.
+  for (const auto &op : sortedMembers()) {
+    if (op.first == MemberType::VectorNodeValue) {
       continue;
     }
-    continue;
-    os << ", " << op.second << "_(" << op.second << ".begin(), " << op.second
-       << ".end()"
-       << ")";
+    if (isVectorType(op.first)) {
+      os << ", " << op.second << "_(" << op.second << ".begin(), " << op.second
+         << ".end())";
+      continue;
+    }
+    os << ", " << op.second << "_(" << op.second << ")";
   }
 
   // The constructor body:
@@ -115,11 +120,39 @@ void NodeBuilder::emitClassMembers(std::ostream &os) const {
   for (const auto &op : nodeInputs_) {
     os << "  NodeHandle " << op << "_;\n";
   }
-  for (const auto &op : members_) {
+  for (const auto &op : sortedMembers()) {
     os << "  " << getStorageTypename(op.first) << " " << op.second << "_;\n";
   }
 }
 
+std::vector<std::pair<MemberType, std::string>>
+NodeBuilder::sortedMembers() const {
+  // Declare the wide members (vectors, pointers, strings) before the narrow
+  // scalars, so the scalars pack into the tail of the object instead of
+  // padding out the middle.
+  auto rank = [](MemberType ty) -> int {
+    if (isVectorType(ty)) {
+      return 0;
+    }
+    switch (ty) {
+    case MemberType::TypeRef:
+    case MemberType::String:
+      return 1;
+    case MemberType::SizeT:
+      return 2;
+    default:
+      return 3;
+    }
+  };
+  auto sorted = members_;
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [&](const std::pair<MemberType, std::string> &a,
+                       const std::pair<MemberType, std::string> &b) {
+                     return rank(a.first) < rank(b.first);
+                   });
+  return sorted;
+}
+
 void NodeBuilder::emitMemberGetter(std::ostream &os, MemberType type,
                                    const std::string &name) const {
   // Synthesize the general getter.
@@ -332,21 +365,15 @@ void NodeBuilder::emitEquator(std::ostream &os) const {
   os << ";\n}\n";
 }
 
-static bool isVectorType(MemberType ty) {
-  return ty == MemberType::VectorFloat || ty == MemberType::VectorNodeValue ||
-         ty == MemberType::VectorSizeT || ty == MemberType::VectorUnsigned;
-}
-
 void NodeBuilder::emitHasher(std::ostream &os) const {
   os << "\nllvm::hash_code " << name_ << "Node::getHash() const {\n"
      << "  return llvm::hash_combine(";
 
-  if (enum_.empty() && nodeInputs_.empty() && members_.empty()) {
-    os << "0);\n }\n";
-    return;
-  }
-
-  auto delim = "";
+  // Always mix in the node kind so that nodes of different classes with
+  // identical members and inputs do not collide in hash tables keyed by the
+  // node hash, like the one used by CSE.
+  os << "\n      getKind()";
+  auto delim = ",";
   if (!enum_.empty()) {
     os << delim << "\n      getMode()";
     delim = ",";
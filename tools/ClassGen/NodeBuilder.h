@@ -161,6 +161,10 @@ private:
   /// Emits the class members (the fields of the class).
   void emitClassMembers(std::ostream &os) const;
 
+  /// \returns the members ordered for declaration: wide members (vectors,
+  /// pointers, strings) before narrow scalars, so the object layout packs.
+  std::vector<std::pair<MemberType, std::string>> sortedMembers() const;
+
   /// Emit the getter for a accessible class member.
   void emitMemberGetter(std::ostream &os, MemberType type,
                         const std::string &name) const;
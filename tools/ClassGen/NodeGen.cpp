@@ -264,6 +264,14 @@ int main(int argc, char **argv) {
       .setDocstring("Performs matrix multiplication between the LHS RHS."
                     "Example: (A, Z) x (Z, B) => (A, B)");
 
+  BB.newNode("BatchMatMul")
+      .addInput("LHS")
+      .addInput("RHS")
+      .addResultFromCtorArg()
+      .setDocstring("Performs matrix multiplication between each pair of "
+                    "corresponding slices of the LHS and RHS batches."
+                    "Example: (N, A, Z) x (N, Z, B) => (N, A, B)");
+
   BB.newNode("BatchedReduceAdd")
       .addInput("Batch")
       .addMember(MemberType::SizeT, "Axis")
@@ -326,6 +334,16 @@ int main(int argc, char **argv) {
       .setDocstring("Transpose the Input tensor based on the vector Shuffle, "
                     "which assigns a new axis for each dimension in Input.");
 
+  BB.newNode("Broadcast")
+      .addInput("Input")
+      .addResultFromCtorArg()
+      .setDocstring("Broadcast the Input tensor to the shape of the result: "
+                    "every dimension of Input is either equal to the result "
+                    "dimension or has size one, and the size-one dimensions "
+                    "are stretched by repeating the data. The repetition "
+                    "happens in the kernel that writes the result, so no "
+                    "intermediate tiled tensors are materialized.");
+
   BB.newNode("Concat")
       .addMember(MemberType::VectorNodeValue, "Inputs")
       .addMember(MemberType::Unsigned, "Dim")
@@ -403,6 +421,41 @@ int main(int argc, char **argv) {
                     "Produces the updated weight that needs to be used "
                     "instead of Weight for the next iteration.");
 
+  BB.newNode("Adam")
+      .addInput("Gradient")
+      .addInput("Weight")
+      .addMember(MemberType::Float, "L1Decay")
+      .addMember(MemberType::Float, "L2Decay")
+      .addMember(MemberType::Float, "LearningRate")
+      .addMember(MemberType::Float, "Beta1")
+      .addMember(MemberType::Float, "Beta2")
+      .addMember(MemberType::Float, "Epsilon")
+      .addMember(MemberType::Unsigned, "BatchSize")
+      .addResult("Weight.getType()", "UpdatedWeight")
+      .setHasSideEffects(true)
+      .setDocstring("Adam optimizer node used during training. Applies one "
+                    "fused update step - gradient scaling, weight decay, "
+                    "first and second moment tracking and bias correction - "
+                    "and produces the updated weight. Executed natively by "
+                    "backends that implement the fused Adam instruction.");
+
+  BB.newNode("RMSProp")
+      .addInput("Gradient")
+      .addInput("Weight")
+      .addMember(MemberType::Float, "L1Decay")
+      .addMember(MemberType::Float, "L2Decay")
+      .addMember(MemberType::Float, "LearningRate")
+      .addMember(MemberType::Float, "Decay")
+      .addMember(MemberType::Float, "Epsilon")
+      .addMember(MemberType::Unsigned, "BatchSize")
+      .addResult("Weight.getType()", "UpdatedWeight")
+      .setHasSideEffects(true)
+      .setDocstring("RMSProp optimizer node used during training. Applies "
+                    "one fused update step that scales the gradient by a "
+                    "running average of its recent magnitudes and produces "
+                    "the updated weight. Executed natively by backends that "
+                    "implement the fused RMSProp instruction.");
+
   //===--------------------------------------------------------------------===//
   //                Nodes used by quantization.
   //===--------------------------------------------------------------------===//
@@ -477,6 +530,42 @@ int main(int argc, char **argv) {
                     "the outputs {D_0, D_1, ... D_n-1, K}, sorted in "
                     "non-decreasing order.");
 
+  BB.newNode("LSTMCell")
+      .addInput("Input")
+      .addInput("H")
+      .addInput("C")
+      .addInput("Wx")
+      .addInput("Wh")
+      .addInput("Bias")
+      .addResult("H.getType()", "NewH")
+      .addResult("C.getType()", "NewC")
+      .setDocstring(
+          "Performs a single fused LSTM timestep. Input is {batch, "
+          "inputSize}, H and C are the previous hidden and cell states "
+          "{batch, hiddenSize}. Wx is {inputSize, 4 * hiddenSize}, Wh is "
+          "{hiddenSize, 4 * hiddenSize} and Bias is {4 * hiddenSize}, with "
+          "the input, forget, cell and output gates packed in that order. "
+          "Produces the new hidden and cell states.");
+
+  BB.newNode("GRUCell")
+      .addInput("Input")
+      .addInput("H")
+      .addInput("Wx")
+      .addInput("Wh")
+      .addInput("Bx")
+      .addInput("Bh")
+      .addResult("H.getType()", "NewH")
+      .setDocstring(
+          "Performs a single fused GRU timestep. Input is {batch, "
+          "inputSize} and H is the previous hidden state {batch, "
+          "hiddenSize}. Wx is {inputSize, 3 * hiddenSize}, Wh is "
+          "{hiddenSize, 3 * hiddenSize} and Bx/Bh are the input-side and "
+          "recurrent biases {3 * hiddenSize}, with the update, reset and "
+          "candidate gates packed in that order. The reset gate scales the "
+          "recurrent pre-activation of the candidate after the matrix "
+          "multiply (the 'linear before reset' formulation), so the two "
+          "matrix multiplies can each be done as one wide GEMM.");
+
   //===--------------------------------------------------------------------===//
   //                Backend-Specific Nodes
   //===--------------------------------------------------------------------===//
@@ -27,6 +27,15 @@
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+
 using namespace glow;
 
 namespace {
@@ -83,6 +92,15 @@ llvm::cl::opt<std::string> loadProfileFileOpt(
     llvm::cl::value_desc("profile.yaml"), llvm::cl::Optional,
     llvm::cl::cat(loaderCat));
 
+llvm::cl::opt<bool> profileAndQuantizeOpt(
+    "profile-and-quantize",
+    llvm::cl::desc("Profile the graph on the given inputs, quantize it in "
+                   "memory based on the captured profile, and compile the "
+                   "quantized graph, all in one invocation. This combines "
+                   "the -dump_profile and -load_profile runs without "
+                   "importing the model twice."),
+    llvm::cl::Optional, llvm::cl::cat(loaderCat));
+
 llvm::cl::opt<BackendKind> ExecutionBackend(
     llvm::cl::desc("Backend to use:"),
     llvm::cl::values(clEnumValN(BackendKind::Interpreter, "interpreter",
@@ -112,10 +130,23 @@ llvm::cl::opt<std::string>
     emitBundle("emit-bundle",
                llvm::cl::desc("Output directory for the bundle serialization"),
                llvm::cl::cat(loaderCat));
+
+llvm::cl::opt<std::string> daemonSocketPathOpt(
+    "daemon",
+    llvm::cl::desc("Stay resident after compilation and serve inference "
+                   "requests over the given unix domain socket, passing "
+                   "tensors through posix shared memory. This amortizes the "
+                   "model import and compile time across requests."),
+    llvm::cl::value_desc("socket path"), llvm::cl::Optional,
+    llvm::cl::cat(loaderCat));
 } // namespace
 
 bool glow::emittingBundle() { return !emitBundle.empty(); }
 
+bool glow::runningDaemon() { return !daemonSocketPathOpt.empty(); }
+
+bool glow::profilingAndQuantizing() { return profileAndQuantizeOpt; }
+
 static bool commandLineIsInvalid() {
   if (!dumpProfileFileOpt.empty() && !loadProfileFileOpt.empty()) {
     llvm::errs() << "Loader: the -" << dumpProfileFileOpt.ArgStr << " and -"
@@ -123,10 +154,27 @@ static bool commandLineIsInvalid() {
                  << " options may not be specified together.\n";
     return true;
   }
+  if (profileAndQuantizeOpt &&
+      (!dumpProfileFileOpt.empty() || !loadProfileFileOpt.empty())) {
+    llvm::errs() << "Loader: the -" << profileAndQuantizeOpt.ArgStr
+                 << " option may not be specified together with -"
+                 << dumpProfileFileOpt.ArgStr << " or -"
+                 << loadProfileFileOpt.ArgStr << ".\n";
+    return true;
+  }
   return false;
 }
 
 void Loader::compile() {
+  // In one-shot profile-and-quantize mode, keep the optimized function
+  // around and compile its instrumented copy for the profiling run; the
+  // kept function is quantized after the run without a second import.
+  if (profileAndQuantizeOpt) {
+    ::optimize(F_, glow::CompilationMode::Infer);
+    preQuantF_ = F_;
+    F_ = ::profileQuantization(F_);
+  }
+
   // Handle the request to profile the graph in preperation for quantization.
   if (!dumpProfileFileOpt.empty()) {
     // Perform the high-level optimizations before instrumenting the graph. This
@@ -155,14 +203,22 @@ void Loader::compile() {
     F_->setName("old");
 
     // Quantize the graph based on the captured profile.
-    F_ = quantization::quantizeFunction(EE_, quantizationInfos, F_, oldName);
+    Function *origF = F_;
+    F_ = quantization::quantizeFunction(EE_, quantizationInfos, origF, oldName);
+
+    // Erase the original float function: once the optimizer folds the
+    // quantized weights, its float weights become dead and are not laid out
+    // into the compiled image or the emitted bundle.
+    EE_.getModule().eraseFunction(origF);
   }
 
-  if (emittingBundle()) {
+  if (emittingBundle() && !profileAndQuantizeOpt) {
     // Emit IR for the graph, compile it and save as a bundle.
     EE_.save(CompilationMode::Infer, F_, emitBundle);
   } else {
-    // Emit IR for the graph and compile it.
+    // Emit IR for the graph and compile it. In profile-and-quantize mode
+    // the bundle is emitted after the profiling run, once the quantized
+    // function has been built.
     EE_.compile(CompilationMode::Infer, F_);
   }
 
@@ -198,6 +254,157 @@ void Loader::runInference(llvm::ArrayRef<Variable *> variables,
         quantization::generateNodeQuantizationInfos(F_, quantizationSchema);
     serializeToYaml(dumpProfileFileOpt, QI);
   }
+
+  if (profileAndQuantizeOpt) {
+    // Quantize the kept-in-memory function based on the profile that was
+    // just captured, and compile the quantized function or emit it as a
+    // bundle, all without re-importing the model.
+    std::vector<NodeQuantizationInfo> QI =
+        quantization::generateNodeQuantizationInfos(F_, quantizationSchema);
+    std::string oldName = preQuantF_->getName();
+    preQuantF_->setName("old");
+    Function *profileF = F_;
+    F_ = quantization::quantizeFunction(EE_, QI, preQuantF_, oldName);
+
+    // Drop the instrumented profile function and the float original, so
+    // that only the quantized weights survive into the compiled image or
+    // the emitted bundle.
+    EE_.getModule().eraseFunction(profileF);
+    EE_.getModule().eraseFunction(preQuantF_);
+    preQuantF_ = nullptr;
+
+    if (emittingBundle()) {
+      EE_.save(CompilationMode::Infer, F_, emitBundle);
+    } else {
+      EE_.compile(CompilationMode::Infer, F_);
+    }
+  }
+}
+
+/// Reads exactly \p size bytes from \p fd into \p data. \returns false on
+/// end of stream or error.
+static bool readAll(int fd, void *data, size_t size) {
+  char *buf = (char *)data;
+  while (size) {
+    ssize_t n = read(fd, buf, size);
+    if (n <= 0) {
+      return false;
+    }
+    buf += n;
+    size -= n;
+  }
+  return true;
+}
+
+/// Writes exactly \p size bytes from \p data to \p fd. \returns false on
+/// error.
+static bool writeAll(int fd, const void *data, size_t size) {
+  const char *buf = (const char *)data;
+  while (size) {
+    ssize_t n = write(fd, buf, size);
+    if (n <= 0) {
+      return false;
+    }
+    buf += n;
+    size -= n;
+  }
+  return true;
+}
+
+void Loader::runDaemon(llvm::ArrayRef<Variable *> inputs, Variable *output) {
+  assert(!emittingBundle() &&
+         "No inference is performed in the bundle generation mode.");
+
+  int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+  GLOW_ASSERT(sock >= 0 && "Cannot create the daemon socket.");
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  GLOW_ASSERT(daemonSocketPathOpt.size() < sizeof(addr.sun_path) &&
+              "The daemon socket path is too long.");
+  strncpy(addr.sun_path, daemonSocketPathOpt.c_str(),
+          sizeof(addr.sun_path) - 1);
+  ::unlink(daemonSocketPathOpt.c_str());
+  GLOW_ASSERT(!bind(sock, (struct sockaddr *)&addr, sizeof(addr)) &&
+              "Cannot bind the daemon socket.");
+  GLOW_ASSERT(!listen(sock, 4) && "Cannot listen on the daemon socket.");
+
+  // The layout of the shared memory segment: the input payloads back to
+  // back, followed by the output payload.
+  std::vector<size_t> inputOffsets;
+  size_t segmentSize = 0;
+  for (auto *V : inputs) {
+    inputOffsets.push_back(segmentSize);
+    segmentSize += V->getType()->getSizeInBytes();
+  }
+  size_t outputOffset = segmentSize;
+  segmentSize += output->getType()->getSizeInBytes();
+
+  llvm::outs() << "Serving inference requests on " << daemonSocketPathOpt
+               << "\n";
+  bool stopping = false;
+  while (!stopping) {
+    int conn = accept(sock, nullptr, nullptr);
+    if (conn < 0) {
+      continue;
+    }
+
+    for (;;) {
+      // One request is the length-prefixed name of the posix shared memory
+      // segment that carries the tensor payloads. An empty name shuts the
+      // daemon down.
+      uint32_t nameLen;
+      if (!readAll(conn, &nameLen, sizeof(nameLen))) {
+        break;
+      }
+      if (!nameLen) {
+        char status = 1;
+        writeAll(conn, &status, sizeof(status));
+        stopping = true;
+        break;
+      }
+      std::string name(nameLen, '\0');
+      if (!readAll(conn, &name[0], nameLen)) {
+        break;
+      }
+
+      // Map the segment, run over unowned tensors that alias the input
+      // payloads in it, and write the result back into the segment.
+      char status = 0;
+      int shmFd = shm_open(name.c_str(), O_RDWR, 0);
+      if (shmFd >= 0) {
+        void *base = mmap(nullptr, segmentSize, PROT_READ | PROT_WRITE,
+                          MAP_SHARED, shmFd, 0);
+        if (base != MAP_FAILED) {
+          std::vector<Tensor> inputTensors;
+          std::vector<Tensor *> inputTensorPtrs;
+          for (size_t i = 0, e = inputs.size(); i < e; i++) {
+            inputTensors.emplace_back((char *)base + inputOffsets[i],
+                                      inputs[i]->getType());
+          }
+          for (auto &T : inputTensors) {
+            inputTensorPtrs.push_back(&T);
+          }
+
+          EE_.run(inputs, inputTensorPtrs);
+
+          Tensor &res = output->getPayload();
+          memcpy((char *)base + outputOffset, res.getUnsafePtr(),
+                 res.getSizeInBytes());
+          status = 1;
+          munmap(base, segmentSize);
+        }
+        close(shmFd);
+      }
+      if (!writeAll(conn, &status, sizeof(status))) {
+        break;
+      }
+    }
+    close(conn);
+  }
+
+  close(sock);
+  ::unlink(daemonSocketPathOpt.c_str());
 }
 
 Loader::Loader(int argc, char **argv) {
@@ -25,6 +25,12 @@ class Tensor;
 /// \return true if emit bundle mode is enabled.
 bool emittingBundle();
 
+/// \return true if daemon mode is enabled.
+bool runningDaemon();
+
+/// \return true if one-shot profile-and-quantize mode is enabled.
+bool profilingAndQuantizing();
+
 /// Driver class for loading, compiling, and running inference for ONNX and
 /// Caffe2 models.
 class Loader {
@@ -38,10 +44,15 @@ class Loader {
   ExecutionEngine EE_{};
   /// Function containing the model.
   Function *F_{nullptr};
+  /// In profile-and-quantize mode, the optimized function that is quantized
+  /// after the profiling run; F_ points at its instrumented copy until then.
+  Function *preQuantF_{nullptr};
 
 public:
   /// Getter for the Function.
   Function *getFunction() { return F_; }
+  /// Getter for the ExecutionEngine.
+  ExecutionEngine &getExecutionEngine() { return EE_; }
   /// Getter for the Caffe2 network file name.
   llvm::StringRef getCaffe2NetDescFilename() { return caffe2NetDescFilename_; }
   /// Getter for the Caffe2 weights file name.
@@ -60,6 +71,16 @@ public:
   void runInference(llvm::ArrayRef<Variable *> variables,
                     llvm::ArrayRef<Tensor *> tensors);
 
+  /// Stays resident with the compiled function warm and serves inference
+  /// requests over the unix domain socket named by the -daemon option,
+  /// amortizing the import and compile time across requests. Each request
+  /// carries the name of a posix shared memory segment that holds the
+  /// payloads of the variables \p inputs back to back, followed by space
+  /// for the payload of \p output; the result is written back into the
+  /// segment and a one-byte status is sent in reply. A request with an
+  /// empty name shuts the daemon down.
+  void runDaemon(llvm::ArrayRef<Variable *> inputs, Variable *output);
+
   /// Create the Loader driver object, and parse/verify the command line
   /// parameters.
   Loader(int argc, char **argv);
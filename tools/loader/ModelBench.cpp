@@ -0,0 +1,159 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Loader.h"
+
+#include "glow/Graph/Nodes.h"
+#include "glow/Importer/Caffe2.h"
+#include "glow/Importer/ONNX.h"
+#include "glow/Support/Compiler.h"
+#include "glow/Support/Random.h"
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+using namespace glow;
+
+namespace {
+llvm::cl::OptionCategory modelBenchCat("Model Benchmark Options");
+
+llvm::cl::list<unsigned> batchSizesOpt(
+    "batch-sizes",
+    llvm::cl::desc("Comma separated batch sizes to sweep (default: 1,8,64)"),
+    llvm::cl::CommaSeparated, llvm::cl::cat(modelBenchCat));
+
+llvm::cl::opt<std::string> inputNameOpt(
+    "input-name", llvm::cl::desc("Name of the model's input tensor"),
+    llvm::cl::init("data"), llvm::cl::cat(modelBenchCat));
+
+llvm::cl::opt<unsigned>
+    warmupRunsOpt("warmup-runs",
+                  llvm::cl::desc("Untimed inferences before the steady-state "
+                                 "measurement of each configuration"),
+                  llvm::cl::init(3), llvm::cl::cat(modelBenchCat));
+
+llvm::cl::opt<unsigned>
+    steadyRunsOpt("steady-runs",
+                  llvm::cl::desc("Timed inferences per configuration"),
+                  llvm::cl::init(100), llvm::cl::cat(modelBenchCat));
+} // namespace
+
+/// \returns the current time in seconds.
+static double now() {
+  return std::chrono::duration<double>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+int main(int argc, char **argv) {
+  // The loader verifies/initializes command line parameters, and initializes
+  // the ExecutionEngine and Function.
+  Loader loader(argc, argv);
+  auto &EE = loader.getExecutionEngine();
+  auto &mod = EE.getModule();
+
+  // Import the model once to discover the shape and type of its input.
+  std::unique_ptr<ProtobufLoader> LD;
+  if (!loader.getCaffe2NetDescFilename().empty()) {
+    LD.reset(new caffe2ModelLoader(loader.getCaffe2NetDescFilename(),
+                                   loader.getCaffe2NetWeightFilename(), {}, {},
+                                   *loader.getFunction()));
+  } else {
+    LD.reset(new ONNXModelLoader(loader.getOnnxModelFilename(), {}, {},
+                                 *loader.getFunction()));
+  }
+  Variable *input = LD->getVariableByName(inputNameOpt);
+  GLOW_ASSERT(input && "The model has no input with the requested name. "
+                       "Use -input-name to select it.");
+  std::vector<size_t> baseDims(input->dims().begin(), input->dims().end());
+  ElemKind elemKind = input->getType()->getElementType();
+  std::string model = !loader.getCaffe2NetDescFilename().empty()
+                          ? loader.getCaffe2NetDescFilename().str()
+                          : loader.getOnnxModelFilename().str();
+
+  std::vector<unsigned> batchSizes(batchSizesOpt.begin(), batchSizesOpt.end());
+  if (batchSizes.empty()) {
+    batchSizes = {1, 8, 64};
+  }
+
+  // One CSV row per configuration, for the fleet dashboards. Per-kernel
+  // thread counts are process-wide flags (-conv-num-threads etc), so thread
+  // sweeps are driven by invoking the tool once per thread count.
+  llvm::outs() << "model,batch,compile_s,first_s,min_s,median_s,p95_s,p99_s,"
+                  "inferences_per_s\n";
+
+  for (unsigned batch : batchSizes) {
+    // Re-import the model with the input resized to the requested batch.
+    auto dims = baseDims;
+    dims[0] = batch;
+    Tensor in(elemKind, dims);
+    if (elemKind == ElemKind::FloatTy) {
+      PseudoRNG PRNG;
+      in.getHandle<float>().randomize(-1.0, 1.0, PRNG);
+    }
+    Function *F = mod.createFunction("batch" + std::to_string(batch));
+    std::unique_ptr<ProtobufLoader> batchLD;
+    if (!loader.getCaffe2NetDescFilename().empty()) {
+      batchLD.reset(new caffe2ModelLoader(loader.getCaffe2NetDescFilename(),
+                                          loader.getCaffe2NetWeightFilename(),
+                                          {inputNameOpt.c_str()}, {&in}, *F));
+    } else {
+      batchLD.reset(new ONNXModelLoader(loader.getOnnxModelFilename(),
+                                        {inputNameOpt.c_str()}, {&in}, *F));
+    }
+    Variable *batchInput = batchLD->getVariableByName(inputNameOpt);
+
+    double start = now();
+    EE.compile(CompilationMode::Infer, F);
+    double compileTime = now() - start;
+
+    // The first inference pays for cold caches and lazy initialization, so
+    // report it separately from the steady state.
+    start = now();
+    EE.run({batchInput}, {&in});
+    double firstTime = now() - start;
+
+    for (unsigned i = 0; i < warmupRunsOpt; i++) {
+      EE.run({batchInput}, {&in});
+    }
+
+    std::vector<double> samples;
+    samples.reserve(steadyRunsOpt);
+    for (unsigned i = 0; i < steadyRunsOpt; i++) {
+      start = now();
+      EE.run({batchInput}, {&in});
+      samples.push_back(now() - start);
+    }
+    std::sort(samples.begin(), samples.end());
+    double median = samples[samples.size() / 2];
+    double p95 = samples[(samples.size() - 1) * 95 / 100];
+    double p99 = samples[(samples.size() - 1) * 99 / 100];
+
+    llvm::outs() << model << "," << batch << ","
+                 << llvm::format("%g,%g,%g,%g,%g,%g,%g", compileTime,
+                                 firstTime, samples.front(), median, p95, p99,
+                                 batch / median)
+                 << "\n";
+  }
+
+  return 0;
+}
@@ -45,8 +45,10 @@ int main(int argc, char **argv) {
   // if requested from command line.
   loader.compile();
 
-  // If in bundle mode, do not run inference.
-  if (!emittingBundle()) {
+  // If in bundle mode, do not run inference. In profile-and-quantize mode
+  // inference runs even when a bundle is requested: it is the calibration
+  // pass, and the quantized bundle is emitted after it.
+  if (!emittingBundle() || profilingAndQuantizing()) {
     loader.runInference({}, {});
 
     llvm::outs() << "Model: " << loader.getFunction()->getName() << "\n";